@@ -116,9 +116,10 @@ void list_removeByValue(list_t *pList, void *value, int withFree) {
 	list_t *pNext = pList->next;
 	while(pNext != NULL) {
 		if (pNext->value == value) {
-			list_delete(pList, pNext, withFree);
+			list_remove(pList, pNext, withFree);
 			return;
 		}
+		pNext = pNext->next;
 	} // End while
 } // list_deleteByValue
 
@@ -9,6 +9,7 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
+#include <freertos/task.h>
 #include <bt.h>              // ESP32 BLE
 #include <esp_bt_main.h>     // ESP32 BLE
 #include <esp_gap_ble_api.h> // ESP32 BLE
@@ -35,7 +36,7 @@ static EventGroupHandle_t g_eventGroup;
 #define EVENT_GROUP_SCAN_COMPLETE (1<<0)
 
 
-//static esp_gatt_if_t g_gattc_if;
+static esp_gatt_if_t g_gattc_if;
 
 /*
  * We maintain a map of found devices.  The map is keyed off the 6 byte address value of the device.
@@ -44,7 +45,15 @@ static EventGroupHandle_t g_eventGroup;
  */
 static std::map<ble_address, BLEDevice> g_devices;
 
+/*
+ * Every advertisement is first recorded in the scan cache.  Only those from a device that is new
+ * or whose payload has changed are parsed into g_devices.
+ */
+static BLE::ScanCache g_scanCache;
+
 BLEServer *BLE::m_bleServer;
+BLEGattClientESP *BLE::m_pGattClient;
+BLEGateway *BLE::m_pGateway;
 
 BLE::BLE() {
 }
@@ -183,7 +192,7 @@ void gatt_server_event_handler(
 ) {
 	ESP_LOGD(LOG_TAG, "gatt_server_event_handler [esp_gatt_if: %d] ... %s",
 		gatts_if,
-		bt_utils_gatt_server_event_type_to_string(event).c_str());
+		bt_utils_gatt_server_event_type_to_string(event));
 	BLEUtils::dumpGattServerEvent(event, gatts_if, param);
 	if (BLE::m_bleServer != nullptr) {
 		BLE::m_bleServer->handleGATTServerEvent(event, gatts_if, param);
@@ -210,9 +219,17 @@ static void gatt_client_event_handler(
 	esp_ble_gattc_cb_param_t *param) {
 
 	ESP_LOGD(LOG_TAG, "gatt_client_event_handler [esp_gatt_if: %d] ... %s",
-		gattc_if, bt_utils_gatt_client_event_type_to_string(event).c_str());
+		gattc_if, bt_utils_gatt_client_event_type_to_string(event));
 	BLEUtils::dumpGattClientEvent(event, gattc_if, param);
 
+	if (event == ESP_GATTC_REG_EVT) {
+		g_gattc_if = gattc_if;
+	}
+	if (BLE::m_pGattClient != nullptr) {
+		BLE::m_pGattClient->handleGATTClientEvent(event, gattc_if, param);
+		return;
+	}
+
 	switch(event) {
 	case ESP_GATTC_OPEN_EVT: {
 		BLEDevice *pDevice = BLEUtils::findByAddress(std::string((char *)param->open.remote_bda, 6));
@@ -300,9 +317,7 @@ static void gap_event_handler(
 
 	switch(event) {
 		case ESP_GAP_BLE_SCAN_RESULT_EVT: {
-			BLEDevice device;
-
-			ESP_LOGD(LOG_TAG, "search_evt: %s", bt_gap_search_event_type_to_string(param->scan_rst.search_evt).c_str());
+			ESP_LOGD(LOG_TAG, "search_evt: %s", bt_gap_search_event_type_to_string(param->scan_rst.search_evt));
 
 			if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_CMPL_EVT) {
 				//ESP_LOGD(tag, "num_resps: %d", param->scan_rst.num_resps);
@@ -315,11 +330,26 @@ static void gap_event_handler(
 				//ESP_LOGD(tag, "rssi: %d", param->scan_rst.rssi);
 				//ESP_LOGD(tag, "addr_type: %s", bt_addr_t_to_string(param->scan_rst.ble_addr_type));
 				//ESP_LOGD(tag, "flag: %d", param->scan_rst.flag);
+				if (BLE::m_pGateway != nullptr) {
+					BLE::m_pGateway->onAdvertisement(
+						param->scan_rst.bda, param->scan_rst.rssi,
+						param->scan_rst.ble_adv, sizeof(param->scan_rst.ble_adv),
+						xTaskGetTickCount() * portTICK_PERIOD_MS);
+				}
+				BLE::ScanCache::Change change = g_scanCache.update(
+					param->scan_rst.bda, param->scan_rst.rssi,
+					param->scan_rst.ble_adv, sizeof(param->scan_rst.ble_adv),
+					xTaskGetTickCount());
+				if (change != BLE::ScanCache::NEW && change != BLE::ScanCache::PAYLOAD_CHANGED) {
+					break;
+				}
+				BLEDevice device;
 				device.setAddress(std::string((char *)param->scan_rst.bda, 6));
 				device.setRSSI(param->scan_rst.rssi);
 				device.setAdFlag(param->scan_rst.flag);
 				//device.dump();
-				device.parsePayload((uint8_t *)param->scan_rst.ble_adv);
+				device.parsePayload((uint8_t *)param->scan_rst.ble_adv, sizeof(param->scan_rst.ble_adv));
+				g_devices.erase(device.getAddress());
 				g_devices.insert(std::pair<std::string,BLEDevice>(device.getAddress(),device));
 				//dump_adv_payload(param->scan_rst.ble_adv);
 			} else {
@@ -352,11 +382,48 @@ static void gap_event_handler(
 /**
  * @brief Get the current set of known devices.
  */
-std::map<ble_address, BLEDevice> getDevices() {
+std::map<ble_address, BLEDevice> BLE::getDevices() {
 	return g_devices;
 } // getDevices
 
 
+/**
+ * @brief Get the cache of the advertisements seen by scans.
+ *
+ * Set its callback to hear of each device that is new or has changed, without the cost of
+ * building a BLEDevice for every advertisement.
+ */
+/**
+ * @brief Get the interface of the GATT client registered by initClient().
+ */
+esp_gatt_if_t BLE::getGattcIF() {
+	return g_gattc_if;
+} // getGattcIF
+
+
+BLE::ScanCache& BLE::getScanCache() {
+	return g_scanCache;
+} // getScanCache
+
+
+/**
+ * @brief Pass every advertisement a scan hears to a gateway.
+ * @param [in] pGateway The gateway, or nullptr to stop passing them.
+ */
+void BLE::setGateway(BLEGateway *pGateway) {
+	m_pGateway = pGateway;
+} // setGateway
+
+
+/**
+ * @brief Pass the GATT client events to a client manager instead of to the BLEDevice handling.
+ * @param [in] pGattClient The client, or nullptr to go back to the BLEDevice handling.
+ */
+void BLE::setGattClient(BLEGattClientESP *pGattClient) {
+	m_pGattClient = pGattClient;
+} // setGattClient
+
+
 /**
  * @brief Initialize the server %BLE environment.
  *
@@ -483,6 +550,7 @@ void BLE::initClient() {
  */
 void BLE::scan(int duration, esp_ble_scan_type_t scan_type) {
 	g_devices.clear();
+	g_scanCache.clear();
 	static esp_ble_scan_params_t ble_scan_params;
 	ble_scan_params.scan_type              = scan_type;
 	ble_scan_params.own_addr_type          = BLE_ADDR_TYPE_PUBLIC;
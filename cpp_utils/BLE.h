@@ -14,8 +14,11 @@
 #include <map>               // Part of C++ STL
 #include <string>
 
+#include "BLEGateway.h"
+#include "BLEScanCache.h"
 #include "BLEServer.h"
 #include "BLEDevice.h"
+#include "BLEGattClientESP.h"
 #include "BLEUtils.h"
 /**
  * @brief %BLE functions.
@@ -24,14 +27,21 @@ class BLE {
 public:
 	BLE();
 	virtual ~BLE();
+	typedef BLEScanCache<64> ScanCache;
+
 	static void dumpDevices();
 	static std::map<ble_address, BLEDevice> getDevices();
+	static ScanCache& getScanCache();
 
 	static void initClient();
 	static BLEServer *initServer(std::string deviceName);
 	static void scan(int duration, esp_ble_scan_type_t scan_type = BLE_SCAN_TYPE_PASSIVE);
 	static esp_gatt_if_t getGattcIF();
+	static void setGateway(BLEGateway *pGateway);
+	static void setGattClient(BLEGattClientESP *pGattClient);
 	static BLEServer *m_bleServer;
+	static BLEGattClientESP *m_pGattClient;
+	static BLEGateway *m_pGateway;
 }; // class BLE
 
 #endif // CONFIG_BT_ENABLED
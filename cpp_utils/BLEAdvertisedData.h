@@ -0,0 +1,116 @@
+/*
+ * BLEAdvertisedData.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVERTISEDDATA_H_
+#define COMPONENTS_CPP_UTILS_BLEADVERTISEDDATA_H_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The AD structures of an advertising payload, read in place.
+ *
+ * A payload is a sequence of structures of the form [length][type][data...], where the length
+ * counts the type and the data, ended by a zero length or by the end of the payload.  Iterating
+ * walks the payload without copying or allocating; each structure found points into it.  A
+ * structure that would run past the end of the payload ends the iteration.
+ *
+ * @code{.cpp}
+ * for (auto& field: BLEAdvertisedData(param->scan_rst.ble_adv, 31)) {
+ *   if (field.type == ESP_BLE_AD_TYPE_NAME_CMPL) { ... field.data, field.length ... }
+ * }
+ * @endcode
+ */
+class BLEAdvertisedData {
+public:
+	/**
+	 * @brief One AD structure.
+	 */
+	struct Field {
+		uint8_t        type;
+		uint8_t        length;   // The length of the data.
+		const uint8_t* data;
+	};
+
+	class Iterator {
+	public:
+		Iterator(const uint8_t* p, const uint8_t* pEnd) : m_p(p), m_pEnd(pEnd) {
+			read();
+		}
+		const Field& operator*() const {
+			return m_field;
+		}
+		const Field* operator->() const {
+			return &m_field;
+		}
+		Iterator& operator++() {
+			m_p += 2 + m_field.length;
+			read();
+			return *this;
+		}
+		bool operator!=(const Iterator& other) const {
+			return m_p != other.m_p;
+		}
+	private:
+		void read() {
+			if (m_p >= m_pEnd || m_p[0] == 0 || m_p[0] > m_pEnd - m_p - 1) {
+				m_p = m_pEnd;
+				return;
+			}
+			m_field.type   = m_p[1];
+			m_field.length = m_p[0] - 1;
+			m_field.data   = m_p + 2;
+		}
+		const uint8_t* m_p;
+		const uint8_t* m_pEnd;
+		Field          m_field;
+	}; // Iterator
+
+	BLEAdvertisedData(const uint8_t* payload, size_t length) : m_payload(payload), m_length(length) {}
+
+	Iterator begin() const {
+		return Iterator(m_payload, m_payload + m_length);
+	}
+	Iterator end() const {
+		return Iterator(m_payload + m_length, m_payload + m_length);
+	}
+
+	/**
+	 * @brief Find the first structure of a type.
+	 * @param [in] type The AD type sought.
+	 * @param [out] pField The structure, if found.
+	 * @return True if the payload has a structure of the type.
+	 */
+	bool find(uint8_t type, Field* pField) const {
+		for (const Field& field: *this) {
+			if (field.type == type) {
+				*pField = field;
+				return true;
+			}
+		}
+		return false;
+	} // find
+
+	/**
+	 * @brief Get the length of the payload up to the end of its last structure.
+	 *
+	 * The bytes after it are padding, and can differ between two copies of the same advertisement.
+	 */
+	size_t getUsedLength() const {
+		Iterator it = begin();
+		const uint8_t* pLast = m_payload;
+		for (; it != end(); ++it) {
+			pLast = it->data + it->length;
+		}
+		return pLast - m_payload;
+	} // getUsedLength
+
+private:
+	const uint8_t* m_payload;
+	size_t         m_length;
+}; // BLEAdvertisedData
+
+#endif /* COMPONENTS_CPP_UTILS_BLEADVERTISEDDATA_H_ */
@@ -113,21 +113,21 @@ void BLEAdvertising::setAppearance(uint16_t appearance) {
 void BLEAdvertising::setServiceUUID(BLEUUID uuid) {
 	ESP_LOGD(LOG_TAG, ">> setServiceUUID(%s)", uuid.toString().c_str());
 	m_serviceUUID = uuid; // Save the new service UUID
-	esp_bt_uuid_t espUUID = *m_serviceUUID.getNative();
-	switch(espUUID.len) {
+	m_serviceUUIDNative = m_serviceUUID.getNative(); // The advertising data points into this.
+	switch(m_serviceUUIDNative.len) {
 		case ESP_UUID_LEN_16: {
 			m_advData.service_uuid_len = 2;
-			m_advData.p_service_uuid = (uint8_t *)&espUUID.uuid.uuid16;
+			m_advData.p_service_uuid = (uint8_t *)&m_serviceUUIDNative.uuid.uuid16;
 			break;
 		}
 		case ESP_UUID_LEN_32: {
 			m_advData.service_uuid_len = 4;
-			m_advData.p_service_uuid = (uint8_t *)&espUUID.uuid.uuid32;
+			m_advData.p_service_uuid = (uint8_t *)&m_serviceUUIDNative.uuid.uuid32;
 			break;
 		}
 		case ESP_UUID_LEN_128: {
 			m_advData.service_uuid_len = 16;
-			m_advData.p_service_uuid = (uint8_t *)&espUUID.uuid.uuid128;
+			m_advData.p_service_uuid = (uint8_t *)&m_serviceUUIDNative.uuid.uuid128;
 			break;
 		}
 	} // switch
@@ -21,6 +21,7 @@ private:
 	esp_ble_adv_data_t   m_advData;
 	esp_ble_adv_params_t m_advParams;
 	BLEUUID              m_serviceUUID;
+	esp_bt_uuid_t        m_serviceUUIDNative;
 };
 
 #endif /* COMPONENTS_CPP_UTILS_BLEADVERTISING_H_ */
@@ -0,0 +1,254 @@
+/*
+ * BLEAssignedNumbers.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <stddef.h>
+#include "BLEAssignedNumbers.h"
+
+namespace {
+
+struct Characteristic {
+	uint16_t    assignedNumber;
+	const char* name;
+};
+
+struct Service {
+	uint16_t    assignedNumber;
+	const char* name;
+	const char* type;
+};
+
+
+/**
+ * The characteristics we know the names of, sorted by number.
+ */
+constexpr Characteristic g_characteristics[] = {
+	{0x2A00, "Device Name"},
+	{0x2A01, "Appearance"},
+	{0x2A02, "Peripheral Privacy Flag"},
+	{0x2A03, "Reconnection Address"},
+	{0x2A04, "Peripheral Preferred Connection Parameters"},
+	{0x2A05, "Service Changed"},
+	{0x2A06, "Alert Level"},
+	{0x2A07, "Tx Power Level"},
+	{0x2A08, "Date Time"},
+	{0x2A09, "Day of Week"},
+	{0x2A0A, "Day Date Time"},
+	{0x2A0C, "Exact Time 256"},
+	{0x2A0D, "DST Offset"},
+	{0x2A0E, "Time Zone"},
+	{0x2A0F, "Local Time Information"},
+	{0x2A11, "Time with DST"},
+	{0x2A12, "Time Accuracy"},
+	{0x2A13, "Time Source"},
+	{0x2A14, "Reference Time Information"},
+	{0x2A16, "Time Update Control Point"},
+	{0x2A17, "Time Update State"},
+	{0x2A18, "Glucose Measurement"},
+	{0x2A19, "Battery Level"},
+	{0x2A1C, "Temperature Measurement"},
+	{0x2A1D, "Temperature Type"},
+	{0x2A1E, "Intermediate Temperature"},
+	{0x2A21, "Measurement Interval"},
+	{0x2A22, "Boot Keyboard Input Report"},
+	{0x2A23, "System ID"},
+	{0x2A24, "Model Number String"},
+	{0x2A25, "Serial Number String"},
+	{0x2A26, "Firmware Revision String"},
+	{0x2A27, "Hardware Revision String"},
+	{0x2A28, "Software Revision String"},
+	{0x2A29, "Manufacturer Name String"},
+	{0x2A2A, "IEEE 11073-20601 Regulatory Certification Data List"},
+	{0x2A2B, "Current Time"},
+	{0x2A2C, "Magnetic Declination"},
+	{0x2A31, "Scan Refresh"},
+	{0x2A32, "Boot Keyboard Output Report"},
+	{0x2A33, "Boot Mouse Input Report"},
+	{0x2A34, "Glucose Measurement Context"},
+	{0x2A35, "Blood Pressure Measurement"},
+	{0x2A36, "Intermediate Cuff Pressure"},
+	{0x2A37, "Heart Rate Measurement"},
+	{0x2A38, "Body Sensor Location"},
+	{0x2A39, "Heart Rate Control Point"},
+	{0x2A3F, "Alert Status"},
+	{0x2A40, "Ringer Control Point"},
+	{0x2A41, "Ringer Setting"},
+	{0x2A42, "Alert Category ID Bit Mask"},
+	{0x2A43, "Alert Category ID"},
+	{0x2A44, "Alert Notification Control Point"},
+	{0x2A45, "Unread Alert Status"},
+	{0x2A46, "New Alert"},
+	{0x2A47, "Supported New Alert Category"},
+	{0x2A48, "Supported Unread Alert Category"},
+	{0x2A49, "Blood Pressure Feature"},
+	{0x2A4A, "HID Information"},
+	{0x2A4B, "Report Map"},
+	{0x2A4C, "HID Control Point"},
+	{0x2A4D, "Report"},
+	{0x2A4E, "Protocol Mode"},
+	{0x2A4F, "Scan Interval Window"},
+	{0x2A50, "PnP ID"},
+	{0x2A51, "Glucose Feature"},
+	{0x2A52, "Record Access Control Point"},
+	{0x2A53, "RSC Measurement"},
+	{0x2A54, "RSC Feature"},
+	{0x2A55, "SC Control Point"},
+	{0x2A5B, "CSC Measurement"},
+	{0x2A5C, "CSC Feature"},
+	{0x2A5D, "Sensor Location"},
+	{0x2A63, "Cycling Power Measurement"},
+	{0x2A64, "Cycling Power Vector"},
+	{0x2A65, "Cycling Power Feature"},
+	{0x2A66, "Cycling Power Control Point"},
+	{0x2A67, "Location and Speed"},
+	{0x2A68, "Navigation"},
+	{0x2A69, "Position Quality"},
+	{0x2A6A, "LN Feature"},
+	{0x2A6B, "LN Control Point"},
+	{0x2A6C, "Elevation"},
+	{0x2A6D, "Pressure"},
+	{0x2A6E, "Temperature"},
+	{0x2A6F, "Humidity"},
+	{0x2A70, "True Wind Speed"},
+	{0x2A71, "True Wind Direction"},
+	{0x2A72, "Apparent Wind Speed"},
+	{0x2A73, "Apparent Wind Direction"},
+	{0x2A74, "Gust Factor"},
+	{0x2A75, "Pollen Concentration"},
+	{0x2A76, "UV Index"},
+	{0x2A77, "Irradiance"},
+	{0x2A78, "Rainfall"},
+	{0x2A79, "Wind Chill"},
+	{0x2A7A, "Heat Index"},
+	{0x2A7B, "Dew Point"},
+	{0x2A7D, "Descriptor Value Changed"},
+	{0x2A80, "Age"},
+	{0x2A85, "Date of Birth"},
+	{0x2A8A, "First Name"},
+	{0x2A8C, "Gender"},
+	{0x2A8E, "Height"},
+	{0x2A90, "Last Name"},
+	{0x2A98, "Weight"},
+	{0x2A99, "Database Change Increment"},
+	{0x2A9A, "User Index"},
+	{0x2A9B, "Body Composition Feature"},
+	{0x2A9C, "Body Composition Measurement"},
+	{0x2A9D, "Weight Measurement"},
+	{0x2A9E, "Weight Scale Feature"},
+	{0x2A9F, "User Control Point"},
+	{0x2AA0, "Magnetic Flux Density - 2D"},
+	{0x2AA1, "Magnetic Flux Density - 3D"},
+	{0x2AA6, "Central Address Resolution"},
+	{0x2AA7, "CGM Measurement"},
+};
+
+
+/**
+ * The services we know the names of, sorted by number.
+ */
+constexpr Service g_services[] = {
+	{0x1800, "Generic Access", "org.bluetooth.service.generic_access"},
+	{0x1801, "Generic Attribute", "org.bluetooth.service.generic_attribute"},
+	{0x1802, "Immediate Alert", "org.bluetooth.service.immediate_alert"},
+	{0x1803, "Link Loss", "org.bluetooth.service.link_loss"},
+	{0x1804, "Tx Power", "org.bluetooth.service.tx_power"},
+	{0x1805, "Current Time Service", "org.bluetooth.service.current_time"},
+	{0x1806, "Reference Time Update Service", "org.bluetooth.service.reference_time_update"},
+	{0x1807, "Next DST Change Service", "org.bluetooth.service.next_dst_change"},
+	{0x1808, "Glucose", "org.bluetooth.service.glucose"},
+	{0x1809, "Health Thermometer", "org.bluetooth.service.health_thermometer"},
+	{0x180A, "Device Information", "org.bluetooth.service.device_information"},
+	{0x180D, "Heart Rate", "org.bluetooth.service.heart_rate"},
+	{0x180E, "Phone Alert Status Service", "org.bluetooth.service.phone_alert_status"},
+	{0x180F, "Battery Service", "org.bluetooth.service.battery_service"},
+	{0x1810, "Blood Pressure", "org.bluetooth.service.blood_pressure"},
+	{0x1811, "Alert Notification Service", "org.bluetooth.service.alert_notification"},
+	{0x1812, "Human Interface Device", "org.bluetooth.service.human_interface_device"},
+	{0x1813, "Scan Parameters", "org.bluetooth.service.scan_parameters"},
+	{0x1814, "Running Speed and Cadence", "org.bluetooth.service.running_speed_and_cadence"},
+	{0x1815, "Automation IO", "org.bluetooth.service.automation_io"},
+	{0x1816, "Cycling Speed and Cadence", "org.bluetooth.service.cycling_speed_and_cadence"},
+	{0x1818, "Cycling Power", "org.bluetooth.service.cycling_power"},
+	{0x1819, "Location and Navigation", "org.bluetooth.service.location_and_navigation"},
+	{0x181A, "Environmental Sensing", "org.bluetooth.service.environmental_sensing"},
+	{0x181B, "Body Composition", "org.bluetooth.service.body_composition"},
+	{0x181C, "User Data", "org.bluetooth.service.user_data"},
+	{0x181D, "Weight Scale", "org.bluetooth.service.weight_scale"},
+	{0x181E, "Bond Management", "org.bluetooth.service.bond_management"},
+	{0x181F, "Continuous Glucose Monitoring", "org.bluetooth.service.continuous_glucose_monitoring"},
+	{0x1820, "Internet Protocol Support", "org.bluetooth.service.internet_protocol_support"},
+	{0x1821, "Indoor Positioning", "org.bluetooth.service.indoor_positioning"},
+	{0x1822, "Pulse Oximeter", "org.bluetooth.service.pulse_oximeter"},
+	{0x1823, "HTTP Proxy", "org.bluetooth.service.http_proxy"},
+	{0x1824, "Transport Discovery", "org.bluetooth.service.transport_discovery"},
+	{0x1825, "Object Transfer", "org.bluetooth.service.object_transfer"},
+};
+
+
+template <typename T>
+constexpr bool isSorted(const T* table, size_t count) {
+	return count < 2 || (table[0].assignedNumber < table[1].assignedNumber && isSorted(table + 1, count - 1));
+}
+
+static_assert(isSorted(g_characteristics, sizeof(g_characteristics) / sizeof(g_characteristics[0])),
+	"g_characteristics must be sorted by assigned number");
+static_assert(isSorted(g_services, sizeof(g_services) / sizeof(g_services[0])),
+	"g_services must be sorted by assigned number");
+
+
+/**
+ * @brief Find an assigned number in a sorted table.
+ * @return The entry, or nullptr if the number is not in the table.
+ */
+template <typename T, size_t N>
+const T* find(const T (&table)[N], uint16_t assignedNumber) {
+	size_t low  = 0;
+	size_t high = N;
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		if (table[middle].assignedNumber < assignedNumber) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low < N && table[low].assignedNumber == assignedNumber ? &table[low] : nullptr;
+} // find
+
+} // namespace
+
+
+/**
+ * @brief Get the name of a characteristic.
+ * @param [in] uuid The 16 bit UUID of the characteristic.
+ * @return The name, or "Unknown".
+ */
+const char* BLEAssignedNumbers::characteristicName(uint16_t uuid) {
+	const Characteristic* p = find(g_characteristics, uuid);
+	return p != nullptr ? p->name : "Unknown";
+} // characteristicName
+
+
+/**
+ * @brief Get the name of a service.
+ * @param [in] uuid The 16 bit UUID of the service.
+ * @return The name, or "Unknown".
+ */
+const char* BLEAssignedNumbers::serviceName(uint16_t uuid) {
+	const Service* p = find(g_services, uuid);
+	return p != nullptr ? p->name : "Unknown";
+} // serviceName
+
+
+/**
+ * @brief Get the type of a service, such as "org.bluetooth.service.battery_service".
+ * @param [in] uuid The 16 bit UUID of the service.
+ * @return The type, or "Unknown".
+ */
+const char* BLEAssignedNumbers::serviceType(uint16_t uuid) {
+	const Service* p = find(g_services, uuid);
+	return p != nullptr ? p->type : "Unknown";
+} // serviceType
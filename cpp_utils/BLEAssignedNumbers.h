@@ -0,0 +1,26 @@
+/*
+ * BLEAssignedNumbers.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEASSIGNEDNUMBERS_H_
+#define COMPONENTS_CPP_UTILS_BLEASSIGNEDNUMBERS_H_
+#include <stdint.h>
+
+/**
+ * @brief The names of the 16 bit UUIDs that the Bluetooth SIG assigns to services and characteristics.
+ *
+ * The names are held in constant tables sorted by number, which stay in flash, and are found by
+ * binary search.  Nothing is allocated, so the names can be had from the stack's callbacks even
+ * when the log they are for is off.
+ */
+class BLEAssignedNumbers {
+public:
+	static const char* characteristicName(uint16_t uuid);
+	static const char* serviceName(uint16_t uuid);
+	static const char* serviceType(uint16_t uuid);
+}; // BLEAssignedNumbers
+
+#endif /* COMPONENTS_CPP_UTILS_BLEASSIGNEDNUMBERS_H_ */
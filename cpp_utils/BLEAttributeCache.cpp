@@ -0,0 +1,362 @@
+/*
+ * BLEAttributeCache.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <stdio.h>
+#include "BLEAttributeCache.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include "NVS.h"
+static const char* LOG_TAG = "BLEAttributeCache";
+#endif
+
+/*
+ * A serialized database is:
+ *
+ *   "GATT" version  services characteristics descriptors
+ *   services:        flags(primary) id
+ *   characteristics: service properties id
+ *   descriptors:     characteristic id
+ *   checksum
+ *
+ * where the counts are one byte, an id is its length, that many bytes of UUID and its instance
+ * id, and the checksum is an FNV-1a hash of all before it, 4 bytes little endian.
+ */
+static const uint8_t FORMAT_VERSION = 1;
+
+
+static uint32_t checksum(const uint8_t* data, size_t length) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+} // checksum
+
+
+static void putId(std::string* pData, const BLEAttributeId& id) {
+	pData->push_back(id.length);
+	pData->append((const char*)id.uuid, id.length);
+	pData->push_back(id.instId);
+} // putId
+
+
+/**
+ * @brief Read an id, advancing the pointer past it.
+ * @return False if the id is bad or runs past the end.
+ */
+static bool getId(const uint8_t** pp, const uint8_t* pEnd, BLEAttributeId* pId) {
+	const uint8_t* p = *pp;
+	if (p >= pEnd || (p[0] != 2 && p[0] != 4 && p[0] != 16) || pEnd - p < 2 + p[0]) {
+		return false;
+	}
+	::memset(pId, 0, sizeof(*pId));
+	pId->length = p[0];
+	::memcpy(pId->uuid, p + 1, p[0]);
+	pId->instId = p[1 + p[0]];
+	*pp = p + 2 + p[0];
+	return true;
+} // getId
+
+
+/**
+ * @brief Add a characteristic of a service.
+ * @return The index of the characteristic, or -1 if there are already 255.
+ */
+int BLEAttributeDatabase::addCharacteristic(int service, const BLEAttributeId& id, uint8_t properties) {
+	if (characteristics.size() >= 255) {
+		return -1;
+	}
+	Characteristic characteristic;
+	characteristic.id         = id;
+	characteristic.service    = service;
+	characteristic.properties = properties;
+	characteristics.push_back(characteristic);
+	return characteristics.size() - 1;
+} // addCharacteristic
+
+
+/**
+ * @brief Add a descriptor of a characteristic.
+ * @return The index of the descriptor, or -1 if there are already 255.
+ */
+int BLEAttributeDatabase::addDescriptor(int characteristic, const BLEAttributeId& id) {
+	if (descriptors.size() >= 255) {
+		return -1;
+	}
+	Descriptor descriptor;
+	descriptor.id             = id;
+	descriptor.characteristic = characteristic;
+	descriptors.push_back(descriptor);
+	return descriptors.size() - 1;
+} // addDescriptor
+
+
+/**
+ * @brief Add a service.
+ * @return The index of the service, or -1 if there are already 255.
+ */
+int BLEAttributeDatabase::addService(const BLEAttributeId& id, bool primary) {
+	if (services.size() >= 255) {
+		return -1;
+	}
+	Service service;
+	service.id      = id;
+	service.primary = primary;
+	services.push_back(service);
+	return services.size() - 1;
+} // addService
+
+
+void BLEAttributeDatabase::clear() {
+	services.clear();
+	characteristics.clear();
+	descriptors.clear();
+} // clear
+
+
+/**
+ * @brief Replace the database with one serialized by serialize().
+ * @return False if the data is damaged or of another version, when the database is left empty.
+ */
+bool BLEAttributeDatabase::deserialize(const uint8_t* data, size_t length) {
+	clear();
+	if (length < 8 + 4 || ::memcmp(data, "GATT", 4) != 0 || data[4] != FORMAT_VERSION) {
+		return false;
+	}
+	const uint8_t* pEnd = data + length - 4;
+	uint32_t sum = pEnd[0] | (pEnd[1] << 8) | (pEnd[2] << 16) | ((uint32_t)pEnd[3] << 24);
+	if (sum != checksum(data, length - 4)) {
+		return false;
+	}
+	int serviceCount        = data[5];
+	int characteristicCount = data[6];
+	int descriptorCount     = data[7];
+	const uint8_t* p = data + 8;
+	BLEAttributeId id;
+	for (int i = 0; i < serviceCount; i++) {
+		if (p >= pEnd) {
+			goto bad;
+		}
+		bool primary = *p++ != 0;
+		if (!getId(&p, pEnd, &id)) {
+			goto bad;
+		}
+		addService(id, primary);
+	}
+	for (int i = 0; i < characteristicCount; i++) {
+		if (pEnd - p < 2 || p[0] >= serviceCount) {
+			goto bad;
+		}
+		int service = *p++;
+		uint8_t properties = *p++;
+		if (!getId(&p, pEnd, &id)) {
+			goto bad;
+		}
+		addCharacteristic(service, id, properties);
+	}
+	for (int i = 0; i < descriptorCount; i++) {
+		if (p >= pEnd || p[0] >= characteristicCount) {
+			goto bad;
+		}
+		int characteristic = *p++;
+		if (!getId(&p, pEnd, &id)) {
+			goto bad;
+		}
+		addDescriptor(characteristic, id);
+	}
+	if (p == pEnd) {
+		return true;
+	}
+bad:
+	clear();
+	return false;
+} // deserialize
+
+
+/**
+ * @brief Find a characteristic of a service.
+ * @param [in] service The index of the service.
+ * @param [in] id The characteristic sought.
+ * @param [in] anyInstance Match the UUID only, and find the first instance.
+ * @return The index of the characteristic, or -1 if it is not found.
+ */
+int BLEAttributeDatabase::findCharacteristic(int service, const BLEAttributeId& id, bool anyInstance) const {
+	for (size_t i = 0; i < characteristics.size(); i++) {
+		if (characteristics[i].service == service &&
+				(anyInstance ? characteristics[i].id.hasUUID(id) : characteristics[i].id.equals(id))) {
+			return i;
+		}
+	}
+	return -1;
+} // findCharacteristic
+
+
+/**
+ * @brief Find a descriptor of a characteristic.
+ * @param [in] characteristic The index of the characteristic.
+ * @param [in] id The descriptor sought.
+ * @param [in] anyInstance Match the UUID only, and find the first instance.
+ * @return The index of the descriptor, or -1 if it is not found.
+ */
+int BLEAttributeDatabase::findDescriptor(int characteristic, const BLEAttributeId& id, bool anyInstance) const {
+	for (size_t i = 0; i < descriptors.size(); i++) {
+		if (descriptors[i].characteristic == characteristic &&
+				(anyInstance ? descriptors[i].id.hasUUID(id) : descriptors[i].id.equals(id))) {
+			return i;
+		}
+	}
+	return -1;
+} // findDescriptor
+
+
+/**
+ * @brief Find a service.
+ * @param [in] id The service sought.
+ * @param [in] anyInstance Match the UUID only, and find the first instance.
+ * @return The index of the service, or -1 if it is not found.
+ */
+int BLEAttributeDatabase::findService(const BLEAttributeId& id, bool anyInstance) const {
+	for (size_t i = 0; i < services.size(); i++) {
+		if (anyInstance ? services[i].id.hasUUID(id) : services[i].id.equals(id)) {
+			return i;
+		}
+	}
+	return -1;
+} // findService
+
+
+/**
+ * @brief Write the database in a compact form that deserialize() reads back.
+ * @param [out] pData The serialized database.
+ */
+void BLEAttributeDatabase::serialize(std::string* pData) const {
+	pData->assign("GATT", 4);
+	pData->push_back(FORMAT_VERSION);
+	pData->push_back(services.size());
+	pData->push_back(characteristics.size());
+	pData->push_back(descriptors.size());
+	for (auto& service: services) {
+		pData->push_back(service.primary ? 1 : 0);
+		putId(pData, service.id);
+	}
+	for (auto& characteristic: characteristics) {
+		pData->push_back(characteristic.service);
+		pData->push_back(characteristic.properties);
+		putId(pData, characteristic.id);
+	}
+	for (auto& descriptor: descriptors) {
+		pData->push_back(descriptor.characteristic);
+		putId(pData, descriptor.id);
+	}
+	uint32_t sum = checksum((const uint8_t*)pData->data(), pData->length());
+	for (int i = 0; i < 4; i++) {
+		pData->push_back((sum >> (i * 8)) & 0xff);
+	}
+} // serialize
+
+
+/**
+ * @brief Write the 12 hex digits of an address, and a null.
+ */
+void BLEAttributeStore::addressToKey(const uint8_t* address, char* key) {
+	static const char digits[] = "0123456789abcdef";
+	for (int i = 0; i < 6; i++) {
+		key[i * 2]     = digits[address[i] >> 4];
+		key[i * 2 + 1] = digits[address[i] & 0xf];
+	}
+	key[12] = 0;
+} // addressToKey
+
+
+/**
+ * @brief Create a store of files.
+ * @param [in] directory The directory of the files, which must exist.
+ */
+BLEAttributeFileStore::BLEAttributeFileStore(std::string directory) {
+	m_directory = directory;
+} // BLEAttributeFileStore
+
+
+std::string BLEAttributeFileStore::getFileName(const uint8_t* address) {
+	char key[13];
+	addressToKey(address, key);
+	return m_directory + "/" + key + ".gat";
+} // getFileName
+
+
+bool BLEAttributeFileStore::load(const uint8_t* address, std::string* pData) {
+	FILE* pFile = ::fopen(getFileName(address).c_str(), "rb");
+	if (pFile == nullptr) {
+		return false;
+	}
+	pData->clear();
+	char buffer[256];
+	size_t count;
+	while ((count = ::fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+		pData->append(buffer, count);
+	}
+	::fclose(pFile);
+	return true;
+} // load
+
+
+void BLEAttributeFileStore::remove(const uint8_t* address) {
+	::remove(getFileName(address).c_str());
+} // remove
+
+
+void BLEAttributeFileStore::save(const uint8_t* address, const std::string& data) {
+	FILE* pFile = ::fopen(getFileName(address).c_str(), "wb");
+	if (pFile == nullptr) {
+		return;
+	}
+	::fwrite(data.data(), 1, data.length(), pFile);
+	::fclose(pFile);
+} // save
+
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Create a store in NVS.
+ * @param [in] name The NVS namespace to use.
+ */
+BLEAttributeNVSStore::BLEAttributeNVSStore(std::string name) {
+	m_name = name;
+} // BLEAttributeNVSStore
+
+
+bool BLEAttributeNVSStore::load(const uint8_t* address, std::string* pData) {
+	char key[13];
+	addressToKey(address, key);
+	NVS nvs(m_name);
+	size_t length = 0;
+	if (nvs.get(key, nullptr, length) != ESP_OK || length == 0) {
+		return false;
+	}
+	pData->resize(length);
+	return nvs.get(key, (uint8_t*)&(*pData)[0], length) == ESP_OK;
+} // load
+
+
+void BLEAttributeNVSStore::remove(const uint8_t* address) {
+	char key[13];
+	addressToKey(address, key);
+	NVS nvs(m_name);
+	nvs.erase(key);
+	nvs.commit();
+} // remove
+
+
+void BLEAttributeNVSStore::save(const uint8_t* address, const std::string& data) {
+	char key[13];
+	addressToKey(address, key);
+	NVS nvs(m_name);
+	nvs.set(key, (uint8_t*)data.data(), data.length());
+	nvs.commit();
+	ESP_LOGD(LOG_TAG, "Saved %d bytes for %s", data.length(), key);
+} // save
+#endif
@@ -0,0 +1,152 @@
+/*
+ * BLEAttributeCache.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_
+#define COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The identity of a service, characteristic or descriptor of a peer.
+ *
+ * It holds what the stack's esp_gatt_id_t holds: the length of the UUID, the UUID as the stack
+ * holds it (a 16 or 32 bit UUID little endian in the first bytes), and the instance id that
+ * tells apart attributes of the same UUID.  It does not depend on the stack's headers, so the
+ * attribute database can be used and tested on a host.
+ */
+struct BLEAttributeId {
+	uint8_t length;     // 2, 4 or 16.
+	uint8_t uuid[16];
+	uint8_t instId;
+
+	static BLEAttributeId fromUUID16(uint16_t uuid, uint8_t instId = 0) {
+		BLEAttributeId id;
+		::memset(&id, 0, sizeof(id));
+		id.length  = 2;
+		id.uuid[0] = uuid & 0xff;
+		id.uuid[1] = uuid >> 8;
+		id.instId  = instId;
+		return id;
+	}
+	static BLEAttributeId fromUUID128(const uint8_t* uuid, uint8_t instId = 0) {
+		BLEAttributeId id;
+		id.length = 16;
+		::memcpy(id.uuid, uuid, 16);
+		id.instId = instId;
+		return id;
+	}
+
+	/**
+	 * @brief Is this the same attribute as another: the same UUID and instance?
+	 */
+	bool equals(const BLEAttributeId& other) const {
+		return length == other.length && instId == other.instId && ::memcmp(uuid, other.uuid, length) == 0;
+	}
+	/**
+	 * @brief Has this attribute the UUID of another, whatever the instance?
+	 */
+	bool hasUUID(const BLEAttributeId& other) const {
+		return length == other.length && ::memcmp(uuid, other.uuid, length) == 0;
+	}
+}; // BLEAttributeId
+
+
+/**
+ * @brief The services, characteristics and descriptors found on a peer.
+ *
+ * Each characteristic records the index of its service, and each descriptor that of its
+ * characteristic.  They are kept in the order they were found.
+ */
+class BLEAttributeDatabase {
+public:
+	struct Service {
+		BLEAttributeId id;
+		bool           primary;
+	};
+	struct Characteristic {
+		BLEAttributeId id;
+		uint8_t        service;
+		uint8_t        properties;
+	};
+	struct Descriptor {
+		BLEAttributeId id;
+		uint8_t        characteristic;
+	};
+
+	int  addCharacteristic(int service, const BLEAttributeId& id, uint8_t properties);
+	int  addDescriptor(int characteristic, const BLEAttributeId& id);
+	int  addService(const BLEAttributeId& id, bool primary);
+	void clear();
+	bool deserialize(const uint8_t* data, size_t length);
+	int  findCharacteristic(int service, const BLEAttributeId& id, bool anyInstance = false) const;
+	int  findDescriptor(int characteristic, const BLEAttributeId& id, bool anyInstance = false) const;
+	int  findService(const BLEAttributeId& id, bool anyInstance = false) const;
+	void serialize(std::string* pData) const;
+
+	std::vector<Service>        services;
+	std::vector<Characteristic> characteristics;
+	std::vector<Descriptor>     descriptors;
+}; // BLEAttributeDatabase
+
+
+/**
+ * @brief Where attribute databases are kept between connections, by the address of the peer.
+ */
+class BLEAttributeStore {
+public:
+	virtual ~BLEAttributeStore() {}
+	/**
+	 * @brief Read the database saved for a peer.
+	 * @return False if there is none.
+	 */
+	virtual bool load(const uint8_t* address, std::string* pData) = 0;
+	virtual void remove(const uint8_t* address) = 0;
+	virtual void save(const uint8_t* address, const std::string& data) = 0;
+
+protected:
+	static void addressToKey(const uint8_t* address, char* key);
+}; // BLEAttributeStore
+
+
+/**
+ * @brief Keep each database in a file named for the address of the peer.
+ *
+ * On a device the directory must be on a mounted file system, such as FATFS_VFS.
+ */
+class BLEAttributeFileStore: public BLEAttributeStore {
+public:
+	BLEAttributeFileStore(std::string directory);
+	bool load(const uint8_t* address, std::string* pData) override;
+	void remove(const uint8_t* address) override;
+	void save(const uint8_t* address, const std::string& data) override;
+
+private:
+	std::string getFileName(const uint8_t* address);
+	std::string m_directory;
+}; // BLEAttributeFileStore
+
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Keep each database as a blob in a namespace of NVS, keyed by the address of the peer.
+ */
+class BLEAttributeNVSStore: public BLEAttributeStore {
+public:
+	BLEAttributeNVSStore(std::string name = "gattcache");
+	bool load(const uint8_t* address, std::string* pData) override;
+	void remove(const uint8_t* address) override;
+	void save(const uint8_t* address, const std::string& data) override;
+
+private:
+	std::string m_name;
+}; // BLEAttributeNVSStore
+#endif
+
+#endif /* COMPONENTS_CPP_UTILS_BLEATTRIBUTECACHE_H_ */
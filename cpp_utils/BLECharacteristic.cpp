@@ -26,12 +26,10 @@ extern "C" {
  * @param [in] uuid - UUID for the characteristic.
  * @param [in] properties - Properties for the characteristic.
  */
-BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
+BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) : m_value(ESP_GATT_MAX_ATTR_LEN) {
 	m_bleUUID            = uuid;
-	m_value.attr_value   = (uint8_t *)malloc(ESP_GATT_MAX_ATTR_LEN);
-	m_value.attr_len     = 0;
-	m_value.attr_max_len = ESP_GATT_MAX_ATTR_LEN;
 	m_handle             = 0;
+	m_pService           = nullptr;
 	m_properties         = 0;
 
 	setBroadcastProperty((properties & PROPERTY_BROADCAST) !=0);
@@ -44,7 +42,6 @@ BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
 
 
 BLECharacteristic::~BLECharacteristic() {
-	free(m_value.attr_value);
 }
 
 
@@ -55,7 +52,10 @@ BLECharacteristic::~BLECharacteristic() {
  */
 void BLECharacteristic::addDescriptor(BLEDescriptor* pDescriptor) {
 	ESP_LOGD(LOG_TAG, ">> addDescriptor(): Adding %s to %s", pDescriptor->toString().c_str(), toString().c_str());
-	m_descriptorMap.setByUUID(pDescriptor->getUUID(), pDescriptor);
+	if (!m_descriptorMap.setByUUID(pDescriptor->getUUID(), pDescriptor)) {
+		ESP_LOGE(LOG_TAG, "<< addDescriptor: descriptor %s not added", pDescriptor->getUUID().toString().c_str());
+		return;
+	}
 	ESP_LOGD(LOG_TAG, "<< addDescriptor()");
 } // addDescriptor
 
@@ -66,7 +66,7 @@ uint16_t BLECharacteristic::getHandle() {
 
 
 size_t BLECharacteristic::getLength() {
-	return m_value.attr_len;
+	return m_value.getLength();
 } // getLength
 
 
@@ -81,7 +81,7 @@ BLEUUID BLECharacteristic::getUUID() {
 
 
 uint8_t* BLECharacteristic::getValue() {
-	return m_value.attr_value;
+	return m_value.getData();
 } // getValue
 
 
@@ -105,16 +105,33 @@ void BLECharacteristic::handleGATTServerEvent(
 		// - uint8_t      *value
 		//
 		case ESP_GATTS_WRITE_EVT: {
-			if (param->write.handle == m_handle) {
-				setValue(param->write.value, param->write.len);
+			if (param->write.handle != m_handle) {
+				break;
+			}
+			esp_gatt_status_t status = ESP_GATT_OK;
+			if (param->write.is_prep) {
+				// A part of a long write: hold it until the write is executed.
+				if (!m_value.prepare(param->write.offset, param->write.value, param->write.len)) {
+					status = param->write.offset > m_value.getMaxLength() ? ESP_GATT_INVALID_OFFSET : ESP_GATT_PREPARE_Q_FULL;
+				}
+			} else if (param->write.offset != 0) {
+				if (!m_value.prepare(param->write.offset, param->write.value, param->write.len) || !m_value.commitPrepared()) {
+					m_value.cancelPrepared();
+					status = ESP_GATT_INVALID_OFFSET;
+				}
+			} else if (!m_value.setValue(param->write.value, param->write.len)) {
+				status = ESP_GATT_INVALID_ATTR_LEN;
+			}
+			if (param->write.need_rsp) {
+				// The response to a prepared write echoes the part written.
 				esp_gatt_rsp_t rsp;
-				rsp.attr_value.len      = getLength();
+				rsp.attr_value.len      = param->write.is_prep ? param->write.len : 0;
 				rsp.attr_value.handle   = m_handle;
-				rsp.attr_value.offset   = 0;
+				rsp.attr_value.offset   = param->write.offset;
 				rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-				memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+				memcpy(rsp.attr_value.value, param->write.value, rsp.attr_value.len);
 				esp_err_t errRc = ::esp_ble_gatts_send_response(
-						gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, &rsp);
+						gatts_if, param->write.conn_id, param->write.trans_id, status, &rsp);
 				if (errRc != ESP_OK) {
 					ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
 				}
@@ -122,6 +139,24 @@ void BLECharacteristic::handleGATTServerEvent(
 			break;
 		} // ESP_GATTS_WRITE_EVT
 
+		// ESP_GATTS_EXEC_WRITE_EVT - The parts of a long write are to be applied or discarded.  The
+		// server sends the response.
+		//
+		// exec_write:
+		// - uint16_t      conn_id
+		// - uint32_t      trans_id
+		// - esp_bd_addr_t bda
+		// - uint8_t       exec_write_flag
+		//
+		case ESP_GATTS_EXEC_WRITE_EVT: {
+			if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC) {
+				m_value.commitPrepared();
+			} else {
+				m_value.cancelPrepared();
+			}
+			break;
+		} // ESP_GATTS_EXEC_WRITE_EVT
+
 		// ESP_GATTS_READ_EVT - A request to read the value of a characteristic has arrived.
 		//
 		// read:
@@ -133,24 +168,26 @@ void BLECharacteristic::handleGATTServerEvent(
 		// - bool          is_long
 		// - bool          need_rsp
 		//
+		// A value longer than one packet is read by a sequence of reads at increasing offsets.  We
+		// answer each with all we can from the offset; the stack cuts it to fit the MTU.
+		//
 		case ESP_GATTS_READ_EVT: {
-			ESP_LOGD(LOG_TAG, "- Testing: 0x%.2x == 0x%.2x", param->read.handle, m_handle);
-			if (param->read.handle == m_handle) {
-				ESP_LOGD(LOG_TAG, "Sending a response (esp_ble_gatts_send_response)");
-				if (param->read.need_rsp) {
-					esp_gatt_rsp_t rsp;
-					rsp.attr_value.len      = getLength();
-					rsp.attr_value.handle   = param->read.handle;
-					rsp.attr_value.offset   = 0;
-					rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-					memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
-					esp_err_t errRc = ::esp_ble_gatts_send_response(
-							gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
-					if (errRc != ESP_OK) {
-						ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
-					}
+			if (param->read.handle == m_handle && param->read.need_rsp) {
+				esp_gatt_rsp_t rsp;
+				esp_gatt_status_t status = ESP_GATT_OK;
+				if (param->read.offset > m_value.getLength()) {
+					status = ESP_GATT_INVALID_OFFSET;
 				}
-			} // ESP_GATTS_READ_EVT
+				rsp.attr_value.len      = m_value.read(param->read.offset, rsp.attr_value.value, ESP_GATT_MAX_ATTR_LEN);
+				rsp.attr_value.handle   = param->read.handle;
+				rsp.attr_value.offset   = param->read.offset;
+				rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+				esp_err_t errRc = ::esp_ble_gatts_send_response(
+						gatts_if, param->read.conn_id, param->read.trans_id, status, &rsp);
+				if (errRc != ESP_OK) {
+					ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
+				}
+			}
 			break;
 		} // ESP_GATTS_READ_EVT
 
@@ -161,7 +198,10 @@ void BLECharacteristic::handleGATTServerEvent(
 	} // switch event
 
 	// Give each of the descriptors associated with this characteristic the opportunity to handle the
-	// event.
+	// event.  Reads and writes are sent by the server straight to the descriptor that owns the handle.
+	if (event == ESP_GATTS_READ_EVT || event == ESP_GATTS_WRITE_EVT) {
+		return;
+	}
 	BLEDescriptor *pDescriptor = m_descriptorMap.getFirst();
 	while(pDescriptor != nullptr) {
 		pDescriptor->handleGATTServerEvent(event, gatts_if, param);
@@ -229,15 +269,35 @@ void BLECharacteristic::setReadProperty(bool value) {
  * @param [in] length The length of the data in bytes.
  */
 void BLECharacteristic::setValue(uint8_t* data, size_t length) {
-	if (length > ESP_GATT_MAX_ATTR_LEN) {
-		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, ESP_GATT_MAX_ATTR_LEN);
-		return;
+	if (!m_value.setValue(data, length)) {
+		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, m_value.getMaxLength());
 	}
-	m_value.attr_len = length;
-	memcpy(m_value.attr_value, data, length);
 } // setValue
 
 
+/**
+ * @brief Set the value of the characteristic to memory owned by the application.
+ *
+ * The memory is not copied and must stay valid while the characteristic uses it.  A value longer
+ * than one packet is read by clients in parts, by offset.
+ *
+ * @param [in] data The memory holding the value.
+ * @param [in] length The length of the value in bytes.
+ */
+void BLECharacteristic::setExternalValue(uint8_t* data, size_t length) {
+	m_value.setExternal(data, length);
+} // setExternalValue
+
+
+/**
+ * @brief Set the longest value a client may write, with long writes.
+ * @param [in] maxLength The longest value in bytes.  The default is ESP_GATT_MAX_ATTR_LEN.
+ */
+void BLECharacteristic::setMaxLength(size_t maxLength) {
+	m_value.setMaxLength(maxLength);
+} // setMaxLength
+
+
 void BLECharacteristic::setValue(std::string value) {
 	setValue((uint8_t *)value.data(), value.length());
 } // setValue
@@ -305,12 +365,17 @@ void BLECharacteristic::executeCreate(BLEService* pService) {
 		m_pService->toString().c_str());
 
 	//m_serializeMutex.take("addCharacteristic"); // Take the mutex, released by event ESP_GATTS_ADD_CHAR_EVT
+	esp_bt_uuid_t uuid = getUUID().getNative();
+	esp_attr_value_t value; // The initial value, copied by the stack.  Reads and writes come to us.
+	value.attr_max_len = ESP_GATT_MAX_ATTR_LEN;
+	value.attr_len     = m_value.getLength() < ESP_GATT_MAX_ATTR_LEN ? m_value.getLength() : ESP_GATT_MAX_ATTR_LEN;
+	value.attr_value   = m_value.getData();
 	esp_err_t errRc = ::esp_ble_gatts_add_char(
 		m_pService->getHandle(),
-		getUUID().getNative(),
+		&uuid,
 		(esp_gatt_perm_t)(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
 		getProperties(),
-		&m_value,
+		&value,
 		NULL);
 
 	if (errRc != ESP_OK) {
@@ -12,6 +12,7 @@
 #include <esp_gatts_api.h>
 #include "BLEDescriptor.h"
 #include "BLEDescriptorMap.h"
+#include "BLEValue.h"
 class BLEService;
 class BLEDescriptor;
 
@@ -25,7 +26,9 @@ public:
 	BLEUUID getUUID();
 	uint8_t *getValue();
 	void setBroadcastProperty(bool value);
+	void setExternalValue(uint8_t *data, size_t length);
 	void setIndicateProperty(bool value);
+	void setMaxLength(size_t maxLength);
 	void setNotifyProperty(bool value);
 	void setReadProperty(bool value);
 	void setValue(uint8_t *data, size_t size);
@@ -50,9 +53,11 @@ private:
 	friend class BLEService;
 	friend class BLEDescriptor;
 	friend class BLECharacteristicMap;
+	friend class BLENotificationScheduler;
+	friend class BLENotificationStreamer;
 	BLEUUID              m_bleUUID;
 	esp_gatt_char_prop_t m_properties;
-	esp_attr_value_t     m_value;
+	BLEValue             m_value;
 	uint16_t             m_handle;
 	BLEService          *m_pService;
 	BLEDescriptorMap     m_descriptorMap;
@@ -6,9 +6,13 @@
  */
 #include <sstream>
 #include <iomanip>
+#include <esp_log.h>
 #include "BLECharacteristicMap.h"
 
+static char LOG_TAG[] = "BLECharacteristicMap";
+
 BLECharacteristicMap::BLECharacteristicMap() {
+	m_iterator = 0;
 }
 
 BLECharacteristicMap::~BLECharacteristicMap() {
@@ -21,12 +25,11 @@ BLECharacteristicMap::~BLECharacteristicMap() {
  * @return The characteristic.
  */
 BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.second->getUUID().equals(uuid)) {
-			return myPair.second;
+	for (auto pCharacteristic : m_characteristics) {
+		if (pCharacteristic->getUUID().equals(uuid)) {
+			return pCharacteristic;
 		}
 	}
-	//return m_uuidMap.at(uuid.toString());
 	return nullptr;
 } // getByUUID
 
@@ -37,7 +40,8 @@ BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
  * @return The characteristic.
  */
 BLECharacteristic* BLECharacteristicMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	BLECharacteristic** ppCharacteristic = m_handleMap.get(handle);
+	return ppCharacteristic == nullptr ? nullptr : *ppCharacteristic;
 } // getByHandle
 
 
@@ -45,12 +49,19 @@ BLECharacteristic* BLECharacteristicMap::getByHandle(uint16_t handle) {
  * @brief Set the characteristic by UUID.
  * @param [in] uuid The uuid of the characteristic.
  * @param [in] characteristic The characteristic to cache.
- * @return N/A.
+ * @return False if the map already holds CONFIG_BLE_MAX_CHARACTERISTICS characteristics.
  */
-void BLECharacteristicMap::setByUUID(
+bool BLECharacteristicMap::setByUUID(
 		BLEUUID            uuid,
 		BLECharacteristic *pCharacteristic) {
-	m_uuidMap.insert(std::pair<std::string, BLECharacteristic *>(uuid.toString(), pCharacteristic));
+	if (getByUUID(uuid) != nullptr) {
+		return true;
+	}
+	if (m_characteristics.size() >= CONFIG_BLE_MAX_CHARACTERISTICS || !m_characteristics.pushBack(pCharacteristic)) {
+		ESP_LOGE(LOG_TAG, "setByUUID: no room for more than %d characteristics, see CONFIG_BLE_MAX_CHARACTERISTICS", CONFIG_BLE_MAX_CHARACTERISTICS);
+		return false;
+	}
+	return true;
 } // setByUUID
 
 
@@ -58,11 +69,15 @@ void BLECharacteristicMap::setByUUID(
  * @brief Set the characteristic by handle.
  * @param [in] handle The handle of the characteristic.
  * @param [in] characteristic The characteristic to cache.
- * @return N/A.
+ * @return False if the map is full.
  */
-void BLECharacteristicMap::setByHandle(uint16_t handle,
+bool BLECharacteristicMap::setByHandle(uint16_t handle,
 		BLECharacteristic *characteristic) {
-	m_handleMap.insert(std::pair<uint16_t, BLECharacteristic *>(handle, characteristic));
+	if (!m_handleMap.set(handle, characteristic)) {
+		ESP_LOGE(LOG_TAG, "setByHandle: more than %d handles", (int)m_handleMap.capacity());
+		return false;
+	}
+	return true;
 } // setByHandle
 
 
@@ -74,12 +89,12 @@ std::string BLECharacteristicMap::toString() {
 	std::stringstream stringStream;
 	stringStream << std::hex << std::setfill('0');
 	int count=0;
-	for (auto &myPair: m_uuidMap) {
+	for (auto pCharacteristic: m_characteristics) {
 		if (count > 0) {
 			stringStream << "\n";
 		}
 		count++;
-		stringStream << "handle: 0x" << std::setw(2) << myPair.second->getHandle() << ", uuid: " + myPair.second->getUUID().toString();
+		stringStream << "handle: 0x" << std::setw(2) << pCharacteristic->getHandle() << ", uuid: " + pCharacteristic->getUUID().toString();
 	}
 	return stringStream.str();
 } // toString
@@ -96,8 +111,8 @@ void BLECharacteristicMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t *param) {
 	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.second->handleGATTServerEvent(event, gatts_if, param);
+	for (auto pCharacteristic : m_characteristics) {
+		pCharacteristic->handleGATTServerEvent(event, gatts_if, param);
 	}
 } // handleGATTServerEvent
 
@@ -107,13 +122,8 @@ void BLECharacteristicMap::handleGATTServerEvent(
  * @return The first characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) {
-		return nullptr;
-	}
-	BLECharacteristic *pRet = m_iterator->second;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 
@@ -122,10 +132,8 @@ BLECharacteristic* BLECharacteristicMap::getFirst() {
  * @return The next characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) {
+	if (m_iterator >= m_characteristics.size()) {
 		return nullptr;
 	}
-	BLECharacteristic *pRet = m_iterator->second;
-	m_iterator++;
-	return pRet;
+	return m_characteristics[m_iterator++];
 } // getNext
@@ -7,15 +7,21 @@
 
 #ifndef COMPONENTS_CPP_UTILS_BLECHARACTERISTICMAP_H_
 #define COMPONENTS_CPP_UTILS_BLECHARACTERISTICMAP_H_
-#include <map>
+#include "FixedHashMap.h"
+#include "SmallVector.h"
 #include "BLECharacteristic.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_BLE_MAX_CHARACTERISTICS
+#define CONFIG_BLE_MAX_CHARACTERISTICS 32
+#endif
 
 class BLECharacteristicMap {
 public:
 	BLECharacteristicMap();
 	virtual ~BLECharacteristicMap();
-	void setByUUID(BLEUUID uuid, BLECharacteristic *characteristic);
-	void setByHandle(uint16_t handle, BLECharacteristic *characteristic);
+	bool setByUUID(BLEUUID uuid, BLECharacteristic *characteristic);
+	bool setByHandle(uint16_t handle, BLECharacteristic *characteristic);
 	BLECharacteristic *getByUUID(BLEUUID uuid);
 	BLECharacteristic *getByHandle(uint16_t handle);
 	BLECharacteristic *getFirst();
@@ -28,9 +34,9 @@ public:
 
 
 private:
-	std::map<std::string, BLECharacteristic *> m_uuidMap;
-	std::map<uint16_t, BLECharacteristic *> m_handleMap;
-	std::map<std::string, BLECharacteristic *>::iterator m_iterator;
+	SmallVector<BLECharacteristic*, 8> m_characteristics;   // In the order they were added.
+	FixedHashMap<uint16_t, BLECharacteristic*, fixedHashMapCapacity(CONFIG_BLE_MAX_CHARACTERISTICS)> m_handleMap;
+	size_t                             m_iterator;
 };
 
 #endif /* COMPONENTS_CPP_UTILS_BLECHARACTERISTICMAP_H_ */
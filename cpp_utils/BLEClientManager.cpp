@@ -0,0 +1,639 @@
+/*
+ * BLEClientManager.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <string.h>
+#include "BLEClientManager.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+static const char* LOG_TAG = "BLEClientManager";
+#else
+#define ESP_LOGD(tag, ...)
+#define ESP_LOGE(tag, ...)
+#endif
+
+
+/**
+ * @brief Create a manager.
+ * @param [in] pTransport The stack to make requests of.
+ * @param [in] pStore Where to keep the databases found, or nullptr to discover them on every connection.
+ */
+BLEClientManager::BLEClientManager(BLEGattClientTransport* pTransport, BLEAttributeStore* pStore) {
+	m_pTransport = pTransport;
+	m_pStore     = pStore;
+	m_pipelined  = true;
+	::memset(&m_stats, 0, sizeof(m_stats));
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		m_connections[i].state   = STATE_IDLE;
+		m_connections[i].head    = 0;
+		m_connections[i].count   = 0;
+		m_connections[i].busy    = false;
+		m_connections[i].closing    = false;
+		m_connections[i].rediscover = false;
+	}
+#ifdef ESP_PLATFORM
+	m_lock = xSemaphoreCreateRecursiveMutex();
+#endif
+} // BLEClientManager
+
+
+BLEClientManager::~BLEClientManager() {
+#ifdef ESP_PLATFORM
+	vSemaphoreDelete(m_lock);
+#endif
+} // ~BLEClientManager
+
+
+/**
+ * @brief Open a connection to a peer.
+ *
+ * Operations may be queued at once.  The ready callback is called when the database of the peer
+ * is known.
+ *
+ * @param [in] address The 6 byte address of the peer.
+ * @return False if MAX_CONNECTIONS are in use or the stack refused.  True if already connected.
+ */
+bool BLEClientManager::connect(const uint8_t* address) {
+	lock();
+	bool result = true;
+	if (findByAddress(address) == nullptr) {
+		Connection* pConnection = nullptr;
+		for (int i = 0; i < MAX_CONNECTIONS; i++) {
+			if (m_connections[i].state == STATE_IDLE) {
+				pConnection = &m_connections[i];
+				break;
+			}
+		}
+		if (pConnection == nullptr) {
+			ESP_LOGE(LOG_TAG, "connect: all %d connections in use", MAX_CONNECTIONS);
+			result = false;
+		} else {
+			::memcpy(pConnection->address, address, 6);
+			pConnection->state   = STATE_OPENING;
+			pConnection->closing = false;
+			if (!m_pTransport->open(address)) {
+				pConnection->state = STATE_IDLE;
+				result = false;
+			}
+		}
+	}
+	unlock();
+	return result;
+} // connect
+
+
+/**
+ * @brief Close the connection to a peer.  Operations still queued fail.
+ */
+void BLEClientManager::disconnect(const uint8_t* address) {
+	lock();
+	Connection* pConnection = findByAddress(address);
+	if (pConnection != nullptr) {
+		if (pConnection->state == STATE_OPENING) {
+			pConnection->closing = true;
+		} else if (pConnection->state != STATE_CLOSING) {
+			m_pTransport->close(pConnection->connId);
+		}
+	}
+	unlock();
+} // disconnect
+
+
+/**
+ * @brief Drop the saved database of a peer, so that it is discovered when next connected.
+ */
+void BLEClientManager::forget(const uint8_t* address) {
+	if (m_pStore != nullptr) {
+		m_pStore->remove(address);
+	}
+} // forget
+
+
+/**
+ * @brief Get the database of a connected peer.
+ * @return The database, valid until the connection closes, or nullptr if the peer is not ready.
+ */
+const BLEAttributeDatabase* BLEClientManager::getDatabase(const uint8_t* address) {
+	lock();
+	Connection* pConnection = findByAddress(address);
+	const BLEAttributeDatabase* pDatabase =
+		pConnection != nullptr && pConnection->state == STATE_READY ? &pConnection->database : nullptr;
+	unlock();
+	return pDatabase;
+} // getDatabase
+
+
+BLEClientManager::state_t BLEClientManager::getState(const uint8_t* address) {
+	lock();
+	Connection* pConnection = findByAddress(address);
+	state_t state = pConnection != nullptr ? pConnection->state : STATE_IDLE;
+	unlock();
+	return state;
+} // getState
+
+
+BLEClientManager::stats_t BLEClientManager::getStats() {
+	lock();
+	stats_t stats = m_stats;
+	unlock();
+	return stats;
+} // getStats
+
+
+/**
+ * @brief Queue a read of a characteristic.
+ *
+ * The service and characteristic are found by UUID; the first instance of each is used.
+ *
+ * @param [in] address The peer, which must be connected or connecting.
+ * @param [in] service The service of the characteristic.
+ * @param [in] characteristic The characteristic to read.
+ * @param [in] onComplete Called with the value read.
+ * @return False if the peer is not connected or its queue is full.
+ */
+bool BLEClientManager::read(const uint8_t* address, const BLEAttributeId& service,
+		const BLEAttributeId& characteristic, onComplete_t onComplete) {
+	Operation operation;
+	operation.write          = false;
+	operation.response       = true;
+	operation.service        = service;
+	operation.characteristic = characteristic;
+	operation.onComplete     = onComplete;
+	return enqueue(address, operation);
+} // read
+
+
+void BLEClientManager::setOnClosed(onClosed_t onClosed) {
+	m_onClosed = onClosed;
+} // setOnClosed
+
+
+void BLEClientManager::setOnReady(onReady_t onReady) {
+	m_onReady = onReady;
+} // setOnReady
+
+
+/**
+ * @brief Make discovery requests one at a time, each when the last is answered, instead of
+ * handing them all to the stack at once.  For comparison: as the stack sends one request at a
+ * time either way, both take the same number of round trips.
+ */
+void BLEClientManager::setPipelined(bool pipelined) {
+	m_pipelined = pipelined;
+} // setPipelined
+
+
+/**
+ * @brief Queue a write of a characteristic.
+ *
+ * @param [in] address The peer, which must be connected or connecting.
+ * @param [in] service The service of the characteristic.
+ * @param [in] characteristic The characteristic to write.
+ * @param [in] data The value to write.  It is copied.
+ * @param [in] length The length of the value.
+ * @param [in] response Ask the peer to respond.
+ * @param [in] onComplete Called when the write completes, or nullptr.
+ * @return False if the peer is not connected or its queue is full.
+ */
+bool BLEClientManager::write(const uint8_t* address, const BLEAttributeId& service,
+		const BLEAttributeId& characteristic, const uint8_t* data, size_t length, bool response,
+		onComplete_t onComplete) {
+	Operation operation;
+	operation.write          = true;
+	operation.response       = response;
+	operation.service        = service;
+	operation.characteristic = characteristic;
+	operation.data.assign((const char*)data, length);
+	operation.onComplete     = onComplete;
+	return enqueue(address, operation);
+} // write
+
+
+/**
+ * @brief A characteristic has been found, or the search for the characteristics of a service has ended.
+ */
+void BLEClientManager::onCharacteristic(uint16_t connId, int status, const BLEAttributeId& service,
+		const BLEAttributeId& characteristic, uint8_t properties) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->state == STATE_DISCOVERING) {
+		pConnection->outstanding--;
+		int serviceIndex = pConnection->database.findService(service);
+		if (status != 0 && status != STATUS_NOT_FOUND) {
+			ESP_LOGE(LOG_TAG, "onCharacteristic: status %d", status);
+			failDiscovery(pConnection);
+			unlock();
+			return;
+		}
+		if (status == 0 && serviceIndex >= 0) {
+			int index = pConnection->database.addCharacteristic(serviceIndex, characteristic, properties);
+			if (index >= 0) {
+				Step descriptors = { true, (uint8_t)serviceIndex, (int16_t)index, -1 };
+				Step next        = { false, (uint8_t)serviceIndex, -1, (int16_t)index };
+				pConnection->steps.push_back(descriptors);
+				pConnection->steps.push_back(next);
+			}
+		}
+		issueSteps(pConnection);
+	}
+	unlock();
+} // onCharacteristic
+
+
+/**
+ * @brief A connection has closed.
+ */
+void BLEClientManager::onClose(uint16_t connId) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr) {
+		uint8_t address[6];
+		::memcpy(address, pConnection->address, 6);
+		release(pConnection);
+		if (m_onClosed) {
+			m_onClosed(address);
+		}
+	}
+	unlock();
+} // onClose
+
+
+/**
+ * @brief A descriptor has been found, or the search for the descriptors of a characteristic has ended.
+ */
+void BLEClientManager::onDescriptor(uint16_t connId, int status, const BLEAttributeId& service,
+		const BLEAttributeId& characteristic, const BLEAttributeId& descriptor) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->state == STATE_DISCOVERING) {
+		pConnection->outstanding--;
+		int serviceIndex        = pConnection->database.findService(service);
+		int characteristicIndex = pConnection->database.findCharacteristic(serviceIndex, characteristic);
+		if (status != 0 && status != STATUS_NOT_FOUND) {
+			ESP_LOGE(LOG_TAG, "onDescriptor: status %d", status);
+			failDiscovery(pConnection);
+			unlock();
+			return;
+		}
+		if (status == 0 && characteristicIndex >= 0) {
+			int index = pConnection->database.addDescriptor(characteristicIndex, descriptor);
+			if (index >= 0) {
+				Step next = { true, (uint8_t)serviceIndex, (int16_t)characteristicIndex, (int16_t)index };
+				pConnection->steps.push_back(next);
+			}
+		}
+		issueSteps(pConnection);
+	}
+	unlock();
+} // onDescriptor
+
+
+/**
+ * @brief A connection has opened, or failed to.
+ *
+ * If the database of the peer was saved, the connection is ready at once.  Otherwise discovery starts.
+ */
+void BLEClientManager::onOpen(const uint8_t* address, uint16_t connId, int status) {
+	lock();
+	Connection* pConnection = findByAddress(address);
+	if (pConnection == nullptr || pConnection->state != STATE_OPENING) {
+		unlock();
+		return;
+	}
+	if (status != 0) {
+		ESP_LOGD(LOG_TAG, "onOpen: status %d", status);
+		release(pConnection);
+		if (m_onClosed) {
+			m_onClosed(address);
+		}
+		unlock();
+		return;
+	}
+	pConnection->connId = connId;
+	m_stats.connects++;
+	if (pConnection->closing) {
+		pConnection->state = STATE_CLOSING;
+		m_pTransport->close(connId);
+		unlock();
+		return;
+	}
+
+	std::string saved;
+	if (m_pStore != nullptr && m_pStore->load(address, &saved) &&
+			pConnection->database.deserialize((const uint8_t*)saved.data(), saved.length())) {
+		m_stats.cacheHits++;
+		pConnection->state = STATE_READY;
+		if (m_onReady) {
+			m_onReady(pConnection->address, connId, true);
+		}
+		pump(pConnection);
+		unlock();
+		return;
+	}
+
+	startDiscovery(pConnection);
+	unlock();
+} // onOpen
+
+
+/**
+ * @brief A read has completed.
+ */
+void BLEClientManager::onRead(uint16_t connId, int status, const uint8_t* data, size_t length) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->busy && !pConnection->queue[pConnection->head].write) {
+		completeOperation(pConnection, status, data, length);
+		pump(pConnection);
+	}
+	unlock();
+} // onRead
+
+
+/**
+ * @brief The search for services has ended: look for the characteristics of each.
+ */
+void BLEClientManager::onSearchComplete(uint16_t connId, int status) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->state == STATE_DISCOVERING) {
+		pConnection->outstanding--;
+		if (status != 0) {
+			ESP_LOGE(LOG_TAG, "onSearchComplete: status %d", status);
+			failDiscovery(pConnection);
+		} else {
+			for (size_t i = 0; i < pConnection->database.services.size(); i++) {
+				Step step = { false, (uint8_t)i, -1, -1 };
+				pConnection->steps.push_back(step);
+			}
+			issueSteps(pConnection);
+		}
+	}
+	unlock();
+} // onSearchComplete
+
+
+/**
+ * @brief A service has been found.
+ */
+void BLEClientManager::onService(uint16_t connId, const BLEAttributeId& service, bool primary) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->state == STATE_DISCOVERING) {
+		pConnection->database.addService(service, primary);
+	}
+	unlock();
+} // onService
+
+
+/**
+ * @brief The peer has indicated Service Changed: its saved database is stale.
+ *
+ * The saved database is dropped and the database found again.  A read or write already sent
+ * completes as usual; those queued wait for the new database.
+ */
+void BLEClientManager::onServiceChanged(const uint8_t* address) {
+	lock();
+	forget(address);
+	Connection* pConnection = findByAddress(address);
+	if (pConnection != nullptr) {
+		if (pConnection->state == STATE_READY) {
+			startDiscovery(pConnection);
+		} else if (pConnection->state == STATE_DISCOVERING) {
+			pConnection->rediscover = true;   // Requests are outstanding: start again when they are answered.
+		}
+	}
+	unlock();
+} // onServiceChanged
+
+
+/**
+ * @brief A write has completed.
+ */
+void BLEClientManager::onWrite(uint16_t connId, int status) {
+	lock();
+	Connection* pConnection = findByConnId(connId);
+	if (pConnection != nullptr && pConnection->busy && pConnection->queue[pConnection->head].write) {
+		completeOperation(pConnection, status, nullptr, 0);
+		pump(pConnection);
+	}
+	unlock();
+} // onWrite
+
+
+/**
+ * @brief Take the operation at the head of the queue off and call its callback.
+ */
+void BLEClientManager::completeOperation(Connection* pConnection, int status, const uint8_t* data, size_t length) {
+	Operation& operation = pConnection->queue[pConnection->head];
+	onComplete_t onComplete = operation.onComplete;
+	operation.onComplete = nullptr;
+	operation.data.clear();
+	pConnection->head  = (pConnection->head + 1) % QUEUE_SIZE;
+	pConnection->count--;
+	pConnection->busy  = false;
+	m_stats.operations++;
+	if (onComplete) {
+		onComplete(status, data, length);
+	}
+} // completeOperation
+
+
+/**
+ * @brief The database is complete: save it and start the operations.
+ */
+void BLEClientManager::endDiscovery(Connection* pConnection) {
+	if (pConnection->rediscover) {
+		startDiscovery(pConnection);
+		return;
+	}
+	if (m_pStore != nullptr) {
+		std::string data;
+		pConnection->database.serialize(&data);
+		m_pStore->save(pConnection->address, data);
+	}
+	pConnection->state = STATE_READY;
+	ESP_LOGD(LOG_TAG, "Discovered %d services, %d characteristics, %d descriptors",
+		pConnection->database.services.size(), pConnection->database.characteristics.size(),
+		pConnection->database.descriptors.size());
+	if (m_onReady) {
+		m_onReady(pConnection->address, pConnection->connId, false);
+	}
+	pump(pConnection);
+} // endDiscovery
+
+
+bool BLEClientManager::enqueue(const uint8_t* address, Operation& operation) {
+	lock();
+	Connection* pConnection = findByAddress(address);
+	bool result = false;
+	if (pConnection != nullptr && !pConnection->closing && pConnection->count < QUEUE_SIZE) {
+		Operation& slot = pConnection->queue[(pConnection->head + pConnection->count) % QUEUE_SIZE];
+		slot.write          = operation.write;
+		slot.response       = operation.response;
+		slot.service        = operation.service;
+		slot.characteristic = operation.characteristic;
+		slot.data.swap(operation.data);
+		slot.onComplete     = operation.onComplete;
+		pConnection->count++;
+		pump(pConnection);
+		result = true;
+	}
+	unlock();
+	return result;
+} // enqueue
+
+
+/**
+ * @brief Give up on a discovery: save nothing, and close the connection.
+ */
+void BLEClientManager::failDiscovery(Connection* pConnection) {
+	pConnection->state = STATE_CLOSING;   // Answers still to come are ignored.
+	pConnection->steps.clear();
+	if (!m_pTransport->close(pConnection->connId)) {
+		uint8_t address[6];
+		::memcpy(address, pConnection->address, 6);
+		release(pConnection);
+		if (m_onClosed) {
+			m_onClosed(address);
+		}
+	}
+} // failDiscovery
+
+
+BLEClientManager::Connection* BLEClientManager::findByAddress(const uint8_t* address) {
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		if (m_connections[i].state != STATE_IDLE && ::memcmp(m_connections[i].address, address, 6) == 0) {
+			return &m_connections[i];
+		}
+	}
+	return nullptr;
+} // findByAddress
+
+
+BLEClientManager::Connection* BLEClientManager::findByConnId(uint16_t connId) {
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		if (m_connections[i].state > STATE_OPENING && m_connections[i].connId == connId) {
+			return &m_connections[i];
+		}
+	}
+	return nullptr;
+} // findByConnId
+
+
+/**
+ * @brief Make the discovery requests that are due: all of them when pipelined, otherwise the
+ * next one when none is outstanding.  Ends discovery when nothing is left.
+ */
+void BLEClientManager::issueSteps(Connection* pConnection) {
+	BLEAttributeDatabase& database = pConnection->database;
+	while (!pConnection->steps.empty() && (m_pipelined || pConnection->outstanding == 0)) {
+		Step step = pConnection->steps.front();
+		pConnection->steps.erase(pConnection->steps.begin());
+		const BLEAttributeDatabase::Service& service = database.services[step.service];
+		bool sent;
+		if (step.descriptor) {
+			sent = m_pTransport->getDescriptor(pConnection->connId, service,
+				database.characteristics[step.characteristic].id,
+				step.after >= 0 ? &database.descriptors[step.after].id : nullptr);
+		} else {
+			sent = m_pTransport->getCharacteristic(pConnection->connId, service,
+				step.after >= 0 ? &database.characteristics[step.after].id : nullptr);
+		}
+		if (!sent) {
+			ESP_LOGE(LOG_TAG, "issueSteps: the stack refused a discovery request");
+			failDiscovery(pConnection);
+			return;
+		}
+		pConnection->outstanding++;
+		m_stats.discoveryRequests++;
+	}
+	if (pConnection->steps.empty() && pConnection->outstanding == 0) {
+		endDiscovery(pConnection);
+	}
+} // issueSteps
+
+
+void BLEClientManager::lock() {
+#ifdef ESP_PLATFORM
+	xSemaphoreTakeRecursive(m_lock, portMAX_DELAY);
+#else
+	m_lock.lock();
+#endif
+} // lock
+
+
+/**
+ * @brief Send the operation at the head of the queue, if the connection is ready for it.
+ */
+void BLEClientManager::pump(Connection* pConnection) {
+	while (pConnection->state == STATE_READY && !pConnection->busy && pConnection->count > 0) {
+		Operation& operation = pConnection->queue[pConnection->head];
+		BLEAttributeDatabase& database = pConnection->database;
+		int service = database.findService(operation.service, true);
+		int characteristic = service >= 0 ? database.findCharacteristic(service, operation.characteristic, true) : -1;
+		if (characteristic < 0) {
+			completeOperation(pConnection, STATUS_NOT_FOUND, nullptr, 0);
+			continue;
+		}
+		pConnection->busy = true;
+		bool sent;
+		if (operation.write) {
+			sent = m_pTransport->write(pConnection->connId, database.services[service],
+				database.characteristics[characteristic].id,
+				(const uint8_t*)operation.data.data(), operation.data.length(), operation.response);
+		} else {
+			sent = m_pTransport->read(pConnection->connId, database.services[service],
+				database.characteristics[characteristic].id);
+		}
+		if (!sent) {
+			completeOperation(pConnection, STATUS_FAILED, nullptr, 0);
+		}
+	}
+} // pump
+
+
+/**
+ * @brief Free a connection, failing the operations left on it.
+ */
+void BLEClientManager::release(Connection* pConnection) {
+	pConnection->state = STATE_IDLE;
+	pConnection->busy  = false;
+	while (pConnection->count > 0) {
+		completeOperation(pConnection, STATUS_FAILED, nullptr, 0);
+	}
+	pConnection->head       = 0;
+	pConnection->closing    = false;
+	pConnection->rediscover = false;
+	pConnection->steps.clear();
+	pConnection->database.clear();
+} // release
+
+
+/**
+ * @brief Search the peer for its services, the first step of discovery.
+ */
+void BLEClientManager::startDiscovery(Connection* pConnection) {
+	pConnection->state       = STATE_DISCOVERING;
+	pConnection->rediscover  = false;
+	pConnection->database.clear();
+	pConnection->steps.clear();
+	pConnection->outstanding = 1;
+	m_stats.discoveryRequests++;
+	if (!m_pTransport->searchServices(pConnection->connId)) {
+		ESP_LOGE(LOG_TAG, "startDiscovery: the stack refused the search");
+		failDiscovery(pConnection);
+	}
+} // startDiscovery
+
+
+void BLEClientManager::unlock() {
+#ifdef ESP_PLATFORM
+	xSemaphoreGiveRecursive(m_lock);
+#else
+	m_lock.unlock();
+#endif
+} // unlock
@@ -0,0 +1,210 @@
+/*
+ * BLEClientManager.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLECLIENTMANAGER_H_
+#define COMPONENTS_CPP_UTILS_BLECLIENTMANAGER_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "BLEAttributeCache.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#else
+#include <mutex>
+#endif
+
+/**
+ * @brief The requests a BLEClientManager makes of a GATT client stack.
+ *
+ * Each request is answered later by a call to the matching on...() method of the manager.
+ * BLEGattClientESP implements it over the ESP-IDF GATT client; a simulated peer implements it
+ * on a host.
+ */
+class BLEGattClientTransport {
+public:
+	virtual ~BLEGattClientTransport() {}
+	virtual bool close(uint16_t connId) = 0;
+	virtual bool getCharacteristic(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId* pAfter) = 0;
+	virtual bool getDescriptor(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const BLEAttributeId* pAfter) = 0;
+	virtual bool open(const uint8_t* address) = 0;
+	virtual bool read(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic) = 0;
+	virtual bool searchServices(uint16_t connId) = 0;
+	virtual bool write(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const uint8_t* data, size_t length, bool response) = 0;
+}; // BLEGattClientTransport
+
+
+/**
+ * @brief Drive GATT client connections to several peers at once.
+ *
+ * connect() opens a connection and finds the peer's services, characteristics and descriptors.
+ * The requests of the discovery are pipelined: every service is searched for characteristics at
+ * once, and each characteristic found starts both the search for the next one and the search
+ * for its descriptors.  ATT allows one request at a time on a connection, so the stack still
+ * sends them one after another and discovery takes a round trip per attribute; pipelining only
+ * saves the stack waiting on the manager's task between an answer and the next request.
+ *
+ * A list of characteristics or descriptors ends with an answer of STATUS_NOT_FOUND.  A request
+ * the stack refuses, or an answer with any other failing status, fails the discovery: nothing is
+ * saved and the connection is closed.
+ *
+ * The database found is saved in a BLEAttributeStore by the address of the peer.  When the peer
+ * is connected again the database is loaded and discovery is skipped.  When the peer indicates
+ * Service Changed the saved database is dropped and the database found again.  Call forget()
+ * when a peer is otherwise known to have changed its services.
+ *
+ * Reads and writes are queued for each connection and sent one at a time, as ATT allows; they
+ * can be made as soon as connect() has been called, and are sent when the connection is ready.
+ *
+ * The manager is locked while it runs, and the callbacks are called with the lock held, from the
+ * task that delivers the stack's events.  They may call the manager.
+ *
+ * @code{.cpp}
+ * BLEAttributeNVSStore store;
+ * BLEGattClientESP client(&store);
+ * BLE::initClient();
+ * BLE::setGattClient(&client);
+ * client.getManager()->connect(address);
+ * client.getManager()->read(address, BLEAttributeId::fromUUID16(0x180f), BLEAttributeId::fromUUID16(0x2a19),
+ *     [](int status, const uint8_t* data, size_t length) { ... });
+ * @endcode
+ */
+class BLEClientManager {
+public:
+	static const int MAX_CONNECTIONS  = 4;
+	static const int QUEUE_SIZE       = 8;    // Operations waiting on one connection.
+	static const int STATUS_FAILED    = -1;   // The status of an operation that could not be sent.
+	static const int STATUS_NOT_FOUND = -2;   // The status of an operation on an attribute the peer lacks.
+
+	typedef enum {
+		STATE_IDLE,
+		STATE_OPENING,
+		STATE_DISCOVERING,
+		STATE_READY,
+		STATE_CLOSING       // Discovery failed: waiting for the stack to close the connection.
+	} state_t;
+
+	/**
+	 * @brief The counts of what the manager has done.
+	 */
+	typedef struct {
+		uint32_t connects;            //!< Connections opened.
+		uint32_t cacheHits;           //!< Connections that loaded their database instead of discovering it.
+		uint32_t discoveryRequests;   //!< Requests made to discover databases.
+		uint32_t operations;          //!< Reads and writes completed.
+	} stats_t;
+
+	/**
+	 * @brief Called when a read or write completes, with the status from the stack (0 is success).
+	 */
+	typedef std::function<void(int status, const uint8_t* data, size_t length)> onComplete_t;
+	typedef std::function<void(const uint8_t* address, uint16_t connId, bool fromCache)> onReady_t;
+	typedef std::function<void(const uint8_t* address)> onClosed_t;
+
+	BLEClientManager(BLEGattClientTransport* pTransport, BLEAttributeStore* pStore = nullptr);
+	virtual ~BLEClientManager();
+
+	bool connect(const uint8_t* address);
+	void disconnect(const uint8_t* address);
+	void forget(const uint8_t* address);
+	const BLEAttributeDatabase* getDatabase(const uint8_t* address);
+	state_t getState(const uint8_t* address);
+	stats_t getStats();
+	bool read(const uint8_t* address, const BLEAttributeId& service, const BLEAttributeId& characteristic,
+			onComplete_t onComplete);
+	void setOnClosed(onClosed_t onClosed);
+	void setOnReady(onReady_t onReady);
+	void setPipelined(bool pipelined);
+	bool write(const uint8_t* address, const BLEAttributeId& service, const BLEAttributeId& characteristic,
+			const uint8_t* data, size_t length, bool response, onComplete_t onComplete);
+
+	// The answers of the stack.
+	void onCharacteristic(uint16_t connId, int status, const BLEAttributeId& service,
+			const BLEAttributeId& characteristic, uint8_t properties);
+	void onClose(uint16_t connId);
+	void onDescriptor(uint16_t connId, int status, const BLEAttributeId& service,
+			const BLEAttributeId& characteristic, const BLEAttributeId& descriptor);
+	void onOpen(const uint8_t* address, uint16_t connId, int status);
+	void onRead(uint16_t connId, int status, const uint8_t* data, size_t length);
+	void onSearchComplete(uint16_t connId, int status);
+	void onService(uint16_t connId, const BLEAttributeId& service, bool primary);
+	void onServiceChanged(const uint8_t* address);
+	void onWrite(uint16_t connId, int status);
+
+private:
+	/**
+	 * @brief A read or write waiting for its turn on a connection.
+	 */
+	struct Operation {
+		bool           write;
+		bool           response;
+		BLEAttributeId service;          // Found by UUID when the operation is sent.
+		BLEAttributeId characteristic;
+		std::string    data;
+		onComplete_t   onComplete;
+	};
+
+	/**
+	 * @brief A discovery request not yet made: the characteristics of a service, or the
+	 * descriptors of a characteristic, after the one last found.
+	 */
+	struct Step {
+		bool    descriptor;
+		uint8_t service;
+		int16_t characteristic;
+		int16_t after;            // The index of the attribute last found, or -1 to start.
+	};
+
+	struct Connection {
+		uint8_t              address[6];
+		uint16_t             connId;
+		state_t              state;
+		BLEAttributeDatabase database;
+		std::vector<Step>    steps;
+		uint16_t             outstanding;   // Discovery requests made and not yet answered.
+		Operation            queue[QUEUE_SIZE];
+		uint8_t              head;
+		uint8_t              count;
+		bool                 busy;          // The operation at the head has been sent.
+		bool                 closing;       // Close the connection as soon as it opens.
+		bool                 rediscover;    // The services changed during discovery: start again.
+	};
+
+	Connection* findByAddress(const uint8_t* address);
+	Connection* findByConnId(uint16_t connId);
+	void        completeOperation(Connection* pConnection, int status, const uint8_t* data, size_t length);
+	void        endDiscovery(Connection* pConnection);
+	bool        enqueue(const uint8_t* address, Operation& operation);
+	void        failDiscovery(Connection* pConnection);
+	void        issueSteps(Connection* pConnection);
+	void        lock();
+	void        pump(Connection* pConnection);
+	void        release(Connection* pConnection);
+	void        startDiscovery(Connection* pConnection);
+	void        unlock();
+
+	BLEGattClientTransport* m_pTransport;
+	BLEAttributeStore*      m_pStore;
+	Connection              m_connections[MAX_CONNECTIONS];
+	bool                    m_pipelined;
+	onReady_t               m_onReady;
+	onClosed_t              m_onClosed;
+	stats_t                 m_stats;
+#ifdef ESP_PLATFORM
+	SemaphoreHandle_t       m_lock;
+#else
+	std::recursive_mutex    m_lock;
+#endif
+}; // BLEClientManager
+
+#endif /* COMPONENTS_CPP_UTILS_BLECLIENTMANAGER_H_ */
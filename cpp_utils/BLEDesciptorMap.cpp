@@ -6,11 +6,15 @@
  */
 #include <sstream>
 #include <iomanip>
+#include <esp_log.h>
 #include "BLEDescriptorMap.h"
 #include "BLEDescriptor.h"
 #include <esp_gatts_api.h>   // ESP32 BLE
 
+static char LOG_TAG[] = "BLEDescriptorMap";
+
 BLEDescriptorMap::BLEDescriptorMap() {
+	m_iterator = 0;
 }
 
 BLEDescriptorMap::~BLEDescriptorMap() {
@@ -23,12 +27,11 @@ BLEDescriptorMap::~BLEDescriptorMap() {
  * @return The descriptor.
  */
 BLEDescriptor* BLEDescriptorMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.second->getUUID().equals(uuid)) {
-			return myPair.second;
+	for (auto pDescriptor : m_descriptors) {
+		if (pDescriptor->getUUID().equals(uuid)) {
+			return pDescriptor;
 		}
 	}
-	//return m_uuidMap.at(uuid.toString());
 	return nullptr;
 } // getByUUID
 
@@ -39,7 +42,8 @@ BLEDescriptor* BLEDescriptorMap::getByUUID(BLEUUID uuid) {
  * @return The descriptor.
  */
 BLEDescriptor* BLEDescriptorMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	BLEDescriptor** ppDescriptor = m_handleMap.get(handle);
+	return ppDescriptor == nullptr ? nullptr : *ppDescriptor;
 } // getByHandle
 
 
@@ -47,12 +51,19 @@ BLEDescriptor* BLEDescriptorMap::getByHandle(uint16_t handle) {
  * @brief Set the descriptor by UUID.
  * @param [in] uuid The uuid of the descriptor.
  * @param [in] characteristic The descriptor to cache.
- * @return N/A.
+ * @return False if the map already holds CONFIG_BLE_MAX_DESCRIPTORS descriptors.
  */
-void BLEDescriptorMap::setByUUID(
+bool BLEDescriptorMap::setByUUID(
 		BLEUUID            uuid,
 		BLEDescriptor *pDescriptor) {
-	m_uuidMap.insert(std::pair<std::string, BLEDescriptor *>(uuid.toString(), pDescriptor));
+	if (getByUUID(uuid) != nullptr) {
+		return true;
+	}
+	if (m_descriptors.size() >= CONFIG_BLE_MAX_DESCRIPTORS || !m_descriptors.pushBack(pDescriptor)) {
+		ESP_LOGE(LOG_TAG, "setByUUID: no room for more than %d descriptors, see CONFIG_BLE_MAX_DESCRIPTORS", CONFIG_BLE_MAX_DESCRIPTORS);
+		return false;
+	}
+	return true;
 } // setByUUID
 
 
@@ -60,11 +71,15 @@ void BLEDescriptorMap::setByUUID(
  * @brief Set the descriptor by handle.
  * @param [in] handle The handle of the descriptor.
  * @param [in] descriptor The descriptor to cache.
- * @return N/A.
+ * @return False if the map is full.
  */
-void BLEDescriptorMap::setByHandle(uint16_t handle,
+bool BLEDescriptorMap::setByHandle(uint16_t handle,
 		BLEDescriptor *pDescriptor) {
-	m_handleMap.insert(std::pair<uint16_t, BLEDescriptor *>(handle, pDescriptor));
+	if (!m_handleMap.set(handle, pDescriptor)) {
+		ESP_LOGE(LOG_TAG, "setByHandle: more than %d handles", (int)m_handleMap.capacity());
+		return false;
+	}
+	return true;
 } // setByHandle
 
 
@@ -76,12 +91,12 @@ std::string BLEDescriptorMap::toString() {
 	std::stringstream stringStream;
 	stringStream << std::hex << std::setfill('0');
 	int count=0;
-	for (auto &myPair: m_uuidMap) {
+	for (auto pDescriptor: m_descriptors) {
 		if (count > 0) {
 			stringStream << "\n";
 		}
 		count++;
-		stringStream << "handle: 0x" << std::setw(2) << myPair.second->getHandle() << ", uuid: " + myPair.second->getUUID().toString();
+		stringStream << "handle: 0x" << std::setw(2) << pDescriptor->getHandle() << ", uuid: " + pDescriptor->getUUID().toString();
 	}
 	return stringStream.str();
 } // toString
@@ -98,8 +113,8 @@ void BLEDescriptorMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t *param) {
 	// Invoke the handler for every descriptor we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.second->handleGATTServerEvent(event, gatts_if, param);
+	for (auto pDescriptor : m_descriptors) {
+		pDescriptor->handleGATTServerEvent(event, gatts_if, param);
 	}
 } // handleGATTServerEvent
 
@@ -109,13 +124,8 @@ void BLEDescriptorMap::handleGATTServerEvent(
  * @return The first descriptor in the map.
  */
 BLEDescriptor* BLEDescriptorMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) {
-		return nullptr;
-	}
-	BLEDescriptor *pRet = m_iterator->second;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 
@@ -124,10 +134,8 @@ BLEDescriptor* BLEDescriptorMap::getFirst() {
  * @return The next descriptor in the map.
  */
 BLEDescriptor* BLEDescriptorMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) {
+	if (m_iterator >= m_descriptors.size()) {
 		return nullptr;
 	}
-	BLEDescriptor *pRet = m_iterator->second;
-	m_iterator++;
-	return pRet;
+	return m_descriptors[m_iterator++];
 } // getNext
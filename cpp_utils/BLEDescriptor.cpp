@@ -21,11 +21,8 @@ extern "C" {
 	char *espToString(esp_err_t value);
 }
 
-BLEDescriptor::BLEDescriptor(BLEUUID uuid) {
+BLEDescriptor::BLEDescriptor(BLEUUID uuid) : m_value(ESP_GATT_MAX_ATTR_LEN) {
 	m_bleUUID            = uuid;
-	m_value.attr_value   = (uint8_t *)malloc(ESP_GATT_MAX_ATTR_LEN);
-	m_value.attr_len     = 0;
-	m_value.attr_max_len = ESP_GATT_MAX_ATTR_LEN;
 	m_handle             = 0;
 	m_pCharacteristic    = nullptr;
 
@@ -33,7 +30,6 @@ BLEDescriptor::BLEDescriptor(BLEUUID uuid) {
 
 
 BLEDescriptor::~BLEDescriptor() {
-	free(m_value.attr_value);
 } // ~BLEDescriptor
 
 
@@ -51,11 +47,16 @@ void BLEDescriptor::executeCreate(BLECharacteristic* pCharacteristic) {
 
 	m_pCharacteristic = pCharacteristic; // Save the characteristic associated with this service.
 
+	esp_bt_uuid_t uuid = getUUID().getNative();
+	esp_attr_value_t value; // The initial value, copied by the stack.  Reads and writes come to us.
+	value.attr_max_len = ESP_GATT_MAX_ATTR_LEN;
+	value.attr_len     = m_value.getLength() < ESP_GATT_MAX_ATTR_LEN ? m_value.getLength() : ESP_GATT_MAX_ATTR_LEN;
+	value.attr_value   = m_value.getData();
 	esp_err_t errRc = ::esp_ble_gatts_add_char_descr(
 			pCharacteristic->getService()->getHandle(),
-			getUUID().getNative(),
+			&uuid,
 			ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-			&m_value,
+			&value,
 			nullptr);
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_add_char_descr: rc=%d %s", errRc, espToString(errRc));
@@ -88,12 +89,9 @@ BLEUUID BLEDescriptor::getUUID() {
  * @param [in] length The length of the data in bytes.
  */
 void BLEDescriptor::setValue(uint8_t* data, size_t length) {
-	if (length > ESP_GATT_MAX_ATTR_LEN) {
-		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, ESP_GATT_MAX_ATTR_LEN);
-		return;
+	if (!m_value.setValue(data, length)) {
+		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, m_value.getMaxLength());
 	}
-	m_value.attr_len = length;
-	memcpy(m_value.attr_value, data, length);
 } // setValue
 
 
@@ -102,11 +100,11 @@ void BLEDescriptor::setValue(std::string value) {
 }
 
 uint8_t* BLEDescriptor::getValue() {
-	return m_value.attr_value;
+	return m_value.getData();
 }
 
 size_t BLEDescriptor::getLength() {
-	return m_value.attr_len;
+	return m_value.getLength();
 }
 
 
@@ -166,16 +164,31 @@ void BLEDescriptor::handleGATTServerEvent(
 		// - uint16_t len
 		// - uint8_t *value
 		case ESP_GATTS_WRITE_EVT: {
-			if (param->write.handle == m_handle) {
-				setValue(param->write.value, param->write.len);
+			if (param->write.handle != m_handle) {
+				break;
+			}
+			esp_gatt_status_t status = ESP_GATT_OK;
+			if (param->write.is_prep) {
+				if (!m_value.prepare(param->write.offset, param->write.value, param->write.len)) {
+					status = param->write.offset > m_value.getMaxLength() ? ESP_GATT_INVALID_OFFSET : ESP_GATT_PREPARE_Q_FULL;
+				}
+			} else if (param->write.offset != 0) {
+				if (!m_value.prepare(param->write.offset, param->write.value, param->write.len) || !m_value.commitPrepared()) {
+					m_value.cancelPrepared();
+					status = ESP_GATT_INVALID_OFFSET;
+				}
+			} else if (!m_value.setValue(param->write.value, param->write.len)) {
+				status = ESP_GATT_INVALID_ATTR_LEN;
+			}
+			if (param->write.need_rsp) {
 				esp_gatt_rsp_t rsp;
-				rsp.attr_value.len    = getLength();
-				rsp.attr_value.handle = m_handle;
-				rsp.attr_value.offset = 0;
+				rsp.attr_value.len      = param->write.is_prep ? param->write.len : 0;
+				rsp.attr_value.handle   = m_handle;
+				rsp.attr_value.offset   = param->write.offset;
 				rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-				memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+				memcpy(rsp.attr_value.value, param->write.value, rsp.attr_value.len);
 				esp_err_t errRc = ::esp_ble_gatts_send_response(
-						gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, &rsp);
+						gatts_if, param->write.conn_id, param->write.trans_id, status, &rsp);
 				if (errRc != ESP_OK) {
 					ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
 				}
@@ -183,6 +196,16 @@ void BLEDescriptor::handleGATTServerEvent(
 			break;
 		} // ESP_GATTS_WRITE_EVT
 
+		// ESP_GATTS_EXEC_WRITE_EVT - The parts of a long write are to be applied or discarded.
+		case ESP_GATTS_EXEC_WRITE_EVT: {
+			if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC) {
+				m_value.commitPrepared();
+			} else {
+				m_value.cancelPrepared();
+			}
+			break;
+		} // ESP_GATTS_EXEC_WRITE_EVT
+
 		// ESP_GATTS_READ_EVT - A request to read the value of a descriptor has arrived.
 		//
 		// read:
@@ -196,24 +219,26 @@ void BLEDescriptor::handleGATTServerEvent(
 		//
 		case ESP_GATTS_READ_EVT: {
 			ESP_LOGD(LOG_TAG, "- Testing: Sought handle: 0x%.2x == descriptor handle: 0x%.2x ?", param->read.handle, m_handle);
-			if (param->read.handle == m_handle) {
+			if (param->read.handle == m_handle && param->read.need_rsp) {
 				ESP_LOGD(LOG_TAG, "Sending a response (esp_ble_gatts_send_response)");
-				if (param->read.need_rsp) {
-					esp_gatt_rsp_t rsp;
-					rsp.attr_value.len    = getLength();
-					rsp.attr_value.handle = param->read.handle;
-					rsp.attr_value.offset = 0;
-					rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-					memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
-					esp_err_t errRc = ::esp_ble_gatts_send_response(
-							gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
-					if (errRc != ESP_OK) {
-						ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
-					}
+				esp_gatt_rsp_t rsp;
+				esp_gatt_status_t status = ESP_GATT_OK;
+				if (param->read.offset > m_value.getLength()) {
+					status = ESP_GATT_INVALID_OFFSET;
+				}
+				rsp.attr_value.len      = m_value.read(param->read.offset, rsp.attr_value.value, ESP_GATT_MAX_ATTR_LEN);
+				rsp.attr_value.handle   = param->read.handle;
+				rsp.attr_value.offset   = param->read.offset;
+				rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+				esp_err_t errRc = ::esp_ble_gatts_send_response(
+						gatts_if, param->read.conn_id, param->read.trans_id, status, &rsp);
+				if (errRc != ESP_OK) {
+					ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
 				}
-			} // ESP_GATTS_READ_EVT
+			}
 			break;
 		} // ESP_GATTS_READ_EVT
+
 		default: {
 			break;
 		}
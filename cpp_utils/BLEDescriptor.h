@@ -10,6 +10,7 @@
 #include <string>
 #include "BLEUUID.h"
 #include "BLECharacteristic.h"
+#include "BLEValue.h"
 #include <esp_gatts_api.h>
 class BLEService;
 class BLECharacteristic;
@@ -33,8 +34,9 @@ public:
 private:
 	friend class BLEDescriptorMap;
 	friend class BLECharacteristic;
+	friend class BLEServer;
 	BLEUUID m_bleUUID;
-	esp_attr_value_t     m_value;
+	BLEValue             m_value;
 	uint16_t             m_handle;
 	BLECharacteristic   *m_pCharacteristic;
 	void executeCreate(BLECharacteristic *pCharacteristic);
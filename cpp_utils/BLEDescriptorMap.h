@@ -7,9 +7,15 @@
 
 #ifndef COMPONENTS_CPP_UTILS_BLEDESCRIPTORMAP_H_
 #define COMPONENTS_CPP_UTILS_BLEDESCRIPTORMAP_H_
-#include <map>
+#include "FixedHashMap.h"
+#include "SmallVector.h"
 #include "BLEUUID.h"
 #include <esp_gatts_api.h>   // ESP32 BLE
+#include "sdkconfig.h"
+
+#ifndef CONFIG_BLE_MAX_DESCRIPTORS
+#define CONFIG_BLE_MAX_DESCRIPTORS 8
+#endif
 
 class BLEDescriptor;
 
@@ -17,8 +23,8 @@ class BLEDescriptorMap {
 public:
 	BLEDescriptorMap();
 	virtual ~BLEDescriptorMap();
-	void setByUUID(BLEUUID uuid,      BLEDescriptor *pDescriptor);
-	void setByHandle(uint16_t handle, BLEDescriptor *pDescriptor);
+	bool setByUUID(BLEUUID uuid,      BLEDescriptor *pDescriptor);
+	bool setByHandle(uint16_t handle, BLEDescriptor *pDescriptor);
 	BLEDescriptor *getByUUID(BLEUUID uuid);
 	BLEDescriptor *getByHandle(uint16_t handle);
 	std::string toString();
@@ -29,9 +35,9 @@ public:
 	BLEDescriptor *getFirst();
 	BLEDescriptor *getNext();
 private:
-	std::map<std::string, BLEDescriptor *> m_uuidMap;
-	std::map<uint16_t,    BLEDescriptor *> m_handleMap;
-	std::map<std::string, BLEDescriptor *>::iterator m_iterator;
+	SmallVector<BLEDescriptor*, 4> m_descriptors;   // In the order they were added.
+	FixedHashMap<uint16_t, BLEDescriptor*, fixedHashMapCapacity(CONFIG_BLE_MAX_DESCRIPTORS)> m_handleMap;
+	size_t                         m_iterator;
 };
 
 #endif /* COMPONENTS_CPP_UTILS_BLEDESCRIPTORMAP_H_ */
@@ -12,6 +12,7 @@
 #include <esp_gap_ble_api.h>
 #include <esp_gattc_api.h>
 #include "BLEDevice.h"
+#include "BLEAdvertisedData.h"
 #include "BLEUtils.h"
 #include "BLEService.h"
 #include <string>
@@ -78,7 +79,7 @@ void BLEDevice::readCharacteristic(uint16_t srvcId, uint16_t characteristicId) {
 
 
 /**
- * @brief Dump the advertizing payload.
+ * @brief Parse the advertizing payload.
  *
  * The payload is a buffer of bytes that is either 31 bytes long or terminated by
  * a 0 length value.  Each entry in the buffer has the format:
@@ -89,65 +90,52 @@ void BLEDevice::readCharacteristic(uint16_t srvcId, uint16_t characteristicId) {
  *
  * https://www.bluetooth.com/specifications/assigned-numbers/generic-access-profile
  */
-void BLEDevice::setAdvertizementResult(uint8_t *payload) {
-	uint8_t length;
-	uint8_t ad_type;
-	uint8_t sizeConsumed = 0;
-	bool finished = false;
-	//int i;
-	//char text[31*2+1];
-	//sprintf(text, "%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x")
-	while(!finished) {
-		length = *payload;
-		payload++;
-		sizeConsumed = 1 + length;
-
-		if (length != 0) {
-			ad_type = *payload;
-
-
-			ESP_LOGD(tag, "Type: 0x%.2x (%s), length: %d", ad_type, adv_type_to_string(ad_type), length);
-			payload++;
-			length--;
-
-			switch(ad_type) {
-				case ESP_BLE_AD_TYPE_NAME_CMPL:
-					m_name = std::string((char *)payload, length);
-					break;
-				case ESP_BLE_AD_TYPE_TX_PWR:
-					m_txPower = *payload;
-					break;
-				case ESP_BLE_AD_TYPE_APPEARANCE:
-					m_appearance = *(uint16_t *)payload;
-					break;
-				case ESP_BLE_AD_TYPE_16SRV_PART:
-					m_services.insert(std::string((char *) payload, 2));
-					break;
-				case ESP_BLE_AD_TYPE_128SRV_PART:
-					m_services.insert(std::string((char *) payload, 16));
-					break;
-				case ESP_BLE_AD_TYPE_FLAG:
-					setAdFlag((uint8_t)*payload);
-					break;
-				case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE:
-					assert(length >=2);
-					m_manufacturerType[0] = payload[0];
-					m_manufacturerType[1] = payload[1];
-					break;
-
-				default:
-					ESP_LOGD(tag, "Unhandled type");
-					break;
-			}
-			payload += length;
-		}
-
+void BLEDevice::setAdvertizementResult(uint8_t *payload, size_t length) {
+	for (const BLEAdvertisedData::Field& field: BLEAdvertisedData(payload, length)) {
+		ESP_LOGD(tag, "Type: 0x%.2x (%s), length: %d", field.type, adv_type_to_string(field.type), field.length);
+
+		switch(field.type) {
+			case ESP_BLE_AD_TYPE_NAME_CMPL:
+				m_name = std::string((char *)field.data, field.length);
+				break;
+			case ESP_BLE_AD_TYPE_TX_PWR:
+				if (field.length >= 1) {
+					m_txPower = field.data[0];
+				}
+				break;
+			case ESP_BLE_AD_TYPE_APPEARANCE:
+				if (field.length >= 2) {
+					m_appearance = field.data[0] | (field.data[1] << 8);
+				}
+				break;
+			case ESP_BLE_AD_TYPE_16SRV_PART:
+				if (field.length >= 2) {
+					m_services.insert(std::string((char *)field.data, 2));
+				}
+				break;
+			case ESP_BLE_AD_TYPE_128SRV_PART:
+				if (field.length >= 16) {
+					m_services.insert(std::string((char *)field.data, 16));
+				}
+				break;
+			case ESP_BLE_AD_TYPE_FLAG:
+				if (field.length >= 1) {
+					setAdFlag(field.data[0]);
+				}
+				break;
+			case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE:
+				if (field.length >= 2) {
+					m_manufacturerType[0] = field.data[0];
+					m_manufacturerType[1] = field.data[1];
+				}
+				break;
 
-		if (sizeConsumed >=31 || length == 0) {
-			finished = true;
+			default:
+				ESP_LOGD(tag, "Unhandled type");
+				break;
 		}
-	} // !finished
-} // dump_adv_payload
+	}
+} // setAdvertizementResult
 
 
 /**
@@ -312,8 +300,8 @@ void BLEDevice::setAdFlag(uint8_t adFlag) {
 } // setAdFlag
 
 
-void BLEDevice::parsePayload(uint8_t* payload) {
-	setAdvertizementResult(payload);
+void BLEDevice::parsePayload(uint8_t* payload, size_t length) {
+	setAdvertizementResult(payload, length);
 	m_haveAdvertizement = true;
 } // parsePayload
 
@@ -11,6 +11,7 @@
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
 
+#include <esp_gap_ble_api.h>
 #include <esp_gattc_api.h>
 #include <string.h>
 #include <map>
@@ -81,7 +82,7 @@ public:
 	void open(esp_gatt_if_t gattc_if);
 	void readCharacteristic(esp_gatt_srvc_id_t srvcId, esp_gatt_id_t characteristicId);
 	void readCharacteristic(uint16_t srvcId, uint16_t characteristicId);
-	void parsePayload(uint8_t *payload);
+	void parsePayload(uint8_t *payload, size_t length = ESP_BLE_ADV_DATA_LEN_MAX);
 	void searchService();
 	void setAddress(ble_address address);
 	void setAdFlag(uint8_t adFlag);
@@ -122,7 +123,7 @@ private:
 	int         m_rssi;
 	std::unordered_set<std::string> m_services;
 	int8_t      m_txPower;
-	void setAdvertizementResult(uint8_t *payload);
+	void setAdvertizementResult(uint8_t *payload, size_t length);
 	bool m_haveAdvertizement;
 }; // class BLEDevice
 
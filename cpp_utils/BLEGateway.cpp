@@ -0,0 +1,448 @@
+/*
+ * BLEGateway.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "BLEAdvertisedData.h"
+#include "BLEGateway.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include "FreeRTOS.h"
+#include "Task.h"
+static const char* LOG_TAG = "BLEGateway";
+#else
+#define ESP_LOGW(tag, ...)
+#endif
+
+/**
+ * @brief The most a record can take in a batch, with its separator or header.
+ */
+static const size_t JSON_RECORD_SIZE   = 1 + 66 + 2 * BLEGateway::PAYLOAD_SIZE + 2;   // ,{"addr":..."data":" <hex> "}
+static const size_t BINARY_RECORD_SIZE = 12 + BLEGateway::PAYLOAD_SIZE;
+static const size_t BINARY_HEADER_SIZE = 6;
+
+const BLEGateway::config_t BLEGateway::DEFAULT_CONFIG = {
+	-90,           // minRSSI
+	1000,          // minIntervalMs
+	30000,         // refreshMs
+	FORMAT_JSON,   // format
+	4096,          // maxBatchBytes
+	64,            // maxBatchRecords
+	1000           // maxBatchAgeMs
+};
+
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief The longest the task waits before it looks at the queue again.
+ */
+static const uint32_t POLL_MS = 50;
+
+/**
+ * @brief The task that runs process(): woken when the queue is half full, when a batch is due
+ * and every POLL_MS.
+ */
+class BLEGatewayTask: public Task {
+public:
+	BLEGatewayTask(BLEGateway* pGateway, uint16_t stackSize): Task("BLEGatewayTask", stackSize) {
+		m_pGateway = pGateway;
+		m_stopped  = xSemaphoreCreateBinary();
+	}
+
+	~BLEGatewayTask() {
+		vSemaphoreDelete(m_stopped);
+	}
+
+	void run(void* data) {
+		while (m_pGateway->m_running) {
+			uint32_t waitMs = m_pGateway->process(FreeRTOS::getTimeSinceStart());
+			TickType_t ticks = (waitMs < POLL_MS ? waitMs : POLL_MS) / portTICK_PERIOD_MS;
+			xSemaphoreTake(m_pGateway->m_wakeup, ticks > 0 ? ticks : 1);   // Not 0, which would spin.
+		}
+		m_pGateway->flush();
+		m_pGateway->process(FreeRTOS::getTimeSinceStart());
+		xSemaphoreGive(m_stopped);
+	} // run
+
+	SemaphoreHandle_t m_stopped;
+
+private:
+	BLEGateway* m_pGateway;
+};
+#endif
+
+
+/**
+ * @brief Create a gateway.
+ * @param [in] sink The function that sends a batch on.
+ * @param [in] config What the filter passes and how the batches are made.
+ */
+BLEGateway::BLEGateway(sink_t sink, config_t config) {
+	size_t smallest = config.format == FORMAT_JSON ? 2 + JSON_RECORD_SIZE : BINARY_HEADER_SIZE + BINARY_RECORD_SIZE;
+	if (config.maxBatchBytes < smallest) {
+		ESP_LOGW(LOG_TAG, "maxBatchBytes %d cannot hold a record, using %d", config.maxBatchBytes, (int)smallest);
+		config.maxBatchBytes = smallest;
+	}
+	if (config.maxBatchRecords == 0) {
+		config.maxBatchRecords = 1;
+	}
+	m_sink           = sink;
+	m_config         = config;
+	m_batch          = new uint8_t[config.maxBatchBytes];
+	m_batchLength    = 0;
+	m_batchCount     = 0;
+	m_batchFirstMs   = 0;
+	m_flushRequested = false;
+#ifdef ESP_PLATFORM
+	m_wakeup  = xSemaphoreCreateBinary();
+	m_pTask   = new BLEGatewayTask(this, 4096);
+	m_running = false;
+#endif
+} // BLEGateway
+
+
+BLEGateway::~BLEGateway() {
+#ifdef ESP_PLATFORM
+	stop();
+	delete m_pTask;
+	vSemaphoreDelete(m_wakeup);
+#endif
+	delete[] m_batch;
+} // ~BLEGateway
+
+
+/**
+ * @brief Add an address to the allowlist.
+ *
+ * While the allowlist is empty every address is allowed.  Call before the first advertisement,
+ * or from the task that calls process().
+ *
+ * @param [in] address The 6 byte address.
+ * @return False if the allowlist already holds MAX_ALLOWED addresses.
+ */
+bool BLEGateway::allow(const uint8_t* address) {
+	uint64_t key = toKey(address);
+	if (m_allowed.get(key) == nullptr && m_allowed.size() >= MAX_ALLOWED) {
+		return false;
+	}
+	return m_allowed.set(key, true);
+} // allow
+
+
+/**
+ * @brief Send the batch being made at the next process(), without waiting for it to fill.
+ */
+void BLEGateway::flush() {
+	m_flushRequested = true;
+#ifdef ESP_PLATFORM
+	xSemaphoreGive(m_wakeup);
+#endif
+} // flush
+
+
+/**
+ * @brief Get what each stage has done.  May be called from any task.
+ */
+BLEGateway::stats_t BLEGateway::getStats() {
+	stats_t stats;
+	stats.received       = m_counters.received.load(std::memory_order_relaxed);
+	stats.queueDrops     = m_counters.queueDrops.load(std::memory_order_relaxed);
+	stats.queueDepth     = m_queue.size();
+	stats.queueHighWater = m_counters.queueHighWater.load(std::memory_order_relaxed);
+	stats.notAllowed     = m_counters.notAllowed.load(std::memory_order_relaxed);
+	stats.weak           = m_counters.weak.load(std::memory_order_relaxed);
+	stats.duplicates     = m_counters.duplicates.load(std::memory_order_relaxed);
+	stats.throttled      = m_counters.throttled.load(std::memory_order_relaxed);
+	stats.untracked      = m_counters.untracked.load(std::memory_order_relaxed);
+	stats.encoded        = m_counters.encoded.load(std::memory_order_relaxed);
+	stats.batchRecords   = m_counters.batchRecords.load(std::memory_order_relaxed);
+	stats.batchBytes     = m_counters.batchBytes.load(std::memory_order_relaxed);
+	stats.batches        = m_counters.batches.load(std::memory_order_relaxed);
+	stats.sinkFailures   = m_counters.sinkFailures.load(std::memory_order_relaxed);
+	stats.sinkDrops      = m_counters.sinkDrops.load(std::memory_order_relaxed);
+	return stats;
+} // getStats
+
+
+/**
+ * @brief Queue an advertisement.
+ *
+ * Call from one task only, normally the GAP event handler.  The advertisement is copied, up to
+ * the end of its last AD structure, and the call never waits.
+ *
+ * @param [in] address The 6 byte address of the advertiser.
+ * @param [in] rssi The RSSI of the advertisement.
+ * @param [in] payload The advertising data, followed by the scan response if there is one.
+ * @param [in] length The length of the payload.
+ * @param [in] now The time in ms.
+ * @return False if the queue was full and the advertisement was dropped.
+ */
+bool BLEGateway::onAdvertisement(const uint8_t* address, int rssi, const uint8_t* payload, size_t length, uint32_t now) {
+	m_counters.received.fetch_add(1, std::memory_order_relaxed);
+	BLEGatewayAdvertisement adv;
+	adv.time   = now;
+	adv.rssi   = rssi;
+	adv.length = BLEAdvertisedData(payload, length < PAYLOAD_SIZE ? length : PAYLOAD_SIZE).getUsedLength();
+	::memcpy(adv.address, address, sizeof(adv.address));
+	::memcpy(adv.payload, payload, adv.length);
+	if (!m_queue.push(adv)) {
+		m_counters.queueDrops.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	uint32_t depth = m_queue.size();
+	if (depth > m_counters.queueHighWater.load(std::memory_order_relaxed)) {
+		m_counters.queueHighWater.store(depth, std::memory_order_relaxed);
+	}
+#ifdef ESP_PLATFORM
+	if (depth == QUEUE_SIZE / 2) {
+		xSemaphoreGive(m_wakeup);
+	}
+#endif
+	return true;
+} // onAdvertisement
+
+
+/**
+ * @brief Pass the queued advertisements through the filter and the encoder, and send the
+ * batch if it is due.
+ *
+ * Call from one task only.  On the ESP32, start() runs it on a task of its own.
+ *
+ * @param [in] now The time in ms.
+ * @return The ms until the batch being made is due, or UINT32_MAX if there is none.
+ */
+uint32_t BLEGateway::process(uint32_t now) {
+	bool force = m_flushRequested.exchange(false);
+	BLEGatewayAdvertisement adv;
+	while (m_queue.pop(&adv)) {
+		if (accept(adv)) {
+			encode(adv);
+		}
+	}
+	if (m_batchCount > 0 && (force || now - m_batchFirstMs >= m_config.maxBatchAgeMs)) {
+		send();
+	}
+	if (m_batchCount == 0) {
+		return UINT32_MAX;
+	}
+	uint32_t age = now - m_batchFirstMs;
+	return age < m_config.maxBatchAgeMs ? m_config.maxBatchAgeMs - age : 0;
+} // process
+
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Start the task that runs process().
+ * @param [in] stackSize The stack size of the task, which also calls the sink.
+ */
+void BLEGateway::start(uint16_t stackSize) {
+	m_running = true;
+	m_pTask->setStackSize(stackSize);
+	m_pTask->start();
+} // start
+
+
+/**
+ * @brief Send what remains and stop the task.
+ */
+void BLEGateway::stop() {
+	if (!m_running) {
+		return;
+	}
+	m_running = false;
+	xSemaphoreGive(m_wakeup);
+	xSemaphoreTake(m_pTask->m_stopped, portMAX_DELAY);
+} // stop
+#endif
+
+
+/**
+ * @brief The filter: decide whether to forward an advertisement, and count it if not.
+ */
+bool BLEGateway::accept(const BLEGatewayAdvertisement& adv) {
+	uint64_t key = toKey(adv.address);
+	if (m_allowed.size() > 0 && m_allowed.get(key) == nullptr) {
+		m_counters.notAllowed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if (adv.rssi < m_config.minRSSI) {
+		m_counters.weak.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	uint32_t hash = 2166136261u;   // FNV-1a
+	for (size_t i = 0; i < adv.length; i++) {
+		hash = (hash ^ adv.payload[i]) * 16777619u;
+	}
+
+	Seen* pSeen = m_seen.get(key);
+	if (pSeen != nullptr) {
+		uint32_t since = adv.time - pSeen->forwarded;
+		if (pSeen->payloadHash == hash && (m_config.refreshMs == 0 || since < m_config.refreshMs)) {
+			m_counters.duplicates.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (since < m_config.minIntervalMs) {
+			m_counters.throttled.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		pSeen->forwarded   = adv.time;
+		pSeen->payloadHash = hash;
+		return true;
+	}
+
+	if (m_seen.size() >= MAX_DEVICES) {
+		// First forget the devices that would pass the filter whether they were remembered or
+		// not.  If that is not enough, forget those not forwarded for minIntervalMs too: they may
+		// be forwarded again sooner than refreshMs allows, but never sooner than minIntervalMs.
+		uint32_t refreshMs = m_config.refreshMs != 0 ? m_config.refreshMs : UINT32_MAX;
+		expire(adv.time, refreshMs > m_config.minIntervalMs ? refreshMs : m_config.minIntervalMs);
+		if (m_seen.size() >= MAX_DEVICES) {
+			expire(adv.time, m_config.minIntervalMs);
+		}
+	}
+	Seen seen;
+	seen.forwarded   = adv.time;
+	seen.payloadHash = hash;
+	if (m_seen.size() >= MAX_DEVICES || !m_seen.set(key, seen)) {
+		m_counters.untracked.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+} // accept
+
+
+/**
+ * @brief The encoder: add a record to the batch, sending the batch first if the record might
+ * not fit, and after if the batch has as many records as it may.
+ */
+void BLEGateway::encode(const BLEGatewayAdvertisement& adv) {
+	bool   json = m_config.format == FORMAT_JSON;
+	size_t room = json ? JSON_RECORD_SIZE + 1 : BINARY_RECORD_SIZE;   // For JSON, also the closing bracket.
+	if (m_batchLength + room > m_config.maxBatchBytes) {
+		send();
+	}
+	if (m_batchCount == 0) {
+		m_batchFirstMs = adv.time;
+		if (json) {
+			m_batch[0]    = '[';
+			m_batchLength = 1;
+		} else {
+			m_batchLength = BINARY_HEADER_SIZE;
+		}
+	} else if (json) {
+		m_batch[m_batchLength++] = ',';
+	}
+	m_batchLength += json ? encodeJSON(adv, m_batch + m_batchLength) : encodeBinary(adv, m_batch + m_batchLength);
+	m_batchCount++;
+	m_counters.encoded.fetch_add(1, std::memory_order_relaxed);
+	m_counters.batchRecords.store(m_batchCount, std::memory_order_relaxed);
+	m_counters.batchBytes.store(m_batchLength, std::memory_order_relaxed);
+	if (m_batchCount >= m_config.maxBatchRecords) {
+		send();
+	}
+} // encode
+
+
+/**
+ * @brief Encode a binary record.
+ * @return The length of the record.
+ */
+size_t BLEGateway::encodeBinary(const BLEGatewayAdvertisement& adv, uint8_t* p) {
+	::memcpy(p, adv.address, 6);
+	p[6]  = (uint8_t)adv.rssi;
+	p[7]  = adv.length;
+	p[8]  = adv.time & 0xff;
+	p[9]  = (adv.time >> 8) & 0xff;
+	p[10] = (adv.time >> 16) & 0xff;
+	p[11] = adv.time >> 24;
+	::memcpy(p + 12, adv.payload, adv.length);
+	return 12 + adv.length;
+} // encodeBinary
+
+
+/**
+ * @brief Encode a JSON record.
+ * @return The length of the record.
+ */
+size_t BLEGateway::encodeJSON(const BLEGatewayAdvertisement& adv, uint8_t* p) {
+	static const char hex[] = "0123456789abcdef";
+	char* pText = (char*)p;
+	pText += ::sprintf(pText, "{\"addr\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"rssi\":%d,\"time\":%u,\"data\":\"",
+		adv.address[0], adv.address[1], adv.address[2], adv.address[3], adv.address[4], adv.address[5],
+		adv.rssi, (unsigned)adv.time);
+	for (size_t i = 0; i < adv.length; i++) {
+		*pText++ = hex[adv.payload[i] >> 4];
+		*pText++ = hex[adv.payload[i] & 0xf];
+	}
+	*pText++ = '"';
+	*pText++ = '}';
+	return pText - (char*)p;
+} // encodeJSON
+
+
+/**
+ * @brief Forget the devices not forwarded for a while, to make room in the filter.
+ * @param [in] now The time in ms.
+ * @param [in] keepMs Forget the devices not forwarded for this long.
+ */
+void BLEGateway::expire(uint32_t now, uint32_t keepMs) {
+	// The map cannot be changed while it is walked, so remove the stale devices a few at a time.
+	uint64_t stale[16];
+	size_t   count;
+	do {
+		count = 0;
+		for (auto& entry: m_seen) {
+			if (now - entry.value.forwarded >= keepMs) {
+				stale[count++] = entry.key;
+				if (count == sizeof(stale) / sizeof(stale[0])) {
+					break;
+				}
+			}
+		}
+		for (size_t i = 0; i < count; i++) {
+			m_seen.remove(stale[i]);
+		}
+	} while (count == sizeof(stale) / sizeof(stale[0]));
+} // expire
+
+
+/**
+ * @brief Complete the batch and hand it to the sink.
+ */
+void BLEGateway::send() {
+	if (m_batchCount == 0) {
+		return;
+	}
+	if (m_config.format == FORMAT_JSON) {
+		m_batch[m_batchLength++] = ']';
+	} else {
+		m_batch[0] = m_batchCount & 0xff;
+		m_batch[1] = m_batchCount >> 8;
+		m_batch[2] = m_batchFirstMs & 0xff;
+		m_batch[3] = (m_batchFirstMs >> 8) & 0xff;
+		m_batch[4] = (m_batchFirstMs >> 16) & 0xff;
+		m_batch[5] = m_batchFirstMs >> 24;
+	}
+	if (m_sink(m_batch, m_batchLength)) {
+		m_counters.batches.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		m_counters.sinkFailures.fetch_add(1, std::memory_order_relaxed);
+		m_counters.sinkDrops.fetch_add(m_batchCount, std::memory_order_relaxed);
+	}
+	m_batchCount  = 0;
+	m_batchLength = 0;
+	m_counters.batchRecords.store(0, std::memory_order_relaxed);
+	m_counters.batchBytes.store(0, std::memory_order_relaxed);
+} // send
+
+
+uint64_t BLEGateway::toKey(const uint8_t* address) {
+	uint64_t key = 0;
+	for (int i = 0; i < 6; i++) {
+		key = (key << 8) | address[i];
+	}
+	return key;
+} // toKey
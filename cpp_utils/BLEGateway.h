@@ -0,0 +1,211 @@
+/*
+ * BLEGateway.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEGATEWAY_H_
+#define COMPONENTS_CPP_UTILS_BLEGATEWAY_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include "FixedHashMap.h"
+#include "SPSCQueue.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#endif
+
+class BLEGatewayTask;
+
+/**
+ * @brief One advertisement as it waits in the queue of a BLEGateway.
+ */
+typedef struct {
+	uint32_t time;          // When it was heard, in ms.
+	uint8_t  address[6];
+	int8_t   rssi;
+	uint8_t  length;        // The used length of the payload.
+	uint8_t  payload[62];   // The advertising data and the scan response.
+} BLEGatewayAdvertisement;
+
+
+/**
+ * @brief Forward the advertisements heard by a scan to a server, in batches.
+ *
+ * A beacon gateway hears hundreds of advertisements a second, most of them repeats.  The
+ * gateway passes them through four stages:
+ *
+ * 1. **Queue.**  onAdvertisement() is called from the GAP event handler.  It copies the
+ *    advertisement into a lock-free single producer, single consumer queue and returns; it never
+ *    waits.  If the queue is full the advertisement is dropped and counted.
+ * 2. **Filter.**  process() takes each advertisement from the queue and drops it if its address
+ *    is not on the allowlist (when there is one), if it is weaker than the RSSI threshold, or if
+ *    the device was forwarded too recently.  A device is forwarded when its payload changes, but
+ *    no more often than minIntervalMs, and again every refreshMs while it keeps advertising the
+ *    same payload.
+ * 3. **Encoder.**  The advertisements that pass are encoded into a batch, as JSON or binary.
+ * 4. **Sink.**  A batch is handed to the sink when it reaches the byte or record limit, or when
+ *    its first record has waited maxBatchAgeMs.  The sink is any function that sends the batch
+ *    on, such as an MQTT or AWS publish or an HTTP post.
+ *
+ * A sink that is slow backs the queue up, and the drops are counted there, so the producer is
+ * never held up by the network.  Every stage counts what it drops, and getStats() also reports
+ * how deep the queue and the current batch are.
+ *
+ * A JSON batch is an array of objects:
+ *
+ *   [{"addr":"c0:00:01:12:34:56","rssi":-61,"time":1234,"data":"0201060303..."},...]
+ *
+ * A binary batch is a 6 byte header and then the records, all integers little endian:
+ *
+ * | count (uint16) | time of the first record (uint32) | records ... |
+ *
+ * where each record is:
+ *
+ * | address (6) | rssi (int8) | length (uint8) | time (uint32) | payload (length) |
+ *
+ * On the ESP32, start() runs process() on a task of its own:
+ *
+ * @code{.cpp}
+ * AWS aws;
+ * BLEGateway gateway([&aws](const uint8_t* data, size_t length) {
+ * 	return aws.publish("gateway/adv", std::string((const char*)data, length)) == 0;
+ * });
+ * BLE::setGateway(&gateway);
+ * gateway.start();
+ * BLE::scan(0);
+ * @endcode
+ *
+ * Elsewhere, call process() from a loop, passing the time.
+ */
+class BLEGateway {
+public:
+	static const size_t PAYLOAD_SIZE = sizeof(((BLEGatewayAdvertisement*)0)->payload);
+	static const size_t QUEUE_SIZE   = 64;    // Advertisements waiting for the filter.
+	static const size_t MAX_DEVICES  = 384;   // Devices the filter remembers.
+	static const size_t MAX_ALLOWED  = 96;    // Addresses the allowlist can hold.
+
+	/**
+	 * @brief The encoding of a batch.
+	 */
+	typedef enum {
+		FORMAT_JSON,   //!< A JSON array of objects.
+		FORMAT_BINARY  //!< Records behind a 6 byte header.
+	} format_t;
+
+	/**
+	 * @brief What the filter passes and how the batches are made.
+	 */
+	typedef struct {
+		int      minRSSI;           //!< Drop advertisements weaker than this, in dBm.
+		uint32_t minIntervalMs;     //!< Forward a device no more often than this.
+		uint32_t refreshMs;         //!< Forward an unchanged payload again after this long, or never if 0.
+		format_t format;            //!< The encoding of the batches.
+		uint32_t maxBatchBytes;     //!< Largest batch.
+		uint32_t maxBatchRecords;   //!< Most records in one batch.
+		uint32_t maxBatchAgeMs;     //!< Longest time the first record of a batch may wait.
+	} config_t;
+
+	/**
+	 * @brief What each stage has done since the gateway was made.
+	 */
+	typedef struct {
+		uint32_t received;         //!< Advertisements passed to onAdvertisement().
+		uint32_t queueDrops;       //!< Dropped because the queue was full.
+		uint32_t queueDepth;       //!< Waiting in the queue now.
+		uint32_t queueHighWater;   //!< The most that have waited in the queue.
+		uint32_t notAllowed;       //!< Dropped because the address is not on the allowlist.
+		uint32_t weak;             //!< Dropped because the RSSI was below minRSSI.
+		uint32_t duplicates;       //!< Dropped because the payload was unchanged.
+		uint32_t throttled;        //!< Dropped because the device was forwarded less than minIntervalMs ago.
+		uint32_t untracked;        //!< Forwarded without being remembered, because the filter was full.
+		uint32_t encoded;          //!< Encoded into a batch.
+		uint32_t batchRecords;     //!< Records in the batch being made now.
+		uint32_t batchBytes;       //!< Bytes in the batch being made now.
+		uint32_t batches;          //!< Batches the sink accepted.
+		uint32_t sinkFailures;     //!< Batches the sink refused.
+		uint32_t sinkDrops;        //!< Records in the batches the sink refused.
+	} stats_t;
+
+	/**
+	 * @brief Sends a batch on.  Called on the task that calls process().
+	 * @return False if the batch could not be sent.  It is dropped either way.
+	 */
+	typedef std::function<bool(const uint8_t* data, size_t length)> sink_t;
+
+	static const config_t DEFAULT_CONFIG;
+
+	BLEGateway(sink_t sink, config_t config = DEFAULT_CONFIG);
+	virtual ~BLEGateway();
+	bool     allow(const uint8_t* address);
+	void     flush();
+	stats_t  getStats();
+	bool     onAdvertisement(const uint8_t* address, int rssi, const uint8_t* payload, size_t length, uint32_t now);
+	uint32_t process(uint32_t now);
+#ifdef ESP_PLATFORM
+	void     start(uint16_t stackSize = 4096);
+	void     stop();
+#endif
+
+private:
+	friend class BLEGatewayTask;
+
+	/**
+	 * @brief What the filter remembers of a device: when it was last forwarded, and what.
+	 */
+	struct Seen {
+		uint32_t forwarded;
+		uint32_t payloadHash;
+	};
+
+	/**
+	 * @brief The counters.  The producer writes the first three, process() the rest.
+	 */
+	struct Counters {
+		std::atomic<uint32_t> received{0};
+		std::atomic<uint32_t> queueDrops{0};
+		std::atomic<uint32_t> queueHighWater{0};
+		std::atomic<uint32_t> notAllowed{0};
+		std::atomic<uint32_t> weak{0};
+		std::atomic<uint32_t> duplicates{0};
+		std::atomic<uint32_t> throttled{0};
+		std::atomic<uint32_t> untracked{0};
+		std::atomic<uint32_t> encoded{0};
+		std::atomic<uint32_t> batchRecords{0};
+		std::atomic<uint32_t> batchBytes{0};
+		std::atomic<uint32_t> batches{0};
+		std::atomic<uint32_t> sinkFailures{0};
+		std::atomic<uint32_t> sinkDrops{0};
+	};
+
+	bool   accept(const BLEGatewayAdvertisement& adv);
+	void   encode(const BLEGatewayAdvertisement& adv);
+	size_t encodeBinary(const BLEGatewayAdvertisement& adv, uint8_t* p);
+	size_t encodeJSON(const BLEGatewayAdvertisement& adv, uint8_t* p);
+	void   expire(uint32_t now, uint32_t keepMs);
+	void   send();
+
+	static uint64_t toKey(const uint8_t* address);
+
+	sink_t                                          m_sink;
+	config_t                                        m_config;
+	SPSCQueue<BLEGatewayAdvertisement, QUEUE_SIZE>  m_queue;
+	FixedHashMap<uint64_t, Seen, 512>               m_seen;      // Address to when it was forwarded.
+	FixedHashMap<uint64_t, bool, 128>               m_allowed;   // Empty to allow every address.
+	uint8_t*                                        m_batch;
+	uint32_t                                        m_batchLength;
+	uint32_t                                        m_batchCount;
+	uint32_t                                        m_batchFirstMs;
+	Counters                                        m_counters;
+	std::atomic<bool>                               m_flushRequested;
+#ifdef ESP_PLATFORM
+	SemaphoreHandle_t                               m_wakeup;
+	BLEGatewayTask*                                 m_pTask;
+	bool                                            m_running;
+#endif
+}; // BLEGateway
+
+#endif /* COMPONENTS_CPP_UTILS_BLEGATEWAY_H_ */
@@ -0,0 +1,204 @@
+/*
+ * BLEGattClientESP.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string.h>
+#include <esp_log.h>
+#include "BLE.h"
+#include "BLEGattClientESP.h"
+
+static const char* LOG_TAG = "BLEGattClientESP";
+
+
+static BLEAttributeId fromGattId(const esp_gatt_id_t& gattId) {
+	BLEAttributeId id;
+	::memset(&id, 0, sizeof(id));
+	id.length = gattId.uuid.len;
+	::memcpy(id.uuid, gattId.uuid.uuid.uuid128, gattId.uuid.len <= 16 ? gattId.uuid.len : 16);
+	id.instId = gattId.inst_id;
+	return id;
+} // fromGattId
+
+
+static esp_gatt_id_t toGattId(const BLEAttributeId& id) {
+	esp_gatt_id_t gattId;
+	::memset(&gattId, 0, sizeof(gattId));
+	gattId.uuid.len = id.length;
+	::memcpy(gattId.uuid.uuid.uuid128, id.uuid, id.length);
+	gattId.inst_id = id.instId;
+	return gattId;
+} // toGattId
+
+
+static esp_gatt_srvc_id_t toServiceId(const BLEAttributeDatabase::Service& service) {
+	esp_gatt_srvc_id_t srvcId;
+	srvcId.id         = toGattId(service.id);
+	srvcId.is_primary = service.primary;
+	return srvcId;
+} // toServiceId
+
+
+/**
+ * @brief The status of an answer to a search for characteristics or descriptors, for the manager.
+ *
+ * The stack ends a list with ESP_GATT_ERROR, which the manager knows as STATUS_NOT_FOUND.
+ */
+static int toListStatus(esp_gatt_status_t status) {
+	return status == ESP_GATT_ERROR || status == ESP_GATT_NOT_FOUND ? BLEClientManager::STATUS_NOT_FOUND : status;
+} // toListStatus
+
+
+/**
+ * @brief Create a client.
+ * @param [in] pStore Where to keep the databases of peers, or nullptr to discover them on every connection.
+ */
+BLEGattClientESP::BLEGattClientESP(BLEAttributeStore* pStore): m_manager(this, pStore) {
+} // BLEGattClientESP
+
+
+BLEClientManager* BLEGattClientESP::getManager() {
+	return &m_manager;
+} // getManager
+
+
+/**
+ * @brief Pass a GATT client event to the manager.
+ */
+void BLEGattClientESP::handleGATTClientEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+		esp_ble_gattc_cb_param_t* param) {
+	switch(event) {
+		case ESP_GATTC_OPEN_EVT: {
+			m_manager.onOpen(param->open.remote_bda, param->open.conn_id, param->open.status);
+			break;
+		}
+
+		case ESP_GATTC_CLOSE_EVT: {
+			m_manager.onClose(param->close.conn_id);
+			break;
+		}
+
+		// The stack takes the peer's Service Changed indication itself and reports it here.
+		case ESP_GATTC_SRVC_CHG_EVT: {
+			m_manager.onServiceChanged(param->srvc_chg.remote_bda);
+			break;
+		}
+
+		case ESP_GATTC_SEARCH_RES_EVT: {
+			m_manager.onService(param->search_res.conn_id, fromGattId(param->search_res.srvc_id.id),
+				param->search_res.srvc_id.is_primary);
+			break;
+		}
+
+		case ESP_GATTC_SEARCH_CMPL_EVT: {
+			m_manager.onSearchComplete(param->search_cmpl.conn_id, param->search_cmpl.status);
+			break;
+		}
+
+		case ESP_GATTC_GET_CHAR_EVT: {
+			m_manager.onCharacteristic(param->get_char.conn_id, toListStatus(param->get_char.status),
+				fromGattId(param->get_char.srvc_id.id), fromGattId(param->get_char.char_id),
+				param->get_char.char_prop);
+			break;
+		}
+
+		case ESP_GATTC_GET_DESCR_EVT: {
+			m_manager.onDescriptor(param->get_descr.conn_id, toListStatus(param->get_descr.status),
+				fromGattId(param->get_descr.srvc_id.id), fromGattId(param->get_descr.char_id),
+				fromGattId(param->get_descr.descr_id));
+			break;
+		}
+
+		case ESP_GATTC_READ_CHAR_EVT: {
+			m_manager.onRead(param->read.conn_id, param->read.status, param->read.value, param->read.value_len);
+			break;
+		}
+
+		case ESP_GATTC_WRITE_CHAR_EVT: {
+			m_manager.onWrite(param->write.conn_id, param->write.status);
+			break;
+		}
+
+		default:
+			break;
+	}
+} // handleGATTClientEvent
+
+
+bool BLEGattClientESP::close(uint16_t connId) {
+	return ::esp_ble_gattc_close(BLE::getGattcIF(), connId) == ESP_OK;
+} // close
+
+
+bool BLEGattClientESP::getCharacteristic(uint16_t connId, const BLEAttributeDatabase::Service& service,
+		const BLEAttributeId* pAfter) {
+	esp_gatt_srvc_id_t srvcId = toServiceId(service);
+	esp_gatt_id_t after;
+	if (pAfter != nullptr) {
+		after = toGattId(*pAfter);
+	}
+	esp_err_t errRc = ::esp_ble_gattc_get_characteristic(BLE::getGattcIF(), connId, &srvcId,
+		pAfter != nullptr ? &after : nullptr);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_characteristic: rc=%d", errRc);
+		return false;
+	}
+	return true;
+} // getCharacteristic
+
+
+bool BLEGattClientESP::getDescriptor(uint16_t connId, const BLEAttributeDatabase::Service& service,
+		const BLEAttributeId& characteristic, const BLEAttributeId* pAfter) {
+	esp_gatt_srvc_id_t srvcId = toServiceId(service);
+	esp_gatt_id_t charId = toGattId(characteristic);
+	esp_gatt_id_t after;
+	if (pAfter != nullptr) {
+		after = toGattId(*pAfter);
+	}
+	esp_err_t errRc = ::esp_ble_gattc_get_descriptor(BLE::getGattcIF(), connId, &srvcId, &charId,
+		pAfter != nullptr ? &after : nullptr);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_descriptor: rc=%d", errRc);
+		return false;
+	}
+	return true;
+} // getDescriptor
+
+
+bool BLEGattClientESP::open(const uint8_t* address) {
+	esp_bd_addr_t bda;
+	::memcpy(bda, address, sizeof(bda));
+	esp_err_t errRc = ::esp_ble_gattc_open(BLE::getGattcIF(), bda, true);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_open: rc=%d", errRc);
+		return false;
+	}
+	return true;
+} // open
+
+
+bool BLEGattClientESP::read(uint16_t connId, const BLEAttributeDatabase::Service& service,
+		const BLEAttributeId& characteristic) {
+	esp_gatt_srvc_id_t srvcId = toServiceId(service);
+	esp_gatt_id_t charId = toGattId(characteristic);
+	return ::esp_ble_gattc_read_char(BLE::getGattcIF(), connId, &srvcId, &charId, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+} // read
+
+
+bool BLEGattClientESP::searchServices(uint16_t connId) {
+	return ::esp_ble_gattc_search_service(BLE::getGattcIF(), connId, nullptr) == ESP_OK;
+} // searchServices
+
+
+bool BLEGattClientESP::write(uint16_t connId, const BLEAttributeDatabase::Service& service,
+		const BLEAttributeId& characteristic, const uint8_t* data, size_t length, bool response) {
+	esp_gatt_srvc_id_t srvcId = toServiceId(service);
+	esp_gatt_id_t charId = toGattId(characteristic);
+	return ::esp_ble_gattc_write_char(BLE::getGattcIF(), connId, &srvcId, &charId, length, (uint8_t*)data,
+		response ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+} // write
+
+#endif // CONFIG_BT_ENABLED
@@ -0,0 +1,49 @@
+/*
+ * BLEGattClientESP.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEGATTCLIENTESP_H_
+#define COMPONENTS_CPP_UTILS_BLEGATTCLIENTESP_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gattc_api.h>
+#include "BLEClientManager.h"
+
+/**
+ * @brief Run a BLEClientManager over the ESP-IDF GATT client.
+ *
+ * Register it with BLE::setGattClient() and the GATT client events are passed to it instead of
+ * to the BLEDevice handling.
+ *
+ * The stack finds characteristics and descriptors by id in a database of its own, which it
+ * fills by searching the peer for services.  When the manager loads a saved database it does
+ * not ask the stack to search, so for reads and writes to work straight away the stack should
+ * keep its own cache too (CONFIG_BT_GATTC_CACHE where the stack has it).
+ */
+class BLEGattClientESP: public BLEGattClientTransport {
+public:
+	BLEGattClientESP(BLEAttributeStore* pStore = nullptr);
+	BLEClientManager* getManager();
+	void handleGATTClientEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* param);
+
+	bool close(uint16_t connId) override;
+	bool getCharacteristic(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId* pAfter) override;
+	bool getDescriptor(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const BLEAttributeId* pAfter) override;
+	bool open(const uint8_t* address) override;
+	bool read(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic) override;
+	bool searchServices(uint16_t connId) override;
+	bool write(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const uint8_t* data, size_t length, bool response) override;
+
+private:
+	BLEClientManager m_manager;
+}; // BLEGattClientESP
+
+#endif // CONFIG_BT_ENABLED
+#endif /* COMPONENTS_CPP_UTILS_BLEGATTCLIENTESP_H_ */
@@ -0,0 +1,107 @@
+/*
+ * BLEHandleTable.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEHANDLETABLE_H_
+#define COMPONENTS_CPP_UTILS_BLEHANDLETABLE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "SmallVector.h"
+
+class BLECharacteristic;
+class BLEDescriptor;
+
+/**
+ * @brief The attributes of a GATT server, indexed by their handles.
+ *
+ * A BLEServer adds each characteristic and descriptor as the BLE stack assigns its handle, and
+ * then sends a read or write straight to the attribute that owns the handle, instead of offering
+ * it to every service, characteristic and descriptor in turn.
+ *
+ * The entries are kept sorted by handle in a flat array and found by binary search.  The stack
+ * assigns handles in increasing order, so adding an attribute is almost always an append.
+ */
+class BLEHandleTable {
+public:
+	/**
+	 * @brief The attribute that owns a handle: exactly one of the pointers is set.
+	 */
+	struct Entry {
+		uint16_t           handle;
+		BLECharacteristic* pCharacteristic;
+		BLEDescriptor*     pDescriptor;
+	};
+
+	/**
+	 * @brief Find the attribute that owns a handle.
+	 *
+	 * @param [in] handle The handle of the attribute.
+	 * @return The entry of the attribute, or nullptr if no attribute has the handle.
+	 */
+	const Entry* find(uint16_t handle) const {
+		size_t low  = 0;
+		size_t high = m_entries.size();
+		while (low < high) {
+			size_t middle = (low + high) / 2;
+			if (m_entries[middle].handle < handle) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		if (low < m_entries.size() && m_entries[low].handle == handle) {
+			return &m_entries[low];
+		}
+		return nullptr;
+	} // find
+
+	/**
+	 * @brief Record that a characteristic owns a handle.
+	 * @return False if the memory for the entry could not be allocated.
+	 */
+	bool setCharacteristic(uint16_t handle, BLECharacteristic* pCharacteristic) {
+		Entry entry = { handle, pCharacteristic, nullptr };
+		return set(entry);
+	} // setCharacteristic
+
+	/**
+	 * @brief Record that a descriptor owns a handle.
+	 * @return False if the memory for the entry could not be allocated.
+	 */
+	bool setDescriptor(uint16_t handle, BLEDescriptor* pDescriptor) {
+		Entry entry = { handle, nullptr, pDescriptor };
+		return set(entry);
+	} // setDescriptor
+
+	size_t size() const {
+		return m_entries.size();
+	}
+
+private:
+	bool set(const Entry& entry) {
+		// Find where the entry goes, starting from the end where new handles usually go.
+		size_t index = m_entries.size();
+		while (index > 0 && m_entries[index - 1].handle > entry.handle) {
+			index--;
+		}
+		if (index > 0 && m_entries[index - 1].handle == entry.handle) {
+			m_entries[index - 1] = entry;
+			return true;
+		}
+		if (!m_entries.pushBack(entry)) {
+			return false;
+		}
+		for (size_t i = m_entries.size() - 1; i > index; i--) {
+			m_entries[i] = m_entries[i - 1];
+		}
+		m_entries[index] = entry;
+		return true;
+	} // set
+
+	SmallVector<Entry, 16> m_entries;   // Sorted by handle.
+}; // BLEHandleTable
+
+#endif /* COMPONENTS_CPP_UTILS_BLEHANDLETABLE_H_ */
@@ -0,0 +1,389 @@
+/*
+ * BLENotificationScheduler.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_gatts_api.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "Task.h"
+#include "BLENotificationScheduler.h"
+#include "BLEServer.h"
+#include "BLEService.h"
+
+static const char* LOG_TAG = "BLENotificationScheduler";
+
+
+/**
+ * @brief The task that sends the waiting values, one connection event at a time.
+ */
+class BLENotificationSchedulerTask: public Task {
+public:
+	BLENotificationSchedulerTask(BLENotificationScheduler* pScheduler, uint16_t stackSize): Task("BLENotificationSchedulerTask", stackSize) {
+		m_pScheduler = pScheduler;
+		m_stopped    = xSemaphoreCreateBinary();
+	}
+
+	~BLENotificationSchedulerTask() {
+		vSemaphoreDelete(m_stopped);
+	}
+
+	void run(void* data) {
+		TickType_t lastWake = xTaskGetTickCount();
+		while (m_pScheduler->m_running) {
+			if (m_pScheduler->sendEvent(FreeRTOS::getTimeSinceStart())) {
+				// Values are left: send the next ones at the next connection event, however many
+				// more are notified meanwhile.
+				// Rounded up, so we never wake before the connection event.
+				TickType_t interval = (m_pScheduler->m_intervalMs + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+				vTaskDelayUntil(&lastWake, interval > 0 ? interval : 1);
+				xSemaphoreTake(m_pScheduler->m_wakeup, 0);
+			} else {
+				xSemaphoreTake(m_pScheduler->m_wakeup, portMAX_DELAY);
+				lastWake = xTaskGetTickCount();
+			}
+		}
+		xSemaphoreGive(m_stopped);
+	} // run
+
+	SemaphoreHandle_t m_stopped;
+
+private:
+	BLENotificationScheduler* m_pScheduler;
+};
+
+
+/**
+ * @brief Create a scheduler.
+ * @param [in] pServer The server whose characteristics are notified.
+ * @param [in] stackSize The stack size of the task that sends the notifications.
+ */
+BLENotificationScheduler::BLENotificationScheduler(BLEServer* pServer, uint16_t stackSize) {
+	m_pServer         = pServer;
+	m_maxLength       = 0;
+	m_scratch         = nullptr;
+	m_intervalMs      = 30;
+	m_packetsPerEvent = 4;
+	m_lock            = portMUX_INITIALIZER_UNLOCKED;
+	m_wakeup          = xSemaphoreCreateBinary();
+	m_pTask           = new BLENotificationSchedulerTask(this, stackSize);
+	m_running         = false;
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		m_clients[i].inUse    = false;
+		m_clients[i].pPending = nullptr;
+	}
+	resetStats();
+} // BLENotificationScheduler
+
+
+BLENotificationScheduler::~BLENotificationScheduler() {
+	stop();
+	delete m_pTask;
+	vSemaphoreDelete(m_wakeup);
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		if (m_clients[i].pPending != nullptr) {
+			m_clients[i].queue.clear();
+			for (size_t c = 0; c < m_characteristics.size(); c++) {
+				delete[] m_clients[i].pPending[c].data;
+			}
+			delete[] m_clients[i].pPending;
+		}
+	}
+	delete[] m_scratch;
+} // ~BLENotificationScheduler
+
+
+/**
+ * @brief Add a characteristic to be notified through the scheduler.
+ *
+ * Characteristics must be added before start() is called.  A value that is longer than the
+ * MTU of a connection allows is cut short when it is sent.
+ *
+ * @param [in] pCharacteristic The characteristic.
+ * @param [in] maxLength The longest value that will be notified.
+ * @return The handle to pass to notify().
+ */
+int BLENotificationScheduler::addCharacteristic(BLECharacteristic* pCharacteristic, uint16_t maxLength) {
+	m_characteristics.push_back(pCharacteristic);
+	m_maxLengths.push_back(maxLength);
+	if (maxLength > m_maxLength) {
+		m_maxLength = maxLength;
+	}
+	return m_characteristics.size() - 1;
+} // addCharacteristic
+
+
+/**
+ * @brief Get the statistics.
+ */
+BLENotificationScheduler::stats_t BLENotificationScheduler::getStats() {
+	portENTER_CRITICAL(&m_lock);
+	stats_t stats = m_stats;
+	stats.latencyAverage = stats.sent > 0 ? m_latencyTotal / stats.sent : 0;
+	portEXIT_CRITICAL(&m_lock);
+	return stats;
+} // getStats
+
+
+/**
+ * @brief Set the value of a characteristic to notify on a connection.
+ *
+ * This may be called from any task.  It copies the value and returns without waiting.
+ *
+ * @param [in] characteristic The handle returned by addCharacteristic().
+ * @param [in] connId The connection to notify.
+ * @param [in] data The value.
+ * @param [in] length The length of the value.
+ * @return False if the scheduler is not running, the value is too long, or the connection is unknown or one too many.
+ */
+bool BLENotificationScheduler::notify(int characteristic, uint16_t connId, const uint8_t* data, size_t length) {
+	if (!m_running || characteristic < 0 || characteristic >= (int)m_characteristics.size()) {
+		return false;
+	}
+	if (length > m_maxLengths[characteristic]) {
+		ESP_LOGE(LOG_TAG, "notify: %d bytes, expected at most %d", (int)length, m_maxLengths[characteristic]);
+		return false;
+	}
+	if (m_pServer->getMTU(connId) == 0) {
+		return false;
+	}
+	uint32_t now  = FreeRTOS::getTimeSinceStart();
+	bool     wake = false;
+
+	portENTER_CRITICAL(&m_lock);
+	Client* pClient = getClient(connId);
+	if (pClient == nullptr) {
+		portEXIT_CRITICAL(&m_lock);
+		return false;
+	}
+	Pending* pPending = &pClient->pPending[characteristic];
+	::memcpy(pPending->data, data, length);
+	pPending->length = length;
+	if (pPending->queued) {
+		m_stats.coalesced++;
+	} else {
+		pPending->queued  = true;
+		pPending->sinceMs = now;
+		wake = pClient->queue.isEmpty();
+		pClient->queue.pushBack(pPending);
+	}
+	m_stats.notified++;
+	portEXIT_CRITICAL(&m_lock);
+
+	if (wake) {
+		xSemaphoreGive(m_wakeup);
+	}
+	return true;
+} // notify
+
+
+/**
+ * @brief Set the value of a characteristic to notify on every connection.
+ * @param [in] characteristic The handle returned by addCharacteristic().
+ * @param [in] data The value.
+ * @param [in] length The length of the value.
+ */
+void BLENotificationScheduler::notifyAll(int characteristic, const uint8_t* data, size_t length) {
+	uint16_t connIds[MAX_CONNECTIONS];
+	size_t count = m_pServer->getConnections(connIds, MAX_CONNECTIONS);
+	for (size_t i = 0; i < count; i++) {
+		notify(characteristic, connIds[i], data, length);
+	}
+} // notifyAll
+
+
+void BLENotificationScheduler::resetStats() {
+	portENTER_CRITICAL(&m_lock);
+	::memset(&m_stats, 0, sizeof(m_stats));
+	m_latencyTotal  = 0;
+	m_windowStartMs = FreeRTOS::getTimeSinceStart();
+	m_windowBytes   = 0;
+	portEXIT_CRITICAL(&m_lock);
+} // resetStats
+
+
+/**
+ * @brief Describe the connection events of the link.
+ *
+ * How many packets fit in one event depends on the controller and the phone; 4 to 6 is usual.
+ *
+ * @param [in] intervalMs The connection interval.
+ * @param [in] packetsPerEvent The most notifications to send on a connection each interval.
+ */
+void BLENotificationScheduler::setConnectionEvent(uint16_t intervalMs, uint8_t packetsPerEvent) {
+	m_intervalMs      = intervalMs;
+	m_packetsPerEvent = packetsPerEvent > 0 ? packetsPerEvent : 1;
+} // setConnectionEvent
+
+
+/**
+ * @brief Allocate the values and start the task that sends them.
+ */
+void BLENotificationScheduler::start() {
+	if (m_running) {
+		return;
+	}
+	if (m_scratch == nullptr) {
+		m_scratch = new uint8_t[m_maxLength];
+		for (int i = 0; i < MAX_CONNECTIONS; i++) {
+			m_clients[i].pPending = new Pending[m_characteristics.size()];
+			for (size_t c = 0; c < m_characteristics.size(); c++) {
+				Pending* pPending = &m_clients[i].pPending[c];
+				pPending->data           = new uint8_t[m_maxLengths[c]];
+				pPending->length         = 0;
+				pPending->queued         = false;
+				pPending->sinceMs        = 0;
+				pPending->characteristic = c;
+			}
+		}
+	}
+	m_running = true;
+	m_pTask->start();
+} // start
+
+
+/**
+ * @brief Stop the task.  Values not yet sent are kept until it is started again.
+ */
+void BLENotificationScheduler::stop() {
+	if (!m_running) {
+		return;
+	}
+	m_running = false;
+	xSemaphoreGive(m_wakeup);
+	xSemaphoreTake(m_pTask->m_stopped, portMAX_DELAY);
+} // stop
+
+
+/**
+ * @brief Find the client of a connection, or take a free one for it.
+ *
+ * Must be called with m_lock held.
+ *
+ * @return The client, or nullptr if MAX_CONNECTIONS are already in use.
+ */
+BLENotificationScheduler::Client* BLENotificationScheduler::getClient(uint16_t connId) {
+	Client* pFree = nullptr;
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		if (m_clients[i].inUse && m_clients[i].connId == connId) {
+			return &m_clients[i];
+		}
+		if (!m_clients[i].inUse && pFree == nullptr) {
+			pFree = &m_clients[i];
+		}
+	}
+	if (pFree != nullptr) {
+		pFree->inUse  = true;
+		pFree->connId = connId;
+	}
+	return pFree;
+} // getClient
+
+
+/**
+ * @brief Send what one connection event can carry on each connection.  Runs on the scheduler's task.
+ * @param [in] now The time in ms.
+ * @return True if values are left to send.
+ */
+bool BLENotificationScheduler::sendEvent(uint32_t now) {
+	bool more = false;
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		Client* pClient = &m_clients[i];
+		// Another task may be claiming the slot for a new connection.
+		portENTER_CRITICAL(&m_lock);
+		bool     inUse  = pClient->inUse;
+		uint16_t connId = pClient->connId;
+		portEXIT_CRITICAL(&m_lock);
+		if (!inUse) {
+			continue;
+		}
+		uint16_t mtu = m_pServer->getMTU(connId);
+		if (mtu == 0) {
+			// The connection has closed: forget what was waiting for it.
+			portENTER_CRITICAL(&m_lock);
+			if (pClient->inUse && pClient->connId == connId) {
+				while (Pending* pPending = pClient->queue.popFront()) {
+					pPending->queued = false;
+				}
+				pClient->inUse = false;
+			}
+			portEXIT_CRITICAL(&m_lock);
+			continue;
+		}
+		if (m_pServer->isCongested(connId)) {
+			portENTER_CRITICAL(&m_lock);
+			m_stats.congested++;
+			more |= !pClient->queue.isEmpty();
+			portEXIT_CRITICAL(&m_lock);
+			continue;
+		}
+
+		for (uint8_t packet = 0; packet < m_packetsPerEvent; packet++) {
+			// Copy the value out, so that notify() can replace it while it is being sent.
+			portENTER_CRITICAL(&m_lock);
+			Pending* pPending = pClient->queue.popFront();
+			if (pPending == nullptr) {
+				portEXIT_CRITICAL(&m_lock);
+				break;
+			}
+			pPending->queued = false;
+			uint16_t length  = pPending->length;
+			uint32_t sinceMs = pPending->sinceMs;
+			::memcpy(m_scratch, pPending->data, length);
+			portEXIT_CRITICAL(&m_lock);
+
+			if (length > mtu - 3) {
+				length = mtu - 3;
+			}
+			BLECharacteristic* pCharacteristic = m_characteristics[pPending->characteristic];
+			esp_err_t errRc = ::esp_ble_gatts_send_indicate(
+					pCharacteristic->getService()->m_gatts_if,
+					connId,
+					pCharacteristic->getHandle(),
+					length,
+					m_scratch,
+					false); // A notification; no confirmation.
+
+			portENTER_CRITICAL(&m_lock);
+			if (errRc != ESP_OK) {
+				// The stack is full: put the value back, unless a newer one has been notified.
+				if (!pPending->queued) {
+					pPending->queued = true;
+					pClient->queue.pushFront(pPending);
+				}
+				portEXIT_CRITICAL(&m_lock);
+				break;
+			}
+			uint32_t latency = now - sinceMs;
+			m_stats.sent++;
+			m_stats.bytesSent += length;
+			m_latencyTotal    += latency;
+			if (latency > m_stats.latencyMax) {
+				m_stats.latencyMax = latency;
+			}
+			m_windowBytes += length;
+			portEXIT_CRITICAL(&m_lock);
+		}
+
+		portENTER_CRITICAL(&m_lock);
+		more |= !pClient->queue.isEmpty();
+		portEXIT_CRITICAL(&m_lock);
+	}
+
+	portENTER_CRITICAL(&m_lock);
+	if (now - m_windowStartMs >= 1000) {
+		m_stats.throughput = (uint64_t)m_windowBytes * 1000 / (now - m_windowStartMs);
+		m_windowStartMs    = now;
+		m_windowBytes      = 0;
+	}
+	portEXIT_CRITICAL(&m_lock);
+	return more;
+} // sendEvent
+
+#endif // CONFIG_BT_ENABLED
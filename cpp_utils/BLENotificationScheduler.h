@@ -0,0 +1,125 @@
+/*
+ * BLENotificationScheduler.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLENOTIFICATIONSCHEDULER_H_
+#define COMPONENTS_CPP_UTILS_BLENOTIFICATIONSCHEDULER_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "BLECharacteristic.h"
+#include "IntrusiveList.h"
+
+class BLEServer;
+class BLENotificationSchedulerTask;
+
+/**
+ * @brief Send the notifications of a server's characteristics at the pace of the link.
+ *
+ * notify() records the latest value of a characteristic for a connection and returns at once.
+ * Each connection has a queue of the characteristics with a value waiting; a characteristic
+ * notified again before its value was sent keeps its place in the queue and only its value is
+ * replaced, as only the latest value matters.
+ *
+ * The scheduler's task wakes once a connection interval and sends, for each connection that is
+ * not congested, at most the number of packets the controller can send in one connection event.
+ * Sending more than that only fills the controller's buffers and makes every later value wait;
+ * sending fewer leaves the link idle.  A sensor notifying faster than the link can carry loses
+ * intermediate values, never blocks, and the values sent are as fresh as the link allows.
+ *
+ * The stack does not report the connection interval, so tell the scheduler the one asked for
+ * with esp_ble_gap_update_conn_params().
+ *
+ * @code{.cpp}
+ * BLENotificationScheduler scheduler(pServer);
+ * int accel = scheduler.addCharacteristic(pAccelCharacteristic, 12);
+ * scheduler.setConnectionEvent(15, 4);   // A 15 ms interval, 4 packets an event.
+ * scheduler.start();
+ * ...
+ * scheduler.notifyAll(accel, reading, 12);   // At 500 Hz.
+ * @endcode
+ */
+class BLENotificationScheduler {
+public:
+	static const int MAX_CONNECTIONS = 4;
+
+	/**
+	 * @brief What the scheduler has done since it was started or its statistics were reset.
+	 */
+	typedef struct {
+		uint32_t notified;        //!< Values passed to notify().
+		uint32_t coalesced;       //!< Values replaced by a later one before they were sent.
+		uint32_t sent;            //!< Notifications sent.
+		uint32_t bytesSent;       //!< Bytes of value sent.
+		uint32_t congested;       //!< Connection events skipped because the connection was congested.
+		uint32_t throughput;      //!< Bytes of value sent a second, over the latest second of sending.
+		uint32_t latencyAverage;  //!< Average time in ms from a value waiting to it being sent.
+		uint32_t latencyMax;      //!< Longest such time in ms.
+	} stats_t;
+
+	BLENotificationScheduler(BLEServer* pServer, uint16_t stackSize = 4096);
+	virtual ~BLENotificationScheduler();
+	int     addCharacteristic(BLECharacteristic* pCharacteristic, uint16_t maxLength);
+	stats_t getStats();
+	bool    notify(int characteristic, uint16_t connId, const uint8_t* data, size_t length);
+	void    notifyAll(int characteristic, const uint8_t* data, size_t length);
+	void    resetStats();
+	void    setConnectionEvent(uint16_t intervalMs, uint8_t packetsPerEvent);
+	void    start();
+	void    stop();
+
+private:
+	friend class BLENotificationSchedulerTask;
+
+	/**
+	 * @brief The value of one characteristic waiting to be sent on one connection.
+	 */
+	struct Pending: public IntrusiveListHook<> {
+		uint8_t* data;
+		uint16_t length;
+		bool     queued;
+		uint32_t sinceMs;         // When the oldest unsent value was notified.
+		int      characteristic;
+	};
+
+	/**
+	 * @brief A connection notified on, with one Pending for each characteristic.
+	 */
+	struct Client {
+		uint16_t               connId;
+		bool                   inUse;
+		Pending*               pPending;
+		IntrusiveList<Pending> queue;    // The characteristics with a value to send, oldest first.
+	};
+
+	Client* getClient(uint16_t connId);
+	bool    sendEvent(uint32_t now);
+
+	BLEServer*                      m_pServer;
+	std::vector<BLECharacteristic*> m_characteristics;
+	std::vector<uint16_t>           m_maxLengths;
+	uint16_t                        m_maxLength;      // The longest of m_maxLengths.
+	uint8_t*                        m_scratch;        // A value copied out of the lock for sending.
+	Client                          m_clients[MAX_CONNECTIONS];
+	uint16_t                        m_intervalMs;
+	uint8_t                         m_packetsPerEvent;
+	portMUX_TYPE                    m_lock;
+	SemaphoreHandle_t               m_wakeup;
+	BLENotificationSchedulerTask*   m_pTask;
+	bool                            m_running;
+
+	stats_t                         m_stats;
+	uint32_t                        m_latencyTotal;
+	uint32_t                        m_windowStartMs;  // The second whose bytes are being counted.
+	uint32_t                        m_windowBytes;
+}; // BLENotificationScheduler
+
+#endif // CONFIG_BT_ENABLED
+#endif /* COMPONENTS_CPP_UTILS_BLENOTIFICATIONSCHEDULER_H_ */
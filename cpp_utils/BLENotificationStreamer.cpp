@@ -0,0 +1,118 @@
+/*
+ * BLENotificationStreamer.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_gatts_api.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "BLENotificationStreamer.h"
+#include "BLEServer.h"
+#include "BLEService.h"
+
+static char LOG_TAG[] = "BLENotificationStreamer";
+
+extern "C" {
+	char *espToString(esp_err_t value);
+}
+
+
+/**
+ * @brief Construct a streamer.
+ * @param [in] pCharacteristic The characteristic to notify.  Its service must be created by a BLEServer.
+ */
+BLENotificationStreamer::BLENotificationStreamer(BLECharacteristic *pCharacteristic) {
+	m_pCharacteristic = pCharacteristic;
+	m_bytesSent       = 0;
+	m_packetsSent     = 0;
+	m_stalls          = 0;
+} // BLENotificationStreamer
+
+
+uint32_t BLENotificationStreamer::getBytesSent() {
+	return m_bytesSent;
+} // getBytesSent
+
+
+uint32_t BLENotificationStreamer::getPacketsSent() {
+	return m_packetsSent;
+} // getPacketsSent
+
+
+uint32_t BLENotificationStreamer::getStalls() {
+	return m_stalls;
+} // getStalls
+
+
+/**
+ * @brief Send a buffer as notifications, waiting as the connection's flow control requires.
+ *
+ * The data is copied by the stack as each piece is sent, so it can be reused when this returns.
+ *
+ * @param [in] connId The connection to send on.
+ * @param [in] data The data to send.
+ * @param [in] length The length of the data.
+ * @param [in] timeoutMs The longest time to wait for the connection to drain, each time it is congested.
+ * @return True if all the data was handed to the stack, false if the connection closed or stayed congested.
+ */
+bool BLENotificationStreamer::send(uint16_t connId, const uint8_t *data, size_t length, uint32_t timeoutMs) {
+	BLEService *pService = m_pCharacteristic->getService();
+	if (pService == nullptr || pService->m_pServer == nullptr) {
+		ESP_LOGE(LOG_TAG, "The characteristic is not on a server");
+		return false;
+	}
+	BLEServer *pServer = pService->m_pServer;
+
+	size_t   offset  = 0;
+	uint32_t retries = 0;
+	while (offset < length) {
+		if (pServer->isCongested(connId)) {
+			m_stalls++;
+		}
+		if (!pServer->waitForFlow(connId, timeoutMs)) {
+			ESP_LOGE(LOG_TAG, "Stopped after %d of %d bytes: connection %d closed or congested", offset, length, connId);
+			return false;
+		}
+		// Read the MTU each time; the client may exchange it while we stream.  It is 0 once the
+		// connection has gone.
+		uint16_t mtu = pServer->getMTU(connId);
+		if (mtu <= 3) {
+			ESP_LOGE(LOG_TAG, "Stopped after %d of %d bytes: connection %d closed", offset, length, connId);
+			return false;
+		}
+		size_t chunk = mtu - 3;
+		if (chunk > length - offset) {
+			chunk = length - offset;
+		}
+		esp_err_t errRc = ::esp_ble_gatts_send_indicate(
+				pService->m_gatts_if,
+				connId,
+				m_pCharacteristic->getHandle(),
+				chunk,
+				(uint8_t *)data + offset,
+				false); // A notification; no confirmation.
+		if (errRc != ESP_OK) {
+			// The stack's queue is full: let it run, then try the same piece again.
+			if (++retries * portTICK_PERIOD_MS > timeoutMs) {
+				ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_indicate: rc=%d %s", errRc, espToString(errRc));
+				return false;
+			}
+			m_stalls++;
+			::vTaskDelay(1);
+			continue;
+		}
+		retries = 0;
+		offset += chunk;
+		m_bytesSent += chunk;
+		m_packetsSent++;
+	}
+	return true;
+} // send
+
+#endif // CONFIG_BT_ENABLED
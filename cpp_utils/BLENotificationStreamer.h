@@ -0,0 +1,50 @@
+/*
+ * BLENotificationStreamer.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLENOTIFICATIONSTREAMER_H_
+#define COMPONENTS_CPP_UTILS_BLENOTIFICATIONSTREAMER_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <stddef.h>
+#include <stdint.h>
+#include "BLECharacteristic.h"
+
+/**
+ * @brief Send a buffer of any size as a stream of notifications of a characteristic.
+ *
+ * The buffer is cut into pieces of the connection's MTU less the 3 byte notification header, so
+ * every packet is full.  The pieces are handed to the stack as fast as it takes them; when the
+ * controller's buffers for the connection fill, the stack reports the connection congested and
+ * the streamer waits for it to drain before going on.  This keeps the link busy every connection
+ * event without overrunning the stack's queues, which is what pushing a firmware diff or a log at
+ * the link's full throughput needs.
+ *
+ * The client must reassemble the pieces; each is a notification of the characteristic, in order.
+ *
+ * @code{.cpp}
+ * BLENotificationStreamer streamer(pLogCharacteristic);
+ * streamer.send(connId, log, logLength, 5000);
+ * @endcode
+ */
+class BLENotificationStreamer {
+public:
+	BLENotificationStreamer(BLECharacteristic *pCharacteristic);
+
+	uint32_t getBytesSent();
+	uint32_t getPacketsSent();
+	uint32_t getStalls();
+	bool     send(uint16_t connId, const uint8_t *data, size_t length, uint32_t timeoutMs);
+
+private:
+	BLECharacteristic *m_pCharacteristic;
+	uint32_t           m_bytesSent;
+	uint32_t           m_packetsSent;
+	uint32_t           m_stalls;      // The number of times we waited for the connection to drain.
+}; // BLENotificationStreamer
+
+#endif // CONFIG_BT_ENABLED
+#endif /* COMPONENTS_CPP_UTILS_BLENOTIFICATIONSTREAMER_H_ */
@@ -0,0 +1,246 @@
+/*
+ * BLEScanCache.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANCACHE_H_
+#define COMPONENTS_CPP_UTILS_BLESCANCACHE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "BLEAdvertisedData.h"
+#include "FixedHashMap.h"
+#include "IntrusiveList.h"
+
+/**
+ * @brief What the scan cache knows of one advertiser.
+ */
+struct BLEScannedDevice: public IntrusiveListHook<> {
+	uint64_t address;       // The 6 bytes of the address, first byte most significant.
+	int16_t  rssiAverage;   // Exponentially weighted average of the RSSI, in 1/16 dBm.
+	int8_t   rssi;          // The RSSI of the latest advertisement.
+	int8_t   rssiReported;  // The average RSSI, in dBm, when the device was last reported.
+	uint32_t firstSeen;     // The times, in the caller's units, of the first and latest advertisements.
+	uint32_t lastSeen;
+	uint32_t payloadHash;   // A hash of the latest payload, up to the end of its last AD structure.
+	uint32_t count;         // The number of advertisements seen.
+
+	/**
+	 * @brief Get the average RSSI in dBm.
+	 */
+	int getRSSI() const {
+		return rssiAverage / 16;
+	}
+}; // BLEScannedDevice
+
+
+/**
+ * @brief The parts of a BLEScanCache that do not depend on its capacity.
+ */
+class BLEScanCacheBase {
+public:
+	enum Change {
+		UNCHANGED,
+		NEW,
+		PAYLOAD_CHANGED,
+		RSSI_CHANGED
+	};
+
+	/**
+	 * @brief The function called when a device is new or has changed.
+	 *
+	 * The payload is that of the advertisement that caused the call.
+	 */
+	typedef void (*OnDevice)(const BLEScannedDevice& device, Change change, const uint8_t* payload, size_t length);
+}; // BLEScanCacheBase
+
+
+/**
+ * @brief A cache of the devices found by a scan, of fixed capacity.
+ *
+ * Busy places hear the same advertisements many times a second.  Each one passed to update() is
+ * looked up by its 48 bit address in an open addressed table, and the cache keeps the running
+ * RSSI average, when the device was last seen and a hash of its payload.  The callback is made
+ * only when a device is new, when its payload changes, or when its average RSSI moves by the
+ * RSSI threshold; a repeat of an advertisement costs a hash of its payload and nothing else.
+ *
+ * When the cache is full the device heard from least recently is evicted to make room.  Devices
+ * not heard from for a while can be dropped with expire().
+ *
+ * Nothing is allocated after construction.  The cache is not thread safe; update it from the
+ * GAP event handler only.
+ *
+ * @tparam CAPACITY The number of devices held.
+ */
+template<size_t CAPACITY>
+class BLEScanCache: public BLEScanCacheBase {
+	static_assert(CAPACITY >= 1 && CAPACITY < 0x8000, "CAPACITY must be from 1 to 32767");
+
+public:
+	BLEScanCache() {
+		m_onDevice      = nullptr;
+		m_rssiThreshold = 0;
+		m_evictions     = 0;
+		clear();
+	}
+
+	void clear() {
+		m_lru.clear();
+		m_free.clear();
+		m_index.clear();
+		for (size_t i = 0; i < CAPACITY; i++) {
+			m_free.pushBack(&m_devices[i]);
+		}
+	} // clear
+
+	/**
+	 * @brief Drop the devices not seen since a time.
+	 * @param [in] before Devices last seen before this time are dropped.
+	 * @return The number of devices dropped.
+	 */
+	size_t expire(uint32_t before) {
+		size_t count = 0;
+		BLEScannedDevice* pDevice = m_lru.getLast();
+		while (pDevice != nullptr && (int32_t)(pDevice->lastSeen - before) < 0) {
+			remove(pDevice);
+			count++;
+			pDevice = m_lru.getLast();
+		}
+		return count;
+	} // expire
+
+	/**
+	 * @brief Find a device by its address.
+	 * @return The device, or nullptr if it is not in the cache.
+	 */
+	const BLEScannedDevice* find(const uint8_t* address) {
+		uint16_t* pIndex = m_index.get(toKey(address));
+		return pIndex == nullptr ? nullptr : &m_devices[*pIndex];
+	} // find
+
+	/**
+	 * @brief Get the number of devices evicted to make room for new ones.
+	 */
+	uint32_t getEvictions() const {
+		return m_evictions;
+	}
+
+	/**
+	 * @brief Get the devices, the most recently seen first.
+	 */
+	IntrusiveList<BLEScannedDevice>& getDevices() {
+		return m_lru;
+	}
+
+	void setOnDevice(OnDevice onDevice) {
+		m_onDevice = onDevice;
+	}
+
+	/**
+	 * @brief Report a device when its average RSSI moves by this many dBm, or never if 0.
+	 */
+	void setRSSIThreshold(int threshold) {
+		m_rssiThreshold = threshold;
+	}
+
+	size_t size() const {
+		return m_index.size();
+	}
+
+	/**
+	 * @brief Record an advertisement.
+	 *
+	 * @param [in] address The 6 byte address of the advertiser.
+	 * @param [in] rssi The RSSI of the advertisement.
+	 * @param [in] payload The advertising payload.
+	 * @param [in] length The length of the payload.
+	 * @param [in] now The time, in any units that increase, such as ticks.
+	 * @return How the device changed.  The callback has been made if it is not UNCHANGED.
+	 */
+	Change update(const uint8_t* address, int rssi, const uint8_t* payload, size_t length, uint32_t now) {
+		uint64_t key  = toKey(address);
+		uint32_t hash = hashOf(payload, BLEAdvertisedData(payload, length).getUsedLength());
+		Change change = UNCHANGED;
+
+		BLEScannedDevice* pDevice;
+		uint16_t* pIndex = m_index.get(key);
+		if (pIndex != nullptr) {
+			pDevice = &m_devices[*pIndex];
+			pDevice->rssiAverage += (rssi * 16 - pDevice->rssiAverage) / 8;
+			if (pDevice->payloadHash != hash) {
+				change = PAYLOAD_CHANGED;
+			} else if (m_rssiThreshold != 0 &&
+					abs(pDevice->getRSSI() - pDevice->rssiReported) >= m_rssiThreshold) {
+				change = RSSI_CHANGED;
+			}
+		} else {
+			pDevice = m_free.popFront();
+			if (pDevice == nullptr) {
+				pDevice = m_lru.getLast();   // Evict the device heard from least recently.
+				remove(pDevice);
+				m_free.remove(pDevice);
+				m_evictions++;
+			}
+			m_index.set(key, (uint16_t)(pDevice - m_devices));
+			pDevice->address     = key;
+			pDevice->rssiAverage = rssi * 16;
+			pDevice->firstSeen   = now;
+			pDevice->count       = 0;
+			change = NEW;
+		}
+		pDevice->rssi        = rssi;
+		pDevice->lastSeen    = now;
+		pDevice->payloadHash = hash;
+		pDevice->count++;
+		m_lru.pushFront(pDevice);
+
+		if (change != UNCHANGED) {
+			pDevice->rssiReported = pDevice->getRSSI();
+			if (m_onDevice != nullptr) {
+				m_onDevice(*pDevice, change, payload, length);
+			}
+		}
+		return change;
+	} // update
+
+private:
+	static uint64_t toKey(const uint8_t* address) {
+		uint64_t key = 0;
+		for (int i = 0; i < 6; i++) {
+			key = (key << 8) | address[i];
+		}
+		return key;
+	}
+	static uint32_t hashOf(const uint8_t* data, size_t length) {
+		uint32_t hash = 2166136261u;   // FNV-1a
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ data[i]) * 16777619u;
+		}
+		return hash;
+	}
+	static int abs(int value) {
+		return value < 0 ? -value : value;
+	}
+	void remove(BLEScannedDevice* pDevice) {
+		m_index.remove(pDevice->address);
+		m_free.pushBack(pDevice);   // Also removes it from the LRU list.
+	}
+
+	/**
+	 * @brief The number of slots in the index: a power of 2 at least twice CAPACITY.
+	 */
+	static constexpr size_t indexSlots(size_t n = 2) {
+		return n >= CAPACITY * 2 ? n : indexSlots(n * 2);
+	}
+
+	BLEScannedDevice                              m_devices[CAPACITY];
+	FixedHashMap<uint64_t, uint16_t, indexSlots()> m_index;   // Address to the index of a device.
+	IntrusiveList<BLEScannedDevice>               m_lru;     // The devices, most recently seen first.
+	IntrusiveList<BLEScannedDevice>               m_free;    // The unused devices.
+	OnDevice                                      m_onDevice;
+	int                                           m_rssiThreshold;
+	uint32_t                                      m_evictions;
+}; // BLEScanCache
+
+#endif /* COMPONENTS_CPP_UTILS_BLESCANCACHE_H_ */
@@ -34,10 +34,13 @@ BLEServer::BLEServer(uint16_t appId) {
 	m_appId    = appId;
 	m_gatts_if = 0;
 	m_serializeMutex.setName("BLEServer");
+	m_connectionsLock = portMUX_INITIALIZER_UNLOCKED;
+	m_flowChanged     = ::xSemaphoreCreateBinary();
 } // BLEServer
 
 
 BLEServer::~BLEServer() {
+	::vSemaphoreDelete(m_flowChanged);
 } // ~BLEServer
 
 
@@ -73,7 +76,13 @@ BLEService *BLEServer::createService(BLEUUID uuid) {
 	}
 
 	BLEService *pService = new BLEService(uuid);
-	m_serviceMap.setByUUID(uuid, pService); // Save a reference to this service being on this server.
+	pService->m_pServer = this;
+	if (!m_serviceMap.setByUUID(uuid, pService)) { // Save a reference to this service being on this server.
+		delete pService;
+		m_serializeMutex.give();
+		ESP_LOGD(LOG_TAG, "<< createService: no room for the service");
+		return nullptr;
+	}
 	pService->executeCreate(m_gatts_if);    // Perform the API calls to actually create the service.
 	ESP_LOGD(LOG_TAG, "<< createService");
 	return pService;
@@ -105,10 +114,25 @@ void BLEServer::handleGATTServerEvent(
 		esp_ble_gatts_cb_param_t *param) {
 
 	ESP_LOGD(LOG_TAG, ">> handleGATTServerEvent: %s",
-			bt_utils_gatt_server_event_type_to_string(event).c_str());
+			bt_utils_gatt_server_event_type_to_string(event));
+
+	switch(event) {
+		// Reads and writes go straight to the attribute that owns the handle.
+		case ESP_GATTS_READ_EVT: {
+			dispatchByHandle(param->read.handle, event, gatts_if, param);
+			break;
+		}
+		case ESP_GATTS_WRITE_EVT: {
+			dispatchByHandle(param->write.handle, event, gatts_if, param);
+			break;
+		}
 
-	// Invoke the handler for every Service we have.
-	m_serviceMap.handleGATTServerEvent(event, gatts_if, param);
+		// Every other event is offered to every Service we have.
+		default: {
+			m_serviceMap.handleGATTServerEvent(event, gatts_if, param);
+			break;
+		}
+	}
 
 	switch(event) {
 		// ESP_GATTS_REG_EVT
@@ -173,8 +197,80 @@ void BLEServer::handleGATTServerEvent(
 			break;
 		}
 
+		// ESP_GATTS_EXEC_WRITE_EVT - The attributes have applied or discarded their prepared writes; one
+		// response covers them all.
+		//
+		// exec_write:
+		// - uint16_t      conn_id
+		// - uint32_t      trans_id
+		// - esp_bd_addr_t bda
+		// - uint8_t       exec_write_flag
+		//
+		case ESP_GATTS_EXEC_WRITE_EVT: {
+			esp_err_t errRc = ::esp_ble_gatts_send_response(
+					gatts_if, param->exec_write.conn_id, param->exec_write.trans_id, ESP_GATT_OK, nullptr);
+			if (errRc != ESP_OK) {
+				ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, espToString(errRc));
+			}
+			break;
+		} // ESP_GATTS_EXEC_WRITE_EVT
+
+
+		// ESP_GATTS_CONNECT_EVT
+		// connect:
+		// - uint16_t      conn_id
+		// - esp_bd_addr_t remote_bda
+		// - bool          is_connected
+		case ESP_GATTS_CONNECT_EVT: {
+			Connection connection;
+			connection.mtu       = ESP_GATT_DEF_BLE_MTU_SIZE;
+			connection.congested = false;
+			portENTER_CRITICAL(&m_connectionsLock);
+			m_connections.set(param->connect.conn_id, connection);
+			portEXIT_CRITICAL(&m_connectionsLock);
+			break;
+		} // ESP_GATTS_CONNECT_EVT
+
+
+		// ESP_GATTS_MTU_EVT - The client has exchanged MTUs.
+		// mtu:
+		// - uint16_t conn_id
+		// - uint16_t mtu
+		case ESP_GATTS_MTU_EVT: {
+			portENTER_CRITICAL(&m_connectionsLock);
+			Connection *pConnection = m_connections.get(param->mtu.conn_id);
+			if (pConnection != nullptr) {
+				pConnection->mtu = param->mtu.mtu;
+			}
+			portEXIT_CRITICAL(&m_connectionsLock);
+			break;
+		} // ESP_GATTS_MTU_EVT
+
+
+		// ESP_GATTS_CONGEST_EVT - The controller's buffers for a connection have filled or drained.
+		// congest:
+		// - uint16_t conn_id
+		// - bool     congested
+		case ESP_GATTS_CONGEST_EVT: {
+			portENTER_CRITICAL(&m_connectionsLock);
+			Connection *pConnection = m_connections.get(param->congest.conn_id);
+			if (pConnection != nullptr) {
+				pConnection->congested = param->congest.congested;
+			}
+			portEXIT_CRITICAL(&m_connectionsLock);
+			if (!param->congest.congested) {
+				::xSemaphoreGive(m_flowChanged);
+			}
+			break;
+		} // ESP_GATTS_CONGEST_EVT
+
+
 		// ESP_GATTS_DISCONNECT_EVT
 		case ESP_GATTS_DISCONNECT_EVT: {
+			portENTER_CRITICAL(&m_connectionsLock);
+			m_connections.remove(param->disconnect.conn_id);
+			portEXIT_CRITICAL(&m_connectionsLock);
+			::xSemaphoreGive(m_flowChanged);
 			startAdvertising();
 			break;
 		} // ESP_GATTS_DISCONNECT_EVT
@@ -187,10 +283,40 @@ void BLEServer::handleGATTServerEvent(
 		// - uint16_t service_handle
 		// - esp_bt_uuid_t char_uuid
 		case ESP_GATTS_ADD_CHAR_EVT: {
+			BLEService *pService = m_serviceMap.getByHandle(param->add_char.service_handle);
+			if (pService == nullptr || param->add_char.status != ESP_GATT_OK) {
+				break;
+			}
+			BLECharacteristic *pCharacteristic = pService->getCharacteristic(BLEUUID(param->add_char.char_uuid));
+			if (pCharacteristic != nullptr) {
+				m_handleTable.setCharacteristic(param->add_char.attr_handle, pCharacteristic);
+			}
 			break;
 		} // ESP_GATTS_ADD_CHAR_EVT
 
 
+		// ESP_GATTS_ADD_CHAR_DESCR_EVT - Indicate that a descriptor was added to the last characteristic created.
+		// add_char_descr:
+		// - esp_gatt_status_t status
+		// - uint16_t attr_handle
+		// - uint16_t service_handle
+		// - esp_bt_uuid_t char_uuid
+		case ESP_GATTS_ADD_CHAR_DESCR_EVT: {
+			BLEService *pService = m_serviceMap.getByHandle(param->add_char_descr.service_handle);
+			if (pService == nullptr || pService->getLastCreatedCharacteristic() == nullptr ||
+					param->add_char_descr.status != ESP_GATT_OK) {
+				break;
+			}
+			// The descriptor has already taken its handle from this event.
+			BLEDescriptor *pDescriptor = pService->getLastCreatedCharacteristic()->m_descriptorMap.getByUUID(
+				BLEUUID(param->add_char_descr.char_uuid));
+			if (pDescriptor != nullptr && pDescriptor->getHandle() == param->add_char_descr.attr_handle) {
+				m_handleTable.setDescriptor(param->add_char_descr.attr_handle, pDescriptor);
+			}
+			break;
+		} // ESP_GATTS_ADD_CHAR_DESCR_EVT
+
+
 		default: {
 			break;
 		}
@@ -199,6 +325,115 @@ void BLEServer::handleGATTServerEvent(
 } // handleGATTServerEvent
 
 
+/**
+ * @brief Get the ids of the open connections.
+ * @param [out] connIds Where to put the ids.
+ * @param [in] maxCount The most ids to put.
+ * @return The number of ids put.
+ */
+size_t BLEServer::getConnections(uint16_t *connIds, size_t maxCount) {
+	size_t count = 0;
+	portENTER_CRITICAL(&m_connectionsLock);
+	for (auto &entry: m_connections) {
+		if (count == maxCount) {
+			break;
+		}
+		connIds[count++] = entry.key;
+	}
+	portEXIT_CRITICAL(&m_connectionsLock);
+	return count;
+} // getConnections
+
+
+/**
+ * @brief Get the MTU of a connection.
+ * @param [in] connId The connection id.
+ * @return The MTU, or 0 if there is no such connection.
+ */
+uint16_t BLEServer::getMTU(uint16_t connId) {
+	uint16_t mtu = 0;
+	portENTER_CRITICAL(&m_connectionsLock);
+	Connection *pConnection = m_connections.get(connId);
+	if (pConnection != nullptr) {
+		mtu = pConnection->mtu;
+	}
+	portEXIT_CRITICAL(&m_connectionsLock);
+	return mtu;
+} // getMTU
+
+
+/**
+ * @brief Are the controller's buffers for a connection full?
+ * @param [in] connId The connection id.
+ * @return True if nothing more should be sent on the connection for now.
+ */
+bool BLEServer::isCongested(uint16_t connId) {
+	bool congested = false;
+	portENTER_CRITICAL(&m_connectionsLock);
+	Connection *pConnection = m_connections.get(connId);
+	if (pConnection != nullptr) {
+		congested = pConnection->congested;
+	}
+	portEXIT_CRITICAL(&m_connectionsLock);
+	return congested;
+} // isCongested
+
+
+/**
+ * @brief Wait until a connection can take more data.
+ *
+ * Only one task should wait on the server at a time; another one still sees the flow resume
+ * within a few ticks.
+ *
+ * @param [in] connId The connection id.
+ * @param [in] timeoutMs The longest time to wait.
+ * @return True if the connection is open and not congested, false if it closed or the time ran out.
+ */
+bool BLEServer::waitForFlow(uint16_t connId, uint32_t timeoutMs) {
+	TickType_t start = ::xTaskGetTickCount();
+	TickType_t limit = timeoutMs / portTICK_PERIOD_MS;
+	while (true) {
+		if (getMTU(connId) == 0) {
+			return false;
+		}
+		if (!isCongested(connId)) {
+			return true;
+		}
+		TickType_t waited = ::xTaskGetTickCount() - start;
+		if (waited >= limit) {
+			return false;
+		}
+		TickType_t wait = limit - waited;
+		::xSemaphoreTake(m_flowChanged, wait < 10 ? wait : 10);
+	}
+} // waitForFlow
+
+
+/**
+ * @brief Pass an event to the characteristic or descriptor that owns a handle.
+ * @param [in] handle The handle the event is for.
+ * @param [in] event
+ * @param [in] gatts_if
+ * @param [in] param
+ */
+void BLEServer::dispatchByHandle(
+		uint16_t                  handle,
+		esp_gatts_cb_event_t      event,
+		esp_gatt_if_t             gatts_if,
+		esp_ble_gatts_cb_param_t *param) {
+	const BLEHandleTable::Entry *pEntry = m_handleTable.find(handle);
+	if (pEntry == nullptr) {
+		ESP_LOGD(LOG_TAG, "No attribute has handle 0x%.2x", handle);
+		return;
+	}
+	if (pEntry->pCharacteristic != nullptr) {
+		pEntry->pCharacteristic->handleGATTServerEvent(event, gatts_if, param);
+	} else {
+		pEntry->pDescriptor->handleGATTServerEvent(event, gatts_if, param);
+	}
+} // dispatchByHandle
+
+
 /**
  * @brief Handle a receiver GAP event.
  * @param [in] event
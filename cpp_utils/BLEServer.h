@@ -16,7 +16,9 @@
 #include "BLECharacteristic.h"
 #include "BLEService.h"
 #include "BLECharacteristicMap.h"
+#include "BLEHandleTable.h"
 #include "BLEServiceMap.h"
+#include "FixedHashMap.h"
 
 class BLEServer {
 public:
@@ -31,14 +33,32 @@ public:
 	BLEAdvertising *getAdvertising();
 	void startAdvertising();
 
+	size_t getConnections(uint16_t *connIds, size_t maxCount);
+	uint16_t getMTU(uint16_t connId);
+	bool isCongested(uint16_t connId);
+	bool waitForFlow(uint16_t connId, uint32_t timeoutMs);
 
 private:
+	/**
+	 * @brief What we know of a connected client.
+	 */
+	struct Connection {
+		uint16_t mtu;
+		bool     congested;
+	};
+
 	esp_ble_adv_data_t  m_adv_data;
 	uint16_t            m_appId;
 	BLEAdvertising      m_bleAdvertising;
   uint16_t            m_gatts_if;
 	FreeRTOS::Semaphore m_serializeMutex;
 	BLEServiceMap       m_serviceMap;
+	BLEHandleTable      m_handleTable;
+	FixedHashMap<uint16_t, Connection, 8> m_connections;   // By connection id.
+	portMUX_TYPE        m_connectionsLock;
+	SemaphoreHandle_t   m_flowChanged;                      // Given when a connection's flow changes.
+
+	void dispatchByHandle(uint16_t handle, esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
 }; // BLEServer
 
 #endif /* COMPONENTS_CPP_UTILS_BLESERVER_H_ */
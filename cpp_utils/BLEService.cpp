@@ -31,6 +31,7 @@ BLEService::BLEService(BLEUUID uuid) {
 	m_gatts_if = 0;
 	m_serializeMutex.setName("BLEService");
 	m_lastCreatedCharacteristic = nullptr;
+	m_pServer  = nullptr;
 }
 
 
@@ -48,7 +49,7 @@ void BLEService::executeCreate(esp_gatt_if_t gatts_if) {
 	ESP_LOGD(LOG_TAG, ">> executeCreate() - Creating service (esp_ble_gatts_create_service)");
 	m_gatts_if           = gatts_if;
 	m_srvc_id.id.inst_id = 0;
-	m_srvc_id.id.uuid    = *m_uuid.getNative();
+	m_srvc_id.id.uuid    = m_uuid.getNative();
 
 	m_serializeMutex.take("executeCreate"); // Take the mutex and release at event ESP_GATTS_CREATE_EVT
 	esp_err_t errRc = ::esp_ble_gatts_create_service(m_gatts_if, &m_srvc_id, 10);
@@ -65,12 +66,13 @@ void BLEService::executeCreate(esp_gatt_if_t gatts_if) {
  * @return N/A.
  */
 void BLEService::dump() {
-	std::string name = "unknown";
+	const char *name = "unknown";
 	if (m_srvc_id.id.uuid.len == ESP_UUID_LEN_16) {
 		name = BLEUtils::gattServiceToString(m_srvc_id.id.uuid.uuid.uuid16);
 	}
-	ESP_LOGD(LOG_TAG, "Service: uuid:%s, handle: 0x%.2x",
+	ESP_LOGD(LOG_TAG, "Service: uuid:%s [%s], handle: 0x%.2x",
 		m_uuid.toString().c_str(),
+		name,
 		m_handle);
 	ESP_LOGD(LOG_TAG, "Characteristics:\n%s", m_characteristicMap.toString().c_str());
 } // dump
@@ -159,7 +161,10 @@ void BLEService::addCharacteristic(BLECharacteristic* pCharacteristic) {
 
 	// Remember this characteristic in our map of characteristics.  At this point, we can lookup by UUID
 	// but not by handle.  The handle is allocated to us on the ESP_GATTS_ADD_CHAR_EVT.
-	m_characteristicMap.setByUUID(pCharacteristic->getUUID(), pCharacteristic);
+	if (!m_characteristicMap.setByUUID(pCharacteristic->getUUID(), pCharacteristic)) {
+		ESP_LOGE(LOG_TAG, "<< addCharacteristic: characteristic %s not added", pCharacteristic->getUUID().toString().c_str());
+		return;
+	}
 
 	ESP_LOGD(LOG_TAG, "<< addCharacteristic()");
 } // addCharacteristic
@@ -15,6 +15,7 @@
 #include "BLECharacteristic.h"
 #include "BLECharacteristicMap.h"
 
+class BLEServer;
 
 class BLEService {
 public:
@@ -38,10 +39,13 @@ private:
 	uint16_t             m_handle;
 	BLECharacteristicMap m_characteristicMap;
 	BLECharacteristic   *m_lastCreatedCharacteristic;
+	BLEServer           *m_pServer;
 	friend class BLEServer;
 	friend class BLEServiceMap;
 	friend class BLEDescriptor;
 	friend class BLECharacteristic;
+	friend class BLENotificationScheduler;
+	friend class BLENotificationStreamer;
 
 	BLECharacteristic *getLastCreatedCharacteristic();
 	void setHandle(uint16_t handle);
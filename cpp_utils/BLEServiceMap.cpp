@@ -7,8 +7,11 @@
 
 #include <sstream>
 #include <iomanip>
+#include <esp_log.h>
 #include "BLEServiceMap.h"
 
+static char LOG_TAG[] = "BLEServiceMap";
+
 BLEServiceMap::BLEServiceMap() {
 }
 
@@ -21,12 +24,11 @@ BLEServiceMap::~BLEServiceMap() {
  * @return The characteristic.
  */
 BLEService* BLEServiceMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.second->getUUID().equals(uuid)) {
-			return myPair.second;
+	for (auto pService : m_services) {
+		if (pService->getUUID().equals(uuid)) {
+			return pService;
 		}
 	}
-	//return m_uuidMap.at(uuid.toString());
 	return nullptr;
 } // getByUUID
 
@@ -37,7 +39,8 @@ BLEService* BLEServiceMap::getByUUID(BLEUUID uuid) {
  * @return The service.
  */
 BLEService* BLEServiceMap::getByHandle(uint16_t handle) {
-	return m_handleMap.at(handle);
+	BLEService** ppService = m_handleMap.get(handle);
+	return ppService == nullptr ? nullptr : *ppService;
 } // getByHandle
 
 
@@ -45,11 +48,18 @@ BLEService* BLEServiceMap::getByHandle(uint16_t handle) {
  * @brief Set the service by UUID.
  * @param [in] uuid The uuid of the service.
  * @param [in] characteristic The service to cache.
- * @return N/A.
+ * @return False if the map already holds CONFIG_BLE_MAX_SERVICES services.
  */
-void BLEServiceMap::setByUUID(BLEUUID uuid,
+bool BLEServiceMap::setByUUID(BLEUUID uuid,
 		BLEService *service) {
-	m_uuidMap.insert(std::pair<std::string, BLEService *>(uuid.toString(), service));
+	if (getByUUID(uuid) != nullptr) {
+		return true;
+	}
+	if (m_services.size() >= CONFIG_BLE_MAX_SERVICES || !m_services.pushBack(service)) {
+		ESP_LOGE(LOG_TAG, "setByUUID: no room for more than %d services, see CONFIG_BLE_MAX_SERVICES", CONFIG_BLE_MAX_SERVICES);
+		return false;
+	}
+	return true;
 } // setByUUID
 
 
@@ -57,11 +67,15 @@ void BLEServiceMap::setByUUID(BLEUUID uuid,
  * @brief Set the service by handle.
  * @param [in] handle The handle of the service.
  * @param [in] service The service to cache.
- * @return N/A.
+ * @return False if the map is full.
  */
-void BLEServiceMap::setByHandle(uint16_t handle,
+bool BLEServiceMap::setByHandle(uint16_t handle,
 		BLEService* service) {
-	m_handleMap.insert(std::pair<uint16_t, BLEService *>(handle, service));
+	if (!m_handleMap.set(handle, service)) {
+		ESP_LOGE(LOG_TAG, "setByHandle: more than %d handles", (int)m_handleMap.capacity());
+		return false;
+	}
+	return true;
 } // setByHandle
 
 
@@ -72,8 +86,8 @@ void BLEServiceMap::setByHandle(uint16_t handle,
 std::string BLEServiceMap::toString() {
 	std::stringstream stringStream;
 	stringStream << std::hex << std::setfill('0');
-	for (auto &myPair: m_handleMap) {
-		stringStream << "handle: 0x" << std::setw(2) << myPair.first << ", uuid: " + myPair.second->getUUID().toString() << "\n";
+	for (auto pService: m_services) {
+		stringStream << "handle: 0x" << std::setw(2) << pService->getHandle() << ", uuid: " + pService->getUUID().toString() << "\n";
 	}
 	return stringStream.str();
 } // toString
@@ -83,7 +97,7 @@ void BLEServiceMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t *param) {
 	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.second->handleGATTServerEvent(event, gatts_if, param);
+	for (auto pService : m_services) {
+		pService->handleGATTServerEvent(event, gatts_if, param);
 	}
 }
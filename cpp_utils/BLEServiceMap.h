@@ -7,15 +7,21 @@
 
 #ifndef COMPONENTS_CPP_UTILS_BLESERVICEMAP_H_
 #define COMPONENTS_CPP_UTILS_BLESERVICEMAP_H_
-#include <map>
+#include "FixedHashMap.h"
+#include "SmallVector.h"
 #include "BLEService.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_BLE_MAX_SERVICES
+#define CONFIG_BLE_MAX_SERVICES 16
+#endif
 
 class BLEServiceMap {
 public:
 	BLEServiceMap();
 	virtual ~BLEServiceMap();
-	void setByUUID(BLEUUID uuid, BLEService *service);
-		void setByHandle(uint16_t handle, BLEService *service);
+	bool setByUUID(BLEUUID uuid, BLEService *service);
+	bool setByHandle(uint16_t handle, BLEService *service);
 	BLEService *getByUUID(BLEUUID uuid);
 	BLEService *getByHandle(uint16_t handle);
 	std::string toString();
@@ -24,8 +30,8 @@ public:
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t *param);
 	private:
-		std::map<std::string, BLEService *> m_uuidMap;
-		std::map<uint16_t, BLEService *> m_handleMap;
+		SmallVector<BLEService*, 4>             m_services;   // In the order they were added.
+		FixedHashMap<uint16_t, BLEService*, fixedHashMapCapacity(CONFIG_BLE_MAX_SERVICES)> m_handleMap;
 };
 
 #endif /* COMPONENTS_CPP_UTILS_BLESERVICEMAP_H_ */
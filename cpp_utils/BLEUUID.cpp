@@ -6,189 +6,110 @@
  */
 #include <esp_log.h>
 #include <string.h>
-#include <sstream>
-#include <iomanip>
 #include "BLEUUID.h"
+#include "GeneralUtils.h"
 static char TAG[] = "BLEUUID";
 
+/**
+ * @brief A UUID from its raw bytes.
+ * @param [in] value 2 or 4 bytes, least significant first, or the 16 bytes of a full UUID.
+ */
 BLEUUID::BLEUUID(std::string value) {
 	if (value.length() == 2) {
-		m_uuid.len = ESP_UUID_LEN_16;
-		m_uuid.uuid.uuid16 = value[0] | (value[1] << 8);
-		m_valueSet = true;
+		*this = BLEUUID((uint16_t)((uint8_t)value[0] | ((uint8_t)value[1] << 8)));
 	} else if (value.length() == 4) {
-		m_uuid.len = ESP_UUID_LEN_32;
-		m_uuid.uuid.uuid32 = value[0] | (value[1] << 8) | (value[2] << 16) | (value[3] << 24);
-		m_valueSet = true;
+		*this = BLEUUID((uint32_t)((uint8_t)value[0] | ((uint8_t)value[1] << 8) | ((uint8_t)value[2] << 16) | ((uint32_t)(uint8_t)value[3] << 24)));
 	} else if (value.length() == 16) {
-		m_uuid.len = ESP_UUID_LEN_128;
-		memcpy(m_uuid.uuid.uuid128, value.data(), 16);
-		m_valueSet = true;
+		memcpy(m_value, value.data(), 16);
+		m_length = ESP_UUID_LEN_128;
 	} else {
 		ESP_LOGE(TAG, "ERROR: UUID value not 2, 4 or 16 bytes");
-		m_valueSet = false;
+		*this = BLEUUID();
 	}
-}
-
-BLEUUID::BLEUUID(uint16_t uuid) {
-	m_uuid.len         = ESP_UUID_LEN_16;
-	m_uuid.uuid.uuid16 = uuid;
-	m_valueSet         = true;
-}
+} // BLEUUID
 
-BLEUUID::BLEUUID(uint32_t uuid) {
-	m_uuid.len         = ESP_UUID_LEN_32;
-	m_uuid.uuid.uuid32 = uuid;
-	m_valueSet         = true;
-}
 
 BLEUUID::BLEUUID(esp_bt_uuid_t uuid) {
-	m_uuid     = uuid;
-	m_valueSet = true;
-}
-
-BLEUUID::BLEUUID() {
-	m_valueSet = false;
-}
-
-BLEUUID::~BLEUUID() {
-	// TODO Auto-generated destructor stub
-}
+	if (uuid.len == ESP_UUID_LEN_16) {
+		*this = BLEUUID(uuid.uuid.uuid16);
+	} else if (uuid.len == ESP_UUID_LEN_32) {
+		*this = BLEUUID(uuid.uuid.uuid32);
+	} else if (uuid.len == ESP_UUID_LEN_128) {
+		memcpy(m_value, uuid.uuid.uuid128, 16);
+		m_length = ESP_UUID_LEN_128;
+	} else {
+		*this = BLEUUID();
+	}
+} // BLEUUID
 
 
 /**
- * @brief Get the native UUID value.
- * @return The native UUID value or NULL if not set.
+ * @brief Get the native UUID value, in the size the UUID was given in.
+ * @return The native UUID value, with a length of 0 if not set.
  */
-esp_bt_uuid_t *BLEUUID::getNative() {
-	//ESP_LOGD(TAG, ">> getNative()")
-	if (m_valueSet == false) {
+esp_bt_uuid_t BLEUUID::getNative() const {
+	esp_bt_uuid_t uuid;
+	uuid.len = m_length;
+	if (m_length == ESP_UUID_LEN_16) {
+		uuid.uuid.uuid16 = (m_value[2] << 8) | m_value[3];
+	} else if (m_length == ESP_UUID_LEN_32) {
+		uuid.uuid.uuid32 = ((uint32_t)m_value[0] << 24) | (m_value[1] << 16) | (m_value[2] << 8) | m_value[3];
+	} else if (m_length == ESP_UUID_LEN_128) {
+		memcpy(uuid.uuid.uuid128, m_value, 16);
+	} else {
 		ESP_LOGD(TAG, "<< Return of un-initialized UUID!");
-		return nullptr;
 	}
-	//ESP_LOGD(TAG, "<< getNative()");
-	return &m_uuid;
-}
+	return uuid;
+} // getNative
+
 
 //01234567 8901 2345 6789 012345678901
 //0000180d-0000-1000-8000-00805f9b34fb
 //0 1 2 3  4 5  6 7  8 9  0 1 2 3 4 5
 
 /**
- * @brief Get a string representation of the UUID.
- * @return A string representation of the UUID.
+ * @brief Write the UUID as text, without allocating.
+ * @param [out] out A buffer of at least STRING_LENGTH characters.
+ * @return The length of the text, not counting the terminating null.
  */
-std::string BLEUUID::toString() {
-	if (m_valueSet == false) {
-		return "<NULL>";
-	}
-	if (m_uuid.len == ESP_UUID_LEN_16) {
-		std::stringstream ss;
-		ss << "0000" << std::hex << std::setfill('0') << std::setw(4) << m_uuid.uuid.uuid16 << "-0000-1000-8000-00805f9b34fb";
-		return ss.str();
-	}
-	if (m_uuid.len == ESP_UUID_LEN_32) {
-		std::stringstream ss;
-		ss << std::hex << std::setfill('0') << std::setw(8) << m_uuid.uuid.uuid32 << "-0000-1000-8000-00805f9b34fb";
-		return ss.str();
+size_t BLEUUID::format(char* out) const {
+	if (m_length == 0) {
+		memcpy(out, "<NULL>", 7);
+		return 6;
 	}
-	else {
-		std::stringstream ss;
-		ss << std::hex << std::setfill('0') <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[0]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[1]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[2]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[3]  << "-" <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[4]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[5]  << "-" <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[6]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[7]  << "-" <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[8]  <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[9]  << "-" <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[10] <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[11] <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[12] <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[13] <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[14] <<
-				std::setw(2) << (int)m_uuid.uuid.uuid128[15];
-		return ss.str();
-	}
-} // toString
+	return GeneralUtils::formatUuid(m_value, out);
+} // format
+
 
 /**
- * @brief Compare a UUID against this UUID.
- * @param [in] uuid The UUID to compare against.
- * @return True if the UUIDs are equal and false otherwise.
+ * @brief Get a hash of the UUID, for hash tables.
+ *
+ * Most UUIDs share the bytes of the base UUID, so every byte is mixed in.
  */
-bool BLEUUID::equals(BLEUUID uuid) {
-	//ESP_LOGD(TAG, "Comparing: %s to %s", toString().c_str(), uuid.toString().c_str());
-	if (m_valueSet == false) {
-		return false;
-	}
-	if (uuid.m_valueSet == false) {
-		return false;
-	}
-	if (uuid.m_uuid.len != m_uuid.len) {
-		return uuid.toString() == toString();
-	}
-	if (uuid.m_uuid.len == ESP_UUID_LEN_16) {
-		return uuid.m_uuid.uuid.uuid16 == m_uuid.uuid.uuid16;
+uint32_t BLEUUID::hash() const {
+	uint32_t hash = 2166136261u;   // FNV-1a
+	for (int i = 0; i < 16; i++) {
+		hash = (hash ^ m_value[i]) * 16777619u;
 	}
-	if (uuid.m_uuid.len == ESP_UUID_LEN_32) {
-		return uuid.m_uuid.uuid.uuid32 == m_uuid.uuid.uuid32;
-	}
-	return memcmp(uuid.m_uuid.uuid.uuid128, m_uuid.uuid.uuid128, 16) == 0;
-}
-
-void BLEUUID::toFull() {
-	//ESP_LOGD(TAG, ">> toFull() - %s", toString().c_str());
-	if (m_valueSet == false) {
-		return;
-	}
-	if (m_uuid.len == ESP_UUID_LEN_128) {
-		return;
-	}
-	/*
-	if (value.length() == 2) {
-		m_uuid.len = ESP_UUID_LEN_16;
-		m_uuid.uuid.uuid16 = value[0] | (value[1] << 8);
-		m_valueSet = true;
-	} else if (value.length() == 4) {
-		m_uuid.len = ESP_UUID_LEN_32;
-		m_uuid.uuid.uuid32 = value[0] | (value[1] << 8) | (value[2] << 16) | (value[3] << 24);
-		m_valueSet = true;
-	*/
-	if (m_uuid.len == ESP_UUID_LEN_16) {
-
-		uint16_t temp = m_uuid.uuid.uuid16;
-		m_uuid.uuid.uuid128[0] = 0;
-		m_uuid.uuid.uuid128[1] = 0;
-		m_uuid.uuid.uuid128[2] = (temp >> 8) & 0xff;
-		m_uuid.uuid.uuid128[3] = temp & 0xff;
+	return hash;
+} // hash
 
-	}
-	if (m_uuid.len == ESP_UUID_LEN_32) {
-		uint32_t temp = m_uuid.uuid.uuid32;
-		m_uuid.uuid.uuid128[0] = (temp >> 24) & 0xff;
-		m_uuid.uuid.uuid128[1] = (temp >> 16) & 0xff;
-		m_uuid.uuid.uuid128[2] = (temp >> 8) & 0xff;
-		m_uuid.uuid.uuid128[3] = temp & 0xff;
-	}
-	m_uuid.len = ESP_UUID_LEN_128;
-	m_uuid.uuid.uuid128[4]  = 0x00;
-	m_uuid.uuid.uuid128[5]  = 0x00;
 
-	m_uuid.uuid.uuid128[6]  = 0x10;
-	m_uuid.uuid.uuid128[7]  = 0x00;
+/**
+ * @brief Get a string representation of the UUID.
+ * @return A string representation of the UUID.
+ */
+std::string BLEUUID::toString() const {
+	char text[STRING_LENGTH];
+	return std::string(text, format(text));
+} // toString
 
-	m_uuid.uuid.uuid128[8]  = 0x80;
-	m_uuid.uuid.uuid128[9]  = 0x00;
 
-	m_uuid.uuid.uuid128[10] = 0x00;
-	m_uuid.uuid.uuid128[11] = 0x80;
-	m_uuid.uuid.uuid128[12] = 0x5f;
-	m_uuid.uuid.uuid128[13] = 0x9b;
-	m_uuid.uuid.uuid128[14] = 0x34;
-	m_uuid.uuid.uuid128[15] = 0xfb;
-	//ESP_LOGD(TAG, "<< toFull <-  %s", toString().c_str());
-}
+/**
+ * @brief Make the native UUID the full 128 bit value.
+ */
+void BLEUUID::toFull() {
+	if (m_length != 0) {
+		m_length = ESP_UUID_LEN_128;
+	}
+} // toFull
@@ -8,24 +8,80 @@
 #ifndef COMPONENTS_CPP_UTILS_BLEUUID_H_
 #define COMPONENTS_CPP_UTILS_BLEUUID_H_
 #include <esp_gatt_defs.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
 #include <string>
 
+/**
+ * @brief A BLE UUID.
+ *
+ * Every UUID is held as its full 128 bit value, in the order it is written, so comparing two
+ * UUIDs is a compare of 16 bytes.  A 16 or 32 bit UUID is expanded against the Bluetooth base
+ * UUID, 00000000-0000-1000-8000-00805f9b34fb, when it is constructed; the size it was given in
+ * is remembered, and is the size used by getNative().
+ *
+ * The numeric constructors are constexpr, so UUIDs can be constants:
+ *
+ * @code{.cpp}
+ * static constexpr BLEUUID heartRate((uint16_t) 0x180d);
+ * static constexpr BLEUUID custom(0x4fafc2011fb5459eULL, 0x8fccc5c9c331914bULL);
+ * @endcode
+ */
 class BLEUUID {
 public:
+	static const size_t STRING_LENGTH = 37;   // The 36 characters of a UUID and a null.
+
+	constexpr BLEUUID() :
+		m_value{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, m_length(0) {}
+	constexpr BLEUUID(uint16_t uuid) :
+		m_value{0, 0, (uint8_t)(uuid >> 8), (uint8_t)uuid,
+			0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb}, m_length(ESP_UUID_LEN_16) {}
+	constexpr BLEUUID(uint32_t uuid) :
+		m_value{(uint8_t)(uuid >> 24), (uint8_t)(uuid >> 16), (uint8_t)(uuid >> 8), (uint8_t)uuid,
+			0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb}, m_length(ESP_UUID_LEN_32) {}
+	/**
+	 * @brief A 128 bit UUID from its first and last 64 bits, as written.
+	 */
+	constexpr BLEUUID(uint64_t high, uint64_t low) :
+		m_value{(uint8_t)(high >> 56), (uint8_t)(high >> 48), (uint8_t)(high >> 40), (uint8_t)(high >> 32),
+			(uint8_t)(high >> 24), (uint8_t)(high >> 16), (uint8_t)(high >> 8), (uint8_t)high,
+			(uint8_t)(low >> 56), (uint8_t)(low >> 48), (uint8_t)(low >> 40), (uint8_t)(low >> 32),
+			(uint8_t)(low >> 24), (uint8_t)(low >> 16), (uint8_t)(low >> 8), (uint8_t)low}, m_length(ESP_UUID_LEN_128) {}
 	BLEUUID(std::string uuid);
-	BLEUUID(uint16_t uuid);
-	BLEUUID(uint32_t uuid);
 	BLEUUID(esp_bt_uuid_t uuid);
-	BLEUUID();
-	virtual ~BLEUUID();
-	bool equals(BLEUUID uuid);
-	esp_bt_uuid_t *getNative();
-	void toFull();
-	std::string toString();
+
+	bool equals(const BLEUUID& uuid) const {
+		return m_length != 0 && uuid.m_length != 0 && memcmp(m_value, uuid.m_value, 16) == 0;
+	}
+	bool operator==(const BLEUUID& uuid) const {
+		return equals(uuid);
+	}
+	bool operator!=(const BLEUUID& uuid) const {
+		return !equals(uuid);
+	}
+	size_t         format(char* out) const;
+	esp_bt_uuid_t  getNative() const;
+	uint32_t       hash() const;
+	bool           isSet() const {
+		return m_length != 0;
+	}
+	void           toFull();
+	std::string    toString() const;
 
 private:
-	esp_bt_uuid_t m_uuid;
-	bool          m_valueSet;
+	uint8_t m_value[16];   // The full 128 bit UUID, most significant byte first.
+	uint8_t m_length;      // The size of the native UUID: ESP_UUID_LEN_16, _32 or _128, or 0 if not set.
 };
 
+namespace std {
+	template<>
+	struct hash<BLEUUID> {
+		size_t operator()(const BLEUUID& uuid) const {
+			return uuid.hash();
+		}
+	};
+}
+
 #endif /* COMPONENTS_CPP_UTILS_BLEUUID_H_ */
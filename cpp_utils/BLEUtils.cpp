@@ -7,7 +7,9 @@
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
 #include "BLEUtils.h"
+#include "BLEAssignedNumbers.h"
 #include "BLEDevice.h"
+#include "GeneralUtils.h"
 
 
 #include <freertos/FreeRTOS.h>
@@ -19,8 +21,7 @@
 #include <esp_err.h>         // ESP32 ESP-IDF
 #include <esp_log.h>         // ESP32 ESP-IDF
 #include <map>               // Part of C++ STL
-#include <sstream>
-#include <iomanip>
+#include <string.h>
 
 static char LOG_TAG[] = "BLEUtils";
 
@@ -34,7 +35,7 @@ BLEUtils::~BLEUtils() {
 }
 
 
-std::string bt_utils_gatt_close_reason_to_string(esp_gatt_conn_reason_t reason) {
+const char *bt_utils_gatt_close_reason_to_string(esp_gatt_conn_reason_t reason) {
 	switch(reason) {
 		case ESP_GATT_CONN_UNKNOWN:
 			return "ESP_GATT_CONN_UNKNOWN";
@@ -64,7 +65,7 @@ std::string bt_utils_gatt_close_reason_to_string(esp_gatt_conn_reason_t reason)
  * @brief Convert a BT GAP event type to a string representation.
  */
 
-std::string gapEventToString(uint32_t eventType) {
+const char *gapEventToString(uint32_t eventType) {
 	switch(eventType) {
 		case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
 			return "ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT";
@@ -111,7 +112,7 @@ std::string gapEventToString(uint32_t eventType) {
 } // gapEventToString
 
 
-std::string bt_utils_gatt_client_event_type_to_string(esp_gattc_cb_event_t eventType) {
+const char *bt_utils_gatt_client_event_type_to_string(esp_gattc_cb_event_t eventType) {
 	switch(eventType) {
 		case ESP_GATTC_ACL_EVT:
 			return "ESP_GATTC_ACL_EVT";
@@ -202,7 +203,7 @@ std::string bt_utils_gatt_client_event_type_to_string(esp_gattc_cb_event_t event
  * @param [in] eventType A GATT server event code.
  * @return A string representation of the GATT server event code.
  */
-std::string bt_utils_gatt_server_event_type_to_string(esp_gatts_cb_event_t eventType) {
+const char *bt_utils_gatt_server_event_type_to_string(esp_gatts_cb_event_t eventType) {
 	switch(eventType) {
 	case ESP_GATTS_REG_EVT:
 		return "ESP_GATTS_REG_EVT";
@@ -280,7 +281,7 @@ static std::string bt_addr_t_to_string(esp_ble_addr_type_t type) {
 /**
  * @brief Convert a BLE device type to a string.
  */
-std::string BLEUtils::devTypeToString(esp_bt_dev_type_t type) {
+const char *BLEUtils::devTypeToString(esp_bt_dev_type_t type) {
 	switch(type) {
 	case ESP_BT_DEVICE_TYPE_BREDR:
 		return "ESP_BT_DEVICE_TYPE_BREDR";
@@ -297,12 +298,20 @@ std::string BLEUtils::devTypeToString(esp_bt_dev_type_t type) {
 
 /**
  * @brief Convert an esp_gatt_id_t to a string.
+ *
+ * @param [in] gattId The id to convert.
+ * @param [out] out The buffer for the text, at least BLEUtils::GATT_ID_STRING_LENGTH characters.
+ * @return The number of characters written.
  */
-static std::string gattIdToString(esp_gatt_id_t gattId) {
-	std::stringstream stream;
-	stream << "uuid: " << BLEUtils::uuidToString(gattId.uuid) << ", inst_id: " << (int)gattId.inst_id;
-	//sprintf(buffer, "uuid: %s, inst_id: %d", uuidToString(gattId.uuid).c_str(), gattId.inst_id);
-	return stream.str();
+static size_t gattIdToString(esp_gatt_id_t gattId, char *out) {
+	char *p = out;
+	memcpy(p, "uuid: ", 6);
+	p += 6;
+	p += BLEUtils::uuidToString(gattId.uuid, p);
+	memcpy(p, ", inst_id: ", 11);
+	p += 11;
+	p += GeneralUtils::formatDecimal((uint32_t)gattId.inst_id, p);
+	return p - out;
 } // gattIdToString
 
 
@@ -313,38 +322,31 @@ static std::string gattIdToString(esp_gatt_id_t gattId) {
  * @return A string representation of the UUID.
  */
 std::string BLEUtils::uuidToString(esp_bt_uuid_t uuid) {
-	std::stringstream stream;
+	char text[GeneralUtils::UUID_STRING_LENGTH];
+	return std::string(text, uuidToString(uuid, text));
+} // uuidToString
+
+
+/**
+ * @brief Convert a UUID into a string representation, without allocating.
+ *
+ * @param [in] uuid A UUID.
+ * @param [out] out The buffer for the text, at least GeneralUtils::UUID_STRING_LENGTH characters.
+ * @return The number of characters written, 0 if the UUID has no valid length.
+ */
+size_t BLEUtils::uuidToString(esp_bt_uuid_t uuid, char *out) {
 	switch (uuid.len) {
 	case ESP_UUID_LEN_16:
-		stream << std::setfill('0') << std::setw(4) << std::hex << uuid.uuid.uuid16;
-		break;
+		return GeneralUtils::formatHex(uuid.uuid.uuid16, out, 4);
 
 	case ESP_UUID_LEN_32:
-		stream << std::setfill('0') << std::setw(8) << std::hex << uuid.uuid.uuid32;
-		break;
+		return GeneralUtils::formatHex(uuid.uuid.uuid32, out, 8);
 
 	case ESP_UUID_LEN_128:
-		stream << std::setfill('0') << std::hex <<
-			std::setw(2) << uuid.uuid.uuid128[0] <<
-			std::setw(2) << uuid.uuid.uuid128[1] <<
-			std::setw(2) << uuid.uuid.uuid128[2] <<
-			std::setw(2) << uuid.uuid.uuid128[3] << "-" <<
-			std::setw(2) << uuid.uuid.uuid128[4] <<
-			std::setw(2) << uuid.uuid.uuid128[5] << "-" <<
-			std::setw(2) << uuid.uuid.uuid128[6] <<
-			std::setw(2) << uuid.uuid.uuid128[7] << "-" <<
-			std::setw(2) << uuid.uuid.uuid128[8] <<
-			std::setw(2) << uuid.uuid.uuid128[9] << "-" <<
-			std::setw(2) << uuid.uuid.uuid128[10] <<
-			std::setw(2) << uuid.uuid.uuid128[11] <<
-			std::setw(2) << uuid.uuid.uuid128[12] <<
-			std::setw(2) << uuid.uuid.uuid128[13] <<
-			std::setw(2) << uuid.uuid.uuid128[14] <<
-			std::setw(2) << uuid.uuid.uuid128[15];
-		break;
+		return GeneralUtils::formatUuid(uuid.uuid.uuid128, out);
 	}
-
-	return stream.str();
+	*out = 0;
+	return 0;
 } // uuidToString
 
 
@@ -368,92 +370,23 @@ void BLEUtils::dumpHexData(uint8_t *target, uint8_t *source, uint8_t length) {
 } // dumpHexData
 
 
-typedef struct {
-	uint32_t assignedNumber;
-	std::string name;
-} characteristicMap_t;
-
-static characteristicMap_t g_characteristicsMappings[] = {
-		{0x2a00, "Device Name"},
-		{0x2a01, "Appearance"},
-		{0, ""}
-};
-
 /**
- * @brief Mapping from service ids to names
+ * @brief Get the name of a service from its 16 bit UUID.
+ * @return The name, or "Unknown".
  */
-typedef struct {
-	std::string name;
-	std::string type;
-	uint32_t assignedNumber;
-} gattService_t;
+const char *BLEUtils::gattServiceToString(uint32_t serviceId) {
+	return BLEAssignedNumbers::serviceName(serviceId);
+} // gattServiceToString
 
 
 /**
- * Definition of the service ids to names that we know about.
+ * @brief Get the name of a characteristic from its 16 bit UUID.
+ * @return The name, or "Unknown".
  */
-static gattService_t g_gattServices[] = {
-		{"Alert Notification Service", "org.bluetooth.service.alert_notification", 0x1811},
-		{"Automation IO", "org.bluetooth.service.automation_io",	0x1815 },
-		{"Battery Service","org.bluetooth.service.battery_service",	0x180F},
-		{"Blood Pressure", "org.bluetooth.service.blood_pressure", 0x1810},
-		{"Body Composition", "org.bluetooth.service.body_composition", 0x181B},
-		{"Bond Management", "org.bluetooth.service.bond_management", 0x181E},
-		{"Continuous Glucose Monitoring", "org.bluetooth.service.continuous_glucose_monitoring", 0x181F},
-		{"Current Time Service", "org.bluetooth.service.current_time", 0x1805},
-		{"Cycling Power", "org.bluetooth.service.cycling_power", 0x1818},
-		{"Cycling Speed and Cadence", "org.bluetooth.service.cycling_speed_and_cadence", 0x1816},
-		{"Device Information", "org.bluetooth.service.device_information", 0x180A},
-		{"Environmental Sensing", "org.bluetooth.service.environmental_sensing", 0x181A},
-		{"Generic Access", "org.bluetooth.service.generic_access", 0x1800},
-		{"Generic Attribute", "org.bluetooth.service.generic_attribute", 0x1801},
-		{"Glucose", "org.bluetooth.service.glucose", 0x1808},
-		{"Health Thermometer", "org.bluetooth.service.health_thermometer", 0x1809},
-		{"Heart Rate", "org.bluetooth.service.heart_rate", 0x180D},
-		{"HTTP Proxy", "org.bluetooth.service.http_proxy", 0x1823},
-		{"Human Interface Device", "org.bluetooth.service.human_interface_device", 0x1812},
-		{"Immediate Alert", "org.bluetooth.service.immediate_alert", 0x1802},
-		{"Indoor Positioning", "org.bluetooth.service.indoor_positioning", 0x1821},
-		{"Internet Protocol Support", "org.bluetooth.service.internet_protocol_support", 0x1820},
-		{"Link Loss", "org.bluetooth.service.link_loss", 0x1803},
-		{"Location and Navigation", "org.bluetooth.service.location_and_navigation", 0x1819},
-		{"Next DST Change Service", "org.bluetooth.service.next_dst_change", 0x1807},
-		{"Object Transfer", "org.bluetooth.service.object_transfer", 0x1825},
-		{"Phone Alert Status Service", "org.bluetooth.service.phone_alert_status", 0x180E},
-		{"Pulse Oximeter", "org.bluetooth.service.pulse_oximeter", 0x1822},
-		{"Reference Time Update Service", "org.bluetooth.service.reference_time_update", 0x1806},
-		{"Running Speed and Cadence", "org.bluetooth.service.running_speed_and_cadence", 0x1814},
-		{"Scan Parameters", "org.bluetooth.service.scan_parameters", 0x1813},
-		{"Transport Discovery", "org.bluetooth.service.transport_discovery", 0x1824},
-		{"Tx Power", "org.bluetooth.service.tx_power", 0x1804},
-		{"User Data", "org.bluetooth.service.user_data", 0x181C},
-		{"Weight Scale", "org.bluetooth.service.weight_scale", 0x181D},
-		{"", "", 0 }
-};
-
-
-std::string BLEUtils::gattServiceToString(uint32_t serviceId) {
-	gattService_t *p = g_gattServices;
-	while (p->name.length() > 0) {
-		if (p->assignedNumber == serviceId) {
-			return p->name;
-		}
-		p++;
-	}
-	return "Unknown";
-} // gattServiceToString
-
+const char *BLEUtils::gattCharacteristicUUIDToString(uint32_t characteristicUUID) {
+	return BLEAssignedNumbers::characteristicName(characteristicUUID);
+} // gattCharacteristicUUIDToString
 
-std::string BLEUtils::gattCharacteristicUUIDToString(uint32_t characteristicUUID) {
-	characteristicMap_t *p = g_characteristicsMappings;
-	while (p->name.length() > 0) {
-		if (p->assignedNumber == characteristicUUID) {
-			return p->name;
-		}
-		p++;
-	}
-	return "Unknown";
-}
 
 /**
  * @brief Convert a GATT status to a string.
@@ -461,7 +394,7 @@ std::string BLEUtils::gattCharacteristicUUIDToString(uint32_t characteristicUUID
  * @param [in] status The status to convert.
  * @return A string representation of the status.
  */
-std::string BLEUtils::gattStatusToString(esp_gatt_status_t status) {
+const char *BLEUtils::gattStatusToString(esp_gatt_status_t status) {
 	switch(status) {
 		case ESP_GATT_OK:
 			return "ESP_GATT_OK";
@@ -547,24 +480,44 @@ std::string BLEUtils::gattStatusToString(esp_gatt_status_t status) {
 } // bt_utils_gatt_status_to_string
 
 
-static std::string characteristic_properties_to_string(esp_gatt_char_prop_t prop) {
-	std::stringstream stream;
-	stream <<
-			"broadcast: "  << ((prop & ESP_GATT_CHAR_PROP_BIT_BROADCAST)?"1":"0") <<
-			", read: "     << ((prop & ESP_GATT_CHAR_PROP_BIT_READ)?"1":"0") <<
-			", write_nr: " << ((prop & ESP_GATT_CHAR_PROP_BIT_WRITE_NR)?"1":"0") <<
-			", write: "    << ((prop & ESP_GATT_CHAR_PROP_BIT_WRITE)?"1":"0") <<
-			", notify: "   << ((prop & ESP_GATT_CHAR_PROP_BIT_NOTIFY)?"1":"0") <<
-			", indicate: " << ((prop & ESP_GATT_CHAR_PROP_BIT_INDICATE)?"1":"0") <<
-			", auth: "     << ((prop & ESP_GATT_CHAR_PROP_BIT_AUTH)?"1":"0");
-	return stream.str();
+static const size_t PROPERTIES_STRING_LENGTH = 80;
+static const size_t DUMP_VALUE_LENGTH        = 32;   // Bytes of a value read that are logged.
+
+
+/**
+ * @brief Convert characteristic properties to a string.
+ *
+ * @param [in] prop The properties.
+ * @param [out] out The buffer for the text, at least PROPERTIES_STRING_LENGTH characters.
+ */
+static void characteristic_properties_to_string(esp_gatt_char_prop_t prop, char *out) {
+	static const struct {
+		esp_gatt_char_prop_t bit;
+		const char*          name;
+	} properties[] = {
+		{ESP_GATT_CHAR_PROP_BIT_BROADCAST, "broadcast: "},
+		{ESP_GATT_CHAR_PROP_BIT_READ,      ", read: "},
+		{ESP_GATT_CHAR_PROP_BIT_WRITE_NR,  ", write_nr: "},
+		{ESP_GATT_CHAR_PROP_BIT_WRITE,     ", write: "},
+		{ESP_GATT_CHAR_PROP_BIT_NOTIFY,    ", notify: "},
+		{ESP_GATT_CHAR_PROP_BIT_INDICATE,  ", indicate: "},
+		{ESP_GATT_CHAR_PROP_BIT_AUTH,      ", auth: "}
+	};
+	char *p = out;
+	for (auto& property: properties) {
+		size_t length = strlen(property.name);
+		memcpy(p, property.name, length);
+		p += length;
+		*p++ = (prop & property.bit) ? '1' : '0';
+	}
+	*p = 0;
 } // characteristic_properties_to_string
 
 
 /**
  * @brief convert a GAP search event to a string.
  */
-std::string bt_gap_search_event_type_to_string(uint32_t searchEvt) {
+const char *bt_gap_search_event_type_to_string(uint32_t searchEvt) {
 	switch(searchEvt) {
 		case ESP_GAP_SEARCH_INQ_RES_EVT:
 			return "ESP_GAP_SEARCH_INQ_RES_EVT";
@@ -613,15 +566,18 @@ void BLEUtils::dumpGattClientEvent(
 	esp_ble_gattc_cb_param_t *evtParam) {
 
 	//esp_ble_gattc_cb_param_t *evtParam = (esp_ble_gattc_cb_param_t *)param;
-	ESP_LOGD(LOG_TAG, "GATT Event: %s", bt_utils_gatt_client_event_type_to_string(event).c_str());
+	if (LOG_LOCAL_LEVEL < ESP_LOG_DEBUG) {
+		return;   // Nothing would be logged, so skip the formatting.
+	}
+	ESP_LOGD(LOG_TAG, "GATT Event: %s", bt_utils_gatt_client_event_type_to_string(event));
 	switch(event) {
 		//
 		// ESP_GATTC_CLOSE_EVT
 		//
 		case ESP_GATTC_CLOSE_EVT: {
 			ESP_LOGD(LOG_TAG, "status: %s, reason:%s, conn_id: %d",
-				BLEUtils::gattStatusToString(evtParam->close.status).c_str(),
-				bt_utils_gatt_close_reason_to_string(evtParam->close.reason).c_str(),
+				BLEUtils::gattStatusToString(evtParam->close.status),
+				bt_utils_gatt_close_reason_to_string(evtParam->close.reason),
 				evtParam->close.conn_id);
 			break;
 		}
@@ -630,17 +586,23 @@ void BLEUtils::dumpGattClientEvent(
 		// ESP_GATTC_GET_CHAR_EVT
 		//
 		case ESP_GATTC_GET_CHAR_EVT: {
-			std::string description = "Unknown";
+			const char *description = "Unknown";
 			if (evtParam->get_char.char_id.uuid.len == ESP_UUID_LEN_16) {
 				description = BLEUtils::gattCharacteristicUUIDToString(evtParam->get_char.char_id.uuid.uuid.uuid16);
 			}
+			char srvcId[GATT_ID_STRING_LENGTH];
+			char charId[GATT_ID_STRING_LENGTH];
+			char properties[PROPERTIES_STRING_LENGTH];
+			BLEUtils::gattServiceIdToString(evtParam->get_char.srvc_id, srvcId);
+			gattIdToString(evtParam->get_char.char_id, charId);
+			characteristic_properties_to_string(evtParam->get_char.char_prop, properties);
 			ESP_LOGD(LOG_TAG, "[status: %s, conn_id: %d, srvc_id: %s, char_id: %s [description: %s]\nchar_prop: %s]",
-					BLEUtils::gattStatusToString(evtParam->get_char.status).c_str(),
+					BLEUtils::gattStatusToString(evtParam->get_char.status),
 				evtParam->get_char.conn_id,
-				BLEUtils::gattServiceIdToString(evtParam->get_char.srvc_id).c_str(),
-				gattIdToString(evtParam->get_char.char_id).c_str(),
-				description.c_str(),
-				characteristic_properties_to_string(evtParam->get_char.char_prop).c_str()
+				srvcId,
+				charId,
+				description,
+				properties
 			);
 			break;
 		}
@@ -649,9 +611,11 @@ void BLEUtils::dumpGattClientEvent(
 		// ESP_GATTC_OPEN_EVT
 		//
 		case ESP_GATTC_OPEN_EVT: {
-			ESP_LOGD(LOG_TAG, "status: %s", BLEUtils::gattStatusToString(evtParam->open.status).c_str());
+			char address[GeneralUtils::MAC_STRING_LENGTH];
+			GeneralUtils::formatMac(evtParam->open.remote_bda, address);
+			ESP_LOGD(LOG_TAG, "status: %s", BLEUtils::gattStatusToString(evtParam->open.status));
 			ESP_LOGD(LOG_TAG, "conn_id: %d", evtParam->open.conn_id);
-			ESP_LOGD(LOG_TAG, "device address: %s", BLEUtils::addressToString(std::string((char *)evtParam->open.remote_bda, 6)).c_str());
+			ESP_LOGD(LOG_TAG, "device address: %s", address);
 			ESP_LOGD(LOG_TAG, "MTU: %d", evtParam->open.mtu);
 			break;
 		} // ESP_GATTC_OPEN_EVT
@@ -661,20 +625,27 @@ void BLEUtils::dumpGattClientEvent(
 		// ESP_GATTC_READ_CHAR_EVT
 		//
 		case ESP_GATTC_READ_CHAR_EVT: {
+			char srvcId[GATT_ID_STRING_LENGTH];
+			char charId[GATT_ID_STRING_LENGTH];
+			char descrId[GATT_ID_STRING_LENGTH];
+			BLEUtils::gattServiceIdToString(evtParam->read.srvc_id, srvcId);
+			gattIdToString(evtParam->read.char_id, charId);
+			gattIdToString(evtParam->read.descr_id, descrId);
 			ESP_LOGD(LOG_TAG, "[status: %s, conn_id: %d, srvc_id: <%s>, char_id: <%s>, descr_id: <%s>, value_type: 0x%x, value_len: %d]",
-				BLEUtils::gattStatusToString(evtParam->read.status).c_str(),
+				BLEUtils::gattStatusToString(evtParam->read.status),
 				evtParam->read.conn_id,
-				BLEUtils::gattServiceIdToString(evtParam->read.srvc_id).c_str(),
-				gattIdToString(evtParam->read.char_id).c_str(),
-				gattIdToString(evtParam->read.descr_id).c_str(),
+				srvcId,
+				charId,
+				descrId,
 				evtParam->read.value_type,
 				evtParam->read.value_len
 			);
 			if (evtParam->read.status == ESP_GATT_OK) {
-				uint8_t *data = (uint8_t *)malloc(evtParam->read.value_len * 2 + 1);
-				BLEUtils::dumpHexData(data, (uint8_t *)evtParam->read.value, evtParam->read.value_len);
-				ESP_LOGD(LOG_TAG, "value: %s", data);
-				free(data);
+				// Only the start of a long value is shown, so the text fits on the stack.
+				char data[DUMP_VALUE_LENGTH * 2 + 1];
+				size_t length = evtParam->read.value_len < DUMP_VALUE_LENGTH ? evtParam->read.value_len : DUMP_VALUE_LENGTH;
+				GeneralUtils::formatHexBytes(evtParam->read.value, length, data);
+				ESP_LOGD(LOG_TAG, "value: %s%s", data, length < evtParam->read.value_len ? "..." : "");
 			}
 			break;
 		} // ESP_GATTC_READ_CHAR_EVT
@@ -684,7 +655,7 @@ void BLEUtils::dumpGattClientEvent(
 		//
 		case ESP_GATTC_REG_EVT: {
 			ESP_LOGD(LOG_TAG, "status: %s, client_if: 0x%x, app_id: 0x%x",
-					BLEUtils::gattStatusToString(evtParam->reg.status).c_str(),
+					BLEUtils::gattStatusToString(evtParam->reg.status),
 				//evtParam->reg.gatt_if,
 				gattc_if,
 				evtParam->reg.app_id);
@@ -696,7 +667,7 @@ void BLEUtils::dumpGattClientEvent(
 		//
 		case ESP_GATTC_SEARCH_CMPL_EVT: {
 			ESP_LOGD(LOG_TAG, "status: %s, conn_id: %d",
-					BLEUtils::gattStatusToString(evtParam->search_cmpl.status).c_str(),
+					BLEUtils::gattStatusToString(evtParam->search_cmpl.status),
 				evtParam->search_cmpl.conn_id);
 			break;
 		}
@@ -705,17 +676,16 @@ void BLEUtils::dumpGattClientEvent(
 		// ESP_GATTC_SEARCH_RES_EVT
 		//
 		case ESP_GATTC_SEARCH_RES_EVT: {
-			std::string name = "";
+			const char *name = "??";
 			if (evtParam->search_res.srvc_id.id.uuid.len == ESP_UUID_LEN_16) {
 				name = BLEUtils::gattServiceToString(evtParam->search_res.srvc_id.id.uuid.uuid.uuid16);
 			}
-			if (name.length() == 0) {
-				name = "??";
-			}
+			char srvcId[GATT_ID_STRING_LENGTH];
+			BLEUtils::gattServiceIdToString(evtParam->search_res.srvc_id, srvcId);
 
 			ESP_LOGD(LOG_TAG, "srvc_id: %s [%s], instanceId: 0x%.2x conn_id: %d",
-				BLEUtils::gattServiceIdToString(evtParam->search_res.srvc_id).c_str(),
-				name.c_str(),
+				srvcId,
+				name,
 				evtParam->search_res.srvc_id.id.inst_id,
 				evtParam->search_res.conn_id);
 			break;
@@ -731,7 +701,11 @@ void BLEUtils::dumpGattClientEvent(
 void BLEUtils::dumpGapEvent(
 	esp_gap_ble_cb_event_t event,
 	esp_ble_gap_cb_param_t *param) {
-	ESP_LOGD(LOG_TAG, "Received a GAP event: %s", gapEventToString(event).c_str());
+	if (LOG_LOCAL_LEVEL < ESP_LOG_DEBUG) {
+		return;   // Nothing would be logged, so skip the formatting.
+	}
+	ESP_LOGD(LOG_TAG, "Received a GAP event: %s", gapEventToString(event));
+	char address[GeneralUtils::MAC_STRING_LENGTH];
 	switch(event) {
 		case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT: {
 			ESP_LOGD(LOG_TAG, "[status: %d]",	param->scan_rsp_data_cmpl.status);
@@ -749,8 +723,9 @@ void BLEUtils::dumpGapEvent(
 		} // ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT
 
 		case ESP_GAP_BLE_NC_REQ_EVT: {
+			GeneralUtils::formatMac(param->ble_security.key_notif.bd_addr, address);
 			ESP_LOGD(LOG_TAG, "[bd_addr: %s, passkey: %d]",
-				BLEUtils::addressToString(param->ble_security.key_notif.bd_addr).c_str(),
+				address,
 				param->ble_security.key_notif.passkey);
 			break;
 		} // ESP_GAP_BLE_NC_REQ_EVT
@@ -775,24 +750,26 @@ void BLEUtils::dumpGapEvent(
 
 
 		case ESP_GAP_BLE_SEC_REQ_EVT: {
-			ESP_LOGD(LOG_TAG, "[bd_addr: %s]", BLEUtils::addressToString(param->ble_security.ble_req.bd_addr).c_str());
+			GeneralUtils::formatMac(param->ble_security.ble_req.bd_addr, address);
+			ESP_LOGD(LOG_TAG, "[bd_addr: %s]", address);
 			break;
 		} // ESP_GAP_BLE_SEC_REQ_EVT
 
 		case ESP_GAP_BLE_AUTH_CMPL_EVT: {
+			GeneralUtils::formatMac(param->ble_security.auth_cmpl.bd_addr, address);
 			ESP_LOGD(LOG_TAG, "[bd_addr: %s, key_present: %d, key: ***, key_type: %d, success: %d, fail_reason: %d, addr_type: ***, dev_type: %s]",
-				BLEUtils::addressToString(param->ble_security.auth_cmpl.bd_addr).c_str(),
+				address,
 				param->ble_security.auth_cmpl.key_present,
 				param->ble_security.auth_cmpl.key_type,
 				param->ble_security.auth_cmpl.success,
 				param->ble_security.auth_cmpl.fail_reason,
-				BLEUtils::devTypeToString(param->ble_security.auth_cmpl.dev_type).c_str()
+				BLEUtils::devTypeToString(param->ble_security.auth_cmpl.dev_type)
 			);
 			break;
 		} // ESP_GAP_BLE_AUTH_CMPL_EVT
 
 		default: {
-			ESP_LOGD(LOG_TAG, "*** dumpGapEvent: Logger not coded ***")
+			ESP_LOGD(LOG_TAG, "*** dumpGapEvent: Logger not coded ***");
 			break;
 		} // default
 	} // switch
@@ -813,48 +790,57 @@ void BLEUtils::dumpGattServerEvent(
 		esp_gatts_cb_event_t event,
 		esp_gatt_if_t gatts_if,
 		esp_ble_gatts_cb_param_t *evtParam) {
-	ESP_LOGD(LOG_TAG, "GATT ServerEvent: %s", bt_utils_gatt_server_event_type_to_string(event).c_str());
+	if (LOG_LOCAL_LEVEL < ESP_LOG_DEBUG) {
+		return;   // Nothing would be logged, so skip the formatting.
+	}
+	ESP_LOGD(LOG_TAG, "GATT ServerEvent: %s", bt_utils_gatt_server_event_type_to_string(event));
+	char text[GATT_ID_STRING_LENGTH];   // Big enough for an address or a UUID too.
 	switch(event) {
 
 		case ESP_GATTS_ADD_CHAR_DESCR_EVT: {
+			uuidToString(evtParam->add_char_descr.char_uuid, text);
 			ESP_LOGD(LOG_TAG, "[status: %s, attr_handle: 0x%.2x, service_handle: 0x%.2x, char_uuid: %s]",
-				gattStatusToString(evtParam->add_char_descr.status).c_str(),
+				gattStatusToString(evtParam->add_char_descr.status),
 				evtParam->add_char_descr.attr_handle,
 				evtParam->add_char_descr.service_handle,
-				uuidToString(evtParam->add_char_descr.char_uuid).c_str());
+				text);
 			break;
 		} // ESP_GATTS_ADD_CHAR_DESCR_EVT
 
 		case ESP_GATTS_ADD_CHAR_EVT: {
+			uuidToString(evtParam->add_char.char_uuid, text);
 			ESP_LOGD(LOG_TAG, "[status: %s, attr_handle: 0x%.2x, service_handle: 0x%.2x, char_uuid: %s]",
-				gattStatusToString(evtParam->add_char.status).c_str(),
+				gattStatusToString(evtParam->add_char.status),
 				evtParam->add_char.attr_handle,
 				evtParam->add_char.service_handle,
-				uuidToString(evtParam->add_char.char_uuid).c_str());
+				text);
 			break;
 		} // ESP_GATTS_ADD_CHAR_EVT
 
 		case ESP_GATTS_CONNECT_EVT: {
+			GeneralUtils::formatMac(evtParam->connect.remote_bda, text);
 			ESP_LOGD(LOG_TAG, "[conn_id: %d, remote_bda: %s, is_connected: %d]",
 				evtParam->connect.conn_id,
-				addressToString(evtParam->connect.remote_bda).c_str(),
+				text,
 				evtParam->connect.is_connected);
 			break;
 		} // ESP_GATTS_CONNECT_EVT
 
 		case ESP_GATTS_DISCONNECT_EVT: {
+			GeneralUtils::formatMac(evtParam->connect.remote_bda, text);
 			ESP_LOGD(LOG_TAG, "[conn_id: %d, remote_bda: %s, is_connected: %d]",
 				evtParam->connect.conn_id,
-				addressToString(evtParam->connect.remote_bda).c_str(),
+				text,
 				evtParam->connect.is_connected);
 			break;
 		} // ESP_GATTS_DISCONNECT_EVT
 
 		case ESP_GATTS_CREATE_EVT: {
+			gattServiceIdToString(evtParam->create.service_id, text);
 			ESP_LOGD(LOG_TAG, "[status: %s, service_handle: 0x%.2x, service_id: [%s]]",
-				gattStatusToString(evtParam->create.status).c_str(),
+				gattStatusToString(evtParam->create.status),
 				evtParam->create.service_handle,
-				gattServiceIdToString(evtParam->create.service_id).c_str());
+				text);
 			break;
 		} // ESP_GATTS_CREATE_EVT
 
@@ -866,10 +852,11 @@ void BLEUtils::dumpGattServerEvent(
 		} // ESP_GATTS_MTU_EVT
 
 		case ESP_GATTS_READ_EVT: {
+			GeneralUtils::formatMac(evtParam->read.bda, text);
 			ESP_LOGD(LOG_TAG, "[conn_id: %d, trans_id: %d, bda: %s, handle: 0x%.2x, is_long: %d, need_rsp:%d]",
 					evtParam->read.conn_id,
 					evtParam->read.trans_id,
-					addressToString(evtParam->read.bda).c_str(),
+					text,
 					evtParam->read.handle,
 					evtParam->read.is_long,
 					evtParam->read.need_rsp);
@@ -878,30 +865,31 @@ void BLEUtils::dumpGattServerEvent(
 
 		case ESP_GATTS_RESPONSE_EVT: {
 			ESP_LOGD(LOG_TAG, "[status: %s, handle: 0x%.2x]",
-				gattStatusToString(evtParam->rsp.status).c_str(),
+				gattStatusToString(evtParam->rsp.status),
 				evtParam->rsp.handle);
 			break;
 		} // ESP_GATTS_RESPONSE_EVT
 
 		case ESP_GATTS_REG_EVT: {
 			ESP_LOGD(LOG_TAG, "[status: %s, app_id: %d]",
-				gattStatusToString(evtParam->reg.status).c_str(),
+				gattStatusToString(evtParam->reg.status),
 				evtParam->reg.app_id);
 			break;
 		} // ESP_GATTS_REG_EVT
 
 		case ESP_GATTS_START_EVT: {
 			ESP_LOGD(LOG_TAG, "[status: %s, service_handle: 0x%.2x]",
-				gattStatusToString(evtParam->start.status).c_str(),
+				gattStatusToString(evtParam->start.status),
 				evtParam->start.service_handle);
 			break;
 		} // ESP_GATTS_START_EVT
 
 		case ESP_GATTS_WRITE_EVT: {
+			GeneralUtils::formatMac(evtParam->write.bda, text);
 			ESP_LOGD(LOG_TAG, "[conn_id: %d, trans_id: %d, bda: %s, handle: 0x%.2x, offset: %d, need_rsp: %d, is_prep: %d, len: %d]",
 					evtParam->write.conn_id,
 					evtParam->write.trans_id,
-					addressToString(evtParam->write.bda).c_str(),
+					text,
 					evtParam->write.handle,
 					evtParam->write.offset,
 					evtParam->write.need_rsp,
@@ -923,14 +911,8 @@ void BLEUtils::dumpGattServerEvent(
  * @return The string representation of the address.
  */
 std::string BLEUtils::addressToString(ble_address address) {
-	std::stringstream stream;
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[0] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[1] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[2] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[3] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[4] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[5];
-	return stream.str();
+	char text[GeneralUtils::MAC_STRING_LENGTH];
+	return std::string(text, GeneralUtils::formatMac((const uint8_t*)address.data(), text));
 }
 
 
@@ -941,14 +923,8 @@ std::string BLEUtils::addressToString(ble_address address) {
  * @return The string representation of the address.
  */
 std::string BLEUtils::addressToString(esp_bd_addr_t address) {
-	std::stringstream stream;
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[0] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[1] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[2] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[3] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[4] << ':';
-	stream << std::setfill('0') << std::setw(2) << std::hex << (int)((uint8_t *)(address))[5];
-	return stream.str();
+	char text[GeneralUtils::MAC_STRING_LENGTH];
+	return std::string(text, GeneralUtils::formatMac((const uint8_t*)address, text));
 }
 
 esp_bt_uuid_t BLEUtils::buildUUID(uint16_t uuid) {
@@ -1035,7 +1011,20 @@ BLEDevice* BLEUtils::findByConnId(uint16_t conn_id) {
  * @brief Convert an esp_gatt_srvc_id_t to a string.
  */
 std::string BLEUtils::gattServiceIdToString(esp_gatt_srvc_id_t srvcId) {
-	return gattIdToString(srvcId.id);
+	char text[GATT_ID_STRING_LENGTH];
+	return std::string(text, gattIdToString(srvcId.id, text));
+} // gattServiceIdToString
+
+
+/**
+ * @brief Convert an esp_gatt_srvc_id_t to a string, without allocating.
+ *
+ * @param [in] srvcId The service id to convert.
+ * @param [out] out The buffer for the text, at least GATT_ID_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t BLEUtils::gattServiceIdToString(esp_gatt_srvc_id_t srvcId, char *out) {
+	return gattIdToString(srvcId.id, out);
 } // gattServiceIdToString
 
 /**
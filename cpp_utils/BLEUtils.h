@@ -18,6 +18,8 @@ typedef std::string ble_address;
 
 class BLEUtils {
 public:
+	static const size_t GATT_ID_STRING_LENGTH = 57;   // "uuid: ", a 128 bit UUID, ", inst_id: 255" and a null.
+
 	BLEUtils();
 	virtual ~BLEUtils();
 	static std::string addressToString(ble_address address);
@@ -32,12 +34,14 @@ public:
 	static BLEDevice *findByConnId(uint16_t conn_id);
 	static BLEDevice *findByAddress(ble_address address);
 	static std::string gattServiceIdToString(esp_gatt_srvc_id_t srvcId);
-	static std::string gattStatusToString(esp_gatt_status_t status);
-	static std::string gattServiceToString(uint32_t serviceId);
+	static size_t gattServiceIdToString(esp_gatt_srvc_id_t srvcId, char *out);
+	static const char *gattStatusToString(esp_gatt_status_t status);
+	static const char *gattServiceToString(uint32_t serviceId);
 	static void registerByAddress(ble_address address, BLEDevice *pDevice);
 	static void registerByConnId(uint16_t conn_id, BLEDevice *pDevice);
 	static std::string uuidToString(esp_bt_uuid_t uuid);
-	static std::string gattCharacteristicUUIDToString(uint32_t characteristicUUID);
+	static size_t uuidToString(esp_bt_uuid_t uuid, char *out);
+	static const char *gattCharacteristicUUIDToString(uint32_t characteristicUUID);
 	static void dumpGattClientEvent(
 		esp_gattc_cb_event_t event,
 		esp_gatt_if_t gattc_if,
@@ -46,13 +50,13 @@ public:
 		esp_gatts_cb_event_t event,
 		esp_gatt_if_t gatts_if,
 		esp_ble_gatts_cb_param_t *evtParam);
-	static std::string devTypeToString(esp_bt_dev_type_t type);
+	static const char *devTypeToString(esp_bt_dev_type_t type);
 	static void dumpGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 };
 
-std::string gapEventToString(uint32_t eventType);
-std::string bt_utils_gatt_client_event_type_to_string(esp_gattc_cb_event_t eventType);
-std::string bt_utils_gatt_server_event_type_to_string(esp_gatts_cb_event_t eventType);
-std::string bt_gap_search_event_type_to_string(uint32_t searchEvt);
+const char *gapEventToString(uint32_t eventType);
+const char *bt_utils_gatt_client_event_type_to_string(esp_gattc_cb_event_t eventType);
+const char *bt_utils_gatt_server_event_type_to_string(esp_gatts_cb_event_t eventType);
+const char *bt_gap_search_event_type_to_string(uint32_t searchEvt);
 #endif // CONFIG_BT_ENABLED
 #endif /* COMPONENTS_CPP_UTILS_BLEUTILS_H_ */
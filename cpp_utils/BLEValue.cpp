@@ -0,0 +1,228 @@
+/*
+ * BLEValue.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "BLEValue.h"
+
+/**
+ * @brief Construct an empty value.
+ * @param [in] maxLength The largest value that can be set or written.
+ */
+BLEValue::BLEValue(size_t maxLength) {
+	m_data           = nullptr;
+	m_length         = 0;
+	m_capacity       = 0;
+	m_external       = false;
+	m_maxLength      = maxLength;
+	m_prepared       = nullptr;
+	m_preparedLength = 0;
+} // BLEValue
+
+
+BLEValue::~BLEValue() {
+	if (!isExternal()) {
+		free(m_data);
+	}
+	free(m_prepared);
+} // ~BLEValue
+
+
+/**
+ * @brief Discard the parts of a prepared write.
+ */
+void BLEValue::cancelPrepared() {
+	free(m_prepared);
+	m_prepared       = nullptr;
+	m_preparedLength = 0;
+} // cancelPrepared
+
+
+/**
+ * @brief Make the parts of a prepared write the value.
+ * @return False if there was no prepared write.
+ */
+bool BLEValue::commitPrepared() {
+	if (m_prepared == nullptr) {
+		return false;
+	}
+	if (!isExternal()) {
+		free(m_data);
+	}
+	m_data           = m_prepared;
+	m_length         = m_preparedLength;
+	m_capacity       = m_preparedLength;
+	m_external       = false;
+	m_prepared       = nullptr;
+	m_preparedLength = 0;
+	return true;
+} // commitPrepared
+
+
+uint8_t* BLEValue::getData() {
+	return m_data;
+} // getData
+
+
+size_t BLEValue::getLength() {
+	return m_length;
+} // getLength
+
+
+size_t BLEValue::getMaxLength() {
+	return m_maxLength;
+} // getMaxLength
+
+
+bool BLEValue::hasPrepared() {
+	return m_prepared != nullptr;
+} // hasPrepared
+
+
+/**
+ * @brief Does the value refer to memory owned by the application?
+ */
+bool BLEValue::isExternal() {
+	return m_external;
+} // isExternal
+
+
+/**
+ * @brief Add a part of a prepared write.
+ *
+ * Each part is written at its offset, so the parts can arrive in any order.  The new value ends
+ * where the furthest part ends; bytes before that which no part covers keep the current value,
+ * or are 0 past its end.  Only as much memory as the parts reach is allocated.
+ *
+ * @param [in] offset The offset in the value of the part.
+ * @param [in] data The data of the part.
+ * @param [in] length The length of the part.
+ * @return False if the part would make the value too long or memory ran out.
+ */
+bool BLEValue::prepare(uint16_t offset, const uint8_t* data, size_t length) {
+	size_t end = (size_t)offset + length;
+	if (end > m_maxLength) {
+		return false;
+	}
+	if (m_prepared == nullptr) {
+		m_prepared = (uint8_t*)malloc(end > 0 ? end : 1); // malloc(0) may return nullptr.
+		if (m_prepared == nullptr) {
+			return false;
+		}
+		m_preparedLength = 0;
+	} else if (end > m_preparedLength) {
+		uint8_t* pPrepared = (uint8_t*)realloc(m_prepared, end);
+		if (pPrepared == nullptr) {
+			return false;
+		}
+		m_prepared = pPrepared;
+	}
+	if (end > m_preparedLength) {
+		// Fill the gap before the part from the current value.
+		size_t from = m_preparedLength;
+		size_t copy = 0;
+		if (offset > from && m_length > from) {
+			copy = (m_length < offset ? m_length : offset) - from;
+			memcpy(m_prepared + from, m_data + from, copy);
+		}
+		if (offset > from + copy) {
+			memset(m_prepared + from + copy, 0, offset - from - copy);
+		}
+		m_preparedLength = end;
+	}
+	if (length > 0) {
+		memcpy(m_prepared + offset, data, length);
+	}
+	return true;
+} // prepare
+
+
+/**
+ * @brief Copy part of the value.
+ * @param [in] offset The offset in the value to copy from.
+ * @param [out] out Where to copy to.
+ * @param [in] maxLength The most bytes to copy.
+ * @return The number of bytes copied, 0 if the offset is at or past the end of the value.
+ */
+size_t BLEValue::read(size_t offset, uint8_t* out, size_t maxLength) {
+	if (offset >= m_length) {
+		return 0;
+	}
+	size_t length = m_length - offset;
+	if (length > maxLength) {
+		length = maxLength;
+	}
+	memcpy(out, m_data + offset, length);
+	return length;
+} // read
+
+
+/**
+ * @brief Make the value refer to memory owned by the application.
+ *
+ * The memory is not copied, and must stay valid until the value is set again.  It can be larger
+ * than the maximum length; reads of it go on by offset.  A write from a client replaces it with
+ * a value of its own.
+ *
+ * @param [in] data The memory.
+ * @param [in] length The length of the value.
+ */
+void BLEValue::setExternal(uint8_t* data, size_t length) {
+	if (!isExternal()) {
+		free(m_data);
+	}
+	m_data     = data;
+	m_length   = length;
+	m_capacity = 0;
+	m_external = true;
+} // setExternal
+
+
+void BLEValue::setMaxLength(size_t maxLength) {
+	m_maxLength = maxLength;
+} // setMaxLength
+
+
+/**
+ * @brief Set the value to a copy of some data.
+ *
+ * The memory of the value is reused if it is large enough, and otherwise replaced by a block of
+ * exactly the new length.
+ *
+ * @param [in] data The data.
+ * @param [in] length The length of the data.
+ * @return False if the data is longer than the maximum length or memory ran out.
+ */
+bool BLEValue::setValue(const uint8_t* data, size_t length) {
+	if (length > m_maxLength) {
+		return false;
+	}
+	if (isExternal()) {
+		m_data     = nullptr;
+		m_length   = 0;
+		m_external = false;
+	}
+	if (!reserve(length)) {
+		return false;
+	}
+	memmove(m_data, data, length);
+	m_length = length;
+	return true;
+} // setValue
+
+
+bool BLEValue::reserve(size_t capacity) {
+	if (capacity <= m_capacity) {
+		return true;
+	}
+	uint8_t* pData = (uint8_t*)realloc(m_data, capacity);
+	if (pData == nullptr) {
+		return false;
+	}
+	m_data     = pData;
+	m_capacity = capacity;
+	return true;
+} // reserve
@@ -0,0 +1,56 @@
+/*
+ * BLEValue.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEVALUE_H_
+#define COMPONENTS_CPP_UTILS_BLEVALUE_H_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The value of a characteristic or descriptor.
+ *
+ * The value is held in a heap block sized to it, rather than in a block of the largest size an
+ * attribute can have.  Alternatively it can refer to memory owned by the application, such as a
+ * firmware image or a log buffer, which is then read in place and never copied.
+ *
+ * A value also collects the parts of a prepared (long) write, which replace the value only when
+ * the write is executed.
+ */
+class BLEValue {
+public:
+	BLEValue(size_t maxLength);
+	~BLEValue();
+
+	void     cancelPrepared();
+	bool     commitPrepared();
+	uint8_t* getData();
+	size_t   getLength();
+	size_t   getMaxLength();
+	bool     hasPrepared();
+	bool     isExternal();
+	bool     prepare(uint16_t offset, const uint8_t* data, size_t length);
+	size_t   read(size_t offset, uint8_t* out, size_t maxLength);
+	void     setExternal(uint8_t* data, size_t length);
+	void     setMaxLength(size_t maxLength);
+	bool     setValue(const uint8_t* data, size_t length);
+
+private:
+	BLEValue(const BLEValue&);
+	BLEValue& operator=(const BLEValue&);
+
+	bool reserve(size_t capacity);
+
+	uint8_t* m_data;
+	size_t   m_length;
+	size_t   m_capacity;         // The size of m_data, if owned.
+	bool     m_external;         // Is m_data owned by the application?
+	size_t   m_maxLength;
+	uint8_t* m_prepared;         // The value being built by a prepared write, or nullptr.
+	size_t   m_preparedLength;
+}; // BLEValue
+
+#endif /* COMPONENTS_CPP_UTILS_BLEVALUE_H_ */
@@ -0,0 +1,911 @@
+/*
+ * CBOR.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <errno.h>
+#include <esp_log.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CBOR.h"
+#include "GeneralUtils.h"
+#include "sdkconfig.h"
+
+static const char* LOG_TAG = "CBOR";
+
+// The major types of RFC 7049 section 2.1.
+static const uint8_t MAJOR_UNSIGNED = 0;
+static const uint8_t MAJOR_NEGATIVE = 1;
+static const uint8_t MAJOR_BYTES    = 2;
+static const uint8_t MAJOR_TEXT     = 3;
+static const uint8_t MAJOR_ARRAY    = 4;
+static const uint8_t MAJOR_MAP      = 5;
+static const uint8_t MAJOR_TAG      = 6;
+static const uint8_t MAJOR_SIMPLE   = 7;
+
+static const uint8_t CBOR_FALSE  = 0xf4;
+static const uint8_t CBOR_TRUE   = 0xf5;
+static const uint8_t CBOR_NULL   = 0xf6;
+static const uint8_t CBOR_HALF   = 0xf9;
+static const uint8_t CBOR_FLOAT  = 0xfa;
+static const uint8_t CBOR_DOUBLE = 0xfb;
+static const uint8_t CBOR_BREAK  = 0xff;
+static const uint8_t INDEFINITE  = 31;
+
+
+/**
+ * @brief Convert a double to half precision if that can be done exactly.
+ * @param [in] value The value.
+ * @param [out] pHalf The half precision bits.
+ * @return True if the value is exactly representable.
+ */
+static bool toHalf(double value, uint16_t* pHalf) {
+	float f = value;
+	if ((double)f != value && !isnan(value)) {
+		return false;
+	}
+	uint32_t bits;
+	::memcpy(&bits, &f, sizeof(bits));
+	uint16_t sign     = (bits >> 16) & 0x8000;
+	int      exponent = (int)((bits >> 23) & 0xff) - 127;
+	uint32_t mantissa = bits & 0x7fffff;
+	if ((bits & 0x7fffffff) == 0) {
+		*pHalf = sign;                                          // Zero
+	} else if (exponent == 128) {
+		*pHalf = sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);   // Infinity or NaN
+	} else if (exponent > 15 || exponent < -24) {
+		return false;
+	} else if (exponent >= -14) {
+		if (mantissa & 0x1fff) {
+			return false;
+		}
+		*pHalf = sign | ((exponent + 15) << 10) | (mantissa >> 13);
+	} else {
+		// Subnormal: the value is a multiple of 2^-24.
+		uint32_t full  = mantissa | 0x800000;
+		int      shift = -exponent - 1;
+		if (full & ((1u << shift) - 1)) {
+			return false;
+		}
+		*pHalf = sign | (full >> shift);
+	}
+	return true;
+} // toHalf
+
+
+static double fromHalf(uint16_t half) {
+	int    exponent = (half >> 10) & 0x1f;
+	int    mantissa = half & 0x3ff;
+	double value;
+	if (exponent == 0) {
+		value = ldexp(mantissa, -24);
+	} else if (exponent != 31) {
+		value = ldexp(mantissa + 1024, exponent - 25);
+	} else {
+		value = mantissa == 0 ? INFINITY : NAN;
+	}
+	return (half & 0x8000) ? -value : value;
+} // fromHalf
+
+
+/**
+ * @brief Passes the events of a JSON parse to a CborWriter.
+ */
+class JsonToCbor: public JsonParserHandler {
+public:
+	JsonToCbor(CborWriter* pWriter) {
+		m_pWriter = pWriter;
+	}
+	void onStartObject() override { m_pWriter->beginObject(); }
+	void onEndObject() override   { m_pWriter->endObject(); }
+	void onStartArray() override  { m_pWriter->beginArray(); }
+	void onEndArray() override    { m_pWriter->endArray(); }
+	void onKey(const char* key, size_t length) override        { m_pWriter->key(std::string(key, length)); }
+	void onString(const char* value, size_t length) override   { m_pWriter->value(std::string(value, length)); }
+	void onBoolean(bool value) override                        { m_pWriter->value(value); }
+	void onNull() override                                     { m_pWriter->valueNull(); }
+	void onNumber(double value, const char* text, size_t length) override {
+		// Integers too long for a double to hold exactly are taken from the text.
+		if (strpbrk(text, ".eE") == nullptr && !(value == 0 && text[0] == '-')) {
+			errno = 0;
+			long long integer = strtoll(text, nullptr, 10);
+			if (errno == 0) {
+				m_pWriter->value((int64_t)integer);
+				return;
+			}
+		}
+		m_pWriter->value(value);
+	}
+
+private:
+	CborWriter* m_pWriter;
+}; // JsonToCbor
+
+
+/**
+ * @brief Passes the events of a CBOR parse to a JsonWriter.
+ */
+class CborToJson: public JsonParserHandler {
+public:
+	CborToJson(JsonWriter* pWriter) {
+		m_pWriter = pWriter;
+	}
+	void onStartObject() override { m_pWriter->beginObject(); }
+	void onEndObject() override   { m_pWriter->endObject(); }
+	void onStartArray() override  { m_pWriter->beginArray(); }
+	void onEndArray() override    { m_pWriter->endArray(); }
+	void onKey(const char* key, size_t length) override                   { m_pWriter->key(std::string(key, length)); }
+	void onString(const char* value, size_t length) override              { m_pWriter->value(std::string(value, length)); }
+	void onNumber(double value, const char* text, size_t length) override { m_pWriter->raw(text, length); }
+	void onBoolean(bool value) override                                   { m_pWriter->value(value); }
+	void onNull() override                                                { m_pWriter->valueNull(); }
+
+private:
+	JsonWriter* m_pWriter;
+}; // CborToJson
+
+
+/**
+ * @brief Convert JSON text to CBOR.
+ * @param [in] json The JSON text.
+ * @return The CBOR encoding, or an empty string if the JSON is not valid.
+ */
+std::string CBOR::fromJson(const std::string& json) {
+	std::string    out;
+	JsonStringSink sink(&out);
+	CborWriter     writer(&sink);
+	JsonToCbor     handler(&writer);
+	JsonParser     parser(&handler);
+	if (!parser.parse(json)) {
+		ESP_LOGE(LOG_TAG, "fromJson: %s", parser.getError().c_str());
+		return "";
+	}
+	writer.finish();
+	return out;
+} // fromJson
+
+
+/**
+ * @brief Convert CBOR to JSON text.
+ * @param [in] data The CBOR encoding.
+ * @param [in] length The length of the encoding.
+ * @return The JSON text, or an empty string if the CBOR is not valid.
+ */
+std::string CBOR::toJson(const uint8_t* data, size_t length) {
+	std::string    out;
+	JsonStringSink sink(&out);
+	JsonWriter     writer(&sink);
+	CborToJson     handler(&writer);
+	CborParser     parser(&handler);
+	if (!parser.parse(data, length)) {
+		ESP_LOGE(LOG_TAG, "toJson: %s", parser.getError().c_str());
+		return "";
+	}
+	writer.finish();
+	return out;
+} // toJson
+
+
+/**
+ * @brief Convert CBOR to JSON text.
+ * @param [in] cbor The CBOR encoding.
+ * @return The JSON text, or an empty string if the CBOR is not valid.
+ */
+std::string CBOR::toJson(const std::string& cbor) {
+	return toJson((const uint8_t*)cbor.data(), cbor.length());
+} // toJson
+
+
+/**
+ * @brief Create a writer.
+ * @param [in] pSink Where the CBOR is sent.
+ * @param [in] bufferSize The size of the buffer that collects output for the sink.
+ */
+CborWriter::CborWriter(JsonSink* pSink, size_t bufferSize) {
+	m_pSink      = pSink;
+	m_bufferSize = bufferSize > 0 ? bufferSize : 1;
+	m_buffer     = new uint8_t[m_bufferSize];
+	m_length     = 0;
+	m_arrays     = 0;
+	m_depth      = 0;
+	m_afterKey   = false;
+	m_ok         = true;
+} // CborWriter
+
+
+/**
+ * @brief Destroy the writer, first writing any buffered output to the sink.
+ */
+CborWriter::~CborWriter() {
+	flush();
+	delete[] m_buffer;
+} // ~CborWriter
+
+
+/**
+ * @brief Begin an array.
+ * @return A builder for the elements of the array.
+ */
+CborArray CborWriter::beginArray() {
+	begin(true);
+	return CborArray(this);
+} // beginArray
+
+
+/**
+ * @brief Begin a map.
+ * @return A builder for the members of the map.
+ */
+CborObject CborWriter::beginObject() {
+	begin(false);
+	return CborObject(this);
+} // beginObject
+
+
+/**
+ * @brief End the current array.
+ */
+CborWriter& CborWriter::endArray() {
+	end(true);
+	return *this;
+} // endArray
+
+
+/**
+ * @brief End the current map.
+ */
+CborWriter& CborWriter::endObject() {
+	end(false);
+	return *this;
+} // endObject
+
+
+/**
+ * @brief Complete the item: flush the buffer and tell the sink there is no more.
+ * @return True if the whole item was written.
+ */
+bool CborWriter::finish() {
+	if (m_depth != 0) {
+		ESP_LOGE(LOG_TAG, "finish: %d containers still open", m_depth);
+		m_ok = false;
+	}
+	flush();
+	m_pSink->finish();
+	return m_ok;
+} // finish
+
+
+/**
+ * @brief Write the buffered output to the sink.
+ * @return True if everything written so far has reached the sink.
+ */
+bool CborWriter::flush() {
+	if (m_length > 0 && m_ok && !m_pSink->write(m_buffer, m_length)) {
+		m_ok = false;
+	}
+	m_length = 0;
+	return m_ok;
+} // flush
+
+
+/**
+ * @brief Determine whether the item is well formed and the sink has accepted it so far.
+ * @return False after a sink error or a misplaced key or value.
+ */
+bool CborWriter::isOk() {
+	return m_ok;
+} // isOk
+
+
+/**
+ * @brief Write the key of the next member of the current map.
+ * @param [in] name The key.
+ */
+CborWriter& CborWriter::key(const char* name) {
+	if (m_depth == 0 || ((m_arrays >> (m_depth - 1)) & 1) || m_afterKey) {
+		ESP_LOGE(LOG_TAG, "key: %s: not expecting a key", name);
+		m_ok = false;
+		return *this;
+	}
+	size_t length = strlen(name);
+	putHead(MAJOR_TEXT, length);
+	put((const uint8_t*)name, length);
+	m_afterKey = true;
+	return *this;
+} // key
+
+
+/**
+ * @brief Write the key of the next member of the current map.
+ * @param [in] name The key.
+ */
+CborWriter& CborWriter::key(const std::string& name) {
+	return key(name.c_str());
+} // key
+
+
+/**
+ * @brief Write a boolean value.
+ */
+CborWriter& CborWriter::value(bool value) {
+	if (separate()) {
+		put(value ? CBOR_TRUE : CBOR_FALSE);
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write an integer value.
+ */
+CborWriter& CborWriter::value(int value) {
+	return this->value((int64_t)value);
+} // value
+
+
+/**
+ * @brief Write an unsigned integer value.
+ */
+CborWriter& CborWriter::value(uint32_t value) {
+	if (separate()) {
+		putHead(MAJOR_UNSIGNED, value);
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a 64 bit integer value.
+ */
+CborWriter& CborWriter::value(int64_t value) {
+	if (separate()) {
+		if (value < 0) {
+			putHead(MAJOR_NEGATIVE, (uint64_t)(-1 - value));
+		} else {
+			putHead(MAJOR_UNSIGNED, value);
+		}
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a number in the fewest bytes that hold it exactly.
+ */
+CborWriter& CborWriter::value(double value) {
+	if (!separate()) {
+		return *this;
+	}
+	uint16_t half;
+	if (value == floor(value) && fabs(value) < 9.2e18 && !(value == 0 && signbit(value))) {
+		int64_t integer = value;
+		putHead(integer < 0 ? MAJOR_NEGATIVE : MAJOR_UNSIGNED, integer < 0 ? (uint64_t)(-1 - integer) : integer);
+	} else if (toHalf(value, &half)) {
+		uint8_t bytes[] = { CBOR_HALF, (uint8_t)(half >> 8), (uint8_t)half };
+		put(bytes, sizeof(bytes));
+	} else if ((double)(float)value == value) {
+		float    f = value;
+		uint32_t bits;
+		::memcpy(&bits, &f, sizeof(bits));
+		uint8_t bytes[] = { CBOR_FLOAT, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits };
+		put(bytes, sizeof(bytes));
+	} else {
+		uint64_t bits;
+		::memcpy(&bits, &value, sizeof(bits));
+		put(CBOR_DOUBLE);
+		for (int shift = 56; shift >= 0; shift -= 8) {
+			put((uint8_t)(bits >> shift));
+		}
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a text string value.
+ */
+CborWriter& CborWriter::value(const char* value) {
+	if (separate()) {
+		size_t length = strlen(value);
+		putHead(MAJOR_TEXT, length);
+		put((const uint8_t*)value, length);
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a text string value.
+ */
+CborWriter& CborWriter::value(const std::string& value) {
+	if (separate()) {
+		putHead(MAJOR_TEXT, value.length());
+		put((const uint8_t*)value.data(), value.length());
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a byte string value.
+ * @param [in] data The bytes.
+ * @param [in] length The number of bytes.
+ */
+CborWriter& CborWriter::value(const uint8_t* data, size_t length) {
+	if (separate()) {
+		putHead(MAJOR_BYTES, length);
+		put(data, length);
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a null value.
+ */
+CborWriter& CborWriter::valueNull() {
+	if (separate()) {
+		put(CBOR_NULL);
+	}
+	return *this;
+} // valueNull
+
+
+bool CborWriter::begin(bool isArray) {
+	if (m_depth == MAX_DEPTH) {
+		ESP_LOGE(LOG_TAG, "begin: nested too deeply");
+		m_ok = false;
+		return false;
+	}
+	if (!separate()) {
+		return false;
+	}
+	put((isArray ? MAJOR_ARRAY : MAJOR_MAP) << 5 | INDEFINITE);
+	if (isArray) {
+		m_arrays |= 1UL << m_depth;
+	} else {
+		m_arrays &= ~(1UL << m_depth);
+	}
+	m_depth++;
+	return true;
+} // begin
+
+
+bool CborWriter::end(bool isArray) {
+	if (m_depth == 0 || ((m_arrays >> (m_depth - 1)) & 1) != isArray || m_afterKey) {
+		ESP_LOGE(LOG_TAG, "end: no %s to end", isArray ? "array" : "map");
+		m_ok = false;
+		return false;
+	}
+	m_depth--;
+	put(CBOR_BREAK);
+	return true;
+} // end
+
+
+/**
+ * @brief Check a value is allowed here.
+ */
+bool CborWriter::separate() {
+	if (m_afterKey) {
+		m_afterKey = false;
+		return true;
+	}
+	if (m_depth > 0 && !((m_arrays >> (m_depth - 1)) & 1)) {
+		ESP_LOGE(LOG_TAG, "value: a member of a map needs a key");
+		m_ok = false;
+		return false;
+	}
+	return true;
+} // separate
+
+
+void CborWriter::put(uint8_t c) {
+	if (m_length == m_bufferSize) {
+		flush();
+	}
+	m_buffer[m_length++] = c;
+} // put
+
+
+void CborWriter::put(const uint8_t* data, size_t length) {
+	while (length > 0) {
+		if (m_length == m_bufferSize) {
+			flush();
+		}
+		size_t count = m_bufferSize - m_length;
+		if (count > length) {
+			count = length;
+		}
+		::memcpy(m_buffer + m_length, data, count);
+		m_length += count;
+		data     += count;
+		length   -= count;
+	}
+} // put
+
+
+/**
+ * @brief Write the initial byte of an item and its argument, in the shortest form.
+ */
+void CborWriter::putHead(uint8_t major, uint64_t value) {
+	uint8_t bytes[9];
+	int     size;
+	if (value < 24) {
+		bytes[0] = major << 5 | value;
+		size = 0;
+	} else if (value <= 0xff) {
+		bytes[0] = major << 5 | 24;
+		size = 1;
+	} else if (value <= 0xffff) {
+		bytes[0] = major << 5 | 25;
+		size = 2;
+	} else if (value <= 0xffffffff) {
+		bytes[0] = major << 5 | 26;
+		size = 4;
+	} else {
+		bytes[0] = major << 5 | 27;
+		size = 8;
+	}
+	for (int i = 0; i < size; i++) {
+		bytes[size - i] = value >> (8 * i);
+	}
+	put(bytes, size + 1);
+} // putHead
+
+
+CborArray::CborArray(CborWriter* pWriter) {
+	m_pWriter = pWriter;
+} // CborArray
+
+
+/**
+ * @brief Add an array to the array.
+ * @return A builder for the new array, which must be ended before the next element is added.
+ */
+CborArray CborArray::addArray() {
+	return m_pWriter->beginArray();
+} // addArray
+
+
+/**
+ * @brief Add a boolean to the array.
+ */
+void CborArray::addBoolean(bool value) {
+	m_pWriter->value(value);
+} // addBoolean
+
+
+/**
+ * @brief Add a double to the array.
+ */
+void CborArray::addDouble(double value) {
+	m_pWriter->value(value);
+} // addDouble
+
+
+/**
+ * @brief Add an integer to the array.
+ */
+void CborArray::addInt(int value) {
+	m_pWriter->value(value);
+} // addInt
+
+
+/**
+ * @brief Add an object to the array.
+ * @return A builder for the new object, which must be ended before the next element is added.
+ */
+CborObject CborArray::addObject() {
+	return m_pWriter->beginObject();
+} // addObject
+
+
+/**
+ * @brief Add a string to the array.
+ */
+void CborArray::addString(std::string value) {
+	m_pWriter->value(value);
+} // addString
+
+
+/**
+ * @brief End the array.
+ */
+void CborArray::end() {
+	m_pWriter->endArray();
+} // end
+
+
+CborObject::CborObject(CborWriter* pWriter) {
+	m_pWriter = pWriter;
+} // CborObject
+
+
+/**
+ * @brief Set the named array property.
+ * @return A builder for the new array, which must be ended before the next property is set.
+ */
+CborArray CborObject::setArray(std::string name) {
+	m_pWriter->key(name);
+	return m_pWriter->beginArray();
+} // setArray
+
+
+/**
+ * @brief Set the named boolean property.
+ */
+void CborObject::setBoolean(std::string name, bool value) {
+	m_pWriter->key(name).value(value);
+} // setBoolean
+
+
+/**
+ * @brief Set the named double property.
+ */
+void CborObject::setDouble(std::string name, double value) {
+	m_pWriter->key(name).value(value);
+} // setDouble
+
+
+/**
+ * @brief Set the named integer property.
+ */
+void CborObject::setInt(std::string name, int value) {
+	m_pWriter->key(name).value(value);
+} // setInt
+
+
+/**
+ * @brief Set the named object property.
+ * @return A builder for the new object, which must be ended before the next property is set.
+ */
+CborObject CborObject::setObject(std::string name) {
+	m_pWriter->key(name);
+	return m_pWriter->beginObject();
+} // setObject
+
+
+/**
+ * @brief Set the named string property.
+ */
+void CborObject::setString(std::string name, std::string value) {
+	m_pWriter->key(name).value(value);
+} // setString
+
+
+/**
+ * @brief End the object.
+ */
+void CborObject::end() {
+	m_pWriter->endObject();
+} // end
+
+
+/**
+ * @brief Create a parser.
+ * @param [in] pHandler The handler told of each item decoded.
+ */
+CborParser::CborParser(JsonParserHandler* pHandler) {
+	m_pHandler = pHandler;
+	m_data     = nullptr;
+	m_length   = 0;
+	m_position = 0;
+	m_error    = nullptr;
+} // CborParser
+
+
+/**
+ * @brief Get the reason the last parse failed.
+ * @return The error, with the offset at which it was found.
+ */
+std::string CborParser::getError() {
+	if (m_error == nullptr) {
+		return "";
+	}
+	char text[100];
+	snprintf(text, sizeof(text), "%s at offset %d", m_error, (int)m_position);
+	return text;
+} // getError
+
+
+/**
+ * @brief Get the offset of the next byte to be decoded.
+ */
+size_t CborParser::getPosition() {
+	return m_position;
+} // getPosition
+
+
+/**
+ * @brief Decode one CBOR item.
+ * @param [in] data The encoding.
+ * @param [in] length The length of the encoding.
+ * @return True if the data is exactly one well formed item.
+ */
+bool CborParser::parse(const uint8_t* data, size_t length) {
+	m_data     = data;
+	m_length   = length;
+	m_position = 0;
+	m_error    = nullptr;
+	if (!readItem(0, false)) {
+		return false;
+	}
+	if (m_position != m_length) {
+		return fail("unexpected data after the item");
+	}
+	return true;
+} // parse
+
+
+/**
+ * @brief Decode one CBOR item.
+ * @param [in] data The encoding.
+ * @return True if the data is exactly one well formed item.
+ */
+bool CborParser::parse(const std::string& data) {
+	return parse((const uint8_t*)data.data(), data.length());
+} // parse
+
+
+bool CborParser::fail(const char* error) {
+	m_error = error;
+	ESP_LOGD(LOG_TAG, "%s at offset %d", error, (int)m_position);
+	return false;
+} // fail
+
+
+/**
+ * @brief Read the initial byte of an item and its argument.
+ */
+bool CborParser::readHead(uint8_t* pMajor, uint8_t* pInfo, uint64_t* pValue) {
+	if (m_position >= m_length) {
+		return fail("truncated");
+	}
+	uint8_t initial = m_data[m_position++];
+	*pMajor = initial >> 5;
+	*pInfo  = initial & 0x1f;
+	*pValue = 0;
+	if (*pInfo < 24) {
+		*pValue = *pInfo;
+	} else if (*pInfo <= 27) {
+		size_t size = 1 << (*pInfo - 24);
+		if (size > m_length - m_position) {
+			return fail("truncated");
+		}
+		for (size_t i = 0; i < size; i++) {
+			*pValue = *pValue << 8 | m_data[m_position++];
+		}
+	} else if (*pInfo != INDEFINITE) {
+		return fail("reserved additional information");
+	} else if (*pMajor == MAJOR_UNSIGNED || *pMajor == MAJOR_NEGATIVE || *pMajor == MAJOR_TAG) {
+		return fail("invalid indefinite length");
+	}
+	return true;
+} // readHead
+
+
+bool CborParser::readItem(int depth, bool isKey) {
+	uint8_t  major;
+	uint8_t  info;
+	uint64_t value;
+	char     text[32];
+	if (depth > MAX_DEPTH) {
+		return fail("nested too deeply");
+	}
+	if (!readHead(&major, &info, &value)) {
+		return false;
+	}
+	switch (major) {
+		case MAJOR_UNSIGNED:
+		case MAJOR_NEGATIVE: {
+			int length;
+			double number;
+			if (major == MAJOR_UNSIGNED) {
+				length = snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+				number = value;
+			} else if (value < 0xffffffffffffffffULL) {
+				length = snprintf(text, sizeof(text), "-%llu", (unsigned long long)(value + 1));
+				number = -1.0 - (double)value;
+			} else {
+				length = snprintf(text, sizeof(text), "-18446744073709551616");
+				number = -1.0 - (double)value;
+			}
+			if (isKey) {
+				m_pHandler->onKey(text, length);
+			} else {
+				m_pHandler->onNumber(number, text, length);
+			}
+			return true;
+		}
+
+		case MAJOR_BYTES:
+		case MAJOR_TEXT: {
+			if (info == INDEFINITE) {
+				return fail("indefinite length strings are not supported");
+			}
+			if (value > m_length - m_position) {
+				return fail("truncated");
+			}
+			const char* p = (const char*)m_data + m_position;
+			m_position += value;
+			if (major == MAJOR_BYTES) {
+				if (isKey) {
+					return fail("map keys must be strings or integers");
+				}
+				std::string   encoded(Base64Encoder::getEncodedLength(value), 0);
+				Base64Encoder encoder(true);
+				size_t length = encoder.encode((const uint8_t*)p, value, &encoded[0]);
+				length += encoder.finish(&encoded[length]);
+				m_pHandler->onString(encoded.data(), length);
+			} else if (isKey) {
+				m_pHandler->onKey(p, value);
+			} else {
+				m_pHandler->onString(p, value);
+			}
+			return true;
+		}
+
+		case MAJOR_ARRAY:
+		case MAJOR_MAP: {
+			if (isKey) {
+				return fail("map keys must be strings or integers");
+			}
+			bool isMap = major == MAJOR_MAP;
+			isMap ? m_pHandler->onStartObject() : m_pHandler->onStartArray();
+			for (uint64_t i = 0; info == INDEFINITE || i < value; i++) {
+				if (info == INDEFINITE && m_position < m_length && m_data[m_position] == CBOR_BREAK) {
+					m_position++;
+					break;
+				}
+				if (!readItem(depth + 1, isMap) || (isMap && !readItem(depth + 1, false))) {
+					return false;
+				}
+			}
+			isMap ? m_pHandler->onEndObject() : m_pHandler->onEndArray();
+			return true;
+		}
+
+		case MAJOR_TAG:
+			return readItem(depth, isKey); // The tagged item is reported as itself.
+
+		default: // MAJOR_SIMPLE
+			if (info == INDEFINITE) {
+				return fail("unexpected break");
+			}
+			if (isKey) {
+				return fail("map keys must be strings or integers");
+			}
+			if (info == 20 || info == 21) {
+				m_pHandler->onBoolean(info == 21);
+			} else if (info >= 25 && info <= 27) {
+				double number;
+				if (info == 25) {
+					number = fromHalf(value);
+				} else if (info == 26) {
+					uint32_t bits = value;
+					float    f;
+					::memcpy(&f, &bits, sizeof(f));
+					number = f;
+				} else {
+					::memcpy(&number, &value, sizeof(number));
+				}
+				if (!isfinite(number)) {
+					m_pHandler->onNull(); // JSON has no infinity or NaN.
+					return true;
+				}
+				int length = snprintf(text, sizeof(text), "%.15g", number);
+				if (strtod(text, nullptr) != number) {
+					length = snprintf(text, sizeof(text), "%.17g", number);
+				}
+				m_pHandler->onNumber(number, text, length);
+			} else {
+				m_pHandler->onNull(); // null, undefined and other simple values.
+			}
+			return true;
+	}
+} // readItem
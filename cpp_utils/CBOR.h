@@ -0,0 +1,181 @@
+/*
+ * CBOR.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_CBOR_H_
+#define COMPONENTS_CPP_UTILS_CBOR_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "JSONParser.h"
+#include "JSONWriter.h"
+
+// Forward declarations
+class CborArray;
+class CborObject;
+
+/**
+ * @brief Conversion between CBOR (RFC 7049) and JSON text.
+ *
+ * Intended for debugging: log the JSON form of a CBOR payload, or build a CBOR test payload
+ * from JSON.
+ */
+class CBOR {
+public:
+	static std::string fromJson(const std::string& json);
+	static std::string toJson(const uint8_t* data, size_t length);
+	static std::string toJson(const std::string& cbor);
+}; // CBOR
+
+
+/**
+ * @brief Write CBOR to a sink as it is generated.
+ *
+ * The CBOR counterpart of JsonWriter, sending its output to the same sinks.  Arrays and maps
+ * are written with indefinite length so that nothing need be known in advance.  Numbers are
+ * written in their shortest exact form: integral doubles as integers, and others as half,
+ * single or double precision floats.  A typical sensor record is around half the size of its
+ * JSON text.
+ *
+ * The CborObject and CborArray builders returned by beginObject() and beginArray() give the
+ * same shape of API as JsonObject and JsonArray:
+ *
+ * @code{.cpp}
+ * std::string payload;
+ * JsonStringSink sink(&payload);
+ * CborWriter writer(&sink);
+ * CborObject record = writer.beginObject();
+ * record.setInt("t", now);
+ * record.setDouble("temp", 21.5);
+ * CborArray samples = record.setArray("samples");
+ * for (auto s: history) samples.addDouble(s);
+ * samples.end();
+ * record.end();
+ * writer.finish();
+ * aws.publish("sensors/1", payload);
+ * @endcode
+ */
+class CborWriter {
+public:
+	static const int MAX_DEPTH = 32;
+
+	CborWriter(JsonSink* pSink, size_t bufferSize = 128);
+	virtual ~CborWriter();
+	CborArray   beginArray();
+	CborObject  beginObject();
+	CborWriter& endArray();
+	CborWriter& endObject();
+	bool        finish();
+	bool        flush();
+	bool        isOk();
+	CborWriter& key(const char* name);
+	CborWriter& key(const std::string& name);
+	CborWriter& value(bool value);
+	CborWriter& value(int value);
+	CborWriter& value(uint32_t value);
+	CborWriter& value(int64_t value);
+	CborWriter& value(double value);
+	CborWriter& value(const char* value);
+	CborWriter& value(const std::string& value);
+	CborWriter& value(const uint8_t* data, size_t length);
+	CborWriter& valueNull();
+
+private:
+	bool begin(bool isArray);
+	bool end(bool isArray);
+	bool separate();
+	void put(uint8_t c);
+	void put(const uint8_t* data, size_t length);
+	void putHead(uint8_t major, uint64_t value);
+
+	JsonSink* m_pSink;
+	uint8_t*  m_buffer;
+	size_t    m_bufferSize;
+	size_t    m_length;
+	uint32_t  m_arrays;    // Bit n set if the container at depth n is an array.
+	int       m_depth;
+	bool      m_afterKey;
+	bool      m_ok;
+}; // CborWriter
+
+
+/**
+ * @brief A CBOR array being written.
+ *
+ * Unlike a JsonArray, the elements are written as they are added, so a nested object or array
+ * must be ended before the next element is added.
+ */
+class CborArray {
+public:
+	CborArray(CborWriter* pWriter);
+	CborArray  addArray();
+	void       addBoolean(bool value);
+	void       addDouble(double value);
+	void       addInt(int value);
+	CborObject addObject();
+	void       addString(std::string value);
+	void       end();
+
+private:
+	CborWriter* m_pWriter;
+}; // CborArray
+
+
+/**
+ * @brief A CBOR map being written, with string keys.
+ *
+ * Unlike a JsonObject, the members are written as they are set, so a nested object or array
+ * must be ended before the next member is set.
+ */
+class CborObject {
+public:
+	CborObject(CborWriter* pWriter);
+	CborArray  setArray(std::string name);
+	void       setBoolean(std::string name, bool value);
+	void       setDouble(std::string name, double value);
+	void       setInt(std::string name, int value);
+	CborObject setObject(std::string name);
+	void       setString(std::string name, std::string value);
+	void       end();
+
+private:
+	CborWriter* m_pWriter;
+}; // CborObject
+
+
+/**
+ * @brief Decode CBOR, reporting what is found to a JsonParserHandler.
+ *
+ * Any handler written for JsonParser, such as JsonPathExtractor or JsonStructReader, can so
+ * read CBOR too.  Integers are reported as numbers, with their exact decimal text.  Byte
+ * strings are reported as base64url strings and tags are ignored, as RFC 7049 suggests for
+ * conversion to JSON.  Map keys must be strings or integers.
+ *
+ * The whole item must be in memory; it is not decoded incrementally.
+ */
+class CborParser {
+public:
+	static const int MAX_DEPTH = 32;
+
+	CborParser(JsonParserHandler* pHandler);
+	std::string getError();
+	size_t      getPosition();
+	bool        parse(const uint8_t* data, size_t length);
+	bool        parse(const std::string& data);
+
+private:
+	bool fail(const char* error);
+	bool readHead(uint8_t* pMajor, uint8_t* pInfo, uint64_t* pValue);
+	bool readItem(int depth, bool isKey);
+
+	JsonParserHandler* m_pHandler;
+	const uint8_t*     m_data;
+	size_t             m_length;
+	size_t             m_position;
+	const char*        m_error;
+}; // CborParser
+
+#endif /* COMPONENTS_CPP_UTILS_CBOR_H_ */
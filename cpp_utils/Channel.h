@@ -0,0 +1,205 @@
+/*
+ * Channel.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_CHANNEL_H_
+#define COMPONENTS_CPP_UTILS_CHANNEL_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "FreeRTOS.h"
+#include "MPSCQueue.h"
+#include "SPSCQueue.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+/**
+ * @brief Pass messages of one type from tasks to a task that waits for them.
+ *
+ * A channel is a lock-free queue with a way for the receiver to sleep until something arrives.
+ * send() copies the item into the queue and wakes the receiver only if it is waiting, so a
+ * message costs no lock, no allocation and, while the receiver is busy, no call into the kernel.
+ * send() never waits: if the queue is full it fails at once and the sender decides what to drop.
+ *
+ * On the ESP32 the receiver sleeps on its task notification, which is lighter than a semaphore
+ * or a FreeRTOS queue.  The receiving task must not use its notification value for anything
+ * else.  On a host it sleeps on a condition variable.
+ *
+ * Any task may send, and from an interrupt sendFromISR(); exactly one task may receive.  Where
+ * there is only one sender, give SPSCQueue as the queue to save the compare and swap:
+ *
+ * @code{.cpp}
+ * Channel<sample_t, 32, SPSCQueue> samples;
+ * // The sampling task
+ * if (!samples.send(sample)) {
+ * 	dropped++;
+ * }
+ * // The processing task
+ * sample_t sample;
+ * while (samples.receive(&sample)) {
+ * 	...
+ * }
+ * @endcode
+ *
+ * @tparam T The message type, which must be default constructible and copyable.
+ * @tparam CAPACITY The number of messages held, a power of 2.
+ * @tparam QUEUE The queue: MPSCQueue, or SPSCQueue when there is one sender.
+ */
+template<typename T, size_t CAPACITY, template<typename, size_t> class QUEUE = MPSCQueue>
+class Channel {
+public:
+	static const uint32_t FOREVER = UINT32_MAX;   // A timeout that never expires.
+
+	Channel(): m_waiting(false) {
+#ifdef ESP_PLATFORM
+		m_receiver = nullptr;
+#else
+		m_notified = false;
+#endif
+	}
+
+	size_t capacity() const {
+		return CAPACITY;
+	}
+
+	/**
+	 * @brief Take the next message, waiting for one if there is none.  Call from the receiver only.
+	 *
+	 * As with the other waits, the timeout is rounded down to whole ticks.
+	 * @param [out] pItem Where to copy the message.
+	 * @param [in] timeoutMs How long to wait, 0 not to wait or FOREVER.
+	 * @return False if no message came within the timeout.
+	 */
+	bool receive(T* pItem, uint32_t timeoutMs = FOREVER) {
+		if (m_queue.pop(pItem)) {
+			return true;
+		}
+		TickType_t ticks = timeoutMs == FOREVER ? portMAX_DELAY : timeoutMs / portTICK_PERIOD_MS;
+		if (ticks == 0) {
+			return false;
+		}
+#ifdef ESP_PLATFORM
+		m_receiver.store(::xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+		TickType_t start = ::xTaskGetTickCount();
+#else
+		TickType_t start = FreeRTOS::getTimeSinceStart() / portTICK_PERIOD_MS;
+#endif
+		for (;;) {
+			// Say we are waiting before looking again, and a sender looks for that after pushing:
+			// then either we find its message or it finds us waiting.
+			m_waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_queue.pop(pItem)) {
+				m_waiting.store(false, std::memory_order_relaxed);
+				return true;
+			}
+			if (!wait(start, ticks)) {
+				m_waiting.store(false, std::memory_order_relaxed);
+				return m_queue.pop(pItem);
+			}
+		}
+	} // receive
+
+	/**
+	 * @brief Send a message.  Call from any task.
+	 * @param [in] item The message to copy into the channel.
+	 * @return False if the channel was full and the message was not sent.
+	 */
+	bool send(const T& item) {
+		if (!m_queue.push(item)) {
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiting.load(std::memory_order_relaxed)) {
+			notify();
+		}
+		return true;
+	} // send
+
+#ifdef ESP_PLATFORM
+	/**
+	 * @brief Send a message from an interrupt handler.
+	 * @param [in] item The message to copy into the channel.
+	 * @param [out] pHigherPriorityTaskWoken Set to pdTRUE if the receiver should run when the handler returns.
+	 * @return False if the channel was full and the message was not sent.
+	 */
+	bool sendFromISR(const T& item, BaseType_t* pHigherPriorityTaskWoken) {
+		if (!m_queue.push(item)) {
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiting.load(std::memory_order_relaxed)) {
+			::vTaskNotifyGiveFromISR(m_receiver.load(std::memory_order_relaxed), pHigherPriorityTaskWoken);
+		}
+		return true;
+	} // sendFromISR
+#endif
+
+	/**
+	 * @brief Get the number of messages waiting.  Only an estimate while other tasks send or receive.
+	 */
+	size_t size() const {
+		return m_queue.size();
+	}
+
+private:
+	/**
+	 * @brief Wake the receiver.
+	 */
+	void notify() {
+#ifdef ESP_PLATFORM
+		::xTaskNotifyGive(m_receiver.load(std::memory_order_relaxed));
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_notified = true;
+		m_notify.notify_one();
+#endif
+	} // notify
+
+	/**
+	 * @brief Sleep until a sender wakes the receiver or the time is up.
+	 * @param [in] start The tick the receive started at.
+	 * @param [in] ticks The ticks it may take, or portMAX_DELAY.
+	 * @return False if the time is up.
+	 */
+	bool wait(TickType_t start, TickType_t ticks) {
+#ifdef ESP_PLATFORM
+		TickType_t waitTicks = portMAX_DELAY;
+		if (ticks != portMAX_DELAY) {
+			TickType_t waited = ::xTaskGetTickCount() - start;
+			if (waited >= ticks) {
+				return false;
+			}
+			waitTicks = ticks - waited;
+		}
+		::ulTaskNotifyTake(pdTRUE, waitTicks);
+		return true;
+#else
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (ticks == portMAX_DELAY) {
+			m_notify.wait(lock, [this]() { return m_notified; });
+		} else if (!m_notify.wait_until(lock, FreeRTOS::getTickTime(start + ticks), [this]() { return m_notified; })) {
+			return false;
+		}
+		m_notified = false;
+		return true;
+#endif
+	} // wait
+
+	QUEUE<T, CAPACITY>         m_queue;
+	std::atomic<bool>          m_waiting;    // The receiver is, or is about to be, asleep.
+#ifdef ESP_PLATFORM
+	std::atomic<TaskHandle_t>  m_receiver;   // The task to notify.
+#else
+	std::mutex                 m_mutex;      // Guards m_notified, the host's task notification.
+	std::condition_variable    m_notify;
+	bool                       m_notified;
+#endif
+}; // Channel
+
+#endif /* COMPONENTS_CPP_UTILS_CHANNEL_H_ */
@@ -39,6 +39,9 @@ std::string File::getContent(bool base64Encode) {
 	if (size == 0) {
 		return "";
 	}
+	if (base64Encode) {
+		return getContentBase64(size);
+	}
 	uint8_t *pData = (uint8_t *)malloc(size);
 	if (pData == nullptr) {
 		ESP_LOGE(tag, "getContent: Failed to allocate memory");
@@ -49,15 +52,40 @@ std::string File::getContent(bool base64Encode) {
 	fclose(file);
 	std::string ret((char *)pData, size);
 	free(pData);
-	if (base64Encode) {
-		std::string encoded;
-		GeneralUtils::base64Decode(ret, &encoded);
-		return encoded;
-	}
 	return ret;
 } // getContent
 
 
+/**
+ * @brief Retrieve the content of the file base64 encoded.
+ *
+ * The file is read and encoded a block at a time, so only the encoded content is held in memory.
+ *
+ * @param [in] size The size of the file.
+ * @return The encoded content of the file.
+ */
+std::string File::getContentBase64(uint32_t size) {
+	FILE *file = fopen(m_name.c_str(), "r");
+	if (file == nullptr) {
+		ESP_LOGE(tag, "getContent: Failed to open %s", m_name.c_str());
+		return "";
+	}
+	std::string encoded;
+	encoded.resize(Base64Encoder::getEncodedLength(size) + 4);
+	Base64Encoder encoder;
+	uint8_t block[384];
+	size_t  encodedLength = 0;
+	size_t  readLength;
+	while ((readLength = fread(block, 1, sizeof(block), file)) > 0 && encodedLength + Base64Encoder::getEncodedLength(readLength) + 4 <= encoded.size()) {
+		encodedLength += encoder.encode(block, readLength, &encoded[encodedLength]);
+	}
+	fclose(file);
+	encodedLength += encoder.finish(&encoded[encodedLength]);
+	encoded.resize(encodedLength);
+	return encoded;
+} // getContentBase64
+
+
 /**
  * @brief Retrieve the content of the file.
  * @param [in] offset The file offset to read from.
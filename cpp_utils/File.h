@@ -26,6 +26,8 @@ public:
 	uint32_t length();
 
 private:
+	std::string getContentBase64(uint32_t size);
+
 	std::string m_name;
 	uint8_t m_type;
 };
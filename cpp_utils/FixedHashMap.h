@@ -0,0 +1,231 @@
+/*
+ * FixedHashMap.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_FIXEDHASHMAP_H_
+#define COMPONENTS_CPP_UTILS_FIXEDHASHMAP_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @brief The default hash of a FixedHashMap, for integer, enum and pointer keys.
+ *
+ * For other keys, supply a class with the same operator().
+ */
+template<typename K>
+struct FixedHashMapHash {
+	uint32_t operator()(const K& key) const {
+		return hashOf(key);
+	}
+private:
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint32_t>::type hashOf(const T& key) {
+		uint64_t value = (uint64_t)key;
+		return (uint32_t)value ^ (uint32_t)(value >> 32);
+	}
+	template<typename T>
+	static uint32_t hashOf(T* const& key) {
+		uint64_t value = (uintptr_t)key;
+		return (uint32_t)(value >> 2) ^ (uint32_t)(value >> 34);
+	}
+}; // FixedHashMapHash
+
+
+/**
+ * @brief The CAPACITY of a FixedHashMap that is to hold count entries: the smallest power of 2
+ * that keeps it no more than three quarters full.
+ */
+constexpr size_t fixedHashMapCapacity(size_t count, size_t capacity = 2) {
+	return count * 4 <= capacity * 3 && count < capacity ? capacity : fixedHashMapCapacity(count, capacity * 2);
+}
+
+
+/**
+ * @brief A hash map of fixed capacity, held entirely within the object.
+ *
+ * Entries are kept in a single array with open addressing and linear probing, so a lookup is a
+ * hash and usually one or two comparisons, and inserting allocates nothing.  A removal moves
+ * the later entries of its run back, so there are no tombstones to slow later lookups.
+ *
+ * The map holds at most CAPACITY - 1 entries: set() fails when it is full.  Lookups are fastest
+ * when it is no more than three quarters full.
+ *
+ * @code{.cpp}
+ * FixedHashMap<uint16_t, BLECharacteristic*, 32> handles;
+ * handles.set(handle, pCharacteristic);
+ * BLECharacteristic** ppCharacteristic = handles.get(handle);
+ * @endcode
+ *
+ * @tparam K The key type, which must be copyable and comparable with ==.
+ * @tparam V The value type, which must be default constructible and copyable.
+ * @tparam CAPACITY The number of slots, a power of 2.
+ * @tparam H The hash of the keys.
+ */
+template<typename K, typename V, size_t CAPACITY, typename H = FixedHashMapHash<K>>
+class FixedHashMap {
+	static_assert(CAPACITY >= 2 && CAPACITY <= 0x80000000u && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+public:
+	struct Entry {
+		K key;
+		V value;
+	};
+
+	class Iterator {
+	public:
+		Iterator(FixedHashMap* pMap, size_t index) : m_pMap(pMap), m_index(index) {
+			skip();
+		}
+		Entry& operator*() const {
+			return m_pMap->m_entries[m_index];
+		}
+		Entry* operator->() const {
+			return &m_pMap->m_entries[m_index];
+		}
+		Iterator& operator++() {
+			m_index++;
+			skip();
+			return *this;
+		}
+		bool operator!=(const Iterator& other) const {
+			return m_index != other.m_index;
+		}
+	private:
+		void skip() {
+			while (m_index < CAPACITY && !m_pMap->isUsed(m_index)) {
+				m_index++;
+			}
+		}
+		FixedHashMap* m_pMap;
+		size_t        m_index;
+	}; // Iterator
+
+	FixedHashMap() {
+		clear();
+	}
+
+	Iterator begin() {
+		return Iterator(this, 0);
+	}
+	Iterator end() {
+		return Iterator(this, CAPACITY);
+	}
+
+	static size_t capacity() {
+		return CAPACITY - 1;
+	}
+
+	void clear() {
+		for (size_t i = 0; i < WORDS; i++) {
+			m_used[i] = 0;
+		}
+		m_size = 0;
+	}
+
+	/**
+	 * @brief Get the value of a key.
+	 *
+	 * @param [in] key The key to look up.
+	 * @return A pointer to the value, valid until the map is next changed, or nullptr if the key
+	 * is not in the map.
+	 */
+	V* get(const K& key) {
+		size_t index = find(key);
+		return isUsed(index) ? &m_entries[index].value : nullptr;
+	}
+
+	/**
+	 * @brief Remove a key.
+	 *
+	 * @param [in] key The key to remove.
+	 * @return False if the key was not in the map.
+	 */
+	bool remove(const K& key) {
+		size_t index = find(key);
+		if (!isUsed(index)) {
+			return false;
+		}
+		// Move back each later entry of the run that could have been placed in the gap.
+		size_t gap = index;
+		for (size_t next = (gap + 1) & MASK; isUsed(next); next = (next + 1) & MASK) {
+			size_t home = slotOf(m_entries[next].key);
+			if (((next - home) & MASK) >= ((next - gap) & MASK)) {
+				m_entries[gap] = m_entries[next];
+				gap = next;
+			}
+		}
+		m_entries[gap] = Entry();
+		setUsed(gap, false);
+		m_size--;
+		return true;
+	}
+
+	/**
+	 * @brief Set the value of a key, replacing any value it had.
+	 *
+	 * @param [in] key The key.
+	 * @param [in] value The value.
+	 * @return False if the key was not in the map and the map is full.
+	 */
+	bool set(const K& key, const V& value) {
+		size_t index = find(key);
+		if (!isUsed(index)) {
+			if (m_size >= CAPACITY - 1) {
+				return false;
+			}
+			m_entries[index].key = key;
+			setUsed(index, true);
+			m_size++;
+		}
+		m_entries[index].value = value;
+		return true;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+private:
+	static const size_t MASK  = CAPACITY - 1;
+	static const size_t WORDS = (CAPACITY + 31) / 32;
+
+	/**
+	 * @brief Find the slot holding a key, or the empty slot where it would go.
+	 */
+	size_t find(const K& key) const {
+		size_t index = slotOf(key);
+		while (isUsed(index) && !(m_entries[index].key == key)) {
+			index = (index + 1) & MASK;
+		}
+		return index;
+	}
+	bool isUsed(size_t index) const {
+		return (m_used[index / 32] >> (index % 32)) & 1;
+	}
+	void setUsed(size_t index, bool used) {
+		if (used) {
+			m_used[index / 32] |= (uint32_t)1 << (index % 32);
+		} else {
+			m_used[index / 32] &= ~((uint32_t)1 << (index % 32));
+		}
+	}
+	/**
+	 * @brief The home slot of a key: the top bits of its hash times the golden ratio.
+	 */
+	static size_t slotOf(const K& key) {
+		return (uint32_t)(H()(key) * 2654435769u) >> (32 - log2(CAPACITY));
+	}
+	static constexpr int log2(size_t n) {
+		return n <= 1 ? 0 : 1 + log2(n / 2);
+	}
+
+	Entry    m_entries[CAPACITY];
+	uint32_t m_used[WORDS];
+	size_t   m_size;
+}; // FixedHashMap
+
+#endif /* COMPONENTS_CPP_UTILS_FIXEDHASHMAP_H_ */
@@ -4,16 +4,58 @@
  *  Created on: Feb 24, 2017
  *      Author: kolban
  */
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
 #include <string>
 #include <sstream>
 #include <iomanip>
 #include "FreeRTOS.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <esp_log.h>
 #include "sdkconfig.h"
 
 static char TAG[] = "FreeRTOS";
+#else
+#include <pthread.h>
+#include <thread>
+
+#define ESP_LOGD(tag, ...)
+
+/**
+ * @brief The least stack a thread is given on a host, where code needs more than on the ESP32.
+ */
+static const size_t HOST_STACK_SIZE = 256 * 1024;
+
+/**
+ * @brief The time the ticks are counted from: the first time anything asks.
+ */
+static std::chrono::steady_clock::time_point startTime() {
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return start;
+} // startTime
+
+/**
+ * @brief The tick count now.
+ */
+static TickType_t tickCount() {
+	auto elapsed = std::chrono::steady_clock::now() - startTime();
+	return (TickType_t)(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / portTICK_PERIOD_MS);
+} // tickCount
+
+typedef struct {
+	void      (*task)(void*);
+	void*       param;
+	std::string name;
+} start_t;
+
+static void* runThread(void* pStart) {
+	start_t start = *(start_t*)pStart;
+	delete (start_t*)pStart;
+	::pthread_setname_np(::pthread_self(), start.name.substr(0, 15).c_str());
+	start.task(start.param);
+	return nullptr;
+} // runThread
+#endif
 
 FreeRTOS::FreeRTOS() {
 }
@@ -25,42 +67,97 @@ FreeRTOS::~FreeRTOS() {
 
 /**
  * Sleep for the specified number of milliseconds.
+ *
+ * As with vTaskDelay(), the time is rounded down to whole ticks, and ends on a tick.
  * @param[in] ms The period in milliseconds for which to sleep.
  */
 void FreeRTOS::sleep(uint32_t ms) {
+#ifdef ESP_PLATFORM
 	::vTaskDelay(ms/portTICK_PERIOD_MS);
+#else
+	TickType_t ticks = ms / portTICK_PERIOD_MS;
+	if (ticks == 0) {
+		std::this_thread::yield();
+		return;
+	}
+	std::this_thread::sleep_until(getTickTime(tickCount() + ticks));
+#endif
 } // sleep
 
 
 /**
  * Start a new task.
+ *
+ * On a host the task is a detached thread, with a stack of at least 256 KB.
  * @param[in] task The function pointer to the function to be run in the task.
  * @param[in] taskName A string identifier for the task.
  * @param[in] param An optional parameter to be passed to the started task.
  * @param[in] stackSize An optional paremeter supplying the size of the stack in which to run the task.
  */
 void FreeRTOS::startTask(void task(void*), std::string taskName, void *param, int stackSize) {
+#ifdef ESP_PLATFORM
 	::xTaskCreate(task, taskName.data(), stackSize, param, 5, NULL);
+#else
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, (size_t)stackSize > HOST_STACK_SIZE ? (size_t)stackSize : HOST_STACK_SIZE);
+	start_t* pStart = new start_t;
+	pStart->task  = task;
+	pStart->param = param;
+	pStart->name  = taskName;
+	pthread_t thread;
+	if (::pthread_create(&thread, &attr, runThread, pStart) != 0) {
+		delete pStart;
+	}
+	pthread_attr_destroy(&attr);
+#endif
 } // startTask
 
 
 /**
  * Delete the task.
+ *
+ * On a host only the calling task can be deleted: its thread exits.  A handle is ignored.
  * @param[in] pTask An optional handle to the task to be deleted.  If not supplied the calling task will be deleted.
  */
 void FreeRTOS::deleteTask(TaskHandle_t pTask) {
+#ifdef ESP_PLATFORM
 	::vTaskDelete(pTask);
+#else
+	if (pTask == nullptr) {
+		::pthread_exit(nullptr);
+	}
+#endif
 } // deleteTask
 
 
 /**
  * Get the time in milliseconds since the %FreeRTOS scheduler started.
+ *
+ * On a host, since the first time the time was asked for.  Either way it advances a tick at a time.
  * @return The time in milliseconds since the %FreeRTOS scheduler started.
  */
 uint32_t FreeRTOS::getTimeSinceStart() {
+#ifdef ESP_PLATFORM
 	return (uint32_t)(xTaskGetTickCount()*portTICK_PERIOD_MS);
+#else
+	return (uint32_t)(tickCount()*portTICK_PERIOD_MS);
+#endif
 } // getTimeSinceStart
 
+
+#ifndef ESP_PLATFORM
+/**
+ * Get the time at which the tick count reaches a value, on a host.
+ * @param[in] tick The tick count.
+ * @return The time.
+ */
+std::chrono::steady_clock::time_point FreeRTOS::getTickTime(TickType_t tick) {
+	return startTime() + std::chrono::milliseconds((uint64_t)tick * portTICK_PERIOD_MS);
+} // getTickTime
+#endif
+
 /*
  * 	public:
 		Semaphore(std::string = "<Unknown>");
@@ -78,24 +175,37 @@ uint32_t FreeRTOS::getTimeSinceStart() {
 
 
 FreeRTOS::Semaphore::Semaphore(std::string name) {
+#ifdef ESP_PLATFORM
 	m_semaphore = xSemaphoreCreateMutex();
+#else
+	m_taken     = false;
+#endif
 	m_name      = name;
 	m_owner     = "<N/A>";
 }
 
 FreeRTOS::Semaphore::~Semaphore() {
+#ifdef ESP_PLATFORM
 	vSemaphoreDelete(m_semaphore);
+#endif
 }
 
 
 /**
  * @brief Give a semaphore.
- * The Semaphore is given.
+ * The Semaphore is given.  On a host, as on the ESP32, any task may give it.
  */
 void FreeRTOS::Semaphore::give() {
+#ifdef ESP_PLATFORM
 	xSemaphoreGive(m_semaphore);
 	ESP_LOGD(TAG, "Semaphore giving: %s", toString().c_str());
 	m_owner = "<N/A>";
+#else
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_taken = false;
+	m_owner = "<N/A>";
+	m_given.notify_one();
+#endif
 } // Semaphore::give
 
 
@@ -107,8 +217,15 @@ void FreeRTOS::Semaphore::take(std::string owner)
 {
 
 	ESP_LOGD(TAG, "Semaphore taking: %s for %s", toString().c_str(), owner.c_str());
+#ifdef ESP_PLATFORM
 	xSemaphoreTake(m_semaphore, portMAX_DELAY);
 	m_owner = owner;
+#else
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_given.wait(lock, [this]() { return !m_taken; });
+	m_taken = true;
+	m_owner = owner;
+#endif
 	ESP_LOGD(TAG, "Semaphore taken:  %s", toString().c_str());
 } // Semaphore::take
 
@@ -116,16 +233,30 @@ void FreeRTOS::Semaphore::take(std::string owner)
 /**
  * @brief Take a semaphore.
  * Take a semaphore but return if we haven't obtained it in the given period of milliseconds.
+ * The period is rounded down to whole ticks.
  * @param [in] timeoutMs Timeout in milliseconds.
  */
 void FreeRTOS::Semaphore::take(uint32_t timeoutMs, std::string owner) {
+#ifdef ESP_PLATFORM
 	m_owner = owner;
 	xSemaphoreTake(m_semaphore, timeoutMs/portTICK_PERIOD_MS);
+#else
+	std::chrono::steady_clock::time_point until = getTickTime(tickCount() + timeoutMs / portTICK_PERIOD_MS);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_owner = owner;
+	if (m_given.wait_until(lock, until, [this]() { return !m_taken; })) {
+		m_taken = true;
+	}
+#endif
 } // Semaphore::take
 
 std::string FreeRTOS::Semaphore::toString() {
 	std::stringstream stringStream;
+#ifdef ESP_PLATFORM
 	stringStream << "name: "<< m_name << " (0x" << std::hex << std::setfill('0') << (uint32_t)m_semaphore << "), owner: " << m_owner;
+#else
+	stringStream << "name: "<< m_name << " (0x" << std::hex << std::setfill('0') << (uintptr_t)this << "), owner: " << m_owner;
+#endif
 	return stringStream.str();
 }
 
@@ -10,9 +10,32 @@
 #include <stdint.h>
 #include <string>
 
+#ifdef ESP_PLATFORM
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/*
+ * On a host the wrappers run over POSIX threads.  These are the FreeRTOS types and constants
+ * their interfaces use, with the tick rate of the ESP32 unless the build sets another, so that
+ * periods in ticks and delays rounded down to ticks come out as they do on the device.
+ */
+#ifndef CONFIG_FREERTOS_HZ
+#define CONFIG_FREERTOS_HZ 100
+#endif
+typedef uint32_t     TickType_t;
+typedef unsigned int UBaseType_t;
+typedef void*        TaskHandle_t;
+typedef TaskHandle_t xTaskHandle;
+#define portMAX_DELAY      ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / CONFIG_FREERTOS_HZ)
+#define pdFALSE            0
+#define pdTRUE             1
+#endif
 
 
 /**
@@ -27,6 +50,9 @@ public:
 	static void deleteTask(TaskHandle_t pTask = nullptr);
 
 	static uint32_t getTimeSinceStart();
+#ifndef ESP_PLATFORM
+	static std::chrono::steady_clock::time_point getTickTime(TickType_t tick);
+#endif
 
 	class Semaphore {
 	public:
@@ -38,7 +64,13 @@ public:
 		void take(uint32_t timeoutMs, std::string owner="<Unknown>");
 		std::string toString();
 	private:
+#ifdef ESP_PLATFORM
 		SemaphoreHandle_t m_semaphore;
+#else
+		std::mutex m_mutex;
+		std::condition_variable m_given;
+		bool m_taken;
+#endif
 		std::string m_name;
 		std::string m_owner;
 	};
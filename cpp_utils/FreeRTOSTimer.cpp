@@ -9,14 +9,98 @@
 #include <map>
 
 #include "FreeRTOSTimer.h"
+#ifndef ESP_PLATFORM
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#endif
 
 
+#ifdef ESP_PLATFORM
 static std::map<void *, FreeRTOSTimer *> timersMap;
 
 void FreeRTOSTimer::internalCallback(TimerHandle_t xTimer) {
 	FreeRTOSTimer *timer = timersMap.at(xTimer);
 	timer->callback(timer);
 }
+#else
+/**
+ * @brief The thread that serves the timers on a host, as the %FreeRTOS timer task does.
+ *
+ * The active timers are kept in a list and the thread sleeps until the first is due.  An auto
+ * reload timer is due again a period after it was last due, not after its callback ran, so it
+ * does not drift.  The lock is held while a callback runs, so a timer cannot be changed or
+ * deleted from another thread part way through its callback; it is recursive, so the callback
+ * itself can.
+ */
+class FreeRTOSTimerService {
+public:
+	static FreeRTOSTimerService* get() {
+		// Never deleted, so the thread can outlive the static objects at exit.
+		static FreeRTOSTimerService* pService = new FreeRTOSTimerService();
+		return pService;
+	}
+
+	void changePeriod(FreeRTOSTimer* pTimer, TickType_t period) {
+		std::lock_guard<std::recursive_mutex> guard(m_lock);
+		pTimer->period = period;
+		schedule(pTimer, period);
+	}
+
+	void cancel(FreeRTOSTimer* pTimer) {
+		std::lock_guard<std::recursive_mutex> guard(m_lock);
+		m_timers.erase(std::remove(m_timers.begin(), m_timers.end(), pTimer), m_timers.end());
+		m_changed.notify_one();
+	}
+
+	/**
+	 * @brief Start a timer, or restart it if it is active, to be due in a number of ticks.
+	 */
+	void schedule(FreeRTOSTimer* pTimer, TickType_t ticks) {
+		std::lock_guard<std::recursive_mutex> guard(m_lock);
+		pTimer->expiry = FreeRTOS::getTickTime(FreeRTOS::getTimeSinceStart() / portTICK_PERIOD_MS + ticks);
+		if (std::find(m_timers.begin(), m_timers.end(), pTimer) == m_timers.end()) {
+			m_timers.push_back(pTimer);
+		}
+		m_changed.notify_one();
+	}
+
+private:
+	FreeRTOSTimerService() {
+		FreeRTOS::startTask(run, "Tmr Svc", this);
+	}
+
+	static void run(void* pData) {
+		FreeRTOSTimerService* pService = (FreeRTOSTimerService*)pData;
+		std::unique_lock<std::recursive_mutex> guard(pService->m_lock);
+		while (true) {
+			auto next = std::min_element(pService->m_timers.begin(), pService->m_timers.end(),
+				[](FreeRTOSTimer* a, FreeRTOSTimer* b) { return a->expiry < b->expiry; });
+			if (next == pService->m_timers.end()) {
+				pService->m_changed.wait(guard);
+				continue;
+			}
+			FreeRTOSTimer* pTimer = *next;
+			std::chrono::steady_clock::time_point expiry = pTimer->expiry;   // The timer may be deleted while we wait.
+			if (std::chrono::steady_clock::now() < expiry) {
+				pService->m_changed.wait_until(guard, expiry);
+				continue;
+			}
+			if (pTimer->reload) {
+				pTimer->expiry += std::chrono::milliseconds((uint64_t)pTimer->period * portTICK_PERIOD_MS);
+			} else {
+				pService->m_timers.erase(next);
+			}
+			pTimer->callback(pTimer);
+		}
+	} // run
+
+	std::recursive_mutex        m_lock;
+	std::condition_variable_any m_changed;
+	std::vector<FreeRTOSTimer*> m_timers;   // The active timers.
+}; // FreeRTOSTimerService
+#endif
 
 /**
  * @brief Construct a timer.
@@ -59,10 +143,17 @@ FreeRTOSTimer::FreeRTOSTimer(
 	assert(callback != nullptr);
 	this->period = period;
 	this->callback = callback;
+#ifdef ESP_PLATFORM
 	timerHandle = ::xTimerCreate(name, period, reload, data, internalCallback);
 
 	// Add the association between the timer handle and this class instance into the map.
 	timersMap.insert(std::make_pair(timerHandle, this));
+#else
+	assert(period > 0);
+	this->name   = name;
+	this->reload = reload;
+	this->data   = data;
+#endif
 } // FreeRTOSTimer
 
 /**
@@ -71,29 +162,48 @@ FreeRTOSTimer::FreeRTOSTimer(
  * The timer is deleted.
  */
 FreeRTOSTimer::~FreeRTOSTimer() {
+#ifdef ESP_PLATFORM
 	::xTimerDelete(timerHandle, portMAX_DELAY);
 	timersMap.erase(timerHandle);
+#else
+	FreeRTOSTimerService::get()->cancel(this);
+#endif
 }
 
 /**
  * @brief Start the timer ticking.
  */
 void FreeRTOSTimer::start(TickType_t blockTime) {
+#ifdef ESP_PLATFORM
 	::xTimerStart(timerHandle, blockTime);
+#else
+	(void)blockTime;   // The host applies the command at once: there is no timer queue to wait on.
+	FreeRTOSTimerService::get()->schedule(this, period);
+#endif
 } // start
 
 /**
  * @brief Stop the timer from ticking.
  */
 void FreeRTOSTimer::stop(TickType_t blockTime) {
+#ifdef ESP_PLATFORM
 	::xTimerStop(timerHandle, blockTime);
+#else
+	(void)blockTime;
+	FreeRTOSTimerService::get()->cancel(this);
+#endif
 } // stop
 
 /**
  * @brief Reset the timer to the period and start it ticking.
  */
 void FreeRTOSTimer::reset(TickType_t blockTime) {
+#ifdef ESP_PLATFORM
 	::xTimerReset(timerHandle, blockTime);
+#else
+	(void)blockTime;
+	FreeRTOSTimerService::get()->schedule(this, period);
+#endif
 } // reset
 
 
@@ -108,14 +218,19 @@ TickType_t FreeRTOSTimer::getPeriod() {
 
 
 /**
- * @brief Change the period of the timer.
+ * @brief Change the period of the timer, and start it if it is not active.
  *
  * @param [in] newPeriod The new period of the timer in ticks.
  */
 void FreeRTOSTimer::changePeriod(TickType_t newPeriod, TickType_t blockTime) {
+#ifdef ESP_PLATFORM
 	if (::xTimerChangePeriod(timerHandle, newPeriod, blockTime) == pdPASS) {
 		period = newPeriod;
 	}
+#else
+	(void)blockTime;
+	FreeRTOSTimerService::get()->changePeriod(this, newPeriod);
+#endif
 } // changePeriod
 
 
@@ -125,7 +240,11 @@ void FreeRTOSTimer::changePeriod(TickType_t newPeriod, TickType_t blockTime) {
  * @return The name of the timer.
  */
 const char *FreeRTOSTimer::getName() {
+#ifdef ESP_PLATFORM
 	return ::pcTimerGetTimerName(timerHandle);
+#else
+	return name;
+#endif
 } // getName
 
 
@@ -135,5 +254,9 @@ const char *FreeRTOSTimer::getName() {
  * @return The user supplied data associated with the timer.
  */
 void *FreeRTOSTimer::getData() {
+#ifdef ESP_PLATFORM
 	return ::pvTimerGetTimerID(timerHandle);
+#else
+	return data;
+#endif
 } // getData
@@ -7,11 +7,19 @@
 
 #ifndef COMPONENTS_CPP_UTILS_FREERTOSTIMER_H_
 #define COMPONENTS_CPP_UTILS_FREERTOSTIMER_H_
+#ifdef ESP_PLATFORM
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/timers.h>
+#else
+#include <chrono>
+#include "FreeRTOS.h"
+#endif
 /**
  * @brief Wrapper around the %FreeRTOS timer functions.
+ *
+ * On a host the timers are served by a thread of their own, as by the %FreeRTOS timer task:
+ * every callback runs on it, one at a time, and a block time is never needed.
  */
 class FreeRTOSTimer {
 public:
@@ -26,10 +34,20 @@ public:
 	void stop(TickType_t blockTime=portMAX_DELAY);
 
 private:
+#ifdef ESP_PLATFORM
 	TimerHandle_t timerHandle;
+#else
+	friend class FreeRTOSTimerService;
+	const char *name;
+	UBaseType_t reload;
+	void *data;
+	std::chrono::steady_clock::time_point expiry;
+#endif
 	TickType_t period;
 	void (*callback)(FreeRTOSTimer *pTimer);
+#ifdef ESP_PLATFORM
 	static void internalCallback(TimerHandle_t xTimer);
+#endif
 };
 
 #endif /* COMPONENTS_CPP_UTILS_FREERTOSTIMER_H_ */
@@ -20,6 +20,36 @@ static const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
+static const char kBase64UrlAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789-_";
+
+static const uint8_t B64_PAD     = 0x40;  // '='
+static const uint8_t B64_SPACE   = 0x41;  // Whitespace, skipped.
+static const uint8_t B64_INVALID = 0xff;
+
+/**
+ * @brief The value of each character in base64, for both the standard and URL alphabets.
+ */
+static const uint8_t kBase64Decode[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x41, 0x41, 0xff, 0xff, 0x41, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x41, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0x3e, 0xff, 0x3f,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0x40, 0xff, 0xff,
+	0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+	0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+	0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
 GeneralUtils::GeneralUtils() {
 	// TODO Auto-generated constructor stub
 
@@ -29,30 +59,6 @@ GeneralUtils::~GeneralUtils() {
 	// TODO Auto-generated destructor stub
 }
 
-static int base64EncodedLength(size_t length) {
-	return (length + 2 - ((length + 2) % 3)) / 3 * 4;
-} // base64EncodedLength
-
-
-static int base64EncodedLength(const std::string &in) {
-	return base64EncodedLength(in.length());
-} // base64EncodedLength
-
-
-static void a3_to_a4(unsigned char * a4, unsigned char * a3) {
-	a4[0] = (a3[0] & 0xfc) >> 2;
-	a4[1] = ((a3[0] & 0x03) << 4) + ((a3[1] & 0xf0) >> 4);
-	a4[2] = ((a3[1] & 0x0f) << 2) + ((a3[2] & 0xc0) >> 6);
-	a4[3] = (a3[2] & 0x3f);
-} // a3_to_a4
-
-
-static void a4_to_a3(unsigned char * a3, unsigned char * a4) {
-	a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
-	a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
-	a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
-} // a4_to_a3
-
 
 /**
  * @brief Encode a string into base 64.
@@ -60,125 +66,244 @@ static void a4_to_a3(unsigned char * a3, unsigned char * a4) {
  * @param [out] out
  */
 bool GeneralUtils::base64Encode(const std::string &in, std::string *out) {
-	int i = 0, j = 0;
-	size_t enc_len = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-
-	out->resize(base64EncodedLength(in));
+	Base64Encoder encoder;
+	out->resize(Base64Encoder::getEncodedLength(in.length()));
+	size_t enc_len = encoder.encode((const uint8_t *)in.data(), in.length(), &(*out)[0]);
+	enc_len += encoder.finish(&(*out)[enc_len]);
+	return (enc_len == out->size());
+} // base64Encode
 
-	int input_len = in.size();
-	std::string::const_iterator input = in.begin();
 
-	while (input_len--) {
-		a3[i++] = *(input++);
-		if (i == 3) {
-			a3_to_a4(a4, a3);
+/**
+ * @brief Decode a chunk of data that is base64 encoded.
+ * @param [in] in The string to be decoded.
+ * @param [out] out The resulting data.
+ */
+bool GeneralUtils::base64Decode(const std::string &in, std::string *out) {
+	Base64Decoder decoder;
+	out->resize(Base64Decoder::getDecodedLength(in.length()));
+	size_t dec_len = 0;
+	bool ok = decoder.decode(in.data(), in.length(), (uint8_t *)&(*out)[0], &dec_len) && decoder.finish((uint8_t *)&(*out)[dec_len], &dec_len);
+	out->resize(dec_len);
+	return ok;
+} // base64Decode
 
-			for (i = 0; i < 4; i++) {
-				(*out)[enc_len++] = kBase64Alphabet[a4[i]];
-			}
 
-			i = 0;
-		}
-	}
+/**
+ * @brief Create an encoder.
+ * @param [in] url Use the URL and filename safe alphabet of RFC 4648 section 5, without padding.
+ */
+Base64Encoder::Base64Encoder(bool url) {
+	m_alphabet      = url ? kBase64UrlAlphabet : kBase64Alphabet;
+	m_pad           = !url;
+	m_pendingLength = 0;
+} // Base64Encoder
 
-	if (i) {
-		for (j = i; j < 3; j++) {
-			a3[j] = '\0';
-		}
 
-		a3_to_a4(a4, a3);
+/**
+ * @brief Encode the next part of the data.
+ *
+ * Bytes that do not complete a group of three are held until the next call or finish().
+ *
+ * @param [in] data The data.
+ * @param [in] length The length of the data.
+ * @param [out] out Where to store the characters: room for getEncodedLength(length) + 4.
+ * @return The number of characters stored.
+ */
+size_t Base64Encoder::encode(const uint8_t* data, size_t length, char* out) {
+	char* start = out;
+	while (m_pendingLength > 0 && m_pendingLength < 3 && length > 0) {
+		m_pending[m_pendingLength++] = *data++;
+		length--;
+	}
+	if (m_pendingLength == 3) {
+		encodeGroup(m_pending, out);
+		out += 4;
+		m_pendingLength = 0;
+	}
+	// 12 bytes, four 24 bit groups, at a time while there are enough.
+	while (length >= 12) {
+		encodeGroup(data, out);
+		encodeGroup(data + 3, out + 4);
+		encodeGroup(data + 6, out + 8);
+		encodeGroup(data + 9, out + 12);
+		data   += 12;
+		out    += 16;
+		length -= 12;
+	}
+	while (length >= 3) {
+		encodeGroup(data, out);
+		data   += 3;
+		out    += 4;
+		length -= 3;
+	}
+	while (length > 0) {
+		m_pending[m_pendingLength++] = *data++;
+		length--;
+	}
+	return out - start;
+} // encode
 
-		for (j = 0; j < i + 1; j++) {
-			(*out)[enc_len++] = kBase64Alphabet[a4[j]];
-		}
 
-		while ((i++ < 3)) {
-			(*out)[enc_len++] = '=';
+/**
+ * @brief Encode the bytes held back by encode(), with padding.
+ * @param [out] out Where to store the characters: room for 4.
+ * @return The number of characters stored.
+ */
+size_t Base64Encoder::finish(char* out) {
+	if (m_pendingLength == 0) {
+		return 0;
+	}
+	uint32_t group = m_pending[0] << 16 | (m_pendingLength > 1 ? m_pending[1] << 8 : 0);
+	size_t   count = m_pendingLength + 1;
+	out[0] = m_alphabet[group >> 18];
+	out[1] = m_alphabet[(group >> 12) & 0x3f];
+	out[2] = m_alphabet[(group >> 6) & 0x3f];
+	if (m_pad) {
+		while (count < 4) {
+			out[count++] = '=';
 		}
 	}
+	m_pendingLength = 0;
+	return count;
+} // finish
 
-	return (enc_len == out->size());
-} // base64Encode
-
-
-static int DecodedLength(const std::string &in) {
-	int numEq = 0;
-	int n = in.size();
 
-	for (std::string::const_reverse_iterator it = in.rbegin(); *it == '='; ++it) {
-		++numEq;
-	}
-	return ((6 * n) / 8) - numEq;
-} // DecodedLength
+/**
+ * @brief Get the length of the encoding of data, with padding.
+ * @param [in] length The length of the data.
+ * @return The number of characters.
+ */
+size_t Base64Encoder::getEncodedLength(size_t length) {
+	return (length + 2) / 3 * 4;
+} // getEncodedLength
 
 
-static unsigned char b64_lookup(unsigned char c) {
-	if(c >='A' && c <='Z') return c - 'A';
-	if(c >='a' && c <='z') return c - 71;
-	if(c >='0' && c <='9') return c + 4;
-	if(c == '+') return 62;
-	if(c == '/') return 63;
-	return 255;
-}; // b64_lookup
+void Base64Encoder::encodeGroup(const uint8_t* data, char* out) {
+	uint32_t group = data[0] << 16 | data[1] << 8 | data[2];
+	out[0] = m_alphabet[group >> 18];
+	out[1] = m_alphabet[(group >> 12) & 0x3f];
+	out[2] = m_alphabet[(group >> 6) & 0x3f];
+	out[3] = m_alphabet[group & 0x3f];
+} // encodeGroup
 
 
 /**
- * @brief Decode a chunk of data that is base64 encoded.
- * @param [in] in The string to be decoded.
- * @param [out] out The resulting data.
+ * @brief Create a decoder.  Both the standard and URL alphabets are accepted, and whitespace is ignored.
  */
-bool GeneralUtils::base64Decode(const std::string &in, std::string *out) {
-	int i = 0, j = 0;
-	size_t dec_len = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
+Base64Decoder::Base64Decoder() {
+	reset();
+} // Base64Decoder
 
-	int input_len = in.size();
-	std::string::const_iterator input = in.begin();
 
-	out->resize(DecodedLength(in));
-
-	while (input_len--) {
-		if (*input == '=') {
-			break;
+/**
+ * @brief Decode the next part of the text.
+ * @param [in] data The text.
+ * @param [in] length The length of the text.
+ * @param [out] out Where to store the data: room for getDecodedLength(length) bytes.
+ * @param [in,out] pOutLength Incremented by the number of bytes stored.
+ * @return False if the text is not valid base64.
+ */
+bool Base64Decoder::decode(const char* data, size_t length, uint8_t* out, size_t* pOutLength) {
+	const uint8_t* p     = (const uint8_t*)data;
+	const uint8_t* end   = p + length;
+	uint8_t*       start = out;
+	while (p < end && !m_error) {
+		if (m_count == 0 && m_padding == 0) {
+			// Whole groups of four characters; anything else is left to the loop below.
+			while (end - p >= 4) {
+				uint8_t a = kBase64Decode[p[0]];
+				uint8_t b = kBase64Decode[p[1]];
+				uint8_t c = kBase64Decode[p[2]];
+				uint8_t d = kBase64Decode[p[3]];
+				if ((a | b | c | d) & 0xc0) {
+					break;
+				}
+				uint32_t group = a << 18 | b << 12 | c << 6 | d;
+				out[0] = group >> 16;
+				out[1] = group >> 8;
+				out[2] = group;
+				out += 3;
+				p   += 4;
+			}
+			if (p == end) {
+				break;
+			}
 		}
-
-		a4[i++] = *(input++);
-		if (i == 4) {
-			for (i = 0; i <4; i++) {
-				a4[i] = b64_lookup(a4[i]);
+		uint8_t value = kBase64Decode[*p++];
+		if (value == B64_SPACE) {
+			continue;
+		}
+		if (value == B64_INVALID || (m_padding > 0 && value != B64_PAD)) {
+			m_error = true;
+		} else if (value == B64_PAD) {
+			if (m_count < 2) {
+				m_error = true;
+			} else if (m_count + ++m_padding == 4) {
+				out += flushGroup(out);
 			}
-
-			a4_to_a3(a3,a4);
-
-			for (i = 0; i < 3; i++) {
-				(*out)[dec_len++] = a3[i];
+		} else {
+			m_group = m_group << 6 | value;
+			if (++m_count == 4) {
+				out += flushGroup(out);
 			}
-
-			i = 0;
 		}
 	}
+	*pOutLength += out - start;
+	return !m_error;
+} // decode
 
-	if (i) {
-		for (j = i; j < 4; j++) {
-			a4[j] = '\0';
-		}
 
-		for (j = 0; j < 4; j++) {
-			a4[j] = b64_lookup(a4[j]);
-		}
+/**
+ * @brief Complete the decoding.  The final group may be unpadded.
+ * @param [out] out Where to store the data: room for 2 bytes.
+ * @param [in,out] pOutLength Incremented by the number of bytes stored.
+ * @return False if the text was not valid base64.
+ */
+bool Base64Decoder::finish(uint8_t* out, size_t* pOutLength) {
+	bool ok = !m_error && m_count != 1;
+	if (ok && m_count > 1) {
+		*pOutLength += flushGroup(out);
+	}
+	reset();
+	return ok;
+} // finish
 
-		a4_to_a3(a3,a4);
 
-		for (j = 0; j < i - 1; j++) {
-			(*out)[dec_len++] = a3[j];
-		}
-	}
+/**
+ * @brief Get the most bytes that text of the given length can decode to.
+ * @param [in] length The length of the text.
+ * @return The number of bytes.
+ */
+size_t Base64Decoder::getDecodedLength(size_t length) {
+	return (length + 3) / 4 * 3;
+} // getDecodedLength
+
+
+/**
+ * @brief Forget any partial group, ready to decode new text.
+ */
+void Base64Decoder::reset() {
+	m_group   = 0;
+	m_count   = 0;
+	m_padding = 0;
+	m_error   = false;
+} // reset
 
-	return (dec_len == out->size());
- } // base64Decode
+
+/**
+ * @brief Store the bytes of the group of up to four characters collected so far.
+ */
+size_t Base64Decoder::flushGroup(uint8_t* out) {
+	uint32_t group = m_group << (6 * (4 - m_count));
+	size_t   count = m_count - 1;
+	out[0] = group >> 16;
+	if (count > 1) out[1] = group >> 8;
+	if (count > 2) out[2] = group;
+	m_group = 0;
+	m_count = 0;
+	return count;
+} // flushGroup
 
 /*
 void GeneralUtils::hexDump(uint8_t* pData, uint32_t length) {
@@ -259,34 +384,13 @@ void GeneralUtils::hexDump(uint8_t* pData, uint32_t length) {
  * @return N/A.
  */
 void GeneralUtils::hexDump(uint8_t* pData, uint32_t length) {
-	char ascii[80];
-	char hex[80];
-	char tempBuf[80];
-	strcpy(ascii, "");
-	strcpy(hex, "");
-	uint32_t index=0;
-	while(index < length) {
-		sprintf(tempBuf, "%.2x ", pData[index]);
-		strcat(hex, tempBuf);
-		if (isprint(pData[index])) {
-			sprintf(tempBuf, "%c", pData[index]);
-		} else {
-			sprintf(tempBuf, ".");
-		}
-		strcat(ascii, tempBuf);
-		index++;
-		if (index % 16 == 0) {
-			ESP_LOGD(tag, "%s %s", hex, ascii);
-			strcpy(ascii, "");
-			strcpy(hex, "");
-		}
+	if (LOG_LOCAL_LEVEL < ESP_LOG_DEBUG) {
+		return;
 	}
-	if (index %16 != 0) {
-		while(index % 16 != 0) {
-			strcat(hex, "   ");
-			index++;
-		}
-		ESP_LOGD(tag, "%s %s", hex, ascii);
+	char row[HEX_ROW_LENGTH];
+	for (uint32_t index = 0; index < length; index += 16) {
+		formatHexRow(pData + index, length - index < 16 ? length - index : 16, row);
+		ESP_LOGD(tag, "%s", row);
 	}
 } // hexDump
 
@@ -296,7 +400,213 @@ void GeneralUtils::hexDump(uint8_t* pData, uint32_t length) {
  * @return A string representation of the IP address.
  */
 std::string GeneralUtils::ipToString(uint8_t *ip) {
-	std::stringstream s;
-	s << (int)ip[0] << '.' << (int)ip[1] << '.' << (int)ip[2] << '.' << (int)ip[3];
-	return s.str();
+	char text[IP_STRING_LENGTH];
+	return std::string(text, formatIp(ip, text));
 } // ipToString
+
+
+/*
+ * The formatting functions below write into a buffer supplied by the caller, terminate it with
+ * a null and return the number of characters written, not counting the null.  They allocate
+ * nothing and take no locks, so may be called from an interrupt handler.
+ */
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+/**
+ * @brief The two digit decimal text of each number from 0 to 99.
+ */
+static const char kDecimalPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+
+/**
+ * @brief Format an unsigned integer in decimal.
+ *
+ * @param [in] value The value to format.
+ * @param [out] out The buffer for the text, at least DECIMAL_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatDecimal(uint32_t value, char* out) {
+	char digits[10];
+	char* p = digits + sizeof(digits);
+	while (value >= 100) {
+		const char* pair = &kDecimalPairs[(value % 100) * 2];
+		value /= 100;
+		*--p = pair[1];
+		*--p = pair[0];
+	}
+	if (value >= 10) {
+		*--p = kDecimalPairs[value * 2 + 1];
+		*--p = kDecimalPairs[value * 2];
+	} else {
+		*--p = '0' + value;
+	}
+	size_t length = digits + sizeof(digits) - p;
+	memcpy(out, p, length);
+	out[length] = 0;
+	return length;
+} // formatDecimal
+
+
+/**
+ * @brief Format a signed integer in decimal.
+ *
+ * @param [in] value The value to format.
+ * @param [out] out The buffer for the text, at least DECIMAL_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatDecimal(int32_t value, char* out) {
+	if (value >= 0) {
+		return formatDecimal((uint32_t)value, out);
+	}
+	*out = '-';
+	return 1 + formatDecimal(0 - (uint32_t)value, out + 1);
+} // formatDecimal
+
+
+/**
+ * @brief Format an integer in lower case hexadecimal, without a prefix.
+ *
+ * @param [in] value The value to format.
+ * @param [out] out The buffer for the text, at least 9 characters.
+ * @param [in] digits The least number of digits, padded with leading zeros.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatHex(uint32_t value, char* out, int digits) {
+	int length = 1;
+	while (length < 8 && (value >> (length * 4)) != 0) {
+		length++;
+	}
+	if (length < digits) {
+		length = digits > 8 ? 8 : digits;
+	}
+	for (int i = length - 1; i >= 0; i--) {
+		out[i] = kHexDigits[value & 0xf];
+		value >>= 4;
+	}
+	out[length] = 0;
+	return length;
+} // formatHex
+
+
+/**
+ * @brief Format bytes as pairs of hexadecimal digits.
+ *
+ * @param [in] data The bytes to format.
+ * @param [in] length The number of bytes.
+ * @param [out] out The buffer for the text, at least 3 * length characters with a separator
+ * and otherwise 2 * length + 1.
+ * @param [in] separator The character to put between the bytes, or 0 for none.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatHexBytes(const uint8_t* data, size_t length, char* out, char separator) {
+	char* p = out;
+	for (size_t i = 0; i < length; i++) {
+		if (separator != 0 && i > 0) {
+			*p++ = separator;
+		}
+		*p++ = kHexDigits[data[i] >> 4];
+		*p++ = kHexDigits[data[i] & 0xf];
+	}
+	*p = 0;
+	return p - out;
+} // formatHexBytes
+
+
+/**
+ * @brief Format a row of a hex dump: up to 16 bytes in hexadecimal, then as ASCII.
+ *
+ * A short row is padded so that its ASCII lines up with that of a full row.
+ *
+ * @param [in] data The bytes to format.
+ * @param [in] length The number of bytes, at most 16.
+ * @param [out] out The buffer for the text, at least HEX_ROW_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatHexRow(const uint8_t* data, size_t length, char* out) {
+	if (length > 16) {
+		length = 16;
+	}
+	char* ascii = out + 16 * 3 + 1;
+	for (size_t i = 0; i < length; i++) {
+		out[i * 3]     = kHexDigits[data[i] >> 4];
+		out[i * 3 + 1] = kHexDigits[data[i] & 0xf];
+		out[i * 3 + 2] = ' ';
+		ascii[i] = data[i] >= 0x20 && data[i] < 0x7f ? data[i] : '.';
+	}
+	memset(out + length * 3, ' ', (16 - length) * 3 + 1);
+	ascii[length] = 0;
+	return ascii + length - out;
+} // formatHexRow
+
+
+/**
+ * @brief Format an IPv4 address in dotted decimal.
+ *
+ * @param [in] ip The 4 bytes of the address, most significant first.
+ * @param [out] out The buffer for the text, at least IP_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatIp(const uint8_t* ip, char* out) {
+	char* p = out;
+	for (int i = 0; i < 4; i++) {
+		uint8_t value = ip[i];
+		if (value >= 100) {
+			*p++ = '0' + value / 100;
+			value %= 100;
+			*p++ = kDecimalPairs[value * 2];
+			*p++ = kDecimalPairs[value * 2 + 1];
+		} else if (value >= 10) {
+			*p++ = kDecimalPairs[value * 2];
+			*p++ = kDecimalPairs[value * 2 + 1];
+		} else {
+			*p++ = '0' + value;
+		}
+		*p++ = '.';
+	}
+	*--p = 0;
+	return p - out;
+} // formatIp
+
+
+/**
+ * @brief Format a 6 byte MAC or Bluetooth device address as xx:xx:xx:xx:xx:xx.
+ *
+ * @param [in] mac The 6 bytes of the address.
+ * @param [out] out The buffer for the text, at least MAC_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatMac(const uint8_t* mac, char* out) {
+	return formatHexBytes(mac, 6, out, ':');
+} // formatMac
+
+
+/**
+ * @brief Format a 128 bit UUID as xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx.
+ *
+ * @param [in] uuid The 16 bytes of the UUID, in the order they are to be written.
+ * @param [out] out The buffer for the text, at least UUID_STRING_LENGTH characters.
+ * @return The number of characters written.
+ */
+size_t GeneralUtils::formatUuid(const uint8_t* uuid, char* out) {
+	char* p = out;
+	for (int i = 0; i < 16; i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			*p++ = '-';
+		}
+		*p++ = kHexDigits[uuid[i] >> 4];
+		*p++ = kHexDigits[uuid[i] & 0xf];
+	}
+	*p = 0;
+	return p - out;
+} // formatUuid
@@ -7,6 +7,7 @@
 
 #ifndef COMPONENTS_CPP_UTILS_GENERALUTILS_H_
 #define COMPONENTS_CPP_UTILS_GENERALUTILS_H_
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
 
@@ -15,12 +16,76 @@
  */
 class GeneralUtils {
 public:
+	static const size_t DECIMAL_STRING_LENGTH = 12;  // "-2147483648" and a null.
+	static const size_t HEX_ROW_LENGTH        = 16 * 3 + 1 + 16 + 1;
+	static const size_t IP_STRING_LENGTH      = 16;
+	static const size_t MAC_STRING_LENGTH     = 18;
+	static const size_t UUID_STRING_LENGTH    = 37;
+
 	GeneralUtils();
 	virtual ~GeneralUtils();
 	static void hexDump(uint8_t *pData, uint32_t length);
 	static std::string ipToString(uint8_t *ip);
 	static bool base64Encode(const std::string &in, std::string *out);
 	static bool base64Decode(const std::string &in, std::string *out);
+
+	static size_t formatDecimal(int32_t value, char* out);
+	static size_t formatDecimal(uint32_t value, char* out);
+	static size_t formatHex(uint32_t value, char* out, int digits = 0);
+	static size_t formatHexBytes(const uint8_t* data, size_t length, char* out, char separator = 0);
+	static size_t formatHexRow(const uint8_t* data, size_t length, char* out);
+	static size_t formatIp(const uint8_t* ip, char* out);
+	static size_t formatMac(const uint8_t* mac, char* out);
+	static size_t formatUuid(const uint8_t* uuid, char* out);
+};
+
+
+/**
+ * @brief Encode data as base64 a part at a time, for data too large to hold in memory at once.
+ *
+ * @code{.cpp}
+ * Base64Encoder encoder;
+ * while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+ *    socket.send_cpp((uint8_t*)text, encoder.encode(buffer, length, text));
+ * }
+ * socket.send_cpp((uint8_t*)text, encoder.finish(text));
+ * @endcode
+ */
+class Base64Encoder {
+public:
+	Base64Encoder(bool url = false);
+	size_t encode(const uint8_t* data, size_t length, char* out);
+	size_t finish(char* out);
+	static size_t getEncodedLength(size_t length);
+
+private:
+	void encodeGroup(const uint8_t* data, char* out);
+
+	const char* m_alphabet;
+	bool        m_pad;
+	uint8_t     m_pending[3];
+	uint8_t     m_pendingLength;
+};
+
+
+/**
+ * @brief Decode base64 text a part at a time.
+ */
+class Base64Decoder {
+public:
+	Base64Decoder();
+	bool decode(const char* data, size_t length, uint8_t* out, size_t* pOutLength);
+	bool finish(uint8_t* out, size_t* pOutLength);
+	static size_t getDecodedLength(size_t length);
+	void reset();
+
+private:
+	size_t flushGroup(uint8_t* out);
+
+	uint32_t m_group;    // The bits of the characters of the current group.
+	uint8_t  m_count;    // The number of characters in the current group.
+	uint8_t  m_padding;  // The number of '=' at the end of the current group.
+	bool     m_error;
 };
 
 #endif /* COMPONENTS_CPP_UTILS_GENERALUTILS_H_ */
@@ -6,7 +6,7 @@
  */
 #if defined(ESP_HAVE_CURL)
 #include "IFTTT.h"
-#include <cJSON.h>
+#include "JSONArena.h"
 
 
 /**
@@ -37,15 +37,13 @@ void IFTTT::trigger(
 		std::string value2,
 		std::string value3) {
 	m_restClient.setURL("https://maker.ifttt.com/trigger/" + event + "/with/key/" + m_key);
-	cJSON *root;
-	root = cJSON_CreateObject();
+	JsonArena arena(384 + value1.length() + value2.length() + value3.length());
+	JsonArenaObject root = arena.createObject();
 
-	cJSON_AddStringToObject(root, "value1", value1.c_str());
-	cJSON_AddStringToObject(root, "value2", value2.c_str());
-	cJSON_AddStringToObject(root, "value3", value3.c_str());
+	root.setString("value1", value1);
+	root.setString("value2", value2);
+	root.setString("value3", value3);
 
-	m_restClient.post(std::string(cJSON_Print(root)));
-
-	cJSON_Delete(root);
+	m_restClient.post(root.toString());
 } // trigger
 #endif // ESP_HAVE_CURL
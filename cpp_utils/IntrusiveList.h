@@ -0,0 +1,210 @@
+/*
+ * IntrusiveList.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_INTRUSIVELIST_H_
+#define COMPONENTS_CPP_UTILS_INTRUSIVELIST_H_
+#include <stddef.h>
+
+/**
+ * @brief The links that let an object be on an IntrusiveList.
+ *
+ * A class derives from IntrusiveListHook once for each list it can be on at the same time,
+ * with a different tag type for each.  An object can be on only one list for each tag.
+ */
+template<typename Tag = void>
+class IntrusiveListHook {
+public:
+	IntrusiveListHook() : m_pPrev(nullptr), m_pNext(nullptr) {}
+	~IntrusiveListHook() {
+		unlink();
+	}
+	/**
+	 * @brief Is the object on a list?
+	 */
+	bool isLinked() const {
+		return m_pNext != nullptr;
+	}
+	/**
+	 * @brief Remove the object from the list it is on, if any.
+	 */
+	void unlink() {
+		if (m_pNext != nullptr) {
+			m_pPrev->m_pNext = m_pNext;
+			m_pNext->m_pPrev = m_pPrev;
+			m_pPrev = nullptr;
+			m_pNext = nullptr;
+		}
+	}
+
+private:
+	// Copying an object does not put the copy on its lists.
+	IntrusiveListHook(const IntrusiveListHook&) : m_pPrev(nullptr), m_pNext(nullptr) {}
+	IntrusiveListHook& operator=(const IntrusiveListHook&) {
+		return *this;
+	}
+
+	template<typename, typename> friend class IntrusiveList;
+	IntrusiveListHook* m_pPrev;
+	IntrusiveListHook* m_pNext;
+}; // IntrusiveListHook
+
+
+/**
+ * @brief A doubly linked list of objects that hold their own links.
+ *
+ * Unlike a std::list or the c_list of c-utils, adding an object allocates nothing, and an
+ * object can be removed in constant time given only a pointer to it.  The list does not own
+ * its objects; an object removes itself from its lists when it is destroyed.
+ *
+ * @code{.cpp}
+ * class Request: public IntrusiveListHook<> { ... };
+ * IntrusiveList<Request> pending;
+ * pending.pushBack(pRequest);
+ * for (Request& request: pending) { ... }
+ * pending.remove(pRequest);
+ * @endcode
+ *
+ * A list is not thread safe.
+ */
+template<typename T, typename Tag = void>
+class IntrusiveList {
+public:
+	typedef IntrusiveListHook<Tag> Hook;
+
+	class Iterator {
+	public:
+		Iterator(Hook* pHook) : m_pHook(pHook) {}
+		T& operator*() const {
+			return *static_cast<T*>(m_pHook);
+		}
+		T* operator->() const {
+			return static_cast<T*>(m_pHook);
+		}
+		Iterator& operator++() {
+			m_pHook = m_pHook->m_pNext;
+			return *this;
+		}
+		bool operator==(const Iterator& other) const {
+			return m_pHook == other.m_pHook;
+		}
+		bool operator!=(const Iterator& other) const {
+			return m_pHook != other.m_pHook;
+		}
+	private:
+		Hook* m_pHook;
+	}; // Iterator
+
+	IntrusiveList() {
+		m_head.m_pPrev = &m_head;
+		m_head.m_pNext = &m_head;
+	}
+	~IntrusiveList() {
+		clear();
+	}
+
+	Iterator begin() {
+		return Iterator(m_head.m_pNext);
+	}
+	Iterator end() {
+		return Iterator(&m_head);
+	}
+
+	/**
+	 * @brief Remove every object from the list.
+	 */
+	void clear() {
+		while (!isEmpty()) {
+			m_head.m_pNext->unlink();
+		}
+	}
+	/**
+	 * @brief Get the first object, or nullptr if the list is empty.
+	 */
+	T* getFirst() {
+		return isEmpty() ? nullptr : static_cast<T*>(m_head.m_pNext);
+	}
+	/**
+	 * @brief Get the last object, or nullptr if the list is empty.
+	 */
+	T* getLast() {
+		return isEmpty() ? nullptr : static_cast<T*>(m_head.m_pPrev);
+	}
+	/**
+	 * @brief Get the object after another on the list, or nullptr if it is the last.
+	 */
+	T* getNext(T* pObject) {
+		Hook* pNext = static_cast<Hook*>(pObject)->m_pNext;
+		return pNext == &m_head ? nullptr : static_cast<T*>(pNext);
+	}
+	/**
+	 * @brief Insert an object before another already on the list.
+	 */
+	void insertBefore(T* pPosition, T* pObject) {
+		link(static_cast<Hook*>(pPosition)->m_pPrev, static_cast<Hook*>(pObject));
+	}
+	bool isEmpty() const {
+		return m_head.m_pNext == &m_head;
+	}
+	/**
+	 * @brief Remove and return the first object, or nullptr if the list is empty.
+	 */
+	T* popFront() {
+		T* pObject = getFirst();
+		if (pObject != nullptr) {
+			remove(pObject);
+		}
+		return pObject;
+	}
+	/**
+	 * @brief Add an object to the end of the list.  It is first removed from any other list
+	 * with the same tag.
+	 */
+	void pushBack(T* pObject) {
+		link(m_head.m_pPrev, static_cast<Hook*>(pObject));
+	}
+	/**
+	 * @brief Add an object to the start of the list.
+	 */
+	void pushFront(T* pObject) {
+		link(&m_head, static_cast<Hook*>(pObject));
+	}
+	/**
+	 * @brief Remove an object from the list.
+	 */
+	void remove(T* pObject) {
+		static_cast<Hook*>(pObject)->unlink();
+	}
+	/**
+	 * @brief Count the objects on the list.  Takes time in proportion to their number.
+	 */
+	size_t size() const {
+		size_t count = 0;
+		for (const Hook* pHook = m_head.m_pNext; pHook != &m_head; pHook = pHook->m_pNext) {
+			count++;
+		}
+		return count;
+	}
+
+private:
+	IntrusiveList(const IntrusiveList&);
+	IntrusiveList& operator=(const IntrusiveList&);
+
+	void link(Hook* pAfter, Hook* pHook) {
+		if (pHook == pAfter) {
+			return;
+		}
+		pHook->unlink();
+		pHook->m_pPrev = pAfter;
+		pHook->m_pNext = pAfter->m_pNext;
+		pAfter->m_pNext->m_pPrev = pHook;
+		pAfter->m_pNext = pHook;
+	}
+
+	Hook m_head;   // The list is a ring through this head.
+}; // IntrusiveList
+
+#endif /* COMPONENTS_CPP_UTILS_INTRUSIVELIST_H_ */
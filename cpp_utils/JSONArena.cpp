@@ -0,0 +1,775 @@
+/*
+ * JSONArena.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JSONArena.h"
+#include "JSONParser.h"
+#include "JSONWriter.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include "sdkconfig.h"
+static const char* LOG_TAG = "JSONArena";
+#else
+#define ESP_LOGD(tag, ...)
+#define ESP_LOGE(tag, ...)
+#endif
+
+static const size_t KEY_TABLE_SIZE    = 32;   // Must be a power of 2.
+
+
+/**
+ * @brief Builds the nodes of a document from the events of a JsonParser.
+ *
+ * Each value is pushed on the arena's scratch stack as it is completed.  When a container
+ * ends, the pointers to its children are popped off the stack into a contiguous array.
+ */
+class JsonArenaBuilder: public JsonParserHandler {
+public:
+	JsonArenaBuilder(JsonArena* pArena) {
+		m_pArena = pArena;
+		m_pParser = nullptr;
+		m_key     = nullptr;
+		m_depth   = 0;
+		m_failed  = false;
+	}
+
+	void onStartObject() override { start(JsonArenaNode::TYPE_OBJECT); }
+	void onEndObject() override { end(); }
+	void onStartArray() override { start(JsonArenaNode::TYPE_ARRAY); }
+	void onEndArray() override { end(); }
+
+	void onKey(const char* key, size_t length) override {
+		m_key = m_pArena->intern(key, length);
+		if (m_key == nullptr) fail();
+	}
+
+	void onString(const char* value, size_t length) override {
+		JsonArenaNode* pNode = m_pArena->newNode(JsonArenaNode::TYPE_STRING);
+		if (pNode != nullptr && (pNode->string = m_pArena->copyString(value, length)) == nullptr) {
+			pNode = nullptr;
+		}
+		push(pNode);
+	}
+
+	void onNumber(double value, const char* text, size_t length) override {
+		JsonArenaNode* pNode = m_pArena->newNode(JsonArenaNode::TYPE_NUMBER);
+		if (pNode != nullptr) pNode->number = value;
+		push(pNode);
+	}
+
+	void onBoolean(bool value) override {
+		push(m_pArena->newNode(value ? JsonArenaNode::TYPE_TRUE : JsonArenaNode::TYPE_FALSE));
+	}
+
+	void onNull() override {
+		push(m_pArena->newNode(JsonArenaNode::TYPE_NULL));
+	}
+
+	JsonParser* m_pParser;
+	bool        m_failed;
+
+private:
+	void fail() {
+		m_failed = true;
+		m_pParser->stop();
+	}
+
+	void push(JsonArenaNode* pNode) {
+		if (pNode == nullptr || m_pArena->m_stack - sizeof(JsonArenaNode*) < m_pArena->m_next) {
+			m_pArena->m_error = "arena full";
+			fail();
+			return;
+		}
+		pNode->key = m_key;
+		m_key = nullptr;
+		m_pArena->m_stack -= sizeof(JsonArenaNode*);
+		*(JsonArenaNode**)m_pArena->m_stack = pNode;
+	}
+
+	void start(uint8_t type) {
+		push(m_pArena->newNode(type));
+		m_base[m_depth++] = m_pArena->m_stack; // The children will be pushed below the container.
+	}
+
+	void end() {
+		uint8_t*        base     = m_base[--m_depth];
+		JsonArenaNode** children = (JsonArenaNode**)m_pArena->m_stack;
+		size_t          count    = (base - m_pArena->m_stack) / sizeof(JsonArenaNode*);
+		JsonArenaNode*  pNode    = *(JsonArenaNode**)base;
+		if (count > UINT16_MAX) {
+			m_pArena->m_error = "too many members";
+			fail();
+			return;
+		}
+		if (count > 0) {
+			JsonArenaNode** array = (JsonArenaNode**)m_pArena->allocate(count * sizeof(JsonArenaNode*), sizeof(JsonArenaNode*));
+			if (array == nullptr) {
+				fail();
+				return;
+			}
+			for (size_t i = 0; i < count; i++) {
+				array[i] = children[count - 1 - i]; // The stack grows down, so the last child is on top.
+			}
+			pNode->children = array;
+		}
+		pNode->count = count;
+		m_pArena->m_stack = base;
+	}
+
+	JsonArena*  m_pArena;
+	const char* m_key;
+	uint8_t*    m_base[JsonParser::MAX_DEPTH];
+	int         m_depth;
+}; // JsonArenaBuilder
+
+
+/**
+ * @brief Find a length no string or number in a JSON text can exceed once parsed.
+ *
+ * Within a string every character counts, as an escape never unescapes to more bytes than it
+ * is written with.  Outside, a token is a run of characters between the structural ones.
+ */
+static size_t longestToken(const std::string& text) {
+	size_t longest  = 0;
+	size_t length   = 0;
+	bool   inString = false;
+	for (size_t i = 0; i < text.length(); i++) {
+		char c = text[i];
+		if (inString) {
+			if (c == '\\') {
+				length += 2;
+				i++;
+				continue;
+			}
+			if (c != '"') {
+				length++;
+				continue;
+			}
+			inString = false;
+		} else if (c == '"') {
+			inString = true;
+		} else if (::strchr(",:[]{} \t\r\n", c) == nullptr) {
+			length++;
+			continue;
+		}
+		if (length > longest) {
+			longest = length;
+		}
+		length = 0;
+	}
+	return length > longest ? length : longest;
+} // longestToken
+
+
+static void writeNode(JsonWriter& writer, JsonArenaNode* pNode) {
+	switch (pNode->type) {
+		case JsonArenaNode::TYPE_NULL:   writer.valueNull();           break;
+		case JsonArenaNode::TYPE_FALSE:  writer.value(false);          break;
+		case JsonArenaNode::TYPE_TRUE:   writer.value(true);           break;
+		case JsonArenaNode::TYPE_NUMBER: writer.value(pNode->number);  break;
+		case JsonArenaNode::TYPE_STRING: writer.value(pNode->string);  break;
+		case JsonArenaNode::TYPE_ARRAY:
+			writer.beginArray();
+			for (int i = 0; i < pNode->count; i++) {
+				writeNode(writer, pNode->children[i]);
+			}
+			writer.endArray();
+			break;
+		case JsonArenaNode::TYPE_OBJECT:
+			writer.beginObject();
+			for (int i = 0; i < pNode->count; i++) {
+				writer.key(pNode->children[i]->key);
+				writeNode(writer, pNode->children[i]);
+			}
+			writer.endObject();
+			break;
+	}
+} // writeNode
+
+
+static std::string nodeToString(JsonArenaNode* pNode) {
+	std::string    out;
+	JsonStringSink sink(&out);
+	JsonWriter     writer(&sink, 256);
+	if (pNode != nullptr) {
+		writeNode(writer, pNode);
+	}
+	writer.flush();
+	return out;
+} // nodeToString
+
+
+/**
+ * @brief Create an arena.
+ * @param [in] capacity The size of the block that will hold the documents.
+ */
+JsonArena::JsonArena(size_t capacity) {
+	m_data = (uint8_t*)malloc(capacity);
+	if (m_data == nullptr) {
+		ESP_LOGE(LOG_TAG, "JsonArena: unable to allocate %d bytes", (int)capacity);
+		capacity = 0;
+	}
+	m_end = m_data + (capacity & ~(sizeof(JsonArenaNode*) - 1)); // The scratch stack holds pointers.
+	clear();
+} // JsonArena
+
+
+JsonArena::~JsonArena() {
+	free(m_data);
+} // ~JsonArena
+
+
+/**
+ * @brief Release every value in the arena.  Objects and arrays obtained from it become invalid.
+ */
+void JsonArena::clear() {
+	m_next  = m_data;
+	m_stack = m_end;
+	m_error.clear();
+	m_keys  = (const char**)allocate(KEY_TABLE_SIZE * sizeof(const char*), sizeof(const char*));
+	if (m_keys != nullptr) {
+		::memset(m_keys, 0, KEY_TABLE_SIZE * sizeof(const char*));
+	}
+} // clear
+
+
+/**
+ * @brief Create an empty array in the arena.
+ * @return The array, which is invalid if the arena is full.
+ */
+JsonArenaArray JsonArena::createArray() {
+	return JsonArenaArray(this, newNode(JsonArenaNode::TYPE_ARRAY));
+} // createArray
+
+
+/**
+ * @brief Create an empty object in the arena.
+ * @return The object, which is invalid if the arena is full.
+ */
+JsonArenaObject JsonArena::createObject() {
+	return JsonArenaObject(this, newNode(JsonArenaNode::TYPE_OBJECT));
+} // createObject
+
+
+/**
+ * @brief Get the size of the arena.
+ * @return The size of the arena in bytes.
+ */
+size_t JsonArena::getCapacity() {
+	return m_end - m_data;
+} // getCapacity
+
+
+/**
+ * @brief Get the reason the last parse or allocation failed.
+ * @return The error, or an empty string if there was none.
+ */
+std::string JsonArena::getError() {
+	return m_error;
+} // getError
+
+
+/**
+ * @brief Get the space used in the arena.
+ * @return The number of bytes used.
+ */
+size_t JsonArena::getUsed() {
+	return m_next - m_data;
+} // getUsed
+
+
+/**
+ * @brief Parse a string that contains a JSON array into the arena.
+ * @param [in] text The JSON text string.
+ * @return The array, which is invalid if the text is not a JSON array or the arena is full.
+ */
+JsonArenaArray JsonArena::parseArray(const std::string& text) {
+	return JsonArenaArray(this, parse(text, JsonArenaNode::TYPE_ARRAY));
+} // parseArray
+
+
+/**
+ * @brief Parse a string that contains a JSON object into the arena.
+ * @param [in] text The JSON text string.
+ * @return The object, which is invalid if the text is not a JSON object or the arena is full.
+ */
+JsonArenaObject JsonArena::parseObject(const std::string& text) {
+	return JsonArenaObject(this, parse(text, JsonArenaNode::TYPE_OBJECT));
+} // parseObject
+
+
+bool JsonArena::addChild(JsonArenaNode* pParent, JsonArenaNode* pChild) {
+	if (pParent->count == UINT16_MAX) {
+		m_error = "too many members";
+		return false;
+	}
+	size_t capacity = pParent->capacity ? (1u << pParent->capacity) : pParent->count;
+	if (pParent->count == capacity) {
+		uint8_t log2 = 2;
+		while ((1u << log2) <= pParent->count) {
+			log2++;
+		}
+		JsonArenaNode** children = (JsonArenaNode**)allocate((1u << log2) * sizeof(JsonArenaNode*), sizeof(JsonArenaNode*));
+		if (children == nullptr) {
+			return false;
+		}
+		if (pParent->count > 0) {
+			::memcpy(children, pParent->children, pParent->count * sizeof(JsonArenaNode*));
+		}
+		pParent->children = children; // The old array is not reclaimed until the arena is cleared.
+		pParent->capacity = log2;
+	}
+	pParent->children[pParent->count++] = pChild;
+	return true;
+} // addChild
+
+
+void* JsonArena::allocate(size_t size, size_t align) {
+	uint8_t* p = (uint8_t*)(((uintptr_t)m_next + align - 1) & ~(uintptr_t)(align - 1));
+	if (m_data == nullptr || p + size > m_stack) {
+		m_error = "arena full";
+		return nullptr;
+	}
+	m_next = p + size;
+	return p;
+} // allocate
+
+
+const char* JsonArena::copyString(const char* text, size_t length) {
+	char* copy = (char*)allocate(length + 1, 1);
+	if (copy != nullptr) {
+		::memcpy(copy, text, length);
+		copy[length] = 0;
+	}
+	return copy;
+} // copyString
+
+
+/**
+ * @brief Find a key in the key table, adding it if it is new and there is room.
+ */
+const char* JsonArena::intern(const char* key, size_t length) {
+	if (m_keys == nullptr) {
+		return copyString(key, length);
+	}
+	uint32_t hash = 2166136261u; // FNV-1a
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+	}
+	for (size_t probe = 0; probe < KEY_TABLE_SIZE / 2; probe++) {
+		const char** pSlot = &m_keys[(hash + probe) & (KEY_TABLE_SIZE - 1)];
+		if (*pSlot == nullptr) {
+			return *pSlot = copyString(key, length);
+		}
+		if (::strncmp(*pSlot, key, length) == 0 && (*pSlot)[length] == 0) {
+			return *pSlot;
+		}
+	}
+	return copyString(key, length); // The table is too full; store the key without interning it.
+} // intern
+
+
+JsonArenaNode* JsonArena::newNode(uint8_t type) {
+	JsonArenaNode* pNode = (JsonArenaNode*)allocate(sizeof(JsonArenaNode), alignof(JsonArenaNode));
+	if (pNode != nullptr) {
+		::memset(pNode, 0, sizeof(JsonArenaNode));
+		pNode->type = type;
+	}
+	return pNode;
+} // newNode
+
+
+JsonArenaNode* JsonArena::parse(const std::string& text, uint8_t type) {
+	m_error.clear();
+	// The parser's token buffer is scratch space at the top of the arena, sized so that any
+	// string in the text fits, and released with the rest of the scratch stack after the parse.
+	size_t tokenLength = longestToken(text);
+	size_t tokenSize   = (tokenLength + 1 + sizeof(JsonArenaNode*) - 1) & ~(sizeof(JsonArenaNode*) - 1);
+	if (m_data == nullptr || (size_t)(m_stack - m_next) < tokenSize) {
+		m_error = "arena full";
+		return nullptr;
+	}
+	m_stack -= tokenSize;
+	JsonArenaBuilder builder(this);
+	JsonParser       parser(&builder, (char*)m_stack, tokenLength);
+	builder.m_pParser = &parser;
+
+	bool ok = parser.parse(text) && !builder.m_failed;
+	JsonArenaNode* pRoot = ok ? *(JsonArenaNode**)m_stack : nullptr;
+	m_stack = m_end;
+	if (!ok) {
+		if (m_error.empty()) {
+			m_error = parser.getError();
+		}
+		ESP_LOGD(LOG_TAG, "parse: %s", m_error.c_str());
+		return nullptr;
+	}
+	if (pRoot->type != type) {
+		m_error = (type == JsonArenaNode::TYPE_OBJECT) ? "not an object" : "not an array";
+		return nullptr;
+	}
+	return pRoot;
+} // parse
+
+
+JsonArenaArray::JsonArenaArray(JsonArena* pArena, JsonArenaNode* node) {
+	m_pArena = pArena;
+	m_node   = (node != nullptr && node->type == JsonArenaNode::TYPE_ARRAY) ? node : nullptr;
+} // JsonArenaArray
+
+
+/**
+ * @brief Add a boolean value to the array.
+ * @param [in] value The boolean value to add to the array.
+ */
+void JsonArenaArray::addBoolean(bool value) {
+	JsonArenaNode* pNode = m_node ? m_pArena->newNode(value ? JsonArenaNode::TYPE_TRUE : JsonArenaNode::TYPE_FALSE) : nullptr;
+	if (pNode != nullptr) {
+		m_pArena->addChild(m_node, pNode);
+	}
+} // addBoolean
+
+
+/**
+ * @brief Add a double value to the array.
+ * @param [in] value The double value to add to the array.
+ */
+void JsonArenaArray::addDouble(double value) {
+	JsonArenaNode* pNode = m_node ? m_pArena->newNode(JsonArenaNode::TYPE_NUMBER) : nullptr;
+	if (pNode != nullptr) {
+		pNode->number = value;
+		m_pArena->addChild(m_node, pNode);
+	}
+} // addDouble
+
+
+/**
+ * @brief Add an int value to the array.
+ * @param [in] value The int value to add to the array.
+ */
+void JsonArenaArray::addInt(int value) {
+	addDouble(value);
+} // addInt
+
+
+/**
+ * @brief Add an object value to the array.
+ * @param [in] value The object value to add to the array.
+ */
+void JsonArenaArray::addObject(JsonArenaObject value) {
+	if (m_node != nullptr && value.m_node != nullptr) {
+		// The key is kept: the object may also be a member of an object, and array elements ignore it.
+		m_pArena->addChild(m_node, value.m_node);
+	}
+} // addObject
+
+
+/**
+ * @brief Add a string value to the array.
+ * @param [in] value The string value to add to the array.
+ */
+void JsonArenaArray::addString(std::string value) {
+	JsonArenaNode* pNode = m_node ? m_pArena->newNode(JsonArenaNode::TYPE_STRING) : nullptr;
+	if (pNode != nullptr && (pNode->string = m_pArena->copyString(value.data(), value.length())) != nullptr) {
+		m_pArena->addChild(m_node, pNode);
+	}
+} // addString
+
+
+/**
+ * @brief Get the indexed boolean value from the array.
+ * @param [in] item The index of the array to retrieve.
+ * @return The boolean value at the given index, false if there is none.
+ */
+bool JsonArenaArray::getBoolean(int item) {
+	if (item < 0 || item >= size()) return false;
+	JsonArenaNode* pNode = m_node->children[item];
+	return pNode->type == JsonArenaNode::TYPE_TRUE || (pNode->type == JsonArenaNode::TYPE_NUMBER && pNode->number != 0);
+} // getBoolean
+
+
+/**
+ * @brief Get the indexed double value from the array.
+ * @param [in] item The index of the array to retrieve.
+ * @return The double value at the given index, 0 if there is none.
+ */
+double JsonArenaArray::getDouble(int item) {
+	if (item < 0 || item >= size() || m_node->children[item]->type != JsonArenaNode::TYPE_NUMBER) return 0;
+	return m_node->children[item]->number;
+} // getDouble
+
+
+/**
+ * @brief Get the indexed int value from the array.
+ * @param [in] item The index of the array to retrieve.
+ * @return The int value at the given index, 0 if there is none.
+ */
+int JsonArenaArray::getInt(int item) {
+	return (int)getDouble(item);
+} // getInt
+
+
+/**
+ * @brief Get the indexed object value from the array.
+ * @param [in] item The index of the array to retrieve.
+ * @return The object value at the given index, which is invalid if there is none.
+ */
+JsonArenaObject JsonArenaArray::getObject(int item) {
+	return JsonArenaObject(m_pArena, (item >= 0 && item < size()) ? m_node->children[item] : nullptr);
+} // getObject
+
+
+/**
+ * @brief Get the indexed string value from the array.
+ * @param [in] item The index of the array to retrieve.
+ * @return The string value at the given index, empty if there is none.
+ */
+std::string JsonArenaArray::getString(int item) {
+	if (item < 0 || item >= size() || m_node->children[item]->type != JsonArenaNode::TYPE_STRING) return "";
+	return std::string(m_node->children[item]->string);
+} // getString
+
+
+/**
+ * @brief Determine whether the array exists.
+ * @return False if the array was not found, did not parse or could not be allocated.
+ */
+bool JsonArenaArray::isValid() {
+	return m_node != nullptr;
+} // isValid
+
+
+/**
+ * @brief Get the number of items in the array.
+ * @return The number of items.
+ */
+int JsonArenaArray::size() {
+	return m_node ? m_node->count : 0;
+} // size
+
+
+/**
+ * @brief Convert the JSON array to a string without whitespace.
+ * @return A JSON string representation of the array.
+ */
+std::string JsonArenaArray::toString() {
+	return nodeToString(m_node);
+} // toString
+
+
+/**
+ * @brief Write the JSON array through a JsonWriter, for example straight to a socket.
+ * @param [in] writer The writer, positioned where a value is expected.
+ */
+void JsonArenaArray::write(JsonWriter& writer) {
+	if (m_node != nullptr) {
+		writeNode(writer, m_node);
+	}
+} // write
+
+
+JsonArenaObject::JsonArenaObject(JsonArena* pArena, JsonArenaNode* node) {
+	m_pArena = pArena;
+	m_node   = (node != nullptr && node->type == JsonArenaNode::TYPE_OBJECT) ? node : nullptr;
+} // JsonArenaObject
+
+
+/**
+ * @brief Get the named array value from the object.
+ * @param [in] name The name of the object property.
+ * @return The array value, which is invalid if there is none.
+ */
+JsonArenaArray JsonArenaObject::getArray(std::string name) {
+	return JsonArenaArray(m_pArena, find(name));
+} // getArray
+
+
+/**
+ * @brief Get the named boolean value from the object.
+ * @param [in] name The name of the object property.
+ * @return The boolean value from the object, false if there is none.
+ */
+bool JsonArenaObject::getBoolean(std::string name) {
+	JsonArenaNode* pNode = find(name);
+	return pNode != nullptr && (pNode->type == JsonArenaNode::TYPE_TRUE || (pNode->type == JsonArenaNode::TYPE_NUMBER && pNode->number != 0));
+} // getBoolean
+
+
+/**
+ * @brief Get the named double value from the object.
+ * @param [in] name The name of the object property.
+ * @return The double value from the object, 0 if there is none.
+ */
+double JsonArenaObject::getDouble(std::string name) {
+	JsonArenaNode* pNode = find(name);
+	return (pNode != nullptr && pNode->type == JsonArenaNode::TYPE_NUMBER) ? pNode->number : 0;
+} // getDouble
+
+
+/**
+ * @brief Get the named int value from the object.
+ * @param [in] name The name of the object property.
+ * @return The int value from the object, 0 if there is none.
+ */
+int JsonArenaObject::getInt(std::string name) {
+	return (int)getDouble(name);
+} // getInt
+
+
+/**
+ * @brief Get the named object value from the object.
+ * @param [in] name The name of the object property.
+ * @return The object value, which is invalid if there is none.
+ */
+JsonArenaObject JsonArenaObject::getObject(std::string name) {
+	return JsonArenaObject(m_pArena, find(name));
+} // getObject
+
+
+/**
+ * @brief Get the named string value from the object.
+ * @param [in] name The name of the object property.
+ * @return The string value from the object, empty if there is none.
+ */
+std::string JsonArenaObject::getString(std::string name) {
+	JsonArenaNode* pNode = find(name);
+	return (pNode != nullptr && pNode->type == JsonArenaNode::TYPE_STRING) ? std::string(pNode->string) : "";
+} // getString
+
+
+/**
+ * @brief Determine whether the object exists.
+ * @return False if the object was not found, did not parse or could not be allocated.
+ */
+bool JsonArenaObject::isValid() {
+	return m_node != nullptr;
+} // isValid
+
+
+/**
+ * @brief Set the named array property.
+ * @param [in] name The name of the property to add.
+ * @param [in] array The array to add to the object.
+ */
+void JsonArenaObject::setArray(std::string name, JsonArenaArray array) {
+	set(name, array.m_node);
+} // setArray
+
+
+/**
+ * @brief Set the named boolean property.
+ * @param [in] name The name of the property to add.
+ * @param [in] value The boolean to add to the object.
+ */
+void JsonArenaObject::setBoolean(std::string name, bool value) {
+	set(name, m_node ? m_pArena->newNode(value ? JsonArenaNode::TYPE_TRUE : JsonArenaNode::TYPE_FALSE) : nullptr);
+} // setBoolean
+
+
+/**
+ * @brief Set the named double property.
+ * @param [in] name The name of the property to add.
+ * @param [in] value The double to add to the object.
+ */
+void JsonArenaObject::setDouble(std::string name, double value) {
+	JsonArenaNode* pNode = m_node ? m_pArena->newNode(JsonArenaNode::TYPE_NUMBER) : nullptr;
+	if (pNode != nullptr) {
+		pNode->number = value;
+	}
+	set(name, pNode);
+} // setDouble
+
+
+/**
+ * @brief Set the named int property.
+ * @param [in] name The name of the property to add.
+ * @param [in] value The int to add to the object.
+ */
+void JsonArenaObject::setInt(std::string name, int value) {
+	setDouble(name, value);
+} // setInt
+
+
+/**
+ * @brief Set the named object property.
+ * @param [in] name The name of the property to add.
+ * @param [in] value The object to add to the object.
+ */
+void JsonArenaObject::setObject(std::string name, JsonArenaObject value) {
+	set(name, value.m_node);
+} // setObject
+
+
+/**
+ * @brief Set the named string property.
+ * @param [in] name The name of the property to add.
+ * @param [in] value The string to add to the object.
+ */
+void JsonArenaObject::setString(std::string name, std::string value) {
+	JsonArenaNode* pNode = m_node ? m_pArena->newNode(JsonArenaNode::TYPE_STRING) : nullptr;
+	if (pNode != nullptr && (pNode->string = m_pArena->copyString(value.data(), value.length())) == nullptr) {
+		pNode = nullptr;
+	}
+	set(name, pNode);
+} // setString
+
+
+/**
+ * @brief Convert the JSON object to a string without whitespace.
+ * @return A JSON string representation of the object.
+ */
+std::string JsonArenaObject::toString() {
+	return nodeToString(m_node);
+} // toString
+
+
+/**
+ * @brief Write the JSON object through a JsonWriter, for example straight to a socket.
+ * @param [in] writer The writer, positioned where a value is expected.
+ */
+void JsonArenaObject::write(JsonWriter& writer) {
+	if (m_node != nullptr) {
+		writeNode(writer, m_node);
+	}
+} // write
+
+
+JsonArenaNode* JsonArenaObject::find(const std::string& name) {
+	if (m_node == nullptr) {
+		return nullptr;
+	}
+	for (int i = 0; i < m_node->count; i++) {
+		const char* key = m_node->children[i]->key;
+		if (key != nullptr && ::strcmp(key, name.c_str()) == 0) {
+			return m_node->children[i];
+		}
+	}
+	return nullptr;
+} // find
+
+
+/**
+ * @brief Add a member.  As with cJSON, an existing member of the same name is not replaced.
+ *
+ * The key is held in the node, so a node already a member under another name is refused.
+ */
+void JsonArenaObject::set(const std::string& name, JsonArenaNode* pValue) {
+	if (m_node == nullptr || pValue == nullptr) {
+		return;
+	}
+	if (pValue->key != nullptr && name != pValue->key) {
+		m_pArena->m_error = "already a member under another name";
+		return;
+	}
+	const char* key = m_pArena->intern(name.data(), name.length());
+	if (key != nullptr) {
+		pValue->key = key;
+		m_pArena->addChild(m_node, pValue);
+	}
+} // set
@@ -0,0 +1,160 @@
+/*
+ * JSONArena.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_JSONARENA_H_
+#define COMPONENTS_CPP_UTILS_JSONARENA_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Forward declarations
+class JsonArena;
+class JsonArenaArray;
+class JsonArenaObject;
+class JsonWriter;
+
+/**
+ * @brief A value in a JsonArena.
+ *
+ * 16 bytes on the ESP32.  The members of an object or array are a contiguous array of
+ * pointers to their nodes.
+ */
+struct JsonArenaNode {
+	typedef enum {
+		TYPE_NULL, TYPE_FALSE, TYPE_TRUE, TYPE_NUMBER, TYPE_STRING, TYPE_ARRAY, TYPE_OBJECT
+	} type_t;
+
+	union {
+		double          number;
+		const char*     string;
+		JsonArenaNode** children;
+	};
+	const char* key;       // Interned.  nullptr for array elements and the root.
+	uint16_t    count;     // Number of children.
+	uint8_t     capacity;  // log2 of the space for children, or 0 if exactly count (as parsed).
+	uint8_t     type;
+};
+
+
+/**
+ * @brief A JSON document held in a single block of memory.
+ *
+ * Where JSON::parseObject() allocates every node and string from the heap, a JsonArena
+ * allocates them from one block by bumping a pointer, and frees them all at once when it is
+ * destroyed or cleared.  Object keys are interned, so the keys of an array of similar objects
+ * are stored once.  The JsonArenaObject and JsonArenaArray accessors match those of
+ * JsonObject and JsonArray.  While a text is parsed, the top of the block also holds the
+ * parser's buffer, as long as the longest string in the text.
+ *
+ * @code{.cpp}
+ * JsonArena arena(4096);
+ * JsonArenaObject config = arena.parseObject(text);
+ * int port = config.getObject("mqtt").getInt("port");
+ * @endcode
+ *
+ * Objects and arrays added to another with setObject(), setArray() or addObject() are added
+ * by reference, as with JsonObject, and must belong to the same arena.  A node holds its own
+ * key, so it can be a member under one name only: setting it under a second name fails and
+ * getError() says why.
+ */
+class JsonArena {
+public:
+	JsonArena(size_t capacity = 8192);
+	virtual ~JsonArena();
+	void            clear();
+	JsonArenaArray  createArray();
+	JsonArenaObject createObject();
+	size_t          getCapacity();
+	std::string     getError();
+	size_t          getUsed();
+	JsonArenaArray  parseArray(const std::string& text);
+	JsonArenaObject parseObject(const std::string& text);
+
+private:
+	friend class JsonArenaArray;
+	friend class JsonArenaObject;
+	friend class JsonArenaBuilder;
+
+	void*          allocate(size_t size, size_t align);
+	bool           addChild(JsonArenaNode* pParent, JsonArenaNode* pChild);
+	const char*    copyString(const char* text, size_t length);
+	const char*    intern(const char* key, size_t length);
+	JsonArenaNode* newNode(uint8_t type);
+	JsonArenaNode* parse(const std::string& text, uint8_t type);
+
+	uint8_t*     m_data;
+	uint8_t*     m_next;      // Allocations are made upwards from here ...
+	uint8_t*     m_stack;     // ... and the parser's scratch stack grows down from here.
+	uint8_t*     m_end;
+	const char** m_keys;      // Interned keys: an open addressed hash table.
+	std::string  m_error;
+};
+
+
+/**
+ * @brief A JSON array in a JsonArena.
+ */
+class JsonArenaArray {
+public:
+	JsonArenaArray(JsonArena* pArena, JsonArenaNode* node);
+	int             getInt(int item);
+	JsonArenaObject getObject(int item);
+	std::string     getString(int item);
+	bool            getBoolean(int item);
+	double          getDouble(int item);
+	bool            isValid();
+	int             size();
+	void            addBoolean(bool value);
+	void            addDouble(double value);
+	void            addInt(int value);
+	void            addObject(JsonArenaObject value);
+	void            addString(std::string value);
+	std::string     toString();
+	void            write(JsonWriter& writer);
+
+	JsonArena*     m_pArena;
+	/**
+	 * @brief The underlying node, nullptr if the array does not exist.
+	 */
+	JsonArenaNode* m_node;
+}; // JsonArenaArray
+
+
+/**
+ * @brief A JSON object in a JsonArena.
+ */
+class JsonArenaObject {
+public:
+	JsonArenaObject(JsonArena* pArena, JsonArenaNode* node);
+	int             getInt(std::string name);
+	JsonArenaArray  getArray(std::string name);
+	JsonArenaObject getObject(std::string name);
+	std::string     getString(std::string name);
+	bool            getBoolean(std::string name);
+	double          getDouble(std::string name);
+	bool            isValid();
+	void            setArray(std::string name, JsonArenaArray array);
+	void            setBoolean(std::string name, bool value);
+	void            setDouble(std::string name, double value);
+	void            setInt(std::string name, int value);
+	void            setObject(std::string name, JsonArenaObject value);
+	void            setString(std::string name, std::string value);
+	std::string     toString();
+	void            write(JsonWriter& writer);
+
+	JsonArena*     m_pArena;
+	/**
+	 * @brief The underlying node, nullptr if the object does not exist.
+	 */
+	JsonArenaNode* m_node;
+
+private:
+	JsonArenaNode* find(const std::string& name);
+	void           set(const std::string& name, JsonArenaNode* pValue);
+}; // JsonArenaObject
+
+#endif /* COMPONENTS_CPP_UTILS_JSONARENA_H_ */
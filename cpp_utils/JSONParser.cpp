@@ -0,0 +1,688 @@
+/*
+ * JSONParser.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JSONParser.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include "sdkconfig.h"
+static const char* LOG_TAG = "JSONParser";
+#else
+#define ESP_LOGD(tag, ...)
+#define ESP_LOGE(tag, ...)
+#endif
+
+
+static bool isWhitespace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+} // isWhitespace
+
+
+static int hexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+} // hexValue
+
+
+/**
+ * @brief Check a number against the JSON grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ */
+static bool isValidNumber(const char* p, const char* end) {
+	if (p < end && *p == '-') p++;
+	if (p == end) return false;
+	if (*p == '0') {
+		p++;
+	} else if (*p >= '1' && *p <= '9') {
+		while (p < end && *p >= '0' && *p <= '9') p++;
+	} else {
+		return false;
+	}
+	if (p < end && *p == '.') {
+		const char* digits = ++p;
+		while (p < end && *p >= '0' && *p <= '9') p++;
+		if (p == digits) return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < end && (*p == '+' || *p == '-')) p++;
+		const char* digits = p;
+		while (p < end && *p >= '0' && *p <= '9') p++;
+		if (p == digits) return false;
+	}
+	return p == end;
+} // isValidNumber
+
+
+/**
+ * @brief Create a parser.
+ * @param [in] pHandler The handler to receive the parse events.
+ * @param [in] maxTokenLength The longest string (after unescaping) or number that can be parsed.
+ */
+JsonParser::JsonParser(JsonParserHandler* pHandler, size_t maxTokenLength) {
+	m_pHandler       = pHandler;
+	m_maxTokenLength = maxTokenLength;
+	m_token          = new char[maxTokenLength + 1];
+	m_ownsToken      = true;
+	reset();
+} // JsonParser
+
+
+/**
+ * @brief Create a parser that uses the caller's buffer for strings and numbers, and allocates nothing.
+ * @param [in] pHandler The handler to receive the parse events.
+ * @param [in] tokenBuffer A buffer of maxTokenLength + 1 bytes, which must outlive the parser.
+ * @param [in] maxTokenLength The longest string (after unescaping) or number that can be parsed.
+ */
+JsonParser::JsonParser(JsonParserHandler* pHandler, char* tokenBuffer, size_t maxTokenLength) {
+	m_pHandler       = pHandler;
+	m_maxTokenLength = maxTokenLength;
+	m_token          = tokenBuffer;
+	m_ownsToken      = false;
+	reset();
+} // JsonParser
+
+
+JsonParser::~JsonParser() {
+	if (m_ownsToken) {
+		delete[] m_token;
+	}
+} // ~JsonParser
+
+
+/**
+ * @brief Signal the end of the text.
+ * @return True if the text was a complete JSON value (or the parse was stopped).
+ */
+bool JsonParser::end() {
+	if (m_state == STATE_NUMBER && m_depth == 0) {
+		finishNumber(); // A top level number has nothing after it to end it.
+	}
+	if (m_state == STATE_DONE || m_state == STATE_STOPPED) {
+		return true;
+	}
+	return m_state == STATE_ERROR ? false : fail("unexpected end of text");
+} // end
+
+
+/**
+ * @brief Parse the next chunk of text.
+ *
+ * The handler is called for every value completed by this chunk.
+ *
+ * @param [in] data The text.
+ * @param [in] length The length of the text.
+ * @return False if the text is not valid JSON.
+ */
+bool JsonParser::feed(const char* data, size_t length) {
+	size_t i = 0;
+	while (i < length) {
+		char c = data[i];
+		switch (m_state) {
+			case STATE_VALUE:
+			case STATE_VALUE_OR_END:
+				if (isWhitespace(c)) break;
+				if (c == ']' && m_state == STATE_VALUE_OR_END) {
+					endContainer(c);
+				} else if (!startValue(c)) {
+					return false;
+				}
+				break;
+
+			case STATE_KEY_OR_END:
+			case STATE_KEY:
+				if (isWhitespace(c)) break;
+				if (c == '}' && m_state == STATE_KEY_OR_END) {
+					endContainer(c);
+				} else if (c == '"') {
+					m_isKey       = true;
+					m_tokenLength = 0;
+					m_state       = STATE_STRING;
+				} else {
+					return fail("expected a key");
+				}
+				break;
+
+			case STATE_COLON:
+				if (isWhitespace(c)) break;
+				if (c != ':') return fail("expected ':'");
+				m_state = STATE_VALUE;
+				break;
+
+			case STATE_COMMA_OR_END: {
+				if (isWhitespace(c)) break;
+				bool inArray = (m_arrays >> (m_depth - 1)) & 1;
+				if (c == ',') {
+					m_state = inArray ? STATE_VALUE : STATE_KEY;
+				} else if (c == (inArray ? ']' : '}')) {
+					endContainer(c);
+				} else {
+					return fail(inArray ? "expected ',' or ']'" : "expected ',' or '}'");
+				}
+				break;
+			}
+
+			case STATE_STRING: {
+				// Copy a run of plain characters at once.
+				size_t start = i;
+				while (i < length && data[i] != '"' && data[i] != '\\' && (uint8_t)data[i] >= 0x20) {
+					i++;
+				}
+				if (i > start && (!appendHighSurrogate() || !append(data + start, i - start))) return false;
+				m_position += i - start;
+				if (i == length) continue;
+				c = data[i];
+				if (c == '\\') {
+					m_state = STATE_ESCAPE;
+				} else if (c == '"') {
+					if (!appendHighSurrogate()) return false;
+					m_token[m_tokenLength] = 0;
+					if (m_isKey) {
+						m_state = STATE_COLON;
+						m_pHandler->onKey(m_token, m_tokenLength);
+					} else {
+						m_pHandler->onString(m_token, m_tokenLength);
+						valueDone();
+					}
+				} else {
+					return fail("control character in string");
+				}
+				break;
+			}
+
+			case STATE_ESCAPE: {
+				const char* from = "\"\\/bfnrt";
+				const char* to   = "\"\\/\b\f\n\r\t";
+				const char* p    = strchr(from, c);
+				if (c == 'u') {
+					m_unicode       = 0;
+					m_unicodeDigits = 0;
+					m_state         = STATE_UNICODE;
+					break;
+				}
+				if (c == 0 || p == nullptr) return fail("invalid escape");
+				if (!appendHighSurrogate() || !append(to + (p - from), 1)) return false;
+				m_state = STATE_STRING;
+				break;
+			}
+
+			case STATE_UNICODE: {
+				int digit = hexValue(c);
+				if (digit < 0) return fail("invalid \\u escape");
+				m_unicode = (m_unicode << 4) | digit;
+				if (++m_unicodeDigits < 4) break;
+				m_state = STATE_STRING;
+				if (m_highSurrogate != 0 && m_unicode >= 0xDC00 && m_unicode <= 0xDFFF) {
+					m_unicode = 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_unicode - 0xDC00);
+					m_highSurrogate = 0;
+				} else {
+					if (!appendHighSurrogate()) return false;
+					if (m_unicode >= 0xD800 && m_unicode <= 0xDBFF) {
+						m_highSurrogate = m_unicode; // Wait for the low half of the pair.
+						break;
+					}
+				}
+				if (!appendCodePoint(m_unicode)) return false;
+				break;
+			}
+
+			case STATE_NUMBER:
+				if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+					if (!append(&c, 1)) return false;
+					break;
+				}
+				if (!finishNumber()) return false;
+				continue; // The character after the number has not been handled yet.
+
+			case STATE_LITERAL:
+				if (c != m_literal[m_literalPos]) return fail("invalid literal");
+				if (m_literal[++m_literalPos] != 0) break;
+				if (m_literal[0] == 'n') {
+					m_pHandler->onNull();
+				} else {
+					m_pHandler->onBoolean(m_literal[0] == 't');
+				}
+				valueDone();
+				break;
+
+			case STATE_DONE:
+				if (!isWhitespace(c)) return fail("unexpected text after the value");
+				break;
+
+			case STATE_STOPPED:
+				return true;
+
+			case STATE_ERROR:
+				return false;
+		}
+		i++;
+		m_position++;
+	}
+	return m_state != STATE_ERROR;
+} // feed
+
+
+/**
+ * @brief Get a description of the error that ended the parse.
+ * @return The error, or an empty string if there was none.
+ */
+std::string JsonParser::getError() {
+	if (m_error == nullptr) {
+		return "";
+	}
+	char position[24];
+	snprintf(position, sizeof(position), " at offset %u", (unsigned)m_position);
+	return std::string(m_error) + position;
+} // getError
+
+
+/**
+ * @brief Get the number of characters parsed so far.
+ * @return The number of characters parsed.
+ */
+size_t JsonParser::getPosition() {
+	return m_position;
+} // getPosition
+
+
+/**
+ * @brief Parse a complete JSON text.
+ * @param [in] text The JSON text.
+ * @return True if the text is valid JSON.
+ */
+bool JsonParser::parse(const std::string& text) {
+	reset();
+	return feed(text.data(), text.length()) && end();
+} // parse
+
+
+/**
+ * @brief Parse a file containing JSON, a block at a time.
+ * @param [in] path The path of the file.
+ * @return True if the file was read and is valid JSON.
+ */
+bool JsonParser::parseFile(std::string path) {
+	reset();
+	FILE* file = fopen(path.c_str(), "r");
+	if (file == nullptr) {
+		ESP_LOGE(LOG_TAG, "parseFile: unable to open %s", path.c_str());
+		return fail("unable to open file");
+	}
+	char   buffer[256];
+	size_t length;
+	bool   ok = true;
+	while (ok && m_state != STATE_STOPPED && (length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		ok = feed(buffer, length);
+	}
+	fclose(file);
+	return ok && end();
+} // parseFile
+
+
+/**
+ * @brief Prepare to parse a new text.
+ */
+void JsonParser::reset() {
+	m_state         = STATE_VALUE;
+	m_tokenLength   = 0;
+	m_isKey         = false;
+	m_literal       = nullptr;
+	m_literalPos    = 0;
+	m_unicode       = 0;
+	m_unicodeDigits = 0;
+	m_highSurrogate = 0;
+	m_arrays        = 0;
+	m_depth         = 0;
+	m_position      = 0;
+	m_error         = nullptr;
+} // reset
+
+
+/**
+ * @brief Ignore the rest of the text.  May be called from a handler event.
+ */
+void JsonParser::stop() {
+	if (m_state != STATE_ERROR) {
+		m_state = STATE_STOPPED;
+	}
+} // stop
+
+
+bool JsonParser::append(const char* data, size_t length) {
+	if (m_tokenLength + length > m_maxTokenLength) {
+		return fail("string or number too long");
+	}
+	::memcpy(m_token + m_tokenLength, data, length);
+	m_tokenLength += length;
+	return true;
+} // append
+
+
+/**
+ * @brief Append a code point from a \\u escape as UTF-8, or U+FFFD for half of a surrogate pair alone.
+ */
+bool JsonParser::appendCodePoint(uint32_t codePoint) {
+	char   utf8[4];
+	size_t length;
+	if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+		codePoint = 0xFFFD; // Half of a surrogate pair on its own cannot be encoded.
+	}
+	if (codePoint < 0x80) {
+		utf8[0] = codePoint;
+		length  = 1;
+	} else if (codePoint < 0x800) {
+		utf8[0] = 0xC0 | (codePoint >> 6);
+		utf8[1] = 0x80 | (codePoint & 0x3F);
+		length  = 2;
+	} else if (codePoint < 0x10000) {
+		utf8[0] = 0xE0 | (codePoint >> 12);
+		utf8[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+		utf8[2] = 0x80 | (codePoint & 0x3F);
+		length  = 3;
+	} else {
+		utf8[0] = 0xF0 | (codePoint >> 18);
+		utf8[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+		utf8[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+		utf8[3] = 0x80 | (codePoint & 0x3F);
+		length  = 4;
+	}
+	return append(utf8, length);
+} // appendCodePoint
+
+
+/**
+ * @brief Append a high surrogate that was not followed by its low half, as U+FFFD.
+ * @return False if the token is full.
+ */
+bool JsonParser::appendHighSurrogate() {
+	if (m_highSurrogate == 0) {
+		return true;
+	}
+	uint32_t codePoint = m_highSurrogate;
+	m_highSurrogate = 0;
+	return appendCodePoint(codePoint);
+} // appendHighSurrogate
+
+
+void JsonParser::endContainer(char c) {
+	m_depth--;
+	m_arrays &= ~(1UL << m_depth);
+	if (c == ']') {
+		m_pHandler->onEndArray();
+	} else {
+		m_pHandler->onEndObject();
+	}
+	valueDone();
+} // endContainer
+
+
+bool JsonParser::fail(const char* error) {
+	m_state = STATE_ERROR;
+	m_error = error;
+	ESP_LOGD(LOG_TAG, "%s at offset %d", error, (int)m_position);
+	return false;
+} // fail
+
+
+bool JsonParser::finishNumber() {
+	if (!isValidNumber(m_token, m_token + m_tokenLength)) {
+		return fail("invalid number");
+	}
+	m_token[m_tokenLength] = 0;
+	m_pHandler->onNumber(strtod(m_token, nullptr), m_token, m_tokenLength);
+	valueDone();
+	return true;
+} // finishNumber
+
+
+/**
+ * @brief Begin a value with its first character.
+ */
+bool JsonParser::startValue(char c) {
+	switch (c) {
+		case '{':
+		case '[':
+			if (m_depth == MAX_DEPTH) {
+				return fail("nested too deeply");
+			}
+			if (c == '[') {
+				m_arrays |= 1UL << m_depth;
+			}
+			m_depth++;
+			if (c == '[') {
+				m_state = STATE_VALUE_OR_END;
+				m_pHandler->onStartArray();
+			} else {
+				m_state = STATE_KEY_OR_END;
+				m_pHandler->onStartObject();
+			}
+			return true;
+		case '"':
+			m_isKey       = false;
+			m_tokenLength = 0;
+			m_state       = STATE_STRING;
+			return true;
+		case 't':
+			m_literal = "true";
+			break;
+		case 'f':
+			m_literal = "false";
+			break;
+		case 'n':
+			m_literal = "null";
+			break;
+		default:
+			if (c == '-' || (c >= '0' && c <= '9')) {
+				m_token[0]    = c;
+				m_tokenLength = 1;
+				m_state       = STATE_NUMBER;
+				return true;
+			}
+			return fail("expected a value");
+	}
+	m_literalPos = 1;
+	m_state      = STATE_LITERAL;
+	return true;
+} // startValue
+
+
+/**
+ * @brief Move on after a complete value.
+ */
+void JsonParser::valueDone() {
+	if (m_state == STATE_STOPPED) {
+		return; // The handler stopped the parse.
+	}
+	m_state = (m_depth == 0) ? STATE_DONE : STATE_COMMA_OR_END;
+} // valueDone
+
+
+/**
+ * @brief Create an extractor.
+ * @param [in] maxTokenLength The longest string or number that can be parsed.
+ */
+JsonPathExtractor::JsonPathExtractor(size_t maxTokenLength): m_parser(this, maxTokenLength) {
+	m_found = 0;
+} // JsonPathExtractor
+
+
+/**
+ * @brief Add a path whose value is wanted.
+ * @param [in] path The path, such as "wifi.ssid" or "sensors[2].value".
+ * @return The handle of the path, to pass to the get methods.
+ */
+int JsonPathExtractor::addPath(std::string path) {
+	m_wanted.push_back({ path, "", false });
+	return m_wanted.size() - 1;
+} // addPath
+
+
+/**
+ * @brief Get a boolean value.
+ * @param [in] path The handle returned by addPath().
+ * @return True if the value was found and is true.
+ */
+bool JsonPathExtractor::getBoolean(int path) {
+	return isFound(path) && m_wanted[path].value == "true";
+} // getBoolean
+
+
+/**
+ * @brief Get a numeric value.
+ * @param [in] path The handle returned by addPath().
+ * @return The value, or 0 if it was not found.
+ */
+double JsonPathExtractor::getDouble(int path) {
+	return isFound(path) ? strtod(m_wanted[path].value.c_str(), nullptr) : 0;
+} // getDouble
+
+
+/**
+ * @brief Get an integer value.
+ * @param [in] path The handle returned by addPath().
+ * @return The value, or 0 if it was not found.
+ */
+int JsonPathExtractor::getInt(int path) {
+	return (int)getDouble(path);
+} // getInt
+
+
+/**
+ * @brief Get the parser to feed the JSON text to.
+ * @return The parser.
+ */
+JsonParser* JsonPathExtractor::getParser() {
+	return &m_parser;
+} // getParser
+
+
+/**
+ * @brief Get a value as a string.
+ *
+ * Strings are returned unescaped; other values are returned as their JSON text.
+ *
+ * @param [in] path The handle returned by addPath().
+ * @return The value, or an empty string if it was not found.
+ */
+std::string JsonPathExtractor::getString(int path) {
+	return isFound(path) ? m_wanted[path].value : "";
+} // getString
+
+
+/**
+ * @brief Determine whether a value was found.
+ * @param [in] path The handle returned by addPath().
+ * @return True if the path was found with a string, number, boolean or null value.
+ */
+bool JsonPathExtractor::isFound(int path) {
+	return path >= 0 && path < (int)m_wanted.size() && m_wanted[path].found;
+} // isFound
+
+
+/**
+ * @brief Forget the values found, ready to parse another document with the same paths.
+ */
+void JsonPathExtractor::reset() {
+	for (auto it = m_wanted.begin(); it != m_wanted.end(); ++it) {
+		it->value.clear();
+		it->found = false;
+	}
+	m_found = 0;
+	m_path.clear();
+	m_levels.clear();
+	m_parser.reset();
+} // reset
+
+
+void JsonPathExtractor::onStartObject() {
+	beginValue();
+	m_levels.push_back({ false, 0, m_path.length() });
+} // onStartObject
+
+
+void JsonPathExtractor::onEndObject() {
+	endLevel();
+} // onEndObject
+
+
+void JsonPathExtractor::onStartArray() {
+	beginValue();
+	m_levels.push_back({ true, 0, m_path.length() });
+} // onStartArray
+
+
+void JsonPathExtractor::onEndArray() {
+	endLevel();
+} // onEndArray
+
+
+void JsonPathExtractor::onKey(const char* key, size_t length) {
+	Level& level = m_levels.back();
+	m_path.resize(level.pathLength);
+	if (level.pathLength > 0) {
+		m_path += '.';
+	}
+	m_path.append(key, length);
+} // onKey
+
+
+void JsonPathExtractor::onString(const char* value, size_t length) {
+	scalar(value, length);
+} // onString
+
+
+void JsonPathExtractor::onNumber(double value, const char* text, size_t length) {
+	scalar(text, length);
+} // onNumber
+
+
+void JsonPathExtractor::onBoolean(bool value) {
+	scalar(value ? "true" : "false", value ? 4 : 5);
+} // onBoolean
+
+
+void JsonPathExtractor::onNull() {
+	scalar("null", 4);
+} // onNull
+
+
+/**
+ * @brief Extend the path for the next element of an array.  Object members are named by onKey().
+ */
+void JsonPathExtractor::beginValue() {
+	if (m_levels.empty() || !m_levels.back().isArray) {
+		return;
+	}
+	Level& level = m_levels.back();
+	char index[16];
+	snprintf(index, sizeof(index), "[%d]", level.index++);
+	m_path.resize(level.pathLength);
+	m_path += index;
+} // beginValue
+
+
+void JsonPathExtractor::endLevel() {
+	m_path.resize(m_levels.back().pathLength);
+	m_levels.pop_back();
+} // endLevel
+
+
+void JsonPathExtractor::scalar(const char* text, size_t length) {
+	beginValue();
+	for (auto it = m_wanted.begin(); it != m_wanted.end(); ++it) {
+		if (!it->found && it->path == m_path) {
+			it->value.assign(text, length);
+			it->found = true;
+			if (++m_found == m_wanted.size()) {
+				m_parser.stop(); // Everything wanted has been seen.
+			}
+		}
+	}
+} // scalar
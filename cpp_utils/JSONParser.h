@@ -0,0 +1,174 @@
+/*
+ * JSONParser.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_JSONPARSER_H_
+#define COMPONENTS_CPP_UTILS_JSONPARSER_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Receives the events of a JsonParser.
+ *
+ * Override the events of interest; the others do nothing.  Key and string values are passed
+ * unescaped and are only valid for the duration of the call.
+ */
+class JsonParserHandler {
+public:
+	virtual ~JsonParserHandler() {};
+	virtual void onStartObject() {};
+	virtual void onEndObject() {};
+	virtual void onStartArray() {};
+	virtual void onEndArray() {};
+	virtual void onKey(const char* key, size_t length) {};
+	virtual void onString(const char* value, size_t length) {};
+	virtual void onNumber(double value, const char* text, size_t length) {};
+	virtual void onBoolean(bool value) {};
+	virtual void onNull() {};
+}; // JsonParserHandler
+
+
+/**
+ * @brief An incremental (SAX style) JSON parser.
+ *
+ * Unlike JSON::parseObject(), no tree is built: the text is passed in chunks of any size as it
+ * arrives and the handler is called for each value as it is completed.  The only memory used
+ * is a buffer for the longest string or number, allocated once by the constructor, so a
+ * document of any size can be parsed straight from a socket, a RESTClient response or a file.
+ *
+ * @code{.cpp}
+ * JsonParser parser(&myHandler);
+ * while ((length = socket.receive(buffer, sizeof(buffer))) > 0) {
+ * 	if (!parser.feed((char*)buffer, length)) break;
+ * }
+ * if (!parser.end()) ESP_LOGE(tag, "%s", parser.getError().c_str());
+ * @endcode
+ */
+class JsonParser {
+public:
+	static const int MAX_DEPTH = 32;
+
+	JsonParser(JsonParserHandler* pHandler, size_t maxTokenLength = 256);
+	JsonParser(JsonParserHandler* pHandler, char* tokenBuffer, size_t maxTokenLength);
+	virtual ~JsonParser();
+	bool        end();
+	bool        feed(const char* data, size_t length);
+	std::string getError();
+	size_t      getPosition();
+	bool        parse(const std::string& text);
+	bool        parseFile(std::string path);
+	void        reset();
+	void        stop();
+
+private:
+	typedef enum {
+		STATE_VALUE,         // A value must follow.
+		STATE_VALUE_OR_END,  // After '[': a value or ']'.
+		STATE_KEY_OR_END,    // After '{': a key or '}'.
+		STATE_KEY,           // After ',' in an object.
+		STATE_COLON,
+		STATE_COMMA_OR_END,  // After a value in an array or object.
+		STATE_STRING,
+		STATE_ESCAPE,
+		STATE_UNICODE,
+		STATE_NUMBER,
+		STATE_LITERAL,       // Within true, false or null.
+		STATE_DONE,          // The top level value is complete.
+		STATE_STOPPED,
+		STATE_ERROR
+	} state_t;
+
+	bool append(const char* data, size_t length);
+	bool appendCodePoint(uint32_t codePoint);
+	bool appendHighSurrogate();
+	void endContainer(char c);
+	bool fail(const char* error);
+	bool finishNumber();
+	bool startValue(char c);
+	void valueDone();
+
+	JsonParserHandler* m_pHandler;
+	state_t     m_state;
+	char*       m_token;
+	size_t      m_tokenLength;
+	size_t      m_maxTokenLength;
+	bool        m_ownsToken;
+	bool        m_isKey;
+	const char* m_literal;
+	uint8_t     m_literalPos;
+	uint8_t     m_unicodeDigits;
+	uint32_t    m_unicode;
+	uint32_t    m_highSurrogate;
+	uint32_t    m_arrays;      // Bit n set if the container at depth n is an array.
+	int         m_depth;
+	size_t      m_position;
+	const char* m_error;
+}; // JsonParser
+
+
+/**
+ * @brief Pull a few values out of a JSON document without building a tree.
+ *
+ * Paths name members with '.' and array elements with "[n]", for example
+ * "wifi.ssid" or "sensors[2].value".  Parsing stops as soon as every path has been found.
+ *
+ * @code{.cpp}
+ * JsonPathExtractor extractor;
+ * int ssid  = extractor.addPath("wifi.ssid");
+ * int first = extractor.addPath("sensors[0].value");
+ * extractor.getParser()->parse(text);
+ * if (extractor.isFound(ssid)) connect(extractor.getString(ssid));
+ * @endcode
+ */
+class JsonPathExtractor: public JsonParserHandler {
+public:
+	JsonPathExtractor(size_t maxTokenLength = 256);
+	int         addPath(std::string path);
+	bool        getBoolean(int path);
+	double      getDouble(int path);
+	int         getInt(int path);
+	JsonParser* getParser();
+	std::string getString(int path);
+	bool        isFound(int path);
+	void        reset();
+
+	void onStartObject() override;
+	void onEndObject() override;
+	void onStartArray() override;
+	void onEndArray() override;
+	void onKey(const char* key, size_t length) override;
+	void onString(const char* value, size_t length) override;
+	void onNumber(double value, const char* text, size_t length) override;
+	void onBoolean(bool value) override;
+	void onNull() override;
+
+private:
+	struct Level {
+		bool   isArray;
+		int    index;    // Next element of an array.
+		size_t pathLength;
+	};
+
+	struct Wanted {
+		std::string path;
+		std::string value;
+		bool        found;
+	};
+
+	void beginValue();
+	void endLevel();
+	void scalar(const char* text, size_t length);
+
+	JsonParser          m_parser;
+	std::string         m_path;   // The path of the current value.
+	std::vector<Level>  m_levels;
+	std::vector<Wanted> m_wanted;
+	size_t              m_found;
+}; // JsonPathExtractor
+
+#endif /* COMPONENTS_CPP_UTILS_JSONPARSER_H_ */
@@ -0,0 +1,414 @@
+/*
+ * JSONStruct.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JSONStruct.h"
+#include "JSONWriter.h"
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+static int64_t getSigned(const uint8_t* p, size_t size) {
+	switch (size) {
+		case 1:  return *(const int8_t*)p;
+		case 2:  return *(const int16_t*)p;
+		case 4:  return *(const int32_t*)p;
+		default: return *(const int64_t*)p;
+	}
+} // getSigned
+
+
+static uint64_t getUnsigned(const uint8_t* p, size_t size) {
+	switch (size) {
+		case 1:  return *(const uint8_t*)p;
+		case 2:  return *(const uint16_t*)p;
+		case 4:  return *(const uint32_t*)p;
+		default: return *(const uint64_t*)p;
+	}
+} // getUnsigned
+
+
+/**
+ * @brief Store an integer in a member of 1, 2, 4 or 8 bytes, signed or unsigned.
+ */
+static void setInteger(uint8_t* p, size_t size, uint64_t value) {
+	switch (size) {
+		case 1:  *(uint8_t*)p  = value; break;
+		case 2:  *(uint16_t*)p = value; break;
+		case 4:  *(uint32_t*)p = value; break;
+		default: *(uint64_t*)p = value; break;
+	}
+} // setInteger
+
+
+/**
+ * @brief Convert a number to the type of an integer member.
+ * @param [in] pField The member, KIND_INT or KIND_UINT.
+ * @param [in] value The number.
+ * @param [in] text The text of the number.
+ * @param [in] length The length of the text.
+ * @param [out] pInteger The integer, to be stored with setInteger().
+ * @return False if the number has a fraction or is outside the range of the member, and is to be skipped.
+ */
+static bool toInteger(const JsonStructField* pField, double value, const char* text, size_t length, uint64_t* pInteger) {
+	bool isSigned = pField->kind == JsonStructField::KIND_INT;
+	if (pField->size == 8 && length < 32) {
+		// A 64 bit member is read from the text, which may hold more digits than a double.
+		char  digits[32];
+		char* pEnd;
+		::memcpy(digits, text, length);
+		digits[length] = 0;
+		errno = 0;
+		if (isSigned) {
+			long long integer = strtoll(digits, &pEnd, 10);
+			if (*pEnd == 0 && errno == 0) {
+				*pInteger = (uint64_t)integer;
+				return true;
+			}
+		} else if (digits[0] != '-') {
+			unsigned long long integer = strtoull(digits, &pEnd, 10);
+			if (*pEnd == 0 && errno == 0) {
+				*pInteger = integer;
+				return true;
+			}
+		}
+	}
+	// An exponent, or a member smaller than 8 bytes: take the double, if it is whole and fits.
+	double limit = ldexp(1.0, pField->size * 8 - (isSigned ? 1 : 0));
+	if (!(value >= (isSigned ? -limit : 0.0) && value < limit) || value != trunc(value)) {
+		return false;
+	}
+	*pInteger = isSigned ? (uint64_t)(int64_t)value : (uint64_t)value;
+	return true;
+} // toInteger
+
+
+/**
+ * @brief Write a float with no more digits than it takes to read back the same value.
+ */
+static void writeFloat(JsonWriter& writer, float value) {
+	if (!isfinite(value)) {
+		writer.valueNull();
+		return;
+	}
+	char text[24];
+	int  length = snprintf(text, sizeof(text), "%.7g", value);
+	if ((float)strtod(text, nullptr) != value) {
+		length = snprintf(text, sizeof(text), "%.9g", value);
+	}
+	writer.raw(text, length);
+} // writeFloat
+
+
+/**
+ * @brief Hash a key that is not NUL terminated.
+ * @param [in] key The key.
+ * @param [in] length The length of the key.
+ * @return The same value as the compile time hash() of the key.
+ */
+uint32_t JsonStruct::hash(const char* key, size_t length) {
+	uint32_t value = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		value = (value ^ (uint8_t)key[i]) * 16777619u;
+	}
+	return value;
+} // hash
+
+
+/**
+ * @brief Make the schema of a struct, for JSON_FIELDS().
+ * @param [in] fields The members of the struct, in the order they are written.
+ * @param [in] count The number of members.
+ * @param [out] byHash Space for count indexes, filled with the members in order of their hash.
+ * @return The schema.
+ */
+JsonStructSchema JsonStruct::makeSchema(const JsonStructField* fields, uint8_t count, uint8_t* byHash) {
+	for (int i = 0; i < count; i++) {
+		int j = i;
+		for (; j > 0 && fields[byHash[j - 1]].hash > fields[i].hash; j--) {
+			byHash[j] = byHash[j - 1];
+		}
+		byHash[j] = i;
+	}
+	JsonStructSchema schema = { fields, count, byHash };
+	return schema;
+} // makeSchema
+
+
+/**
+ * @brief Parse a JSON object into a struct.
+ * @param [in] text The JSON text.
+ * @param [in] schema The members of the struct.
+ * @param [out] pValue The struct.
+ * @return True if the text is a valid JSON object.
+ */
+bool JsonStruct::parse(const std::string& text, const JsonStructSchema& schema, void* pValue) {
+	JsonStructReader reader(schema, pValue);
+	return reader.getParser()->parse(text) && reader.isObject();
+} // parse
+
+
+/**
+ * @brief Convert a struct to a JSON object.
+ * @param [in] schema The members of the struct.
+ * @param [in] pValue The struct.
+ * @return The JSON text.
+ */
+std::string JsonStruct::toString(const JsonStructSchema& schema, const void* pValue) {
+	std::string    out;
+	JsonStringSink sink(&out);
+	JsonWriter     writer(&sink);
+	write(writer, schema, pValue);
+	writer.flush();
+	return out;
+} // toString
+
+
+/**
+ * @brief Write a struct as a JSON object through a JsonWriter.
+ * @param [in] writer The writer, positioned where a value is expected.
+ * @param [in] schema The members of the struct.
+ * @param [in] pValue The struct.
+ */
+void JsonStruct::write(JsonWriter& writer, const JsonStructSchema& schema, const void* pValue) {
+	writer.beginObject();
+	for (int i = 0; i < schema.count; i++) {
+		const JsonStructField& field = schema.fields[i];
+		const uint8_t* p = (const uint8_t*)pValue + field.offset;
+		writer.key(field.name);
+		switch (field.kind) {
+			case JsonStructField::KIND_BOOL:
+				writer.value(*(const bool*)p);
+				break;
+
+			case JsonStructField::KIND_INT: {
+				int64_t value = getSigned(p, field.size);
+				if (value >= INT32_MIN && value <= INT32_MAX) {
+					writer.value((int)value);
+				} else {
+					char text[24];
+					writer.raw(text, snprintf(text, sizeof(text), "%lld", (long long)value));
+				}
+				break;
+			}
+
+			case JsonStructField::KIND_UINT: {
+				uint64_t value = getUnsigned(p, field.size);
+				if (value <= UINT32_MAX) {
+					writer.value((uint32_t)value);
+				} else {
+					char text[24];
+					writer.raw(text, snprintf(text, sizeof(text), "%llu", (unsigned long long)value));
+				}
+				break;
+			}
+
+			case JsonStructField::KIND_FLOAT:
+				if (field.size == sizeof(float)) {
+					writeFloat(writer, *(const float*)p);
+				} else {
+					writer.value(*(const double*)p);
+				}
+				break;
+
+			case JsonStructField::KIND_STRING:
+				writer.value(*(const std::string*)p);
+				break;
+
+			case JsonStructField::KIND_CHARS:
+				writer.value(std::string((const char*)p, strnlen((const char*)p, field.size)));
+				break;
+
+			case JsonStructField::KIND_STRUCT:
+				write(writer, field.schema(), p);
+				break;
+		}
+	}
+	writer.endObject();
+} // write
+
+
+/**
+ * @brief Create a reader that parses into a struct.
+ * @param [in] schema The members of the struct.
+ * @param [out] pValue The struct.  Members not present in the text are left unchanged.
+ * @param [in] maxTokenLength The longest string the parser accepts.
+ */
+JsonStructReader::JsonStructReader(const JsonStructSchema& schema, void* pValue, size_t maxTokenLength): m_parser(this, maxTokenLength) {
+	m_schema = &schema;
+	m_pValue = pValue;
+	reset();
+} // JsonStructReader
+
+
+/**
+ * @brief Get the parser to feed the JSON text to.
+ * @return The parser.
+ */
+JsonParser* JsonStructReader::getParser() {
+	return &m_parser;
+} // getParser
+
+
+/**
+ * @brief Determine whether the document parsed was an object, and so was read into the struct.
+ */
+bool JsonStructReader::isObject() {
+	return m_isObject;
+} // isObject
+
+
+/**
+ * @brief Prepare to parse another document into the same struct.
+ */
+void JsonStructReader::reset() {
+	m_depth    = 0;
+	m_skip     = 0;
+	m_field    = nullptr;
+	m_isObject = false;
+	m_parser.reset();
+} // reset
+
+
+void JsonStructReader::onStartObject() {
+	const JsonStructField* pField = m_field;
+	m_field = nullptr;
+	if (m_skip > 0) {
+		m_skip++;
+	} else if (m_depth == 0 && !m_isObject) {
+		m_levels[0] = { m_schema, (uint8_t*)m_pValue };
+		m_depth = 1;
+		m_isObject = true;
+	} else if (m_depth > 0 && m_depth < JsonStruct::MAX_DEPTH && pField != nullptr && pField->kind == JsonStructField::KIND_STRUCT) {
+		m_levels[m_depth] = { &pField->schema(), m_levels[m_depth - 1].base + pField->offset };
+		m_depth++;
+	} else {
+		m_skip = 1;
+	}
+} // onStartObject
+
+
+void JsonStructReader::onEndObject() {
+	if (m_skip > 0) {
+		m_skip--;
+	} else {
+		m_depth--;
+	}
+} // onEndObject
+
+
+void JsonStructReader::onStartArray() {
+	m_field = nullptr;
+	m_skip++;
+} // onStartArray
+
+
+void JsonStructReader::onEndArray() {
+	m_skip--;
+} // onEndArray
+
+
+void JsonStructReader::onKey(const char* key, size_t length) {
+	m_field = nullptr;
+	if (m_skip > 0 || m_depth == 0) {
+		return;
+	}
+	const JsonStructSchema* pSchema = m_levels[m_depth - 1].schema;
+	uint32_t hash = JsonStruct::hash(key, length);
+	// Find the first member with the hash, then check the name of each that has it.
+	int low  = 0;
+	int high = pSchema->count;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (pSchema->fields[pSchema->byHash[middle]].hash < hash) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	for (; low < pSchema->count; low++) {
+		const JsonStructField& field = pSchema->fields[pSchema->byHash[low]];
+		if (field.hash != hash) {
+			return;
+		}
+		if (::strncmp(field.name, key, length) == 0 && field.name[length] == 0) {
+			m_field = &field;
+			return;
+		}
+	}
+} // onKey
+
+
+void JsonStructReader::onString(const char* value, size_t length) {
+	const JsonStructField* pField;
+	uint8_t* p = target(&pField);
+	if (p == nullptr) {
+		return;
+	}
+	if (pField->kind == JsonStructField::KIND_STRING) {
+		((std::string*)p)->assign(value, length);
+	} else if (pField->kind == JsonStructField::KIND_CHARS) {
+		if (length >= pField->size) {
+			length = pField->size - 1; // Truncated to fit.
+		}
+		::memcpy(p, value, length);
+		p[length] = 0;
+	}
+} // onString
+
+
+void JsonStructReader::onNumber(double value, const char* text, size_t length) {
+	const JsonStructField* pField;
+	uint8_t* p = target(&pField);
+	if (p == nullptr) {
+		return;
+	}
+	uint64_t integer;
+	switch (pField->kind) {
+		case JsonStructField::KIND_INT:
+		case JsonStructField::KIND_UINT:
+			if (toInteger(pField, value, text, length, &integer)) {
+				setInteger(p, pField->size, integer);
+			}
+			break;
+		case JsonStructField::KIND_FLOAT:
+			if (pField->size == sizeof(float)) {
+				*(float*)p = value;
+			} else {
+				*(double*)p = value;
+			}
+			break;
+	}
+} // onNumber
+
+
+void JsonStructReader::onBoolean(bool value) {
+	const JsonStructField* pField;
+	uint8_t* p = target(&pField);
+	if (p != nullptr && pField->kind == JsonStructField::KIND_BOOL) {
+		*(bool*)p = value;
+	}
+} // onBoolean
+
+
+/**
+ * @brief Get the member that a scalar value is to be stored in.
+ * @param [out] ppField The member.
+ * @return The address of the member, or nullptr if the value is to be skipped.
+ */
+uint8_t* JsonStructReader::target(const JsonStructField** ppField) {
+	*ppField = m_field;
+	m_field = nullptr;
+	if (*ppField == nullptr || m_skip > 0 || m_depth == 0) {
+		return nullptr;
+	}
+	return m_levels[m_depth - 1].base + (*ppField)->offset;
+} // target
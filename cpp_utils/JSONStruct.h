@@ -0,0 +1,246 @@
+/*
+ * JSONStruct.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_JSONSTRUCT_H_
+#define COMPONENTS_CPP_UTILS_JSONSTRUCT_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include "JSONParser.h"
+
+// Forward declarations
+class JsonWriter;
+struct JsonStructSchema;
+
+/**
+ * @brief A member of a struct declared with JSON_FIELDS().
+ */
+struct JsonStructField {
+	typedef enum {
+		KIND_BOOL, KIND_INT, KIND_UINT, KIND_FLOAT, KIND_STRING, KIND_CHARS, KIND_STRUCT
+	} kind_t;
+
+	const char* name;
+	uint32_t    hash;      // JsonStruct::hash() of the name.
+	uint16_t    offset;
+	uint16_t    size;
+	uint8_t     kind;
+	const JsonStructSchema& (*schema)(); // The schema of a KIND_STRUCT member, else nullptr.
+};
+
+
+/**
+ * @brief The members of a struct declared with JSON_FIELDS().
+ */
+struct JsonStructSchema {
+	const JsonStructField* fields;
+	uint8_t                count;
+	const uint8_t*         byHash;  // The indexes of the fields in order of their hash.
+};
+
+
+/**
+ * @brief Read and write structs as JSON objects without a JSON tree.
+ *
+ * Getting the values of a fixed-shape message from a JsonObject costs a string keyed lookup
+ * and a std::string temporary per member.  Instead, declare the members of a struct once with
+ * JSON_FIELDS().  JsonStruct then parses JSON straight into the struct, matching keys by their
+ * hash, and writes the struct through a JsonWriter.
+ *
+ * @code{.cpp}
+ * struct Mqtt {
+ *    char     host[32];
+ *    uint16_t port;
+ *    int      keepalive;
+ *    JSON_FIELDS(Mqtt, host, port, keepalive)
+ * };
+ *
+ * Mqtt mqtt = {};
+ * JsonStruct::parse(text, &mqtt);
+ * std::string json = JsonStruct::toString(mqtt);
+ * @endcode
+ *
+ * Members may be bool, integers, float, double, std::string, char arrays and structs that are
+ * themselves declared with JSON_FIELDS().  Keys that are not members and values of the wrong
+ * type are skipped, leaving the member as it was, as are numbers with a fraction or outside the
+ * range of an integer member.  Arrays are not supported.
+ *
+ * The members are found with offsetof(), so the struct must be standard layout: no virtual
+ * functions, no base class with members and all the members under the same access.
+ */
+class JsonStruct {
+public:
+	static const int MAX_DEPTH = 8;
+
+	/**
+	 * @brief The FNV-1a hash of a key, evaluated at compile time for a literal.
+	 */
+	static constexpr uint32_t hash(const char* key, uint32_t value = 2166136261u) {
+		return *key == 0 ? value : hash(key + 1, (value ^ (uint8_t)*key) * 16777619u);
+	}
+	static uint32_t    hash(const char* key, size_t length);
+	static JsonStructSchema makeSchema(const JsonStructField* fields, uint8_t count, uint8_t* byHash);
+	static bool        parse(const std::string& text, const JsonStructSchema& schema, void* pValue);
+	static std::string toString(const JsonStructSchema& schema, const void* pValue);
+	static void        write(JsonWriter& writer, const JsonStructSchema& schema, const void* pValue);
+
+	/**
+	 * @brief Parse a JSON object into a struct.
+	 * @param [in] text The JSON text.
+	 * @param [out] pValue The struct.  Members not present in the text are left unchanged.
+	 * @return True if the text is a valid JSON object.
+	 */
+	template<typename T> static bool parse(const std::string& text, T* pValue) {
+		return parse(text, T::jsonSchema(), pValue);
+	}
+
+	/**
+	 * @brief Convert a struct to a JSON object.
+	 */
+	template<typename T> static std::string toString(const T& value) {
+		return toString(T::jsonSchema(), &value);
+	}
+
+	/**
+	 * @brief Write a struct as a JSON object through a JsonWriter.
+	 */
+	template<typename T> static void write(JsonWriter& writer, const T& value) {
+		write(writer, T::jsonSchema(), &value);
+	}
+}; // JsonStruct
+
+
+/**
+ * @brief Parse a JSON object into a struct as it arrives.
+ *
+ * Feed the parser returned by getParser(), for example with RESTClient::setResponseParser().
+ */
+class JsonStructReader: public JsonParserHandler {
+public:
+	JsonStructReader(const JsonStructSchema& schema, void* pValue, size_t maxTokenLength = 256);
+	/**
+	 * @brief Create a reader that parses into the given struct.
+	 */
+	template<typename T> JsonStructReader(T* pValue): JsonStructReader(T::jsonSchema(), pValue) {}
+	JsonParser* getParser();
+	bool        isObject();
+	void        reset();
+
+	void onStartObject() override;
+	void onEndObject() override;
+	void onStartArray() override;
+	void onEndArray() override;
+	void onKey(const char* key, size_t length) override;
+	void onString(const char* value, size_t length) override;
+	void onNumber(double value, const char* text, size_t length) override;
+	void onBoolean(bool value) override;
+
+private:
+	struct Level {
+		const JsonStructSchema* schema;
+		uint8_t*                base;
+	};
+
+	uint8_t* target(const JsonStructField** ppField);
+
+	JsonParser             m_parser;
+	const JsonStructSchema* m_schema;
+	void*                  m_pValue;
+	Level                  m_levels[JsonStruct::MAX_DEPTH];
+	int                    m_depth;
+	int                    m_skip;     // Depth within a container that is being skipped.
+	const JsonStructField* m_field;    // The member named by the last key, nullptr if none.
+	bool                   m_isObject;
+}; // JsonStructReader
+
+
+/**
+ * @brief How a member type is read and written.  Only the types below are supported.
+ */
+template<typename T, typename Enable = void> struct JsonStructTraits;
+
+template<> struct JsonStructTraits<bool> {
+	static constexpr uint8_t kind() { return JsonStructField::KIND_BOOL; }
+	static constexpr const JsonStructSchema& (*schema())() { return nullptr; }
+};
+
+template<typename T> struct JsonStructTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+	static constexpr uint8_t kind() { return std::is_signed<T>::value ? JsonStructField::KIND_INT : JsonStructField::KIND_UINT; }
+	static constexpr const JsonStructSchema& (*schema())() { return nullptr; }
+};
+
+template<typename T> struct JsonStructTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+	static constexpr uint8_t kind() { return JsonStructField::KIND_FLOAT; }
+	static constexpr const JsonStructSchema& (*schema())() { return nullptr; }
+};
+
+template<> struct JsonStructTraits<std::string> {
+	static constexpr uint8_t kind() { return JsonStructField::KIND_STRING; }
+	static constexpr const JsonStructSchema& (*schema())() { return nullptr; }
+};
+
+template<size_t N> struct JsonStructTraits<char[N]> {
+	static constexpr uint8_t kind() { return JsonStructField::KIND_CHARS; }
+	static constexpr const JsonStructSchema& (*schema())() { return nullptr; }
+};
+
+template<typename T> struct JsonStructTraits<T, typename std::enable_if<std::is_class<T>::value && !std::is_same<T, std::string>::value>::type> {
+	static constexpr uint8_t kind() { return JsonStructField::KIND_STRUCT; }
+	static constexpr const JsonStructSchema& (*schema())() { return &T::jsonSchema; }
+};
+
+
+#define JSON_STRUCT_FIELD(Type, name) { \
+	#name, JsonStruct::hash(#name), offsetof(Type, name), sizeof(((Type*)nullptr)->name), \
+	JsonStructTraits<decltype(Type::name)>::kind(), JsonStructTraits<decltype(Type::name)>::schema() },
+
+// Apply JSON_STRUCT_FIELD to each of up to 24 member names.
+#define JSON_FIELDS_1(T, a)       JSON_STRUCT_FIELD(T, a)
+#define JSON_FIELDS_2(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_1(T, __VA_ARGS__)
+#define JSON_FIELDS_3(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_2(T, __VA_ARGS__)
+#define JSON_FIELDS_4(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_3(T, __VA_ARGS__)
+#define JSON_FIELDS_5(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_4(T, __VA_ARGS__)
+#define JSON_FIELDS_6(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_5(T, __VA_ARGS__)
+#define JSON_FIELDS_7(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_6(T, __VA_ARGS__)
+#define JSON_FIELDS_8(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_7(T, __VA_ARGS__)
+#define JSON_FIELDS_9(T, a, ...)  JSON_STRUCT_FIELD(T, a) JSON_FIELDS_8(T, __VA_ARGS__)
+#define JSON_FIELDS_10(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_9(T, __VA_ARGS__)
+#define JSON_FIELDS_11(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_10(T, __VA_ARGS__)
+#define JSON_FIELDS_12(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_11(T, __VA_ARGS__)
+#define JSON_FIELDS_13(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_12(T, __VA_ARGS__)
+#define JSON_FIELDS_14(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_13(T, __VA_ARGS__)
+#define JSON_FIELDS_15(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_14(T, __VA_ARGS__)
+#define JSON_FIELDS_16(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_15(T, __VA_ARGS__)
+#define JSON_FIELDS_17(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_16(T, __VA_ARGS__)
+#define JSON_FIELDS_18(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_17(T, __VA_ARGS__)
+#define JSON_FIELDS_19(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_18(T, __VA_ARGS__)
+#define JSON_FIELDS_20(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_19(T, __VA_ARGS__)
+#define JSON_FIELDS_21(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_20(T, __VA_ARGS__)
+#define JSON_FIELDS_22(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_21(T, __VA_ARGS__)
+#define JSON_FIELDS_23(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_22(T, __VA_ARGS__)
+#define JSON_FIELDS_24(T, a, ...) JSON_STRUCT_FIELD(T, a) JSON_FIELDS_23(T, __VA_ARGS__)
+#define JSON_FIELDS_COUNT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+	_17, _18, _19, _20, _21, _22, _23, _24, N, ...) JSON_FIELDS_##N
+#define JSON_FIELDS_EACH(T, ...) JSON_FIELDS_COUNT(__VA_ARGS__, 24, 23, 22, 21, 20, 19, 18, 17, 16, \
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)(T, __VA_ARGS__)
+
+/**
+ * @brief Declare, within a struct, which of its members are read and written as JSON.
+ * @param Type The name of the struct.
+ * @param ... The names of the members, in the order they are written.
+ */
+#define JSON_FIELDS(Type, ...) \
+	static const JsonStructSchema& jsonSchema() { \
+		static_assert(std::is_standard_layout<Type>::value, #Type " must be standard layout for JSON_FIELDS"); \
+		static const JsonStructField fields[] = { JSON_FIELDS_EACH(Type, __VA_ARGS__) }; \
+		static uint8_t byHash[sizeof(fields) / sizeof(fields[0])]; \
+		static const JsonStructSchema schema = JsonStruct::makeSchema(fields, sizeof(fields) / sizeof(fields[0]), byHash); \
+		return schema; \
+	}
+
+#endif /* COMPONENTS_CPP_UTILS_JSONSTRUCT_H_ */
@@ -0,0 +1,449 @@
+/*
+ * JSONWriter.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JSONWriter.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include "SockServ.h"
+#include "Socket.h"
+#include "sdkconfig.h"
+static const char* LOG_TAG = "JSONWriter";
+#else
+#define ESP_LOGE(tag, ...)
+#endif
+
+
+/**
+ * @brief Create a writer.
+ * @param [in] pSink Where the JSON text is sent.
+ * @param [in] bufferSize The size of the buffer that collects text for the sink.
+ */
+JsonWriter::JsonWriter(JsonSink* pSink, size_t bufferSize) {
+	m_pSink      = pSink;
+	m_bufferSize = bufferSize > 0 ? bufferSize : 1;
+	m_buffer     = new uint8_t[m_bufferSize];
+	m_length     = 0;
+	m_arrays     = 0;
+	m_started    = 0;
+	m_depth      = 0;
+	m_afterKey   = false;
+	m_ok         = true;
+} // JsonWriter
+
+
+/**
+ * @brief Destroy the writer, first writing any buffered text to the sink.
+ */
+JsonWriter::~JsonWriter() {
+	flush();
+	delete[] m_buffer;
+} // ~JsonWriter
+
+
+/**
+ * @brief Begin an array.
+ */
+JsonWriter& JsonWriter::beginArray() {
+	begin(true);
+	return *this;
+} // beginArray
+
+
+/**
+ * @brief Begin an object.
+ */
+JsonWriter& JsonWriter::beginObject() {
+	begin(false);
+	return *this;
+} // beginObject
+
+
+/**
+ * @brief End the current array.
+ */
+JsonWriter& JsonWriter::endArray() {
+	end(true);
+	return *this;
+} // endArray
+
+
+/**
+ * @brief End the current object.
+ */
+JsonWriter& JsonWriter::endObject() {
+	end(false);
+	return *this;
+} // endObject
+
+
+/**
+ * @brief Complete the document: flush the buffer and tell the sink there is no more.
+ * @return True if the whole document was written.
+ */
+bool JsonWriter::finish() {
+	if (m_depth != 0) {
+		ESP_LOGE(LOG_TAG, "finish: %d containers still open", m_depth);
+		m_ok = false;
+	}
+	flush();
+	m_pSink->finish();
+	return m_ok;
+} // finish
+
+
+/**
+ * @brief Write the buffered text to the sink.
+ * @return True if everything written so far has reached the sink.
+ */
+bool JsonWriter::flush() {
+	if (m_length > 0 && m_ok && !m_pSink->write(m_buffer, m_length)) {
+		m_ok = false;
+	}
+	m_length = 0;
+	return m_ok;
+} // flush
+
+
+/**
+ * @brief Determine whether the document is well formed and the sink has accepted it so far.
+ * @return False after a sink error or a misplaced key or value.
+ */
+bool JsonWriter::isOk() {
+	return m_ok;
+} // isOk
+
+
+/**
+ * @brief Write the name of the next member of the current object.
+ * @param [in] name The name of the member.
+ */
+JsonWriter& JsonWriter::key(const char* name) {
+	if (m_depth == 0 || ((m_arrays >> (m_depth - 1)) & 1) || m_afterKey) {
+		ESP_LOGE(LOG_TAG, "key: %s: not expecting a key", name);
+		m_ok = false;
+		return *this;
+	}
+	if ((m_started >> (m_depth - 1)) & 1) {
+		put(',');
+	}
+	m_started |= 1UL << (m_depth - 1);
+	putString(name, strlen(name));
+	put(':');
+	m_afterKey = true;
+	return *this;
+} // key
+
+
+/**
+ * @brief Write the name of the next member of the current object.
+ * @param [in] name The name of the member.
+ */
+JsonWriter& JsonWriter::key(const std::string& name) {
+	return key(name.c_str());
+} // key
+
+
+/**
+ * @brief Write a value that is already JSON text, such as a document read from a file.
+ * @param [in] json The JSON text.
+ * @param [in] length The length of the text.
+ */
+JsonWriter& JsonWriter::raw(const char* json, size_t length) {
+	if (separate()) {
+		put(json, length);
+	}
+	return *this;
+} // raw
+
+
+/**
+ * @brief Write a boolean value.
+ */
+JsonWriter& JsonWriter::value(bool value) {
+	if (separate()) {
+		put(value ? "true" : "false", value ? 4 : 5);
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write an integer value.
+ */
+JsonWriter& JsonWriter::value(int value) {
+	if (separate()) {
+		char text[12];
+		put(text, snprintf(text, sizeof(text), "%d", value));
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write an unsigned integer value.
+ */
+JsonWriter& JsonWriter::value(uint32_t value) {
+	if (separate()) {
+		char text[12];
+		put(text, snprintf(text, sizeof(text), "%u", (unsigned)value));
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a 64 bit integer value.
+ */
+JsonWriter& JsonWriter::value(int64_t value) {
+	if (separate()) {
+		char text[24];
+		put(text, snprintf(text, sizeof(text), "%lld", (long long)value));
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a 64 bit unsigned integer value.
+ */
+JsonWriter& JsonWriter::value(uint64_t value) {
+	if (separate()) {
+		char text[24];
+		put(text, snprintf(text, sizeof(text), "%llu", (unsigned long long)value));
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a number.  Infinities and NaN, which JSON cannot represent, are written as null.
+ */
+JsonWriter& JsonWriter::value(double value) {
+	if (!separate()) {
+		return *this;
+	}
+	char text[32];
+	int  length;
+	if (!isfinite(value)) {
+		put("null", 4);
+		return *this;
+	}
+	if (fabs(value) < 2147483647.0 && value == (int)value) {
+		length = snprintf(text, sizeof(text), "%d", (int)value);
+	} else {
+		// The shortest form that reads back as the same double.
+		length = snprintf(text, sizeof(text), "%.15g", value);
+		if (strtod(text, nullptr) != value) {
+			length = snprintf(text, sizeof(text), "%.17g", value);
+		}
+	}
+	put(text, length);
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a string value.
+ */
+JsonWriter& JsonWriter::value(const char* value) {
+	if (separate()) {
+		putString(value, strlen(value));
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a string value.
+ */
+JsonWriter& JsonWriter::value(const std::string& value) {
+	if (separate()) {
+		putString(value.data(), value.length());
+	}
+	return *this;
+} // value
+
+
+/**
+ * @brief Write a null value.
+ */
+JsonWriter& JsonWriter::valueNull() {
+	if (separate()) {
+		put("null", 4);
+	}
+	return *this;
+} // valueNull
+
+
+bool JsonWriter::begin(bool isArray) {
+	if (m_depth == MAX_DEPTH) {
+		ESP_LOGE(LOG_TAG, "begin: nested too deeply");
+		m_ok = false;
+		return false;
+	}
+	if (!separate()) {
+		return false;
+	}
+	put(isArray ? '[' : '{');
+	if (isArray) {
+		m_arrays |= 1UL << m_depth;
+	} else {
+		m_arrays &= ~(1UL << m_depth);
+	}
+	m_started &= ~(1UL << m_depth);
+	m_depth++;
+	return true;
+} // begin
+
+
+bool JsonWriter::end(bool isArray) {
+	if (m_depth == 0 || ((m_arrays >> (m_depth - 1)) & 1) != isArray || m_afterKey) {
+		ESP_LOGE(LOG_TAG, "end: no %s to end", isArray ? "array" : "object");
+		m_ok = false;
+		return false;
+	}
+	m_depth--;
+	put(isArray ? ']' : '}');
+	return true;
+} // end
+
+
+/**
+ * @brief Write the comma before a value if one is needed, and check a value is allowed here.
+ */
+bool JsonWriter::separate() {
+	if (m_afterKey) {
+		m_afterKey = false;
+		return true;
+	}
+	if (m_depth == 0) {
+		return true;
+	}
+	if (!((m_arrays >> (m_depth - 1)) & 1)) {
+		ESP_LOGE(LOG_TAG, "value: a member of an object needs a key");
+		m_ok = false;
+		return false;
+	}
+	if ((m_started >> (m_depth - 1)) & 1) {
+		put(',');
+	}
+	m_started |= 1UL << (m_depth - 1);
+	return true;
+} // separate
+
+
+void JsonWriter::put(char c) {
+	if (m_length == m_bufferSize) {
+		flush();
+	}
+	m_buffer[m_length++] = c;
+} // put
+
+
+void JsonWriter::put(const char* data, size_t length) {
+	while (length > 0) {
+		if (m_length == m_bufferSize) {
+			flush();
+		}
+		size_t count = m_bufferSize - m_length;
+		if (count > length) {
+			count = length;
+		}
+		::memcpy(m_buffer + m_length, data, count);
+		m_length += count;
+		data     += count;
+		length   -= count;
+	}
+} // put
+
+
+void JsonWriter::putString(const char* value, size_t length) {
+	put('"');
+	const char* run = value; // Characters that need no escape are copied a run at a time.
+	for (const char* p = value; p < value + length; p++) {
+		uint8_t c = *p;
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+		put(run, p - run);
+		run = p + 1;
+		switch (c) {
+			case '"':  put("\\\"", 2); break;
+			case '\\': put("\\\\", 2); break;
+			case '\b': put("\\b", 2);  break;
+			case '\f': put("\\f", 2);  break;
+			case '\n': put("\\n", 2);  break;
+			case '\r': put("\\r", 2);  break;
+			case '\t': put("\\t", 2);  break;
+			default: {
+				char escape[8];
+				put(escape, snprintf(escape, sizeof(escape), "\\u%04x", c));
+				break;
+			}
+		}
+	}
+	put(run, value + length - run);
+	put('"');
+} // putString
+
+
+JsonStringSink::JsonStringSink(std::string* pString) {
+	m_pString = pString;
+} // JsonStringSink
+
+
+bool JsonStringSink::write(const uint8_t* data, size_t length) {
+	m_pString->append((const char*)data, length);
+	return true;
+} // write
+
+
+JsonFileSink::JsonFileSink(FILE* file) {
+	m_file = file;
+} // JsonFileSink
+
+
+bool JsonFileSink::write(const uint8_t* data, size_t length) {
+	return fwrite(data, 1, length, m_file) == length;
+} // write
+
+
+#ifdef ESP_PLATFORM
+JsonSocketSink::JsonSocketSink(Socket* pSocket) {
+	m_pSocket = pSocket;
+} // JsonSocketSink
+
+
+bool JsonSocketSink::write(const uint8_t* data, size_t length) {
+	while (length > 0) {
+		int rc = m_pSocket->send_cpp(data, length);
+		if (rc <= 0) {
+			return false;
+		}
+		data   += rc;
+		length -= rc;
+	}
+	return true;
+} // write
+
+
+JsonSockServSink::JsonSockServSink(SockServ* pSockServ) {
+	m_pSockServ = pSockServ;
+} // JsonSockServSink
+
+
+bool JsonSockServSink::write(const uint8_t* data, size_t length) {
+	if (m_pSockServ->connectedCount() == 0) {
+		return false;
+	}
+	m_pSockServ->sendData((uint8_t*)data, length);
+	return true;
+} // write
+#endif // ESP_PLATFORM
@@ -0,0 +1,160 @@
+/*
+ * JSONWriter.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_JSONWRITER_H_
+#define COMPONENTS_CPP_UTILS_JSONWRITER_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <type_traits>
+
+// Forward declarations
+class Socket;
+class SockServ;
+
+/**
+ * @brief Where a JsonWriter sends its output.
+ */
+class JsonSink {
+public:
+	virtual ~JsonSink() {};
+	/**
+	 * @brief Write the next piece of the document.
+	 * @return False if the data could not be written.
+	 */
+	virtual bool write(const uint8_t* data, size_t length) = 0;
+	/**
+	 * @brief Called by JsonWriter::finish() once the document is complete.
+	 */
+	virtual void finish() {};
+}; // JsonSink
+
+
+/**
+ * @brief Write JSON text to a sink as it is generated.
+ *
+ * JsonObject::toString() builds the whole document in memory before any of it can be sent.
+ * A JsonWriter instead passes the text to its sink through a small buffer, so a document of
+ * any size is produced in constant memory, as long as the sink itself does not hold on to the
+ * text.  Commas, colons and string escapes are handled by
+ * the writer.
+ *
+ * @code{.cpp}
+ * JsonSocketSink sink(&socket);
+ * JsonWriter writer(&sink);
+ * writer.beginObject();
+ * writer.key("uptime").value(FreeRTOS::getTimeSinceStart());
+ * writer.key("history").beginArray();
+ * for (auto& r: readings) writer.value(r);
+ * writer.endArray();
+ * writer.endObject();
+ * writer.finish();
+ * @endcode
+ */
+class JsonWriter {
+public:
+	static const int MAX_DEPTH = 32;
+
+	JsonWriter(JsonSink* pSink, size_t bufferSize = 128);
+	virtual ~JsonWriter();
+	JsonWriter& beginArray();
+	JsonWriter& beginObject();
+	JsonWriter& endArray();
+	JsonWriter& endObject();
+	bool        finish();
+	bool        flush();
+	bool        isOk();
+	JsonWriter& key(const char* name);
+	JsonWriter& key(const std::string& name);
+	JsonWriter& raw(const char* json, size_t length);
+	JsonWriter& value(bool value);
+	JsonWriter& value(int value);
+	JsonWriter& value(uint32_t value);
+	JsonWriter& value(int64_t value);
+	JsonWriter& value(uint64_t value);
+	JsonWriter& value(double value);
+	JsonWriter& value(const char* value);
+	JsonWriter& value(const std::string& value);
+	JsonWriter& valueNull();
+
+	/**
+	 * @brief Write an integer of any other type, such as long or size_t where that is not one of the above.
+	 */
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, JsonWriter&>::type value(T value) {
+		return std::is_signed<T>::value ? this->value((int64_t)value) : this->value((uint64_t)value);
+	}
+
+private:
+	bool begin(bool isArray);
+	bool end(bool isArray);
+	bool separate();
+	void put(char c);
+	void put(const char* data, size_t length);
+	void putString(const char* value, size_t length);
+
+	JsonSink* m_pSink;
+	uint8_t*  m_buffer;
+	size_t    m_bufferSize;
+	size_t    m_length;
+	uint32_t  m_arrays;    // Bit n set if the container at depth n is an array.
+	uint32_t  m_started;   // Bit n set once the container at depth n has a member.
+	int       m_depth;
+	bool      m_afterKey;
+	bool      m_ok;
+}; // JsonWriter
+
+
+/**
+ * @brief A sink that appends to a string.
+ */
+class JsonStringSink: public JsonSink {
+public:
+	JsonStringSink(std::string* pString);
+	bool write(const uint8_t* data, size_t length) override;
+private:
+	std::string* m_pString;
+}; // JsonStringSink
+
+
+/**
+ * @brief A sink that writes to an open file.
+ */
+class JsonFileSink: public JsonSink {
+public:
+	JsonFileSink(FILE* file);
+	bool write(const uint8_t* data, size_t length) override;
+private:
+	FILE* m_file;
+}; // JsonFileSink
+
+
+/**
+ * @brief A sink that sends to a connected Socket.
+ */
+class JsonSocketSink: public JsonSink {
+public:
+	JsonSocketSink(Socket* pSocket);
+	bool write(const uint8_t* data, size_t length) override;
+private:
+	Socket* m_pSocket;
+}; // JsonSocketSink
+
+
+/**
+ * @brief A sink that sends to the partner connected to a SockServ.
+ */
+class JsonSockServSink: public JsonSink {
+public:
+	JsonSockServSink(SockServ* pSockServ);
+	bool write(const uint8_t* data, size_t length) override;
+private:
+	SockServ* m_pSockServ;
+}; // JsonSockServSink
+
+#endif /* COMPONENTS_CPP_UTILS_JSONWRITER_H_ */
@@ -0,0 +1,139 @@
+/*
+ * MPSCQueue.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_MPSCQUEUE_H_
+#define COMPONENTS_CPP_UTILS_MPSCQUEUE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief A bounded queue between any number of producers and one consumer that takes no lock.
+ *
+ * The items are held in a ring within the object.  Each slot carries a sequence number that
+ * says whose turn it is: a producer claims the next slot by moving the tail with one
+ * compare and swap, copies its item in and then publishes it by moving the slot's sequence on,
+ * and the consumer frees it the same way.  A push to a full queue fails at once, so a producer
+ * never waits.
+ *
+ * A producer that is suspended between claiming a slot and publishing it holds back the items
+ * pushed after it: the consumer finds the queue empty until it goes on.  Nothing is lost.
+ *
+ * Any task may push; exactly one task may pop.  With a single producer SPSCQueue is cheaper.
+ *
+ * @code{.cpp}
+ * MPSCQueue<event_t, 32> queue;
+ * // Any producer
+ * if (!queue.push(event)) {
+ * 	dropped++;
+ * }
+ * // The consumer
+ * event_t event;
+ * while (queue.pop(&event)) {
+ * 	...
+ * }
+ * @endcode
+ *
+ * @tparam T The item type, which must be default constructible and copyable.
+ * @tparam CAPACITY The number of items held, a power of 2.
+ */
+template<typename T, size_t CAPACITY>
+class MPSCQueue {
+	static_assert(CAPACITY >= 2 && CAPACITY <= 0x80000000u && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+public:
+	MPSCQueue(): m_tail(0), m_head(0) {
+		for (uint32_t i = 0; i < CAPACITY; i++) {
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	size_t capacity() const {
+		return CAPACITY;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/**
+	 * @brief Remove the item at the head of the queue.  Call from the consumer only.
+	 * @param [out] pItem Where to copy the item.
+	 * @return False if the queue was empty, or its head not yet published.
+	 */
+	bool pop(T* pItem) {
+		uint32_t head = m_head.load(std::memory_order_relaxed);
+		Slot& slot = m_slots[head & MASK];
+		if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (head + 1)) < 0) {
+			return false;
+		}
+		*pItem = slot.item;
+		slot.sequence.store(head + CAPACITY, std::memory_order_release);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	} // pop
+
+	/**
+	 * @brief Add an item at the tail of the queue.  Call from any producer.
+	 * @param [in] item The item to copy into the queue.
+	 * @return False if the queue was full and the item was not added.
+	 */
+	bool push(const T& item) {
+		uint32_t tail = m_tail.load(std::memory_order_relaxed);
+		Slot* pSlot;
+		for (;;) {
+			pSlot = &m_slots[tail & MASK];
+			int32_t diff = (int32_t)(pSlot->sequence.load(std::memory_order_acquire) - tail);
+			if (diff == 0) {
+				// The slot is free for this index: claim it, unless another producer did first.
+				if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;   // The consumer has not yet freed the slot a lap ago.
+			} else {
+				tail = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+		pSlot->item = item;
+		pSlot->sequence.store(tail + 1, std::memory_order_release);
+		return true;
+	} // push
+
+	/**
+	 * @brief Get the number of items in the queue, including those claimed but not yet published.
+	 *
+	 * Only an estimate while other tasks push or pop.
+	 */
+	size_t size() const {
+		int32_t size = (int32_t)(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+		return size < 0 ? 0 : (size_t)size;
+	}
+
+private:
+	static const uint32_t MASK = CAPACITY - 1;
+
+	/**
+	 * @brief A slot of the ring.  Its sequence is the index that may push into it next when it
+	 * equals that index, and the index that may pop from it when it is one past.
+	 */
+	struct Slot {
+		std::atomic<uint32_t> sequence;
+		T                     item;
+	};
+
+	// The indexes only ever increase, wrapping at 2^32, and the slot is the index modulo
+	// CAPACITY.  The producers' and the consumer's fields are kept apart so the two do not share
+	// a cache line.
+	std::atomic<uint32_t> m_tail;   // Moved by the producers.
+	uint8_t               m_pad1[64];
+	std::atomic<uint32_t> m_head;   // Moved by the consumer.
+	uint8_t               m_pad2[64];
+	Slot                  m_slots[CAPACITY];
+}; // MPSCQueue
+
+#endif /* COMPONENTS_CPP_UTILS_MPSCQUEUE_H_ */
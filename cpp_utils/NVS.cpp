@@ -67,6 +67,33 @@ void NVS::get(std::string key, std::string* result) {
 } // get
 
 
+/**
+ * @brief Retrieve a binary value by key.
+ *
+ * Pass a null result to learn the length of the value.
+ *
+ * @param [in] key The key to read from the namespace.
+ * @param [out] result Where to put the value, or nullptr.
+ * @param [in,out] length The size of the result; set to the length of the value.
+ * @return ESP_OK, or the error of nvs_get_blob, such as ESP_ERR_NVS_NOT_FOUND.
+ */
+esp_err_t NVS::get(std::string key, uint8_t* result, size_t& length) {
+	return nvs_get_blob(m_handle, key.c_str(), result, &length);
+} // get
+
+
+/**
+ * @brief Set a binary value by key.
+ *
+ * @param [in] key The key to set from the namespace.
+ * @param [in] data The value to set for the key.
+ * @param [in] length The length of the value.
+ */
+void NVS::set(std::string key, uint8_t* data, size_t length) {
+	nvs_set_blob(m_handle, key.c_str(), data, length);
+} // set
+
+
 /**
  * @brief Set the string value by key.
  *
@@ -22,7 +22,9 @@ public:
 	void erase();
 	void erase(std::string key);
 	void get(std::string key, std::string *result);
+	esp_err_t get(std::string key, uint8_t *result, size_t &length);
 	void set(std::string key, std::string data);
+	void set(std::string key, uint8_t *data, size_t length);
 private:
 	std::string m_name;
 	nvs_handle m_handle;
@@ -0,0 +1,340 @@
+/*
+ * PublishBatcher.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include <esp_log.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "PublishBatcher.h"
+#include "Task.h"
+#include "sdkconfig.h"
+
+static const char* LOG_TAG = "PublishBatcher";
+
+static const uint32_t BINARY_HEADER_SIZE = 8;
+
+const PublishBatcher::policy_t PublishBatcher::DEFAULT_POLICY = { 1024, 100, 1000 };
+
+
+/**
+ * @brief The task that publishes full frames, so that producers never wait on the network.
+ */
+class PublishBatcherTask: public Task {
+public:
+	PublishBatcherTask(PublishBatcher* pBatcher, uint16_t stackSize): Task("PublishBatcherTask", stackSize) {
+		m_pBatcher = pBatcher;
+		m_stopped  = xSemaphoreCreateBinary();
+	}
+
+	~PublishBatcherTask() {
+		vSemaphoreDelete(m_stopped);
+	}
+
+	void run(void* data) {
+		while (m_pBatcher->m_running) {
+			bool force = m_pBatcher->m_flushRequested;
+			m_pBatcher->m_flushRequested = false;
+			uint32_t waitMs = m_pBatcher->publishFull(force);
+			// Wait at least a tick: a frame due sooner would otherwise be polled without a pause.
+			TickType_t ticks = waitMs == UINT32_MAX ? portMAX_DELAY : (waitMs + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+			xSemaphoreTake(m_pBatcher->m_wakeup, ticks == 0 ? 1 : ticks);
+		}
+		m_pBatcher->publishFull(true);
+		xSemaphoreGive(m_stopped);
+	} // run
+
+	SemaphoreHandle_t m_stopped;
+
+private:
+	PublishBatcher* m_pBatcher;
+};
+
+
+/**
+ * @brief Create a batcher.
+ * @param [in] sink The function that publishes a frame.
+ * @param [in] stackSize The stack size of the task that calls the sink.
+ */
+PublishBatcher::PublishBatcher(sink_t sink, uint16_t stackSize) {
+	m_sink    = sink;
+	m_lock    = portMUX_INITIALIZER_UNLOCKED;
+	m_wakeup  = xSemaphoreCreateBinary();
+	m_pTask   = new PublishBatcherTask(this, stackSize);
+	m_dropped = 0;
+	m_running = false;
+	m_flushRequested = false;
+} // PublishBatcher
+
+
+PublishBatcher::~PublishBatcher() {
+	stop();
+	delete m_pTask;
+	vSemaphoreDelete(m_wakeup);
+	for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+		delete[] (*it)->frames[0].data;
+		delete[] (*it)->frames[1].data;
+		delete *it;
+	}
+} // ~PublishBatcher
+
+
+/**
+ * @brief Add a topic whose samples are fixed size binary records.
+ *
+ * Topics must be added before start() is called.
+ *
+ * @param [in] topic The topic the frames are published on.
+ * @param [in] recordSize The size of every sample passed to add().
+ * @param [in] policy The limits that cause a frame to be published.  maxSamples is limited to
+ * 65535, as the header counts the records in 16 bits.
+ * @return The handle to pass to add(), or -1 if the policy cannot hold a single record.
+ */
+int PublishBatcher::addTopic(std::string topic, uint16_t recordSize, policy_t policy) {
+	if (recordSize == 0 || policy.maxBytes < BINARY_HEADER_SIZE + recordSize) {
+		ESP_LOGE(LOG_TAG, "addTopic: %s: maxBytes %d too small for records of %d", topic.c_str(), policy.maxBytes, recordSize);
+		return -1;
+	}
+	if (policy.maxSamples > UINT16_MAX) {
+		ESP_LOGW(LOG_TAG, "addTopic: %s: maxSamples %u limited to %u, the most the frame header can count",
+			topic.c_str(), (unsigned)policy.maxSamples, (unsigned)UINT16_MAX);
+		policy.maxSamples = UINT16_MAX;
+	}
+	int handle = addTopic(topic, FORMAT_BINARY, policy);
+	m_batches[handle]->recordSize = recordSize;
+	return handle;
+} // addTopic
+
+
+/**
+ * @brief Add a topic.
+ *
+ * Topics must be added before start() is called.
+ *
+ * @param [in] topic The topic the frames are published on.
+ * @param [in] format The encoding of the frames.  Use the other form of addTopic() for FORMAT_BINARY.
+ * @param [in] policy The limits that cause a frame to be published.
+ * @return The handle to pass to add().
+ */
+int PublishBatcher::addTopic(std::string topic, format_t format, policy_t policy) {
+	Batch* pBatch = new Batch;
+	pBatch->topic      = topic;
+	pBatch->format     = format;
+	pBatch->recordSize = 0;
+	pBatch->policy     = policy;
+	pBatch->filling    = 0;
+	pBatch->full       = false;
+	for (int i = 0; i < 2; i++) {
+		pBatch->frames[i].data = new uint8_t[policy.maxBytes];
+		beginFrame(pBatch, &pBatch->frames[i], 0);
+	}
+	m_batches.push_back(pBatch);
+	return m_batches.size() - 1;
+} // addTopic
+
+
+/**
+ * @brief Add a sample to the current frame of a topic.
+ *
+ * This may be called from any task.  It copies the sample and returns without waiting for
+ * any publish to complete.
+ *
+ * @param [in] topic The handle returned by addTopic().
+ * @param [in] sample The sample: a record for FORMAT_BINARY, the text of a JSON value for FORMAT_JSON_ARRAY.
+ * @param [in] length The length of the sample.
+ * @return True if the sample was added, false if it was dropped because both frames are full.
+ */
+bool PublishBatcher::add(int topic, const void* sample, size_t length) {
+	if (topic < 0 || topic >= (int)m_batches.size()) {
+		return false;
+	}
+	Batch* pBatch = m_batches[topic];
+	if (pBatch->format == FORMAT_BINARY && length != pBatch->recordSize) {
+		ESP_LOGE(LOG_TAG, "add: %s: sample of %d bytes, expected %d", pBatch->topic.c_str(), (int)length, pBatch->recordSize);
+		return false;
+	}
+	// A JSON sample must fit an empty frame between its brackets.  addTopic() has checked a record does.
+	if (pBatch->format == FORMAT_JSON_ARRAY && length + 2 > pBatch->policy.maxBytes) {
+		ESP_LOGE(LOG_TAG, "add: %s: sample of %d bytes, frames hold %d", pBatch->topic.c_str(), (int)length, (int)pBatch->policy.maxBytes);
+		portENTER_CRITICAL(&m_lock);
+		m_dropped++;
+		portEXIT_CRITICAL(&m_lock);
+		return false;
+	}
+	uint32_t now   = FreeRTOS::getTimeSinceStart();
+	bool     added = false;
+	bool     wake  = false;
+
+	portENTER_CRITICAL(&m_lock);
+	Frame* pFrame = &pBatch->frames[pBatch->filling];
+	// For JSON, a separating comma and the closing bracket.
+	uint32_t extra = (pBatch->format == FORMAT_JSON_ARRAY) ? (pFrame->count > 0) + 1 : 0;
+	if (pFrame->length + length + extra > pBatch->policy.maxBytes) {
+		if (pFrame->count == 0 || !swap(pBatch)) {
+			goto done; // The other frame is still being published.
+		}
+		wake   = true;
+		pFrame = &pBatch->frames[pBatch->filling];
+	}
+	if (pFrame->count == 0) {
+		pFrame->firstMs = now;
+	} else if (pBatch->format == FORMAT_JSON_ARRAY) {
+		pFrame->data[pFrame->length++] = ',';
+	}
+	::memcpy(pFrame->data + pFrame->length, sample, length);
+	pFrame->length += length;
+	pFrame->count++;
+	added = true;
+	if (pFrame->count >= pBatch->policy.maxSamples && swap(pBatch)) {
+		wake = true;
+	}
+done:
+	if (!added) {
+		m_dropped++;
+	}
+	portEXIT_CRITICAL(&m_lock);
+
+	if (wake) {
+		xSemaphoreGive(m_wakeup);
+	}
+	return added;
+} // add
+
+
+/**
+ * @brief Publish everything batched so far without waiting for the policy limits.
+ */
+void PublishBatcher::flush() {
+	m_flushRequested = true;
+	xSemaphoreGive(m_wakeup);
+} // flush
+
+
+/**
+ * @brief Get the number of samples dropped because a topic's frames were both full.
+ * @return The number of dropped samples.
+ */
+uint32_t PublishBatcher::getDropped() {
+	return m_dropped;
+} // getDropped
+
+
+/**
+ * @brief Start the task that publishes the frames.
+ */
+void PublishBatcher::start() {
+	m_running = true;
+	m_pTask->start();
+} // start
+
+
+/**
+ * @brief Publish what remains and stop the task.
+ */
+void PublishBatcher::stop() {
+	if (!m_running) {
+		return;
+	}
+	m_running = false;
+	xSemaphoreGive(m_wakeup);
+	xSemaphoreTake(m_pTask->m_stopped, portMAX_DELAY);
+} // stop
+
+
+/**
+ * @brief Reset a frame to hold no samples.
+ */
+void PublishBatcher::beginFrame(Batch* pBatch, Frame* pFrame, uint32_t now) {
+	pFrame->count   = 0;
+	pFrame->firstMs = now;
+	if (pBatch->format == FORMAT_JSON_ARRAY) {
+		pFrame->data[0] = '[';
+		pFrame->length  = 1;
+	} else {
+		pFrame->length  = BINARY_HEADER_SIZE;
+	}
+} // beginFrame
+
+
+/**
+ * @brief Complete a frame ready for publishing: the header or the closing bracket.
+ */
+void PublishBatcher::endFrame(Batch* pBatch, Frame* pFrame) {
+	if (pBatch->format == FORMAT_JSON_ARRAY) {
+		pFrame->data[pFrame->length++] = ']';
+		return;
+	}
+	uint8_t* p = pFrame->data;
+	p[0] = pFrame->count & 0xff;
+	p[1] = pFrame->count >> 8;
+	p[2] = pBatch->recordSize & 0xff;
+	p[3] = pBatch->recordSize >> 8;
+	p[4] = pFrame->firstMs & 0xff;
+	p[5] = (pFrame->firstMs >> 8) & 0xff;
+	p[6] = (pFrame->firstMs >> 16) & 0xff;
+	p[7] = pFrame->firstMs >> 24;
+} // endFrame
+
+
+/**
+ * @brief Hand the filling frame over for publishing and start filling the other one.
+ *
+ * Must be called with m_lock held.
+ *
+ * @return False if the other frame has not been published yet.
+ */
+bool PublishBatcher::swap(Batch* pBatch) {
+	if (pBatch->full) {
+		return false;
+	}
+	pBatch->full    = true;
+	pBatch->filling ^= 1;
+	beginFrame(pBatch, &pBatch->frames[pBatch->filling], 0);
+	return true;
+} // swap
+
+
+/**
+ * @brief Publish the frames that are full or old enough.  Runs on the batcher's task.
+ * @param [in] force Publish every frame that holds a sample, whatever its age.
+ * @return The time in milliseconds until the oldest waiting sample is due, or UINT32_MAX if there are none.
+ */
+uint32_t PublishBatcher::publishFull(bool force) {
+	uint32_t waitMs = UINT32_MAX;
+	for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+		Batch* pBatch = *it;
+		while (true) {
+			uint32_t now = FreeRTOS::getTimeSinceStart();
+			portENTER_CRITICAL(&m_lock);
+			Frame* pFilling = &pBatch->frames[pBatch->filling];
+			if (!pBatch->full && pFilling->count > 0 && (force ||
+					now - pFilling->firstMs >= pBatch->policy.maxAgeMs || pFilling->count >= pBatch->policy.maxSamples)) {
+				swap(pBatch);
+			}
+			bool   full    = pBatch->full;
+			Frame* pFrame  = &pBatch->frames[pBatch->filling ^ 1];
+			if (!full && pFilling->count > 0) {
+				uint32_t due = pBatch->policy.maxAgeMs - (now - pFilling->firstMs);
+				if (due < waitMs) {
+					waitMs = due;
+				}
+			}
+			portEXIT_CRITICAL(&m_lock);
+			if (!full) {
+				break;
+			}
+
+			// Producers leave a full frame alone, so it can be published without the lock.
+			endFrame(pBatch, pFrame);
+			ESP_LOGD(LOG_TAG, "publish: %s: %d samples, %d bytes", pBatch->topic.c_str(), pFrame->count, pFrame->length);
+			m_sink(pBatch->topic, pFrame->data, pFrame->length);
+
+			portENTER_CRITICAL(&m_lock);
+			pBatch->full = false;
+			portEXIT_CRITICAL(&m_lock);
+		}
+	}
+	return waitMs;
+} // publishFull
@@ -0,0 +1,117 @@
+/*
+ * PublishBatcher.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_PUBLISHBATCHER_H_
+#define COMPONENTS_CPP_UTILS_PUBLISHBATCHER_H_
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+class PublishBatcherTask;
+
+/**
+ * @brief Coalesce high rate samples into fewer, larger publishes.
+ *
+ * Each topic added to the batcher accumulates samples into a frame.  When the frame reaches
+ * the byte, sample count or age limit of the topic's policy, it is handed to the sink
+ * (typically an MQTT or AWS publish) from the batcher's own task.  Every topic has two
+ * frame buffers: producers fill one while the other is being published, so add() never
+ * waits for the network.  If both buffers are full the sample is dropped and counted.
+ *
+ * Frames are either a JSON array of the samples, each of which must be a JSON value, or a
+ * binary frame of fixed size records:
+ *
+ * | count (uint16 LE) | record size (uint16 LE) | first sample time ms (uint32 LE) | records ... |
+ *
+ * For example:
+ *
+ * @code{.cpp}
+ * AWS aws;
+ * PublishBatcher batcher([&aws](const std::string& topic, const uint8_t* data, size_t length) {
+ * 	aws.publish(topic, std::string((const char*)data, length));
+ * });
+ * int accel = batcher.addTopic("sensor/accel", sizeof(accel_t));
+ * batcher.start();
+ * ...
+ * batcher.add(accel, &reading, sizeof(reading));  // at 100Hz
+ * @endcode
+ */
+class PublishBatcher {
+public:
+	/**
+	 * @brief The encoding of the samples in a frame.
+	 */
+	typedef enum {
+		FORMAT_BINARY,     //!< Fixed size records behind an 8 byte header.
+		FORMAT_JSON_ARRAY  //!< Samples are JSON values, published as "[s1,s2,...]".
+	} format_t;
+
+	/**
+	 * @brief When to publish a frame.  A frame is published as soon as any limit is reached.
+	 */
+	typedef struct {
+		uint32_t maxBytes;    //!< Largest frame, including the header or brackets.
+		uint32_t maxSamples;  //!< Most samples in one frame.
+		uint32_t maxAgeMs;    //!< Longest time the first sample of a frame may wait.
+	} policy_t;
+
+	/**
+	 * @brief Receives each frame to publish.  Called on the batcher's task.
+	 */
+	typedef std::function<void(const std::string& topic, const uint8_t* data, size_t length)> sink_t;
+
+	static const policy_t DEFAULT_POLICY;
+
+	PublishBatcher(sink_t sink, uint16_t stackSize = 4096);
+	virtual ~PublishBatcher();
+	int      addTopic(std::string topic, uint16_t recordSize, policy_t policy = DEFAULT_POLICY);
+	int      addTopic(std::string topic, format_t format, policy_t policy = DEFAULT_POLICY);
+	bool     add(int topic, const void* sample, size_t length);
+	void     flush();
+	uint32_t getDropped();
+	void     start();
+	void     stop();
+
+private:
+	friend class PublishBatcherTask;
+
+	struct Frame {
+		uint8_t* data;
+		uint32_t length;
+		uint32_t count;
+		uint32_t firstMs;
+	};
+
+	struct Batch {
+		std::string topic;
+		format_t    format;
+		uint16_t    recordSize;
+		policy_t    policy;
+		Frame       frames[2];
+		int         filling;   // Index of the frame producers append to.
+		bool        full;      // The other frame is waiting to be published.
+	};
+
+	void     beginFrame(Batch* pBatch, Frame* pFrame, uint32_t now);
+	void     endFrame(Batch* pBatch, Frame* pFrame);
+	bool     swap(Batch* pBatch);
+	uint32_t publishFull(bool force);
+
+	sink_t              m_sink;
+	std::vector<Batch*> m_batches;
+	portMUX_TYPE        m_lock;
+	SemaphoreHandle_t   m_wakeup;
+	PublishBatcherTask* m_pTask;
+	uint32_t            m_dropped;
+	bool                m_running;
+	volatile bool       m_flushRequested;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_PUBLISHBATCHER_H_ */
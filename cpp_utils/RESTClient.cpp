@@ -52,7 +52,8 @@ void RESTClient::get() {
  */
 void RESTClient::post(std::string body) {
 	prepForCall();
-	::curl_easy_setopt(m_curlHandle, CURLOPT_POSTFIELDS, body.c_str());
+	::curl_easy_setopt(m_curlHandle, CURLOPT_POSTFIELDSIZE, (long)body.length()); // The body may be binary, such as CBOR.
+	::curl_easy_setopt(m_curlHandle, CURLOPT_POSTFIELDS, body.data());
 	int rc = ::curl_easy_perform(m_curlHandle);
 	if (rc != CURLE_OK) {
 		ESP_LOGE(tag, "post(): %s", getErrorMessage().c_str());
@@ -73,7 +74,7 @@ std::string RESTClient::getErrorMessage() {
  * @brief Callback function to handle the data received.
  *
  * This is a callback function architected by libcurl to be called when data is received.
- * We append the data to an accumulating buffer.
+ * We append the data to an accumulating buffer, or feed it to the response parser if one is set.
  *
  * @param [in] buffer A buffer of records.
  * @param [in] size The size of a record.
@@ -85,6 +86,10 @@ std::string RESTClient::getErrorMessage() {
 size_t RESTClient::handleData(void *buffer, size_t size, size_t nmemb, void *userp) {
 	//printf("handleData: size: %d, num: %d\n", size, nmemb);
 	RESTClient *pClient = (RESTClient *)userp;
+	if (pClient->m_pResponseParser != nullptr) {
+		// Returning less than we were given makes libcurl abandon the transfer.
+		return pClient->m_pResponseParser->feed((const char *)buffer, size*nmemb) ? size * nmemb : 0;
+	}
 	pClient->m_response.append((const char *)buffer, size*nmemb);
 	return size * nmemb;
 } // handleData
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <curl/curl.h>
+#include "JSONParser.h"
 class RESTClient;
 
 /**
@@ -87,6 +88,18 @@ public:
 
 	void post(std::string body);
 
+	/**
+	 * @brief Pass the response to a JSON parser as it arrives instead of accumulating it.
+	 *
+	 * getResponse() then returns an empty string.  The caller resets the parser before the
+	 * call and calls its end() method after it.
+	 *
+	 * @param [in] pParser The parser, or nullptr to accumulate the response again.
+	 */
+	void setResponseParser(JsonParser* pParser) {
+		m_pResponseParser = pParser;
+	};
+
 	/**
 	 * @brief Set the URL for the target.
 	 *
@@ -117,6 +130,7 @@ private:
 	friend class RESTTimings;
 	RESTTimings *m_timings;
 	std::string m_response;
+	JsonParser *m_pResponseParser = nullptr;
 	static size_t handleData(void *buffer, size_t size, size_t nmemb, void *userp);
 	void prepForCall();
 };
@@ -0,0 +1,124 @@
+/*
+ * SPSCQueue.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_SPSCQUEUE_H_
+#define COMPONENTS_CPP_UTILS_SPSCQUEUE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief A bounded queue between one producer and one consumer that takes no lock.
+ *
+ * The items are held in a ring within the object.  The producer alone moves the tail and the
+ * consumer alone moves the head, so push() and pop() are a copy and an atomic store each, and
+ * neither ever waits for the other: a push to a full queue fails at once, which suits a producer
+ * such as a BLE or network callback that must not block.  Each side keeps its own copy of the
+ * other's index and reads the shared one only when its copy says the queue is full or empty.
+ *
+ * Exactly one task may push and exactly one task may pop.
+ *
+ * @code{.cpp}
+ * SPSCQueue<sample_t, 64> queue;
+ * // Producer
+ * if (!queue.push(sample)) {
+ * 	dropped++;
+ * }
+ * // Consumer
+ * sample_t sample;
+ * while (queue.pop(&sample)) {
+ * 	...
+ * }
+ * @endcode
+ *
+ * @tparam T The item type, which must be default constructible and copyable.
+ * @tparam CAPACITY The number of items held, a power of 2.
+ */
+template<typename T, size_t CAPACITY>
+class SPSCQueue {
+	static_assert(CAPACITY >= 2 && CAPACITY <= 0x80000000u && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+public:
+	SPSCQueue(): m_head(0), m_tail(0) {
+		m_headCache = 0;
+		m_tailCache = 0;
+	}
+
+	size_t capacity() const {
+		return CAPACITY;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/**
+	 * @brief Remove the item at the head of the queue.  Call from the consumer only.
+	 * @param [out] pItem Where to copy the item.
+	 * @return False if the queue was empty.
+	 */
+	bool pop(T* pItem) {
+		uint32_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tailCache) {
+			m_tailCache = m_tail.load(std::memory_order_acquire);
+			if (head == m_tailCache) {
+				return false;
+			}
+		}
+		*pItem = m_items[head & MASK];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	} // pop
+
+	/**
+	 * @brief Add an item at the tail of the queue.  Call from the producer only.
+	 * @param [in] item The item to copy into the queue.
+	 * @return False if the queue was full and the item was not added.
+	 */
+	bool push(const T& item) {
+		uint32_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_headCache == CAPACITY) {
+			m_headCache = m_head.load(std::memory_order_acquire);
+			if (tail - m_headCache == CAPACITY) {
+				return false;
+			}
+		}
+		m_items[tail & MASK] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	} // push
+
+	/**
+	 * @brief Get the number of items in the queue.
+	 *
+	 * From either side the count is exact for that side: the consumer may find more, the
+	 * producer may find room for more.  From any other task it is only an estimate, but never
+	 * more than the capacity.
+	 */
+	size_t size() const {
+		// The head first: the tail is then at least the head that was read, as the head never
+		// passes the tail, so the difference cannot wrap.
+		uint32_t head = m_head.load(std::memory_order_acquire);
+		uint32_t size = m_tail.load(std::memory_order_acquire) - head;
+		return size > CAPACITY ? CAPACITY : size;
+	}
+
+private:
+	static const uint32_t MASK = CAPACITY - 1;
+
+	// The indexes only ever increase, wrapping at 2^32, and the slot is the index modulo
+	// CAPACITY.  Each side's fields are kept apart so the two do not share a cache line.
+	std::atomic<uint32_t> m_head;        // Written by the consumer.
+	uint32_t              m_tailCache;   // The consumer's copy of m_tail.
+	uint8_t               m_pad1[64];
+	std::atomic<uint32_t> m_tail;        // Written by the producer.
+	uint32_t              m_headCache;   // The producer's copy of m_head.
+	uint8_t               m_pad2[64];
+	T                     m_items[CAPACITY];
+}; // SPSCQueue
+
+#endif /* COMPONENTS_CPP_UTILS_SPSCQUEUE_H_ */
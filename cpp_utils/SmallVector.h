@@ -0,0 +1,173 @@
+/*
+ * SmallVector.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_SMALLVECTOR_H_
+#define COMPONENTS_CPP_UTILS_SMALLVECTOR_H_
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <utility>
+
+/**
+ * @brief A vector that holds its first N elements within the object.
+ *
+ * Up to N elements need no allocation at all; beyond that the elements move to the heap, as
+ * with a std::vector.  For the short lists that are common on a device, such as the
+ * characteristics of a service, this saves an allocation and the heap's per block overhead.
+ *
+ * @code{.cpp}
+ * SmallVector<BLECharacteristic*, 8> characteristics;
+ * characteristics.pushBack(pCharacteristic);
+ * for (auto pCharacteristic: characteristics) { ... }
+ * @endcode
+ */
+template<typename T, size_t N>
+class SmallVector {
+	static_assert(N > 0, "N must be at least 1");
+
+public:
+	SmallVector() : m_data(inlineData()), m_size(0), m_capacity(N) {}
+
+	SmallVector(const SmallVector& other) : m_data(inlineData()), m_size(0), m_capacity(N) {
+		*this = other;
+	}
+
+	~SmallVector() {
+		clear();
+		if (!isInline()) {
+			free(m_data);
+		}
+	}
+
+	/**
+	 * @brief Copy the elements of another vector.
+	 *
+	 * If the memory for them cannot be allocated, only as many as fit are copied.
+	 */
+	SmallVector& operator=(const SmallVector& other) {
+		if (this != &other) {
+			clear();
+			size_t size = reserve(other.m_size) ? other.m_size : m_capacity;
+			for (size_t i = 0; i < size; i++) {
+				new (&m_data[i]) T(other.m_data[i]);
+			}
+			m_size = size;
+		}
+		return *this;
+	}
+
+	T& operator[](size_t index) {
+		return m_data[index];
+	}
+	const T& operator[](size_t index) const {
+		return m_data[index];
+	}
+
+	T* begin() {
+		return m_data;
+	}
+	T* end() {
+		return m_data + m_size;
+	}
+	const T* begin() const {
+		return m_data;
+	}
+	const T* end() const {
+		return m_data + m_size;
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	void clear() {
+		for (size_t i = 0; i < m_size; i++) {
+			m_data[i].~T();
+		}
+		m_size = 0;
+	}
+
+	/**
+	 * @brief Remove an element, moving those after it down.
+	 */
+	void erase(size_t index) {
+		for (size_t i = index; i + 1 < m_size; i++) {
+			m_data[i] = std::move(m_data[i + 1]);
+		}
+		m_data[--m_size].~T();
+	}
+
+	bool isEmpty() const {
+		return m_size == 0;
+	}
+
+	void popBack() {
+		m_data[--m_size].~T();
+	}
+
+	/**
+	 * @brief Add an element to the end.
+	 *
+	 * @return False if more memory was needed and could not be allocated.
+	 */
+	bool pushBack(const T& value) {
+		if (m_size == m_capacity) {
+			T copy(value);   // The value may be one of our elements, which are about to move.
+			if (!reserve(m_capacity * 2)) {
+				return false;
+			}
+			new (&m_data[m_size++]) T(std::move(copy));
+			return true;
+		}
+		new (&m_data[m_size++]) T(value);
+		return true;
+	}
+
+	/**
+	 * @brief Make room for at least a number of elements.
+	 *
+	 * @return False if the memory could not be allocated.
+	 */
+	bool reserve(size_t capacity) {
+		if (capacity <= m_capacity) {
+			return true;
+		}
+		T* pData = (T*)malloc(capacity * sizeof(T));
+		if (pData == nullptr) {
+			return false;
+		}
+		for (size_t i = 0; i < m_size; i++) {
+			new (&pData[i]) T(std::move(m_data[i]));
+			m_data[i].~T();
+		}
+		if (!isInline()) {
+			free(m_data);
+		}
+		m_data     = pData;
+		m_capacity = capacity;
+		return true;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+private:
+	T* inlineData() {
+		return reinterpret_cast<T*>(m_inline);
+	}
+	bool isInline() {
+		return m_data == inlineData();
+	}
+
+	alignas(T) unsigned char m_inline[N * sizeof(T)];
+	T*     m_data;
+	size_t m_size;
+	size_t m_capacity;
+}; // SmallVector
+
+#endif /* COMPONENTS_CPP_UTILS_SMALLVECTOR_H_ */
@@ -13,6 +13,7 @@
 #include <unistd.h>
 
 #include "sdkconfig.h"
+#include "GeneralUtils.h"
 #include "Socket.h"
 
 static char tag[] = "Socket";
@@ -33,11 +34,13 @@ Socket::~Socket() {
  */
 std::string Socket::addressToString(struct sockaddr* addr) {
 	struct sockaddr_in *pInAddr = (struct sockaddr_in *)addr;
-	char temp[30];
-	char ip[20];
-	inet_ntop(AF_INET, &pInAddr->sin_addr, ip, sizeof(ip));
-	sprintf(temp, "%s [%d]", ip, ntohs(pInAddr->sin_port));
-	return std::string(temp);
+	char temp[GeneralUtils::IP_STRING_LENGTH + GeneralUtils::DECIMAL_STRING_LENGTH + 3];
+	size_t length = GeneralUtils::formatIp((const uint8_t*)&pInAddr->sin_addr, temp);
+	temp[length++] = ' ';
+	temp[length++] = '[';
+	length += GeneralUtils::formatDecimal((uint32_t)ntohs(pInAddr->sin_port), temp + length);
+	temp[length++] = ']';
+	return std::string(temp, length);
 } // addressToString
 
 
@@ -200,14 +203,15 @@ int Socket::receiveFrom_cpp(uint8_t* data, size_t length,	struct sockaddr *pAddr
  *
  * @param [in] data The buffer containing the data to send.
  * @param [in] length The length of data to be sent.
- * @return N/A.
+ * @return The number of bytes sent, which may be fewer than length, or -1 on an error.
  *
  */
-void Socket::send_cpp(const uint8_t* data, size_t length) {
+int Socket::send_cpp(const uint8_t* data, size_t length) {
 	int rc = ::send(m_sock, data, length, 0);
 	if (rc == -1) {
 		ESP_LOGE(tag, "send: socket=%d, %s", m_sock, strerror(errno));
 	}
+	return rc;
 } // send_cpp
 
 
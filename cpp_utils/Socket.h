@@ -34,7 +34,7 @@ public:
 	void listen_cpp(uint16_t port, bool isDatagram);
 	int receive_cpp(uint8_t *data, size_t length);
 	int receiveFrom_cpp(uint8_t *data, size_t length, struct sockaddr *pAddr);
-	void send_cpp(const uint8_t *data, size_t length);
+	int send_cpp(const uint8_t *data, size_t length);
 	void sendTo_cpp(const uint8_t *data, size_t length, struct sockaddr *pAddr);
 private:
 	int m_sock;
@@ -6,15 +6,31 @@
  */
 
 
-#include <esp_log.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
 #include <string>
 
 #include "Task.h"
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "sdkconfig.h"
 
 static char tag[] = "Task";
+#else
+#define ESP_LOGD(tag, ...)
+#define ESP_LOGE(tag, ...)
+#define ESP_LOGW(tag, ...)
+
+/**
+ * @brief The least stack a thread is given on a host, where code needs more than on the ESP32.
+ */
+static const size_t HOST_STACK_SIZE = 256 * 1024;
+
+/**
+ * @brief The task running on this thread, set by the thread itself before run() is called.
+ */
+static thread_local Task* s_pCurrentTask = nullptr;
+#endif
 
 
 /**
@@ -25,6 +41,7 @@ static char tag[] = "Task";
  * @return N/A.
  */
 Task::Task(std::string taskName, uint16_t stackSize) {
+	this->taskName  = taskName;
 	this->stackSize = stackSize;
 	taskData = nullptr;
 	handle   = nullptr;
@@ -36,12 +53,18 @@ Task::~Task() {
 /**
  * @brief Suspend the task for the specified milliseconds.
  *
+ * The time is rounded down to whole ticks.
+ *
  * @param [in] ms The delay time in milliseconds.
  * @return N/A.
  */
 
 void Task::delay(int ms) {
+#ifdef ESP_PLATFORM
 	::vTaskDelay(ms/portTICK_PERIOD_MS);
+#else
+	FreeRTOS::sleep(ms);
+#endif
 } // delay
 
 /**
@@ -68,13 +91,35 @@ void Task::start(void *taskData) {
 		ESP_LOGW(tag, "Task::start - There might be a task already running!");
 	}
 	this->taskData = taskData;
+#ifdef ESP_PLATFORM
 	::xTaskCreate(&runTask, taskName.c_str(), stackSize, this, 5, &handle);
+#else
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, stackSize > HOST_STACK_SIZE ? stackSize : HOST_STACK_SIZE);
+	handle = this;
+	pthread_t thread;
+	int rc = ::pthread_create(&thread, &attr, [](void* pTaskInstance) -> void* {
+		s_pCurrentTask = (Task*)pTaskInstance;
+		::pthread_setname_np(::pthread_self(), ((Task*)pTaskInstance)->taskName.substr(0, 15).c_str());
+		runTask(pTaskInstance);
+		return nullptr;
+	}, this);
+	if (rc != 0) {
+		ESP_LOGE(tag, "Task::start - pthread_create: rc=%d", rc);
+		handle = nullptr;
+	}
+	pthread_attr_destroy(&attr);
+#endif
 } // start
 
 
 /**
  * @brief Stop the task.
  *
+ * On a host only a task stopping itself ends at once; see the class description.
+ *
  * @return N/A.
  */
 void Task::stop() {
@@ -83,7 +128,14 @@ void Task::stop() {
 	}
 	xTaskHandle temp = handle;
 	handle = nullptr;
+#ifdef ESP_PLATFORM
 	::vTaskDelete(temp);
+#else
+	(void)temp;
+	if (s_pCurrentTask == this) {
+		::pthread_exit(nullptr);
+	}
+#endif
 } // stop
 
 /**
@@ -7,8 +7,13 @@
 
 #ifndef COMPONENTS_CPP_UTILS_TASK_H_
 #define COMPONENTS_CPP_UTILS_TASK_H_
+#ifdef ESP_PLATFORM
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#else
+#include <pthread.h>
+#include "FreeRTOS.h"
+#endif
 #include <string>
 /**
  * @brief Encapsulate a runnable task.
@@ -30,6 +35,12 @@
  * @endcode
  *
  * implemented.
+ *
+ * On a host the task is a POSIX thread.  A task can only stop itself there: stop() called from
+ * another task marks it stopped but the thread runs on until run() returns.  There is no join
+ * either, as there is none on the ESP32.  A task that others wait on gives a semaphore as the last
+ * thing run() does; its thread then only clears the handle in stop(), so the task must not be
+ * deleted straight after the semaphore is taken.
  */
 class Task {
 public:
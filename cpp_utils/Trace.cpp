@@ -0,0 +1,640 @@
+/*
+ * Trace.cpp
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#include "Trace.h"
+#include "JSONWriter.h"
+#include <stdlib.h>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <xtensa/hal.h>
+#include <rom/ets_sys.h>
+#include <esp_log.h>
+static const char* LOG_TAG = "Trace";
+static portMUX_TYPE s_formatMux = portMUX_INITIALIZER_UNLOCKED;
+#define TRACE_LOCK()   portENTER_CRITICAL(&s_formatMux)
+#define TRACE_UNLOCK() portEXIT_CRITICAL(&s_formatMux)
+#else
+#include <chrono>
+#include <mutex>
+static std::mutex s_mutex;
+#define TRACE_LOCK()   s_mutex.lock()
+#define TRACE_UNLOCK() s_mutex.unlock()
+#endif
+
+/*
+ * An event in a buffer is a sequence of 32 bit words:
+ *
+ * [0] id:16 | words:8 | kind:4 | nargs:4
+ * [1] The time, in ticks.
+ * [2] The type of each argument, 2 bits each from bit 0.  Present only if there are arguments.
+ * The arguments: 1 word for an INT32, 2 for an INT64 or DOUBLE (low word first) and for a
+ * STRING a word holding its length followed by its characters.
+ *
+ * An event never wraps round the end of a buffer.  If it would, the rest of the buffer is
+ * skipped, marked by TRACE_PAD in place of an event header.
+ *
+ * A dump is a sequence of words in the byte order of the device:
+ *
+ * TRACE_MAGIC tickHz dropped
+ * TRACE_FORMAT id length characters...   - for each format not in an earlier dump.
+ * TRACE_EVENTS buffer count events...    - for each buffer holding events.
+ */
+static const uint32_t TRACE_MAGIC  = 0x31435254;   // "TRC1"
+static const uint32_t TRACE_PAD    = 0xffffffff;
+static const uint32_t TRACE_FORMAT = 0xfffffffe;
+static const uint32_t TRACE_EVENTS = 0xfffffffd;
+
+typedef struct {
+	uint32_t* data;
+	uint32_t  mask;      // The size of the buffer in words, less 1.
+	uint32_t  head;      // Written only by the producer.
+	uint32_t  tail;      // Written only by dump().
+	uint32_t  dropped;   // Written only by the producer.
+	bool      inUse;
+} trace_buffer_t;
+
+static trace_buffer_t s_buffers[Trace::MAX_BUFFERS];
+static const char*    s_formats[Trace::MAX_FORMATS];
+static uint32_t       s_formatCount = 0;
+static uint32_t       s_formatsSent = 0;
+
+volatile bool Trace::m_enabled = false;
+
+
+#ifndef ESP_PLATFORM
+static const std::chrono::steady_clock::time_point s_startTime = std::chrono::steady_clock::now();
+
+/**
+ * @brief The buffer of a thread, returned to the pool when the thread ends.
+ */
+class TraceThread {
+public:
+	TraceThread() {
+		m_pBuffer = nullptr;
+		std::lock_guard<std::mutex> lock(s_mutex);
+		for (int i = 0; i < Trace::MAX_BUFFERS; i++) {
+			if (!s_buffers[i].inUse) {
+				s_buffers[i].inUse = true;
+				m_pBuffer = &s_buffers[i];
+				break;
+			}
+		}
+	}
+	~TraceThread() {
+		if (m_pBuffer != nullptr) {
+			std::lock_guard<std::mutex> lock(s_mutex);
+			m_pBuffer->inUse = false;
+		}
+	}
+	trace_buffer_t* m_pBuffer;
+}; // TraceThread
+#endif
+
+
+/**
+ * @brief Get the number of ticks in a second.
+ */
+static uint32_t getTickHz() {
+#ifdef ESP_PLATFORM
+	return ets_get_cpu_frequency() * 1000000;
+#else
+	return 1000000;
+#endif
+} // getTickHz
+
+
+/**
+ * @brief Get the current time in ticks.
+ *
+ * On the ESP32 this is the cycle count of the calling core.
+ */
+static inline uint32_t getTicks() {
+#ifdef ESP_PLATFORM
+	return xthal_get_ccount();
+#else
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_startTime).count();
+#endif
+} // getTicks
+
+
+/**
+ * @brief Append an event to a buffer.
+ *
+ * @param [in] pBuffer The buffer, of which the caller is the only producer.
+ * @param [in] words The event.
+ * @param [in] count The length of the event in words.
+ * @return False if there was no room for the event.
+ */
+static bool put(trace_buffer_t* pBuffer, const uint32_t* words, uint32_t count) {
+	uint32_t head       = pBuffer->head;
+	uint32_t tail       = __atomic_load_n(&pBuffer->tail, __ATOMIC_ACQUIRE);
+	uint32_t size       = pBuffer->mask + 1;
+	uint32_t contiguous = size - (head & pBuffer->mask);
+	uint32_t needed     = contiguous < count ? contiguous + count : count;
+	if (needed > size - (head - tail)) {
+		return false;
+	}
+	if (contiguous < count) {
+		pBuffer->data[head & pBuffer->mask] = TRACE_PAD;
+		head += contiguous;
+	}
+	memcpy(&pBuffer->data[head & pBuffer->mask], words, count * sizeof(uint32_t));
+	__atomic_store_n(&pBuffer->head, head + count, __ATOMIC_RELEASE);
+	return true;
+} // put
+
+
+/**
+ * @brief Register a format string.
+ *
+ * Each use of TRACE() registers its format once, the first time it is reached.
+ *
+ * @param [in] format The format string, which must live for as long as the program.
+ * @return The id of the format, or 0 if the table of formats is full.
+ */
+uint16_t Trace::addFormat(const char* format) {
+	uint16_t id = 0;
+	TRACE_LOCK();
+	if (s_formatCount < MAX_FORMATS) {
+		s_formats[s_formatCount++] = format;
+		id = s_formatCount;
+	}
+	TRACE_UNLOCK();
+	return id;
+} // addFormat
+
+
+/**
+ * @brief Write the events recorded since the last dump, and then discard them.
+ *
+ * Only the formats registered since the last dump are written, so the dumps must be decoded in
+ * order by one TraceDecoder.  Only one task may dump at a time.
+ *
+ * @param [in] pSink The sink to write the dump to.
+ * @return False if the sink failed.
+ */
+bool Trace::dump(JsonSink* pSink) {
+	// Take the heads before the formats, so that every event dumped has its format dumped too.
+	uint32_t heads[MAX_BUFFERS];
+	for (int i = 0; i < MAX_BUFFERS; i++) {
+		heads[i] = __atomic_load_n(&s_buffers[i].head, __ATOMIC_ACQUIRE);
+	}
+	TRACE_LOCK();
+	uint32_t formatCount = s_formatCount;
+	TRACE_UNLOCK();
+
+	uint32_t header[3] = { TRACE_MAGIC, getTickHz(), getDropped() };
+	bool ok = pSink->write((const uint8_t*)header, sizeof(header));
+	for (; s_formatsSent < formatCount && ok; s_formatsSent++) {
+		uint32_t length = strlen(s_formats[s_formatsSent]);
+		uint32_t item[3] = { TRACE_FORMAT, s_formatsSent + 1, length };
+		uint32_t zero = 0;
+		ok = pSink->write((const uint8_t*)item, sizeof(item)) &&
+			pSink->write((const uint8_t*)s_formats[s_formatsSent], length) &&
+			pSink->write((const uint8_t*)&zero, (4 - length % 4) % 4);
+	}
+
+	for (int i = 0; i < MAX_BUFFERS && ok; i++) {
+		trace_buffer_t* pBuffer = &s_buffers[i];
+		uint32_t head = heads[i];
+		uint32_t tail = pBuffer->tail;
+		if (pBuffer->data == nullptr || head == tail) {
+			continue;
+		}
+		uint32_t size = pBuffer->mask + 1;
+		uint32_t count = 0;
+		for (uint32_t index = tail; index != head;) {
+			uint32_t word = pBuffer->data[index & pBuffer->mask];
+			if (word == TRACE_PAD) {
+				index += size - (index & pBuffer->mask);
+			} else {
+				count += (word >> 8) & 0xff;
+				index += (word >> 8) & 0xff;
+			}
+		}
+		uint32_t item[3] = { TRACE_EVENTS, (uint32_t)i, count };
+		ok = pSink->write((const uint8_t*)item, sizeof(item));
+
+		// Write the events in runs, broken at the padding and the end of the buffer.
+		uint32_t start = tail;
+		for (uint32_t index = tail; ok;) {
+			bool atEnd = index == head;
+			bool atPad = !atEnd && pBuffer->data[index & pBuffer->mask] == TRACE_PAD;
+			bool atWrap = index != start && (index & pBuffer->mask) == 0;
+			if (atEnd || atPad || atWrap) {
+				if (index != start) {
+					ok = pSink->write((const uint8_t*)&pBuffer->data[start & pBuffer->mask], (index - start) * sizeof(uint32_t));
+				}
+				if (atEnd) {
+					break;
+				}
+				if (atPad) {
+					index += size - (index & pBuffer->mask);
+				}
+				start = index;
+				continue;
+			}
+			index += (pBuffer->data[index & pBuffer->mask] >> 8) & 0xff;
+		}
+		__atomic_store_n(&pBuffer->tail, head, __ATOMIC_RELEASE);
+	}
+	return ok;
+} // dump
+
+
+/**
+ * @brief Get the number of events dropped because a buffer was full.
+ */
+uint32_t Trace::getDropped() {
+	uint32_t dropped = 0;
+	for (int i = 0; i < MAX_BUFFERS; i++) {
+		dropped += s_buffers[i].dropped;
+	}
+	return dropped;
+} // getDropped
+
+
+/**
+ * @brief Allocate the buffers and start recording events.
+ *
+ * @param [in] bufferSize The size in bytes of each buffer, rounded up to a power of 2.  On the
+ * ESP32 there is one buffer for each core and on a host one for each of up to MAX_BUFFERS threads.
+ * @return False if the buffers could not be allocated.
+ */
+bool Trace::start(size_t bufferSize) {
+	uint32_t words = 128;
+	while (words * sizeof(uint32_t) < bufferSize) {
+		words *= 2;
+	}
+	for (int i = 0; i < MAX_BUFFERS; i++) {
+		if (s_buffers[i].data != nullptr) {
+			continue;
+		}
+		s_buffers[i].data = (uint32_t*)malloc(words * sizeof(uint32_t));
+		if (s_buffers[i].data == nullptr) {
+#ifdef ESP_PLATFORM
+			ESP_LOGE(LOG_TAG, "Unable to allocate %d byte trace buffer", (int)(words * sizeof(uint32_t)));
+#endif
+			return false;
+		}
+		s_buffers[i].mask = words - 1;
+	}
+	m_enabled = true;
+	return true;
+} // start
+
+
+/**
+ * @brief Stop recording events.
+ *
+ * The events already recorded are kept for dump().
+ */
+void Trace::stop() {
+	m_enabled = false;
+} // stop
+
+
+/**
+ * @brief Add an event to the buffer of the calling core or thread.
+ *
+ * Normally called through the TRACE() macro.
+ *
+ * @param [in] words The event, of which the time is filled in here.
+ * @param [in] count The length of the event in words.
+ */
+void Trace::write(uint32_t* words, size_t count) {
+#ifdef ESP_PLATFORM
+	// Masking interrupts makes this the only producer for the buffer of this core.
+	unsigned state = portENTER_CRITICAL_NESTED();
+	trace_buffer_t* pBuffer = &s_buffers[xPortGetCoreID()];
+#else
+	static thread_local TraceThread thread;
+	trace_buffer_t* pBuffer = thread.m_pBuffer;
+#endif
+	if (pBuffer != nullptr && pBuffer->data != nullptr) {
+		words[1] = getTicks();
+		if (!put(pBuffer, words, count)) {
+			pBuffer->dropped++;
+		}
+	}
+#ifdef ESP_PLATFORM
+	portEXIT_CRITICAL_NESTED(state);
+#endif
+} // write
+
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief The body of the log task: dump, decode and print the events.
+ */
+static void traceLogTask(void* data) {
+	uint32_t intervalMs = (uintptr_t)data;
+	TraceTextHandler handler(stdout);
+	TraceDecoder decoder(&handler);
+	std::string dumped;
+	while (1) {
+		vTaskDelay(intervalMs / portTICK_PERIOD_MS);
+		dumped.clear();
+		JsonStringSink sink(&dumped);
+		Trace::dump(&sink);
+		if (!decoder.decode(dumped)) {
+			ESP_LOGE(LOG_TAG, "Unable to decode trace: %s", decoder.getError().c_str());
+		}
+	}
+} // traceLogTask
+
+
+/**
+ * @brief Start a low priority task that periodically prints the events recorded.
+ *
+ * @param [in] intervalMs The time between printing the events.
+ */
+void Trace::startLogTask(uint32_t intervalMs) {
+	::xTaskCreate(&traceLogTask, "traceLogTask", 4096, (void*)(uintptr_t)intervalMs, tskIDLE_PRIORITY + 1, nullptr);
+} // startLogTask
+#endif
+
+
+TraceDecoder::TraceDecoder(TraceHandler* pHandler) {
+	m_pHandler = pHandler;
+	m_tickHz   = 1000000;
+	m_error    = nullptr;
+} // TraceDecoder
+
+
+/**
+ * @brief Decode a dump, passing each event to the handler.
+ *
+ * @param [in] data The dump.
+ * @param [in] length The length of the dump in bytes.
+ * @return False if the dump is not valid.
+ */
+bool TraceDecoder::decode(const uint8_t* data, size_t length) {
+	if (length % 4 != 0) {
+		return fail("Length is not a whole number of words");
+	}
+	std::vector<uint32_t> copy(length / 4);   // The data need not be aligned.
+	memcpy(copy.data(), data, length);
+	const uint32_t* words = copy.data();
+	size_t count = copy.size();
+	size_t index = 0;
+	while (index < count) {
+		uint32_t tag = words[index];
+		if (tag == TRACE_MAGIC) {
+			if (count - index < 3) {
+				return fail("Truncated header");
+			}
+			m_tickHz = words[index + 1];
+			index += 3;
+		} else if (tag == TRACE_FORMAT) {
+			if (count - index < 3 || (count - index - 3) * 4 < words[index + 2]) {
+				return fail("Truncated format");
+			}
+			uint32_t id = words[index + 1];
+			if (id == 0 || id > Trace::MAX_FORMATS) {
+				return fail("Bad format id");
+			}
+			if (m_formats.size() < id) {
+				m_formats.resize(id);
+			}
+			m_formats[id - 1].assign((const char*)&words[index + 3], words[index + 2]);
+			index += 3 + (words[index + 2] + 3) / 4;
+		} else if (tag == TRACE_EVENTS) {
+			if (count - index < 3 || count - index - 3 < words[index + 2]) {
+				return fail("Truncated events");
+			}
+			uint32_t buffer = words[index + 1];
+			if (buffer >= m_ticks.size()) {
+				m_ticks.resize(buffer + 1);
+			}
+			size_t end = index + 3 + words[index + 2];
+			index += 3;
+			while (index < end) {
+				uint32_t header = words[index];
+				uint32_t id     = header >> 16;
+				uint32_t size   = (header >> 8) & 0xff;
+				uint32_t nargs  = header & 0xf;
+				if (size < 2 || size > end - index || (nargs > 0 && size < 3)) {
+					return fail("Bad event");
+				}
+				// Extend the time to 64 bits, assuming less than one wrap between events.
+				uint64_t ticks = (m_ticks[buffer] & ~(uint64_t)0xffffffff) | words[index + 1];
+				if (ticks < m_ticks[buffer]) {
+					ticks += (uint64_t)1 << 32;
+				}
+				m_ticks[buffer] = ticks;
+				std::string text;
+				if (id == 0 || id > m_formats.size()) {
+					text = "<unknown format>";
+				} else if (nargs == 0) {
+					text = format(m_formats[id - 1].c_str(), nullptr, 0, 0, 0);
+				} else {
+					text = format(m_formats[id - 1].c_str(), &words[index + 3], size - 3, nargs, words[index + 2]);
+				}
+				m_pHandler->onEvent(buffer, (double)ticks * 1000000 / m_tickHz, (Trace::kind_t)((header >> 4) & 0xf), text);
+				index += size;
+			}
+		} else {
+			return fail("Unknown item");
+		}
+	}
+	return true;
+} // decode
+
+
+bool TraceDecoder::decode(const std::string& data) {
+	return decode((const uint8_t*)data.data(), data.length());
+} // decode
+
+
+/**
+ * @brief Record the reason decoding failed.
+ */
+bool TraceDecoder::fail(const char* error) {
+	m_error = error;
+	return false;
+} // fail
+
+
+/**
+ * @brief Format an event as printf() would have.
+ *
+ * Each conversion takes the next argument as recorded, whatever its length modifier says, so
+ * "%ld" and "%d" both print an INT32.  A "*" width or precision is not supported.
+ */
+std::string TraceDecoder::format(const char* format, const uint32_t* args, size_t count, uint32_t nargs, uint32_t types) {
+	std::string text;
+	char buffer[Trace::MAX_STRING + 64];
+	size_t position = 0;
+	uint32_t arg = 0;
+	const char* p = format;
+	while (*p != 0) {
+		if (*p != '%') {
+			text += *p++;
+			continue;
+		}
+		if (p[1] == '%') {
+			text += '%';
+			p += 2;
+			continue;
+		}
+		std::string spec = "%";
+		p++;
+		while (*p != 0 && strchr("-+ #0123456789.", *p) != nullptr) {
+			spec += *p++;
+		}
+		while (*p != 0 && strchr("hlLqjzt", *p) != nullptr) {
+			p++;
+		}
+		if (*p == 0) {
+			break;
+		}
+		char conversion = *p++;
+		if (spec.length() > 24 || arg >= nargs) {
+			text += "<?>";
+			continue;
+		}
+		uint32_t type = (types >> (arg++ * 2)) & 3;
+		size_t needed = type == Trace::ARG_INT32 ? 1 : 2;
+		if (position + needed > count) {
+			text += "<?>";
+			continue;
+		}
+		bool isFloat = strchr("feEgGaA", conversion) != nullptr;
+		bool isSigned = conversion == 'd' || conversion == 'i';
+		switch (type) {
+			case Trace::ARG_INT32: {
+				uint32_t value = args[position++];
+				if (isFloat) {
+					snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), isSigned ? (double)(int32_t)value : (double)value);
+				} else if (conversion == 's') {
+					snprintf(buffer, sizeof(buffer), (spec + "d").c_str(), (int32_t)value);
+				} else if (conversion == 'p') {
+					snprintf(buffer, sizeof(buffer), "0x%08x", value);
+				} else {
+					snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), value);
+				}
+				break;
+			}
+			case Trace::ARG_INT64: {
+				uint64_t value = args[position] | ((uint64_t)args[position + 1] << 32);
+				position += 2;
+				if (isFloat) {
+					snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), isSigned ? (double)(int64_t)value : (double)value);
+				} else if (conversion == 's') {
+					snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), (long long)value);
+				} else if (conversion == 'p') {
+					snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long)value);
+				} else if (conversion == 'c') {
+					snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (int)value);
+				} else {
+					snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), (unsigned long long)value);
+				}
+				break;
+			}
+			case Trace::ARG_DOUBLE: {
+				uint64_t bits = args[position] | ((uint64_t)args[position + 1] << 32);
+				position += 2;
+				double value;
+				memcpy(&value, &bits, sizeof(value));
+				snprintf(buffer, sizeof(buffer), (spec + (isFloat ? conversion : 'g')).c_str(), value);
+				break;
+			}
+			default: {
+				uint32_t length = args[position++];
+				if (length > Trace::MAX_STRING || position + (length + 3) / 4 > count) {
+					text += "<?>";
+					position = count;
+					continue;
+				}
+				char value[Trace::MAX_STRING + 1];
+				memcpy(value, &args[position], length);
+				value[length] = 0;
+				position += (length + 3) / 4;
+				snprintf(buffer, sizeof(buffer), (spec + "s").c_str(), value);
+				break;
+			}
+		}
+		text += buffer;
+	}
+	return text;
+} // format
+
+
+/**
+ * @brief Get the reason the last decode() failed.
+ */
+std::string TraceDecoder::getError() {
+	return m_error == nullptr ? "" : m_error;
+} // getError
+
+
+TraceTextHandler::TraceTextHandler(std::string* pText) {
+	m_pText = pText;
+	m_pFile = nullptr;
+} // TraceTextHandler
+
+
+TraceTextHandler::TraceTextHandler(FILE* pFile) {
+	m_pText = nullptr;
+	m_pFile = pFile;
+} // TraceTextHandler
+
+
+void TraceTextHandler::onEvent(int buffer, double timeUs, Trace::kind_t kind, const std::string& text) {
+	char line[Trace::MAX_STRING + 256];
+	const char* marker = kind == Trace::KIND_BEGIN ? "> " : kind == Trace::KIND_END ? "< " : "";
+	int length = snprintf(line, sizeof(line), "[%14.3f] %d: %s", timeUs, buffer, marker);
+	if (m_pText != nullptr) {
+		m_pText->append(line, length);
+		m_pText->append(text);
+		*m_pText += '\n';
+	} else {
+		fprintf(m_pFile, "%s%s\n", line, text.c_str());
+	}
+} // onEvent
+
+
+TraceChromeHandler::TraceChromeHandler(FILE* pFile) {
+	m_pFile = pFile;
+	m_first = true;
+} // TraceChromeHandler
+
+
+/**
+ * @brief Complete the document.  Must be called after the last event has been decoded.
+ */
+void TraceChromeHandler::finish() {
+	if (m_first) {
+		fprintf(m_pFile, "{\"traceEvents\":[");
+	}
+	fprintf(m_pFile, "]}\n");
+} // finish
+
+
+void TraceChromeHandler::onEvent(int buffer, double timeUs, Trace::kind_t kind, const std::string& text) {
+	fprintf(m_pFile, m_first ? "{\"traceEvents\":[\n" : ",\n");
+	m_first = false;
+	std::string name;
+	for (char c: text) {
+		if (c == '"' || c == '\\') {
+			name += '\\';
+			name += c;
+		} else if ((uint8_t)c < 0x20) {
+			char escape[8];
+			sprintf(escape, "\\u%04x", c);
+			name += escape;
+		} else {
+			name += c;
+		}
+	}
+	const char* phase = kind == Trace::KIND_BEGIN ? "B" : kind == Trace::KIND_END ? "E" : "i";
+	fprintf(m_pFile, "{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":0,\"tid\":%d%s}",
+		name.c_str(), phase, timeUs, buffer, kind == Trace::KIND_INSTANT ? ",\"s\":\"t\"" : "");
+} // onEvent
@@ -0,0 +1,287 @@
+/*
+ * Trace.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TRACE_H_
+#define COMPONENTS_CPP_UTILS_TRACE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class JsonSink;
+
+/**
+ * @brief Deferred binary logging.
+ *
+ * A trace event records only the identity of its format string and its raw arguments, in a
+ * ring buffer for the core (or on a host, the thread) that logged it.  Nothing is formatted
+ * when the event happens: the buffers are drained by dump() and the events turned into text
+ * later, either by a low priority task on the device (startLogTask()) or on a host by
+ * TraceDecoder from a dump that was saved or sent over the network.  Recording an event costs
+ * a few tens of nanoseconds, where ESP_LOGD() costs a full printf().
+ *
+ * @code{.cpp}
+ * Trace::start();
+ * Trace::startLogTask();
+ * ...
+ * TRACE("Pixel value: %x", currentPixel);
+ * TRACE("Received %d bytes from %s", length, "uart");
+ * @endcode
+ *
+ * Arguments may be integers, pointers, floating point numbers and strings.  Strings are copied
+ * into the event, up to MAX_STRING characters, so a string argument need not outlive the call.
+ * The format string must be a literal, or otherwise live for as long as the program.
+ *
+ * When a buffer is full, new events are dropped and counted rather than overwriting those not
+ * yet dumped.
+ */
+class Trace {
+public:
+	typedef enum {
+		KIND_INSTANT = 0,
+		KIND_BEGIN   = 1,
+		KIND_END     = 2
+	} kind_t;
+
+	typedef enum {
+		ARG_INT32  = 0,
+		ARG_INT64  = 1,
+		ARG_DOUBLE = 2,
+		ARG_STRING = 3
+	} arg_t;
+
+	static const int MAX_ARGS    = 8;
+	static const int MAX_STRING  = 32;
+	static const int MAX_FORMATS = 1024;
+	static const int MAX_WORDS   = 3 + MAX_ARGS * (1 + MAX_STRING / 4);
+#ifdef ESP_PLATFORM
+	static const int MAX_BUFFERS = 2;   // One per core.
+#else
+	static const int MAX_BUFFERS = 16;  // One per thread.
+#endif
+
+	static uint16_t addFormat(const char* format);
+	static bool     dump(JsonSink* pSink);
+	static uint32_t getDropped();
+	static bool     start(size_t bufferSize = 4096);
+	static void     stop();
+#ifdef ESP_PLATFORM
+	static void     startLogTask(uint32_t intervalMs = 1000);
+#endif
+	static void     write(uint32_t* words, size_t count);
+
+	/**
+	 * @brief Record an event.
+	 *
+	 * Normally called through the TRACE() macro.
+	 *
+	 * @param [in] id The id of the event's format string, from addFormat().
+	 * @param [in] kind The kind of the event.
+	 * @param [in] args The arguments of the event.
+	 */
+	template<typename... Args>
+	static void record(uint16_t id, kind_t kind, Args... args) {
+		static_assert(sizeof...(Args) <= MAX_ARGS, "Too many trace arguments");
+		if (id == 0) {
+			return;
+		}
+		uint32_t words[3 + sizeof...(Args) * (1 + MAX_STRING / 4)];
+		Encoder encoder(words);
+		int dummy[] = {0, (encoder.put(args), 0)...};
+		(void)dummy;
+		words[0] = ((uint32_t)id << 16) | (encoder.m_count << 8) | (kind << 4) | sizeof...(Args);
+		if (sizeof...(Args) > 0) {
+			words[2] = encoder.m_types;
+		}
+		write(words, encoder.m_count);
+	} // record
+
+	static volatile bool m_enabled;
+
+private:
+	/**
+	 * @brief Pack the arguments of an event after its header words.
+	 */
+	class Encoder {
+	public:
+		Encoder(uint32_t* words) : m_words(words), m_types(0), m_count(3), m_arg(0) {}
+
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type put(T value) {
+			if (sizeof(T) <= 4) {
+				putInt32((uint32_t)value);
+			} else {
+				putInt64((uint64_t)value);
+			}
+		}
+		template<typename T>
+		typename std::enable_if<std::is_floating_point<T>::value>::type put(T value) {
+			double d = value;
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			m_words[m_count++] = (uint32_t)bits;
+			m_words[m_count++] = (uint32_t)(bits >> 32);
+			m_types |= ARG_DOUBLE << (m_arg++ * 2);
+		}
+		void put(const char* value) {
+			size_t length = 0;
+			while (value != nullptr && length < MAX_STRING && value[length] != 0) {
+				length++;
+			}
+			m_words[m_count++] = length;
+			if (length % 4 != 0) {
+				m_words[m_count + length / 4] = 0;
+			}
+			memcpy(&m_words[m_count], value, length);
+			m_count += (length + 3) / 4;
+			m_types |= ARG_STRING << (m_arg++ * 2);
+		}
+		void put(char* value) {
+			put((const char*)value);
+		}
+		void put(const std::string& value) {
+			put(value.c_str());
+		}
+		template<typename T>
+		void put(T* value) {
+			put((uintptr_t)value);
+		}
+
+		uint32_t* m_words;
+		uint32_t  m_types;
+		uint32_t  m_count;
+		int       m_arg;
+
+	private:
+		void putInt32(uint32_t value) {
+			m_words[m_count++] = value;
+			m_types |= ARG_INT32 << (m_arg++ * 2);
+		}
+		void putInt64(uint64_t value) {
+			m_words[m_count++] = (uint32_t)value;
+			m_words[m_count++] = (uint32_t)(value >> 32);
+			m_types |= ARG_INT64 << (m_arg++ * 2);
+		}
+	}; // Encoder
+}; // Trace
+
+
+/**
+ * @brief Record a begin event when constructed and the matching end event when destroyed.
+ *
+ * In the Chrome trace view the pair shows as a slice covering the scope.  Normally declared
+ * through TRACE_SCOPE().
+ */
+class TraceScope {
+public:
+	TraceScope(uint16_t id) {
+		m_id = Trace::m_enabled ? id : 0;
+		Trace::record(m_id, Trace::KIND_BEGIN);
+	}
+	~TraceScope() {
+		Trace::record(m_id, Trace::KIND_END);
+	}
+private:
+	uint16_t m_id;
+}; // TraceScope
+
+
+/**
+ * @brief Receive the events decoded by a TraceDecoder.
+ */
+class TraceHandler {
+public:
+	virtual ~TraceHandler() {};
+	/**
+	 * @brief Called once for each event.
+	 *
+	 * @param [in] buffer The buffer the event was recorded in: the core, or on a host the thread.
+	 * @param [in] timeUs The time of the event in microseconds.
+	 * @param [in] kind The kind of the event.
+	 * @param [in] text The formatted text of the event.
+	 */
+	virtual void onEvent(int buffer, double timeUs, Trace::kind_t kind, const std::string& text) = 0;
+}; // TraceHandler
+
+
+/**
+ * @brief Decode the dumps written by Trace::dump().
+ *
+ * The formats are carried in the dumps, so a sequence of dumps from one run must be decoded in
+ * order by the same decoder.
+ */
+class TraceDecoder {
+public:
+	TraceDecoder(TraceHandler* pHandler);
+	bool        decode(const uint8_t* data, size_t length);
+	bool        decode(const std::string& data);
+	std::string getError();
+
+private:
+	bool        fail(const char* error);
+	std::string format(const char* format, const uint32_t* args, size_t count, uint32_t nargs, uint32_t types);
+
+	TraceHandler*            m_pHandler;
+	std::vector<std::string> m_formats;
+	uint32_t                 m_tickHz;
+	std::vector<uint64_t>    m_ticks;   // The last time of each buffer, extended to 64 bits.
+	const char*              m_error;
+}; // TraceDecoder
+
+
+/**
+ * @brief Write decoded events as lines of text, to a string or a file.
+ */
+class TraceTextHandler: public TraceHandler {
+public:
+	TraceTextHandler(std::string* pText);
+	TraceTextHandler(FILE* pFile);
+	void onEvent(int buffer, double timeUs, Trace::kind_t kind, const std::string& text) override;
+private:
+	std::string* m_pText;
+	FILE*        m_pFile;
+}; // TraceTextHandler
+
+
+/**
+ * @brief Write decoded events in the Chrome trace event format, for chrome://tracing or Perfetto.
+ *
+ * Instant events are written as instants, and the events of a TraceScope as a slice.  Each
+ * core or thread is shown as a thread of its own.
+ */
+class TraceChromeHandler: public TraceHandler {
+public:
+	TraceChromeHandler(FILE* pFile);
+	void finish();
+	void onEvent(int buffer, double timeUs, Trace::kind_t kind, const std::string& text) override;
+private:
+	FILE* m_pFile;
+	bool  m_first;
+}; // TraceChromeHandler
+
+
+/**
+ * @brief Record an event with a printf style format string and its arguments.
+ */
+#define TRACE(_FORMAT, ...) do { \
+		if (Trace::m_enabled) { \
+			static const uint16_t _traceId = Trace::addFormat(_FORMAT); \
+			Trace::record(_traceId, Trace::KIND_INSTANT, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/**
+ * @brief Record the time spent in the rest of the enclosing scope.
+ */
+#define TRACE_SCOPE(_NAME) \
+	static const uint16_t _traceScopeId = Trace::addFormat(_NAME); \
+	TraceScope _traceScope(_traceScopeId)
+
+#endif /* COMPONENTS_CPP_UTILS_TRACE_H_ */
@@ -8,6 +8,7 @@
 
 #include "GPIO.h"
 #include "sdkconfig.h"
+#include "Trace.h"
 #include "WS2812.h"
 
 static char tag[] = "WS2812";
@@ -153,7 +154,7 @@ void WS2812::show() {
 				(getChannelValueByType(this->colorOrder[1], this->pixels[i]) << 8)  |
 				(getChannelValueByType(this->colorOrder[2], this->pixels[i]));
 
-		ESP_LOGD(tag, "Pixel value: %x", currentPixel);
+		TRACE("Pixel value: %x", currentPixel);
 		for (int j=23; j>=0; j--) {
 			// We have 24 bits of data representing the red, green amd blue channels. The value of the
 			// 24 bits to output is in the variable current_pixel.  We now need to stream this value
@@ -13,6 +13,7 @@
 #ifdef CONFIG_MONGOOSE_PRESENT
 #define MG_ENABLE_HTTP_STREAMING_MULTIPART 1
 #define MG_ENABLE_FILESYSTEM 1
+#include "Trace.h"
 #include "WebServer.h"
 #include <esp_log.h>
 #include <mongoose.h>
@@ -33,7 +34,7 @@ struct WebServerUserData {
  * @param [in] event The received event type.
  * @return The string representation of the event.
  */
-static std::string mongoose_eventToString(int event) {
+static const char* mongoose_eventToString(int event) {
 	switch (event) {
 	case MG_EV_CONNECT:
 		return "MG_EV_CONNECT";
@@ -102,9 +103,7 @@ static std::string mongoose_eventToString(int event) {
 	case MG_EV_WEBSOCKET_CONTROL_FRAME:
 		return "MG_EV_WEBSOCKET_CONTROL_FRAME";
 	}
-	std::ostringstream s;
-	s << "Unknown event: " << event;
-	return s.str();
+	return "Unknown event";
 } //eventToString
 
 /**
@@ -147,7 +146,7 @@ static void mongoose_event_handler_web_server(
 	if (event == MG_EV_POLL) {
 		return;
 	}
-	ESP_LOGD(tag, "Event: %s [%d]", mongoose_eventToString(event).c_str(), mgConnection->sock);
+	TRACE("Event: %s (%d) [%d]", mongoose_eventToString(event), event, mgConnection->sock);
 	switch (event) {
 		case MG_EV_HTTP_REQUEST: {
 			struct http_message *message = (struct http_message *) eventData;
@@ -411,6 +410,7 @@ WebServer::HTTPResponse::HTTPResponse(struct mg_connection* nc) {
 	m_nc = nc;
 	m_status = 200;
 	m_dataSent = false;
+	m_chunked = false;
 } // HTTPResponse
 
 
@@ -449,6 +449,45 @@ void WebServer::HTTPResponse::sendData(uint8_t *pData, size_t length) {
 	}
 	m_dataSent = true;
 
+	sendHead(length);
+	mg_send(m_nc, pData, length);
+	m_nc->flags |= MG_F_SEND_AND_CLOSE;
+} // sendData
+
+
+/**
+ * @brief Send part of the response body to the HTTP caller.
+ *
+ * The first call sends the headers with chunked transfer encoding, so the length of the body
+ * need not be known in advance.  A call with a length of 0 ends the response.  sendData()
+ * cannot be used on the same response.
+ *
+ * @param [in] pData The data to be sent to the HTTP caller.
+ * @param [in] length The length of the data to be sent, or 0 to end the response.
+ * @return N/A.
+ */
+void WebServer::HTTPResponse::sendChunk(const uint8_t *pData, size_t length) {
+	if (m_dataSent && !m_chunked) {
+		ESP_LOGE(tag, "HTTPResponse: Data already sent!  Attempt to send again/more.");
+		return;
+	}
+	if (!m_dataSent) {
+		m_dataSent = true;
+		m_chunked = true;
+		sendHead(-1); // A length of -1 makes mongoose use chunked encoding.
+	}
+	mg_send_http_chunk(m_nc, pData != nullptr ? (const char *)pData : "", length);
+	if (length == 0) {
+		m_nc->flags |= MG_F_SEND_AND_CLOSE;
+	}
+} // sendChunk
+
+
+/**
+ * @brief Send the status line and headers.
+ * @param [in] length The length of the body, or -1 for chunked transfer encoding.
+ */
+void WebServer::HTTPResponse::sendHead(int64_t length) {
 	std::map<std::string, std::string>::iterator iter;
 	std::string headers;
 
@@ -460,9 +499,7 @@ void WebServer::HTTPResponse::sendData(uint8_t *pData, size_t length) {
 		}
 	}
 	mg_send_head(m_nc, m_status, length, headers.c_str());
-	mg_send(m_nc, pData, length);
-	m_nc->flags |= MG_F_SEND_AND_CLOSE;
-} // sendData
+} // sendHead
 
 
 /**
@@ -844,4 +881,20 @@ void WebServer::WebSocketHandler::close() {
 
 
 
+JsonHTTPResponseSink::JsonHTTPResponseSink(WebServer::HTTPResponse *pResponse) {
+	m_pResponse = pResponse;
+} // JsonHTTPResponseSink
+
+
+bool JsonHTTPResponseSink::write(const uint8_t *data, size_t length) {
+	m_pResponse->sendChunk(data, length);
+	return true;
+} // write
+
+
+void JsonHTTPResponseSink::finish() {
+	m_pResponse->sendChunk(nullptr, 0);
+} // finish
+
+
 #endif // CONFIG_MONGOOSE_PRESENT
@@ -14,6 +14,7 @@
 #include "sdkconfig.h"
 #ifdef CONFIG_MONGOOSE_PRESENT
 #include <mongoose.h>
+#include "JSONWriter.h"
 
 
 
@@ -53,13 +54,16 @@ public:
 			void setHeaders(std::map<std::string, std::string>  headers);
 			void sendData(std::string data);
 			void sendData(uint8_t *pData, size_t length);
+			void sendChunk(const uint8_t *pData, size_t length);
 			void setRootPath(std::string path);
 		private:
+			void sendHead(int64_t length);
 			struct mg_connection *m_nc;
 			std::string m_rootPath;
 			int m_status;
 			std::map<std::string, std::string> m_headers;
 			bool m_dataSent;
+			bool m_chunked;
 	}; // HTTPResponse
 
 	/**
@@ -190,5 +194,23 @@ private:
 	std::vector<PathHandler> m_pathHandlers;
 };
 
+/**
+ * @brief A JsonWriter sink that streams the body of an HTTP response.
+ *
+ * The response is sent with chunked transfer encoding, so its length need not be known in
+ * advance.  JsonWriter::finish() ends the response.  Mongoose only sends the chunks once the
+ * request handler has returned and holds them in the connection's send buffer until then, so
+ * the whole document is in memory at once.  The writer saves building a std::string of it
+ * first, but a response must still fit in the heap.
+ */
+class JsonHTTPResponseSink: public JsonSink {
+public:
+	JsonHTTPResponseSink(WebServer::HTTPResponse *pResponse);
+	bool write(const uint8_t *data, size_t length) override;
+	void finish() override;
+private:
+	WebServer::HTTPResponse *m_pResponse;
+}; // JsonHTTPResponseSink
+
 #endif // CONFIG_MONGOOSE_PRESENT
 #endif /* CPP_UTILS_WEBSERVER_H_ */
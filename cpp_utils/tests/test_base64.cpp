@@ -0,0 +1,90 @@
+/*
+ * Measure the throughput of the base64 codec, whole strings and streamed in blocks.
+ */
+#include <algorithm>
+#include <esp_log.h>
+#include <FreeRTOS.h>
+#include <GeneralUtils.h>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Task.h>
+
+#include "sdkconfig.h"
+
+static char tag[] = "test_base64";
+
+extern "C" {
+	void app_main(void);
+}
+
+static const int SIZE       = 48 * 1024;
+static const int ITERATIONS = 20;
+
+
+static void report(const char* name, uint32_t ms) {
+	// Bytes per millisecond is KB/s.
+	printf("  %-22s %5d ms, %6d KB/s\n", name, ms, ms == 0 ? 0 : (int)((uint64_t)SIZE * ITERATIONS / ms));
+}
+
+
+class Base64TestTask: public Task {
+	void run(void *data) {
+		ESP_LOGD(tag, "Measuring base64 ...");
+		std::string raw;
+		for (int i = 0; i < SIZE; i++) {
+			raw += (char)rand();
+		}
+		std::string encoded;
+		std::string decoded;
+
+		uint32_t start = FreeRTOS::getTimeSinceStart();
+		for (int i = 0; i < ITERATIONS; i++) {
+			GeneralUtils::base64Encode(raw, &encoded);
+		}
+		report("base64Encode", FreeRTOS::getTimeSinceStart() - start);
+
+		start = FreeRTOS::getTimeSinceStart();
+		bool ok = true;
+		for (int i = 0; i < ITERATIONS; i++) {
+			ok &= GeneralUtils::base64Decode(encoded, &decoded);
+		}
+		report("base64Decode", FreeRTOS::getTimeSinceStart() - start);
+		printf("  round trip: %s\n", ok && decoded == raw ? "ok" : "FAILED");
+
+		// Streamed 1KB at a time, as File::getContent(true) does.
+		char* text = (char*)malloc(Base64Encoder::getEncodedLength(1024) + 4);
+		start = FreeRTOS::getTimeSinceStart();
+		for (int i = 0; i < ITERATIONS; i++) {
+			Base64Encoder encoder;
+			for (int offset = 0; offset < SIZE; offset += 1024) {
+				encoder.encode((const uint8_t*)raw.data() + offset, 1024, text);
+			}
+			encoder.finish(text);
+		}
+		report("Base64Encoder, 1KB", FreeRTOS::getTimeSinceStart() - start);
+		free(text);
+
+		uint8_t* bytes = (uint8_t*)malloc(Base64Decoder::getDecodedLength(1024));
+		start = FreeRTOS::getTimeSinceStart();
+		for (int i = 0; i < ITERATIONS; i++) {
+			Base64Decoder decoder;
+			size_t length;
+			for (size_t offset = 0; offset < encoded.length(); offset += 1024) {
+				length = 0;
+				decoder.decode(encoded.data() + offset, std::min((size_t)1024, encoded.length() - offset), bytes, &length);
+			}
+			decoder.finish(bytes, &length);
+		}
+		report("Base64Decoder, 1KB", FreeRTOS::getTimeSinceStart() - start);
+		free(bytes);
+		printf("Tests done\n");
+	}
+};
+
+
+void app_main(void) {
+	Base64TestTask* pTask = new Base64TestTask();
+	pTask->setStackSize(8000);
+	pTask->start();
+}
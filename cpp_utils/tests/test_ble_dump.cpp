@@ -0,0 +1,95 @@
+/*
+ * Check that the BLEUtils dump helpers allocate nothing, for every GATT client, GATT server and
+ * GAP event, and time the name lookups they use.
+ *
+ * Build with the log level at Debug (CONFIG_LOG_DEFAULT_LEVEL_DEBUG), or the dump helpers return
+ * at once and the check proves nothing.
+ */
+#include <esp_log.h>
+#include <BLEAssignedNumbers.h>
+#include <BLEUtils.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Task.h>
+#include <xtensa/hal.h>
+
+#include "sdkconfig.h"
+
+static char tag[] = "test_ble_dump";
+
+extern "C" {
+	void app_main(void);
+}
+
+static const int ITERATIONS = 1000;
+
+static volatile uint32_t s_allocations = 0;   // Calls of operator new.
+
+void* operator new(size_t size) {
+	s_allocations++;
+	void* p = malloc(size);
+	if (p == nullptr) {
+		abort();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+
+class BLEDumpTestTask: public Task {
+	void run(void *data) {
+		ESP_LOGD(tag, "Dumping every event ...");
+		uint8_t value[100];
+		for (size_t i = 0; i < sizeof(value); i++) {
+			value[i] = i;
+		}
+
+		uint32_t before = s_allocations;
+		esp_ble_gattc_cb_param_t client;
+		for (int event = 0; event <= ESP_GATTC_UNREG_FOR_NOTIFY_EVT; event++) {
+			memset(&client, 0, sizeof(client));
+			client.get_char.srvc_id.id.uuid.len = ESP_UUID_LEN_128;
+			client.get_char.char_id.uuid.len = ESP_UUID_LEN_16;
+			client.get_char.char_id.uuid.uuid.uuid16 = 0x2a19;
+			if (event == ESP_GATTC_READ_CHAR_EVT) {
+				client.read.value     = value;
+				client.read.value_len = sizeof(value);
+			}
+			BLEUtils::dumpGattClientEvent((esp_gattc_cb_event_t)event, 3, &client);
+		}
+		esp_ble_gatts_cb_param_t server;
+		memset(&server, 0, sizeof(server));
+		for (int event = 0; event <= ESP_GATTS_SET_ATTR_VAL_EVT; event++) {
+			BLEUtils::dumpGattServerEvent((esp_gatts_cb_event_t)event, 3, &server);
+		}
+		esp_ble_gap_cb_param_t gap;
+		memset(&gap, 0, sizeof(gap));
+		for (int event = 0; event <= ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT; event++) {
+			BLEUtils::dumpGapEvent((esp_gap_ble_cb_event_t)event, &gap);
+		}
+		uint32_t allocations = s_allocations - before;
+		printf("Dump helpers: %d allocations %s\n", allocations, allocations == 0 ? "(pass)" : "(FAIL)");
+
+		volatile size_t length = 0;
+		uint32_t start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length += strlen(BLEAssignedNumbers::serviceName(0x1800 + (i & 0x1f)));
+			length += strlen(BLEAssignedNumbers::characteristicName(0x2a00 + (i & 0xff)));
+		}
+		printf("Name lookups: %d cycles a service and characteristic\n", (xthal_get_ccount() - start) / ITERATIONS);
+		(void)length;
+		printf("Tests done\n");
+	}
+};
+
+
+void app_main(void) {
+	BLEDumpTestTask* pTask = new BLEDumpTestTask();
+	pTask->setStackSize(8000);
+	pTask->start();
+}
@@ -0,0 +1,134 @@
+/*
+ * Measure the GeneralUtils formatting functions against the stringstream and sprintf code they
+ * replaced.
+ */
+#include <esp_log.h>
+#include <GeneralUtils.h>
+#include <iomanip>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <Task.h>
+#include <xtensa/hal.h>
+
+#include "sdkconfig.h"
+
+static char tag[] = "test_format";
+
+extern "C" {
+	void app_main(void);
+}
+
+static const int ITERATIONS = 1000;
+
+
+static std::string oldIpToString(uint8_t* ip) {
+	std::stringstream s;
+	s << (int)ip[0] << '.' << (int)ip[1] << '.' << (int)ip[2] << '.' << (int)ip[3];
+	return s.str();
+}
+
+static std::string oldAddressToString(uint8_t* address) {
+	std::stringstream stream;
+	for (int i = 0; i < 6; i++) {
+		stream << std::setfill('0') << std::setw(2) << std::hex << (int)address[i];
+		if (i < 5) {
+			stream << ':';
+		}
+	}
+	return stream.str();
+}
+
+static void oldHexRow(uint8_t* pData, uint32_t length, char* out) {
+	char ascii[80];
+	char hex[80];
+	char tempBuf[80];
+	strcpy(ascii, "");
+	strcpy(hex, "");
+	for (uint32_t index = 0; index < length; index++) {
+		sprintf(tempBuf, "%.2x ", pData[index]);
+		strcat(hex, tempBuf);
+		sprintf(tempBuf, "%c", isprint(pData[index]) ? pData[index] : '.');
+		strcat(ascii, tempBuf);
+	}
+	sprintf(out, "%s %s", hex, ascii);
+}
+
+
+static void report(const char* name, uint32_t oldCycles, uint32_t newCycles) {
+	printf("  %-14s old %6d cycles, new %6d cycles\n", name, oldCycles / ITERATIONS, newCycles / ITERATIONS);
+}
+
+
+class FormatTestTask: public Task {
+	void run(void *data) {
+		ESP_LOGD(tag, "Measuring formatting ...");
+		uint8_t bytes[16] = { 192, 168, 1, 100, 0x24, 0x0a, 0xc4, 0x01, 0x02, 'H', 'e', 'l', 'l', 'o', 0, 0xff };
+		char text[GeneralUtils::HEX_ROW_LENGTH];
+		volatile size_t length;
+
+		uint32_t start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = oldIpToString(bytes).length();
+		}
+		uint32_t oldCycles = xthal_get_ccount() - start;
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = GeneralUtils::formatIp(bytes, text);
+		}
+		report("IP address", oldCycles, xthal_get_ccount() - start);
+
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = oldAddressToString(bytes + 4).length();
+		}
+		oldCycles = xthal_get_ccount() - start;
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = GeneralUtils::formatMac(bytes + 4, text);
+		}
+		report("MAC address", oldCycles, xthal_get_ccount() - start);
+
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			oldHexRow(bytes, 16, text);
+		}
+		oldCycles = xthal_get_ccount() - start;
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = GeneralUtils::formatHexRow(bytes, 16, text);
+		}
+		report("Hex dump row", oldCycles, xthal_get_ccount() - start);
+
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = sprintf(text, "%d", i * 7919);
+		}
+		oldCycles = xthal_get_ccount() - start;
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = GeneralUtils::formatDecimal((int32_t)(i * 7919), text);
+		}
+		report("Decimal", oldCycles, xthal_get_ccount() - start);
+
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = sprintf(text, "%x", i * 7919);
+		}
+		oldCycles = xthal_get_ccount() - start;
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			length = GeneralUtils::formatHex(i * 7919, text);
+		}
+		report("Hex", oldCycles, xthal_get_ccount() - start);
+		(void)length;
+		printf("Tests done\n");
+	}
+};
+
+
+void app_main(void) {
+	FormatTestTask* pTask = new FormatTestTask();
+	pTask->setStackSize(8000);
+	pTask->start();
+}
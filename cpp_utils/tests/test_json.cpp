@@ -0,0 +1,327 @@
+/*
+ * Compare the JSON classes: heap used and time taken to parse and print a corpus of documents.
+ */
+#include <algorithm>
+#include <CBOR.h>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <FreeRTOS.h>
+#include <JSON.h>
+#include <JSONArena.h>
+#include <JSONParser.h>
+#include <JSONStruct.h>
+#include <JSONWriter.h>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <System.h>
+#include <Task.h>
+
+#include "sdkconfig.h"
+
+static char tag[] = "test_json";
+
+extern "C" {
+	void app_main(void);
+}
+
+static const int ITERATIONS = 20;
+
+
+/**
+ * A configuration document of about 20KB.
+ */
+static std::string makeConfig() {
+	std::string text = "{\"device\":{\"name\":\"gateway-01\",\"firmware\":\"1.4.2\"},\"wifi\":{\"ssid\":\"sweetie\",\"password\":\"secret\"},\"sensors\":[";
+	for (int i = 0; i < 150; i++) {
+		char item[160];
+		snprintf(item, sizeof(item), "%s{\"id\":%d,\"type\":\"temperature\",\"pin\":%d,\"interval\":%d,\"scale\":%.3f,\"enabled\":%s,\"label\":\"Sensor \\u00b0%d\"}",
+			i == 0 ? "" : ",", i, i % 40, 1000 + i, 0.125 * i, (i % 3) ? "true" : "false", i);
+		text += item;
+	}
+	return text + "],\"mqtt\":{\"host\":\"broker.local\",\"port\":1883,\"keepalive\":60}}";
+}
+
+
+/**
+ * An array of telemetry records, as returned by a REST history query.
+ */
+static std::string makeHistory() {
+	std::string text = "[";
+	for (int i = 0; i < 200; i++) {
+		char item[120];
+		snprintf(item, sizeof(item), "%s{\"t\":%d,\"temp\":%.2f,\"humidity\":%.1f,\"ok\":true}", i == 0 ? "" : ",", 1508140800 + i * 60, 21.5 + (i % 17) * 0.1, 40.0 + (i % 9));
+		text += item;
+	}
+	return text + "]";
+}
+
+
+/**
+ * Samples the free heap at every event, to find the low water mark during a parse.
+ */
+/**
+ * Counts and discards the output of a JsonWriter.
+ */
+class CountingSink: public JsonSink {
+public:
+	size_t m_total = 0;
+	bool write(const uint8_t* data, size_t length) override { m_total += length; return true; }
+};
+
+
+class HeapSampler: public JsonParserHandler {
+public:
+	uint32_t m_minFree = UINT32_MAX;
+	void sample() {
+		uint32_t free = System::getFreeHeapSize();
+		if (free < m_minFree) m_minFree = free;
+	}
+	void onEndObject() override { sample(); }
+	void onEndArray() override { sample(); }
+	void onNumber(double value, const char* text, size_t length) override { sample(); }
+};
+
+
+static void compare(const char* name, const std::string& text) {
+	// cJSON builds the whole tree, so the heap it holds after parsing is its peak.
+	uint32_t before = System::getFreeHeapSize();
+	cJSON* root = cJSON_Parse(text.c_str());
+	uint32_t cjsonHeap = before - System::getFreeHeapSize();
+	cJSON_Delete(root);
+
+	uint32_t start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		cJSON_Delete(cJSON_Parse(text.c_str()));
+	}
+	uint32_t cjsonMs = FreeRTOS::getTimeSinceStart() - start;
+
+	// The incremental parser, fed in 512 byte chunks as if from a socket.
+	HeapSampler sampler;
+	before = System::getFreeHeapSize();
+	sampler.m_minFree = before;
+	JsonParser* pParser = new JsonParser(&sampler);
+	for (size_t offset = 0; offset < text.length(); offset += 512) {
+		pParser->feed(text.data() + offset, std::min((size_t)512, text.length() - offset));
+	}
+	bool ok = pParser->end();
+	uint32_t parserHeap = before - sampler.m_minFree;
+	delete pParser;
+
+	JsonParserHandler nullHandler;
+	JsonParser parser(&nullHandler);
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		parser.parse(text);
+	}
+	uint32_t parserMs = FreeRTOS::getTimeSinceStart() - start;
+
+	// Pull out one field without a tree.
+	JsonPathExtractor extractor;
+	int field = extractor.addPath("sensors[3].interval");
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		extractor.reset();
+		extractor.getParser()->feed(text.data(), text.length());
+	}
+	uint32_t extractorMs = FreeRTOS::getTimeSinceStart() - start;
+
+	// The arena DOM: one block, sized generously, reused for every parse.
+	JsonArena arena(text.length() * 3);
+	bool arenaOk = (text[0] == '[') ? arena.parseArray(text).isValid() : arena.parseObject(text).isValid();
+	uint32_t arenaUsed = arena.getUsed();
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		arena.clear();
+		(text[0] == '[') ? arena.parseArray(text).isValid() : arena.parseObject(text).isValid();
+	}
+	uint32_t arenaMs = FreeRTOS::getTimeSinceStart() - start;
+
+	// Serialize both trees.
+	root = cJSON_Parse(text.c_str());
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		free(cJSON_PrintUnformatted(root));
+	}
+	uint32_t cjsonPrintMs = FreeRTOS::getTimeSinceStart() - start;
+	cJSON_Delete(root);
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		(text[0] == '[') ? arena.parseArray(text).toString() : arena.parseObject(text).toString();
+		arena.clear();
+	}
+	uint32_t arenaPrintMs = FreeRTOS::getTimeSinceStart() - start - arenaMs;
+
+	// Stream the arena document through a JsonWriter: only the writer's 128 byte buffer is needed.
+	arena.clear();
+	JsonArenaObject object = (text[0] == '[') ? JsonArenaObject(&arena, nullptr) : arena.parseObject(text);
+	JsonArenaArray  array  = (text[0] == '[') ? arena.parseArray(text) : JsonArenaArray(&arena, nullptr);
+	CountingSink sink;
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < ITERATIONS; i++) {
+		JsonWriter writer(&sink);
+		object.write(writer);
+		array.write(writer);
+		writer.finish();
+	}
+	uint32_t writerMs = FreeRTOS::getTimeSinceStart() - start;
+
+	printf("%s: %d bytes, valid: %d %d\n", name, (int)text.length(), ok, arenaOk);
+	printf("  cJSON:     heap %6d bytes, %4d ms for %d parses, %4d ms for %d prints\n", cjsonHeap, cjsonMs, ITERATIONS, cjsonPrintMs, ITERATIONS);
+	printf("  JsonParser: heap %6d bytes, %4d ms for %d parses\n", parserHeap, parserMs, ITERATIONS);
+	printf("  JsonArena:  used %6d bytes, %4d ms for %d parses, %4d ms for %d prints\n", arenaUsed, arenaMs, ITERATIONS, arenaPrintMs, ITERATIONS);
+	printf("  JsonWriter: %4d ms for %d streamed prints of %d bytes\n", writerMs, ITERATIONS, (int)(sink.m_total / ITERATIONS));
+	printf("  JsonPathExtractor: %4d ms for %d extractions (found: %d)\n", extractorMs, ITERATIONS, extractor.isFound(field));
+}
+
+
+/**
+ * A fixed-shape telemetry message, as published every few seconds.
+ */
+struct Location {
+	double lat;
+	double lon;
+	JSON_FIELDS(Location, lat, lon)
+};
+
+struct Telemetry {
+	char     device[24];
+	uint32_t t;
+	float    temp;
+	float    humidity;
+	int      rssi;
+	bool     ok;
+	Location location;
+	JSON_FIELDS(Telemetry, device, t, temp, humidity, rssi, ok, location)
+};
+
+
+/**
+ * Read and write a Telemetry message with JsonObject getters and setters and with JsonStruct.
+ */
+static void compareStruct() {
+	const int COUNT = 500;
+	std::string text = "{\"device\":\"gateway-01\",\"t\":1508140800,\"temp\":21.5,\"humidity\":40.25,\"rssi\":-67,\"ok\":true,\"location\":{\"lat\":51.5074,\"lon\":-0.1278}}";
+	Telemetry telemetry = {};
+
+	uint32_t start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		JsonObject object = JSON::parseObject(text);
+		std::string device = object.getString("device");
+		strncpy(telemetry.device, device.c_str(), sizeof(telemetry.device) - 1);
+		telemetry.t        = object.getInt("t");
+		telemetry.temp     = object.getDouble("temp");
+		telemetry.humidity = object.getDouble("humidity");
+		telemetry.rssi     = object.getInt("rssi");
+		telemetry.ok       = object.getBoolean("ok");
+		JsonObject location = object.getObject("location");
+		telemetry.location.lat = location.getDouble("lat");
+		telemetry.location.lon = location.getDouble("lon");
+		JSON::deleteObject(object);
+	}
+	uint32_t objectParseMs = FreeRTOS::getTimeSinceStart() - start;
+
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		JsonObject object = JSON::createObject();
+		object.setString("device", telemetry.device);
+		object.setInt("t", telemetry.t);
+		object.setDouble("temp", telemetry.temp);
+		object.setDouble("humidity", telemetry.humidity);
+		object.setInt("rssi", telemetry.rssi);
+		object.setBoolean("ok", telemetry.ok);
+		JsonObject location = JSON::createObject();
+		location.setDouble("lat", telemetry.location.lat);
+		location.setDouble("lon", telemetry.location.lon);
+		object.setObject("location", location);
+		object.toString();
+		JSON::deleteObject(object);
+	}
+	uint32_t objectWriteMs = FreeRTOS::getTimeSinceStart() - start;
+
+	bool ok = true;
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		ok &= JsonStruct::parse(text, &telemetry);
+	}
+	uint32_t structParseMs = FreeRTOS::getTimeSinceStart() - start;
+
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		JsonStruct::toString(telemetry);
+	}
+	uint32_t structWriteMs = FreeRTOS::getTimeSinceStart() - start;
+
+	printf("telemetry: %d bytes, valid: %d -> %s\n", (int)text.length(), ok, JsonStruct::toString(telemetry).c_str());
+	printf("  JsonObject: %4d ms for %d reads, %4d ms for %d writes\n", objectParseMs, COUNT, objectWriteMs, COUNT);
+	printf("  JsonStruct: %4d ms for %d reads, %4d ms for %d writes\n", structParseMs, COUNT, structWriteMs, COUNT);
+}
+
+
+/**
+ * Encode sensor records as JSON with JsonObject and as CBOR with CborWriter, and compare the
+ * time taken and the size of the payloads.
+ */
+static void compareCbor() {
+	const int COUNT = 500;
+	std::string json;
+	uint32_t start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		JsonObject record = JSON::createObject();
+		record.setString("device", "gateway-01");
+		record.setInt("t", 1508140800 + i * 60);
+		record.setDouble("temp", 21.5 + (i % 17) * 0.25);
+		record.setDouble("humidity", 40.0 + (i % 9));
+		record.setInt("rssi", -60 - (i % 20));
+		record.setBoolean("ok", true);
+		json = record.toString();
+		JSON::deleteObject(record);
+	}
+	uint32_t jsonMs = FreeRTOS::getTimeSinceStart() - start;
+
+	std::string cbor;
+	start = FreeRTOS::getTimeSinceStart();
+	for (int i = 0; i < COUNT; i++) {
+		cbor.clear();
+		JsonStringSink sink(&cbor);
+		CborWriter writer(&sink);
+		CborObject record = writer.beginObject();
+		record.setString("device", "gateway-01");
+		record.setInt("t", 1508140800 + i * 60);
+		record.setDouble("temp", 21.5 + (i % 17) * 0.25);
+		record.setDouble("humidity", 40.0 + (i % 9));
+		record.setInt("rssi", -60 - (i % 20));
+		record.setBoolean("ok", true);
+		record.end();
+		writer.finish();
+	}
+	uint32_t cborMs = FreeRTOS::getTimeSinceStart() - start;
+
+	std::string history = makeHistory();
+	std::string historyCbor = CBOR::fromJson(history);
+	printf("sensor record: JSON %d bytes, CBOR %d bytes -> %s\n", (int)json.length(), (int)cbor.length(), CBOR::toJson(cbor).c_str());
+	printf("  JsonObject: %4d ms for %d encodes\n", jsonMs, COUNT);
+	printf("  CborWriter: %4d ms for %d encodes\n", cborMs, COUNT);
+	printf("history: JSON %d bytes, CBOR %d bytes, round trip %s\n", (int)history.length(), (int)historyCbor.length(),
+		CBOR::toJson(historyCbor) == JsonArena(history.length() * 3).parseArray(history).toString() ? "ok" : "FAILED");
+}
+
+
+class JsonTestTask: public Task {
+	void run(void *data) {
+		ESP_LOGD(tag, "Comparing JSON parsers ...");
+		compare("config", makeConfig());
+		compare("history", makeHistory());
+		compareStruct();
+		compareCbor();
+		printf("Tests done\n");
+	}
+};
+
+
+void app_main(void) {
+	JsonTestTask* pTask = new JsonTestTask();
+	pTask->setStackSize(8000);
+	pTask->start();
+}
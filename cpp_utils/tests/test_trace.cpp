@@ -0,0 +1,57 @@
+/*
+ * Measure the cost of a trace event against formatting the same text, and print the events
+ * through the trace log task.
+ */
+#include <esp_log.h>
+#include <stdio.h>
+#include <Task.h>
+#include <Trace.h>
+#include <xtensa/hal.h>
+
+#include "sdkconfig.h"
+
+static char tag[] = "test_trace";
+
+extern "C" {
+	void app_main(void);
+}
+
+static const int ITERATIONS = 1000;
+
+
+class TraceTestTask: public Task {
+	void run(void *data) {
+		ESP_LOGD(tag, "Measuring trace ...");
+		Trace::start(32 * 1024);
+
+		uint32_t start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			TRACE("Pixel %d value: %x", i, 0x102030);
+		}
+		uint32_t traceCycles = xthal_get_ccount() - start;
+
+		char buffer[64];
+		start = xthal_get_ccount();
+		for (int i = 0; i < ITERATIONS; i++) {
+			snprintf(buffer, sizeof(buffer), "Pixel %d value: %x", i, 0x102030);
+		}
+		uint32_t formatCycles = xthal_get_ccount() - start;
+
+		printf("  TRACE    %5d cycles per event, %d dropped\n", traceCycles / ITERATIONS, Trace::getDropped());
+		printf("  snprintf %5d cycles per line\n", formatCycles / ITERATIONS);
+
+		{
+			TRACE_SCOPE("scope");
+			TRACE("A string: %s, a double: %f", "hello", 3.5);
+		}
+		Trace::startLogTask(500);
+		printf("Tests done\n");
+	}
+};
+
+
+void app_main(void) {
+	TraceTestTask* pTask = new TraceTestTask();
+	pTask->setStackSize(8000);
+	pTask->start();
+}
@@ -0,0 +1,275 @@
+/*
+ * BLESimulatedPeer.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TOOLS_BLESIMULATEDPEER_H_
+#define COMPONENTS_CPP_UTILS_TOOLS_BLESIMULATEDPEER_H_
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "BLEClientManager.h"
+
+/**
+ * @brief A GATT client stack, on a host, connected to simulated peers.
+ *
+ * Each peer is described by a BLEAttributeDatabase.  Every request is answered after a round
+ * trip of simulated time, as the ESP-IDF stack answers: a characteristic is found by asking for
+ * the one after the last found, and the end of a list is an answer of STATUS_NOT_FOUND.  As ATT
+ * allows, a connection has one request outstanding: requests made at once are sent one after
+ * another, each when the last is answered.  run() delivers the answers to the manager in the
+ * order of their time, and the time they are delivered is the simulated time.  Nothing is
+ * delivered from within a request, just as the stack answers on its own task.
+ *
+ * failLists() makes the answers to searches for characteristics and descriptors fail, and
+ * changeDatabase() changes a peer's services and indicates Service Changed.
+ *
+ * A read of a characteristic returns the last value written to it, or its index in the peer's
+ * database as a byte if none was.
+ */
+class BLESimulatedPeer: public BLEGattClientTransport {
+public:
+	BLESimulatedPeer(uint32_t roundTripMs): m_roundTripMs(roundTripMs) {}
+
+	void addPeer(const uint8_t* address, const BLEAttributeDatabase& database) {
+		Peer peer;
+		peer.database = database;
+		peer.connected = false;
+		peer.busyUntil = 0;
+		m_peers[std::string((const char*)address, 6)] = peer;
+	}
+	void setManager(BLEClientManager* pManager) {
+		m_pManager = pManager;
+	}
+	/**
+	 * @brief Change the services of a peer and, if it is connected, indicate Service Changed.
+	 */
+	void changeDatabase(const uint8_t* address, const BLEAttributeDatabase& database) {
+		std::string key((const char*)address, 6);
+		Peer* pPeer = &m_peers[key];
+		pPeer->database = database;
+		pPeer->values.clear();
+		if (pPeer->connected) {
+			answer([this, key]() { m_pManager->onServiceChanged((const uint8_t*)key.data()); });
+		}
+	}
+	/**
+	 * @brief Answer every search for characteristics or descriptors with this status, or 0 to answer them again.
+	 */
+	void failLists(int status) {
+		m_listStatus = status;
+	}
+	uint32_t getRequests() {
+		return m_requests;
+	}
+	uint32_t getTime() {
+		return m_now;
+	}
+	/**
+	 * @brief Deliver answers until there are none left.
+	 */
+	void run() {
+		while (!m_events.empty()) {
+			std::pop_heap(m_events.begin(), m_events.end(), later);
+			Event event = m_events.back();
+			m_events.pop_back();
+			m_now = event.time;
+			event.deliver();
+		}
+	}
+
+	bool close(uint16_t connId) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		pPeer->connected = false;
+		answer([this, connId]() { m_pManager->onClose(connId); });
+		return true;
+	}
+
+	bool getCharacteristic(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId* pAfter) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		const BLEAttributeDatabase& database = pPeer->database;
+		int serviceIndex = database.findService(service.id);
+		int start = pAfter != nullptr ? database.findCharacteristic(serviceIndex, *pAfter) + 1 : 0;
+		int found = -1;
+		for (int i = start; serviceIndex >= 0 && i < (int)database.characteristics.size(); i++) {
+			if (database.characteristics[i].service == serviceIndex) {
+				found = i;
+				break;
+			}
+		}
+		BLEAttributeId serviceId = service.id;
+		if (m_listStatus != 0 || found < 0) {
+			int status = m_listStatus != 0 ? m_listStatus : BLEClientManager::STATUS_NOT_FOUND;
+			request(pPeer, [this, connId, status, serviceId]() {
+				m_pManager->onCharacteristic(connId, status, serviceId, BLEAttributeId(), 0);
+			});
+		} else {
+			BLEAttributeDatabase::Characteristic characteristic = database.characteristics[found];
+			request(pPeer, [this, connId, serviceId, characteristic]() {
+				m_pManager->onCharacteristic(connId, 0, serviceId, characteristic.id, characteristic.properties);
+			});
+		}
+		return true;
+	}
+
+	bool getDescriptor(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const BLEAttributeId* pAfter) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		const BLEAttributeDatabase& database = pPeer->database;
+		int characteristicIndex = database.findCharacteristic(database.findService(service.id), characteristic);
+		int start = pAfter != nullptr ? database.findDescriptor(characteristicIndex, *pAfter) + 1 : 0;
+		int found = -1;
+		for (int i = start; characteristicIndex >= 0 && i < (int)database.descriptors.size(); i++) {
+			if (database.descriptors[i].characteristic == characteristicIndex) {
+				found = i;
+				break;
+			}
+		}
+		BLEAttributeId serviceId = service.id;
+		BLEAttributeId characteristicId = characteristic;
+		BLEAttributeId descriptorId = found >= 0 ? database.descriptors[found].id : BLEAttributeId();
+		int status = m_listStatus != 0 ? m_listStatus : found >= 0 ? 0 : BLEClientManager::STATUS_NOT_FOUND;
+		request(pPeer, [this, connId, status, serviceId, characteristicId, descriptorId]() {
+			m_pManager->onDescriptor(connId, status, serviceId, characteristicId, descriptorId);
+		});
+		return true;
+	}
+
+	bool open(const uint8_t* address) override {
+		auto it = m_peers.find(std::string((const char*)address, 6));
+		if (it == m_peers.end()) {
+			return false;
+		}
+		Peer* pPeer = &it->second;
+		pPeer->connected = true;
+		pPeer->connId    = m_nextConnId++;
+		std::string key = it->first;
+		uint16_t connId = pPeer->connId;
+		answer([this, key, connId]() {
+			m_pManager->onOpen((const uint8_t*)key.data(), connId, 0);
+		});
+		return true;
+	}
+
+	bool read(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		int index = pPeer->database.findCharacteristic(pPeer->database.findService(service.id), characteristic);
+		std::string value;
+		if (pPeer->values.count(index) > 0) {
+			value = pPeer->values[index];
+		} else {
+			value.push_back((char)index);
+		}
+		int status = index >= 0 ? 0 : BLEClientManager::STATUS_NOT_FOUND;
+		request(pPeer, [this, connId, status, value]() {
+			m_pManager->onRead(connId, status, (const uint8_t*)value.data(), value.length());
+		});
+		return true;
+	}
+
+	bool searchServices(uint16_t connId) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		std::vector<BLEAttributeDatabase::Service> services = pPeer->database.services;
+		request(pPeer, [this, connId, services]() {
+			for (auto& service: services) {
+				m_pManager->onService(connId, service.id, service.primary);
+			}
+			m_pManager->onSearchComplete(connId, 0);
+		});
+		return true;
+	}
+
+	bool write(uint16_t connId, const BLEAttributeDatabase::Service& service,
+			const BLEAttributeId& characteristic, const uint8_t* data, size_t length, bool) override {
+		Peer* pPeer = findByConnId(connId);
+		if (pPeer == nullptr) {
+			return false;
+		}
+		int index = pPeer->database.findCharacteristic(pPeer->database.findService(service.id), characteristic);
+		if (index >= 0) {
+			pPeer->values[index].assign((const char*)data, length);
+		}
+		int status = index >= 0 ? 0 : BLEClientManager::STATUS_NOT_FOUND;
+		request(pPeer, [this, connId, status]() { m_pManager->onWrite(connId, status); });
+		return true;
+	}
+
+private:
+	struct Peer {
+		BLEAttributeDatabase       database;
+		std::map<int, std::string> values;
+		bool                       connected;
+		uint16_t                   connId;
+		uint32_t                   busyUntil;   // When the outstanding request is answered.
+	};
+	struct Event {
+		uint32_t              time;
+		uint32_t              sequence;   // Keeps answers due at once in the order they were asked.
+		std::function<void()> deliver;
+	};
+
+	static bool later(const Event& a, const Event& b) {
+		return a.time != b.time ? a.time > b.time : a.sequence > b.sequence;
+	}
+	/**
+	 * @brief Deliver something a round trip from now.
+	 */
+	void answer(std::function<void()> deliver, uint32_t time = 0) {
+		Event event;
+		event.time     = time != 0 ? time : m_now + m_roundTripMs;
+		event.sequence = m_sequence++;
+		event.deliver  = deliver;
+		m_events.push_back(event);
+		std::push_heap(m_events.begin(), m_events.end(), later);
+		m_requests++;
+	}
+	/**
+	 * @brief Answer an ATT request a round trip after the peer has answered those before it.
+	 */
+	void request(Peer* pPeer, std::function<void()> deliver) {
+		pPeer->busyUntil = std::max(m_now, pPeer->busyUntil) + m_roundTripMs;
+		answer(deliver, pPeer->busyUntil);
+	}
+	Peer* findByConnId(uint16_t connId) {
+		for (auto& it: m_peers) {
+			if (it.second.connected && it.second.connId == connId) {
+				return &it.second;
+			}
+		}
+		return nullptr;
+	}
+
+	BLEClientManager*           m_pManager   = nullptr;
+	std::map<std::string, Peer> m_peers;
+	std::vector<Event>          m_events;
+	uint32_t                    m_roundTripMs;
+	int                         m_listStatus = 0;
+	uint32_t                    m_now        = 0;
+	uint32_t                    m_sequence   = 0;
+	uint32_t                    m_requests   = 0;
+	uint16_t                    m_nextConnId = 0;
+}; // BLESimulatedPeer
+
+#endif /* COMPONENTS_CPP_UTILS_TOOLS_BLESIMULATEDPEER_H_ */
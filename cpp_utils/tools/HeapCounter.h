@@ -0,0 +1,39 @@
+/*
+ * HeapCounter.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TOOLS_HEAPCOUNTER_H_
+#define COMPONENTS_CPP_UTILS_TOOLS_HEAPCOUNTER_H_
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+ * Count the bytes a host tool asks of operator new, by replacing the global operator new and
+ * operator delete.  Read s_heapBytes before and after the code being measured.  malloc() is not
+ * counted.  The replacements are defined here, so include this header from one source file of
+ * a tool only: the one with main().
+ */
+static size_t s_heapBytes = 0;   // Bytes asked of operator new.
+
+void* operator new(size_t size) {
+	s_heapBytes += size;
+	void* p = malloc(size);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+#endif /* COMPONENTS_CPP_UTILS_TOOLS_HEAPCOUNTER_H_ */
@@ -0,0 +1,260 @@
+/*
+ * Compare Channel, over MPSCQueue and SPSCQueue, with a queue guarded by a mutex, on a host.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -pthread -I.. -o bench_channel bench_channel.cpp ../FreeRTOS.cpp ../Task.cpp
+ *
+ * First checks the queues alone: that they fill to their capacity and no further, and keep
+ * their order through many laps of the ring.  Then, for each channel and for the baseline, a
+ * std::deque behind a std::mutex and a std::condition_variable as a FreeRTOS queue would be:
+ *
+ * - hand over: the time for a message to go from one task to another that is waiting for it,
+ *   measured as half a round trip;
+ * - throughput: the messages a second that one and then four sending tasks get through to one
+ *   receiving task, which checks that each sender's messages arrive complete and in order.
+ *
+ * Also checks that a receive with nothing to receive times out.  Exits 1 if a check fails.
+ * With a single CPU the tasks only take turns, so the throughputs measure the cost of a turn.
+ */
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include "Channel.h"
+#include "FreeRTOS.h"
+#include "MPSCQueue.h"
+#include "SPSCQueue.h"
+#include "Task.h"
+
+static const size_t   CAPACITY = 64;
+static const int      ROUNDS   = 20000;     // Round trips for the hand over.
+static const uint32_t MESSAGES = 400000;    // Messages for the throughput, from all the senders.
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+typedef struct {
+	uint32_t sender;
+	uint32_t sequence;
+} message_t;
+
+
+/**
+ * @brief The baseline: a bounded queue behind a mutex, with a condition variable to wait on.
+ */
+template<typename T, size_t SIZE>
+class LockedQueue {
+public:
+	static const uint32_t FOREVER = UINT32_MAX;
+
+	bool receive(T* pItem, uint32_t timeoutMs = FOREVER) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto ready = [this]() { return !m_items.empty(); };
+		if (timeoutMs == FOREVER) {
+			m_notEmpty.wait(lock, ready);
+		} else if (!m_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready)) {
+			return false;
+		}
+		*pItem = m_items.front();
+		m_items.pop_front();
+		return true;
+	}
+
+	bool send(const T& item) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_items.size() == SIZE) {
+			return false;
+		}
+		m_items.push_back(item);
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_notEmpty;
+	std::deque<T>           m_items;
+};
+
+
+/**
+ * @brief Receives a message and sends it back, for the hand over.
+ */
+template<typename CHANNEL>
+class EchoTask: public Task {
+public:
+	EchoTask(CHANNEL* pPing, CHANNEL* pPong): Task("EchoTask"), m_pPing(pPing), m_pPong(pPong) {}
+
+	void run(void* data) {
+		message_t message;
+		for (int i = 0; i < ROUNDS; i++) {
+			m_pPing->receive(&message);
+			m_pPong->send(message);
+		}
+	}
+
+private:
+	CHANNEL* m_pPing;
+	CHANNEL* m_pPong;
+};
+
+
+/**
+ * @brief Sends its share of the messages, numbered, trying again while the channel is full.
+ */
+template<typename CHANNEL>
+class SendingTask: public Task {
+public:
+	SendingTask(CHANNEL* pChannel, uint32_t sender, uint32_t count)
+		: Task("SendingTask"), m_pChannel(pChannel), m_sender(sender), m_count(count) {}
+
+	void run(void* data) {
+		message_t message;
+		message.sender = m_sender;
+		for (uint32_t i = 0; i < m_count; i++) {
+			message.sequence = i;
+			while (!m_pChannel->send(message)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	CHANNEL* m_pChannel;
+	uint32_t m_sender;
+	uint32_t m_count;
+};
+
+
+// The tasks are kept until the end, as runTask() still uses a task after its run() returns.
+static Task* s_tasks[16];
+static int   s_taskCount = 0;
+
+
+template<typename QUEUE>
+static void checkQueue(const char* name) {
+	static QUEUE queue;
+	uint32_t value = 0;
+	CHECK(queue.empty() && !queue.pop(&value));
+	for (uint32_t i = 0; i < queue.capacity(); i++) {
+		CHECK(queue.push(i));
+	}
+	CHECK(!queue.push(0));
+	CHECK(queue.size() == queue.capacity());
+	uint32_t next = 0;
+	for (uint32_t lap = 0; lap < 1000; lap++) {
+		for (uint32_t i = 0; i < queue.capacity() / 2; i++) {
+			CHECK(queue.pop(&value) && value == next);
+			next++;
+		}
+		for (uint32_t i = 0; i < queue.capacity() / 2; i++) {
+			CHECK(queue.push(next + queue.capacity() - queue.capacity() / 2 + i));
+		}
+	}
+	while (queue.pop(&value)) {
+		CHECK(value == next);
+		next++;
+	}
+	CHECK(queue.empty());
+	printf("%s: filled to %u, kept its order through 1000 laps\n", name, (unsigned)queue.capacity());
+} // checkQueue
+
+
+template<typename CHANNEL>
+static double handOverNs() {
+	static CHANNEL ping;
+	static CHANNEL pong;
+	Task* pEcho = new EchoTask<CHANNEL>(&ping, &pong);
+	s_tasks[s_taskCount++] = pEcho;
+	pEcho->start();
+	message_t message = {0, 0};
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ROUNDS; i++) {
+		message.sequence = i;
+		ping.send(message);
+		CHECK(pong.receive(&message, 5000) && message.sequence == (uint32_t)i);
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS / 2;
+} // handOverNs
+
+
+template<typename CHANNEL>
+static double throughput(uint32_t senders) {
+	static CHANNEL channel;
+	uint32_t each = MESSAGES / senders;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < senders; i++) {
+		Task* pSender = new SendingTask<CHANNEL>(&channel, i, each);
+		s_tasks[s_taskCount++] = pSender;
+		pSender->start();
+	}
+	std::vector<uint32_t> next(senders, 0);
+	message_t message;
+	bool inOrder = true;
+	for (uint32_t i = 0; i < each * senders; i++) {
+		if (!channel.receive(&message, 5000)) {
+			printf("FAILED: only %u messages came\n", i);
+			s_failures++;
+			break;
+		}
+		inOrder = inOrder && message.sender < senders && message.sequence == next[message.sender];
+		next[message.sender]++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	CHECK(inOrder);
+	CHECK(!channel.receive(&message, 0));
+	return each * senders / seconds;
+} // throughput
+
+
+template<typename CHANNEL>
+static void checkTimeout(const char* name) {
+	static CHANNEL channel;
+	message_t message;
+	auto start = std::chrono::steady_clock::now();
+	CHECK(!channel.receive(&message, 100));
+	uint32_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	CHECK(ms >= 100 - portTICK_PERIOD_MS && ms <= 100 + 30);
+	printf("%s: an empty receive(100) took %u ms\n", name, ms);
+} // checkTimeout
+
+
+template<typename CHANNEL>
+static void report(const char* name, bool singleSender) {
+	double ns  = handOverNs<CHANNEL>();
+	double one = throughput<CHANNEL>(1);
+	if (singleSender) {
+		printf("%-28s hand over %7.0f ns  1 sender %6.2f M/s\n", name, ns, one / 1e6);
+	} else {
+		double four = throughput<CHANNEL>(4);
+		printf("%-28s hand over %7.0f ns  1 sender %6.2f M/s  4 senders %6.2f M/s\n", name, ns, one / 1e6, four / 1e6);
+	}
+} // report
+
+
+int main() {
+	checkQueue<SPSCQueue<uint32_t, CAPACITY>>("SPSCQueue");
+	checkQueue<MPSCQueue<uint32_t, CAPACITY>>("MPSCQueue");
+	checkTimeout<Channel<message_t, CAPACITY>>("Channel");
+	printf("\n");
+
+	report<LockedQueue<message_t, CAPACITY>>("mutex + deque", false);
+	report<Channel<message_t, CAPACITY>>("Channel (MPSCQueue)", false);
+	report<Channel<message_t, CAPACITY, SPSCQueue>>("Channel (SPSCQueue)", true);
+
+	if (s_failures > 0) {
+		printf("%d checks FAILED\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
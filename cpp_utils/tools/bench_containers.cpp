@@ -0,0 +1,203 @@
+/*
+ * Compare FixedHashMap, SmallVector and IntrusiveList with the standard containers they
+ * replace, on a host.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o bench_containers bench_containers.cpp
+ *
+ * For each container this prints the time to insert and to look up, and the memory it uses for
+ * each element.  The heap is measured by counting the bytes asked of operator new and malloc
+ * is not counted, so the figures for SmallVector past its inline capacity are low.  Allocator
+ * overhead, 8 bytes or more a block on the ESP32, comes on top of the heap figures.
+ */
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "FixedHashMap.h"
+#include "HeapCounter.h"
+#include "IntrusiveList.h"
+#include "SmallVector.h"
+
+static const int COUNT  = 24;       // About the number of attributes of a GATT server.
+static const int ROUNDS = 100000;
+
+static volatile uintptr_t s_sink;
+
+template<typename F>
+static double timeNs(F f, int operations) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+static void report(const char* name, double insertNs, double lookupNs, double bytesPerElement) {
+	printf("%-42s insert %6.1f ns  lookup %6.1f ns  %6.1f bytes/element\n", name, insertNs, lookupNs, bytesPerElement);
+}
+
+struct Item: public IntrusiveListHook<> {
+	uint16_t handle;
+};
+
+
+int main() {
+	std::vector<uint16_t> handles;
+	std::vector<std::string> uuids;
+	for (int i = 0; i < COUNT; i++) {
+		handles.push_back(40 + i * 3);
+		char text[40];
+		snprintf(text, sizeof(text), "%08x-0000-1000-8000-00805f9b34fb", 0x2a00 + i * 7);
+		uuids.push_back(text);
+	}
+	Item items[COUNT];
+	for (int i = 0; i < COUNT; i++) {
+		items[i].handle = handles[i];
+	}
+
+	// Handle to pointer: std::map, as the BLE maps used, against FixedHashMap.
+	{
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				std::map<uint16_t, Item*> map;
+				for (int i = 0; i < COUNT; i++) {
+					map.insert(std::pair<uint16_t, Item*>(handles[i], &items[i]));
+				}
+				s_sink = map.size();
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		std::map<uint16_t, Item*> map;
+		for (int i = 0; i < COUNT; i++) {
+			map.insert(std::pair<uint16_t, Item*>(handles[i], &items[i]));
+		}
+		double lookupNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS; r++) {
+				s_sink = (uintptr_t)map.at(handles[r % COUNT]);
+			}
+		}, ROUNDS);
+		report("std::map<uint16_t, T*>", insertNs, lookupNs, (double)(sizeof(map) + heap) / COUNT);
+	}
+	{
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				FixedHashMap<uint16_t, Item*, 32> map;
+				for (int i = 0; i < COUNT; i++) {
+					map.set(handles[i], &items[i]);
+				}
+				s_sink = map.size();
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		FixedHashMap<uint16_t, Item*, 32> map;
+		for (int i = 0; i < COUNT; i++) {
+			map.set(handles[i], &items[i]);
+		}
+		double lookupNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS; r++) {
+				s_sink = (uintptr_t)*map.get(handles[r % COUNT]);
+			}
+		}, ROUNDS);
+		report("FixedHashMap<uint16_t, T*, 32>", insertNs, lookupNs, (double)(sizeof(map) + heap) / COUNT);
+	}
+
+	// UUID to pointer: std::map keyed by the UUID string, against a SmallVector searched in order.
+	{
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				std::map<std::string, Item*> map;
+				for (int i = 0; i < COUNT; i++) {
+					map.insert(std::pair<std::string, Item*>(uuids[i], &items[i]));
+				}
+				s_sink = map.size();
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		std::map<std::string, Item*> map;
+		for (int i = 0; i < COUNT; i++) {
+			map.insert(std::pair<std::string, Item*>(uuids[i], &items[i]));
+		}
+		double lookupNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS; r++) {
+				s_sink = (uintptr_t)map.at(uuids[r % COUNT]);
+			}
+		}, ROUNDS);
+		report("std::map<std::string, T*>", insertNs, lookupNs, (double)(sizeof(map) + heap) / COUNT);
+	}
+	{
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				SmallVector<Item*, 32> vector;
+				for (int i = 0; i < COUNT; i++) {
+					vector.pushBack(&items[i]);
+				}
+				s_sink = vector.size();
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		SmallVector<Item*, 32> vector;
+		for (int i = 0; i < COUNT; i++) {
+			vector.pushBack(&items[i]);
+		}
+		double lookupNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS; r++) {
+				uint16_t handle = handles[r % COUNT];
+				for (auto pItem: vector) {
+					if (pItem->handle == handle) {
+						s_sink = (uintptr_t)pItem;
+						break;
+					}
+				}
+			}
+		}, ROUNDS);
+		report("SmallVector<T*, 32>, linear search", insertNs, lookupNs, (double)(sizeof(vector) + heap) / COUNT);
+	}
+
+	// A list of objects: std::list style nodes from c_list against IntrusiveList.
+	{
+		struct Node {
+			void* value;
+			Node* next;
+			Node* prev;
+		};
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				Node head = { nullptr, nullptr, nullptr };
+				Node* pLast = &head;
+				for (int i = 0; i < COUNT; i++) {
+					Node* pNode = new Node { &items[i], nullptr, pLast };
+					pLast->next = pNode;
+					pLast = pNode;
+				}
+				for (Node* pNode = head.next; pNode != nullptr;) {
+					Node* pNext = pNode->next;
+					delete pNode;
+					pNode = pNext;
+				}
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		report("c_list (one node allocated per value)", insertNs, 0, (double)(sizeof(Node) + heap) / COUNT);
+	}
+	{
+		size_t before = s_heapBytes;
+		double insertNs = timeNs([&] {
+			for (int r = 0; r < ROUNDS / 10; r++) {
+				IntrusiveList<Item> list;
+				for (int i = 0; i < COUNT; i++) {
+					list.pushBack(&items[i]);
+				}
+				s_sink = (uintptr_t)list.getLast();
+			}
+		}, ROUNDS / 10 * COUNT);
+		size_t heap = (s_heapBytes - before) / (ROUNDS / 10);
+		report("IntrusiveList (links in each object)", insertNs, 0, sizeof(IntrusiveListHook<>) + (double)heap / COUNT);
+	}
+	return 0;
+}
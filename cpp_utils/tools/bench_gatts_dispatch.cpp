@@ -0,0 +1,165 @@
+/*
+ * Replay a synthetic stream of GATT server reads and writes, on a host, and compare offering
+ * each event to every attribute with sending it through a BLEHandleTable.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o bench_gatts_dispatch bench_gatts_dispatch.cpp
+ *
+ * The attributes stand in for those of BLEServer: services own characteristics, which own
+ * descriptors, and every handler is a virtual call that checks the handle of the event, as
+ * BLECharacteristic::handleGATTServerEvent does.  The server is laid out as the stack assigns
+ * handles: a service, then each characteristic followed by its descriptor.  Every event must
+ * reach exactly the attribute that owns its handle.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "BLEHandleTable.h"
+
+static const int EVENTS = 200000;
+
+enum Event {
+	READ_EVT,
+	WRITE_EVT
+};
+
+static unsigned long s_calls   = 0;   // Handlers invoked.
+static unsigned long s_handled = 0;   // Handlers that owned the handle.
+
+class BLEDescriptor {
+public:
+	BLEDescriptor(uint16_t handle) : m_handle(handle) {}
+	virtual ~BLEDescriptor() {}
+	virtual void handleGATTServerEvent(Event event, uint16_t handle) {
+		s_calls++;
+		if (handle == m_handle) {
+			s_handled++;
+		}
+	}
+	uint16_t m_handle;
+};
+
+class BLECharacteristic {
+public:
+	BLECharacteristic(uint16_t handle) : m_handle(handle) {}
+	virtual ~BLECharacteristic() {}
+	virtual void handleGATTServerEvent(Event event, uint16_t handle, bool toDescriptors) {
+		s_calls++;
+		if (handle == m_handle) {
+			s_handled++;
+		}
+		if (toDescriptors) {
+			for (auto pDescriptor: m_descriptors) {
+				pDescriptor->handleGATTServerEvent(event, handle);
+			}
+		}
+	}
+	uint16_t m_handle;
+	std::vector<BLEDescriptor*> m_descriptors;
+};
+
+struct Service {
+	std::vector<BLECharacteristic*> characteristics;
+};
+
+
+template<typename F>
+static double timeNs(F f, int operations) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+
+/**
+ * Build a server of some characteristics, each with a descriptor, and replay the same stream
+ * of events through both dispatchers.
+ */
+static bool run(int characteristicsPerService, int services) {
+	std::vector<Service> server(services);
+	std::vector<uint16_t> handles;
+	BLEHandleTable table;
+	uint16_t handle = 40;
+	for (auto& service: server) {
+		handle++;   // The service's own handle.
+		for (int i = 0; i < characteristicsPerService; i++) {
+			BLECharacteristic* pCharacteristic = new BLECharacteristic(handle);
+			table.setCharacteristic(handle, pCharacteristic);
+			handles.push_back(handle++);
+			BLEDescriptor* pDescriptor = new BLEDescriptor(handle);
+			pCharacteristic->m_descriptors.push_back(pDescriptor);
+			table.setDescriptor(handle, pDescriptor);
+			handles.push_back(handle++);
+			service.characteristics.push_back(pCharacteristic);
+		}
+	}
+
+	std::vector<uint16_t> stream;
+	srand(1);
+	for (int i = 0; i < EVENTS; i++) {
+		stream.push_back(handles[rand() % handles.size()]);
+	}
+
+	s_calls   = 0;
+	s_handled = 0;
+	double broadcastNs = timeNs([&] {
+		for (int i = 0; i < EVENTS; i++) {
+			Event event = (i & 1) ? WRITE_EVT : READ_EVT;
+			for (auto& service: server) {
+				for (auto pCharacteristic: service.characteristics) {
+					pCharacteristic->handleGATTServerEvent(event, stream[i], true);
+				}
+			}
+		}
+	}, EVENTS);
+	double broadcastCalls = (double)s_calls / EVENTS;
+	bool ok = s_handled == (unsigned long)EVENTS;
+
+	s_calls   = 0;
+	s_handled = 0;
+	double tableNs = timeNs([&] {
+		for (int i = 0; i < EVENTS; i++) {
+			Event event = (i & 1) ? WRITE_EVT : READ_EVT;
+			const BLEHandleTable::Entry* pEntry = table.find(stream[i]);
+			if (pEntry->pCharacteristic != nullptr) {
+				pEntry->pCharacteristic->handleGATTServerEvent(event, stream[i], false);
+			} else {
+				pEntry->pDescriptor->handleGATTServerEvent(event, stream[i]);
+			}
+		}
+	}, EVENTS);
+	double tableCalls = (double)s_calls / EVENTS;
+	ok = ok && s_handled == (unsigned long)EVENTS;
+
+	printf("%10d %10d %14.1f %10.1f %14.1f %10.1f\n",
+		services, (int)handles.size(), broadcastNs, broadcastCalls, tableNs, tableCalls);
+
+	for (auto& service: server) {
+		for (auto pCharacteristic: service.characteristics) {
+			for (auto pDescriptor: pCharacteristic->m_descriptors) {
+				delete pDescriptor;
+			}
+			delete pCharacteristic;
+		}
+	}
+	return ok;
+} // run
+
+
+int main() {
+	printf("%10s %10s %14s %10s %14s %10s\n",
+		"services", "attributes", "broadcast ns", "calls", "table ns", "calls");
+	bool ok = true;
+	ok = run(2, 1) && ok;
+	ok = run(4, 2) && ok;
+	ok = run(4, 4) && ok;
+	ok = run(8, 4) && ok;
+	ok = run(8, 8) && ok;
+	ok = run(16, 8) && ok;
+	if (!ok) {
+		printf("An event did not reach exactly its attribute\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,295 @@
+/*
+ * Measure JsonParser, JsonArena, JsonWriter and JsonStruct on a host.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o bench_json bench_json.cpp ../JSONArena.cpp ../JSONParser.cpp ../JSONStruct.cpp ../JSONWriter.cpp
+ *
+ * For a 16KB configuration document and an array of 200 telemetry records this prints the time
+ * to parse with the event parser and into an arena, the time to print the arena document to a
+ * string and to stream it through a JsonWriter, and the heap each asks of operator new.  The
+ * arena's own block comes from malloc() and is given as the bytes used in it.  Then it reads and
+ * writes a telemetry message with the JsonArena getters and setters and with JsonStruct.
+ *
+ * cJSON, and so the JSON class, is part of ESP-IDF and is not built here: the comparison with
+ * it is in tests/test_json.cpp, which runs on the device.
+ *
+ * Also checks that the documents print text that reads back the same, that an array stops at 65535
+ * members, that a node cannot be set under a second name and that JsonStruct skips numbers an
+ * integer member cannot hold.  Exits 1 if a check fails.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "HeapCounter.h"
+#include "JSONArena.h"
+#include "JSONParser.h"
+#include "JSONStruct.h"
+#include "JSONWriter.h"
+
+static const int ITERATIONS = 200;
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+
+/**
+ * A configuration document like the one in tests/test_json.cpp.
+ */
+static std::string makeConfig() {
+	std::string text = "{\"device\":{\"name\":\"gateway-01\",\"firmware\":\"1.4.2\"},\"wifi\":{\"ssid\":\"sweetie\",\"password\":\"secret\"},\"sensors\":[";
+	for (int i = 0; i < 150; i++) {
+		char item[160];
+		snprintf(item, sizeof(item), "%s{\"id\":%d,\"type\":\"temperature\",\"pin\":%d,\"interval\":%d,\"scale\":%.3f,\"enabled\":%s,\"label\":\"Sensor %d\"}",
+			i == 0 ? "" : ",", i, i % 40, 1000 + i, 0.125 * i, (i % 3) ? "true" : "false", i);
+		text += item;
+	}
+	return text + "],\"mqtt\":{\"host\":\"broker.local\",\"port\":1883,\"keepalive\":60}}";
+}
+
+
+/**
+ * An array of telemetry records, as returned by a REST history query.
+ */
+static std::string makeHistory() {
+	std::string text = "[";
+	for (int i = 0; i < 200; i++) {
+		char item[120];
+		snprintf(item, sizeof(item), "%s{\"t\":%d,\"temp\":%.2f,\"humidity\":%.1f,\"ok\":true}", i == 0 ? "" : ",", 1508140800 + i * 60, 21.5 + (i % 17) * 0.1, 40.0 + (i % 9));
+		text += item;
+	}
+	return text + "]";
+}
+
+
+/**
+ * Counts and discards the output of a JsonWriter.
+ */
+class CountingSink: public JsonSink {
+public:
+	size_t m_total = 0;
+	bool write(const uint8_t*, size_t length) override { m_total += length; return true; }
+};
+
+
+static double microsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static void measure(const char* name, const std::string& text) {
+	bool isArray = text[0] == '[';
+
+	JsonParserHandler nullHandler;
+	JsonParser parser(&nullHandler);
+	size_t heapBefore = s_heapBytes;
+	CHECK(parser.parse(text));
+	size_t parserHeap = s_heapBytes - heapBefore;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		parser.parse(text);
+	}
+	double parserUs = microsSince(start) / ITERATIONS;
+
+	JsonArena arena(text.length() * 4);
+	heapBefore = s_heapBytes;
+	CHECK(isArray ? arena.parseArray(text).isValid() : arena.parseObject(text).isValid());
+	size_t arenaHeap = s_heapBytes - heapBefore;
+	size_t arenaUsed = arena.getUsed();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		arena.clear();
+		if (isArray) {
+			arena.parseArray(text);
+		} else {
+			arena.parseObject(text);
+		}
+	}
+	double arenaUs = microsSince(start) / ITERATIONS;
+
+	// Numbers are printed in their shortest form, so the text printed must read back the same.
+	arena.clear();
+	JsonArenaObject object = isArray ? JsonArenaObject(&arena, nullptr) : arena.parseObject(text);
+	JsonArenaArray  array  = isArray ? arena.parseArray(text) : JsonArenaArray(&arena, nullptr);
+	std::string printed = isArray ? array.toString() : object.toString();
+	JsonArena again(text.length() * 4);
+	CHECK(!printed.empty() && printed == (isArray ? again.parseArray(printed).toString() : again.parseObject(printed).toString()));
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		isArray ? array.toString() : object.toString();
+	}
+	double printUs = microsSince(start) / ITERATIONS;
+
+	CountingSink sink;
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		JsonWriter writer(&sink);
+		object.write(writer);
+		array.write(writer);
+		writer.finish();
+	}
+	double writerUs = microsSince(start) / ITERATIONS;
+	size_t writerHeap = (s_heapBytes - heapBefore) / ITERATIONS;
+	CHECK(sink.m_total == printed.length() * ITERATIONS);
+
+	printf("%s: %d bytes\n", name, (int)text.length());
+	printf("  JsonParser events   %8.1f us a parse   heap %6d bytes\n", parserUs, (int)parserHeap);
+	printf("  JsonArena parse     %8.1f us a parse   heap %6d bytes, %6d bytes of the arena\n", arenaUs, (int)arenaHeap, (int)arenaUsed);
+	printf("  JsonArena toString  %8.1f us a print\n", printUs);
+	printf("  JsonWriter stream   %8.1f us a print   heap %6d bytes\n", writerUs, (int)writerHeap);
+} // measure
+
+
+/**
+ * A fixed-shape telemetry message, as published every few seconds.
+ */
+struct Location {
+	double lat;
+	double lon;
+	JSON_FIELDS(Location, lat, lon)
+};
+
+struct Telemetry {
+	char     device[24];
+	uint32_t t;
+	float    temp;
+	float    humidity;
+	int      rssi;
+	bool     ok;
+	Location location;
+	JSON_FIELDS(Telemetry, device, t, temp, humidity, rssi, ok, location)
+};
+
+
+/**
+ * Read and write a Telemetry message with the JsonArena getters and setters and with JsonStruct.
+ */
+static void measureStruct() {
+	const int COUNT = 20000;
+	std::string text = "{\"device\":\"gateway-01\",\"t\":1508140800,\"temp\":21.5,\"humidity\":40.25,\"rssi\":-67,\"ok\":true,\"location\":{\"lat\":51.5074,\"lon\":-0.1278}}";
+	Telemetry telemetry = {};
+	JsonArena arena(1024);
+
+	size_t heapBefore = s_heapBytes;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < COUNT; i++) {
+		arena.clear();
+		JsonArenaObject object = arena.parseObject(text);
+		std::string device = object.getString("device");
+		strncpy(telemetry.device, device.c_str(), sizeof(telemetry.device) - 1);
+		telemetry.t        = object.getInt("t");
+		telemetry.temp     = object.getDouble("temp");
+		telemetry.humidity = object.getDouble("humidity");
+		telemetry.rssi     = object.getInt("rssi");
+		telemetry.ok       = object.getBoolean("ok");
+		JsonArenaObject location = object.getObject("location");
+		telemetry.location.lat = location.getDouble("lat");
+		telemetry.location.lon = location.getDouble("lon");
+	}
+	double arenaReadUs = microsSince(start) / COUNT;
+	double arenaReadHeap = (double)(s_heapBytes - heapBefore) / COUNT;
+
+	std::string arenaText;
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < COUNT; i++) {
+		arena.clear();
+		JsonArenaObject object = arena.createObject();
+		object.setString("device", telemetry.device);
+		object.setInt("t", telemetry.t);
+		object.setDouble("temp", telemetry.temp);
+		object.setDouble("humidity", telemetry.humidity);
+		object.setInt("rssi", telemetry.rssi);
+		object.setBoolean("ok", telemetry.ok);
+		JsonArenaObject location = arena.createObject();
+		location.setDouble("lat", telemetry.location.lat);
+		location.setDouble("lon", telemetry.location.lon);
+		object.setObject("location", location);
+		arenaText = object.toString();
+	}
+	double arenaWriteUs = microsSince(start) / COUNT;
+	double arenaWriteHeap = (double)(s_heapBytes - heapBefore) / COUNT;
+
+	Telemetry parsed = {};
+	bool ok = true;
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < COUNT; i++) {
+		ok &= JsonStruct::parse(text, &parsed);
+	}
+	double structReadUs = microsSince(start) / COUNT;
+	double structReadHeap = (double)(s_heapBytes - heapBefore) / COUNT;
+	CHECK(ok && strcmp(parsed.device, "gateway-01") == 0 && parsed.t == 1508140800 && parsed.rssi == -67);
+	CHECK(parsed.temp == telemetry.temp && parsed.location.lon == telemetry.location.lon);
+
+	std::string structText;
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < COUNT; i++) {
+		structText = JsonStruct::toString(parsed);
+	}
+	double structWriteUs = microsSince(start) / COUNT;
+	double structWriteHeap = (double)(s_heapBytes - heapBefore) / COUNT;
+	CHECK(structText == text);
+
+	printf("telemetry: %d bytes\n", (int)text.length());
+	printf("  JsonArena getters   %6.2f us a read    heap %5.1f bytes\n", arenaReadUs, arenaReadHeap);
+	printf("  JsonArena setters   %6.2f us a write   heap %5.1f bytes\n", arenaWriteUs, arenaWriteHeap);
+	printf("  JsonStruct parse    %6.2f us a read    heap %5.1f bytes\n", structReadUs, structReadHeap);
+	printf("  JsonStruct toString %6.2f us a write   heap %5.1f bytes\n", structWriteUs, structWriteHeap);
+} // measureStruct
+
+
+struct Limits {
+	int      port;
+	uint8_t  level;
+	uint64_t id;
+	JSON_FIELDS(Limits, port, level, id)
+};
+
+
+static void checkLimits() {
+	JsonArena big(8 << 20);
+	JsonArenaArray array = big.createArray();
+	for (int i = 0; i < 70000; i++) {
+		array.addInt(i);
+	}
+	CHECK(array.size() == 65535 && array.getInt(65534) == 65534 && array.getInt(0) == 0);
+	CHECK(big.getError() == "too many members");
+
+	JsonArena arena(1024);
+	JsonArenaObject parent = arena.createObject();
+	JsonArenaObject child  = arena.createObject();
+	child.setInt("v", 1);
+	parent.setObject("p", child);
+	parent.setObject("q", child);
+	CHECK(parent.toString() == "{\"p\":{\"v\":1}}");
+	CHECK(!arena.getError().empty());
+
+	Limits limits = { 7, 8, 9 };
+	CHECK(JsonStruct::parse("{\"port\":3.5,\"level\":256,\"id\":2.5}", &limits));
+	CHECK(limits.port == 7 && limits.level == 8 && limits.id == 9);
+	CHECK(JsonStruct::parse("{\"port\":4e1,\"level\":255,\"id\":18446744073709551615}", &limits));
+	CHECK(limits.port == 40 && limits.level == 255 && limits.id == UINT64_MAX);
+} // checkLimits
+
+
+int main() {
+	measure("config", makeConfig());
+	measure("history", makeHistory());
+	measureStruct();
+	checkLimits();
+	if (s_failures > 0) {
+		printf("%d checks failed\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
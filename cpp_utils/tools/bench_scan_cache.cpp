@@ -0,0 +1,229 @@
+/*
+ * Replay a trace of BLE advertisements, on a host, through the scan cache and through the
+ * map of parsed devices that BLE::scan used to keep.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o bench_scan_cache bench_scan_cache.cpp
+ *
+ * Usage:
+ * bench_scan_cache [<trace file>]
+ *
+ * A trace file has one advertisement a line:
+ *
+ *   <time in ms> <address as aa:bb:cc:dd:ee:ff> <rssi> <payload in hex>
+ *
+ * such as can be written from the scan results of a device, or converted from btmon output.
+ * Lines starting with # are ignored.  Without a file, a trace is made of a busy place: 300
+ * devices for 60 seconds, most advertising every 100 to 1000 ms with an unchanging payload,
+ * some with a payload that changes, and a stream of devices passing through that are heard
+ * only a few times.
+ */
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BLEAdvertisedData.h"
+#include "BLEScanCache.h"
+#include "HeapCounter.h"
+
+struct Advertisement {
+	uint32_t time;
+	uint8_t  address[6];
+	int8_t   rssi;
+	uint8_t  payload[31];
+};
+
+/**
+ * What BLEDevice held of an advertisement, parsed as BLEDevice::parsePayload does.
+ */
+struct ParsedDevice {
+	std::string           address;
+	int                   rssi;
+	std::string           name;
+	int8_t                txPower;
+	uint16_t              appearance;
+	std::set<std::string> services;
+
+	void parse(const uint8_t* payload, size_t length) {
+		for (auto& field: BLEAdvertisedData(payload, length)) {
+			switch (field.type) {
+				case 0x09:
+					name = std::string((const char*)field.data, field.length);
+					break;
+				case 0x0a:
+					txPower = field.length >= 1 ? field.data[0] : 0;
+					break;
+				case 0x19:
+					appearance = field.length >= 2 ? field.data[0] | (field.data[1] << 8) : 0;
+					break;
+				case 0x02:
+				case 0x03:
+					services.insert(std::string((const char*)field.data, field.length >= 2 ? 2 : 0));
+					break;
+				default:
+					break;
+			}
+		}
+	}
+};
+
+
+static size_t makePayload(uint8_t* payload, int device, int version) {
+	size_t i = 0;
+	payload[i++] = 2; payload[i++] = 0x01; payload[i++] = 0x06;                        // Flags
+	payload[i++] = 3; payload[i++] = 0x03; payload[i++] = 0x0d; payload[i++] = 0x18;   // 16 bit service
+	char name[16];
+	int n = snprintf(name, sizeof(name), "dev-%d", device);
+	payload[i++] = n + 1; payload[i++] = 0x09;
+	memcpy(payload + i, name, n);
+	i += n;
+	payload[i++] = 5; payload[i++] = 0xff; payload[i++] = 0x4c; payload[i++] = 0x00;     // Manufacturer data
+	payload[i++] = version & 0xff; payload[i++] = version >> 8;
+	memset(payload + i, 0, 31 - i);
+	return i;
+}
+
+static std::vector<Advertisement> makeTrace() {
+	std::vector<Advertisement> trace;
+	srand(1);
+	const int DEVICES = 300;
+	const uint32_t DURATION = 60000;
+	for (int d = 0; d < DEVICES + 2000; d++) {
+		bool passing  = d >= DEVICES;           // Heard a few times and gone.
+		bool changing = !passing && d % 10 == 0;
+		uint32_t interval = 100 + rand() % 900;
+		uint32_t start    = passing ? rand() % DURATION : rand() % interval;
+		uint32_t end      = passing ? start + interval * (1 + rand() % 4) : DURATION;
+		int rssi = -40 - rand() % 50;
+		for (uint32_t t = start; t < end && t < DURATION; t += interval) {
+			Advertisement adv;
+			adv.time = t;
+			adv.address[0] = 0xc0 | (d >> 16);
+			adv.address[1] = d >> 8;
+			adv.address[2] = d;
+			adv.address[3] = 0x12; adv.address[4] = 0x34; adv.address[5] = 0x56;
+			adv.rssi = rssi - 3 + rand() % 7;
+			makePayload(adv.payload, d, changing ? t / 5000 : 0);
+			trace.push_back(adv);
+		}
+	}
+	std::sort(trace.begin(), trace.end(), [](const Advertisement& a, const Advertisement& b) {
+		return a.time < b.time;
+	});
+	return trace;
+}
+
+static bool readTrace(const char* fileName, std::vector<Advertisement>& trace) {
+	FILE* pFile = fopen(fileName, "r");
+	if (pFile == nullptr) {
+		perror(fileName);
+		return false;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), pFile) != nullptr) {
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		Advertisement adv;
+		unsigned a[6];
+		int rssi;
+		char hex[128];
+		if (sscanf(line, "%u %x:%x:%x:%x:%x:%x %d %127s", &adv.time, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &rssi, hex) != 9) {
+			fprintf(stderr, "Bad line: %s", line);
+			continue;
+		}
+		for (int i = 0; i < 6; i++) {
+			adv.address[i] = a[i];
+		}
+		adv.rssi = rssi;
+		memset(adv.payload, 0, sizeof(adv.payload));
+		for (size_t i = 0; i < sizeof(adv.payload) && hex[i * 2] != 0 && hex[i * 2 + 1] != 0; i++) {
+			unsigned byte;
+			sscanf(hex + i * 2, "%2x", &byte);
+			adv.payload[i] = byte;
+		}
+		trace.push_back(adv);
+	}
+	fclose(pFile);
+	return true;
+}
+
+
+static unsigned long s_callbacks = 0;
+
+static void onDevice(const BLEScannedDevice& device, BLEScanCacheBase::Change change, const uint8_t* payload, size_t length) {
+	s_callbacks++;
+}
+
+
+/**
+ * Record every advertisement in a cache, and parse only those from new or changed devices.
+ */
+template<size_t CAPACITY>
+static void replay(const std::vector<Advertisement>& trace) {
+	static BLEScanCache<CAPACITY> cache;
+	cache.setOnDevice(onDevice);
+	s_callbacks = 0;
+	size_t heapBefore = s_heapBytes;
+	unsigned long parsed = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto& adv: trace) {
+		BLEScanCacheBase::Change change = cache.update(adv.address, adv.rssi, adv.payload, sizeof(adv.payload), adv.time);
+		if (change == BLEScanCacheBase::NEW || change == BLEScanCacheBase::PAYLOAD_CHANGED) {
+			ParsedDevice device;
+			device.parse(adv.payload, sizeof(adv.payload));
+			parsed++;
+		}
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	char name[40];
+	snprintf(name, sizeof(name), "BLEScanCache<%d>", (int)CAPACITY);
+	printf("%-24s %8.1f ns/adv  %8.1f heap bytes/adv  %6d devices held\n",
+		name, ns / trace.size(), (double)(s_heapBytes - heapBefore) / trace.size(), (int)cache.size());
+	printf("  %lu callbacks, %lu parsed, %u evictions, %d bytes for the cache\n",
+		s_callbacks, parsed, cache.getEvictions(), (int)sizeof(cache));
+} // replay
+
+
+int main(int argc, char* argv[]) {
+	std::vector<Advertisement> trace;
+	if (argc > 1) {
+		if (!readTrace(argv[1], trace)) {
+			return 1;
+		}
+	} else {
+		trace = makeTrace();
+	}
+	std::set<std::string> addresses;
+	for (auto& adv: trace) {
+		addresses.insert(std::string((char*)adv.address, 6));
+	}
+	printf("%d advertisements from %d devices\n", (int)trace.size(), (int)addresses.size());
+
+	// Before: every advertisement parsed into a device and copied into a map by address.
+	{
+		size_t heapBefore = s_heapBytes;
+		std::map<std::string, ParsedDevice> devices;
+		auto start = std::chrono::steady_clock::now();
+		for (auto& adv: trace) {
+			ParsedDevice device;
+			device.address = std::string((char*)adv.address, 6);
+			device.rssi    = adv.rssi;
+			device.parse(adv.payload, sizeof(adv.payload));
+			devices.insert(std::pair<std::string, ParsedDevice>(device.address, device));
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		printf("%-24s %8.1f ns/adv  %8.1f heap bytes/adv  %6d devices held\n",
+			"map of parsed devices", ns / trace.size(), (double)(s_heapBytes - heapBefore) / trace.size(), (int)devices.size());
+	}
+
+	replay<64>(trace);
+	replay<256>(trace);
+	replay<1024>(trace);
+	return 0;
+}
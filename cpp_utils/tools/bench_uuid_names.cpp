@@ -0,0 +1,158 @@
+/*
+ * Compare the lookup of SIG service and characteristic names in BLEAssignedNumbers with the
+ * linear search of std::string tables that BLEUtils used to do, on a host.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o bench_uuid_names bench_uuid_names.cpp ../BLEAssignedNumbers.cpp
+ *
+ * Checks that every service the old table named gets the same name, and that a lookup
+ * allocates nothing, then prints the time and heap bytes of a lookup of each kind for the
+ * UUIDs a GATT client typically meets: mostly known ones, some unknown.  Exits 1 if a check fails.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "BLEAssignedNumbers.h"
+#include "HeapCounter.h"
+
+static const int ITERATIONS = 1000000;
+
+
+/*
+ * The table and lookup BLEUtils::gattServiceToString had.
+ */
+typedef struct {
+	std::string name;
+	std::string type;
+	uint32_t assignedNumber;
+} gattService_t;
+
+static gattService_t* g_gattServices;
+
+static void makeOldTable() {
+	static gattService_t services[] = {
+		{"Alert Notification Service", "org.bluetooth.service.alert_notification", 0x1811},
+		{"Automation IO", "org.bluetooth.service.automation_io",	0x1815 },
+		{"Battery Service","org.bluetooth.service.battery_service",	0x180F},
+		{"Blood Pressure", "org.bluetooth.service.blood_pressure", 0x1810},
+		{"Body Composition", "org.bluetooth.service.body_composition", 0x181B},
+		{"Bond Management", "org.bluetooth.service.bond_management", 0x181E},
+		{"Continuous Glucose Monitoring", "org.bluetooth.service.continuous_glucose_monitoring", 0x181F},
+		{"Current Time Service", "org.bluetooth.service.current_time", 0x1805},
+		{"Cycling Power", "org.bluetooth.service.cycling_power", 0x1818},
+		{"Cycling Speed and Cadence", "org.bluetooth.service.cycling_speed_and_cadence", 0x1816},
+		{"Device Information", "org.bluetooth.service.device_information", 0x180A},
+		{"Environmental Sensing", "org.bluetooth.service.environmental_sensing", 0x181A},
+		{"Generic Access", "org.bluetooth.service.generic_access", 0x1800},
+		{"Generic Attribute", "org.bluetooth.service.generic_attribute", 0x1801},
+		{"Glucose", "org.bluetooth.service.glucose", 0x1808},
+		{"Health Thermometer", "org.bluetooth.service.health_thermometer", 0x1809},
+		{"Heart Rate", "org.bluetooth.service.heart_rate", 0x180D},
+		{"HTTP Proxy", "org.bluetooth.service.http_proxy", 0x1823},
+		{"Human Interface Device", "org.bluetooth.service.human_interface_device", 0x1812},
+		{"Immediate Alert", "org.bluetooth.service.immediate_alert", 0x1802},
+		{"Indoor Positioning", "org.bluetooth.service.indoor_positioning", 0x1821},
+		{"Internet Protocol Support", "org.bluetooth.service.internet_protocol_support", 0x1820},
+		{"Link Loss", "org.bluetooth.service.link_loss", 0x1803},
+		{"Location and Navigation", "org.bluetooth.service.location_and_navigation", 0x1819},
+		{"Next DST Change Service", "org.bluetooth.service.next_dst_change", 0x1807},
+		{"Object Transfer", "org.bluetooth.service.object_transfer", 0x1825},
+		{"Phone Alert Status Service", "org.bluetooth.service.phone_alert_status", 0x180E},
+		{"Pulse Oximeter", "org.bluetooth.service.pulse_oximeter", 0x1822},
+		{"Reference Time Update Service", "org.bluetooth.service.reference_time_update", 0x1806},
+		{"Running Speed and Cadence", "org.bluetooth.service.running_speed_and_cadence", 0x1814},
+		{"Scan Parameters", "org.bluetooth.service.scan_parameters", 0x1813},
+		{"Transport Discovery", "org.bluetooth.service.transport_discovery", 0x1824},
+		{"Tx Power", "org.bluetooth.service.tx_power", 0x1804},
+		{"User Data", "org.bluetooth.service.user_data", 0x181C},
+		{"Weight Scale", "org.bluetooth.service.weight_scale", 0x181D},
+		{"", "", 0 }
+	};
+	g_gattServices = services;
+}
+
+static std::string oldServiceName(uint32_t serviceId) {
+	gattService_t *p = g_gattServices;
+	while (p->name.length() > 0) {
+		if (p->assignedNumber == serviceId) {
+			return p->name;
+		}
+		p++;
+	}
+	return "Unknown";
+}
+
+
+int main() {
+	makeOldTable();
+	bool ok = true;
+
+	// The same names as before, for every service the old table knew.
+	for (gattService_t* p = g_gattServices; p->name.length() > 0; p++) {
+		if (p->name != BLEAssignedNumbers::serviceName(p->assignedNumber) ||
+				p->type != BLEAssignedNumbers::serviceType(p->assignedNumber)) {
+			printf("FAILED: service 0x%04x is \"%s\"\n", p->assignedNumber, BLEAssignedNumbers::serviceName(p->assignedNumber));
+			ok = false;
+		}
+	}
+	for (uint32_t uuid = 0; uuid <= 0xffff; uuid++) {
+		if (oldServiceName(uuid) != BLEAssignedNumbers::serviceName(uuid)) {
+			printf("FAILED: service 0x%04x differs\n", uuid);
+			ok = false;
+		}
+	}
+	if (strcmp(BLEAssignedNumbers::characteristicName(0x2a19), "Battery Level") != 0 ||
+			strcmp(BLEAssignedNumbers::characteristicName(0x2a00), "Device Name") != 0 ||
+			strcmp(BLEAssignedNumbers::characteristicName(0x2aa7), "CGM Measurement") != 0 ||
+			strcmp(BLEAssignedNumbers::characteristicName(0x2a0b), "Unknown") != 0 ||
+			strcmp(BLEAssignedNumbers::characteristicName(0xffff), "Unknown") != 0) {
+		printf("FAILED: characteristic names\n");
+		ok = false;
+	}
+
+	// Mostly services a client meets, one in eight unknown.
+	static const uint16_t uuids[] = { 0x1800, 0x1801, 0x180a, 0x180f, 0x180d, 0x1812, 0x1825, 0xfe95 };
+	size_t total = 0;
+
+	size_t heapBefore = s_heapBytes;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		total += oldServiceName(uuids[i % 8]).length();
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	printf("%-32s %8.1f ns/lookup  %6.1f heap bytes/lookup\n", "linear std::string table",
+		ns / ITERATIONS, (double)(s_heapBytes - heapBefore) / ITERATIONS);
+
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		total += strlen(BLEAssignedNumbers::serviceName(uuids[i % 8]));
+	}
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	size_t heap = s_heapBytes - heapBefore;
+	printf("%-32s %8.1f ns/lookup  %6.1f heap bytes/lookup\n", "BLEAssignedNumbers::serviceName",
+		ns / ITERATIONS, (double)heap / ITERATIONS);
+	if (heap != 0) {
+		printf("FAILED: serviceName allocated %d bytes\n", (int)heap);
+		ok = false;
+	}
+
+	heapBefore = s_heapBytes;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++) {
+		total += strlen(BLEAssignedNumbers::characteristicName(0x2a00 + (i & 0xff)));
+	}
+	ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	heap = s_heapBytes - heapBefore;
+	printf("%-32s %8.1f ns/lookup  %6.1f heap bytes/lookup\n", "characteristicName",
+		ns / ITERATIONS, (double)heap / ITERATIONS);
+	if (heap != 0) {
+		printf("FAILED: characteristicName allocated %d bytes\n", (int)heap);
+		ok = false;
+	}
+
+	printf("(%d characters)\n", (int)total);
+	return ok ? 0 : 1;
+}
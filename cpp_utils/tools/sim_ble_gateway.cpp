@@ -0,0 +1,431 @@
+/*
+ * Replay a trace of BLE advertisements, on a host, through the gateway pipeline at 1000
+ * advertisements a second.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -pthread -I.. -o sim_ble_gateway sim_ble_gateway.cpp ../BLEGateway.cpp
+ *
+ * Usage:
+ * sim_ble_gateway [<trace file>]
+ *
+ * The trace file is as for bench_scan_cache: one advertisement a line,
+ *
+ *   <time in ms> <address as aa:bb:cc:dd:ee:ff> <rssi> <payload in hex>
+ *
+ * Without a file, a trace is made of 200 beacons heard for 60 seconds, every 250 ms on average,
+ * a tenth of them with a payload that changes every 700 ms, and 1500 devices passing through
+ * that are each heard 8 times: 1000 advertisements a second in all.
+ *
+ * The trace is replayed in simulated time, with process() run every 10 ms as the gateway's task
+ * would be, under several configurations: JSON and binary batches, an allowlist, a sink that
+ * takes 200 ms to send a batch, and a sink that fails.  Every batch is decoded, and the tool
+ * checks that every advertisement is accounted for by one stage or another, that every record
+ * encoded reaches the sink, and that no device is forwarded more often than minIntervalMs.
+ * Then a producer and a consumer thread run the trace through the gateway as fast as they can,
+ * and a million numbers through a bare queue, to check the queue between threads.  Prints what
+ * each stage did.  Exits 1 if a check fails.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BLEGateway.h"
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+struct Advertisement {
+	uint32_t time;
+	uint8_t  address[6];
+	int8_t   rssi;
+	uint8_t  payload[31];
+};
+
+
+static size_t makePayload(uint8_t* payload, int device, int version) {
+	size_t i = 0;
+	payload[i++] = 2; payload[i++] = 0x01; payload[i++] = 0x06;                                // Flags
+	payload[i++] = 3; payload[i++] = 0x03; payload[i++] = 0xaa; payload[i++] = 0xfe;           // Eddystone
+	payload[i++] = 12; payload[i++] = 0x16; payload[i++] = 0xaa; payload[i++] = 0xfe;          // TLM frame
+	payload[i++] = 0x20; payload[i++] = 0x00;
+	payload[i++] = 0x0b; payload[i++] = 0xb8;                                                  // Battery mV
+	payload[i++] = device & 0xff; payload[i++] = 0x00;                                         // Temperature
+	payload[i++] = version >> 8; payload[i++] = version & 0xff; payload[i++] = 0; payload[i++] = 0;
+	memset(payload + i, 0, 31 - i);
+	return i;
+}
+
+static std::vector<Advertisement> makeTrace() {
+	std::vector<Advertisement> trace;
+	srand(1);
+	const int DEVICES = 200;
+	const uint32_t DURATION = 60000;
+	for (int d = 0; d < DEVICES + 1500; d++) {
+		bool passing  = d >= DEVICES;           // Heard for a second or two and gone.
+		bool changing = !passing && d % 10 == 0;
+		uint32_t interval = passing ? 100 + rand() % 200 : 150 + rand() % 200;
+		uint32_t start    = passing ? rand() % DURATION : rand() % interval;
+		uint32_t end      = passing ? start + interval * 8 : DURATION;
+		int rssi = -50 - rand() % 50;
+		for (uint32_t t = start; t < end && t < DURATION; t += interval) {
+			Advertisement adv;
+			adv.time = t;
+			adv.address[0] = 0xc0;
+			adv.address[1] = d >> 8;
+			adv.address[2] = d;
+			adv.address[3] = 0x12; adv.address[4] = 0x34; adv.address[5] = 0x56;
+			adv.rssi = rssi - 3 + rand() % 7;
+			makePayload(adv.payload, d, changing ? t / 700 : 0);
+			trace.push_back(adv);
+		}
+	}
+	std::stable_sort(trace.begin(), trace.end(), [](const Advertisement& a, const Advertisement& b) {
+		return a.time < b.time;
+	});
+	return trace;
+}
+
+static bool readTrace(const char* fileName, std::vector<Advertisement>& trace) {
+	FILE* pFile = fopen(fileName, "r");
+	if (pFile == nullptr) {
+		perror(fileName);
+		return false;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), pFile) != nullptr) {
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		Advertisement adv;
+		unsigned a[6];
+		int rssi;
+		char hex[128];
+		if (sscanf(line, "%u %x:%x:%x:%x:%x:%x %d %127s", &adv.time, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &rssi, hex) != 9) {
+			fprintf(stderr, "Bad line: %s", line);
+			continue;
+		}
+		for (int i = 0; i < 6; i++) {
+			adv.address[i] = a[i];
+		}
+		adv.rssi = rssi;
+		memset(adv.payload, 0, sizeof(adv.payload));
+		for (size_t i = 0; i < sizeof(adv.payload) && hex[i * 2] != 0 && hex[i * 2 + 1] != 0; i++) {
+			unsigned byte;
+			sscanf(hex + i * 2, "%2x", &byte);
+			adv.payload[i] = byte;
+		}
+		trace.push_back(adv);
+	}
+	fclose(pFile);
+	return true;
+}
+
+
+/**
+ * The receiving end of the sink: decodes every batch and keeps when each device was forwarded.
+ */
+struct Server {
+	BLEGateway::format_t         format;
+	uint32_t                     minIntervalMs;
+	uint32_t                     sendMs     = 0;   // Simulated time each send takes.
+	uint32_t                     failEvery  = 0;   // Fail every nth send, or never if 0.
+	uint32_t                     sends      = 0;
+	uint32_t                     records    = 0;   // In the batches accepted.
+	uint32_t                     bytes      = 0;
+	uint32_t                     tooSoon    = 0;   // Devices forwarded within minIntervalMs.
+	uint32_t                     malformed  = 0;
+	uint32_t                     busyUntil  = 0;
+	uint32_t                     now        = 0;
+	std::map<uint64_t, uint32_t> lastForwarded;
+
+	void record(const uint8_t* address, uint32_t time) {
+		uint64_t key = 0;
+		for (int i = 0; i < 6; i++) {
+			key = (key << 8) | address[i];
+		}
+		auto it = lastForwarded.find(key);
+		if (it != lastForwarded.end() && time - it->second < minIntervalMs) {
+			tooSoon++;
+		}
+		lastForwarded[key] = time;
+		records++;
+	}
+
+	bool receive(const uint8_t* data, size_t length) {
+		sends++;
+		busyUntil = now + sendMs;
+		if (failEvery != 0 && sends % failEvery == 0) {
+			return false;
+		}
+		bytes += length;
+		if (format == BLEGateway::FORMAT_BINARY) {
+			decodeBinary(data, length);
+		} else {
+			decodeJSON(data, length);
+		}
+		return true;
+	}
+
+	void decodeBinary(const uint8_t* data, size_t length) {
+		uint32_t count = data[0] | (data[1] << 8);
+		size_t   i     = 6;
+		for (uint32_t n = 0; n < count; n++) {
+			if (i + 12 > length || i + 12 + data[i + 7] > length) {
+				malformed++;
+				return;
+			}
+			uint32_t time = data[i + 8] | (data[i + 9] << 8) | (data[i + 10] << 16) | ((uint32_t)data[i + 11] << 24);
+			record(data + i, time);
+			i += 12 + data[i + 7];
+		}
+		if (i != length) {
+			malformed++;
+		}
+	}
+
+	void decodeJSON(const uint8_t* data, size_t length) {
+		std::string text((const char*)data, length);
+		if (text.front() != '[' || text.back() != ']') {
+			malformed++;
+			return;
+		}
+		for (size_t at = text.find("{\"addr\":"); at != std::string::npos; at = text.find("{\"addr\":", at + 1)) {
+			unsigned a[6];
+			int      rssi;
+			unsigned time;
+			char     hex[128];
+			if (sscanf(text.c_str() + at, "{\"addr\":\"%x:%x:%x:%x:%x:%x\",\"rssi\":%d,\"time\":%u,\"data\":\"%127[0-9a-f]\"}",
+					&a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &rssi, &time, hex) != 9) {
+				malformed++;
+				continue;
+			}
+			uint8_t address[6];
+			for (int i = 0; i < 6; i++) {
+				address[i] = a[i];
+			}
+			record(address, time);
+		}
+	}
+};
+
+
+static void printHeader() {
+	printf("%-14s %8s %6s %5s %7s %6s %6s %7s %7s %7s %6s %5s %5s %9s\n", "", "received", "qdrop", "qhigh",
+		"!allow", "weak", "dup", "thrott", "untrack", "encoded", "sent", "fail", "lost", "bytes");
+}
+
+static void printStats(const char* name, const BLEGateway::stats_t& stats, const Server& server) {
+	printf("%-14s %8u %6u %5u %7u %6u %6u %7u %7u %7u %6u %5u %5u %9u\n", name, stats.received, stats.queueDrops,
+		stats.queueHighWater, stats.notAllowed, stats.weak, stats.duplicates, stats.throttled, stats.untracked,
+		stats.encoded, stats.batches, stats.sinkFailures, stats.sinkDrops, server.bytes);
+}
+
+/**
+ * Check that every advertisement was counted once, and every record encoded was sent or lost.
+ */
+static void checkAccounts(const BLEGateway::stats_t& stats, const Server& server, size_t traceLength) {
+	CHECK(stats.received == traceLength);
+	CHECK(stats.queueDepth == 0);
+	CHECK(stats.batchRecords == 0);
+	CHECK(stats.received == stats.queueDrops + stats.notAllowed + stats.weak + stats.duplicates +
+		stats.throttled + stats.encoded);
+	CHECK(stats.encoded == server.records + stats.sinkDrops);
+	CHECK(stats.batches + stats.sinkFailures == server.sends);
+	CHECK(server.malformed == 0);
+	CHECK(stats.untracked != 0 || server.tooSoon == 0);
+}
+
+
+/**
+ * Replay a trace in simulated time, running process() every 10 ms unless the sink is busy.
+ */
+static void replay(const char* name, const std::vector<Advertisement>& trace, BLEGateway::config_t config,
+		int allowed, uint32_t sendMs, uint32_t failEvery) {
+	Server server;
+	server.format        = config.format;
+	server.minIntervalMs = config.minIntervalMs;
+	server.sendMs        = sendMs;
+	server.failEvery     = failEvery;
+	BLEGateway gateway([&server](const uint8_t* data, size_t length) {
+		return server.receive(data, length);
+	}, config);
+	for (int d = 0; d < allowed; d++) {
+		uint8_t address[6] = {0xc0, 0x00, (uint8_t)(d * 5), 0x12, 0x34, 0x56};
+		CHECK(gateway.allow(address));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t   next = 0;
+	uint32_t now  = 0;
+	for (; next < trace.size(); now++) {
+		for (; next < trace.size() && trace[next].time <= now; next++) {
+			const Advertisement& adv = trace[next];
+			gateway.onAdvertisement(adv.address, adv.rssi, adv.payload, sizeof(adv.payload), adv.time);
+		}
+		if (now % 10 == 0 && now >= server.busyUntil) {
+			server.now = now;
+			gateway.process(now);
+		}
+	}
+	server.now = now;
+	gateway.flush();
+	gateway.process(now);
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	BLEGateway::stats_t stats = gateway.getStats();
+	printStats(name, stats, server);
+	printf("%-14s %.0f ns of host time an advertisement\n", "", ns / trace.size());
+	checkAccounts(stats, server, trace.size());
+	if (sendMs == 0) {
+		CHECK(stats.queueDrops == 0);
+	}
+} // replay
+
+
+/**
+ * Run a trace through the gateway from a producer thread while a consumer thread processes it.
+ */
+static void threaded(const std::vector<Advertisement>& trace) {
+	Server server;
+	server.format        = BLEGateway::FORMAT_BINARY;
+	server.minIntervalMs = 0;
+	BLEGateway::config_t config = BLEGateway::DEFAULT_CONFIG;
+	config.format        = BLEGateway::FORMAT_BINARY;
+	config.minIntervalMs = 0;
+	config.refreshMs     = 1;   // Forward every advertisement that is not weak.
+	BLEGateway gateway([&server](const uint8_t* data, size_t length) {
+		return server.receive(data, length);
+	}, config);
+
+	std::atomic<bool>     done(false);
+	std::atomic<uint32_t> now(0);
+	auto start = std::chrono::steady_clock::now();
+	std::thread consumer([&]() {
+		while (!done.load()) {
+			gateway.process(now.load());
+			std::this_thread::yield();
+		}
+		gateway.flush();
+		gateway.process(now.load());
+	});
+	for (auto& adv: trace) {
+		now.store(adv.time);
+		while (!gateway.onAdvertisement(adv.address, adv.rssi, adv.payload, sizeof(adv.payload), adv.time)) {
+			// Count the drop, and offer the same advertisement again until the consumer makes room.
+			std::this_thread::yield();
+		}
+	}
+	done.store(true);
+	consumer.join();
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	BLEGateway::stats_t stats = gateway.getStats();
+	printStats("two threads", stats, server);
+	printf("%-14s %.0f ns an advertisement, end to end\n", "", ns / trace.size());
+	CHECK(stats.received == trace.size() + stats.queueDrops);
+	CHECK(stats.queueDepth == 0);
+	CHECK(stats.received == stats.queueDrops + stats.notAllowed + stats.weak + stats.duplicates +
+		stats.throttled + stats.encoded);
+	CHECK(stats.encoded == server.records);
+	CHECK(stats.weak + stats.encoded == trace.size());
+	CHECK(server.malformed == 0);
+} // threaded
+
+
+/**
+ * Pass a sequence of numbers through a bare queue between two threads, and check it arrives in
+ * order and complete.
+ */
+static void sequence() {
+	static SPSCQueue<uint32_t, 256> queue;
+	const uint32_t COUNT = 1000000;
+	uint32_t fullPushes = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::thread consumer([]() {
+		uint32_t expected = 0;
+		uint32_t value;
+		while (expected < COUNT) {
+			if (queue.pop(&value)) {
+				if (value != expected) {
+					printf("FAILED: popped %u, expected %u\n", value, expected);
+					s_failures++;
+					return;
+				}
+				expected++;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+	for (uint32_t i = 0; i < COUNT; i++) {
+		while (!queue.push(i)) {
+			fullPushes++;
+			std::this_thread::yield();
+		}
+	}
+	consumer.join();
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	printf("SPSCQueue: %u numbers in order, %.1f ns each, %u pushes found it full\n", COUNT, ns / COUNT, fullPushes);
+	CHECK(queue.empty());
+} // sequence
+
+
+int main(int argc, char* argv[]) {
+	std::vector<Advertisement> trace;
+	if (argc > 1) {
+		if (!readTrace(argv[1], trace)) {
+			return 1;
+		}
+	} else {
+		trace = makeTrace();
+	}
+	if (trace.empty()) {
+		printf("No advertisements\n");
+		return 1;
+	}
+	uint32_t duration = trace.back().time - trace.front().time + 1;
+	printf("%u advertisements in %u ms: %.0f a second\n\n", (unsigned)trace.size(), duration,
+		trace.size() * 1000.0 / duration);
+
+	printHeader();
+	BLEGateway::config_t config = BLEGateway::DEFAULT_CONFIG;
+	replay("json", trace, config, 0, 0, 0);
+
+	config.format = BLEGateway::FORMAT_BINARY;
+	replay("binary", trace, config, 0, 0, 0);
+
+	replay("allowlist", trace, config, 20, 0, 0);
+
+	replay("slow sink", trace, config, 0, 200, 0);
+
+	replay("failing sink", trace, config, 0, 0, 4);
+
+	config.minRSSI       = -127;
+	config.minIntervalMs = 0;
+	config.refreshMs     = 0;
+	replay("payload only", trace, config, 0, 0, 0);
+
+	printf("\n");
+	printHeader();
+	threaded(trace);
+	sequence();
+
+	if (s_failures > 0) {
+		printf("%d checks FAILED\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,309 @@
+/*
+ * Run the GATT client manager, on a host, against simulated peers.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o test_client_manager test_client_manager.cpp ../BLEClientManager.cpp ../BLEAttributeCache.cpp
+ *
+ * Checks that discovery finds every attribute of a peer, pipelined and one request at a time,
+ * with the same requests and, as the peer answers one at a time, in no more time; that a peer
+ * connected again loads its database from the store instead of discovering it, and discovers it
+ * again if the saved database is damaged or the peer indicates Service Changed; that a failing
+ * search closes the connection and saves nothing; that reads and writes made before the
+ * connection is ready are sent when it is; and that several peers are served at once.  Prints
+ * the simulated time and requests each discovery took.  Exits 1 if a check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include "BLESimulatedPeer.h"
+
+static const uint32_t ROUND_TRIP_MS = 30;   // About 4 connection events at 7.5 ms.
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+
+/**
+ * A peer with the given number of services, each with characteristics that have descriptors.
+ * The first service is the battery service with the battery level characteristic.
+ */
+static BLEAttributeDatabase makeDatabase(int services, int characteristics, int descriptors) {
+	BLEAttributeDatabase database;
+	uint8_t uuid[16];
+	for (int s = 0; s < services; s++) {
+		BLEAttributeId serviceId;
+		if (s == 0) {
+			serviceId = BLEAttributeId::fromUUID16(0x180f);
+		} else {
+			memset(uuid, 0x10 + s, sizeof(uuid));
+			serviceId = BLEAttributeId::fromUUID128(uuid);
+		}
+		int service = database.addService(serviceId, true);
+		for (int c = 0; c < characteristics; c++) {
+			BLEAttributeId characteristicId = (s == 0 && c == 0) ?
+				BLEAttributeId::fromUUID16(0x2a19) : BLEAttributeId::fromUUID16(0x2a00 + c, c % 2);
+			int characteristic = database.addCharacteristic(service, characteristicId, 0x1a);
+			for (int d = 0; d < descriptors; d++) {
+				database.addDescriptor(characteristic, BLEAttributeId::fromUUID16(0x2902 + d));
+			}
+		}
+	}
+	return database;
+} // makeDatabase
+
+
+/**
+ * Has the database found every attribute of the peer, under the right parent, and no others?
+ * Pipelined discovery finds them in another order than the peer holds them.
+ */
+static bool sameDatabase(const BLEAttributeDatabase& found, const BLEAttributeDatabase& peer) {
+	if (found.services.size() != peer.services.size() ||
+			found.characteristics.size() != peer.characteristics.size() ||
+			found.descriptors.size() != peer.descriptors.size()) {
+		return false;
+	}
+	for (auto& descriptor: peer.descriptors) {
+		const BLEAttributeDatabase::Characteristic& characteristic = peer.characteristics[descriptor.characteristic];
+		const BLEAttributeDatabase::Service& service = peer.services[characteristic.service];
+		int s = found.findService(service.id);
+		int c = found.findCharacteristic(s, characteristic.id);
+		if (s < 0 || c < 0 || found.findDescriptor(c, descriptor.id) < 0 ||
+				found.characteristics[c].properties != characteristic.properties) {
+			return false;
+		}
+	}
+	return true;
+} // sameDatabase
+
+
+static void makeAddress(int n, uint8_t* address) {
+	static const uint8_t base[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x00 };
+	memcpy(address, base, 6);
+	address[5] = n;
+} // makeAddress
+
+
+/**
+ * Connect to one peer and wait for its database.
+ * @return The simulated ms it took to be ready.
+ */
+static uint32_t discover(BLEClientManager& manager, BLESimulatedPeer& simulator, const uint8_t* address,
+		const BLEAttributeDatabase& peer, bool* pFromCache) {
+	uint32_t start = simulator.getTime();
+	uint32_t readyAt = 0;
+	manager.setOnReady([&](const uint8_t*, uint16_t, bool fromCache) {
+		readyAt = simulator.getTime();
+		*pFromCache = fromCache;
+	});
+	CHECK(manager.connect(address));
+	simulator.run();
+	CHECK(manager.getState(address) == BLEClientManager::STATE_READY);
+	const BLEAttributeDatabase* pDatabase = manager.getDatabase(address);
+	CHECK(pDatabase != nullptr && sameDatabase(*pDatabase, peer));
+	return readyAt - start;
+} // discover
+
+
+int main() {
+	char directory[] = "/tmp/gattcacheXXXXXX";
+	if (mkdtemp(directory) == nullptr) {
+		perror("mkdtemp");
+		return 1;
+	}
+	BLEAttributeDatabase peer = makeDatabase(6, 5, 2);
+	printf("Peer: %d services, %d characteristics, %d descriptors, %u ms a round trip\n",
+		(int)peer.services.size(), (int)peer.characteristics.size(), (int)peer.descriptors.size(), ROUND_TRIP_MS);
+	uint8_t address[6];
+	makeAddress(1, address);
+
+	// Discovery one request at a time, and pipelined.
+	uint32_t sequentialMs;
+	uint32_t pipelinedMs;
+	uint32_t sequentialRequests;
+	{
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		simulator.addPeer(address, peer);
+		BLEClientManager manager(&simulator);
+		simulator.setManager(&manager);
+		manager.setPipelined(false);
+		bool fromCache = true;
+		sequentialMs = discover(manager, simulator, address, peer, &fromCache);
+		CHECK(!fromCache);
+		sequentialRequests = simulator.getRequests();
+		printf("%-24s %6u ms  %4u requests\n", "sequential discovery", sequentialMs, sequentialRequests);
+	}
+	BLEAttributeFileStore store(directory);
+	{
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		simulator.addPeer(address, peer);
+		BLEClientManager manager(&simulator, &store);
+		simulator.setManager(&manager);
+		bool fromCache = true;
+		pipelinedMs = discover(manager, simulator, address, peer, &fromCache);
+		CHECK(!fromCache);
+		printf("%-24s %6u ms  %4u requests\n", "pipelined discovery", pipelinedMs, simulator.getRequests());
+		CHECK(pipelinedMs <= sequentialMs);
+		CHECK(simulator.getRequests() == sequentialRequests);
+
+		// Connected again: the database is loaded.
+		manager.disconnect(address);
+		simulator.run();
+		CHECK(manager.getState(address) == BLEClientManager::STATE_IDLE);
+		uint32_t requests = simulator.getRequests();
+		uint32_t cachedMs = discover(manager, simulator, address, peer, &fromCache);
+		CHECK(fromCache);
+		CHECK(cachedMs == ROUND_TRIP_MS);
+		printf("%-24s %6u ms  %4u requests\n", "from the store", cachedMs, simulator.getRequests() - requests);
+		BLEClientManager::stats_t stats = manager.getStats();
+		CHECK(stats.connects == 2 && stats.cacheHits == 1);
+	}
+
+	// A damaged saved database is discovered again.
+	{
+		std::string data;
+		CHECK(store.load(address, &data));
+		data[data.length() / 2] ^= 0x40;
+		store.save(address, data);
+		BLEAttributeDatabase database;
+		CHECK(!database.deserialize((const uint8_t*)data.data(), data.length()));
+		CHECK(database.services.empty());
+		CHECK(!database.deserialize((const uint8_t*)data.data(), 7));
+
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		simulator.addPeer(address, peer);
+		BLEClientManager manager(&simulator, &store);
+		simulator.setManager(&manager);
+		bool fromCache = true;
+		discover(manager, simulator, address, peer, &fromCache);
+		CHECK(!fromCache);
+		CHECK(manager.getStats().cacheHits == 0);
+		CHECK(store.load(address, &data) && database.deserialize((const uint8_t*)data.data(), data.length()));
+
+		// forget() drops the saved database.
+		manager.forget(address);
+		CHECK(!store.load(address, &data));
+	}
+
+	// A search that fails closes the connection and saves nothing.
+	{
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		simulator.addPeer(address, peer);
+		BLEClientManager manager(&simulator, &store);
+		simulator.setManager(&manager);
+		simulator.failLists(0x85);
+		bool ready = false;
+		bool closed = false;
+		manager.setOnReady([&](const uint8_t*, uint16_t, bool) { ready = true; });
+		manager.setOnClosed([&](const uint8_t*) { closed = true; });
+		CHECK(manager.connect(address));
+		simulator.run();
+		CHECK(!ready && closed);
+		CHECK(manager.getState(address) == BLEClientManager::STATE_IDLE);
+		std::string data;
+		CHECK(!store.load(address, &data));
+	}
+
+	// Service Changed drops the saved database and finds the new one.
+	{
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		simulator.addPeer(address, peer);
+		BLEClientManager manager(&simulator, &store);
+		simulator.setManager(&manager);
+		bool fromCache = true;
+		discover(manager, simulator, address, peer, &fromCache);
+		CHECK(!fromCache);
+		BLEAttributeDatabase changed = makeDatabase(7, 3, 1);
+		int readies = 0;
+		manager.setOnReady([&](const uint8_t*, uint16_t, bool fromCache) {
+			CHECK(!fromCache);
+			readies++;
+		});
+		simulator.changeDatabase(address, changed);
+		simulator.run();
+		CHECK(readies == 1);
+		CHECK(manager.getState(address) == BLEClientManager::STATE_READY);
+		const BLEAttributeDatabase* pDatabase = manager.getDatabase(address);
+		CHECK(pDatabase != nullptr && sameDatabase(*pDatabase, changed));
+		std::string data;
+		BLEAttributeDatabase saved;
+		CHECK(store.load(address, &data) && saved.deserialize((const uint8_t*)data.data(), data.length()));
+		CHECK(sameDatabase(saved, changed));
+		manager.forget(address);
+	}
+
+	// Reads and writes made before the connection is ready, and on several peers at once.
+	{
+		BLESimulatedPeer simulator(ROUND_TRIP_MS);
+		BLEClientManager manager(&simulator, &store);
+		simulator.setManager(&manager);
+		uint8_t addresses[BLEClientManager::MAX_CONNECTIONS + 1][6];
+		for (int i = 0; i <= BLEClientManager::MAX_CONNECTIONS; i++) {
+			makeAddress(10 + i, addresses[i]);
+			simulator.addPeer(addresses[i], makeDatabase(3 + i, 4, 1));
+		}
+		for (int i = 0; i < BLEClientManager::MAX_CONNECTIONS; i++) {
+			CHECK(manager.connect(addresses[i]));
+		}
+		CHECK(!manager.connect(addresses[BLEClientManager::MAX_CONNECTIONS]));
+
+		BLEAttributeId battery = BLEAttributeId::fromUUID16(0x180f);
+		BLEAttributeId level   = BLEAttributeId::fromUUID16(0x2a19);
+		int reads = 0;
+		int notFound = 0;
+		std::string values[BLEClientManager::MAX_CONNECTIONS];
+		for (int i = 0; i < BLEClientManager::MAX_CONNECTIONS; i++) {
+			uint8_t value = 50 + i;
+			CHECK(manager.write(addresses[i], battery, level, &value, 1, true, nullptr));
+			CHECK(manager.read(addresses[i], battery, level, [&, i](int status, const uint8_t* data, size_t length) {
+				CHECK(status == 0);
+				values[i].assign((const char*)data, length);
+				reads++;
+			}));
+			CHECK(manager.read(addresses[i], battery, BLEAttributeId::fromUUID16(0x2aff),
+				[&](int status, const uint8_t*, size_t) {
+					CHECK(status == BLEClientManager::STATUS_NOT_FOUND);
+					notFound++;
+				}));
+		}
+		simulator.run();
+		CHECK(reads == BLEClientManager::MAX_CONNECTIONS && notFound == BLEClientManager::MAX_CONNECTIONS);
+		for (int i = 0; i < BLEClientManager::MAX_CONNECTIONS; i++) {
+			CHECK(values[i] == std::string(1, (char)(50 + i)));
+		}
+
+		// Queued operations fail when the connection closes.
+		int failed = 0;
+		for (int i = 0; i < 3; i++) {
+			manager.read(addresses[0], battery, level, [&](int status, const uint8_t*, size_t) {
+				if (status == BLEClientManager::STATUS_FAILED) {
+					failed++;
+				}
+			});
+		}
+		manager.disconnect(addresses[0]);
+		simulator.run();
+		CHECK(failed == 2);   // The first was sent, and answered before the close.
+		CHECK(manager.connect(addresses[BLEClientManager::MAX_CONNECTIONS]));
+		simulator.run();
+		CHECK(manager.getState(addresses[BLEClientManager::MAX_CONNECTIONS]) == BLEClientManager::STATE_READY);
+		printf("%-24s %6u ms  %4u operations\n", "5 peers, 4 at once", simulator.getTime(), manager.getStats().operations);
+	}
+
+	std::string command = std::string("rm -rf ") + directory;
+	if (system(command.c_str()) != 0) {
+		printf("Could not remove %s\n", directory);
+	}
+	if (s_failures > 0) {
+		printf("%d checks failed\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
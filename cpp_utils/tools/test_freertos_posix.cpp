@@ -0,0 +1,314 @@
+/*
+ * Run the FreeRTOS, Task, Semaphore and FreeRTOSTimer wrappers on a host, over POSIX threads.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -pthread -I.. -o test_freertos_posix test_freertos_posix.cpp ../FreeRTOS.cpp ../Task.cpp ../FreeRTOSTimer.cpp
+ *
+ * Checks that the time advances a tick at a time; that a task runs with its data; that delays
+ * are rounded down to ticks as vTaskDelay() rounds them; that a semaphore blocks until it is
+ * given from another task, gives up after its timeout, and excludes four tasks from each other;
+ * and that a timer fires at its period without drifting, once if it does not reload, never
+ * after it is stopped, and always on the one timer thread.  Then times the hand over of a
+ * semaphore from one task to another.  Exits 1 if a check fails.
+ *
+ * The time checks allow 30 ms for a busy host.
+ */
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "FreeRTOS.h"
+#include "FreeRTOSTimer.h"
+#include "Task.h"
+
+static const int SLACK_MS = 30;
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+static uint32_t elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+class RecordingTask: public Task {
+public:
+	RecordingTask(): Task("RecordingTask", 2048) {}
+
+	void run(void* data) {
+		m_data = data;
+		char name[16];
+		pthread_getname_np(pthread_self(), name, sizeof(name));
+		m_name = name;
+		m_done.give();
+	}
+
+	FreeRTOS::Semaphore m_done;
+	void*               m_data = nullptr;
+	std::string         m_name;
+};
+
+
+class CountingTask: public Task {
+public:
+	CountingTask(FreeRTOS::Semaphore* pLock, uint32_t* pCount, FreeRTOS::Semaphore* pDone)
+		: Task("CountingTask"), m_pLock(pLock), m_pCount(pCount), m_pDone(pDone) {}
+
+	void run(void* data) {
+		for (int i = 0; i < 100000; i++) {
+			m_pLock->take("count");
+			(*m_pCount)++;
+			m_pLock->give();
+		}
+		m_pDone->give();
+	}
+
+private:
+	FreeRTOS::Semaphore* m_pLock;
+	uint32_t*            m_pCount;
+	FreeRTOS::Semaphore* m_pDone;
+};
+
+
+class GivingTask: public Task {
+public:
+	GivingTask(FreeRTOS::Semaphore* pSemaphore, int delayMs)
+		: Task("GivingTask"), m_pSemaphore(pSemaphore), m_delayMs(delayMs) {}
+
+	void run(void* data) {
+		delay(m_delayMs);
+		m_pSemaphore->give();
+	}
+
+private:
+	FreeRTOS::Semaphore* m_pSemaphore;
+	int                  m_delayMs;
+};
+
+
+/**
+ * Passes a token back and forth with the main task, for the hand over time.
+ */
+class PongTask: public Task {
+public:
+	PongTask(FreeRTOS::Semaphore* pPing, FreeRTOS::Semaphore* pPong, int rounds)
+		: Task("PongTask"), m_pPing(pPing), m_pPong(pPong), m_rounds(rounds) {}
+
+	void run(void* data) {
+		for (int i = 0; i < m_rounds; i++) {
+			m_pPing->take("pong");
+			m_pPong->give();
+		}
+		m_done.give();
+	}
+
+	FreeRTOS::Semaphore m_done;
+
+private:
+	FreeRTOS::Semaphore* m_pPing;
+	FreeRTOS::Semaphore* m_pPong;
+	int                  m_rounds;
+};
+
+
+struct TimerRecord {
+	std::vector<std::chrono::steady_clock::time_point> times;
+	std::vector<pthread_t>                             threads;
+	std::atomic<int>                                   count;
+	int                                                stopAfter;   // Stop the timer from its callback after this many, or never if 0.
+};
+
+static void onTimer(FreeRTOSTimer* pTimer) {
+	TimerRecord* pRecord = (TimerRecord*)pTimer->getData();
+	pRecord->times.push_back(std::chrono::steady_clock::now());
+	pRecord->threads.push_back(pthread_self());
+	if (++pRecord->count == pRecord->stopAfter) {
+		pTimer->stop(0);
+	}
+}
+
+
+static void testTime() {
+	uint32_t first = FreeRTOS::getTimeSinceStart();
+	CHECK(first % portTICK_PERIOD_MS == 0);
+	FreeRTOS::sleep(100);
+	uint32_t later = FreeRTOS::getTimeSinceStart();
+	CHECK(later % portTICK_PERIOD_MS == 0);
+	CHECK(later - first >= 100 && later - first <= 100 + SLACK_MS);
+	printf("Tick %d ms: slept 100 ms from %u to %u\n", portTICK_PERIOD_MS, first, later);
+} // testTime
+
+
+static void testTask() {
+	static RecordingTask task;   // Tasks outlive their threads: runTask() calls stop() after run().
+	static int data = 42;
+	task.m_done.take("main");
+	task.start(&data);
+	task.m_done.take(1000, "main");
+	CHECK(task.m_data == &data);
+	CHECK(task.m_name == "RecordingTask");
+
+	auto start = std::chrono::steady_clock::now();
+	task.delay(200);
+	uint32_t ms = elapsedMs(start);
+	CHECK(ms >= 200 - portTICK_PERIOD_MS && ms <= 200 + SLACK_MS);
+
+	// Less than a tick rounds down to no delay at all, as on the ESP32.
+	start = std::chrono::steady_clock::now();
+	task.delay(portTICK_PERIOD_MS - 1);
+	uint32_t shortMs = elapsedMs(start);
+	CHECK(portTICK_PERIOD_MS == 1 || shortMs < portTICK_PERIOD_MS);
+	printf("Task: ran with its data as \"%s\"; delay(200) took %u ms, delay(%d) took %u ms\n",
+		task.m_name.c_str(), ms, portTICK_PERIOD_MS - 1, shortMs);
+} // testTask
+
+
+static void testSemaphore() {
+	static FreeRTOS::Semaphore semaphore("test");
+	semaphore.take("main");
+
+	// Given by another task after 100 ms.
+	static GivingTask giver(&semaphore, 100);
+	auto start = std::chrono::steady_clock::now();
+	giver.start();
+	semaphore.take("main");
+	uint32_t givenMs = elapsedMs(start);
+	CHECK(givenMs >= 100 - portTICK_PERIOD_MS && givenMs <= 100 + SLACK_MS);
+
+	// Never given: the timed take gives up.
+	start = std::chrono::steady_clock::now();
+	semaphore.take(150, "main");
+	uint32_t timeoutMs = elapsedMs(start);
+	CHECK(timeoutMs >= 150 - portTICK_PERIOD_MS && timeoutMs <= 150 + SLACK_MS);
+	semaphore.give();
+
+	// Excludes.
+	static FreeRTOS::Semaphore lock("lock");
+	static FreeRTOS::Semaphore done[4];
+	static uint32_t count = 0;
+	static CountingTask* tasks[4];
+	for (int i = 0; i < 4; i++) {
+		done[i].take("main");
+		tasks[i] = new CountingTask(&lock, &count, &done[i]);
+		tasks[i]->start();
+	}
+	for (int i = 0; i < 4; i++) {
+		done[i].take("main");
+	}
+	CHECK(count == 400000);
+	printf("Semaphore: given after %u ms, timed out after %u ms, 4 tasks counted to %u\n", givenMs, timeoutMs, count);
+} // testSemaphore
+
+
+static void testTimer() {
+	static char periodicName[] = "periodic";
+	static char onceName[]     = "once";
+	static char selfName[]     = "self";
+	const TickType_t PERIOD = 50 / portTICK_PERIOD_MS;
+	const uint32_t PERIOD_MS = PERIOD * portTICK_PERIOD_MS;
+
+	TimerRecord periodic;
+	periodic.count     = 0;
+	periodic.stopAfter = 0;
+	TimerRecord once;
+	once.count     = 0;
+	once.stopAfter = 0;
+	TimerRecord self;
+	self.count     = 0;
+	self.stopAfter = 3;
+
+	FreeRTOSTimer periodicTimer(periodicName, PERIOD, pdTRUE, &periodic, onTimer);
+	FreeRTOSTimer onceTimer(onceName, PERIOD, pdFALSE, &once, onTimer);
+	FreeRTOSTimer selfTimer(selfName, PERIOD / 2, pdTRUE, &self, onTimer);
+	CHECK(strcmp(periodicTimer.getName(), "periodic") == 0);
+	CHECK(periodicTimer.getData() == &periodic);
+	CHECK(periodicTimer.getPeriod() == PERIOD);
+
+	auto start = std::chrono::steady_clock::now();
+	periodicTimer.start();
+	onceTimer.start();
+	selfTimer.start();
+	FreeRTOS::sleep(1000);
+	periodicTimer.stop();
+	int stoppedAt = periodic.count;
+	FreeRTOS::sleep(200);
+
+	CHECK(periodic.count == stoppedAt);
+	CHECK(periodic.count >= (int)(1000 / PERIOD_MS) - 1 && periodic.count <= (int)(1000 / PERIOD_MS) + 1);
+	CHECK(once.count == 1);
+	CHECK(self.count == 3);
+
+	// The first callback is due a period after the start, rounded to a tick, and each later one a
+	// whole number of periods after the first, however late the last ran.
+	uint32_t firstMs = std::chrono::duration_cast<std::chrono::milliseconds>(periodic.times[0] - start).count();
+	CHECK(firstMs >= PERIOD_MS - portTICK_PERIOD_MS && firstMs <= PERIOD_MS + SLACK_MS);
+	uint32_t worstLateMs = 0;
+	for (size_t i = 1; i < periodic.times.size(); i++) {
+		int64_t dueMs  = (int64_t)i * PERIOD_MS;
+		int64_t tookMs = std::chrono::duration_cast<std::chrono::milliseconds>(periodic.times[i] - periodic.times[0]).count();
+		int64_t lateMs = tookMs - dueMs;
+		CHECK(lateMs > -(int64_t)portTICK_PERIOD_MS && lateMs <= SLACK_MS);
+		if (lateMs > (int64_t)worstLateMs) {
+			worstLateMs = lateMs;
+		}
+	}
+	bool oneThread = true;
+	for (auto thread: periodic.threads) {
+		oneThread = oneThread && pthread_equal(thread, periodic.threads[0]) &&
+			pthread_equal(thread, once.threads[0]) && pthread_equal(thread, self.threads[0]);
+	}
+	CHECK(oneThread);
+
+	// Changing the period of a stopped timer starts it.
+	periodic.count = 0;
+	periodicTimer.changePeriod(PERIOD * 2);
+	CHECK(periodicTimer.getPeriod() == PERIOD * 2);
+	FreeRTOS::sleep(PERIOD_MS * 2 * 3 + PERIOD_MS);
+	periodicTimer.stop();
+	CHECK(periodic.count == 3);
+
+	printf("Timer: %d callbacks of %u ms in 1 s, the first after %u ms, the latest %u ms behind the first; one shot fired %d, self stopped after %d\n",
+		stoppedAt, PERIOD_MS, firstMs, worstLateMs, once.count.load(), self.count.load());
+} // testTimer
+
+
+static void benchmarkHandOver() {
+	const int ROUNDS = 20000;
+	static FreeRTOS::Semaphore ping("ping");
+	static FreeRTOS::Semaphore pong("pong");
+	ping.take("main");
+	pong.take("main");
+	static PongTask task(&ping, &pong, ROUNDS);
+	task.m_done.take("main");
+	task.start();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ROUNDS; i++) {
+		ping.give();
+		pong.take("main");
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	task.m_done.take("main");   // Do not end the program while the task is still in run().
+	printf("Semaphore hand over between two tasks: %.0f ns\n", ns / ROUNDS / 2);
+} // benchmarkHandOver
+
+
+int main() {
+	testTime();
+	testTask();
+	testSemaphore();
+	testTimer();
+	benchmarkHandOver();
+	if (s_failures > 0) {
+		printf("%d checks FAILED\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
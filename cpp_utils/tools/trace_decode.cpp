@@ -0,0 +1,50 @@
+/*
+ * Decode the dumps written by Trace::dump(), on a host.
+ *
+ * Build:
+ * g++ -std=gnu++11 -O2 -I.. -o trace_decode trace_decode.cpp ../Trace.cpp
+ *
+ * Usage:
+ * trace_decode [--chrome] <dump file>
+ *
+ * With --chrome the events are written as Chrome trace JSON, which chrome://tracing and
+ * Perfetto can show, and otherwise as lines of text.  The dump file may hold a sequence of
+ * dumps from one run, such as those captured from a socket.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Trace.h"
+
+int main(int argc, char* argv[]) {
+	bool chrome = argc == 3 && strcmp(argv[1], "--chrome") == 0;
+	if (argc != (chrome ? 3 : 2)) {
+		fprintf(stderr, "Usage: %s [--chrome] <dump file>\n", argv[0]);
+		return 2;
+	}
+	FILE* pFile = fopen(argv[argc - 1], "rb");
+	if (pFile == nullptr) {
+		perror(argv[argc - 1]);
+		return 1;
+	}
+	std::string data;
+	char buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+		data.append(buffer, length);
+	}
+	fclose(pFile);
+
+	TraceTextHandler textHandler(stdout);
+	TraceChromeHandler chromeHandler(stdout);
+	TraceDecoder decoder(chrome ? (TraceHandler*)&chromeHandler : (TraceHandler*)&textHandler);
+	bool ok = decoder.decode(data);
+	if (chrome) {
+		chromeHandler.finish();
+	}
+	if (!ok) {
+		fprintf(stderr, "%s: %s\n", argv[argc - 1], decoder.getError().c_str());
+		return 1;
+	}
+	return 0;
+}
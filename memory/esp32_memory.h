@@ -11,8 +11,12 @@
 #include <esp_system.h>
 #include <esp_log.h>
 
-static uint32_t _heapFreeBefore;
-static uint32_t _counter = 0;
+/*
+ * HEAP_CHANGE_START/HEAP_CHANGE_END only report the change in free heap seen by the calling
+ * task.  Use heap_profiler.h to find out who allocated what.
+ */
+static __thread uint32_t _heapFreeBefore;
+static __thread uint32_t _counter = 0;
 
 #define HEAP_CHANGE_START()  _heapFreeBefore = esp_get_free_heap_size()
 #define HEAP_CHANGE_END(_EYECATCHER) { \
@@ -0,0 +1,594 @@
+/*
+ * heap_profiler.c
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef ESP_PLATFORM
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap_profiler.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+
+#define REAL(_NAME) __real_##_NAME
+#define HOOK(_NAME) __wrap_##_NAME
+// On the Xtensa the top bits of a return address hold the caller's register window size.
+#define CALLER() ((void *)(((uint32_t)__builtin_return_address(0) & 0x3fffffff) | 0x40000000))
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+#define LOCK()   portENTER_CRITICAL(&s_lock)
+#define UNLOCK() portEXIT_CRITICAL(&s_lock)
+
+#else
+#include <dlfcn.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define REAL(_NAME) __libc_##_NAME
+#define HOOK(_NAME) _NAME
+#define CALLER() __builtin_return_address(0)
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()   pthread_mutex_lock(&s_lock)
+#define UNLOCK() pthread_mutex_unlock(&s_lock)
+#endif
+
+void *REAL(malloc)(size_t size);
+void  REAL(free)(void *ptr);
+void *REAL(calloc)(size_t count, size_t size);
+void *REAL(realloc)(void *ptr, size_t size);
+
+// C++ operator new and new[], plain and nothrow, by their mangled names, as this is C.
+#if __SIZEOF_SIZE_T__ == 8
+#define NEW               _Znwm
+#define NEW_ARRAY         _Znam
+#define NEW_NOTHROW       _ZnwmRKSt9nothrow_t
+#define NEW_ARRAY_NOTHROW _ZnamRKSt9nothrow_t
+#else
+#define NEW               _Znwj
+#define NEW_ARRAY         _Znaj
+#define NEW_NOTHROW       _ZnwjRKSt9nothrow_t
+#define NEW_ARRAY_NOTHROW _ZnajRKSt9nothrow_t
+#endif
+#define HOOK_OF(_NAME) HOOK(_NAME)   // Expands _NAME first.
+
+typedef void *(*new_t)(size_t size);
+typedef void *(*new_nothrow_t)(size_t size, const void *nothrow);
+
+#ifdef ESP_PLATFORM
+#define REAL_OF(_NAME) REAL(_NAME)
+void *REAL_OF(NEW)(size_t size);
+void *REAL_OF(NEW_ARRAY)(size_t size);
+void *REAL_OF(NEW_NOTHROW)(size_t size, const void *nothrow);
+void *REAL_OF(NEW_ARRAY_NOTHROW)(size_t size, const void *nothrow);
+#define REAL_NEW(_NAME, _TYPE) REAL_OF(_NAME)
+#else
+#define NAME_OF(_NAME) NAME(_NAME)
+#define NAME(_NAME)    #_NAME
+// The operator of the C++ library, found on first use.
+#define REAL_NEW(_NAME, _TYPE) ((_TYPE)dlsym(RTLD_NEXT, NAME_OF(_NAME)))
+#endif
+
+/**
+ * A live allocation.  The table is open addressed with linear probing; ptr is NULL in an
+ * empty slot.
+ */
+typedef struct {
+	void    *ptr;
+	uint32_t size;
+	uint16_t site;
+} live_t;
+
+static live_t              s_live[HEAP_PROFILER_MAX_LIVE];
+static heap_profile_site_t s_sites[HEAP_PROFILER_MAX_SITES];  // Site 0 collects the overflow.
+static int                 s_siteCount;
+static size_t              s_liveBytes;
+static size_t              s_peakBytes;
+static uint32_t            s_untracked;
+static volatile int        s_enabled;
+
+static __thread const char *s_tag;
+static __thread int         s_inProfiler;  // Allocations made by the profiler itself are not recorded.
+
+static uint32_t hashPtr(void *ptr) {
+	return (uint32_t)(((uintptr_t)ptr >> 3) * 2654435761u) & (HEAP_PROFILER_MAX_LIVE - 1);
+} // hashPtr
+
+
+/**
+ * Find the site for the current tag or caller, adding it if it is new.
+ */
+static uint16_t findSite(void *caller) {
+	const char *tag = s_tag;
+	int i;
+	for (i = 1; i < s_siteCount; i++) {
+		if (tag != NULL ? (s_sites[i].tag != NULL && (s_sites[i].tag == tag || strcmp(s_sites[i].tag, tag) == 0))
+				: (s_sites[i].tag == NULL && s_sites[i].caller == caller)) {
+			return i;
+		}
+	}
+	if (s_siteCount == HEAP_PROFILER_MAX_SITES) {
+		return 0;
+	}
+	memset(&s_sites[s_siteCount], 0, sizeof(heap_profile_site_t));
+	s_sites[s_siteCount].tag    = tag;
+	s_sites[s_siteCount].caller = tag == NULL ? caller : NULL;
+	return s_siteCount++;
+} // findSite
+
+
+static void recordAlloc(void *ptr, size_t size, void *caller) {
+	if (ptr == NULL || !s_enabled || s_inProfiler) {
+		return;
+	}
+	LOCK();
+	uint32_t i = hashPtr(ptr);
+	uint32_t probes;
+	for (probes = 0; probes < HEAP_PROFILER_MAX_LIVE && s_live[i].ptr != NULL; probes++) {
+		i = (i + 1) & (HEAP_PROFILER_MAX_LIVE - 1);
+	}
+	if (probes == HEAP_PROFILER_MAX_LIVE) {
+		s_untracked++;
+		UNLOCK();
+		return;
+	}
+	uint16_t site = findSite(caller);
+	s_live[i].ptr  = ptr;
+	s_live[i].size = size;
+	s_live[i].site = site;
+	heap_profile_site_t *pSite = &s_sites[site];
+	pSite->live_bytes += size;
+	pSite->live_count++;
+	pSite->allocs++;
+	if (pSite->live_bytes > pSite->peak_bytes) {
+		pSite->peak_bytes = pSite->live_bytes;
+	}
+	s_liveBytes += size;
+	if (s_liveBytes > s_peakBytes) {
+		s_peakBytes = s_liveBytes;
+	}
+	UNLOCK();
+} // recordAlloc
+
+
+/**
+ * Record a free.
+ * @param [in] ptr The allocation freed.
+ * @param [out] pRemoved If not NULL, given the record removed, for restoreAlloc().
+ * @return 1 if the allocation was being tracked.
+ */
+static int recordFree(void *ptr, live_t *pRemoved) {
+	if (ptr == NULL || s_siteCount == 0) {
+		return 0;
+	}
+	LOCK();
+	uint32_t i = hashPtr(ptr);
+	uint32_t probes;
+	for (probes = 0; probes < HEAP_PROFILER_MAX_LIVE && s_live[i].ptr != ptr; probes++) {
+		if (s_live[i].ptr == NULL) {
+			UNLOCK();
+			return 0;  // Allocated before the profiler started, or untracked.
+		}
+		i = (i + 1) & (HEAP_PROFILER_MAX_LIVE - 1);
+	}
+	if (probes == HEAP_PROFILER_MAX_LIVE) {
+		UNLOCK();
+		return 0;
+	}
+	if (pRemoved != NULL) {
+		*pRemoved = s_live[i];
+	}
+	heap_profile_site_t *pSite = &s_sites[s_live[i].site];
+	pSite->live_bytes -= s_live[i].size;
+	pSite->live_count--;
+	pSite->frees++;
+	s_liveBytes -= s_live[i].size;
+
+	// Delete by shifting back any later entry of the run that would otherwise be unreachable.
+	uint32_t j = i;
+	for (;;) {
+		j = (j + 1) & (HEAP_PROFILER_MAX_LIVE - 1);
+		if (s_live[j].ptr == NULL) {
+			break;
+		}
+		uint32_t home = hashPtr(s_live[j].ptr);
+		if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+			s_live[i] = s_live[j];
+			i = j;
+		}
+	}
+	s_live[i].ptr = NULL;
+	UNLOCK();
+	return 1;
+} // recordFree
+
+
+/**
+ * Put back a record taken out by recordFree(), when the free did not happen after all.
+ */
+static void restoreAlloc(const live_t *pLive) {
+	LOCK();
+	uint32_t i = hashPtr(pLive->ptr);
+	uint32_t probes;
+	for (probes = 0; probes < HEAP_PROFILER_MAX_LIVE && s_live[i].ptr != NULL; probes++) {
+		i = (i + 1) & (HEAP_PROFILER_MAX_LIVE - 1);
+	}
+	heap_profile_site_t *pSite = &s_sites[pLive->site];
+	pSite->frees--;
+	if (probes == HEAP_PROFILER_MAX_LIVE) {
+		s_untracked++;  // The table filled up in the meantime.
+		UNLOCK();
+		return;
+	}
+	s_live[i] = *pLive;
+	pSite->live_bytes += pLive->size;
+	pSite->live_count++;
+	s_liveBytes += pLive->size;
+	UNLOCK();
+} // restoreAlloc
+
+
+void *HOOK(malloc)(size_t size) {
+	void *ptr = REAL(malloc)(size);
+	recordAlloc(ptr, size, CALLER());
+	return ptr;
+} // malloc
+
+
+void HOOK(free)(void *ptr) {
+	recordFree(ptr, NULL);
+	REAL(free)(ptr);
+} // free
+
+
+void *HOOK(calloc)(size_t count, size_t size) {
+	void *ptr = REAL(calloc)(count, size);
+	recordAlloc(ptr, count * size, CALLER());
+	return ptr;
+} // calloc
+
+
+void *HOOK(realloc)(void *ptr, size_t size) {
+	// Record the free first: once the block is freed another thread may be given its address.
+	live_t removed;
+	int    tracked = recordFree(ptr, &removed);
+	void  *newPtr  = REAL(realloc)(ptr, size);
+	if (newPtr == NULL && size != 0) {
+		if (tracked) {
+			restoreAlloc(&removed);  // The block was left as it was.
+		}
+		return NULL;
+	}
+	recordAlloc(newPtr, size, CALLER());
+	return newPtr;
+} // realloc
+
+
+/*
+ * operator new takes its memory from malloc(), so without these hooks every allocation made
+ * with new would be charged to one site, in operator new itself.  They take the memory from
+ * malloc() directly and charge it to the code that used new.  If malloc() fails they hand over
+ * to the library's operator new, to call the new handler and throw or return NULL.
+ * operator delete calls free(), which is recorded, so it needs no hook.
+ */
+void *HOOK_OF(NEW)(size_t size) {
+	void *ptr = REAL(malloc)(size != 0 ? size : 1);
+	if (ptr == NULL) {
+		return REAL_NEW(NEW, new_t)(size);
+	}
+	recordAlloc(ptr, size, CALLER());
+	return ptr;
+} // operator new
+
+
+void *HOOK_OF(NEW_ARRAY)(size_t size) {
+	void *ptr = REAL(malloc)(size != 0 ? size : 1);
+	if (ptr == NULL) {
+		return REAL_NEW(NEW_ARRAY, new_t)(size);
+	}
+	recordAlloc(ptr, size, CALLER());
+	return ptr;
+} // operator new[]
+
+
+void *HOOK_OF(NEW_NOTHROW)(size_t size, const void *nothrow) {
+	void *ptr = REAL(malloc)(size != 0 ? size : 1);
+	if (ptr == NULL) {
+		return REAL_NEW(NEW_NOTHROW, new_nothrow_t)(size, nothrow);
+	}
+	recordAlloc(ptr, size, CALLER());
+	return ptr;
+} // operator new(nothrow)
+
+
+void *HOOK_OF(NEW_ARRAY_NOTHROW)(size_t size, const void *nothrow) {
+	void *ptr = REAL(malloc)(size != 0 ? size : 1);
+	if (ptr == NULL) {
+		return REAL_NEW(NEW_ARRAY_NOTHROW, new_nothrow_t)(size, nothrow);
+	}
+	recordAlloc(ptr, size, CALLER());
+	return ptr;
+} // operator new[](nothrow)
+
+
+/**
+ * Forget everything recorded and start recording.
+ */
+void heap_profiler_start() {
+	LOCK();
+	memset(s_live, 0, sizeof(s_live));
+	memset(&s_sites[0], 0, sizeof(heap_profile_site_t));
+	s_sites[0].tag = "(other)";
+	s_siteCount = 1;
+	s_liveBytes = 0;
+	s_peakBytes = 0;
+	s_untracked = 0;
+	s_enabled   = 1;
+	UNLOCK();
+} // heap_profiler_start
+
+
+/**
+ * Stop recording new allocations.  Frees of allocations already recorded are still recorded.
+ */
+void heap_profiler_stop() {
+	s_enabled = 0;
+} // heap_profiler_stop
+
+
+/**
+ * Set the tag of the allocations made by the calling thread.
+ * @param [in] tag A string that lives as long as the profiler, such as a literal, or NULL to
+ * identify allocations by their caller.
+ * @return The previous tag, to restore later.
+ */
+const char *heap_profiler_set_tag(const char *tag) {
+	const char *previous = s_tag;
+	s_tag = tag;
+	return previous;
+} // heap_profiler_set_tag
+
+
+/**
+ * Get the statistics of each site.
+ * @param [out] sites Where to store the statistics.
+ * @param [in] max The most sites to store.
+ * @return The number of sites stored.
+ */
+int heap_profiler_get_sites(heap_profile_site_t *sites, int max) {
+	LOCK();
+	int count = s_siteCount < max ? s_siteCount : max;
+	memcpy(sites, s_sites, count * sizeof(heap_profile_site_t));
+	UNLOCK();
+	return count;
+} // heap_profiler_get_sites
+
+
+/**
+ * Get the free heap, the largest free block and the totals of the tracked allocations.
+ *
+ * On a Linux host the largest free block is that at the top of the heap, as reported by
+ * mallinfo(); blocks obtained with mmap() are not counted.
+ */
+void heap_profiler_get_summary(heap_profile_summary_t *summary) {
+#ifdef ESP_PLATFORM
+	summary->total_free   = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	summary->largest_free = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	struct mallinfo2 info = mallinfo2();
+	summary->total_free   = info.fordblks;
+	summary->largest_free = info.keepcost;
+#else
+	struct mallinfo info = mallinfo();
+	summary->total_free   = info.fordblks;
+	summary->largest_free = info.keepcost;
+#endif
+	summary->fragmentation = summary->total_free == 0 ? 0 :
+		(uint32_t)(100 - (uint64_t)summary->largest_free * 100 / summary->total_free);
+	LOCK();
+	summary->live_bytes = s_liveBytes;
+	summary->peak_bytes = s_peakBytes;
+	summary->untracked  = s_untracked;
+	UNLOCK();
+} // heap_profiler_get_summary
+
+
+/**
+ * Write a tag as the contents of a JSON string, escaped and cut short if it does not fit.
+ * @return The length written, not counting the NUL that ends it.
+ */
+static size_t escapeTag(char *buffer, size_t length, const char *tag) {
+	static const char hex[] = "0123456789abcdef";
+	size_t used = 0;
+	for (; *tag != 0; tag++) {
+		unsigned char c = *tag;
+		char escaped[6];
+		size_t n = 0;
+		if (c == '"' || c == '\\') {
+			escaped[n++] = '\\';
+			escaped[n++] = c;
+		} else if (c < 0x20) {
+			escaped[n++] = '\\';
+			escaped[n++] = 'u';
+			escaped[n++] = '0';
+			escaped[n++] = '0';
+			escaped[n++] = hex[c >> 4];
+			escaped[n++] = hex[c & 0xf];
+		} else {
+			escaped[n++] = c;
+		}
+		if (used + n >= length) {
+			break;
+		}
+		memcpy(buffer + used, escaped, n);
+		used += n;
+	}
+	buffer[used] = 0;
+	return used;
+} // escapeTag
+
+
+/**
+ * Write a snapshot of the profile as JSON:
+ * {"free":..,"largest":..,"fragmentation":..,"live":..,"peak":..,"untracked":..,
+ *  "sites":[{"tag":"mqtt","live":..,"count":..,"peak":..,"allocs":..,"frees":..},{"caller":"0x400d1234",..}]}
+ * @param [out] buffer Where to write the JSON.
+ * @param [in] length The size of the buffer.
+ * @return The length of the JSON, which is truncated if this is not less than length.
+ */
+int heap_profiler_snapshot_json(char *buffer, size_t length) {
+	heap_profile_summary_t summary;
+	s_inProfiler++;
+	heap_profiler_get_summary(&summary);
+	size_t used = snprintf(buffer, length,
+		"{\"free\":%u,\"largest\":%u,\"fragmentation\":%u,\"live\":%u,\"peak\":%u,\"untracked\":%u,\"sites\":[",
+		(unsigned)summary.total_free, (unsigned)summary.largest_free, summary.fragmentation,
+		(unsigned)summary.live_bytes, (unsigned)summary.peak_bytes, summary.untracked);
+	// Copy one site at a time, so that any number of threads may take snapshots at once.
+	int i;
+	for (i = 0; ; i++) {
+		heap_profile_site_t entry;
+		LOCK();
+		int more = i < s_siteCount;
+		if (more) {
+			entry = s_sites[i];
+		}
+		UNLOCK();
+		if (!more) {
+			break;
+		}
+		char site[96];
+		if (entry.tag != NULL) {
+			size_t n = snprintf(site, sizeof(site), "\"tag\":\"");
+			n += escapeTag(site + n, 64, entry.tag);
+			snprintf(site + n, sizeof(site) - n, "\"");
+		} else {
+			snprintf(site, sizeof(site), "\"caller\":\"%p\"", entry.caller);
+		}
+		used += snprintf(used < length ? buffer + used : NULL, used < length ? length - used : 0,
+			"%s{%s,\"live\":%u,\"count\":%u,\"peak\":%u,\"allocs\":%u,\"frees\":%u}", i == 0 ? "" : ",", site,
+			(unsigned)entry.live_bytes, entry.live_count, (unsigned)entry.peak_bytes, entry.allocs, entry.frees);
+	}
+	used += snprintf(used < length ? buffer + used : NULL, used < length ? length - used : 0, "]}");
+	s_inProfiler--;
+	return used;
+} // heap_profiler_snapshot_json
+
+
+static heap_profiler_callback_t s_callback;
+static void                    *s_callbackArg;
+static uint32_t                 s_intervalMs;
+static volatile int             s_periodic;
+
+#define SNAPSHOT_SIZE (HEAP_PROFILER_MAX_SITES * 110 + 160)
+
+static void periodicTask(void *arg) {
+	(void)arg;
+	char *json = REAL(malloc)(SNAPSHOT_SIZE);
+	while (s_periodic && json != NULL) {
+#ifdef ESP_PLATFORM
+		vTaskDelay(s_intervalMs / portTICK_PERIOD_MS);
+#else
+		usleep(s_intervalMs * 1000);
+#endif
+		if (!s_periodic) {
+			break;
+		}
+		heap_profiler_snapshot_json(json, SNAPSHOT_SIZE);
+		s_inProfiler++;
+		s_callback(json, s_callbackArg);
+		s_inProfiler--;
+	}
+	REAL(free)(json);
+#ifdef ESP_PLATFORM
+	vTaskDelete(NULL);
+#endif
+} // periodicTask
+
+
+#ifndef ESP_PLATFORM
+static void *periodicThread(void *arg) {
+	periodicTask(arg);
+	return NULL;
+} // periodicThread
+#endif
+
+
+/**
+ * Pass a snapshot to a callback periodically, for example to log it or publish it over MQTT.
+ * @param [in] interval_ms The time between snapshots.
+ * @param [in] callback The function given each snapshot as JSON.
+ * @param [in] arg Passed to the callback.
+ * @return 0 on success.
+ */
+int heap_profiler_start_periodic(uint32_t interval_ms, heap_profiler_callback_t callback, void *arg) {
+	if (s_periodic) {
+		return -1;
+	}
+	s_callback    = callback;
+	s_callbackArg = arg;
+	s_intervalMs  = interval_ms;
+	s_periodic    = 1;
+#ifdef ESP_PLATFORM
+	if (xTaskCreate(periodicTask, "heap_profiler", 3072, NULL, 1, NULL) != pdPASS) {
+		s_periodic = 0;
+		return -1;
+	}
+#else
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, periodicThread, NULL) != 0) {
+		s_periodic = 0;
+		return -1;
+	}
+	pthread_detach(thread);
+#endif
+	return 0;
+} // heap_profiler_start_periodic
+
+
+/**
+ * Stop the periodic snapshots, after the current interval.
+ */
+void heap_profiler_stop_periodic() {
+	s_periodic = 0;
+} // heap_profiler_stop_periodic
+
+
+#ifndef ESP_PLATFORM
+static const char *s_exitPath;
+
+static void writeAtExit() {
+	static char json[SNAPSHOT_SIZE];
+	heap_profiler_stop();
+	heap_profiler_snapshot_json(json, sizeof(json));
+	s_inProfiler++;
+	FILE *file = fopen(s_exitPath, "w");
+	if (file != NULL) {
+		fputs(json, file);
+		fclose(file);
+	}
+	s_inProfiler--;
+} // writeAtExit
+
+
+/**
+ * When loaded with HEAP_PROFILER_JSON set in the environment, profile the whole run and write
+ * the final snapshot to the file it names.
+ */
+__attribute__((constructor)) static void autoStart() {
+	s_exitPath = getenv("HEAP_PROFILER_JSON");
+	if (s_exitPath != NULL) {
+		heap_profiler_start();
+		atexit(writeAtExit);
+	}
+} // autoStart
+#endif
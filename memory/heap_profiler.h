@@ -0,0 +1,116 @@
+/*
+ * heap_profiler.h
+ *
+ *  Created on: Oct 16, 2017
+ *      Author: kolban
+ */
+
+#ifndef MAIN_HEAP_PROFILER_H_
+#define MAIN_HEAP_PROFILER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A heap profiler.  Every malloc(), calloc(), realloc() and free() is recorded against a site:
+ * the tag set by the calling thread with heap_profiler_set_tag(), or if there is none the
+ * address the allocation was made from.  C++ operator new and new[] are hooked too, so that an
+ * object made with new is charged to the code that made it rather than to operator new.  For
+ * each site we keep the live bytes and allocations, the high water mark of live bytes and the
+ * count of allocations and frees.
+ *
+ * The allocation functions are hooked at link time:
+ *
+ * * On the ESP32, with the linker's --wrap option.  In the component.mk of the component that
+ *   holds heap_profiler.c:
+ *   COMPONENT_ADD_LDFLAGS += -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=calloc -Wl,--wrap=realloc \
+ *     -Wl,--wrap=_Znwj -Wl,--wrap=_Znaj -Wl,--wrap=_ZnwjRKSt9nothrow_t -Wl,--wrap=_ZnajRKSt9nothrow_t
+ * * On a Linux host, by interposition: heap_profiler.c defines malloc() and friends and passes
+ *   them on to glibc.  Link it into the program, or build it as a shared library and load it
+ *   with LD_PRELOAD:
+ *   gcc -shared -fPIC -O2 -o libheap_profiler.so heap_profiler.c -lpthread -ldl
+ *   With HEAP_PROFILER_JSON=<file> in the environment the whole run is profiled and the final
+ *   snapshot written to the file, so any test program can be profiled in CI:
+ *   HEAP_PROFILER_JSON=heap.json LD_PRELOAD=./libheap_profiler.so ./test_program
+ *
+ * Nothing is recorded until heap_profiler_start() is called.  Allocations made when the table
+ * of live allocations is full are counted as untracked.
+ */
+
+#ifndef HEAP_PROFILER_MAX_LIVE
+#ifdef ESP_PLATFORM
+#define HEAP_PROFILER_MAX_LIVE 1024   // Must be a power of 2.
+#else
+#define HEAP_PROFILER_MAX_LIVE 262144
+#endif
+#endif
+
+#ifndef HEAP_PROFILER_MAX_SITES
+#ifdef ESP_PLATFORM
+#define HEAP_PROFILER_MAX_SITES 32
+#else
+#define HEAP_PROFILER_MAX_SITES 256
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	const char *tag;       // The tag, or NULL for a site identified by its caller.
+	void       *caller;    // The address the allocations were made from, if there is no tag.
+	size_t      live_bytes;
+	size_t      peak_bytes;
+	uint32_t    live_count;
+	uint32_t    allocs;
+	uint32_t    frees;
+} heap_profile_site_t;
+
+typedef struct {
+	size_t   total_free;
+	size_t   largest_free;   // The largest block that could be allocated.
+	uint32_t fragmentation;  // Percent of the free heap not in the largest block.
+	size_t   live_bytes;     // Tracked allocations only.
+	size_t   peak_bytes;
+	uint32_t untracked;
+} heap_profile_summary_t;
+
+typedef void (*heap_profiler_callback_t)(const char *json, void *arg);
+
+void        heap_profiler_start();
+void        heap_profiler_stop();
+const char *heap_profiler_set_tag(const char *tag);
+int         heap_profiler_get_sites(heap_profile_site_t *sites, int max);
+void        heap_profiler_get_summary(heap_profile_summary_t *summary);
+int         heap_profiler_snapshot_json(char *buffer, size_t length);
+int         heap_profiler_start_periodic(uint32_t interval_ms, heap_profiler_callback_t callback, void *arg);
+void        heap_profiler_stop_periodic();
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief Tag the allocations made by this thread until the end of the scope.
+ */
+class HeapProfileScope {
+public:
+	HeapProfileScope(const char *tag) {
+		m_previous = heap_profiler_set_tag(tag);
+	}
+	~HeapProfileScope() {
+		heap_profiler_set_tag(m_previous);
+	}
+private:
+	const char *m_previous;
+};
+#endif
+
+/**
+ * Tag the allocations made by this thread between HEAP_PROFILE_BEGIN and HEAP_PROFILE_END,
+ * which must be in the same block.
+ */
+#define HEAP_PROFILE_BEGIN(_TAG) const char *_heapProfilePrevious = heap_profiler_set_tag(_TAG)
+#define HEAP_PROFILE_END()       heap_profiler_set_tag(_heapProfilePrevious)
+
+#endif /* MAIN_HEAP_PROFILER_H_ */
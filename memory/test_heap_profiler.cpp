@@ -0,0 +1,106 @@
+/*
+ * Check the heap profiler on a host.
+ *
+ * Build:
+ * gcc -O2 -c heap_profiler.c && g++ -O2 -o test_heap_profiler test_heap_profiler.cpp heap_profiler.o -lpthread -ldl
+ *
+ * Checks that allocations made with new and new[] in two functions are charged to two sites,
+ * not to the site of a malloc() made elsewhere, that a tag collects them into one site and that
+ * delete and delete[] record the frees.  Exits 1 if a check fails.
+ */
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include "heap_profiler.h"
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAILED line %d: %s\n", __LINE__, #condition); \
+		s_failures++; \
+	} \
+} while (0)
+
+struct Record {
+	char data[72];
+};
+
+
+__attribute__((noinline)) static Record* makeRecord() {
+	return new Record();
+}
+
+
+__attribute__((noinline)) static char* makeBuffer() {
+	return new char[200];
+}
+
+
+__attribute__((noinline)) static char* makeNothrowBuffer() {
+	return new (std::nothrow) char[136];
+}
+
+
+/**
+ * Find the site holding exactly this many live bytes.
+ */
+static const heap_profile_site_t* findSite(const heap_profile_site_t* sites, int count, size_t liveBytes) {
+	for (int i = 1; i < count; i++) {
+		if (sites[i].live_bytes == liveBytes) {
+			return &sites[i];
+		}
+	}
+	return nullptr;
+}
+
+
+int main() {
+	static heap_profile_site_t sites[HEAP_PROFILER_MAX_SITES];
+	heap_profiler_start();
+	Record* pRecord  = makeRecord();
+	char*   pBuffer  = makeBuffer();
+	char*   pNothrow = makeNothrowBuffer();
+	void* volatile pMalloc = malloc(40);   // volatile, or the compiler drops malloc() and free().
+	int count = heap_profiler_get_sites(sites, HEAP_PROFILER_MAX_SITES);
+	const heap_profile_site_t* pRecordSite  = findSite(sites, count, sizeof(Record));
+	const heap_profile_site_t* pBufferSite  = findSite(sites, count, 200);
+	const heap_profile_site_t* pNothrowSite = findSite(sites, count, 136);
+	const heap_profile_site_t* pMallocSite  = findSite(sites, count, 40);
+	CHECK(pRecordSite != nullptr && pBufferSite != nullptr && pNothrowSite != nullptr && pMallocSite != nullptr);
+	if (pRecordSite != nullptr && pBufferSite != nullptr && pNothrowSite != nullptr && pMallocSite != nullptr) {
+		CHECK(pRecordSite != pBufferSite && pBufferSite != pNothrowSite && pRecordSite != pNothrowSite);
+		CHECK(pRecordSite->allocs == 1 && pBufferSite->allocs == 1 && pNothrowSite->allocs == 1);
+		CHECK(pRecordSite->caller != pMallocSite->caller && pBufferSite->caller != pMallocSite->caller);
+		CHECK(pRecordSite->tag == nullptr && pRecordSite->caller != nullptr);
+	}
+
+	delete pRecord;
+	delete[] pBuffer;
+	delete[] pNothrow;
+	free(pMalloc);
+	count = heap_profiler_get_sites(sites, HEAP_PROFILER_MAX_SITES);
+	for (int i = 0; i < count; i++) {
+		CHECK(sites[i].live_bytes == 0 && sites[i].allocs == sites[i].frees);
+	}
+
+	// A tag gathers the allocations of both functions.
+	{
+		HeapProfileScope scope("records");
+		pRecord = makeRecord();
+		pBuffer = makeBuffer();
+	}
+	count = heap_profiler_get_sites(sites, HEAP_PROFILER_MAX_SITES);
+	const heap_profile_site_t* pTagSite = findSite(sites, count, sizeof(Record) + 200);
+	CHECK(pTagSite != nullptr && pTagSite->tag != nullptr && pTagSite->allocs == 2);
+	delete pRecord;
+	delete[] pBuffer;
+	heap_profiler_stop();
+
+	if (s_failures > 0) {
+		printf("%d checks failed\n", s_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -8,6 +8,7 @@ C_SRCS += \
 ../src/MQTTConnectServer.c \
 ../src/MQTTDeserializePublish.c \
 ../src/MQTTPacket.c \
+../src/MQTTProperties.c \
 ../src/MQTTSerializePublish.c \
 ../src/MQTTSubscribeClient.c \
 ../src/MQTTSubscribeServer.c \
@@ -19,6 +20,7 @@ C_DEPS += \
 ./src/MQTTConnectServer.d \
 ./src/MQTTDeserializePublish.d \
 ./src/MQTTPacket.d \
+./src/MQTTProperties.d \
 ./src/MQTTSerializePublish.d \
 ./src/MQTTSubscribeClient.d \
 ./src/MQTTSubscribeServer.d \
@@ -30,6 +32,7 @@ OBJS += \
 ./src/MQTTConnectServer.o \
 ./src/MQTTDeserializePublish.o \
 ./src/MQTTPacket.o \
+./src/MQTTProperties.o \
 ./src/MQTTSerializePublish.o \
 ./src/MQTTSubscribeClient.o \
 ./src/MQTTSubscribeServer.o \
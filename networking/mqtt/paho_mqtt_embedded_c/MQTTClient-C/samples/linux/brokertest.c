@@ -0,0 +1,336 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Fan-out throughput test for MQTTBroker
+ *******************************************************************************/
+
+/*
+ * One broker, SUBSCRIBERS event clients and one publishing event client, all on one reactor
+ * and connected over loopback TCP.  Half of the subscribers use "sensors/+/temp" and half
+ * "sensors/#"; every publish must reach every subscriber exactly once and in order, and the
+ * retained message must reach only the "sensors/#" subscribers.  A client whose CONNACK refuses
+ * the connection must be closed as soon as the CONNACK arrives.
+ *
+ *   brokertest [--messages n] [--size bytes]
+ *
+ * Exits with 0 on success.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "MQTTBroker.h"
+#include "MQTTEventClient.h"
+
+#define SUBSCRIBERS 6
+#define WINDOW 32 /* publishes in flight to the slowest subscriber - below MQTTBROKER_QUEUE_LEN */
+
+struct Subscriber
+{
+	MQTTEventClient client;
+	unsigned char buf[256];
+	unsigned char readbuf[1024];
+	int subscribed;
+	int received;
+	int retained;
+	int errors;
+};
+
+static struct Subscriber subs[SUBSCRIBERS];
+static MQTTEventClient pub;
+static unsigned char pubbuf[8192], pubreadbuf[256];
+static int connected = 0;
+static MQTTEventClient refused;
+static unsigned char refusedbuf[256], refusedreadbuf[256];
+static int refused_closed = 0, refused_rc = 0;
+
+
+/* The payload points into the readbuf of the client that received it */
+static struct Subscriber* owner(MessageData* md)
+{
+	int i;
+
+	for (i = 0; i < SUBSCRIBERS; ++i)
+	{
+		unsigned char* p = (unsigned char*)md->message->payload;
+
+		if (p >= subs[i].readbuf && p < subs[i].readbuf + sizeof(subs[i].readbuf))
+			return &subs[i];
+	}
+	return NULL;
+}
+
+
+static void onMessage(MessageData* md)
+{
+	struct Subscriber* s = owner(md);
+	int seq;
+
+	if (s == NULL)
+		return;
+	if (md->message->retained)
+	{
+		++s->retained;
+		return;
+	}
+	memcpy(&seq, md->message->payload, sizeof(seq));
+	if (seq != s->received)
+		++s->errors;
+	++s->received;
+}
+
+
+static void onConnected(MQTTEventClient* c, int rc)
+{
+	(void)c;
+	if (rc == 0)
+		++connected;
+}
+
+
+static void onCompleted(MQTTEventClient* c, unsigned short packetid, int rc)
+{
+	struct Subscriber* s = (struct Subscriber*)c->context;
+
+	(void)packetid;
+	if (s && rc >= 0)
+		s->subscribed = 1;
+}
+
+
+static const MQTTEventCallbacks callbacks = { onConnected, onCompleted, NULL };
+
+
+static void onRefusedClosed(MQTTEventClient* c, int rc)
+{
+	(void)c;
+	refused_closed = 1;
+	refused_rc = rc;
+}
+
+
+static const MQTTEventCallbacks refusedCallbacks = { NULL, NULL, onRefusedClosed };
+
+
+static int connectTo(int port)
+{
+	struct sockaddr_in addr;
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		perror("connect");
+		exit(1);
+	}
+	return sock;
+}
+
+
+static int minReceived(void)
+{
+	int i, min = subs[0].received;
+
+	for (i = 1; i < SUBSCRIBERS; ++i)
+	{
+		if (subs[i].received < min)
+			min = subs[i].received;
+	}
+	return min;
+}
+
+
+/* run the reactor until cond() holds, or fail after timeout_ms */
+static void runUntil(MQTTReactor* r, int (*cond)(void), const char* what)
+{
+	unsigned long start = MQTTReactor_nowMS();
+
+	while (!cond())
+	{
+		if (MQTTReactor_run(r, 100) < 0 || MQTTReactor_nowMS() - start > 10000)
+		{
+			printf("FAILED: timed out waiting for %s\n", what);
+			exit(1);
+		}
+	}
+}
+
+
+static int allConnected(void)
+{
+	return connected == SUBSCRIBERS + 1;
+}
+
+
+static int refusedClosed(void)
+{
+	return refused_closed;
+}
+
+
+static int allSubscribed(void)
+{
+	int i;
+
+	for (i = 0; i < SUBSCRIBERS; ++i)
+	{
+		if (!subs[i].subscribed)
+			return 0;
+	}
+	return 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	MQTTReactor reactor;
+	MQTTBroker broker;
+	MQTTMessage message;
+	unsigned char payload[1024];
+	unsigned long start, elapsed;
+	int messages = 100000, size = 32;
+	unsigned char connack[] = { 0x20, 0x02, 0x00, 0x05 };
+	int listener, refuser[2], i, sent = 0, rc = 0;
+
+	for (i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--messages") == 0)
+			messages = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--size") == 0)
+			size = atoi(argv[i + 1]);
+	}
+	if (size < (int)sizeof(int) || size > (int)sizeof(payload))
+		size = 32;
+
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SUBSCRIBERS + 1) != 0 ||
+			getsockname(listener, (struct sockaddr*)&addr, &addrlen) != 0)
+	{
+		perror("listen");
+		return 1;
+	}
+
+	MQTTReactor_init(&reactor);
+	MQTTBroker_init(&broker, &reactor, listener);
+	MQTTBroker_publish(&broker, "sensors/status", (unsigned char*)"up", 2, 1);
+
+	data.keepAliveInterval = 60;
+	data.cleansession = 1;
+	for (i = 0; i < SUBSCRIBERS; ++i)
+	{
+		MQTTEventClient_init(&subs[i].client, &reactor, connectTo(ntohs(addr.sin_port)), 1000,
+			subs[i].buf, sizeof(subs[i].buf), subs[i].readbuf, sizeof(subs[i].readbuf), &callbacks, &subs[i]);
+		MQTTEventClient_connect(&subs[i].client, &data);
+	}
+	MQTTEventClient_init(&pub, &reactor, connectTo(ntohs(addr.sin_port)), 1000,
+		pubbuf, sizeof(pubbuf), pubreadbuf, sizeof(pubreadbuf), &callbacks, NULL);
+	MQTTEventClient_connect(&pub, &data);
+	runUntil(&reactor, allConnected, "CONNACK");
+
+	/* the broker accepts every client, so play a server that refuses one: not authorized */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, refuser) != 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	MQTTEventClient_init(&refused, &reactor, refuser[0], 1000,
+		refusedbuf, sizeof(refusedbuf), refusedreadbuf, sizeof(refusedreadbuf), &refusedCallbacks, NULL);
+	MQTTEventClient_connect(&refused, &data);
+	if (write(refuser[1], connack, sizeof(connack)) != sizeof(connack))
+	{
+		perror("write");
+		return 1;
+	}
+	runUntil(&reactor, refusedClosed, "the refused client to close");
+	if (refused_rc != 5)
+	{
+		printf("FAILED: refused client closed with %d, expected 5\n", refused_rc);
+		rc = 1;
+	}
+	close(refuser[0]);
+	close(refuser[1]);
+
+	for (i = 0; i < SUBSCRIBERS; ++i)
+		MQTTEventClient_subscribe(&subs[i].client, (i % 2) ? "sensors/#" : "sensors/+/temp", QOS0, onMessage);
+	runUntil(&reactor, allSubscribed, "SUBACK");
+
+	memset(payload, 'x', sizeof(payload));
+	memset(&message, 0, sizeof(message));
+	message.qos = QOS0;
+	message.payload = payload;
+	message.payloadlen = size;
+
+	start = MQTTReactor_nowMS();
+	while (minReceived() < messages)
+	{
+		while (sent < messages && sent - minReceived() < WINDOW)
+		{
+			memcpy(payload, &sent, sizeof(sent));
+			if (MQTTEventClient_publish(&pub, "sensors/1/temp", &message) < 0)
+				break; /* send buffer full */
+			++sent;
+		}
+		if (MQTTReactor_run(&reactor, 100) < 0 || MQTTReactor_nowMS() - start > 60000)
+		{
+			printf("FAILED: stalled after %d of %d messages\n", minReceived(), messages);
+			return 1;
+		}
+	}
+	elapsed = MQTTReactor_nowMS() - start;
+
+	for (i = 0; i < SUBSCRIBERS; ++i)
+	{
+		struct Subscriber* s = &subs[i];
+		int retained = (i % 2) ? 1 : 0;
+
+		if (s->received != messages || s->errors != 0 || s->retained != retained)
+		{
+			printf("FAILED: subscriber %d received %d of %d, %d out of order, %d retained (expected %d)\n",
+				i, s->received, messages, s->errors, s->retained, retained);
+			rc = 1;
+		}
+	}
+	if (broker.dropped != 0)
+	{
+		printf("FAILED: broker dropped %lu messages\n", broker.dropped);
+		rc = 1;
+	}
+	printf("%d messages of %d bytes to %d subscribers in %lu ms: %.0f publishes/s, %.0f deliveries/s\n",
+		messages, size, SUBSCRIBERS, elapsed, messages * 1000.0 / (elapsed ? elapsed : 1),
+		messages * (double)SUBSCRIBERS * 1000.0 / (elapsed ? elapsed : 1));
+
+	for (i = 0; i < SUBSCRIBERS; ++i)
+		MQTTEventClient_close(&subs[i].client, SUCCESS);
+	MQTTEventClient_close(&pub, SUCCESS);
+	MQTTBroker_stop(&broker);
+	for (i = 0; i < SUBSCRIBERS; ++i)
+		close(subs[i].client.handle.fd);
+	close(pub.handle.fd);
+	close(listener);
+	printf("%s\n", rc ? "FAILED" : "PASSED");
+	return rc;
+}
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *   http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Event driven client sample
+ *******************************************************************************/
+
+/*
+
+ event driven subscriber / publisher
+
+ Two clients share one reactor and therefore one thread: the first subscribes to a topic
+ and prints what arrives, the second publishes a counter to the same topic once a second
+ from a reactor timer.  Neither ever blocks.
+
+ for example:
+
+    eventsub topic/of/interest iot.eclipse.org
+
+*/
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "MQTTEventClient.h"
+
+
+volatile int toStop = 0;
+char* topic;
+MQTTReactor reactor;
+MQTTReactorTimer publish_timer;
+MQTTEventClient subscriber, publisher;
+
+
+void cfinish(int sig)
+{
+	signal(SIGINT, NULL);
+	toStop = 1;
+}
+
+
+int connectSocket(const char* host, int port)
+{
+	struct addrinfo hints, *result;
+	char service[8];
+	int sock = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if (getaddrinfo(host, service, &hints, &result) != 0)
+		return -1;
+	if ((sock = socket(AF_INET, SOCK_STREAM, 0)) >= 0 && connect(sock, result->ai_addr, result->ai_addrlen) != 0)
+	{
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(result);
+	return sock;
+}
+
+
+void messageArrived(MessageData* md)
+{
+	printf("%.*s\t%.*s\n", md->topicName->lenstring.len, md->topicName->lenstring.data,
+			(int)md->message->payloadlen, (char*)md->message->payload);
+}
+
+
+void publishNext(void* arg)
+{
+	static char payload[16];
+	static int count = 0;
+	static MQTTMessage message;
+
+	message.qos = QOS1;
+	message.payload = payload;
+	message.payloadlen = snprintf(payload, sizeof(payload), "%d", ++count);
+	MQTTEventClient_publish(&publisher, topic, &message);
+	MQTTReactor_schedule(&reactor, &publish_timer, 1000);
+}
+
+
+void connected(MQTTEventClient* c, int rc)
+{
+	printf("%s connected %d\n", (char*)c->context, rc);
+	if (rc != 0)
+		toStop = 1;
+	else if (c == &subscriber)
+		MQTTEventClient_subscribe(c, topic, QOS1, messageArrived);
+	else
+		MQTTReactor_schedule(&reactor, &publish_timer, 1000);
+}
+
+
+void completed(MQTTEventClient* c, unsigned short packetid, int rc)
+{
+	if (rc < 0)
+		printf("%s packet %d failed\n", (char*)c->context, packetid);
+}
+
+
+void closed(MQTTEventClient* c, int rc)
+{
+	printf("%s closed %d\n", (char*)c->context, rc);
+	close(c->handle.fd);
+	toStop = 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	const MQTTEventCallbacks callbacks = {connected, completed, closed};
+	unsigned char subbuf[200], subreadbuf[200], pubbuf[200], pubreadbuf[200];
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	int subsock, pubsock;
+
+	if (argc < 3)
+	{
+		printf("Usage: eventsub topicname host\n");
+		return -1;
+	}
+	topic = argv[1];
+	signal(SIGINT, cfinish);
+	signal(SIGTERM, cfinish);
+
+	if ((subsock = connectSocket(argv[2], 1883)) < 0 || (pubsock = connectSocket(argv[2], 1883)) < 0)
+	{
+		printf("Unable to connect to %s\n", argv[2]);
+		return -1;
+	}
+
+	MQTTReactor_init(&reactor);
+	MQTTReactorTimer_init(&publish_timer, publishNext, NULL);
+	MQTTEventClient_init(&subscriber, &reactor, subsock, 2000, subbuf, sizeof(subbuf),
+			subreadbuf, sizeof(subreadbuf), &callbacks, "subscriber");
+	MQTTEventClient_init(&publisher, &reactor, pubsock, 2000, pubbuf, sizeof(pubbuf),
+			pubreadbuf, sizeof(pubreadbuf), &callbacks, "publisher");
+
+	data.keepAliveInterval = 10;
+	data.clientID.cstring = "event-subscriber";
+	MQTTEventClient_connect(&subscriber, &data);
+	data.clientID.cstring = "event-publisher";
+	MQTTEventClient_connect(&publisher, &data);
+
+	while (!toStop)
+		MQTTReactor_run(&reactor, 1000);
+
+	printf("Stopping\n");
+	MQTTReactor_cancel(&reactor, &publish_timer);
+	MQTTEventClient_disconnect(&subscriber);
+	MQTTEventClient_disconnect(&publisher);
+	return 0;
+}
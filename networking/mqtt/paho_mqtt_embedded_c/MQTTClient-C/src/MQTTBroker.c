@@ -0,0 +1,758 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Small local broker running on an MQTTReactor
+ *******************************************************************************/
+#include "MQTTBroker.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+
+static MQTTBrokerMessage* newMessage(int len)
+{
+	MQTTBrokerMessage* m = malloc(sizeof(MQTTBrokerMessage) + len);
+
+	if (m)
+	{
+		m->refs = 1;
+		m->len = len;
+		m->data = (unsigned char*)(m + 1);
+	}
+	return m;
+}
+
+
+static void releaseMessage(MQTTBrokerMessage* m)
+{
+	if (--m->refs == 0)
+		free(m);
+}
+
+
+/* MQTTTransport getfn: -1 for error or end of stream, 0 to call again later */
+static int brokerRead(void* sck, unsigned char* buf, int len)
+{
+	int rc = recv(*(int*)sck, buf, len, MSG_DONTWAIT);
+
+	if (rc > 0)
+		return rc;
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 0;
+	return -1;
+}
+
+
+/*
+ * Client queues.  A client is never closed from another client's callback, because the
+ * reactor may be walking its handle list; it is marked closing and closes itself when the
+ * reactor next reports its socket writable.
+ */
+
+static void updateWriteInterest(MQTTBrokerClient* c)
+{
+	if (c->queue_count > 0 || c->closing)
+		c->handle.events |= MQTTREACTOR_WRITE;
+	else
+		c->handle.events &= ~MQTTREACTOR_WRITE;
+}
+
+
+static void dropQueue(MQTTBrokerClient* c)
+{
+	while (c->queue_count > 0)
+	{
+		releaseMessage(c->queue[c->queue_head]);
+		c->queue_head = (c->queue_head + 1) % MQTTBROKER_QUEUE_LEN;
+		--c->queue_count;
+	}
+	c->written = 0;
+}
+
+
+static void flush(MQTTBrokerClient* c)
+{
+	while (c->queue_count > 0)
+	{
+		MQTTBrokerMessage* m = c->queue[c->queue_head];
+		int rc = send(c->handle.fd, m->data + c->written, m->len - c->written, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (rc < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				dropQueue(c);
+				c->closing = 1;
+			}
+			break;
+		}
+		if ((c->written += rc) < m->len)
+			break;
+		releaseMessage(m);
+		c->queue_head = (c->queue_head + 1) % MQTTBROKER_QUEUE_LEN;
+		--c->queue_count;
+		c->written = 0;
+	}
+	updateWriteInterest(c);
+}
+
+
+static void enqueue(MQTTBrokerClient* c, MQTTBrokerMessage* m)
+{
+	if (c->closing)
+		return;
+	if (c->queue_count == MQTTBROKER_QUEUE_LEN)
+	{
+		++c->dropped;
+		++c->broker->dropped;
+		return;
+	}
+	++m->refs;
+	c->queue[(c->queue_head + c->queue_count++) % MQTTBROKER_QUEUE_LEN] = m;
+	if (c->queue_count == 1)
+		flush(c); /* try to write it straight away, saving a trip round the reactor */
+	else
+		updateWriteInterest(c);
+}
+
+
+/* queue a packet serialized by fn into a message of its own */
+static void enqueueNew(MQTTBrokerClient* c, unsigned char* buf, int len)
+{
+	MQTTBrokerMessage* m;
+
+	if (len <= 0 || (m = newMessage(len)) == NULL)
+		return;
+	memcpy(m->data, buf, len);
+	enqueue(c, m);
+	releaseMessage(m);
+}
+
+
+/*
+ * The topic trie.  Each node is one level of a topic filter; the node at the end of a
+ * filter holds the bit mask of the clients subscribed to it.
+ */
+
+static MQTTBrokerTopicNode* findChild(MQTTBrokerTopicNode* node, const char* level, int len)
+{
+	MQTTBrokerTopicNode* child;
+
+	for (child = node->child; child; child = child->sibling)
+	{
+		if (child->len == len && memcmp(child->level, level, len) == 0)
+			break;
+	}
+	return child;
+}
+
+
+static MQTTBrokerTopicNode* addChild(MQTTBrokerTopicNode* node, const char* level, int len)
+{
+	MQTTBrokerTopicNode* child = malloc(sizeof(MQTTBrokerTopicNode) + len);
+
+	if (child)
+	{
+		memset(child, 0, sizeof(MQTTBrokerTopicNode));
+		child->parent = node;
+		child->len = len;
+		child->level = (char*)(child + 1);
+		memcpy(child->level, level, len);
+		child->sibling = node->child;
+		node->child = child;
+	}
+	return child;
+}
+
+
+/* free node if it has neither subscribers nor children, returning its parent if so */
+static MQTTBrokerTopicNode* pruneOne(MQTTBrokerTopicNode* node)
+{
+	MQTTBrokerTopicNode* parent = node->parent;
+	MQTTBrokerTopicNode** pp;
+
+	if (parent == NULL || node->subscribers != 0 || node->child != NULL)
+		return NULL;
+	for (pp = &parent->child; *pp != node; pp = &(*pp)->sibling)
+		;
+	*pp = node->sibling;
+	free(node);
+	return parent;
+}
+
+
+/* free node, and then its ancestors, while they have neither subscribers nor children */
+static void prune(MQTTBrokerTopicNode* node)
+{
+	while (node)
+		node = pruneOne(node);
+}
+
+
+/* wildcards must fill a whole level, and # must be the last */
+static int isValidFilter(const char* filter, int len)
+{
+	int i;
+
+	if (len == 0)
+		return 0;
+	for (i = 0; i < len; ++i)
+	{
+		if ((filter[i] == '+' || filter[i] == '#') && ((i > 0 && filter[i - 1] != '/') || (i + 1 < len && filter[i + 1] != '/')))
+			return 0;
+		if (filter[i] == '#' && i + 1 != len)
+			return 0;
+	}
+	return 1;
+}
+
+
+/* walk (and if create is set, build) the trie along a filter */
+static MQTTBrokerTopicNode* findFilter(MQTTBroker* b, const char* filter, int len, int create)
+{
+	MQTTBrokerTopicNode* node = &b->root;
+	const char* end = filter + len;
+	const char* level = filter;
+
+	while (node)
+	{
+		const char* sep = memchr(level, '/', end - level);
+		int levellen = (sep ? sep : end) - level;
+		MQTTBrokerTopicNode* child = findChild(node, level, levellen);
+
+		if (child == NULL && create)
+			child = addChild(node, level, levellen);
+		node = child;
+		if (sep == NULL)
+			break;
+		level = sep + 1;
+	}
+	return node;
+}
+
+
+/* collect the subscribers of every filter that matches the levels from level to end */
+static void match(MQTTBrokerTopicNode* node, const char* level, const char* end, int root, unsigned long* mask)
+{
+	MQTTBrokerTopicNode* child;
+	const char* sep;
+	const char* next;
+	int levellen;
+	int wild;
+
+	if (level == NULL)
+	{
+		*mask |= node->subscribers;
+		if ((child = findChild(node, "#", 1)) != NULL) /* "a/#" matches "a" too */
+			*mask |= child->subscribers;
+		return;
+	}
+	sep = memchr(level, '/', end - level);
+	levellen = (sep ? sep : end) - level;
+	next = sep ? sep + 1 : NULL;
+	wild = !(root && levellen > 0 && level[0] == '$'); /* wildcards at the start never match $ topics */
+
+	for (child = node->child; child; child = child->sibling)
+	{
+		if (child->len == 1 && child->level[0] == '#')
+		{
+			if (wild)
+				*mask |= child->subscribers;
+		}
+		else if (child->len == 1 && child->level[0] == '+')
+		{
+			if (wild)
+				match(child, next, end, 0, mask);
+		}
+		else if (child->len == levellen && memcmp(child->level, level, levellen) == 0)
+			match(child, next, end, 0, mask);
+	}
+}
+
+
+static void unsubscribeAll(MQTTBrokerTopicNode* node, unsigned long bit)
+{
+	MQTTBrokerTopicNode* child = node->child;
+
+	while (child)
+	{
+		MQTTBrokerTopicNode* sibling = child->sibling; /* child may be pruned */
+
+		unsubscribeAll(child, bit);
+		child = sibling;
+	}
+	node->subscribers &= ~bit;
+	pruneOne(node); /* the caller is walking the parent's children, so leave the parent alone */
+}
+
+
+/* does a topic filter match a topic name? */
+static int topicMatches(const char* filter, int filterlen, const char* topic, int topiclen)
+{
+	const char* fend = filter + filterlen;
+	const char* tend = topic + topiclen;
+
+	if (topiclen > 0 && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+		return 0;
+	while (filter < fend)
+	{
+		if (*filter == '#')
+			return 1;
+		if (*filter == '+')
+		{
+			while (topic < tend && *topic != '/')
+				++topic;
+			++filter;
+		}
+		else
+		{
+			if (topic >= tend)
+				return (fend - filter == 2 && filter[0] == '/' && filter[1] == '#'); /* "a/#" matches "a" */
+			if (*filter != *topic)
+				return 0;
+			++filter;
+			++topic;
+		}
+	}
+	return topic == tend;
+}
+
+
+/*
+ * Retained messages
+ */
+
+static void retain(MQTTBroker* b, MQTTString* topicName, MQTTBrokerMessage* m, int payloadlen)
+{
+	MQTTBrokerRetained** pp;
+	MQTTBrokerRetained* r;
+	MQTTHeader header;
+	unsigned char* ptr;
+
+	for (pp = &b->retained; *pp; pp = &(*pp)->next)
+	{
+		r = *pp;
+		if (r->topic.lenstring.len == topicName->lenstring.len &&
+				memcmp(r->topic.lenstring.data, topicName->lenstring.data, topicName->lenstring.len) == 0)
+		{
+			*pp = r->next;
+			b->retained_bytes -= r->message->len;
+			releaseMessage(r->message);
+			free(r);
+			break;
+		}
+	}
+	if (payloadlen == 0 || b->retained_bytes + m->len > MQTTBROKER_RETAINED_MAX)
+		return; /* an empty payload only clears the retained message */
+
+	if ((r = malloc(sizeof(MQTTBrokerRetained))) == NULL)
+		return;
+	if ((r->message = newMessage(m->len)) == NULL)
+	{
+		free(r);
+		return;
+	}
+	memcpy(r->message->data, m->data, m->len);
+	header.byte = r->message->data[0];
+	header.bits.retain = 1;
+	r->message->data[0] = header.byte;
+	ptr = r->message->data + 1;
+	MQTTPacket_readRemainingLength(&ptr, r->message->data + r->message->len);
+	readMQTTLenString(&r->topic, &ptr, r->message->data + r->message->len);
+	r->next = b->retained;
+	b->retained = r;
+	b->retained_bytes += r->message->len;
+}
+
+
+static void sendRetained(MQTTBrokerClient* c, const char* filter, int filterlen)
+{
+	MQTTBrokerRetained* r;
+
+	for (r = c->broker->retained; r; r = r->next)
+	{
+		if (topicMatches(filter, filterlen, r->topic.lenstring.data, r->topic.lenstring.len))
+			enqueue(c, r->message);
+	}
+}
+
+
+/* serialize a publish once and queue it for every subscriber */
+static int route(MQTTBroker* b, MQTTString topicName, unsigned char* payload, int payloadlen, unsigned char retained)
+{
+	int len = MQTTPacket_len(2 + MQTTstrlen(topicName) + payloadlen);
+	MQTTBrokerMessage* m = newMessage(len);
+	unsigned long mask = 0;
+	int i;
+
+	if (m == NULL)
+		return -1;
+	MQTTSerialize_publish(m->data, m->len, 0, 0, 0, 0, topicName, payload, payloadlen);
+	++b->published;
+
+	if (topicName.cstring)
+	{
+		topicName.lenstring.data = topicName.cstring;
+		topicName.lenstring.len = strlen(topicName.cstring);
+	}
+	match(&b->root, topicName.lenstring.data, topicName.lenstring.data + topicName.lenstring.len, 1, &mask);
+	for (i = 0; mask; ++i, mask >>= 1)
+	{
+		if ((mask & 1) && b->clients[i].connected)
+		{
+			enqueue(&b->clients[i], m);
+			++b->delivered;
+		}
+	}
+	if (retained)
+		retain(b, &topicName, m, payloadlen);
+	releaseMessage(m);
+	return 0;
+}
+
+
+/*
+ * Client connections
+ */
+
+static void closeClient(MQTTBrokerClient* c)
+{
+	MQTTBroker* b = c->broker;
+
+	MQTTReactor_cancel(b->reactor, &c->timer);
+	MQTTReactor_remove(b->reactor, &c->handle);
+	close(c->handle.fd);
+	c->handle.fd = -1;
+	dropQueue(c);
+	unsubscribeAll(&b->root, 1UL << c->index);
+	c->connected = c->closing = 0;
+}
+
+
+static void onTimer(void* arg)
+{
+	MQTTBrokerClient* c = (MQTTBrokerClient*)arg;
+	unsigned long allowed = c->connected ? c->keepAliveInterval * 1500UL : MQTTBROKER_CONNECT_TIMEOUT_MS;
+	unsigned long idle = MQTTReactor_nowMS() - c->last_received;
+
+	if (idle >= allowed)
+		closeClient(c); /* one and a half keepalive intervals without a packet */
+	else
+		MQTTReactor_schedule(c->broker->reactor, &c->timer, allowed - idle);
+}
+
+
+static void handleConnect(MQTTBrokerClient* c)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	unsigned char buf[4];
+	unsigned char rc = 0;
+
+	if (MQTTDeserialize_connect(&data, c->readbuf, sizeof(c->readbuf)) != 1)
+	{
+		c->closing = 1;
+		return;
+	}
+	if (data.MQTTVersion != 3 && data.MQTTVersion != 4)
+		rc = 1; /* unacceptable protocol version */
+	enqueueNew(c, buf, MQTTSerialize_connack(buf, sizeof(buf), rc, 0));
+	if (rc != 0)
+	{
+		c->closing = 1;
+		return;
+	}
+	c->connected = 1;
+	c->keepAliveInterval = data.keepAliveInterval;
+	MQTTReactor_cancel(c->broker->reactor, &c->timer);
+	if (c->keepAliveInterval > 0)
+		MQTTReactor_schedule(c->broker->reactor, &c->timer, c->keepAliveInterval * 1500UL);
+}
+
+
+static void handleSubscribe(MQTTBrokerClient* c)
+{
+	MQTTString filters[MQTTBROKER_MAX_FILTERS];
+	int qoss[MQTTBROKER_MAX_FILTERS];
+	unsigned char buf[4 + MQTTBROKER_MAX_FILTERS];
+	unsigned short packetid;
+	unsigned char dup;
+	int count, i;
+
+	if (MQTTDeserialize_subscribe(&dup, &packetid, MQTTBROKER_MAX_FILTERS, &count, filters, qoss,
+			c->readbuf, sizeof(c->readbuf)) != 1)
+	{
+		c->closing = 1;
+		return;
+	}
+	for (i = 0; i < count; ++i)
+	{
+		MQTTBrokerTopicNode* node;
+
+		if (!isValidFilter(filters[i].lenstring.data, filters[i].lenstring.len) ||
+				(node = findFilter(c->broker, filters[i].lenstring.data, filters[i].lenstring.len, 1)) == NULL)
+			qoss[i] = 0x80; /* failure */
+		else
+		{
+			node->subscribers |= 1UL << c->index;
+			qoss[i] = 0; /* everything is delivered at QoS 0 */
+		}
+	}
+	enqueueNew(c, buf, MQTTSerialize_suback(buf, sizeof(buf), packetid, count, qoss));
+	for (i = 0; i < count; ++i)
+	{
+		if (qoss[i] == 0)
+			sendRetained(c, filters[i].lenstring.data, filters[i].lenstring.len);
+	}
+}
+
+
+static void handleUnsubscribe(MQTTBrokerClient* c)
+{
+	MQTTString filters[MQTTBROKER_MAX_FILTERS];
+	unsigned char buf[4];
+	unsigned short packetid;
+	unsigned char dup;
+	int count, i;
+
+	if (MQTTDeserialize_unsubscribe(&dup, &packetid, MQTTBROKER_MAX_FILTERS, &count, filters,
+			c->readbuf, sizeof(c->readbuf)) != 1)
+	{
+		c->closing = 1;
+		return;
+	}
+	for (i = 0; i < count; ++i)
+	{
+		MQTTBrokerTopicNode* node = findFilter(c->broker, filters[i].lenstring.data, filters[i].lenstring.len, 0);
+
+		if (node)
+		{
+			node->subscribers &= ~(1UL << c->index);
+			prune(node);
+		}
+	}
+	enqueueNew(c, buf, MQTTSerialize_unsuback(buf, sizeof(buf), packetid));
+}
+
+
+static void handlePublish(MQTTBrokerClient* c)
+{
+	MQTTString topicName;
+	unsigned char dup, retained, *payload;
+	unsigned char buf[4];
+	unsigned short packetid;
+	int qos, payloadlen;
+
+	if (MQTTDeserialize_publish(&dup, &qos, &retained, &packetid, &topicName, &payload, &payloadlen,
+			c->readbuf, sizeof(c->readbuf)) != 1 || topicName.lenstring.len == 0 ||
+			memchr(topicName.lenstring.data, '+', topicName.lenstring.len) ||
+			memchr(topicName.lenstring.data, '#', topicName.lenstring.len))
+	{
+		c->closing = 1;
+		return;
+	}
+	if (qos == 1)
+		enqueueNew(c, buf, MQTTSerialize_puback(buf, sizeof(buf), packetid));
+	else if (qos == 2)
+		enqueueNew(c, buf, MQTTSerialize_ack(buf, sizeof(buf), PUBREC, 0, packetid));
+	route(c->broker, topicName, payload, payloadlen, retained);
+}
+
+
+static void handlePacket(MQTTBrokerClient* c, int packet_type)
+{
+	unsigned char buf[4];
+	unsigned short packetid;
+	unsigned char type, dup;
+
+	c->last_received = MQTTReactor_nowMS();
+	if (!c->connected && packet_type != CONNECT)
+	{
+		c->closing = 1; /* the first packet must be CONNECT */
+		return;
+	}
+	switch (packet_type)
+	{
+		case CONNECT:
+			if (c->connected)
+				c->closing = 1; /* a second CONNECT is a protocol violation */
+			else
+				handleConnect(c);
+			break;
+		case PUBLISH:
+			handlePublish(c);
+			break;
+		case PUBREL:
+			if (MQTTDeserialize_ack(&type, &dup, &packetid, c->readbuf, sizeof(c->readbuf)) == 1)
+				enqueueNew(c, buf, MQTTSerialize_pubcomp(buf, sizeof(buf), packetid));
+			break;
+		case SUBSCRIBE:
+			handleSubscribe(c);
+			break;
+		case UNSUBSCRIBE:
+			handleUnsubscribe(c);
+			break;
+		case PINGREQ:
+		{
+			MQTTHeader header = {0};
+
+			header.bits.type = PINGRESP;
+			buf[0] = header.byte;
+			buf[1] = 0;
+			enqueueNew(c, buf, 2);
+			break;
+		}
+		case DISCONNECT:
+			c->closing = 1;
+			break;
+		case PUBACK:
+		case PUBREC:
+		case PUBCOMP:
+			break; /* nothing is sent at QoS 1 or 2, so there is nothing to acknowledge */
+		default:
+			c->closing = 1;
+			break;
+	}
+}
+
+
+static void onWritable(void* arg)
+{
+	MQTTBrokerClient* c = (MQTTBrokerClient*)arg;
+
+	flush(c);
+	if (c->closing && c->queue_count == 0)
+		closeClient(c);
+}
+
+
+static void onReadable(void* arg)
+{
+	MQTTBrokerClient* c = (MQTTBrokerClient*)arg;
+
+	while (!c->closing)
+	{
+		int rc = MQTTPacket_readnb(c->readbuf, sizeof(c->readbuf), &c->transport);
+
+		if (rc == 0)
+			break; /* no complete packet yet */
+		if (rc < 0)
+		{
+			dropQueue(c);
+			c->closing = 1;
+			break;
+		}
+		handlePacket(c, rc);
+	}
+	if (c->closing)
+		onWritable(c);
+}
+
+
+static void onAccept(void* arg)
+{
+	MQTTBroker* b = (MQTTBroker*)arg;
+	MQTTBrokerClient* c = NULL;
+	int sock, i;
+
+	if ((sock = accept(b->listener.fd, NULL, NULL)) < 0)
+		return;
+	for (i = 0; i < MQTTBROKER_MAX_CLIENTS && c == NULL; ++i)
+	{
+		if (b->clients[i].handle.fd < 0)
+			c = &b->clients[i];
+	}
+	if (c == NULL)
+	{
+		close(sock); /* full */
+		return;
+	}
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+	c->handle.fd = sock;
+	c->handle.events = MQTTREACTOR_READ;
+	c->transport.state = 0;
+	c->connected = c->closing = 0;
+	c->queue_head = c->queue_count = c->written = 0;
+	c->dropped = 0;
+	c->last_received = MQTTReactor_nowMS();
+	MQTTReactor_add(b->reactor, &c->handle);
+	MQTTReactor_schedule(b->reactor, &c->timer, MQTTBROKER_CONNECT_TIMEOUT_MS);
+}
+
+
+void MQTTBroker_init(MQTTBroker* b, MQTTReactor* reactor, int listen_sock)
+{
+	int i;
+
+	memset(b, 0, sizeof(MQTTBroker));
+	b->reactor = reactor;
+	for (i = 0; i < MQTTBROKER_MAX_CLIENTS; ++i)
+	{
+		MQTTBrokerClient* c = &b->clients[i];
+
+		c->broker = b;
+		c->index = i;
+		c->handle.fd = -1;
+		c->handle.onReadable = onReadable;
+		c->handle.onWritable = onWritable;
+		c->handle.arg = c;
+		c->transport.getfn = brokerRead;
+		c->transport.sck = &c->handle.fd;
+		MQTTReactorTimer_init(&c->timer, onTimer, c);
+	}
+	b->listener.fd = listen_sock;
+	b->listener.events = MQTTREACTOR_READ;
+	b->listener.onReadable = onAccept;
+	b->listener.arg = b;
+	MQTTReactor_add(reactor, &b->listener);
+}
+
+
+int MQTTBroker_publish(MQTTBroker* b, const char* topicName, unsigned char* payload, int payloadlen, unsigned char retained)
+{
+	MQTTString topic = MQTTString_initializer;
+
+	topic.cstring = (char*)topicName;
+	return route(b, topic, payload, payloadlen, retained);
+}
+
+
+void MQTTBroker_stop(MQTTBroker* b)
+{
+	int i;
+
+	MQTTReactor_remove(b->reactor, &b->listener);
+	for (i = 0; i < MQTTBROKER_MAX_CLIENTS; ++i)
+	{
+		if (b->clients[i].handle.fd >= 0)
+			closeClient(&b->clients[i]);
+	}
+	while (b->retained)
+	{
+		MQTTBrokerRetained* r = b->retained;
+
+		b->retained = r->next;
+		releaseMessage(r->message);
+		free(r);
+	}
+	b->retained_bytes = 0;
+}
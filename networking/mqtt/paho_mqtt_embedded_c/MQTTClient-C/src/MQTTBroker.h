@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Small local broker running on an MQTTReactor
+ *******************************************************************************/
+
+#if !defined(__MQTT_BROKER_)
+#define __MQTT_BROKER_
+
+#if defined(__cplusplus)
+ extern "C" {
+#endif
+
+#include "MQTTPacket.h"
+#include "MQTTReactor.h"
+
+/*
+ * A broker for a handful of local clients, so that a gateway can connect its own sensors
+ * to each other without a round trip to the cloud.  It runs on a reactor like the event
+ * client, and so never blocks and needs no task of its own.
+ *
+ * Subscriptions are kept in a topic trie whose nodes hold a bit mask of subscribed clients,
+ * so one walk of the trie finds every receiver of a publish, overlapping subscriptions
+ * included.  A publish is serialized once; every receiver's queue holds a reference to the
+ * same buffer.  Retained messages are kept as those same serialized packets.
+ *
+ * Limitations, to stay small: messages are delivered at QoS 0 (QoS 1 and 2 publishes are
+ * acknowledged as they are received), sessions are always clean, wills are ignored, and a
+ * client whose queue is full misses messages rather than slowing the publisher down.
+ */
+
+#if !defined(MQTTBROKER_MAX_CLIENTS)
+#define MQTTBROKER_MAX_CLIENTS 8 /* redefinable - at most the number of bits in an unsigned long */
+#endif
+
+#if !defined(MQTTBROKER_READBUF_SIZE)
+#define MQTTBROKER_READBUF_SIZE 1024 /* redefinable - largest packet accepted from a client */
+#endif
+
+#if !defined(MQTTBROKER_QUEUE_LEN)
+#define MQTTBROKER_QUEUE_LEN 64 /* redefinable - packets waiting to be written to each client */
+#endif
+
+#if !defined(MQTTBROKER_MAX_FILTERS)
+#define MQTTBROKER_MAX_FILTERS 4 /* redefinable - topic filters in one subscribe or unsubscribe */
+#endif
+
+#if !defined(MQTTBROKER_RETAINED_MAX)
+#define MQTTBROKER_RETAINED_MAX 4096 /* redefinable - bytes of retained messages kept */
+#endif
+
+#if !defined(MQTTBROKER_CONNECT_TIMEOUT_MS)
+#define MQTTBROKER_CONNECT_TIMEOUT_MS 10000 /* redefinable - time allowed for the CONNECT packet */
+#endif
+
+/** A serialized packet shared by all the queues it is on */
+typedef struct MQTTBrokerMessage
+{
+	int refs;
+	int len;
+	unsigned char* data;
+} MQTTBrokerMessage;
+
+typedef struct MQTTBrokerTopicNode
+{
+	struct MQTTBrokerTopicNode* parent;
+	struct MQTTBrokerTopicNode* child;
+	struct MQTTBrokerTopicNode* sibling;
+	unsigned long subscribers;   /**< bit n set if client n subscribed to the filter ending here */
+	int len;
+	char* level;                 /**< this level of the filter, not terminated */
+} MQTTBrokerTopicNode;
+
+typedef struct MQTTBrokerRetained
+{
+	struct MQTTBrokerRetained* next;
+	MQTTBrokerMessage* message;  /**< the publish packet, with the retain flag set */
+	MQTTString topic;            /**< points into message */
+} MQTTBrokerRetained;
+
+typedef struct MQTTBroker MQTTBroker;
+
+typedef struct MQTTBrokerClient
+{
+	MQTTBroker* broker;
+	MQTTReactorHandle handle;
+	MQTTReactorTimer timer;      /**< connect timeout, then keepalive */
+	MQTTTransport transport;
+	int index;
+	char connected;
+	char closing;                /**< close once the queue has been written */
+	unsigned short keepAliveInterval;
+	unsigned long last_received;
+
+	MQTTBrokerMessage* queue[MQTTBROKER_QUEUE_LEN];
+	int queue_head, queue_count;
+	int written;                 /**< bytes of the message at queue_head already written */
+	unsigned long dropped;
+
+	unsigned char readbuf[MQTTBROKER_READBUF_SIZE];
+} MQTTBrokerClient;
+
+struct MQTTBroker
+{
+	MQTTReactor* reactor;
+	MQTTReactorHandle listener;
+	MQTTBrokerClient clients[MQTTBROKER_MAX_CLIENTS];
+	MQTTBrokerTopicNode root;
+	MQTTBrokerRetained* retained;
+	int retained_bytes;
+	unsigned long published,     /**< publishes received */
+	  delivered,                 /**< copies queued for subscribers */
+	  dropped;                   /**< copies lost because a client's queue was full */
+};
+
+/**
+ * Start a broker
+ * @param broker - the broker object to initialize
+ * @param reactor - the reactor that will drive the broker
+ * @param listen_sock - a socket that is already bound and listening
+ */
+DLLExport void MQTTBroker_init(MQTTBroker* broker, MQTTReactor* reactor, int listen_sock);
+
+/** Publish a message from the broker's own application to the connected clients.
+ *  @return 0 if successful, -1 if the message could not be allocated
+ */
+DLLExport int MQTTBroker_publish(MQTTBroker* broker, const char* topicName, unsigned char* payload, int payloadlen,
+		unsigned char retained);
+
+/** Disconnect every client and free all subscriptions and retained messages.  The
+ *  listening socket is not closed.
+ */
+DLLExport void MQTTBroker_stop(MQTTBroker* broker);
+
+#if defined(__cplusplus)
+     }
+#endif
+
+#endif
@@ -87,12 +87,15 @@ static int decodePacket(MQTTClient* c, int* value, int timeout)
 
         if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
         {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
+            len = MQTTPACKET_READ_ERROR; /* bad data */
             goto exit;
         }
         rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
         if (rc != 1)
+        {
+            len = MQTTPACKET_READ_ERROR;
             goto exit;
+        }
         *value += (i & 127) * multiplier;
         multiplier *= 128;
     } while ((i & 128) != 0);
@@ -114,7 +117,13 @@ static int readPacket(MQTTClient* c, Timer* timer)
 
     len = 1;
     /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, TimerLeftMS(timer));
+    if (decodePacket(c, &rem_len, TimerLeftMS(timer)) == MQTTPACKET_READ_ERROR)
+        goto exit;
+    if ((size_t)MQTTPacket_len(rem_len) > c->readbuf_size)
+    {
+        rc = BUFFER_OVERFLOW; /* the packet would not fit in readbuf */
+        goto exit;
+    }
     len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
 
     /* 3. read the rest of the buffer using a callback to supply the rest of the data */
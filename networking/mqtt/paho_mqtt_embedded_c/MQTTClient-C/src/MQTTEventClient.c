@@ -0,0 +1,569 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Non-blocking, event driven client running on an MQTTReactor
+ *******************************************************************************/
+#include "MQTTEventClient.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+
+static int getNextPacketId(MQTTEventClient* c)
+{
+	return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
+}
+
+
+/* MQTTTransport getfn: -1 for error or end of stream, 0 to call again later */
+static int eventRead(void* sck, unsigned char* buf, int len)
+{
+	int rc = recv(*(int*)sck, buf, len, MSG_DONTWAIT);
+
+	if (rc > 0)
+		return rc;
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 0;
+	return -1;
+}
+
+
+static void updateWriteInterest(MQTTEventClient* c)
+{
+	if (c->out_end > c->out_start)
+		c->handle.events |= MQTTREACTOR_WRITE;
+	else
+		c->handle.events &= ~MQTTREACTOR_WRITE;
+}
+
+
+static int flush(MQTTEventClient* c)
+{
+	while (c->out_end > c->out_start)
+	{
+		int rc = send(c->handle.fd, &c->buf[c->out_start], c->out_end - c->out_start, MSG_DONTWAIT);
+
+		if (rc < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				break; /* wait until the reactor says we are writable */
+			return FAILURE;
+		}
+		c->out_start += rc;
+		c->last_sent = MQTTReactor_nowMS();
+	}
+	if (c->out_start == c->out_end)
+		c->out_start = c->out_end = 0;
+	updateWriteInterest(c);
+	return SUCCESS;
+}
+
+
+/* make room at the end of the send buffer and return how much there is */
+static int reserve(MQTTEventClient* c)
+{
+	if (c->out_start > 0)
+	{
+		memmove(c->buf, &c->buf[c->out_start], c->out_end - c->out_start);
+		c->out_end -= c->out_start;
+		c->out_start = 0;
+	}
+	return (int)(c->buf_size - c->out_end);
+}
+
+
+/* a packet of len bytes has been serialized at buf[out_end] */
+static int queuePacket(MQTTEventClient* c, int len)
+{
+	if (len <= 0)
+		return BUFFER_OVERFLOW;
+	c->out_end += len;
+	if (flush(c) != SUCCESS)
+	{
+		MQTTEventClient_close(c, FAILURE);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+
+static int queueAck(MQTTEventClient* c, unsigned char type, unsigned short packetid)
+{
+	int room = reserve(c);
+	return queuePacket(c, MQTTSerialize_ack(&c->buf[c->out_end], room, type, 0, packetid));
+}
+
+
+static int queuePublish(MQTTEventClient* c, unsigned char dup, const char* topicName, MQTTMessage* message)
+{
+	MQTTString topic = MQTTString_initializer;
+	int room = reserve(c);
+
+	topic.cstring = (char*)topicName;
+	return queuePacket(c, MQTTSerialize_publish(&c->buf[c->out_end], room, dup, message->qos, message->retained,
+			message->id, topic, (unsigned char*)message->payload, message->payloadlen));
+}
+
+
+static MQTTEventInflight* findInflight(MQTTEventClient* c, unsigned char expect, unsigned short packetid)
+{
+	int i;
+
+	for (i = 0; i < MQTTEVENT_MAX_INFLIGHT; ++i)
+	{
+		if (c->inflight[i].expect == expect && c->inflight[i].id == packetid)
+			return &c->inflight[i];
+	}
+	return NULL;
+}
+
+
+static MQTTEventInflight* addInflight(MQTTEventClient* c, unsigned char expect, unsigned short packetid)
+{
+	MQTTEventInflight* f = findInflight(c, 0, 0);
+
+	if (f)
+	{
+		memset(f, 0, sizeof(*f));
+		f->id = packetid;
+		f->expect = expect;
+		f->deadline = MQTTReactor_nowMS() + c->command_timeout_ms;
+		if (c->retry_timer.slot < 0)
+			MQTTReactor_schedule(c->reactor, &c->retry_timer, c->command_timeout_ms);
+	}
+	return f;
+}
+
+
+static void complete(MQTTEventClient* c, MQTTEventInflight* f, int rc)
+{
+	unsigned char expect = f->expect;
+	unsigned short id = f->id;
+
+	f->expect = 0;
+	f->id = 0;
+	if (expect == CONNACK)
+	{
+		if (c->callbacks->connected)
+			c->callbacks->connected(c, rc);
+	}
+	else if (c->callbacks->completed)
+		c->callbacks->completed(c, id, rc);
+}
+
+
+// assume topic filter and name are in the correct format:
+// '#' only at the end, '+' and '#' only next to a separator
+static char isTopicMatched(const char* filter, MQTTString* topicName)
+{
+	const char* name = topicName->lenstring.data;
+	const char* name_end = name + topicName->lenstring.len;
+
+	while (*filter)
+	{
+		if (*filter == '#')
+			return 1;
+		if (name == name_end && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0')
+			return 1; /* "a/#" also matches "a" */
+		if (*filter == '+')
+		{
+			while (name < name_end && *name != '/')
+				name++;
+			filter++;
+			continue;
+		}
+		if (name == name_end || *filter != *name)
+			return 0;
+		filter++;
+		name++;
+	}
+	return name == name_end;
+}
+
+
+static void deliverMessage(MQTTEventClient* c, MQTTString* topicName, MQTTMessage* message)
+{
+	MessageData md;
+	int i, delivered = 0;
+
+	md.topicName = topicName;
+	md.message = message;
+	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+	{
+		if (c->messageHandlers[i].topicFilter != 0 && c->messageHandlers[i].fp != NULL &&
+				isTopicMatched(c->messageHandlers[i].topicFilter, topicName))
+		{
+			c->messageHandlers[i].fp(&md);
+			delivered = 1;
+		}
+	}
+	if (!delivered && c->defaultMessageHandler != NULL)
+		c->defaultMessageHandler(&md);
+}
+
+
+static void removeHandler(MQTTEventClient* c, const char* topicFilter)
+{
+	int i;
+
+	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+	{
+		if (c->messageHandlers[i].topicFilter != 0 && strcmp(c->messageHandlers[i].topicFilter, topicFilter) == 0)
+			c->messageHandlers[i].topicFilter = 0;
+	}
+}
+
+
+static void handlePacket(MQTTEventClient* c, int packet_type)
+{
+	MQTTEventInflight* f;
+	unsigned short packetid = 0;
+	unsigned char dup, type;
+
+	switch (packet_type)
+	{
+		case CONNACK:
+		{
+			unsigned char sessionPresent = 0, connack_rc = 255;
+
+			if ((f = findInflight(c, CONNACK, 0)) == NULL)
+				break;
+			if (MQTTDeserialize_connack(&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) != 1)
+				connack_rc = 255;
+			if (connack_rc == 0)
+				c->state = MQTTEVENT_CONNECTED;
+			complete(c, f, connack_rc);
+			if (connack_rc != 0)
+				MQTTEventClient_close(c, connack_rc); /* refused: the server closes the connection anyway */
+			break;
+		}
+		case PUBLISH:
+		{
+			MQTTString topicName;
+			MQTTMessage msg;
+			int intQoS, payloadlen;
+
+			if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
+					(unsigned char**)&msg.payload, &payloadlen, c->readbuf, c->readbuf_size) != 1)
+				break;
+			msg.qos = (enum QoS)intQoS;
+			msg.payloadlen = payloadlen;
+			deliverMessage(c, &topicName, &msg);
+			if (msg.qos == QOS1)
+				queueAck(c, PUBACK, msg.id);
+			else if (msg.qos == QOS2)
+				queueAck(c, PUBREC, msg.id);
+			break;
+		}
+		case PUBREL:
+			if (MQTTDeserialize_ack(&type, &dup, &packetid, c->readbuf, c->readbuf_size) == 1)
+				queueAck(c, PUBCOMP, packetid);
+			break;
+		case PUBREC:
+			if (MQTTDeserialize_ack(&type, &dup, &packetid, c->readbuf, c->readbuf_size) != 1 ||
+					(f = findInflight(c, PUBREC, packetid)) == NULL)
+				break;
+			/* second half of the QoS 2 exchange */
+			f->expect = PUBCOMP;
+			f->retries = 0;
+			f->deadline = MQTTReactor_nowMS() + c->command_timeout_ms;
+			queueAck(c, PUBREL, packetid);
+			break;
+		case PUBACK:
+		case PUBCOMP:
+		case UNSUBACK:
+			if (MQTTDeserialize_ack(&type, &dup, &packetid, c->readbuf, c->readbuf_size) == 1 &&
+					(f = findInflight(c, packet_type, packetid)) != NULL)
+				complete(c, f, SUCCESS);
+			break;
+		case SUBACK:
+		{
+			int count = 0, grantedQoS = -1;
+
+			if (MQTTDeserialize_suback(&packetid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) != 1 ||
+					(f = findInflight(c, SUBACK, packetid)) == NULL)
+				break;
+			if (grantedQoS == 0x80)
+				removeHandler(c, f->topic);
+			complete(c, f, grantedQoS);
+			break;
+		}
+		case PINGRESP:
+			c->ping_outstanding = 0;
+			break;
+	}
+}
+
+
+static void onReadable(void* arg)
+{
+	MQTTEventClient* c = (MQTTEventClient*)arg;
+
+	while (c->state != MQTTEVENT_CLOSED)
+	{
+		int rc = MQTTPacket_readnb(c->readbuf, c->readbuf_size, &c->transport);
+
+		if (rc == 0)
+			break; /* no complete packet yet */
+		if (rc < 0)
+		{
+			MQTTEventClient_close(c, FAILURE);
+			break;
+		}
+		handlePacket(c, rc);
+	}
+}
+
+
+static void onWritable(void* arg)
+{
+	MQTTEventClient* c = (MQTTEventClient*)arg;
+
+	if (flush(c) != SUCCESS)
+		MQTTEventClient_close(c, FAILURE);
+	else if (c->state == MQTTEVENT_DISCONNECTING && c->out_end == 0)
+		MQTTEventClient_close(c, SUCCESS);
+}
+
+
+static void onKeepalive(void* arg)
+{
+	MQTTEventClient* c = (MQTTEventClient*)arg;
+	unsigned long interval = c->keepAliveInterval * 1000UL;
+	unsigned long idle = MQTTReactor_nowMS() - c->last_sent;
+
+	if (c->state == MQTTEVENT_CONNECTING)
+	{
+		MQTTEventClient_close(c, FAILURE); /* no CONNACK within a whole keepalive interval */
+		return;
+	}
+	if (c->state != MQTTEVENT_CONNECTED)
+		return;
+	if (c->ping_outstanding)
+	{
+		MQTTEventClient_close(c, FAILURE); /* no PINGRESP within a whole keepalive interval */
+		return;
+	}
+	if (idle < interval)
+	{
+		/* something else was sent recently, which keeps the session alive for us */
+		MQTTReactor_schedule(c->reactor, &c->keepalive_timer, interval - idle);
+		return;
+	}
+	if (queuePacket(c, MQTTSerialize_pingreq(&c->buf[c->out_end], reserve(c))) == SUCCESS)
+	{
+		c->ping_outstanding = 1;
+		MQTTReactor_schedule(c->reactor, &c->keepalive_timer, interval);
+	}
+}
+
+
+static void onRetry(void* arg)
+{
+	MQTTEventClient* c = (MQTTEventClient*)arg;
+	unsigned long now = MQTTReactor_nowMS();
+	int i, pending = 0;
+
+	for (i = 0; i < MQTTEVENT_MAX_INFLIGHT && c->state != MQTTEVENT_CLOSED; ++i)
+	{
+		MQTTEventInflight* f = &c->inflight[i];
+
+		if (f->expect == 0)
+			continue;
+		if ((long)(f->deadline - now) > 0)
+		{
+			pending = 1;
+			continue;
+		}
+		if ((f->expect == PUBACK || f->expect == PUBREC || f->expect == PUBCOMP) && f->retries < MQTTEVENT_MAX_RETRIES)
+		{
+			f->retries++;
+			f->deadline = now + c->command_timeout_ms;
+			if (f->expect == PUBCOMP)
+				queueAck(c, PUBREL, f->id);
+			else
+				queuePublish(c, 1, f->topic, f->message);
+			pending = 1;
+		}
+		else if (f->expect == CONNACK)
+		{
+			complete(c, f, FAILURE);
+			MQTTEventClient_close(c, FAILURE); /* never connected, nothing more can be sent */
+		}
+		else
+			complete(c, f, FAILURE);
+	}
+	if (pending && c->state != MQTTEVENT_CLOSED)
+		MQTTReactor_schedule(c->reactor, &c->retry_timer, MQTTREACTOR_TICK_MS * 4);
+}
+
+
+void MQTTEventClient_init(MQTTEventClient* c, MQTTReactor* reactor, int sock,
+		unsigned int command_timeout_ms, unsigned char* sendbuf, size_t sendbuf_size,
+		unsigned char* readbuf, size_t readbuf_size, const MQTTEventCallbacks* callbacks, void* context)
+{
+	static const MQTTEventCallbacks no_callbacks = {NULL, NULL, NULL};
+
+	memset(c, 0, sizeof(*c));
+	c->reactor = reactor;
+	c->command_timeout_ms = command_timeout_ms;
+	c->buf = sendbuf;
+	c->buf_size = sendbuf_size;
+	c->readbuf = readbuf;
+	c->readbuf_size = readbuf_size;
+	c->next_packetid = 1;
+	c->callbacks = callbacks ? callbacks : &no_callbacks;
+	c->context = context;
+	c->state = MQTTEVENT_IDLE;
+
+	c->handle.fd = sock;
+	c->handle.events = MQTTREACTOR_READ;
+	c->handle.onReadable = onReadable;
+	c->handle.onWritable = onWritable;
+	c->handle.arg = c;
+	c->transport.getfn = eventRead;
+	c->transport.sck = &c->handle.fd;
+	c->transport.state = 0;
+	MQTTReactorTimer_init(&c->keepalive_timer, onKeepalive, c);
+	MQTTReactorTimer_init(&c->retry_timer, onRetry, c);
+	MQTTReactor_add(reactor, &c->handle);
+}
+
+
+int MQTTEventClient_connect(MQTTEventClient* c, MQTTPacket_connectData* options)
+{
+	MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
+	int rc;
+
+	if (c->state != MQTTEVENT_IDLE)
+		return FAILURE;
+	if (options == 0)
+		options = &default_options;
+	if (findInflight(c, 0, 0) == NULL)
+		return FAILURE;
+
+	c->keepAliveInterval = options->keepAliveInterval;
+	if ((rc = queuePacket(c, MQTTSerialize_connect(&c->buf[c->out_end], reserve(c), options))) != SUCCESS)
+		return rc;
+	c->state = MQTTEVENT_CONNECTING;
+	addInflight(c, CONNACK, 0);
+	if (c->keepAliveInterval > 0)
+		MQTTReactor_schedule(c->reactor, &c->keepalive_timer, c->keepAliveInterval * 1000);
+	return SUCCESS;
+}
+
+
+int MQTTEventClient_publish(MQTTEventClient* c, const char* topicName, MQTTMessage* message)
+{
+	MQTTEventInflight* f = NULL;
+	int rc;
+
+	if (c->state != MQTTEVENT_CONNECTED)
+		return FAILURE;
+	if (message->qos != QOS0 && findInflight(c, 0, 0) == NULL)
+		return FAILURE; /* too many publishes in flight */
+
+	message->id = (message->qos == QOS0) ? 0 : getNextPacketId(c);
+	if ((rc = queuePublish(c, 0, topicName, message)) != SUCCESS)
+		return rc;
+	if (message->qos != QOS0)
+	{
+		f = addInflight(c, (message->qos == QOS1) ? PUBACK : PUBREC, message->id);
+		f->topic = topicName;
+		f->message = message;
+	}
+	return message->id;
+}
+
+
+int MQTTEventClient_subscribe(MQTTEventClient* c, const char* topicFilter, enum QoS qos, messageHandler handler)
+{
+	MQTTString topic = MQTTString_initializer;
+	MQTTEventInflight* f;
+	int i, rc, packetid, intQoS = qos;
+
+	if (c->state != MQTTEVENT_CONNECTED || findInflight(c, 0, 0) == NULL)
+		return FAILURE;
+	for (i = 0; i < MAX_MESSAGE_HANDLERS && c->messageHandlers[i].topicFilter != 0; ++i)
+		;
+	if (i == MAX_MESSAGE_HANDLERS)
+		return FAILURE;
+
+	topic.cstring = (char*)topicFilter;
+	packetid = getNextPacketId(c);
+	if ((rc = queuePacket(c, MQTTSerialize_subscribe(&c->buf[c->out_end], reserve(c), 0, packetid, 1, &topic, &intQoS))) != SUCCESS)
+		return rc;
+	/* install the handler now, retained messages can arrive before the SUBACK */
+	c->messageHandlers[i].topicFilter = topicFilter;
+	c->messageHandlers[i].fp = handler;
+	f = addInflight(c, SUBACK, packetid);
+	f->topic = topicFilter;
+	return packetid;
+}
+
+
+int MQTTEventClient_unsubscribe(MQTTEventClient* c, const char* topicFilter)
+{
+	MQTTString topic = MQTTString_initializer;
+	int rc, packetid;
+
+	if (c->state != MQTTEVENT_CONNECTED || findInflight(c, 0, 0) == NULL)
+		return FAILURE;
+
+	topic.cstring = (char*)topicFilter;
+	packetid = getNextPacketId(c);
+	if ((rc = queuePacket(c, MQTTSerialize_unsubscribe(&c->buf[c->out_end], reserve(c), 0, packetid, 1, &topic))) != SUCCESS)
+		return rc;
+	removeHandler(c, topicFilter);
+	addInflight(c, UNSUBACK, packetid);
+	return packetid;
+}
+
+
+int MQTTEventClient_disconnect(MQTTEventClient* c)
+{
+	int rc;
+
+	if (c->state == MQTTEVENT_CLOSED || c->state == MQTTEVENT_DISCONNECTING)
+		return FAILURE;
+	if ((rc = queuePacket(c, MQTTSerialize_disconnect(&c->buf[c->out_end], reserve(c)))) != SUCCESS)
+		return rc;
+	c->state = MQTTEVENT_DISCONNECTING;
+	if (c->out_end == 0)
+		MQTTEventClient_close(c, SUCCESS); /* already on the wire */
+	return SUCCESS;
+}
+
+
+void MQTTEventClient_close(MQTTEventClient* c, int rc)
+{
+	int i;
+
+	if (c->state == MQTTEVENT_CLOSED)
+		return;
+	c->state = MQTTEVENT_CLOSED;
+	MQTTReactor_remove(c->reactor, &c->handle);
+	MQTTReactor_cancel(c->reactor, &c->keepalive_timer);
+	MQTTReactor_cancel(c->reactor, &c->retry_timer);
+	c->handle.events = 0;
+	c->out_start = c->out_end = 0;
+	for (i = 0; i < MQTTEVENT_MAX_INFLIGHT; ++i)
+	{
+		if (c->inflight[i].expect != 0)
+			complete(c, &c->inflight[i], FAILURE);
+	}
+	if (c->callbacks->closed)
+		c->callbacks->closed(c, rc);
+}
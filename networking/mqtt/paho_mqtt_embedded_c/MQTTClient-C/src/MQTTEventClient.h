@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Non-blocking, event driven client running on an MQTTReactor
+ *******************************************************************************/
+
+#if !defined(__MQTT_EVENT_CLIENT_)
+#define __MQTT_EVENT_CLIENT_
+
+#if defined(__cplusplus)
+ extern "C" {
+#endif
+
+#include "MQTTClient.h"
+#include "MQTTReactor.h"
+
+/*
+ * Unlike MQTTClient, none of the calls below block.  Each one serializes its packet into
+ * the send buffer and returns; the outcome is reported later through MQTTEventCallbacks
+ * when the reactor sees the matching acknowledgement or the command times out.  Any number
+ * of clients (and other sockets) can share one reactor, and so one task; all calls for a
+ * given reactor must be made from the task that runs MQTTReactor_run.
+ *
+ * The socket must already be connected.  The client only reads and writes it with
+ * MSG_DONTWAIT; it never closes it.  TLS is not supported.
+ */
+
+#if !defined(MQTTEVENT_MAX_INFLIGHT)
+#define MQTTEVENT_MAX_INFLIGHT 4 /* redefinable - commands awaiting acknowledgement */
+#endif
+
+#if !defined(MQTTEVENT_MAX_RETRIES)
+#define MQTTEVENT_MAX_RETRIES 3 /* redefinable - resends of an unacknowledged publish */
+#endif
+
+enum MQTTEventState { MQTTEVENT_IDLE, MQTTEVENT_CONNECTING, MQTTEVENT_CONNECTED, MQTTEVENT_DISCONNECTING, MQTTEVENT_CLOSED };
+
+typedef struct MQTTEventClient MQTTEventClient;
+
+typedef struct MQTTEventCallbacks
+{
+	void (*connected) (MQTTEventClient*, int connack_rc);             /**< CONNACK received, or FAILURE on timeout */
+	void (*completed) (MQTTEventClient*, unsigned short packetid, int rc); /**< publish/subscribe/unsubscribe finished */
+	void (*closed) (MQTTEventClient*, int rc);                        /**< client stopped, socket may now be closed */
+} MQTTEventCallbacks;
+
+typedef struct MQTTEventInflight
+{
+	unsigned short id;
+	unsigned char expect;        /**< packet type that moves this entry on, 0 if unused */
+	unsigned char retries;
+	unsigned long deadline;
+	const char* topic;           /**< publish topic or subscribe filter */
+	MQTTMessage* message;        /**< kept for retransmission of QoS 1 and 2 publishes */
+} MQTTEventInflight;
+
+struct MQTTEventClient
+{
+	MQTTReactor* reactor;
+	MQTTReactorHandle handle;
+	MQTTReactorTimer keepalive_timer;
+	MQTTReactorTimer retry_timer;
+	MQTTTransport transport;
+	enum MQTTEventState state;
+
+	unsigned int next_packetid,
+	  command_timeout_ms;
+	unsigned int keepAliveInterval;
+	char ping_outstanding;
+	unsigned long last_sent;
+
+	unsigned char *buf,
+	  *readbuf;
+	size_t buf_size,
+	  readbuf_size,
+	  out_start,                 /* bytes buf[out_start..out_end) are waiting to be written */
+	  out_end;
+
+	struct
+	{
+		const char* topicFilter;
+		messageHandler fp;
+	} messageHandlers[MAX_MESSAGE_HANDLERS];
+	messageHandler defaultMessageHandler;
+
+	MQTTEventInflight inflight[MQTTEVENT_MAX_INFLIGHT];
+	const MQTTEventCallbacks* callbacks;
+	void* context;               /* for the application */
+};
+
+/**
+ * Create an event driven MQTT client object and register it with a reactor
+ * @param client - the client object to initialize
+ * @param reactor - the reactor that will drive the client
+ * @param sock - a connected socket
+ * @param command_timeout_ms - time allowed for each acknowledgement before a retry or failure
+ * @param callbacks - completion callbacks, may contain NULL entries
+ * @param context - application data, returned unchanged in client->context
+ */
+DLLExport void MQTTEventClient_init(MQTTEventClient* client, MQTTReactor* reactor, int sock,
+		unsigned int command_timeout_ms, unsigned char* sendbuf, size_t sendbuf_size,
+		unsigned char* readbuf, size_t readbuf_size, const MQTTEventCallbacks* callbacks, void* context);
+
+/** Queue a CONNECT packet.  callbacks->connected reports the result.
+ *  @return SUCCESS if queued, otherwise a negative returnCode
+ */
+DLLExport int MQTTEventClient_connect(MQTTEventClient* client, MQTTPacket_connectData* options);
+
+/** Queue a PUBLISH packet.  For QoS 1 and 2, topicName and message must remain valid until
+ *  callbacks->completed is called for the returned packet id.
+ *  @return the packet id (0 for QoS 0), otherwise a negative returnCode
+ */
+DLLExport int MQTTEventClient_publish(MQTTEventClient* client, const char* topicName, MQTTMessage* message);
+
+/** Queue a SUBSCRIBE packet.  topicFilter must remain valid while subscribed.
+ *  @return the packet id, otherwise a negative returnCode
+ */
+DLLExport int MQTTEventClient_subscribe(MQTTEventClient* client, const char* topicFilter, enum QoS qos, messageHandler handler);
+
+/** Queue an UNSUBSCRIBE packet.
+ *  @return the packet id, otherwise a negative returnCode
+ */
+DLLExport int MQTTEventClient_unsubscribe(MQTTEventClient* client, const char* topicFilter);
+
+/** Queue a DISCONNECT packet.  The client closes itself once it has been written.
+ *  @return SUCCESS if queued, otherwise a negative returnCode
+ */
+DLLExport int MQTTEventClient_disconnect(MQTTEventClient* client);
+
+/** Stop the client immediately: fail everything in flight and leave the reactor.
+ */
+DLLExport void MQTTEventClient_close(MQTTEventClient* client, int rc);
+
+#if defined(__cplusplus)
+     }
+#endif
+
+#endif
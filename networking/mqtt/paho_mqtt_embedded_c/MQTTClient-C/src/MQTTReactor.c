@@ -0,0 +1,241 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    select() based reactor and timer wheel shared by event driven clients
+ *******************************************************************************/
+#include "MQTTReactor.h"
+
+#include <stddef.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/select.h>
+
+
+unsigned long MQTTReactor_nowMS(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (unsigned long)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+
+static void unlinkTimer(MQTTReactorTimer* t)
+{
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->next = t->prev = t;
+}
+
+
+static void linkTimer(MQTTReactorTimer* head, MQTTReactorTimer* t)
+{
+	t->prev = head->prev;
+	t->next = head;
+	head->prev->next = t;
+	head->prev = t;
+}
+
+
+void MQTTReactor_init(MQTTReactor* r)
+{
+	int i;
+
+	r->handles = NULL;
+	for (i = 0; i < MQTTREACTOR_WHEEL_SLOTS; ++i)
+		r->wheel[i].next = r->wheel[i].prev = &r->wheel[i];
+	r->current = 0;
+	r->last_tick = MQTTReactor_nowMS();
+	r->armed = 0;
+}
+
+
+void MQTTReactor_add(MQTTReactor* r, MQTTReactorHandle* h)
+{
+	h->next = r->handles;
+	r->handles = h;
+}
+
+
+void MQTTReactor_remove(MQTTReactor* r, MQTTReactorHandle* h)
+{
+	MQTTReactorHandle** pp = &r->handles;
+
+	while (*pp && *pp != h)
+		pp = &(*pp)->next;
+	if (*pp)
+		*pp = h->next;
+	h->next = NULL;
+}
+
+
+void MQTTReactorTimer_init(MQTTReactorTimer* t, void (*fn)(void*), void* arg)
+{
+	t->next = t->prev = t;
+	t->rounds = 0;
+	t->slot = -1;
+	t->fn = fn;
+	t->arg = arg;
+}
+
+
+void MQTTReactor_schedule(MQTTReactor* r, MQTTReactorTimer* t, unsigned int timeout_ms)
+{
+	unsigned int ticks = (timeout_ms + MQTTREACTOR_TICK_MS - 1) / MQTTREACTOR_TICK_MS;
+
+	MQTTReactor_cancel(r, t);
+	if (ticks == 0)
+		ticks = 1;
+	/* a timer placed n ticks ahead is first visited after ((n - 1) % slots) + 1 ticks */
+	t->slot = (r->current + ticks) % MQTTREACTOR_WHEEL_SLOTS;
+	t->rounds = (ticks - 1) / MQTTREACTOR_WHEEL_SLOTS;
+	linkTimer(&r->wheel[t->slot], t);
+	r->armed++;
+}
+
+
+void MQTTReactor_cancel(MQTTReactor* r, MQTTReactorTimer* t)
+{
+	if (t->slot < 0)
+		return;
+	unlinkTimer(t);
+	t->slot = -1;
+	r->armed--;
+}
+
+
+/* is h still watched for fd?  A callback may have removed it, and freed it */
+static int isWatched(MQTTReactor* r, MQTTReactorHandle* h, int fd)
+{
+	MQTTReactorHandle* p;
+
+	for (p = r->handles; p; p = p->next)
+	{
+		if (p == h)
+			return h->fd == fd;
+	}
+	return 0;
+}
+
+
+static void tick(MQTTReactor* r)
+{
+	MQTTReactorTimer pending;
+	MQTTReactorTimer* head;
+
+	r->current = (r->current + 1) % MQTTREACTOR_WHEEL_SLOTS;
+	head = &r->wheel[r->current];
+	if (head->next == head)
+		return;
+
+	/* move the slot onto a local list so callbacks can reschedule into this slot or cancel
+	 * timers that have not fired yet */
+	pending.next = head->next;
+	pending.prev = head->prev;
+	pending.next->prev = &pending;
+	pending.prev->next = &pending;
+	head->next = head->prev = head;
+
+	while (pending.next != &pending)
+	{
+		MQTTReactorTimer* t = pending.next;
+
+		unlinkTimer(t);
+		if (t->rounds > 0)
+		{
+			t->rounds--;
+			linkTimer(head, t);
+		}
+		else
+		{
+			t->slot = -1;
+			r->armed--;
+			t->fn(t->arg);
+		}
+	}
+}
+
+
+int MQTTReactor_run(MQTTReactor* r, int timeout_ms)
+{
+	fd_set readfds, writefds;
+	struct timeval tv;
+	MQTTReactorHandle* h;
+	unsigned long now;
+	int maxfd = -1;
+	int rc = 0;
+
+	FD_ZERO(&readfds);
+	FD_ZERO(&writefds);
+	for (h = r->handles; h; h = h->next)
+	{
+		if (h->fd < 0)
+			continue;
+		if (h->events & MQTTREACTOR_READ)
+			FD_SET(h->fd, &readfds);
+		if (h->events & MQTTREACTOR_WRITE)
+			FD_SET(h->fd, &writefds);
+		if ((h->events & (MQTTREACTOR_READ | MQTTREACTOR_WRITE)) && h->fd > maxfd)
+			maxfd = h->fd;
+	}
+
+	if (r->armed > 0)
+	{
+		long until_tick = (long)(r->last_tick + MQTTREACTOR_TICK_MS - MQTTReactor_nowMS());
+
+		if (until_tick < 0)
+			until_tick = 0;
+		if (until_tick < timeout_ms)
+			timeout_ms = (int)until_tick;
+	}
+	if (timeout_ms < 0)
+		timeout_ms = 0;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	if (select(maxfd + 1, &readfds, &writefds, NULL, &tv) < 0)
+		return -1;
+
+	for (h = r->handles; h; )
+	{
+		MQTTReactorHandle* next = h->next; /* the callback may remove h */
+		int fd = h->fd;
+		int events = h->events;
+		int readable = fd >= 0 && (events & MQTTREACTOR_READ) && FD_ISSET(fd, &readfds);
+
+		if (fd >= 0 && (events & MQTTREACTOR_WRITE) && FD_ISSET(fd, &writefds))
+		{
+			h->onWritable(h->arg);
+			rc++;
+			/* h must not be touched again if the callback removed it */
+			if (readable && (!isWatched(r, h, fd) || !(h->events & MQTTREACTOR_READ)))
+				readable = 0;
+		}
+		if (readable)
+		{
+			h->onReadable(h->arg);
+			rc++;
+		}
+		h = next;
+	}
+
+	/* catch up on every tick that elapsed, even if we were late */
+	now = MQTTReactor_nowMS();
+	if (r->armed == 0)
+		r->last_tick = now - (now - r->last_tick) % MQTTREACTOR_TICK_MS; /* nothing to fire, don't spin the wheel */
+	while (now - r->last_tick >= MQTTREACTOR_TICK_MS)
+	{
+		r->last_tick += MQTTREACTOR_TICK_MS;
+		tick(r);
+	}
+	return rc;
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    select() based reactor and timer wheel shared by event driven clients
+ *******************************************************************************/
+
+#if !defined(__MQTT_REACTOR_)
+#define __MQTT_REACTOR_
+
+#if defined(__cplusplus)
+ extern "C" {
+#endif
+
+#if !defined(MQTTREACTOR_WHEEL_SLOTS)
+#define MQTTREACTOR_WHEEL_SLOTS 64 /* redefinable - number of slots in the timer wheel */
+#endif
+
+#if !defined(MQTTREACTOR_TICK_MS)
+#define MQTTREACTOR_TICK_MS 50 /* redefinable - timer resolution in milliseconds */
+#endif
+
+enum MQTTReactorEvents { MQTTREACTOR_READ = 1, MQTTREACTOR_WRITE = 2 };
+
+/**
+ * A timer on the reactor wheel.  The structure is owned by the caller and linked into
+ * the wheel while armed, so scheduling a timer never allocates.
+ */
+typedef struct MQTTReactorTimer
+{
+	struct MQTTReactorTimer* next;
+	struct MQTTReactorTimer* prev;
+	unsigned int rounds;   /**< full turns of the wheel left before the timer fires */
+	int slot;              /**< wheel slot, or -1 when the timer is not armed */
+	void (*fn)(void* arg);
+	void* arg;
+} MQTTReactorTimer;
+
+/**
+ * A socket watched by the reactor.  onReadable/onWritable are called from MQTTReactor_run
+ * when the socket is ready and the matching bit is set in events.
+ */
+typedef struct MQTTReactorHandle
+{
+	int fd;
+	int events;            /**< MQTTREACTOR_READ and/or MQTTREACTOR_WRITE */
+	void (*onReadable)(void* arg);
+	void (*onWritable)(void* arg);
+	void* arg;
+	struct MQTTReactorHandle* next;
+} MQTTReactorHandle;
+
+typedef struct MQTTReactor
+{
+	MQTTReactorHandle* handles;
+	MQTTReactorTimer wheel[MQTTREACTOR_WHEEL_SLOTS]; /* list heads, one per slot */
+	unsigned int current;
+	unsigned long last_tick;
+	int armed;
+} MQTTReactor;
+
+unsigned long MQTTReactor_nowMS(void);
+
+void MQTTReactor_init(MQTTReactor* r);
+void MQTTReactor_add(MQTTReactor* r, MQTTReactorHandle* h);
+void MQTTReactor_remove(MQTTReactor* r, MQTTReactorHandle* h);
+
+void MQTTReactorTimer_init(MQTTReactorTimer* t, void (*fn)(void*), void* arg);
+void MQTTReactor_schedule(MQTTReactor* r, MQTTReactorTimer* t, unsigned int timeout_ms);
+void MQTTReactor_cancel(MQTTReactor* r, MQTTReactorTimer* t);
+
+/** Wait up to timeout_ms for socket readiness, then dispatch ready handles and expired timers.
+ *  A callback may remove its own handle or cancel/schedule any timer, but must not remove
+ *  other handles.
+ *  @param r - the reactor
+ *  @param timeout_ms - longest time to block in select
+ *  @return number of handle callbacks made, or -1 if select failed
+ */
+int MQTTReactor_run(MQTTReactor* r, int timeout_ms);
+
+#if defined(__cplusplus)
+     }
+#endif
+
+#endif
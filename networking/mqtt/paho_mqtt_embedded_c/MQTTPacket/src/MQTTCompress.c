@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    LZSS payload compression with a preset dictionary
+ *******************************************************************************/
+
+#include "StackTrace.h"
+#include "MQTTPacket.h"
+
+#include <string.h>
+
+#define WINDOW 4096
+#define MIN_MATCH 3
+#define MAX_MATCH (MIN_MATCH + 15)
+
+/* the byte at position pos of the history, where positions below 0 are in the dictionary */
+#define HISTORY(pos) (((pos) < 0) ? dict[dictlen + (pos)] : in[pos])
+
+
+/**
+ * Compresses a payload
+ * @param dict the preset dictionary, may be NULL if dictlen is 0
+ * @param dictlen the length of the dictionary; only the last 4096 bytes are used
+ * @param in the payload
+ * @param inlen the length of the payload
+ * @param out the buffer for the compressed payload
+ * @param outlen the length of out
+ * @return the compressed length, or -1 if compression would not make the payload smaller
+ */
+int MQTTCompress_encode(const unsigned char* dict, int dictlen, const unsigned char* in, int inlen,
+		unsigned char* out, int outlen)
+{
+	unsigned char* flags = NULL;
+	int bit = 8;
+	int pos = 0;
+	int olen = 0;
+	int rc = -1;
+
+	FUNC_ENTRY;
+	if (inlen <= 0)
+		goto exit;
+	if (outlen >= inlen)
+		outlen = inlen - 1; /* no point sending it compressed unless it saves something */
+	while (pos < inlen)
+	{
+		int start = pos - WINDOW;
+		int maxlen = inlen - pos;
+		int bestlen = 0, bestdist = 0;
+		int cand;
+
+		if (start < -dictlen)
+			start = -dictlen;
+		if (maxlen > MAX_MATCH)
+			maxlen = MAX_MATCH;
+
+		for (cand = pos - 1; cand >= start && bestlen < maxlen; --cand)
+		{
+			int len = 0;
+
+			/* a match may run on into the bytes it is copying, which repeats them */
+			while (len < maxlen && HISTORY(cand + len) == in[pos + len])
+				++len;
+			if (len > bestlen)
+			{
+				bestlen = len;
+				bestdist = pos - cand;
+			}
+		}
+
+		if (bit == 8)
+		{
+			if (olen >= outlen)
+				goto exit;
+			flags = &out[olen++];
+			*flags = 0;
+			bit = 0;
+		}
+		if (bestlen >= MIN_MATCH)
+		{
+			if (olen + 2 > outlen)
+				goto exit;
+			out[olen++] = (bestdist - 1) & 0xff;
+			out[olen++] = (((bestdist - 1) >> 8) << 4) | (bestlen - MIN_MATCH);
+			pos += bestlen;
+		}
+		else
+		{
+			if (olen >= outlen)
+				goto exit;
+			*flags |= 1 << bit;
+			out[olen++] = in[pos++];
+		}
+		++bit;
+	}
+	rc = olen;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Decompresses a payload
+ * @param dict the preset dictionary the payload was compressed with
+ * @param dictlen the length of the dictionary
+ * @param in the compressed payload
+ * @param inlen the length of the compressed payload
+ * @param out the buffer for the payload
+ * @param outlen the length of out
+ * @return the decompressed length, or -1 if the input is malformed or does not fit in out
+ */
+int MQTTCompress_decode(const unsigned char* dict, int dictlen, const unsigned char* in, int inlen,
+		unsigned char* out, int outlen)
+{
+	int ipos = 0;
+	int opos = 0;
+	int rc = -1;
+
+	FUNC_ENTRY;
+	while (ipos < inlen)
+	{
+		unsigned char flags = in[ipos++];
+		int bit;
+
+		for (bit = 0; bit < 8 && ipos < inlen; ++bit)
+		{
+			if (flags & (1 << bit))
+			{
+				if (opos >= outlen)
+					goto exit;
+				out[opos++] = in[ipos++];
+			}
+			else
+			{
+				int dist, len;
+
+				if (inlen - ipos < 2)
+					goto exit;
+				dist = (in[ipos] | ((in[ipos + 1] >> 4) << 8)) + 1;
+				len = (in[ipos + 1] & 0x0f) + MIN_MATCH;
+				ipos += 2;
+				if (dist > opos + dictlen || len > outlen - opos)
+					goto exit;
+				while (len--)
+				{
+					int from = opos - dist;
+
+					out[opos] = (from < 0) ? dict[dictlen + from] : out[from];
+					++opos;
+				}
+			}
+		}
+	}
+	rc = opos;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Fills in the user property that marks a publish payload as compressed
+ * @param prop the property to fill in, ready for MQTTProperties_add
+ */
+void MQTTCompress_property(MQTTProperty* prop)
+{
+	prop->identifier = MQTTPROPERTY_CODE_USER_PROPERTY;
+	prop->value.data.data = MQTTCOMPRESS_PROPERTY_NAME;
+	prop->value.data.len = sizeof(MQTTCOMPRESS_PROPERTY_NAME) - 1;
+	prop->value.value.data = MQTTCOMPRESS_PROPERTY_VALUE;
+	prop->value.value.len = sizeof(MQTTCOMPRESS_PROPERTY_VALUE) - 1;
+}
+
+
+/**
+ * Checks the properties of a received publish for the compression marker
+ * @param properties the publish properties
+ * @return 1 if the payload should be passed to MQTTCompress_decode, otherwise 0
+ */
+int MQTTCompress_isCompressed(MQTTProperties* properties)
+{
+	MQTTProperty* prop = MQTTProperties_getUserProperty(properties, MQTTCOMPRESS_PROPERTY_NAME);
+
+	return prop != NULL && prop->value.value.len == sizeof(MQTTCOMPRESS_PROPERTY_VALUE) - 1 &&
+		memcmp(prop->value.value.data, MQTTCOMPRESS_PROPERTY_VALUE, prop->value.value.len) == 0;
+}
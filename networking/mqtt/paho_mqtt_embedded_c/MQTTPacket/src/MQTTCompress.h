@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    LZSS payload compression with a preset dictionary
+ *******************************************************************************/
+
+#if !defined(MQTTCOMPRESS_H_)
+#define MQTTCOMPRESS_H_
+
+#if !defined(DLLImport)
+  #define DLLImport
+#endif
+#if !defined(DLLExport)
+  #define DLLExport
+#endif
+
+/*
+ * Telemetry payloads are short and repetitive, too short for a general purpose compressor
+ * to find much in one message.  Both ends therefore share a preset dictionary - typically
+ * a sample payload or two - that back-references may point into, as if it had been sent
+ * just before the message.
+ *
+ * The compressed stream is a series of groups: a flag byte followed by up to eight items,
+ * one per flag bit starting with the least significant.  A set bit is a literal byte; a
+ * clear bit is a two byte back-reference: the low byte of (distance - 1), then the top
+ * four bits of (distance - 1) and (length - 3) in the low four bits.  Distances reach up
+ * to 4096 bytes back into the dictionary and the output so far; lengths are 3 to 18.
+ *
+ * A compressed publish carries the user property MQTTCOMPRESS_PROPERTY_NAME with the value
+ * MQTTCOMPRESS_PROPERTY_VALUE, so receivers know to decompress it.  The name is kept short
+ * because it is sent with every compressed message.
+ */
+
+#define MQTTCOMPRESS_PROPERTY_NAME "enc"
+#define MQTTCOMPRESS_PROPERTY_VALUE "lzss"
+
+DLLExport int MQTTCompress_encode(const unsigned char* dict, int dictlen, const unsigned char* in, int inlen,
+		unsigned char* out, int outlen);
+DLLExport int MQTTCompress_decode(const unsigned char* dict, int dictlen, const unsigned char* in, int inlen,
+		unsigned char* out, int outlen);
+DLLExport void MQTTCompress_property(MQTTProperty* prop);
+DLLExport int MQTTCompress_isCompressed(MQTTProperties* properties);
+
+#endif /* MQTTCOMPRESS_H_ */
@@ -22,9 +22,11 @@
 /**
   * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
   * @param options the options to be used to build the connect packet
+  * @param connectProperties MQTT 5 connect properties, used only if options->MQTTVersion is 5
+  * @param willProperties MQTT 5 will properties, used only if options->MQTTVersion is 5
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
+int MQTTSerialize_connectLength(MQTTPacket_connectData* options, MQTTProperties* connectProperties, MQTTProperties* willProperties)
 {
 	int len = 0;
 
@@ -34,10 +36,16 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
 		len = 12; /* variable depending on MQTT or MQIsdp */
 	else if (options->MQTTVersion == 4)
 		len = 10;
+	else if (options->MQTTVersion == 5)
+		len = 10 + MQTTProperties_len(connectProperties);
 
 	len += MQTTstrlen(options->clientID)+2;
 	if (options->willFlag)
+	{
 		len += MQTTstrlen(options->will.topicName)+2 + MQTTstrlen(options->will.message)+2;
+		if (options->MQTTVersion == 5)
+			len += MQTTProperties_len(willProperties);
+	}
 	if (options->username.cstring || options->username.lenstring.data)
 		len += MQTTstrlen(options->username)+2;
 	if (options->password.cstring || options->password.lenstring.data)
@@ -56,6 +64,22 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
   * @return serialized length, or error if 0
   */
 int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options)
+{
+	return MQTTV5Serialize_connect(buf, buflen, options, NULL, NULL);
+}
+
+
+/**
+  * Serializes the connect options into the buffer.  The packet is MQTT 5 if options->MQTTVersion is 5.
+  * @param buf the buffer into which the packet will be serialized
+  * @param len the length in bytes of the supplied buffer
+  * @param options the options to be used to build the connect packet
+  * @param connectProperties MQTT 5 connect properties, or NULL for none
+  * @param willProperties MQTT 5 will properties, or NULL for none
+  * @return serialized length, or error if 0
+  */
+int MQTTV5Serialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options,
+		MQTTProperties* connectProperties, MQTTProperties* willProperties)
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -64,7 +88,7 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 	int rc = -1;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(len = MQTTSerialize_connectLength(options)) > buflen)
+	if (MQTTPacket_len(len = MQTTSerialize_connectLength(options, connectProperties, willProperties)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -76,10 +100,10 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	ptr += MQTTPacket_encode(ptr, len); /* write remaining length */
 
-	if (options->MQTTVersion == 4)
+	if (options->MQTTVersion == 4 || options->MQTTVersion == 5)
 	{
 		writeCString(&ptr, "MQTT");
-		writeChar(&ptr, (char) 4);
+		writeChar(&ptr, (char) options->MQTTVersion);
 	}
 	else
 	{
@@ -103,9 +127,13 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	writeChar(&ptr, flags.all);
 	writeInt(&ptr, options->keepAliveInterval);
+	if (options->MQTTVersion == 5)
+		MQTTProperties_write(&ptr, connectProperties);
 	writeMQTTString(&ptr, options->clientID);
 	if (options->willFlag)
 	{
+		if (options->MQTTVersion == 5)
+			MQTTProperties_write(&ptr, willProperties);
 		writeMQTTString(&ptr, options->will.topicName);
 		writeMQTTString(&ptr, options->will.message);
 	}
@@ -130,29 +158,51 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
   * @return error code.  1 is success, 0 is failure
   */
 int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connack_rc, unsigned char* buf, int buflen)
+{
+	return MQTTV5Deserialize_connack(NULL, sessionPresent, connack_rc, buf, buflen);
+}
+
+
+/**
+  * Deserializes the supplied (wire) buffer into connack data - reason code and properties
+  * @param connackProperties returned MQTT 5 properties, or NULL to deserialize an MQTT 3.1.1 connack
+  * @param sessionPresent the session present flag returned
+  * @param reasonCode returned integer value of the connack reason code
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param len the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_connack(MQTTProperties* connackProperties, unsigned char* sessionPresent, unsigned char* reasonCode,
+		unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
 	unsigned char* enddata = NULL;
 	int rc = 0;
-	int mylen;
 	MQTTConnackFlags flags = {0};
 
 	FUNC_ENTRY;
+	if (buflen < 2) {
+		goto exit;
+	}
 	header.byte = readChar(&curdata);
 	if (header.bits.type != CONNACK) {
 		goto exit;
 	}
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
-	enddata = curdata + mylen;
+	if ((enddata = MQTTPacket_readRemainingLength(&curdata, buf + buflen)) == NULL) { /* read remaining length */
+		goto exit;
+	}
 	if (enddata - curdata < 2) {
 		goto exit;
 	}
 
 	flags.all = readChar(&curdata);
 	*sessionPresent = flags.bits.sessionpresent;
-	*connack_rc = readChar(&curdata);
+	*reasonCode = readChar(&curdata);
+
+	if (connackProperties && !MQTTProperties_read(connackProperties, &curdata, enddata))
+		goto exit;
 
 	rc = 1;
 exit:
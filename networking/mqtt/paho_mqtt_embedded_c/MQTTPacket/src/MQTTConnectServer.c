@@ -53,21 +53,23 @@ int MQTTDeserialize_connect(MQTTPacket_connectData* data, unsigned char* buf, in
 	MQTTHeader header = {0};
 	MQTTConnectFlags flags = {0};
 	unsigned char* curdata = buf;
-	unsigned char* enddata = &buf[len];
+	unsigned char* enddata = NULL;
 	int rc = 0;
 	MQTTString Protocol;
 	int version;
-	int mylen = 0;
 
 	FUNC_ENTRY;
+	if (len < 2)
+		goto exit;
 	header.byte = readChar(&curdata);
 	if (header.bits.type != CONNECT)
 		goto exit;
 
-	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	if ((enddata = MQTTPacket_readRemainingLength(&curdata, buf + len)) == NULL) /* read remaining length */
+		goto exit;
 
 	if (!readMQTTLenString(&Protocol, &curdata, enddata) ||
-		enddata - curdata < 0) /* do we have enough data to read the protocol version byte? */
+		enddata - curdata < 1) /* do we have enough data to read the protocol version byte? */
 		goto exit;
 
 	version = (int)readChar(&curdata); /* Protocol version */
@@ -76,6 +78,8 @@ int MQTTDeserialize_connect(MQTTPacket_connectData* data, unsigned char* buf, in
 	 */
 	if (MQTTPacket_checkVersion(&Protocol, version))
 	{
+		if (enddata - curdata < 3) /* flags and keepalive */
+			goto exit;
 		flags.all = readChar(&curdata);
 		data->cleansession = flags.bits.cleansession;
 		data->keepAliveInterval = readInt(&curdata);
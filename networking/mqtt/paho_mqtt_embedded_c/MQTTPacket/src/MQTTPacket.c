@@ -49,7 +49,7 @@ int MQTTPacket_encode(unsigned char* buf, int length)
  * Decodes the message length according to the MQTT algorithm
  * @param getcharfn pointer to function to read the next character from the data source
  * @param value the decoded length returned
- * @return the number of bytes read from the socket
+ * @return the number of bytes read from the socket, or MQTTPACKET_READ_ERROR
  */
 int MQTTPacket_decode(int (*getcharfn)(unsigned char*, int), int* value)
 {
@@ -66,12 +66,15 @@ int MQTTPacket_decode(int (*getcharfn)(unsigned char*, int), int* value)
 
 		if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
 		{
-			rc = MQTTPACKET_READ_ERROR;	/* bad data */
+			len = MQTTPACKET_READ_ERROR;	/* bad data */
 			goto exit;
 		}
 		rc = (*getcharfn)(&c, 1);
 		if (rc != 1)
+		{
+			len = MQTTPACKET_READ_ERROR;
 			goto exit;
+		}
 		*value += (c & 127) * multiplier;
 		multiplier *= 128;
 	} while ((c & 128) != 0);
@@ -117,6 +120,42 @@ int MQTTPacket_decodeBuf(unsigned char* buf, int* value)
 }
 
 
+/**
+ * Decodes the remaining length of a packet held in a buffer, without reading past the buffer
+ * @param pptr pointer to the remaining length, just past the header byte - incremented past it
+ * @param bufend pointer to the end of the supplied buffer
+ * @return pointer to the end of the packet, or NULL if the length is malformed or the
+ * packet does not fit in the buffer
+ */
+unsigned char* MQTTPacket_readRemainingLength(unsigned char** pptr, unsigned char* bufend)
+{
+	unsigned char* ptr = *pptr;
+	unsigned char* enddata = NULL;
+	int multiplier = 1;
+	int value = 0;
+	int len = 0;
+	unsigned char c;
+
+	FUNC_ENTRY;
+	do
+	{
+		if (ptr >= bufend || ++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+			goto exit;
+		c = *ptr++;
+		value += (c & 127) * multiplier;
+		multiplier *= 128;
+	} while ((c & 128) != 0);
+
+	if (value > bufend - ptr)
+		goto exit;
+	*pptr = ptr;
+	enddata = ptr + value;
+exit:
+	FUNC_EXIT;
+	return enddata;
+}
+
+
 /**
  * Calculates an integer from two bytes read from the input buffer
  * @param pptr pointer to the input buffer - incremented by the number of bytes used & returned
@@ -221,7 +260,7 @@ int readMQTTLenString(MQTTString* mqttstring, unsigned char** pptr, unsigned cha
 	if (enddata - (*pptr) > 1) /* enough length to read the integer? */
 	{
 		mqttstring->lenstring.len = readInt(pptr); /* increments pptr to point past length */
-		if (&(*pptr)[mqttstring->lenstring.len] <= enddata)
+		if (enddata - (*pptr) >= mqttstring->lenstring.len)
 		{
 			mqttstring->lenstring.data = (char*)*pptr;
 			*pptr += mqttstring->lenstring.len;
@@ -300,12 +339,13 @@ int MQTTPacket_read(unsigned char* buf, int buflen, int (*getfn)(unsigned char*,
 
 	len = 1;
 	/* 2. read the remaining length.  This is variable in itself */
-	MQTTPacket_decode(getfn, &rem_len);
+	if (MQTTPacket_decode(getfn, &rem_len) == MQTTPACKET_READ_ERROR)
+		goto exit;
+	if (MQTTPacket_len(rem_len) > buflen) /* check before encoding, buf may be shorter than the length field */
+		goto exit;
 	len += MQTTPacket_encode(buf + 1, rem_len); /* put the original remaining length back into the buffer */
 
 	/* 3. read the rest of the buffer using a callback to supply the rest of the data */
-	if((rem_len + len) > buflen)
-		goto exit;
 	if ((*getfn)(buf + len, rem_len) != rem_len)
 		goto exit;
 
@@ -382,21 +422,24 @@ int MQTTPacket_readnb(unsigned char* buf, int buflen, MQTTTransport *trp)
 			goto exit;
 		if(frc == 0)
 			return 0;
-		trp->len = 1 + MQTTPacket_encode(buf + 1, trp->rem_len); /* put the original remaining length back into the buffer */
-		if((trp->rem_len + trp->len) > buflen)
+		if (MQTTPacket_len(trp->rem_len) > buflen)
 			goto exit;
+		trp->len = 1 + MQTTPacket_encode(buf + 1, trp->rem_len); /* put the original remaining length back into the buffer */
 		++trp->state;
 		/*FALLTHROUGH*/
 	case 2:
 		/* read the rest of the buffer using a callback to supply the rest of the data */
-		if ((frc=(*trp->getfn)(trp->sck, buf + trp->len, trp->rem_len)) == -1)
-			goto exit;
-		if (frc == 0)
-			return 0;
-		trp->rem_len -= frc;
-		trp->len += frc;
-		if(trp->rem_len)
-			return 0;
+		if (trp->rem_len > 0) /* packets such as PINGRESP have no variable header or payload */
+		{
+			if ((frc=(*trp->getfn)(trp->sck, buf + trp->len, trp->rem_len)) == -1)
+				goto exit;
+			if (frc == 0)
+				return 0;
+			trp->rem_len -= frc;
+			trp->len += frc;
+			if(trp->rem_len)
+				return 0;
+		}
 
 		header.byte = buf[0];
 		rc = header.bits.type;
@@ -88,11 +88,14 @@ typedef struct
 
 int MQTTstrlen(MQTTString mqttstring);
 
+#include "MQTTProperties.h"
 #include "MQTTConnect.h"
 #include "MQTTPublish.h"
 #include "MQTTSubscribe.h"
 #include "MQTTUnsubscribe.h"
 #include "MQTTFormat.h"
+#include "MQTTTopicAlias.h"
+#include "MQTTCompress.h"
 
 int MQTTSerialize_ack(unsigned char* buf, int buflen, unsigned char type, unsigned char dup, unsigned short packetid);
 int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid, unsigned char* buf, int buflen);
@@ -103,6 +106,7 @@ int MQTTPacket_equals(MQTTString* a, char* b);
 int MQTTPacket_encode(unsigned char* buf, int length);
 int MQTTPacket_decode(int (*getcharfn)(unsigned char*, int), int* value);
 int MQTTPacket_decodeBuf(unsigned char* buf, int* value);
+unsigned char* MQTTPacket_readRemainingLength(unsigned char** pptr, unsigned char* bufend);
 
 int readInt(unsigned char** pptr);
 char readChar(unsigned char** pptr);
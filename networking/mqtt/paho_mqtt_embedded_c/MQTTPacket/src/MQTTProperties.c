@@ -0,0 +1,391 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    MQTT 5 properties
+ *******************************************************************************/
+
+#include "StackTrace.h"
+#include "MQTTPacket.h"
+
+#include <string.h>
+
+
+static struct nameToType
+{
+	int identifier;
+	int type;
+} namesToTypes[] =
+{
+	{MQTTPROPERTY_CODE_PAYLOAD_FORMAT_INDICATOR, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_MESSAGE_EXPIRY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_CONTENT_TYPE, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_RESPONSE_TOPIC, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_CORRELATION_DATA, MQTTPROPERTY_TYPE_BINARY_DATA},
+	{MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIER, MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_ASSIGNED_CLIENT_IDENTIFER, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_SERVER_KEEP_ALIVE, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_AUTHENTICATION_METHOD, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_AUTHENTICATION_DATA, MQTTPROPERTY_TYPE_BINARY_DATA},
+	{MQTTPROPERTY_CODE_REQUEST_PROBLEM_INFORMATION, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_WILL_DELAY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_REQUEST_RESPONSE_INFORMATION, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_RESPONSE_INFORMATION, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_SERVER_REFERENCE, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_REASON_STRING, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_RECEIVE_MAXIMUM, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_TOPIC_ALIAS, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_MAXIMUM_QOS, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_RETAIN_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_USER_PROPERTY, MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR},
+	{MQTTPROPERTY_CODE_MAXIMUM_PACKET_SIZE, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_WILDCARD_SUBSCRIPTION_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIERS_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_SHARED_SUBSCRIPTION_AVAILABLE, MQTTPROPERTY_TYPE_BYTE}
+};
+
+
+/**
+ * Returns the type of the value carried by a property
+ * @param identifier the property identifier
+ * @return one of enum MQTTPropertyTypes, or -1 if the identifier is not known
+ */
+int MQTTProperty_getType(int identifier)
+{
+	int i;
+
+	for (i = 0; i < (int)(sizeof(namesToTypes) / sizeof(namesToTypes[0])); ++i)
+	{
+		if (namesToTypes[i].identifier == identifier)
+			return namesToTypes[i].type;
+	}
+	return -1;
+}
+
+
+/**
+ * Returns the number of bytes taken by a variable byte integer
+ */
+static int MQTTProperties_varIntLen(int value)
+{
+	int len = 1;
+
+	while (value >= 128)
+	{
+		value /= 128;
+		++len;
+	}
+	return len;
+}
+
+
+/**
+ * Returns the encoded length of one property, including its identifier
+ */
+static int MQTTProperty_len(MQTTProperty* prop)
+{
+	int len = 1;
+
+	switch (MQTTProperty_getType(prop->identifier))
+	{
+	case MQTTPROPERTY_TYPE_BYTE:
+		len += 1;
+		break;
+	case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+		len += 2;
+		break;
+	case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+		len += 4;
+		break;
+	case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+		len += MQTTProperties_varIntLen(prop->value.integer4);
+		break;
+	case MQTTPROPERTY_TYPE_BINARY_DATA:
+	case MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING:
+		len += 2 + prop->value.data.len;
+		break;
+	case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+		len += 2 + prop->value.data.len + 2 + prop->value.value.len;
+		break;
+	default:
+		len = 0;
+	}
+	return len;
+}
+
+
+/**
+ * Returns the length of a property list as written to a packet: the properties plus the
+ * variable byte integer in front of them
+ * @param props the property list, or NULL for an empty list
+ * @return the serialized length
+ */
+int MQTTProperties_len(MQTTProperties* props)
+{
+	int length = (props == NULL) ? 0 : props->length;
+
+	return length + MQTTProperties_varIntLen(length);
+}
+
+
+/**
+ * Adds a property to a list.  String values are referenced, not copied.
+ * @param props the property list
+ * @param prop the property to add
+ * @return 0 on success, -1 if the list is full or the property identifier is not known
+ */
+int MQTTProperties_add(MQTTProperties* props, MQTTProperty* prop)
+{
+	int rc = -1;
+	int len;
+
+	FUNC_ENTRY;
+	if (props->count >= props->max_count || (len = MQTTProperty_len(prop)) == 0)
+		goto exit;
+	props->array[props->count++] = *prop;
+	props->length += len;
+	rc = 0;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+static void writeLenString(unsigned char** pptr, MQTTLenString* string)
+{
+	writeInt(pptr, string->len);
+	memcpy(*pptr, string->data, string->len);
+	*pptr += string->len;
+}
+
+
+/**
+ * Writes a property list, preceded by its length
+ * @param pptr pointer to the output buffer - incremented by the number of bytes written
+ * @param properties the property list, or NULL for an empty list
+ * @return the number of bytes written
+ */
+int MQTTProperties_write(unsigned char** pptr, MQTTProperties* properties)
+{
+	unsigned char* start = *pptr;
+	int i;
+
+	FUNC_ENTRY;
+	if (properties == NULL)
+	{
+		writeChar(pptr, 0);
+		goto exit;
+	}
+	*pptr += MQTTPacket_encode(*pptr, properties->length);
+	for (i = 0; i < properties->count; ++i)
+	{
+		MQTTProperty* prop = &properties->array[i];
+
+		writeChar(pptr, prop->identifier);
+		switch (MQTTProperty_getType(prop->identifier))
+		{
+		case MQTTPROPERTY_TYPE_BYTE:
+			writeChar(pptr, prop->value.byte);
+			break;
+		case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+			writeInt(pptr, prop->value.integer2);
+			break;
+		case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+			writeInt(pptr, prop->value.integer4 >> 16);
+			writeInt(pptr, prop->value.integer4 & 0xffff);
+			break;
+		case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+			*pptr += MQTTPacket_encode(*pptr, prop->value.integer4);
+			break;
+		case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+			writeLenString(pptr, &prop->value.data);
+			writeLenString(pptr, &prop->value.value);
+			break;
+		default: /* binary data and strings */
+			writeLenString(pptr, &prop->value.data);
+			break;
+		}
+	}
+exit:
+	FUNC_EXIT;
+	return *pptr - start;
+}
+
+
+static int readLenString(MQTTLenString* string, unsigned char** pptr, unsigned char* enddata)
+{
+	if (enddata - *pptr < 2)
+		return 0;
+	string->len = readInt(pptr);
+	if (enddata - *pptr < string->len)
+		return 0;
+	string->data = (char*)*pptr;
+	*pptr += string->len;
+	return 1;
+}
+
+
+static int readVarInt(unsigned int* value, unsigned char** pptr, unsigned char* enddata)
+{
+	unsigned int multiplier = 1;
+	int len = 0;
+	unsigned char c;
+
+	*value = 0;
+	do
+	{
+		if (*pptr >= enddata || ++len > 4)
+			return 0;
+		c = readChar(pptr);
+		*value += (c & 127) * multiplier;
+		multiplier *= 128;
+	} while ((c & 128) != 0);
+	return 1;
+}
+
+
+/**
+ * Reads a property list, preceded by its length.  If there are more properties than
+ * entries in the array the extra ones are skipped, but still validated.
+ * @param properties the list to fill in; array and max_count must be set
+ * @param pptr pointer to the input buffer - incremented past the properties
+ * @param enddata pointer to the end of the packet
+ * @return 1 on success, 0 if the properties are malformed or run past enddata
+ */
+int MQTTProperties_read(MQTTProperties* properties, unsigned char** pptr, unsigned char* enddata)
+{
+	unsigned char* curdata = *pptr;
+	unsigned char* propend;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	properties->count = properties->length = 0;
+	if ((propend = MQTTPacket_readRemainingLength(&curdata, enddata)) == NULL)
+		goto exit;
+	properties->length = propend - curdata;
+
+	while (curdata < propend)
+	{
+		MQTTProperty prop;
+
+		prop.identifier = readChar(&curdata);
+		switch (MQTTProperty_getType(prop.identifier))
+		{
+		case MQTTPROPERTY_TYPE_BYTE:
+			if (propend - curdata < 1)
+				goto exit;
+			prop.value.byte = readChar(&curdata);
+			break;
+		case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+			if (propend - curdata < 2)
+				goto exit;
+			prop.value.integer2 = readInt(&curdata);
+			break;
+		case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+			if (propend - curdata < 4)
+				goto exit;
+			prop.value.integer4 = readInt(&curdata) << 16;
+			prop.value.integer4 |= readInt(&curdata);
+			break;
+		case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+			if (!readVarInt(&prop.value.integer4, &curdata, propend))
+				goto exit;
+			break;
+		case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+			if (!readLenString(&prop.value.data, &curdata, propend) || !readLenString(&prop.value.value, &curdata, propend))
+				goto exit;
+			break;
+		case MQTTPROPERTY_TYPE_BINARY_DATA:
+		case MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING:
+			if (!readLenString(&prop.value.data, &curdata, propend))
+				goto exit;
+			break;
+		default:
+			goto exit; /* an unknown property is a protocol error */
+		}
+		if (properties->count < properties->max_count)
+			properties->array[properties->count++] = prop;
+	}
+	*pptr = curdata;
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+ * Finds the first property with the given identifier
+ * @return the property, or NULL if it is not in the list
+ */
+MQTTProperty* MQTTProperties_get(MQTTProperties* props, int identifier)
+{
+	int i;
+
+	for (i = 0; i < props->count; ++i)
+	{
+		if (props->array[i].identifier == identifier)
+			return &props->array[i];
+	}
+	return NULL;
+}
+
+
+/**
+ * Returns the value of a numeric property
+ * @return the value, or -1 if the property is not in the list or is not numeric
+ */
+int MQTTProperties_getNumericValue(MQTTProperties* props, int identifier)
+{
+	MQTTProperty* prop = MQTTProperties_get(props, identifier);
+	int rc = -1;
+
+	if (prop == NULL)
+		return rc;
+	switch (MQTTProperty_getType(identifier))
+	{
+	case MQTTPROPERTY_TYPE_BYTE:
+		rc = prop->value.byte;
+		break;
+	case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+		rc = prop->value.integer2;
+		break;
+	case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+	case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+		rc = (int)prop->value.integer4;
+		break;
+	}
+	return rc;
+}
+
+
+/**
+ * Finds a user property by name
+ * @return the property, or NULL if there is no user property with that name
+ */
+MQTTProperty* MQTTProperties_getUserProperty(MQTTProperties* props, const char* name)
+{
+	int len = strlen(name);
+	int i;
+
+	for (i = 0; i < props->count; ++i)
+	{
+		MQTTProperty* prop = &props->array[i];
+
+		if (prop->identifier == MQTTPROPERTY_CODE_USER_PROPERTY && prop->value.data.len == len &&
+				memcmp(prop->value.data.data, name, len) == 0)
+			return prop;
+	}
+	return NULL;
+}
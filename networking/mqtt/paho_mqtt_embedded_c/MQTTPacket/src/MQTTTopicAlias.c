@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    MQTT 5 topic alias tables
+ *******************************************************************************/
+
+#include "StackTrace.h"
+#include "MQTTPacket.h"
+
+#include <string.h>
+
+
+/**
+ * Empties an alias table
+ * @param aliases the table
+ * @param maximum the Topic Alias Maximum negotiated for this direction; 0 disables aliases
+ */
+void MQTTTopicAliases_init(MQTTTopicAliases* aliases, int maximum)
+{
+	memset(aliases, 0, sizeof(*aliases));
+	aliases->maximum = (maximum < MQTT_MAX_TOPIC_ALIASES) ? maximum : MQTT_MAX_TOPIC_ALIASES;
+}
+
+
+static int MQTTTopicAliases_equals(const char* stored, MQTTString* topicName)
+{
+	if (topicName->cstring)
+		return strcmp(stored, topicName->cstring) == 0;
+	return (int)strlen(stored) == topicName->lenstring.len &&
+		memcmp(stored, topicName->lenstring.data, topicName->lenstring.len) == 0;
+}
+
+
+/**
+ * Chooses the topic alias for an outgoing publish.  If the topic already has an alias
+ * the topic name is emptied, so that only the alias goes on the wire; otherwise the
+ * topic is given an alias, reusing the oldest one if the table is full, and sent in full
+ * this once.  Send the result in the MQTTPROPERTY_CODE_TOPIC_ALIAS property.
+ * @param aliases the sender's table
+ * @param topicName the topic of the publish - emptied if the alias alone is enough
+ * @return the alias to send, or 0 if this publish should carry no alias
+ */
+unsigned short MQTTTopicAliases_outgoing(MQTTTopicAliases* aliases, MQTTString* topicName)
+{
+	int len = MQTTstrlen(*topicName);
+	unsigned short alias = 0;
+	int i;
+
+	FUNC_ENTRY;
+	if (aliases->maximum == 0 || len == 0 || len >= MQTT_TOPIC_ALIAS_LEN)
+		goto exit;
+
+	for (i = 0; i < aliases->maximum; ++i)
+	{
+		if (aliases->topics[i][0] != '\0' && MQTTTopicAliases_equals(aliases->topics[i], topicName))
+		{
+			alias = i + 1;
+			topicName->cstring = NULL;
+			topicName->lenstring.len = 0;
+			topicName->lenstring.data = NULL;
+			goto exit;
+		}
+	}
+
+	/* not known: take the next slot in turn, so the longest standing mapping is replaced */
+	i = aliases->next;
+	aliases->next = (aliases->next + 1) % aliases->maximum;
+	memcpy(aliases->topics[i], topicName->cstring ? topicName->cstring : topicName->lenstring.data, len);
+	aliases->topics[i][len] = '\0';
+	alias = i + 1;
+exit:
+	FUNC_EXIT_RC(alias);
+	return alias;
+}
+
+
+/**
+ * Resolves the topic of an incoming publish.  A publish carrying both a topic and an alias
+ * (re)defines the alias; one carrying only the alias has its topic filled in from the table.
+ * @param aliases the receiver's table
+ * @param alias the MQTTPROPERTY_CODE_TOPIC_ALIAS value of the publish, 0 if there was none
+ * @param topicName the topic of the publish - on return it is never empty
+ * @return 1 if successful, 0 if the alias is out of range or unknown (a protocol error)
+ */
+int MQTTTopicAliases_incoming(MQTTTopicAliases* aliases, unsigned short alias, MQTTString* topicName)
+{
+	int len = MQTTstrlen(*topicName);
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (alias == 0)
+	{
+		rc = (len > 0);
+		goto exit;
+	}
+	if (alias > aliases->maximum)
+		goto exit;
+
+	if (len > 0)
+	{
+		if (len >= MQTT_TOPIC_ALIAS_LEN)
+			goto exit;
+		memcpy(aliases->topics[alias - 1], topicName->cstring ? topicName->cstring : topicName->lenstring.data, len);
+		aliases->topics[alias - 1][len] = '\0';
+	}
+	else if (aliases->topics[alias - 1][0] == '\0')
+		goto exit;
+	else
+	{
+		topicName->cstring = NULL;
+		topicName->lenstring.data = aliases->topics[alias - 1];
+		topicName->lenstring.len = strlen(aliases->topics[alias - 1]);
+	}
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
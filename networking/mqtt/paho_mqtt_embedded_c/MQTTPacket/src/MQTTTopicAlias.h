@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    MQTT 5 topic alias tables
+ *******************************************************************************/
+
+#if !defined(MQTTTOPICALIAS_H_)
+#define MQTTTOPICALIAS_H_
+
+#if !defined(DLLImport)
+  #define DLLImport
+#endif
+#if !defined(DLLExport)
+  #define DLLExport
+#endif
+
+#if !defined(MQTT_MAX_TOPIC_ALIASES)
+#define MQTT_MAX_TOPIC_ALIASES 8 /* redefinable - aliases remembered in each direction */
+#endif
+
+#if !defined(MQTT_TOPIC_ALIAS_LEN)
+#define MQTT_TOPIC_ALIAS_LEN 64 /* redefinable - longest topic, with terminator, that is given an alias */
+#endif
+
+/**
+ * One direction of the topic alias mapping of a network connection.  A sender uses one
+ * table, initialized with the Topic Alias Maximum from the peer's CONNECT or CONNACK; a
+ * receiver uses another, initialized with the maximum it advertised itself.  Topics are
+ * copied into the table, so the caller's strings need not outlive the publish.  Aliases
+ * only last for the life of a network connection: reinitialize the tables on reconnect.
+ */
+typedef struct
+{
+	unsigned short maximum;   /**< number of aliases in use, at most MQTT_MAX_TOPIC_ALIASES */
+	unsigned short next;      /**< the alias a sender reassigns when the table is full */
+	char topics[MQTT_MAX_TOPIC_ALIASES][MQTT_TOPIC_ALIAS_LEN];
+} MQTTTopicAliases;
+
+DLLExport void MQTTTopicAliases_init(MQTTTopicAliases* aliases, int maximum);
+DLLExport unsigned short MQTTTopicAliases_outgoing(MQTTTopicAliases* aliases, MQTTString* topicName);
+DLLExport int MQTTTopicAliases_incoming(MQTTTopicAliases* aliases, unsigned short alias, MQTTString* topicName);
+
+#endif /* MQTTTOPICALIAS_H_ */
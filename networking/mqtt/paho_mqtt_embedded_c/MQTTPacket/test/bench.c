@@ -0,0 +1,288 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Host benchmark of the MQTTPacket serializers and deserializers
+ *******************************************************************************/
+
+/*
+ Measures nanoseconds per packet to encode and decode each packet type.
+
+    bench [--iterations n] [--max ns] [--trace file]
+
+ With --max, the program exits with a non-zero status if any measurement exceeds the given
+ number of nanoseconds, so a CI job can catch gross regressions in the codec.
+
+ With --trace, it instead reports the bytes on the wire for a recorded trace of publishes,
+ one "topic payload" per line (see telemetry.trace), as MQTT 3.1.1, as MQTT 5 with topic
+ aliases, and as MQTT 5 with topic aliases and payload compression.
+*/
+
+#include "MQTTPacket.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static long iterations = 1000000;
+static double max_ns = 0;
+static int over = 0;
+
+static unsigned char buf[8192];
+static unsigned char payload[4096];
+static volatile int sink; /* stops the compiler optimizing the decode loops away */
+
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void report(const char* name, const char* op, double start, int len)
+{
+	double ns = (now_ns() - start) / iterations;
+
+	printf("%-18s %-6s %6d bytes %9.1f ns/packet %9.1f MB/s\n", name, op, len, ns, len * 1e3 / ns);
+	if (max_ns > 0 && ns > max_ns)
+		over++;
+}
+
+
+static void benchConnect(void)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer, out = MQTTPacket_connectData_initializer;
+	double start;
+	long i;
+	int len = 0;
+
+	data.clientID.cstring = "esp32-sensor-0001";
+	data.username.cstring = "user";
+	data.password.cstring = "password";
+	data.keepAliveInterval = 60;
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_connect(buf, sizeof(buf), &data);
+	report("CONNECT", "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_connect(&out, buf, len);
+	report("CONNECT", "decode", start, len);
+}
+
+
+static void benchPublish(int payloadlen)
+{
+	MQTTString topic = MQTTString_initializer, topicOut;
+	unsigned char dup, retained, *payloadOut;
+	unsigned short packetid;
+	int qos, payloadlenOut;
+	char name[32];
+	double start;
+	long i;
+	int len = 0;
+
+	topic.cstring = "site/building/floor/room/sensor/temperature";
+	snprintf(name, sizeof(name), "PUBLISH %d", payloadlen);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_publish(buf, sizeof(buf), 0, 1, 0, (unsigned short)i, topic, payload, payloadlen);
+	report(name, "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_publish(&dup, &qos, &retained, &packetid, &topicOut, &payloadOut, &payloadlenOut, buf, len);
+	report(name, "decode", start, len);
+}
+
+
+static void benchSubscribe(void)
+{
+	MQTTString topics[2], topicsOut[2];
+	int qoss[2] = {1, 0}, qossOut[2], count;
+	unsigned char dup;
+	unsigned short packetid;
+	double start;
+	long i;
+	int len = 0;
+
+	topics[0].cstring = "site/+/floor/+/sensor/#";
+	topics[1].cstring = "cmd/esp32-sensor-0001";
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_subscribe(buf, sizeof(buf), 0, 1, 2, topics, qoss);
+	report("SUBSCRIBE", "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_subscribe(&dup, &packetid, 2, &count, topicsOut, qossOut, buf, len);
+	report("SUBSCRIBE", "decode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_suback(buf, sizeof(buf), 1, 2, qoss);
+	report("SUBACK", "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_suback(&packetid, 2, &count, qossOut, buf, len);
+	report("SUBACK", "decode", start, len);
+}
+
+
+static void benchAcks(void)
+{
+	unsigned char sessionPresent, connack_rc, type, dup;
+	unsigned short packetid;
+	double start;
+	long i;
+	int len = 0;
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_connack(buf, sizeof(buf), 0, 0);
+	report("CONNACK", "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_connack(&sessionPresent, &connack_rc, buf, len);
+	report("CONNACK", "decode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_puback(buf, sizeof(buf), (unsigned short)i);
+	report("PUBACK", "encode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		sink += MQTTDeserialize_ack(&type, &dup, &packetid, buf, len);
+	report("PUBACK", "decode", start, len);
+
+	start = now_ns();
+	for (i = 0; i < iterations; ++i)
+		len = MQTTSerialize_pingreq(buf, sizeof(buf));
+	report("PINGREQ", "encode", start, len);
+}
+
+
+/* what a deployment would choose: the shape of a typical payload, and the unit strings */
+static const char dictionary[] =
+	"\"unit\":\"hPa\"\"unit\":\"ppm\"\"unit\":\"lx\"\"unit\":\"%\"\"value\":true,\"value\":false,"
+	"{\"ts\":1508140800,\"value\":21.00,\"unit\":\"C\",\"battery\":90}";
+
+
+static int trace(const char* filename)
+{
+	MQTTTopicAliases aliases;
+	MQTTProperty propsArray[2], prop;
+	MQTTProperties props = MQTTProperties_initializer;
+	MQTTString topic = MQTTString_initializer;
+	long v3 = 0, v5 = 0, v5compressed = 0, payloads = 0, count = 0;
+	char line[512];
+	double start, compress_ns = 0;
+	FILE* f = fopen(filename, "r");
+
+	if (f == NULL)
+	{
+		printf("cannot open %s\n", filename);
+		return 1;
+	}
+	MQTTTopicAliases_init(&aliases, 65535); /* as many as the broker allows; the table size limits it */
+	props.array = propsArray;
+	props.max_count = 2;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		char* payload = strchr(line, ' ');
+		unsigned char compressed[512];
+		unsigned short alias;
+		int payloadlen, len, clen;
+
+		if (payload == NULL)
+			continue;
+		*payload++ = '\0';
+		payloadlen = strcspn(payload, "\r\n");
+		topic.cstring = line;
+		++count;
+		payloads += payloadlen;
+
+		v3 += MQTTSerialize_publish(buf, sizeof(buf), 0, 1, 0, 1, topic, (unsigned char*)payload, payloadlen);
+
+		props.count = props.length = 0;
+		if ((alias = MQTTTopicAliases_outgoing(&aliases, &topic)) != 0)
+		{
+			prop.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+			prop.value.integer2 = alias;
+			MQTTProperties_add(&props, &prop);
+		}
+		v5 += (len = MQTTV5Serialize_publish(buf, sizeof(buf), 0, 1, 0, 1, topic, &props, (unsigned char*)payload, payloadlen));
+
+		/* a compressed payload needs the marker property too: send whichever is shorter */
+		start = now_ns();
+		clen = MQTTCompress_encode((const unsigned char*)dictionary, sizeof(dictionary) - 1, (unsigned char*)payload, payloadlen,
+				compressed, sizeof(compressed));
+		compress_ns += now_ns() - start;
+		if (clen > 0)
+		{
+			MQTTCompress_property(&prop);
+			MQTTProperties_add(&props, &prop);
+			if ((clen = MQTTV5Serialize_publish(buf, sizeof(buf), 0, 1, 0, 1, topic, &props, compressed, clen)) < len)
+				len = clen;
+		}
+		v5compressed += len;
+	}
+	fclose(f);
+
+	if (count == 0)
+		return 1;
+	printf("%ld publishes, average payload %.1f bytes, %d topic aliases\n", count, (double)payloads / count, MQTT_MAX_TOPIC_ALIASES);
+	printf("MQTT 3.1.1                      %7.1f bytes/message\n", (double)v3 / count);
+	printf("MQTT 5, topic aliases           %7.1f bytes/message %5.1f%%\n", (double)v5 / count, 100.0 * v5 / v3);
+	printf("MQTT 5, aliases and compression %7.1f bytes/message %5.1f%%  (%.0f ns/message to compress)\n",
+			(double)v5compressed / count, 100.0 * v5compressed / v3, compress_ns / count);
+	return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+	int arg;
+
+	for (arg = 1; arg < argc; ++arg)
+	{
+		if (strcmp(argv[arg], "--iterations") == 0 && arg + 1 < argc)
+			iterations = atol(argv[++arg]);
+		else if (strcmp(argv[arg], "--max") == 0 && arg + 1 < argc)
+			max_ns = atof(argv[++arg]);
+		else if (strcmp(argv[arg], "--trace") == 0 && arg + 1 < argc)
+			return trace(argv[++arg]);
+	}
+	memset(payload, 'x', sizeof(payload));
+
+	benchConnect();
+	benchPublish(16);
+	benchPublish(256);
+	benchPublish(4096);
+	benchSubscribe();
+	benchAcks();
+
+	if (over)
+		printf("%d measurements over %.1f ns\n", over, max_ns);
+	return over;
+}
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * Copyright (c) 2017 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Fuzz harness for the MQTTDeserialize_* functions and MQTTPacket_read
+ *******************************************************************************/
+
+/*
+ libFuzzer:
+
+    clang -g -fsanitize=fuzzer,address,undefined -I../src fuzz_deserialize.c ../src/MQTT*.c -o fuzz_deserialize
+    ./fuzz_deserialize corpus/
+
+ Without libFuzzer (gcc, CI), build with -DFUZZ_STANDALONE.  The program then runs every
+ file named on the command line, followed by a number of random mutations of valid packets:
+
+    gcc -g -fsanitize=address,undefined -DFUZZ_STANDALONE -I../src fuzz_deserialize.c ../src/MQTT*.c -o fuzz_deserialize
+    ./fuzz_deserialize --iterations 200000
+
+ The input is copied into a heap buffer of exactly its own size, so any read past the end
+ of the packet is reported by AddressSanitizer.
+*/
+
+#include "MQTTPacket.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_COUNT 4
+
+static unsigned char* readptr;
+static unsigned char* readend;
+
+/* bounds-checked reader for MQTTPacket_read: never hands out more than the input holds */
+static int boundedRead(unsigned char* buf, int count)
+{
+	if (count < 0 || count > readend - readptr)
+		return -1;
+	memcpy(buf, readptr, count);
+	readptr += count;
+	return count;
+}
+
+
+static void deserializeAll(unsigned char* buf, int len)
+{
+	MQTTPacket_connectData connect = MQTTPacket_connectData_initializer;
+	MQTTProperty propsArray[MAX_COUNT];
+	MQTTProperties props = MQTTProperties_initializer;
+	unsigned char out[256];
+	MQTTString topicName, topicFilters[MAX_COUNT];
+	unsigned char dup, retained, sessionPresent, connack_rc, type;
+	unsigned short packetid;
+	unsigned char* payload;
+	int qos, payloadlen, count, qoss[MAX_COUNT];
+
+	/* every deserializer sees every input, so a wrong packet type is exercised too */
+	MQTTDeserialize_connect(&connect, buf, len);
+	MQTTDeserialize_connack(&sessionPresent, &connack_rc, buf, len);
+	if (MQTTDeserialize_publish(&dup, &qos, &retained, &packetid, &topicName, &payload, &payloadlen, buf, len) == 1)
+	{
+		/* touch what was returned so out of range pointers are caught */
+		if (payloadlen < 0 || payload + payloadlen > buf + len || topicName.lenstring.data + topicName.lenstring.len > (char*)buf + len)
+			abort();
+		if (payloadlen > 0 && (payload[0] ^ payload[payloadlen - 1]) == 0xff)
+			qos++;
+	}
+	MQTTDeserialize_ack(&type, &dup, &packetid, buf, len);
+	MQTTDeserialize_subscribe(&dup, &packetid, MAX_COUNT, &count, topicFilters, qoss, buf, len);
+	MQTTDeserialize_suback(&packetid, MAX_COUNT, &count, qoss, buf, len);
+	MQTTDeserialize_unsubscribe(&dup, &packetid, MAX_COUNT, &count, topicFilters, buf, len);
+	MQTTDeserialize_unsuback(&packetid, buf, len);
+
+	props.array = propsArray;
+	props.max_count = MAX_COUNT;
+	MQTTV5Deserialize_connack(&props, &sessionPresent, &connack_rc, buf, len);
+	if (MQTTV5Deserialize_publish(&dup, &qos, &retained, &packetid, &topicName, &props, &payload, &payloadlen, buf, len) == 1)
+	{
+		if (payloadlen < 0 || payload + payloadlen > buf + len)
+			abort();
+		MQTTCompress_isCompressed(&props);
+	}
+	MQTTV5Deserialize_suback(&packetid, &props, MAX_COUNT, &count, qoss, buf, len);
+	MQTTCompress_decode(buf, len / 2, buf + len / 2, len - len / 2, out, sizeof(out));
+}
+
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size)
+{
+	unsigned char* copy = malloc(size ? size : 1);
+	unsigned char readbuf[64];
+
+	memcpy(copy, data, size);
+	deserializeAll(copy, (int)size);
+
+	/* read the input as a stream into a small buffer, then decode whatever was read */
+	readptr = copy;
+	readend = copy + size;
+	if (MQTTPacket_read(readbuf, sizeof(readbuf), boundedRead) > 0)
+		deserializeAll(readbuf, sizeof(readbuf));
+
+	free(copy);
+	return 0;
+}
+
+
+#if defined(FUZZ_STANDALONE)
+
+static int seeds(unsigned char seed[][128], int* lens)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	MQTTString topic = MQTTString_initializer;
+	int qoss[2] = {1, 2};
+	MQTTString topics[2];
+	MQTTProperty propsArray[2], prop;
+	MQTTProperties props = MQTTProperties_initializer;
+	unsigned char compressed[64];
+	int n = 0, clen;
+
+	data.clientID.cstring = "fuzz";
+	data.username.cstring = "user";
+	data.password.cstring = "pass";
+	data.willFlag = 1;
+	data.will.topicName.cstring = "will/topic";
+	data.will.message.cstring = "bye";
+	lens[n] = MQTTSerialize_connect(seed[n], 128, &data); n++;
+	lens[n] = MQTTSerialize_connack(seed[n], 128, 0, 1); n++;
+	topic.cstring = "site/building/floor/room/sensor/temperature";
+	lens[n] = MQTTSerialize_publish(seed[n], 128, 0, 1, 0, 77, topic, (unsigned char*)"21.5", 4); n++;
+	lens[n] = MQTTSerialize_puback(seed[n], 128, 77); n++;
+	topics[0].cstring = "a/+/c";
+	topics[1].cstring = "d/#";
+	lens[n] = MQTTSerialize_subscribe(seed[n], 128, 0, 5, 2, topics, qoss); n++;
+	lens[n] = MQTTSerialize_suback(seed[n], 128, 5, 2, qoss); n++;
+	lens[n] = MQTTSerialize_unsubscribe(seed[n], 128, 0, 6, 2, topics); n++;
+	lens[n] = MQTTSerialize_unsuback(seed[n], 128, 6); n++;
+
+	props.array = propsArray;
+	props.max_count = 2;
+	prop.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+	prop.value.integer2 = 1;
+	MQTTProperties_add(&props, &prop);
+	MQTTCompress_property(&prop);
+	MQTTProperties_add(&props, &prop);
+	clen = MQTTCompress_encode(NULL, 0, (unsigned char*)"21.5,21.5,21.5,21.5", 19, compressed, sizeof(compressed));
+	lens[n] = MQTTV5Serialize_publish(seed[n], 128, 0, 1, 0, 78, topic, &props, compressed, clen); n++;
+	lens[n] = MQTTV5Serialize_subscribe(seed[n], 128, 0, 7, &props, 2, topics, qoss); n++;
+	return n;
+}
+
+
+static void runFile(const char* name)
+{
+	unsigned char buf[4096];
+	FILE* f = fopen(name, "rb");
+	size_t len;
+
+	if (f == NULL)
+	{
+		printf("cannot open %s\n", name);
+		return;
+	}
+	len = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	LLVMFuzzerTestOneInput(buf, len);
+}
+
+
+int main(int argc, char** argv)
+{
+	unsigned char seed[10][128], input[160];
+	int lens[10];
+	long iterations = 100000, i;
+	int count, arg;
+
+	for (arg = 1; arg < argc; ++arg)
+	{
+		if (strcmp(argv[arg], "--iterations") == 0 && arg + 1 < argc)
+			iterations = atol(argv[++arg]);
+		else
+			runFile(argv[arg]);
+	}
+
+	srand(1);
+	count = seeds(seed, lens);
+	for (i = 0; i < iterations; ++i)
+	{
+		int s = rand() % count;
+		int len = lens[s];
+		int mutations = 1 + rand() % 4;
+
+		memcpy(input, seed[s], len);
+		while (mutations--)
+		{
+			switch (rand() % 4)
+			{
+			case 0: /* flip a byte */
+				input[rand() % len] = rand();
+				break;
+			case 1: /* truncate */
+				len = rand() % (len + 1);
+				break;
+			case 2: /* append junk */
+				if (len < (int)sizeof(input))
+					input[len++] = rand();
+				break;
+			default: /* lie about the remaining length */
+				if (len > 1)
+					input[1] = rand();
+				break;
+			}
+			if (len == 0)
+				break;
+		}
+		LLVMFuzzerTestOneInput(input, len);
+	}
+	printf("fuzz_deserialize: %ld inputs, no failures\n", iterations);
+	return 0;
+}
+
+#endif
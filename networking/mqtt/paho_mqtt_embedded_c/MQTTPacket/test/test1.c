@@ -605,11 +605,195 @@ int test6(struct Options options)
 	return failures;
 }
 
+int test7(struct Options options)
+{
+	int rc = 0;
+	unsigned char buf[100];
+	int buflen = 0;
+	int i;
+
+	unsigned char dup = 0;
+	int qos = 0;
+	unsigned char retained = 0;
+	unsigned short msgid = 0;
+	MQTTString topicString = MQTTString_initializer;
+	unsigned char *payload = NULL;
+	int payloadlen = 0;
+	int count = 0;
+	int grantedQoSs[1];
+	MQTTString topicFilters[1];
+	unsigned char sessionPresent, connack_rc;
+
+	fprintf(xml, "<testcase classname=\"test1\" name=\"malformed packets\"");
+	global_start_time = start_clock();
+	failures = 0;
+	MyLog(LOGA_INFO, "Starting test 7 - rejection of truncated and malformed packets");
+
+	topicString.cstring = "mytopic";
+	buflen = MQTTSerialize_publish(buf, sizeof(buf), 0, 1, 0, 23, topicString, (unsigned char*)"payload", 7);
+	assert("good rc from serialize publish", buflen > 0, "rc was %d\n", buflen);
+
+	/* every truncation of a valid packet must be rejected rather than read past the end */
+	for (i = 0; i < buflen; ++i)
+	{
+		rc = MQTTDeserialize_publish(&dup, &qos, &retained, &msgid, &topicString, &payload, &payloadlen, buf, i);
+		assert1("truncated publish should be rejected", rc != 1, "rc was %d for length %d\n", rc, i);
+	}
+	rc = MQTTDeserialize_publish(&dup, &qos, &retained, &msgid, &topicString, &payload, &payloadlen, buf, buflen);
+	assert("good rc from deserialize publish", rc == 1, "rc was %d\n", rc);
+
+	/* remaining length claims more data than the buffer holds */
+	buf[1] = 0x7f;
+	rc = MQTTDeserialize_publish(&dup, &qos, &retained, &msgid, &topicString, &payload, &payloadlen, buf, buflen);
+	assert("overlong remaining length should be rejected", rc != 1, "rc was %d\n", rc);
+
+	/* five byte remaining length is malformed */
+	memset(buf, 0xff, 6);
+	buf[0] = 0x20;
+	rc = MQTTDeserialize_connack(&sessionPresent, &connack_rc, buf, sizeof(buf));
+	assert("five byte remaining length should be rejected", rc != 1, "rc was %d\n", rc);
+
+	/* more granted QoSs than the caller has room for */
+	grantedQoSs[0] = 0;
+	buflen = MQTTSerialize_suback(buf, sizeof(buf), 7, 1, grantedQoSs);
+	buf[1]++;
+	buf[buflen++] = 1;
+	rc = MQTTDeserialize_suback(&msgid, 1, &count, grantedQoSs, buf, buflen);
+	assert("suback with too many QoSs should be rejected", rc != 1, "rc was %d\n", rc);
+
+	/* more topic filters than the caller has room for */
+	topicFilters[0].cstring = "a";
+	buflen = MQTTSerialize_unsubscribe(buf, sizeof(buf), 0, 7, 1, topicFilters);
+	buf[1] += 3;
+	buf[buflen++] = 0;
+	buf[buflen++] = 1;
+	buf[buflen++] = 'b';
+	rc = MQTTDeserialize_unsubscribe(&dup, &msgid, 1, &count, topicFilters, buf, buflen);
+	assert("unsubscribe with too many topics should be rejected", rc != 1, "rc was %d\n", rc);
+
+/* exit: */
+	MyLog(LOGA_INFO, "TEST7: test %s. %d tests run, %d failures.",
+			(failures == 0) ? "passed" : "failed", tests, failures);
+	write_test_result();
+	return failures;
+}
+
+
+int test8(struct Options options)
+{
+	MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+	MQTTProperty propsArray[4], readArray[4], prop;
+	MQTTProperties props = MQTTProperties_initializer, readProps = MQTTProperties_initializer;
+	MQTTTopicAliases sender, receiver;
+	MQTTString topicString = MQTTString_initializer, topicString2 = MQTTString_initializer;
+	unsigned char buf[200], sessionPresent = 1, reasonCode = 1, dup, retained;
+	unsigned char *payload = (unsigned char*)"{\"temperature\":21.5,\"humidity\":40}", *payload2;
+	unsigned char dict[] = "{\"temperature\":20.0,\"humidity\":50}";
+	unsigned char compressed[64], decompressed[64];
+	unsigned short packetid, alias;
+	int rc, qos, payloadlen = strlen((char*)payload), payloadlen2, len1, len2;
+
+	fprintf(xml, "<testcase classname=\"test1\" name=\"mqtt 5\"");
+	global_start_time = start_clock();
+	failures = 0;
+	MyLog(LOGA_INFO, "Starting test 8 - MQTT 5 properties, topic aliases and compression");
+
+	props.array = propsArray;
+	props.max_count = 4;
+	readProps.array = readArray;
+	readProps.max_count = 4;
+
+	/* CONNECT advertising a topic alias maximum */
+	prop.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM;
+	prop.value.integer2 = 10;
+	rc = MQTTProperties_add(&props, &prop);
+	assert("good rc from properties add", rc == 0, "rc was %d\n", rc);
+	data.MQTTVersion = 5;
+	data.clientID.cstring = "me";
+	rc = MQTTV5Serialize_connect(buf, sizeof(buf), &data, &props, NULL);
+	assert("good rc from serialize connect", rc > 0, "rc was %d\n", rc);
+	assert("protocol level should be 5", buf[8] == 5, "level was %d\n", buf[8]);
+	assert("properties should follow keepalive", buf[12] == 3 && buf[13] == MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM,
+			"properties length was %d\n", buf[12]);
+
+	/* CONNACK carrying a topic alias maximum */
+	buf[0] = CONNACK << 4;
+	buf[1] = 6;
+	buf[2] = 0;
+	buf[3] = 0;
+	memcpy(&buf[4], "\x03\x22\x00\x05", 4);
+	rc = MQTTV5Deserialize_connack(&readProps, &sessionPresent, &reasonCode, buf, 8);
+	assert("good rc from deserialize connack", rc == 1, "rc was %d\n", rc);
+	rc = MQTTProperties_getNumericValue(&readProps, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM);
+	assert("topic alias maximum should be 5", rc == 5, "value was %d\n", rc);
+	buf[4] = 4;
+	rc = MQTTV5Deserialize_connack(&readProps, &sessionPresent, &reasonCode, buf, 8);
+	assert("properties running past the packet should be rejected", rc != 1, "rc was %d\n", rc);
+
+	/* the first publish on a topic sends topic and alias, the second only the alias */
+	MQTTTopicAliases_init(&sender, 5);
+	MQTTTopicAliases_init(&receiver, 5);
+	topicString.cstring = "site/building/floor/room/sensor/temperature";
+	alias = MQTTTopicAliases_outgoing(&sender, &topicString);
+	assert("first publish should get alias 1", alias == 1 && topicString.cstring != NULL, "alias was %d\n", alias);
+	props.count = props.length = 0;
+	prop.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+	prop.value.integer2 = alias;
+	MQTTProperties_add(&props, &prop);
+	len1 = MQTTV5Serialize_publish(buf, sizeof(buf), 0, 1, 0, 7, topicString, &props, payload, payloadlen);
+	assert("good rc from serialize publish", len1 > 0, "rc was %d\n", len1);
+	rc = MQTTV5Deserialize_publish(&dup, &qos, &retained, &packetid, &topicString2, &readProps, &payload2, &payloadlen2, buf, len1);
+	assert("good rc from deserialize publish", rc == 1, "rc was %d\n", rc);
+	rc = MQTTTopicAliases_incoming(&receiver, MQTTProperties_getNumericValue(&readProps, MQTTPROPERTY_CODE_TOPIC_ALIAS), &topicString2);
+	assert("receiver should record the alias", rc == 1, "rc was %d\n", rc);
+
+	alias = MQTTTopicAliases_outgoing(&sender, &topicString);
+	assert("second publish should reuse alias 1", alias == 1 && topicString.cstring == NULL && topicString.lenstring.len == 0, "alias was %d\n", alias);
+	len2 = MQTTV5Serialize_publish(buf, sizeof(buf), 0, 1, 0, 8, topicString, &props, payload, payloadlen);
+	assert("aliased publish should be shorter", len2 == len1 - 43, "aliased length was %d\n", len2);
+	rc = MQTTV5Deserialize_publish(&dup, &qos, &retained, &packetid, &topicString2, &readProps, &payload2, &payloadlen2, buf, len2);
+	assert("good rc from deserialize publish", rc == 1 && topicString2.lenstring.len == 0, "rc was %d\n", rc);
+	rc = MQTTTopicAliases_incoming(&receiver, MQTTProperties_getNumericValue(&readProps, MQTTPROPERTY_CODE_TOPIC_ALIAS), &topicString2);
+	assert("receiver should resolve the alias", rc == 1 && topicString2.lenstring.len == 43 &&
+			memcmp(topicString2.lenstring.data, "site/building/floor/room/sensor/temperature", 43) == 0,
+			"rc was %d\n", rc);
+	assert("payloads should be the same", payloadlen2 == payloadlen && memcmp(payload, payload2, payloadlen) == 0,
+			"payload length was %d\n", payloadlen2);
+	rc = MQTTTopicAliases_incoming(&receiver, 2, &topicString);
+	assert("unknown alias should be rejected", rc == 0, "rc was %d\n", rc);
+	rc = MQTTTopicAliases_incoming(&receiver, 6, &topicString2);
+	assert("alias above the maximum should be rejected", rc == 0, "rc was %d\n", rc);
+
+	/* compression against a preset dictionary, flagged by a user property */
+	len1 = MQTTCompress_encode(dict, sizeof(dict) - 1, payload, payloadlen, compressed, sizeof(compressed));
+	assert("payload should compress", len1 > 0 && len1 < payloadlen / 2, "compressed length was %d\n", len1);
+	len2 = MQTTCompress_decode(dict, sizeof(dict) - 1, compressed, len1, decompressed, sizeof(decompressed));
+	assert("payload should decompress", len2 == payloadlen && memcmp(payload, decompressed, payloadlen) == 0,
+			"decompressed length was %d\n", len2);
+	len2 = MQTTCompress_decode(NULL, 0, compressed, len1, decompressed, sizeof(decompressed));
+	assert("references outside the dictionary should be rejected", len2 == -1, "decompressed length was %d\n", len2);
+	rc = MQTTCompress_encode(NULL, 0, (unsigned char*)"abc", 3, compressed, sizeof(compressed));
+	assert("incompressible payload should not be compressed", rc == -1, "rc was %d\n", rc);
+
+	MQTTCompress_property(&prop);
+	MQTTProperties_add(&props, &prop);
+	rc = MQTTV5Serialize_publish(buf, sizeof(buf), 0, 0, 0, 0, topicString, &props, compressed, len1);
+	rc = MQTTV5Deserialize_publish(&dup, &qos, &retained, &packetid, &topicString2, &readProps, &payload2, &payloadlen2, buf, rc);
+	assert("good rc from deserialize publish", rc == 1, "rc was %d\n", rc);
+	assert("publish should be marked compressed", MQTTCompress_isCompressed(&readProps) == 1, "count was %d\n", readProps.count);
+
+/* exit: */
+	MyLog(LOGA_INFO, "TEST8: test %s. %d tests run, %d failures.",
+			(failures == 0) ? "passed" : "failed", tests, failures);
+	write_test_result();
+	return failures;
+}
+
 
 int main(int argc, char** argv)
 {
 	int rc = 0;
- 	int (*tests[])() = {NULL, test1, test2, test3, test4, test5, test6};
+ 	int (*tests[])() = {NULL, test1, test2, test3, test4, test5, test6, test7, test8};
 
 	xml = fopen("TEST-test1.xml", "w");
 	fprintf(xml, "<testsuite name=\"test1\" tests=\"%d\">\n", (int)(ARRAY_SIZE(tests) - 1));